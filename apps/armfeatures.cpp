@@ -10,6 +10,21 @@
 
 #include "armfeatures.h"
 #include "restrictions.h"
+#include "strutils.h"
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__linux__)
+    #include <unistd.h>
+    #include <sys/stat.h>
+#elif defined(__APPLE__)
+    #include <unistd.h>
+    #include <sys/stat.h>
+    #include <sys/sysctl.h>
+#endif
 
 
 //----------------------------------------------------------------------------
@@ -54,7 +69,8 @@ ArmFeatures::ArmFeatures() :
     _tcr2(0),
     _trcdevarch(0),
     _pmmir(0),
-    _pmsidr(0)
+    _pmsidr(0),
+    _features()
 {
 }
 
@@ -72,6 +88,464 @@ void ArmFeatures::clear()
     _isar0 = _isar1 = _isar2 = _isar3 = _isar4 = _isar5 = _isar6 = 0;
     _mmfr0 = _mmfr1 = _mmfr2 = _mmfr3 = _mmfr4 = _mmfr5 = 0;
     _ctr = _tcr = _tcr2 = _trcdevarch = _pmmir = _pmsidr = 0;
+    _features.clear();
+}
+
+
+//----------------------------------------------------------------------------
+// Table of all features, in the order of the ArmFeature enumeration.
+//----------------------------------------------------------------------------
+
+namespace {
+    struct FeatureDesc {
+        std::string_view name;
+        bool (ArmFeatures::*get)() const;
+    };
+
+    constexpr FeatureDesc AllFeatures[] = {
+        // Begin generated features list, use "build-features-header.py --update armfeatures.h armfeatures.cpp"
+        {"FEAT_AA32BF16", &ArmFeatures::FEAT_AA32BF16},
+        {"FEAT_AA32HPD", &ArmFeatures::FEAT_AA32HPD},
+        {"FEAT_AA32I8MM", &ArmFeatures::FEAT_AA32I8MM},
+        {"FEAT_AArch32", &ArmFeatures::FEAT_AArch32},
+        {"FEAT_ABLE", &ArmFeatures::FEAT_ABLE},
+        {"FEAT_ADERR", &ArmFeatures::FEAT_ADERR},
+        {"FEAT_AdvSIMD", &ArmFeatures::FEAT_AdvSIMD},
+        {"FEAT_AES", &ArmFeatures::FEAT_AES},
+        {"FEAT_AFP", &ArmFeatures::FEAT_AFP},
+        {"FEAT_AIE", &ArmFeatures::FEAT_AIE},
+        {"FEAT_AMUv1", &ArmFeatures::FEAT_AMUv1},
+        {"FEAT_AMUv1p1", &ArmFeatures::FEAT_AMUv1p1},
+        {"FEAT_ANERR", &ArmFeatures::FEAT_ANERR},
+        {"FEAT_B16B16", &ArmFeatures::FEAT_B16B16},
+        {"FEAT_BBM", &ArmFeatures::FEAT_BBM},
+        {"FEAT_BF16", &ArmFeatures::FEAT_BF16},
+        {"FEAT_BRBE", &ArmFeatures::FEAT_BRBE},
+        {"FEAT_BRBEv1p1", &ArmFeatures::FEAT_BRBEv1p1},
+        {"FEAT_BTI", &ArmFeatures::FEAT_BTI},
+        {"FEAT_CCIDX", &ArmFeatures::FEAT_CCIDX},
+        {"FEAT_CLRBHB", &ArmFeatures::FEAT_CLRBHB},
+        {"FEAT_CMOW", &ArmFeatures::FEAT_CMOW},
+        {"FEAT_CONSTPACFIELD", &ArmFeatures::FEAT_CONSTPACFIELD},
+        {"FEAT_CRC32", &ArmFeatures::FEAT_CRC32},
+        {"FEAT_CSSC", &ArmFeatures::FEAT_CSSC},
+        {"FEAT_CSV2", &ArmFeatures::FEAT_CSV2},
+        {"FEAT_CSV2_1p1", &ArmFeatures::FEAT_CSV2_1p1},
+        {"FEAT_CSV2_1p2", &ArmFeatures::FEAT_CSV2_1p2},
+        {"FEAT_CSV2_2", &ArmFeatures::FEAT_CSV2_2},
+        {"FEAT_CSV2_3", &ArmFeatures::FEAT_CSV2_3},
+        {"FEAT_CSV3", &ArmFeatures::FEAT_CSV3},
+        {"FEAT_D128", &ArmFeatures::FEAT_D128},
+        {"FEAT_Debugv8p1", &ArmFeatures::FEAT_Debugv8p1},
+        {"FEAT_Debugv8p2", &ArmFeatures::FEAT_Debugv8p2},
+        {"FEAT_Debugv8p4", &ArmFeatures::FEAT_Debugv8p4},
+        {"FEAT_Debugv8p8", &ArmFeatures::FEAT_Debugv8p8},
+        {"FEAT_Debugv8p9", &ArmFeatures::FEAT_Debugv8p9},
+        {"FEAT_DGH", &ArmFeatures::FEAT_DGH},
+        {"FEAT_DIT", &ArmFeatures::FEAT_DIT},
+        {"FEAT_DotProd", &ArmFeatures::FEAT_DotProd},
+        {"FEAT_DoubleFault", &ArmFeatures::FEAT_DoubleFault},
+        {"FEAT_DoubleFault2", &ArmFeatures::FEAT_DoubleFault2},
+        {"FEAT_DoubleLock", &ArmFeatures::FEAT_DoubleLock},
+        {"FEAT_DPB", &ArmFeatures::FEAT_DPB},
+        {"FEAT_DPB2", &ArmFeatures::FEAT_DPB2},
+        {"FEAT_E0PD", &ArmFeatures::FEAT_E0PD},
+        {"FEAT_EBEP", &ArmFeatures::FEAT_EBEP},
+        {"FEAT_EBF16", &ArmFeatures::FEAT_EBF16},
+        {"FEAT_ECBHB", &ArmFeatures::FEAT_ECBHB},
+        {"FEAT_ECV", &ArmFeatures::FEAT_ECV},
+        {"FEAT_EPAC", &ArmFeatures::FEAT_EPAC},
+        {"FEAT_ETE", &ArmFeatures::FEAT_ETE},
+        {"FEAT_ETEv1p1", &ArmFeatures::FEAT_ETEv1p1},
+        {"FEAT_ETEv1p2", &ArmFeatures::FEAT_ETEv1p2},
+        {"FEAT_ETEv1p3", &ArmFeatures::FEAT_ETEv1p3},
+        {"FEAT_ETMv4", &ArmFeatures::FEAT_ETMv4},
+        {"FEAT_ETMv4p1", &ArmFeatures::FEAT_ETMv4p1},
+        {"FEAT_ETMv4p2", &ArmFeatures::FEAT_ETMv4p2},
+        {"FEAT_ETMv4p3", &ArmFeatures::FEAT_ETMv4p3},
+        {"FEAT_ETMv4p4", &ArmFeatures::FEAT_ETMv4p4},
+        {"FEAT_ETMv4p5", &ArmFeatures::FEAT_ETMv4p5},
+        {"FEAT_ETMv4p6", &ArmFeatures::FEAT_ETMv4p6},
+        {"FEAT_ETS", &ArmFeatures::FEAT_ETS},
+        {"FEAT_EVT", &ArmFeatures::FEAT_EVT},
+        {"FEAT_ExS", &ArmFeatures::FEAT_ExS},
+        {"FEAT_F32MM", &ArmFeatures::FEAT_F32MM},
+        {"FEAT_F64MM", &ArmFeatures::FEAT_F64MM},
+        {"FEAT_FCMA", &ArmFeatures::FEAT_FCMA},
+        {"FEAT_FGT", &ArmFeatures::FEAT_FGT},
+        {"FEAT_FGT2", &ArmFeatures::FEAT_FGT2},
+        {"FEAT_FHM", &ArmFeatures::FEAT_FHM},
+        {"FEAT_FlagM", &ArmFeatures::FEAT_FlagM},
+        {"FEAT_FlagM2", &ArmFeatures::FEAT_FlagM2},
+        {"FEAT_FP", &ArmFeatures::FEAT_FP},
+        {"FEAT_FP16", &ArmFeatures::FEAT_FP16},
+        {"FEAT_FPAC", &ArmFeatures::FEAT_FPAC},
+        {"FEAT_FPACCOMBINE", &ArmFeatures::FEAT_FPACCOMBINE},
+        {"FEAT_FRINTTS", &ArmFeatures::FEAT_FRINTTS},
+        {"FEAT_GCS", &ArmFeatures::FEAT_GCS},
+        {"FEAT_GICv3", &ArmFeatures::FEAT_GICv3},
+        {"FEAT_GICv4", &ArmFeatures::FEAT_GICv4},
+        {"FEAT_GICv4p1", &ArmFeatures::FEAT_GICv4p1},
+        {"FEAT_GTG", &ArmFeatures::FEAT_GTG},
+        {"FEAT_HAFDBS", &ArmFeatures::FEAT_HAFDBS},
+        {"FEAT_HAFT", &ArmFeatures::FEAT_HAFT},
+        {"FEAT_HBC", &ArmFeatures::FEAT_HBC},
+        {"FEAT_HCX", &ArmFeatures::FEAT_HCX},
+        {"FEAT_HPDS", &ArmFeatures::FEAT_HPDS},
+        {"FEAT_HPDS2", &ArmFeatures::FEAT_HPDS2},
+        {"FEAT_HPMN0", &ArmFeatures::FEAT_HPMN0},
+        {"FEAT_I8MM", &ArmFeatures::FEAT_I8MM},
+        {"FEAT_IDST", &ArmFeatures::FEAT_IDST},
+        {"FEAT_IESB", &ArmFeatures::FEAT_IESB},
+        {"FEAT_ITE", &ArmFeatures::FEAT_ITE},
+        {"FEAT_JSCVT", &ArmFeatures::FEAT_JSCVT},
+        {"FEAT_LOR", &ArmFeatures::FEAT_LOR},
+        {"FEAT_LPA", &ArmFeatures::FEAT_LPA},
+        {"FEAT_LPA2", &ArmFeatures::FEAT_LPA2},
+        {"FEAT_LRCPC", &ArmFeatures::FEAT_LRCPC},
+        {"FEAT_LRCPC2", &ArmFeatures::FEAT_LRCPC2},
+        {"FEAT_LRCPC3", &ArmFeatures::FEAT_LRCPC3},
+        {"FEAT_LS64", &ArmFeatures::FEAT_LS64},
+        {"FEAT_LS64_ACCDATA", &ArmFeatures::FEAT_LS64_ACCDATA},
+        {"FEAT_LS64_V", &ArmFeatures::FEAT_LS64_V},
+        {"FEAT_LSE", &ArmFeatures::FEAT_LSE},
+        {"FEAT_LSE128", &ArmFeatures::FEAT_LSE128},
+        {"FEAT_LSE2", &ArmFeatures::FEAT_LSE2},
+        {"FEAT_LSMAOC", &ArmFeatures::FEAT_LSMAOC},
+        {"FEAT_LVA", &ArmFeatures::FEAT_LVA},
+        {"FEAT_LVA3", &ArmFeatures::FEAT_LVA3},
+        {"FEAT_MEC", &ArmFeatures::FEAT_MEC},
+        {"FEAT_MOPS", &ArmFeatures::FEAT_MOPS},
+        {"FEAT_MPAM", &ArmFeatures::FEAT_MPAM},
+        {"FEAT_MPAMv0p1", &ArmFeatures::FEAT_MPAMv0p1},
+        {"FEAT_MPAMv1p0", &ArmFeatures::FEAT_MPAMv1p0},
+        {"FEAT_MPAMv1p1", &ArmFeatures::FEAT_MPAMv1p1},
+        {"FEAT_MTE", &ArmFeatures::FEAT_MTE},
+        {"FEAT_MTE2", &ArmFeatures::FEAT_MTE2},
+        {"FEAT_MTE3", &ArmFeatures::FEAT_MTE3},
+        {"FEAT_MTE4", &ArmFeatures::FEAT_MTE4},
+        {"FEAT_MTE_CANONICAL_TAGS", &ArmFeatures::FEAT_MTE_CANONICAL_TAGS},
+        {"FEAT_MTE_NO_ADDRESS_TAGS", &ArmFeatures::FEAT_MTE_NO_ADDRESS_TAGS},
+        {"FEAT_MTE_PERM", &ArmFeatures::FEAT_MTE_PERM},
+        {"FEAT_MTE_STORE_ONLY", &ArmFeatures::FEAT_MTE_STORE_ONLY},
+        {"FEAT_MTE_TAGGED_FAR", &ArmFeatures::FEAT_MTE_TAGGED_FAR},
+        {"FEAT_MTPMU", &ArmFeatures::FEAT_MTPMU},
+        {"FEAT_NMI", &ArmFeatures::FEAT_NMI},
+        {"FEAT_nTLBPA", &ArmFeatures::FEAT_nTLBPA},
+        {"FEAT_NV", &ArmFeatures::FEAT_NV},
+        {"FEAT_NV2", &ArmFeatures::FEAT_NV2},
+        {"FEAT_PACIMP", &ArmFeatures::FEAT_PACIMP},
+        {"FEAT_PACQARMA3", &ArmFeatures::FEAT_PACQARMA3},
+        {"FEAT_PACQARMA5", &ArmFeatures::FEAT_PACQARMA5},
+        {"FEAT_PAN", &ArmFeatures::FEAT_PAN},
+        {"FEAT_PAN2", &ArmFeatures::FEAT_PAN2},
+        {"FEAT_PAN3", &ArmFeatures::FEAT_PAN3},
+        {"FEAT_PAuth", &ArmFeatures::FEAT_PAuth},
+        {"FEAT_PAuth2", &ArmFeatures::FEAT_PAuth2},
+        {"FEAT_PFAR", &ArmFeatures::FEAT_PFAR},
+        {"FEAT_PMULL", &ArmFeatures::FEAT_PMULL},
+        {"FEAT_PMUv3", &ArmFeatures::FEAT_PMUv3},
+        {"FEAT_PMUv3_EDGE", &ArmFeatures::FEAT_PMUv3_EDGE},
+        {"FEAT_PMUv3_ICNTR", &ArmFeatures::FEAT_PMUv3_ICNTR},
+        {"FEAT_PMUv3_SS", &ArmFeatures::FEAT_PMUv3_SS},
+        {"FEAT_PMUv3_TH", &ArmFeatures::FEAT_PMUv3_TH},
+        {"FEAT_PMUv3p1", &ArmFeatures::FEAT_PMUv3p1},
+        {"FEAT_PMUv3p4", &ArmFeatures::FEAT_PMUv3p4},
+        {"FEAT_PMUv3p5", &ArmFeatures::FEAT_PMUv3p5},
+        {"FEAT_PMUv3p7", &ArmFeatures::FEAT_PMUv3p7},
+        {"FEAT_PMUv3p8", &ArmFeatures::FEAT_PMUv3p8},
+        {"FEAT_PMUv3p9", &ArmFeatures::FEAT_PMUv3p9},
+        {"FEAT_PRFMSLC", &ArmFeatures::FEAT_PRFMSLC},
+        {"FEAT_RAS", &ArmFeatures::FEAT_RAS},
+        {"FEAT_RASv1p1", &ArmFeatures::FEAT_RASv1p1},
+        {"FEAT_RASv2", &ArmFeatures::FEAT_RASv2},
+        {"FEAT_RDM", &ArmFeatures::FEAT_RDM},
+        {"FEAT_RME", &ArmFeatures::FEAT_RME},
+        {"FEAT_RNG", &ArmFeatures::FEAT_RNG},
+        {"FEAT_RNG_TRAP", &ArmFeatures::FEAT_RNG_TRAP},
+        {"FEAT_RPRES", &ArmFeatures::FEAT_RPRES},
+        {"FEAT_RPRFM", &ArmFeatures::FEAT_RPRFM},
+        {"FEAT_S1PIE", &ArmFeatures::FEAT_S1PIE},
+        {"FEAT_S1POE", &ArmFeatures::FEAT_S1POE},
+        {"FEAT_S2FWB", &ArmFeatures::FEAT_S2FWB},
+        {"FEAT_S2PIE", &ArmFeatures::FEAT_S2PIE},
+        {"FEAT_S2POE", &ArmFeatures::FEAT_S2POE},
+        {"FEAT_SB", &ArmFeatures::FEAT_SB},
+        {"FEAT_SCTLR2", &ArmFeatures::FEAT_SCTLR2},
+        {"FEAT_SEBEP", &ArmFeatures::FEAT_SEBEP},
+        {"FEAT_SEL2", &ArmFeatures::FEAT_SEL2},
+        {"FEAT_SHA1", &ArmFeatures::FEAT_SHA1},
+        {"FEAT_SHA256", &ArmFeatures::FEAT_SHA256},
+        {"FEAT_SHA3", &ArmFeatures::FEAT_SHA3},
+        {"FEAT_SHA512", &ArmFeatures::FEAT_SHA512},
+        {"FEAT_SM3", &ArmFeatures::FEAT_SM3},
+        {"FEAT_SM4", &ArmFeatures::FEAT_SM4},
+        {"FEAT_SME", &ArmFeatures::FEAT_SME},
+        {"FEAT_SME2", &ArmFeatures::FEAT_SME2},
+        {"FEAT_SME2p1", &ArmFeatures::FEAT_SME2p1},
+        {"FEAT_SME_F16F16", &ArmFeatures::FEAT_SME_F16F16},
+        {"FEAT_SME_F64F64", &ArmFeatures::FEAT_SME_F64F64},
+        {"FEAT_SME_FA64", &ArmFeatures::FEAT_SME_FA64},
+        {"FEAT_SME_I16I64", &ArmFeatures::FEAT_SME_I16I64},
+        {"FEAT_SPE", &ArmFeatures::FEAT_SPE},
+        {"FEAT_SPE_CRR", &ArmFeatures::FEAT_SPE_CRR},
+        {"FEAT_SPE_FDS", &ArmFeatures::FEAT_SPE_FDS},
+        {"FEAT_SPECRES", &ArmFeatures::FEAT_SPECRES},
+        {"FEAT_SPECRES2", &ArmFeatures::FEAT_SPECRES2},
+        {"FEAT_SPEv1p1", &ArmFeatures::FEAT_SPEv1p1},
+        {"FEAT_SPEv1p2", &ArmFeatures::FEAT_SPEv1p2},
+        {"FEAT_SPEv1p3", &ArmFeatures::FEAT_SPEv1p3},
+        {"FEAT_SPEv1p4", &ArmFeatures::FEAT_SPEv1p4},
+        {"FEAT_SPMU", &ArmFeatures::FEAT_SPMU},
+        {"FEAT_SSBS", &ArmFeatures::FEAT_SSBS},
+        {"FEAT_SSBS2", &ArmFeatures::FEAT_SSBS2},
+        {"FEAT_SVE", &ArmFeatures::FEAT_SVE},
+        {"FEAT_SVE2", &ArmFeatures::FEAT_SVE2},
+        {"FEAT_SVE2p1", &ArmFeatures::FEAT_SVE2p1},
+        {"FEAT_SVE_AES", &ArmFeatures::FEAT_SVE_AES},
+        {"FEAT_SVE_BitPerm", &ArmFeatures::FEAT_SVE_BitPerm},
+        {"FEAT_SVE_PMULL128", &ArmFeatures::FEAT_SVE_PMULL128},
+        {"FEAT_SVE_SHA3", &ArmFeatures::FEAT_SVE_SHA3},
+        {"FEAT_SVE_SM4", &ArmFeatures::FEAT_SVE_SM4},
+        {"FEAT_SYSINSTR128", &ArmFeatures::FEAT_SYSINSTR128},
+        {"FEAT_SYSREG128", &ArmFeatures::FEAT_SYSREG128},
+        {"FEAT_TCR2", &ArmFeatures::FEAT_TCR2},
+        {"FEAT_THE", &ArmFeatures::FEAT_THE},
+        {"FEAT_TIDCP1", &ArmFeatures::FEAT_TIDCP1},
+        {"FEAT_TLBIOS", &ArmFeatures::FEAT_TLBIOS},
+        {"FEAT_TLBIRANGE", &ArmFeatures::FEAT_TLBIRANGE},
+        {"FEAT_TME", &ArmFeatures::FEAT_TME},
+        {"FEAT_TRBE", &ArmFeatures::FEAT_TRBE},
+        {"FEAT_TRF", &ArmFeatures::FEAT_TRF},
+        {"FEAT_TTCNP", &ArmFeatures::FEAT_TTCNP},
+        {"FEAT_TTL", &ArmFeatures::FEAT_TTL},
+        {"FEAT_TTST", &ArmFeatures::FEAT_TTST},
+        {"FEAT_TWED", &ArmFeatures::FEAT_TWED},
+        {"FEAT_UAO", &ArmFeatures::FEAT_UAO},
+        {"FEAT_VHE", &ArmFeatures::FEAT_VHE},
+        {"FEAT_VMID16", &ArmFeatures::FEAT_VMID16},
+        {"FEAT_VPIPT", &ArmFeatures::FEAT_VPIPT},
+        {"FEAT_WFxT", &ArmFeatures::FEAT_WFxT},
+        {"FEAT_XNX", &ArmFeatures::FEAT_XNX},
+        {"FEAT_XS", &ArmFeatures::FEAT_XS},
+        // End generated features list
+    };
+
+    // Compare feature names, case insensitive.
+    constexpr char LowerChar(char c) { return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c; }
+    constexpr int CompareNames(std::string_view a, std::string_view b)
+    {
+        for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+            if (LowerChar(a[i]) != LowerChar(b[i])) {
+                return LowerChar(a[i]) < LowerChar(b[i]) ? -1 : 1;
+            }
+        }
+        return a.size() == b.size() ? 0 : (a.size() < b.size() ? -1 : 1);
+    }
+
+    // Check that the list is sorted, for binary search.
+    constexpr bool FeaturesSorted()
+    {
+        for (size_t i = 1; i < sizeof(AllFeatures) / sizeof(AllFeatures[0]); i++) {
+            if (CompareNames(AllFeatures[i-1].name, AllFeatures[i].name) >= 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static_assert(sizeof(AllFeatures) / sizeof(AllFeatures[0]) == size_t(ArmFeature::Count), "features list out of date");
+    static_assert(FeaturesSorted(), "features list not sorted");
+}
+
+// Compute the feature set from the register fields.
+void ArmFeatures::computeFeatures()
+{
+    _features.clear();
+    for (size_t i = 0; i < size_t(ArmFeature::Count); i++) {
+        if ((this->*AllFeatures[i].get)()) {
+            _features.set(ArmFeature(i));
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Feature sets.
+//----------------------------------------------------------------------------
+
+size_t FeatureSet::count() const
+{
+    size_t count = 0;
+    for (auto w : _bits) {
+        for (; w != 0; w &= w - 1) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool FeatureSet::subsetOf(const FeatureSet& other) const
+{
+    for (size_t i = 0; i < WORDS; i++) {
+        if ((_bits[i] & ~other._bits[i]) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+FeatureSet& FeatureSet::operator&=(const FeatureSet& other)
+{
+    for (size_t i = 0; i < WORDS; i++) {
+        _bits[i] &= other._bits[i];
+    }
+    return *this;
+}
+
+FeatureSet& FeatureSet::operator|=(const FeatureSet& other)
+{
+    for (size_t i = 0; i < WORDS; i++) {
+        _bits[i] |= other._bits[i];
+    }
+    return *this;
+}
+
+FeatureSet& FeatureSet::operator-=(const FeatureSet& other)
+{
+    for (size_t i = 0; i < WORDS; i++) {
+        _bits[i] &= ~other._bits[i];
+    }
+    return *this;
+}
+
+FeatureSet& FeatureSet::operator^=(const FeatureSet& other)
+{
+    for (size_t i = 0; i < WORDS; i++) {
+        _bits[i] ^= other._bits[i];
+    }
+    return *this;
+}
+
+size_t FeatureSet::hash() const
+{
+    // FNV-1a on 64-bit words.
+    csr_u64_t h = 0xCBF29CE484222325;
+    for (auto w : _bits) {
+        h = (h ^ w) * 0x100000001B3;
+    }
+    return size_t(h);
+}
+
+void FeatureSet::setWords(const std::array<csr_u64_t, WORDS>& words)
+{
+    _bits = words;
+    // Clear unused bits in last word.
+    if (size_t(ArmFeature::Count) % 64 != 0) {
+        _bits[WORDS - 1] &= (csr_u64_t(1) << (size_t(ArmFeature::Count) % 64)) - 1;
+    }
+}
+
+std::string FeatureSet::toHexa() const
+{
+    std::string res;
+    for (size_t i = WORDS; i > 0; i--) {
+        res += Format("%016llX", _bits[i-1]);
+    }
+    return res;
+}
+
+bool FeatureSet::fromHexa(const std::string& hexa)
+{
+    std::array<csr_u64_t, WORDS> words {};
+    size_t bit = 0;
+    for (size_t i = hexa.length(); i > 0; i--) {
+        const char c = hexa[i-1];
+        csr_u64_t nibble = 0;
+        if (c >= '0' && c <= '9') {
+            nibble = c - '0';
+        }
+        else if (c >= 'a' && c <= 'f') {
+            nibble = c - 'a' + 10;
+        }
+        else if (c >= 'A' && c <= 'F') {
+            nibble = c - 'A' + 10;
+        }
+        else {
+            return false;
+        }
+        if (bit < 64 * WORDS) {
+            words[bit / 64] |= nibble << (bit % 64);
+        }
+        else if (nibble != 0) {
+            return false; // too many features
+        }
+        bit += 4;
+    }
+    setWords(words);
+    return true;
+}
+
+std::string FeatureSet::toNames(const std::string& separator) const
+{
+    std::string res;
+    for (size_t i = 0; i < size_t(ArmFeature::Count); i++) {
+        if (has(ArmFeature(i))) {
+            if (!res.empty()) {
+                res += separator;
+            }
+            res += AllFeatures[i].name;
+        }
+    }
+    return res;
+}
+
+bool FeatureSet::fromNames(const std::string& names, const std::string& separators)
+{
+    clear();
+    bool ok = true;
+    size_t start = 0;
+    while (start < names.length()) {
+        const size_t end = std::min(names.find_first_of(separators, start), names.length());
+        if (end > start) {
+            ArmFeature f;
+            if (fromName(std::string_view(names).substr(start, end - start), f)) {
+                set(f);
+            }
+            else {
+                ok = false;
+            }
+        }
+        start = end + 1;
+    }
+    return ok;
+}
+
+std::string_view FeatureSet::name(ArmFeature f)
+{
+    return size_t(f) < size_t(ArmFeature::Count) ? AllFeatures[size_t(f)].name : std::string_view();
+}
+
+bool FeatureSet::fromName(std::string_view name, ArmFeature& f)
+{
+    // The table is sorted, case insensitive: binary search.
+    size_t low = 0;
+    size_t high = size_t(ArmFeature::Count);
+    while (low < high) {
+        const size_t mid = (low + high) / 2;
+        const int cmp = CompareNames(AllFeatures[mid].name, name);
+        if (cmp == 0) {
+            f = ArmFeature(mid);
+            return true;
+        }
+        else if (cmp < 0) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return false;
 }
 
 
@@ -123,57 +597,125 @@ int ArmFeatures::pacQARMA() const
 
 bool ArmFeatures::load(RegAccess& reg)
 {
-    clear();
-    _loaded =
-        reg.read(CSR_REGID_ID_AA64ISAR0_EL1, _aa64isar0) &&
-        reg.read(CSR_REGID_ID_AA64ISAR1_EL1, _aa64isar1) &&
-        reg.read(CSR_REGID_ID_AA64ISAR2_EL1, _aa64isar2) &&
-        reg.read(CSR_REGID_ID_AA64PFR0_EL1, _aa64pfr0) &&
-        reg.read(CSR_REGID_ID_AA64PFR1_EL1, _aa64pfr1) &&
-        reg.read(CSR_REGID_ID_AA64PFR2_EL1, _aa64pfr2) &&
-        reg.read(CSR_REGID_ID_AA64DFR0_EL1, _aa64dfr0) &&
-        reg.read(CSR_REGID_ID_AA64DFR1_EL1, _aa64dfr1) &&
-        reg.read(CSR_REGID_ID_AA64MMFR0_EL1, _aa64mmfr0) &&
-        reg.read(CSR_REGID_ID_AA64MMFR1_EL1, _aa64mmfr1) &&
-        reg.read(CSR_REGID_ID_AA64MMFR2_EL1, _aa64mmfr2) &&
-        reg.read(CSR_REGID_ID_AA64MMFR3_EL1, _aa64mmfr3) &&
-        reg.read(CSR_REGID_ID_AA64MMFR4_EL1, _aa64mmfr4) &&
-        reg.read(CSR_REGID_ID_ISAR0_EL1, _isar0) &&
-        reg.read(CSR_REGID_ID_ISAR1_EL1, _isar1) &&
-        reg.read(CSR_REGID_ID_ISAR2_EL1, _isar2) &&
-        reg.read(CSR_REGID_ID_ISAR3_EL1, _isar3) &&
-        reg.read(CSR_REGID_ID_ISAR4_EL1, _isar4) &&
-        reg.read(CSR_REGID_ID_ISAR5_EL1, _isar5) &&
-        reg.read(CSR_REGID_ID_ISAR6_EL1, _isar6) &&
-        reg.read(CSR_REGID_ID_MMFR0_EL1, _mmfr0) &&
-        reg.read(CSR_REGID_ID_MMFR1_EL1, _mmfr1) &&
-        reg.read(CSR_REGID_ID_MMFR2_EL1, _mmfr2) &&
-        reg.read(CSR_REGID_ID_MMFR3_EL1, _mmfr3) &&
-        reg.read(CSR_REGID_ID_MMFR4_EL1, _mmfr4) &&
-        reg.read(CSR_REGID_ID_MMFR5_EL1, _mmfr5) &&
-        reg.read(CSR_REGID_ID_PFR0_EL1, _pfr0) &&
-        reg.read(CSR_REGID_ID_PFR1_EL1, _pfr1) &&
-        reg.read(CSR_REGID_ID_PFR2_EL1, _pfr2) &&
-        (!csr_has_sme(_aa64pfr1) || reg.read(CSR_REGID_ID_AA64SMFR0_EL1, _aa64smfr0)) &&
-        (!csr_has_sve(_aa64pfr0) || reg.read(CSR_REGID_ID_AA64ZFR0_EL1, _aa64zfr0)) &&
-        reg.read(CSR_REGID_TCR_EL1, _tcr) &&
-        (!csr_has_tcr2(_aa64mmfr3) || reg.read(CSR_REGID_TCR2_EL1, _tcr2)) &&
-        (!csr_has_ete(_aa64dfr0) || reg.read(CSR_REGID_TRCDEVARCH, _trcdevarch)) &&
-        (!csr_has_pmuv3p4(_aa64dfr0) || reg.read(CSR_REGID_PMMIR_EL1, _pmmir));
+    return load(reg, nullptr);
+}
+
+bool ArmFeatures::loadFastest(RegAccess& reg, const RegSource& source)
+{
+    return load(reg, &source);
+}
 
+bool ArmFeatures::load(RegAccess& reg, const RegSource* source)
+{
+    // List of registers to load, all of them in one single call to the kernel module.
+    // Registers which depend on a missing CPU feature are returned with status 2 and left to zero.
+    static const struct {
+        int regid;
+        csr_u64_t ArmFeatures::* field;
+    } registers[] = {
+        {CSR_REGID_ID_AA64ISAR0_EL1, &ArmFeatures::_aa64isar0},
+        {CSR_REGID_ID_AA64ISAR1_EL1, &ArmFeatures::_aa64isar1},
+        {CSR_REGID_ID_AA64ISAR2_EL1, &ArmFeatures::_aa64isar2},
+        {CSR_REGID_ID_AA64PFR0_EL1,  &ArmFeatures::_aa64pfr0},
+        {CSR_REGID_ID_AA64PFR1_EL1,  &ArmFeatures::_aa64pfr1},
+        {CSR_REGID_ID_AA64PFR2_EL1,  &ArmFeatures::_aa64pfr2},
+        {CSR_REGID_ID_AA64DFR0_EL1,  &ArmFeatures::_aa64dfr0},
+        {CSR_REGID_ID_AA64DFR1_EL1,  &ArmFeatures::_aa64dfr1},
+        {CSR_REGID_ID_AA64MMFR0_EL1, &ArmFeatures::_aa64mmfr0},
+        {CSR_REGID_ID_AA64MMFR1_EL1, &ArmFeatures::_aa64mmfr1},
+        {CSR_REGID_ID_AA64MMFR2_EL1, &ArmFeatures::_aa64mmfr2},
+        {CSR_REGID_ID_AA64MMFR3_EL1, &ArmFeatures::_aa64mmfr3},
+        {CSR_REGID_ID_AA64MMFR4_EL1, &ArmFeatures::_aa64mmfr4},
+        {CSR_REGID_ID_ISAR0_EL1,     &ArmFeatures::_isar0},
+        {CSR_REGID_ID_ISAR1_EL1,     &ArmFeatures::_isar1},
+        {CSR_REGID_ID_ISAR2_EL1,     &ArmFeatures::_isar2},
+        {CSR_REGID_ID_ISAR3_EL1,     &ArmFeatures::_isar3},
+        {CSR_REGID_ID_ISAR4_EL1,     &ArmFeatures::_isar4},
+        {CSR_REGID_ID_ISAR5_EL1,     &ArmFeatures::_isar5},
+        {CSR_REGID_ID_ISAR6_EL1,     &ArmFeatures::_isar6},
+        {CSR_REGID_ID_MMFR0_EL1,     &ArmFeatures::_mmfr0},
+        {CSR_REGID_ID_MMFR1_EL1,     &ArmFeatures::_mmfr1},
+        {CSR_REGID_ID_MMFR2_EL1,     &ArmFeatures::_mmfr2},
+        {CSR_REGID_ID_MMFR3_EL1,     &ArmFeatures::_mmfr3},
+        {CSR_REGID_ID_MMFR4_EL1,     &ArmFeatures::_mmfr4},
+        {CSR_REGID_ID_MMFR5_EL1,     &ArmFeatures::_mmfr5},
+        {CSR_REGID_ID_PFR0_EL1,      &ArmFeatures::_pfr0},
+        {CSR_REGID_ID_PFR1_EL1,      &ArmFeatures::_pfr1},
+        {CSR_REGID_ID_PFR2_EL1,      &ArmFeatures::_pfr2},
+        {CSR_REGID_ID_AA64SMFR0_EL1, &ArmFeatures::_aa64smfr0},
+        {CSR_REGID_ID_AA64ZFR0_EL1,  &ArmFeatures::_aa64zfr0},
+        {CSR_REGID_TCR_EL1,          &ArmFeatures::_tcr},
+        {CSR_REGID_TCR2_EL1,         &ArmFeatures::_tcr2},
+        {CSR_REGID_TRCDEVARCH,       &ArmFeatures::_trcdevarch},
+        {CSR_REGID_PMMIR_EL1,        &ArmFeatures::_pmmir},
 #if !defined(CSR_AVOID_CTR_EL0)
-    _loaded = _loaded &&
-        reg.read(CSR_REGID_CTR_EL0, _ctr);
+        {CSR_REGID_CTR_EL0,          &ArmFeatures::_ctr},
 #endif
-
 #if !defined(CSR_AVOID_PMSIDR_EL1)
-    _loaded = _loaded &&
-        (!csr_has_spe(_aa64dfr0) || reg.read(CSR_REGID_PMSIDR_EL1, _pmsidr));
+        {CSR_REGID_PMSIDR_EL1,       &ArmFeatures::_pmsidr},
 #endif
+    };
 
+    clear();
+    _loaded = true;
+
+    // Get immutable registers from the snapshot, without system call. Read the others from the kernel module,
+    // including the writable TCR_EL1 and TCR2_EL1 which are never in the snapshot.
+    // With a source, some registers are faster to read at EL0.
+    const csr_snapshot_t* snap = RegAccess::snapshot();
+    std::vector<csr_multi_reg_t> regs;
+    std::vector<csr_u64_t ArmFeatures::*> fields;
+    for (const auto& r : registers) {
+        if (source != nullptr && source->path(r.regid) == RegSource::DIRECT && RegSource::readDirect(r.regid, this->*r.field)) {
+            continue;
+        }
+        const csr_multi_reg_t* found = snap == nullptr ? nullptr : csr_snapshot_find(snap, r.regid);
+        if (found != nullptr) {
+            setField(r.field, *found);
+        }
+        else {
+            regs.push_back(csr_multi_reg_t{csr_u64_t(r.regid), 0, {0, 0}});
+            fields.push_back(r.field);
+        }
+    }
+    if (!regs.empty() && !reg.readMany(regs)) {
+        return _loaded = false;
+    }
+    for (size_t i = 0; i < regs.size(); i++) {
+        setField(fields[i], regs[i]);
+    }
+    computeFeatures();
     return _loaded;
 }
 
+// Re-read the writable control registers from the kernel module.
+bool ArmFeatures::loadControl(RegAccess& reg)
+{
+    std::vector<csr_multi_reg_t> regs {
+        {CSR_REGID_TCR_EL1, 0, {0, 0}},
+        {CSR_REGID_TCR2_EL1, 0, {0, 0}},
+    };
+    if (!reg.readMany(regs)) {
+        return false;
+    }
+    // TCR2_EL1 has status 2 without FEAT_TCR2.
+    _tcr = regs[0].status == 0 ? regs[0].value.low : 0;
+    _tcr2 = regs[1].status == 0 ? regs[1].value.low : 0;
+    return regs[0].status == 0;
+}
+
+// Set a register field from a multi-register result.
+void ArmFeatures::setField(csr_u64_t ArmFeatures::* field, const csr_multi_reg_t& reg)
+{
+    if (reg.status == 0) {
+        this->*field = reg.value.low;
+    }
+    else if (reg.status != 2) {
+        // Unknown register, the kernel module is probably outdated.
+        _loaded = false;
+    }
+}
+
 //----------------------------------------------------------------------------
 // Load features using direct access to system registers in userland.
 // Works on Linux thanks to mrs emulation. Trap on other systems.
@@ -206,4 +748,202 @@ void ArmFeatures::loadDirect()
         csr_mrs(_aa64zfr0, CSR_SREG_ID_AA64ZFR0_EL1);
     }
     _loaded = true;
+    computeFeatures();
+}
+
+
+//----------------------------------------------------------------------------
+// Process-wide instance.
+//----------------------------------------------------------------------------
+
+const ArmFeatures& ArmFeatures::instance()
+{
+    // Thread-safe initialization, the first time only.
+    static const ArmFeatures features(loadInstance());
+    return features;
+}
+
+ArmFeatures ArmFeatures::loadInstance()
+{
+    ArmFeatures features;
+    const std::string file(cacheFile());
+    RegAccess& regs(RegAccess::shared());
+    if (file.empty() || !features.loadCache(file)) {
+        if (features.load(regs) && !file.empty()) {
+            // Failing to update the cache is not an error (typically not running as root).
+            features.saveCache(file);
+        }
+    }
+    else if (regs.isOpen() && !features.loadControl(regs)) {
+        // Keep the features from the cache without control registers.
+        regs.clearError();
+    }
+    return features;
+}
+
+
+//----------------------------------------------------------------------------
+// Cache file of the features.
+//----------------------------------------------------------------------------
+
+// All register fields, in the order of the cache file. The writable control registers,
+// TCR_EL1 and TCR2_EL1, are not cached: they may be modified after boot.
+csr_u64_t ArmFeatures::* const ArmFeatures::_all_fields[] = {
+    &ArmFeatures::_aa64isar0, &ArmFeatures::_aa64isar1, &ArmFeatures::_aa64isar2,
+    &ArmFeatures::_aa64pfr0,  &ArmFeatures::_aa64pfr1,  &ArmFeatures::_aa64pfr2,
+    &ArmFeatures::_aa64dfr0,  &ArmFeatures::_aa64dfr1,
+    &ArmFeatures::_aa64mmfr0, &ArmFeatures::_aa64mmfr1, &ArmFeatures::_aa64mmfr2, &ArmFeatures::_aa64mmfr3, &ArmFeatures::_aa64mmfr4,
+    &ArmFeatures::_aa64smfr0, &ArmFeatures::_aa64zfr0,
+    &ArmFeatures::_isar0, &ArmFeatures::_isar1, &ArmFeatures::_isar2, &ArmFeatures::_isar3,
+    &ArmFeatures::_isar4, &ArmFeatures::_isar5, &ArmFeatures::_isar6,
+    &ArmFeatures::_mmfr0, &ArmFeatures::_mmfr1, &ArmFeatures::_mmfr2, &ArmFeatures::_mmfr3, &ArmFeatures::_mmfr4, &ArmFeatures::_mmfr5,
+    &ArmFeatures::_pfr0, &ArmFeatures::_pfr1, &ArmFeatures::_pfr2,
+    &ArmFeatures::_ctr, &ArmFeatures::_trcdevarch, &ArmFeatures::_pmmir, &ArmFeatures::_pmsidr,
+};
+
+namespace {
+    // Header of the cache file, followed by the values of all register fields.
+    constexpr char CacheMagic[8] = "CSRFEAT";
+    constexpr uint32_t CacheVersion = 2;
+    struct CacheHeader {
+        char      magic[8];
+        uint32_t  version;
+        uint32_t  count;        // number of register fields
+        char      boot_id[64];  // identification of the current boot
+        csr_u64_t midr;         // MIDR_EL1 of the processor, zero if unknown
+    };
+}
+
+// Get the cache file name.
+std::string ArmFeatures::cacheFile()
+{
+    const char* env = ::getenv("CSR_FEATURES_CACHE");
+    if (env != nullptr) {
+        return env;
+    }
+#if defined(__linux__)
+    return "/run/cpusysregs.features";
+#elif defined(__APPLE__)
+    return "/var/run/cpusysregs.features";
+#else
+    return std::string();
+#endif
+}
+
+// Get the identification of the current boot and processor.
+bool ArmFeatures::cacheKey(std::string& boot_id, csr_u64_t& midr)
+{
+    boot_id.clear();
+    midr = 0;
+#if defined(__linux__)
+    std::ifstream boot("/proc/sys/kernel/random/boot_id");
+    std::ifstream id("/sys/devices/system/cpu/cpu0/regs/identification/midr_el1");
+    std::string midr_str;
+    if (id >> midr_str) {
+        midr = std::strtoull(midr_str.c_str(), nullptr, 16);
+    }
+    return bool(boot >> boot_id) && !boot_id.empty();
+#elif defined(__APPLE__)
+    // MIDR_EL1 is not accessible without the kernel extension, the boot session is enough.
+    char uuid[64];
+    size_t len = sizeof(uuid);
+    if (::sysctlbyname("kern.bootsessionuuid", uuid, &len, nullptr, 0) < 0 || len == 0) {
+        return false;
+    }
+    boot_id.assign(uuid, ::strnlen(uuid, len));
+    return !boot_id.empty();
+#else
+    return false;
+#endif
+}
+
+// Load the features from the cache file.
+bool ArmFeatures::loadCache(const std::string& file)
+{
+    constexpr size_t count = sizeof(_all_fields) / sizeof(_all_fields[0]);
+    std::string boot_id;
+    csr_u64_t midr = 0;
+    if (!cacheKey(boot_id, midr)) {
+        return false;
+    }
+
+    // The complete file is read at once.
+    struct {
+        CacheHeader header;
+        csr_u64_t   values[count];
+    } data;
+    std::ifstream in(file, std::ios::binary);
+    if (!in.read(reinterpret_cast<char*>(&data), sizeof(data)) || in.gcount() != std::streamsize(sizeof(data))) {
+        return false;
+    }
+    if (::memcmp(data.header.magic, CacheMagic, sizeof(CacheMagic)) != 0 ||
+        data.header.version != CacheVersion ||
+        data.header.count != count ||
+        data.header.midr != midr ||
+        ::strncmp(data.header.boot_id, boot_id.c_str(), sizeof(data.header.boot_id)) != 0)
+    {
+        return false;
+    }
+
+    clear();
+    for (size_t i = 0; i < count; i++) {
+        this->*_all_fields[i] = data.values[i];
+    }
+    _loaded = true;
+    computeFeatures();
+    return true;
+}
+
+// Save the features in the cache file.
+bool ArmFeatures::saveCache(const std::string& file) const
+{
+    constexpr size_t count = sizeof(_all_fields) / sizeof(_all_fields[0]);
+    std::string boot_id;
+    struct {
+        CacheHeader header;
+        csr_u64_t   values[count];
+    } data;
+    Zero(&data, sizeof(data));
+    if (!_loaded || !cacheKey(boot_id, data.header.midr) || boot_id.length() >= sizeof(data.header.boot_id)) {
+        return false;
+    }
+    ::memcpy(data.header.magic, CacheMagic, sizeof(CacheMagic));
+    ::memcpy(data.header.boot_id, boot_id.data(), boot_id.length());
+    data.header.version = CacheVersion;
+    data.header.count = count;
+    for (size_t i = 0; i < count; i++) {
+        data.values[i] = this->*_all_fields[i];
+    }
+
+    // Write a temporary file and rename it, so that concurrent readers never see a partial file.
+    // The cache directory may be shared: the temporary file is a new file with an unpredictable
+    // name, never an existing file or symbolic link, and is rejected if incompletely written.
+#if defined(__linux__) || defined(__APPLE__)
+    std::string temp(file + ".XXXXXX");
+    const int fd = ::mkstemp(&temp[0]);
+    if (fd < 0) {
+        return false;
+    }
+    // mkstemp() creates the file with mode 0600, the cache is readable by all users.
+    const bool written = ::fchmod(fd, 0644) == 0 && ::write(fd, &data, sizeof(data)) == ssize_t(sizeof(data));
+    if (::close(fd) != 0 || !written) {
+        ::unlink(temp.c_str());
+        return false;
+    }
+#else
+    const std::string temp(file + ".tmp");
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out.write(reinterpret_cast<const char*>(&data), sizeof(data)) || !out.flush()) {
+            out.close();
+            std::remove(temp.c_str());
+            return false;
+        }
+    }
+#endif
+    if (std::rename(temp.c_str(), file.c_str()) != 0) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
 }
@@ -10,6 +10,317 @@
 
 #pragma once
 #include "regaccess.h"
+#include "regsource.h"
+#include <array>
+#include <functional>
+#include <string>
+#include <string_view>
+
+//
+// Identifiers of all features in the class ArmFeatures, same names as the FEAT_xxx() methods.
+// The identifiers are in alphabetical order, their values change when new features are added.
+//
+enum class ArmFeature : uint16_t {
+    // Begin generated features list, use "build-features-header.py --update armfeatures.h armfeatures.cpp"
+    FEAT_AA32BF16,
+    FEAT_AA32HPD,
+    FEAT_AA32I8MM,
+    FEAT_AArch32,
+    FEAT_ABLE,
+    FEAT_ADERR,
+    FEAT_AdvSIMD,
+    FEAT_AES,
+    FEAT_AFP,
+    FEAT_AIE,
+    FEAT_AMUv1,
+    FEAT_AMUv1p1,
+    FEAT_ANERR,
+    FEAT_B16B16,
+    FEAT_BBM,
+    FEAT_BF16,
+    FEAT_BRBE,
+    FEAT_BRBEv1p1,
+    FEAT_BTI,
+    FEAT_CCIDX,
+    FEAT_CLRBHB,
+    FEAT_CMOW,
+    FEAT_CONSTPACFIELD,
+    FEAT_CRC32,
+    FEAT_CSSC,
+    FEAT_CSV2,
+    FEAT_CSV2_1p1,
+    FEAT_CSV2_1p2,
+    FEAT_CSV2_2,
+    FEAT_CSV2_3,
+    FEAT_CSV3,
+    FEAT_D128,
+    FEAT_Debugv8p1,
+    FEAT_Debugv8p2,
+    FEAT_Debugv8p4,
+    FEAT_Debugv8p8,
+    FEAT_Debugv8p9,
+    FEAT_DGH,
+    FEAT_DIT,
+    FEAT_DotProd,
+    FEAT_DoubleFault,
+    FEAT_DoubleFault2,
+    FEAT_DoubleLock,
+    FEAT_DPB,
+    FEAT_DPB2,
+    FEAT_E0PD,
+    FEAT_EBEP,
+    FEAT_EBF16,
+    FEAT_ECBHB,
+    FEAT_ECV,
+    FEAT_EPAC,
+    FEAT_ETE,
+    FEAT_ETEv1p1,
+    FEAT_ETEv1p2,
+    FEAT_ETEv1p3,
+    FEAT_ETMv4,
+    FEAT_ETMv4p1,
+    FEAT_ETMv4p2,
+    FEAT_ETMv4p3,
+    FEAT_ETMv4p4,
+    FEAT_ETMv4p5,
+    FEAT_ETMv4p6,
+    FEAT_ETS,
+    FEAT_EVT,
+    FEAT_ExS,
+    FEAT_F32MM,
+    FEAT_F64MM,
+    FEAT_FCMA,
+    FEAT_FGT,
+    FEAT_FGT2,
+    FEAT_FHM,
+    FEAT_FlagM,
+    FEAT_FlagM2,
+    FEAT_FP,
+    FEAT_FP16,
+    FEAT_FPAC,
+    FEAT_FPACCOMBINE,
+    FEAT_FRINTTS,
+    FEAT_GCS,
+    FEAT_GICv3,
+    FEAT_GICv4,
+    FEAT_GICv4p1,
+    FEAT_GTG,
+    FEAT_HAFDBS,
+    FEAT_HAFT,
+    FEAT_HBC,
+    FEAT_HCX,
+    FEAT_HPDS,
+    FEAT_HPDS2,
+    FEAT_HPMN0,
+    FEAT_I8MM,
+    FEAT_IDST,
+    FEAT_IESB,
+    FEAT_ITE,
+    FEAT_JSCVT,
+    FEAT_LOR,
+    FEAT_LPA,
+    FEAT_LPA2,
+    FEAT_LRCPC,
+    FEAT_LRCPC2,
+    FEAT_LRCPC3,
+    FEAT_LS64,
+    FEAT_LS64_ACCDATA,
+    FEAT_LS64_V,
+    FEAT_LSE,
+    FEAT_LSE128,
+    FEAT_LSE2,
+    FEAT_LSMAOC,
+    FEAT_LVA,
+    FEAT_LVA3,
+    FEAT_MEC,
+    FEAT_MOPS,
+    FEAT_MPAM,
+    FEAT_MPAMv0p1,
+    FEAT_MPAMv1p0,
+    FEAT_MPAMv1p1,
+    FEAT_MTE,
+    FEAT_MTE2,
+    FEAT_MTE3,
+    FEAT_MTE4,
+    FEAT_MTE_CANONICAL_TAGS,
+    FEAT_MTE_NO_ADDRESS_TAGS,
+    FEAT_MTE_PERM,
+    FEAT_MTE_STORE_ONLY,
+    FEAT_MTE_TAGGED_FAR,
+    FEAT_MTPMU,
+    FEAT_NMI,
+    FEAT_nTLBPA,
+    FEAT_NV,
+    FEAT_NV2,
+    FEAT_PACIMP,
+    FEAT_PACQARMA3,
+    FEAT_PACQARMA5,
+    FEAT_PAN,
+    FEAT_PAN2,
+    FEAT_PAN3,
+    FEAT_PAuth,
+    FEAT_PAuth2,
+    FEAT_PFAR,
+    FEAT_PMULL,
+    FEAT_PMUv3,
+    FEAT_PMUv3_EDGE,
+    FEAT_PMUv3_ICNTR,
+    FEAT_PMUv3_SS,
+    FEAT_PMUv3_TH,
+    FEAT_PMUv3p1,
+    FEAT_PMUv3p4,
+    FEAT_PMUv3p5,
+    FEAT_PMUv3p7,
+    FEAT_PMUv3p8,
+    FEAT_PMUv3p9,
+    FEAT_PRFMSLC,
+    FEAT_RAS,
+    FEAT_RASv1p1,
+    FEAT_RASv2,
+    FEAT_RDM,
+    FEAT_RME,
+    FEAT_RNG,
+    FEAT_RNG_TRAP,
+    FEAT_RPRES,
+    FEAT_RPRFM,
+    FEAT_S1PIE,
+    FEAT_S1POE,
+    FEAT_S2FWB,
+    FEAT_S2PIE,
+    FEAT_S2POE,
+    FEAT_SB,
+    FEAT_SCTLR2,
+    FEAT_SEBEP,
+    FEAT_SEL2,
+    FEAT_SHA1,
+    FEAT_SHA256,
+    FEAT_SHA3,
+    FEAT_SHA512,
+    FEAT_SM3,
+    FEAT_SM4,
+    FEAT_SME,
+    FEAT_SME2,
+    FEAT_SME2p1,
+    FEAT_SME_F16F16,
+    FEAT_SME_F64F64,
+    FEAT_SME_FA64,
+    FEAT_SME_I16I64,
+    FEAT_SPE,
+    FEAT_SPE_CRR,
+    FEAT_SPE_FDS,
+    FEAT_SPECRES,
+    FEAT_SPECRES2,
+    FEAT_SPEv1p1,
+    FEAT_SPEv1p2,
+    FEAT_SPEv1p3,
+    FEAT_SPEv1p4,
+    FEAT_SPMU,
+    FEAT_SSBS,
+    FEAT_SSBS2,
+    FEAT_SVE,
+    FEAT_SVE2,
+    FEAT_SVE2p1,
+    FEAT_SVE_AES,
+    FEAT_SVE_BitPerm,
+    FEAT_SVE_PMULL128,
+    FEAT_SVE_SHA3,
+    FEAT_SVE_SM4,
+    FEAT_SYSINSTR128,
+    FEAT_SYSREG128,
+    FEAT_TCR2,
+    FEAT_THE,
+    FEAT_TIDCP1,
+    FEAT_TLBIOS,
+    FEAT_TLBIRANGE,
+    FEAT_TME,
+    FEAT_TRBE,
+    FEAT_TRF,
+    FEAT_TTCNP,
+    FEAT_TTL,
+    FEAT_TTST,
+    FEAT_TWED,
+    FEAT_UAO,
+    FEAT_VHE,
+    FEAT_VMID16,
+    FEAT_VPIPT,
+    FEAT_WFxT,
+    FEAT_XNX,
+    FEAT_XS,
+    // End generated features list
+    Count
+};
+
+//
+// A set of Arm64 processor features, as a bitmap.
+// The binary representation is valid between identical versions of this code only.
+// Use the names of the features to exchange feature sets with other versions.
+//
+class FeatureSet
+{
+public:
+    // Number of 64-bit words in the bitmap.
+    static constexpr size_t WORDS = (size_t(ArmFeature::Count) + 63) / 64;
+
+    // Constructor: an empty set.
+    constexpr FeatureSet() = default;
+
+    // Check, add, remove features.
+    bool has(ArmFeature f) const { return (_bits[size_t(f) / 64] >> (size_t(f) % 64)) & 1; }
+    void set(ArmFeature f) { _bits[size_t(f) / 64] |= csr_u64_t(1) << (size_t(f) % 64); }
+    void reset(ArmFeature f) { _bits[size_t(f) / 64] &= ~(csr_u64_t(1) << (size_t(f) % 64)); }
+    void clear() { _bits.fill(0); }
+
+    // Number of features in the set.
+    size_t count() const;
+    bool empty() const { return count() == 0; }
+
+    // Check if all features in this set are also in the other one.
+    bool subsetOf(const FeatureSet& other) const;
+
+    // Set operations: intersection, union, difference, symmetric difference.
+    FeatureSet& operator&=(const FeatureSet& other);
+    FeatureSet& operator|=(const FeatureSet& other);
+    FeatureSet& operator-=(const FeatureSet& other);
+    FeatureSet& operator^=(const FeatureSet& other);
+    FeatureSet operator&(const FeatureSet& other) const { return FeatureSet(*this) &= other; }
+    FeatureSet operator|(const FeatureSet& other) const { return FeatureSet(*this) |= other; }
+    FeatureSet operator-(const FeatureSet& other) const { return FeatureSet(*this) -= other; }
+    FeatureSet operator^(const FeatureSet& other) const { return FeatureSet(*this) ^= other; }
+    bool operator==(const FeatureSet& other) const { return _bits == other._bits; }
+    bool operator!=(const FeatureSet& other) const { return _bits != other._bits; }
+
+    // Hash value of the set, for unordered containers.
+    size_t hash() const;
+
+    // Raw binary representation.
+    const std::array<csr_u64_t, WORDS>& words() const { return _bits; }
+    void setWords(const std::array<csr_u64_t, WORDS>& words);
+
+    // Hexadecimal representation of the bitmap, from high to low words.
+    std::string toHexa() const;
+    bool fromHexa(const std::string& hexa);
+
+    // List of feature names, separated by the specified separator.
+    // When decoding, unknown names are ignored and reported as an error.
+    std::string toNames(const std::string& separator = " ") const;
+    bool fromNames(const std::string& names, const std::string& separators = " ,;\t\r\n");
+
+    // Get the name of a feature or the feature from its name (case insensitive).
+    static std::string_view name(ArmFeature f);
+    static bool fromName(std::string_view name, ArmFeature& f);
+
+private:
+    std::array<csr_u64_t, WORDS> _bits {};
+};
+
+// Hash of a feature set for std::unordered_set and std::unordered_map.
+namespace std {
+    template <>
+    struct hash<FeatureSet>
+    {
+        size_t operator()(const FeatureSet& fs) const { return fs.hash(); }
+    };
+}
 
 //
 // A class describing the features of an Arm64 processor.
@@ -22,9 +333,21 @@ public:
     ArmFeatures(RegAccess&);
 
     // Load features from the system registers.
+    // Immutable registers are taken from the kernel module snapshot, when available, without system call.
     bool load(RegAccess&);
     bool isLoaded() const { return _loaded; }
 
+    // Same as load() but read each register using the fastest correct path, as selected by a
+    // RegSource probe: EL0 MRS emulation or kernel module. The registers are the same as with load().
+    // The process-wide RegSource instance is probed on first use, with the same RegAccess.
+    // Probing is more expensive than one load(), use it in processes which load the features often.
+    bool loadFastest(RegAccess& reg) { return loadFastest(reg, RegSource::instance(reg)); }
+    bool loadFastest(RegAccess&, const RegSource&);
+
+    // Re-read the writable control registers, TCR_EL1 and TCR2_EL1, from the kernel module,
+    // never from the snapshot or the cache file. The features are not recomputed.
+    bool loadControl(RegAccess&);
+
     // Clear contents of all loaded registers.
     void clear();
 
@@ -33,6 +356,25 @@ public:
     // macOS: Illegal instruction exception.
     void loadDirect();
 
+    // Get the set of all supported features, computed once when the features are loaded.
+    const FeatureSet& features() const { return _features; }
+    bool has(ArmFeature f) const { return _features.has(f); }
+
+    // Get a process-wide instance, loaded only once, thread-safe.
+    // The features are loaded from the cache file when it is valid, only the control registers
+    // are then read from the kernel module. Otherwise, they are loaded from the kernel module
+    // and the cache file is updated, when possible.
+    static const ArmFeatures& instance();
+
+    // Load or save the features in a cache file. A cache file is valid during one boot of
+    // the system only, on the same processor. The cache file name can be overridden with
+    // the environment variable CSR_FEATURES_CACHE. When defined empty, there is no cache.
+    // The writable control registers are not in the cache file, see loadControl().
+    // The file is written in a new temporary file in the same directory, then renamed.
+    bool loadCache(const std::string& file);
+    bool saveCache(const std::string& file) const;
+    static std::string cacheFile();
+
     // Individual fields in the system registers.
 
     int ID_AA64ISAR0_EL1_RNDR() const { return (int)(_aa64isar0 >> 60) & 0x0F; }
@@ -728,4 +1070,23 @@ private:
     csr_u64_t _trcdevarch;
     csr_u64_t _pmmir;
     csr_u64_t _pmsidr;
+    FeatureSet _features;
+
+    // All register fields, in the order of the cache file.
+    static csr_u64_t ArmFeatures::* const _all_fields[];
+
+    // Common code of load() and loadFastest(), without source, all registers use the kernel path.
+    bool load(RegAccess&, const RegSource*);
+
+    // Set a register field from a multi-register result.
+    void setField(csr_u64_t ArmFeatures::* field, const csr_multi_reg_t& reg);
+
+    // Compute the feature set from the register fields.
+    void computeFeatures();
+
+    // Load the process-wide instance.
+    static ArmFeatures loadInstance();
+
+    // Get the identification of the current boot and processor, for the cache file.
+    static bool cacheKey(std::string& boot_id, csr_u64_t& midr);
 };
@@ -12,14 +12,54 @@
 #include "armpseudocode.h"
 #include "qarma64.h"
 #include "strutils.h"
+#include <algorithm>
+#include <vector>
 #include <cstring>
 #include <cassert>
 
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define CSR_USE_NEON 1
+#endif
+
 // Constructor.
 ArmPseudoCode::ArmPseudoCode(RegAccess& regs) :
     _regs(regs),
-    _feat(regs)
+    _feat(regs),
+    _walkparams(),
+    _walkparams_valid(),
+    _geometry()
+{
+}
+
+ArmPseudoCode::ArmPseudoCode(RegAccess& regs, const ArmFeatures& features) :
+    _regs(regs),
+    _feat(features),
+    _walkparams(),
+    _walkparams_valid(),
+    _geometry()
+{
+}
+
+// Invalidate cached values.
+void ArmPseudoCode::invalidate()
 {
+    // The ID registers are immutable, only the control registers are read again, live.
+    _feat.loadControl(_regs);
+    _walkparams_valid[VARange_LOWER] = _walkparams_valid[VARange_UPPER] = false;
+    for (auto& geo : _geometry) {
+        geo.valid = false;
+    }
+}
+
+// Get the cached walk parameters, build them the first time.
+const ArmPseudoCode::S1TTWParams& ArmPseudoCode::walkParams(VARange varange)
+{
+    if (!_walkparams_valid[varange]) {
+        AArch64_S1TTWParamsEL10(_walkparams[varange], varange);
+        _walkparams_valid[varange] = true;
+    }
+    return _walkparams[varange];
 }
 
 // TGxGranuleBits()
@@ -74,7 +114,7 @@ ArmPseudoCode::VARange ArmPseudoCode::AArch64_GetVARange(csr_u64_t va)
 // Returns stage 1 translation table walk parameters from respective controlling System registers.
 void ArmPseudoCode::AArch64_GetS1TTWParams(S1TTWParams& walkparams, csr_u64_t  va)
 {
-    AArch64_S1TTWParamsEL10(walkparams, AArch64_GetVARange(va));
+    walkparams = walkParams(AArch64_GetVARange(va));
 }
 
 // AArch64.S1TTWParamsEL10()
@@ -300,20 +340,27 @@ csr_u64_t ArmPseudoCode::ComputePACQARMA(csr_u64_t data, csr_u64_t modifier, csr
 // inserts that into pointer authentication code field of that 64-bit quantity.
 csr_u64_t ArmPseudoCode::AddPAC(csr_u64_t ptr, csr_u64_t modifier, const csr_pair_t& K, bool data)
 {
-    const bool isgeneric = false;
+    csr_u64_t ext_ptr = 0;
+    if (!PACExtendPointer(ptr, data, ext_ptr)) {
+        return ptr;
+    }
+    return PACInsert(ptr, ComputePAC(ext_ptr, modifier, K.high, K.low, false), data);
+}
+
+// First part of AddPAC(): the pointer with good extension bits, for the PAC computation.
+bool ArmPseudoCode::PACExtendPointer(csr_u64_t ptr, bool data, csr_u64_t& ext_ptr)
+{
     const bool tbi = EffectiveTBI(ptr, !data);
     const bool mtx = EffectiveMTX(ptr, !data);
     const csr_u64_t selbit = (ptr & (1ull << pacSelBit(ptr, !data))) ? 1 : 0;
     const csr_u64_t extfield = selbit ? ~0ull : 0ull;
-    const int top_bit = pacTopBit(ptr, !data);
     const int bottom_PAC_bit = pacBottomBit(ptr, !data);
 
     if (tbi && bottom_PAC_bit >= 55) {
-        return ptr;
+        return false;
     }
 
     // Compute the pointer authentication code for a ptr with good extension bits.
-    csr_u64_t ext_ptr = 0;
     if (tbi) {
         ext_ptr = (ptr & Bits(63, 56)) |
                   (extfield & Bits(55, bottom_PAC_bit)) |
@@ -329,8 +376,17 @@ csr_u64_t ArmPseudoCode::AddPAC(csr_u64_t ptr, csr_u64_t modifier, const csr_pai
         ext_ptr = (extfield & Bits(63, bottom_PAC_bit)) |
                   (ptr & Bits(bottom_PAC_bit - 1, 0));
     }
+    return true;
+}
 
-    csr_u64_t PAC = ComputePAC(ext_ptr, modifier, K.high, K.low, isgeneric);
+// Second part of AddPAC(): insert the computed PAC in the pointer.
+csr_u64_t ArmPseudoCode::PACInsert(csr_u64_t ptr, csr_u64_t PAC, bool data)
+{
+    const bool tbi = EffectiveTBI(ptr, !data);
+    const bool mtx = EffectiveMTX(ptr, !data);
+    const csr_u64_t selbit = (ptr & (1ull << pacSelBit(ptr, !data))) ? 1 : 0;
+    const int top_bit = pacTopBit(ptr, !data);
+    const int bottom_PAC_bit = pacBottomBit(ptr, !data);
 
     // Check if the ptr has good extension bits and corrupt the pointer authentication code if not
     csr_u64_t unusedbits_mask = Bits(54, bottom_PAC_bit);
@@ -392,6 +448,83 @@ csr_u64_t ArmPseudoCode::AddPAC(csr_u64_t ptr, csr_u64_t modifier, const csr_pai
     return result;
 }
 
+// Bulk AddPAC(), the PAC computation is done in one batch when the algorithm is QARMA.
+void ArmPseudoCode::addPAC(csr_u64_t* output, Span<csr_u64_t> ptrs, Span<csr_u64_t> modifiers, const csr_pair_t& K, bool data)
+{
+    const size_t count = std::min(ptrs.size(), modifiers.size());
+    std::vector<Qarma64::text_t> ext(count);
+    std::vector<Qarma64::tweak_t> mod(count);
+    std::vector<Qarma64::text_t> pac(count);
+    std::vector<bool> has_pac(count);
+
+    for (size_t i = 0; i < count; i++) {
+        csr_u64_t ext_ptr = 0;
+        has_pac[i] = PACExtendPointer(ptrs[i], data, ext_ptr);
+        ext[i] = ext_ptr;
+        mod[i] = modifiers[i];
+    }
+
+    // Same selection of the algorithm as ComputePAC().
+    const int rounds = UsePACIMP(false) ? 0 : (UsePACQARMA3(false) ? 3 : (UsePACQARMA5(false) ? 5 : 0));
+    if (rounds > 0) {
+        Qarma64 qarma(rounds);
+        qarma.encryptBatch(pac.data(), ext, mod, qarma.makeKey(K.high, K.low));
+    }
+    else {
+        for (size_t i = 0; i < count; i++) {
+            pac[i] = ComputePAC(ext[i], mod[i], K.high, K.low, false);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        output[i] = has_pac[i] ? PACInsert(ptrs[i], pac[i], data) : ptrs[i];
+    }
+}
+
+// Strip()
+// =======
+// Bulk version: the pointers are classified by bit 55, with precomputed masks for each class.
+void ArmPseudoCode::stripPAC(csr_u64_t* output, Span<csr_u64_t> ptrs, bool is_instr)
+{
+    // Mask of the PAC field, for lower and upper addresses.
+    csr_u64_t field[2];
+    for (int upper = 0; upper < 2; upper++) {
+        const csr_u64_t address = upper ? ~0ull : 0ull;
+        const int bottom_PAC_bit = 64 - AArch64_PACEffectiveTxSZ(walkParams(upper ? VARange_UPPER : VARange_LOWER));
+        if (EffectiveTBI(address, is_instr)) {
+            field[upper] = Bits(55, bottom_PAC_bit);
+        }
+        else if (EffectiveMTX(address, is_instr)) {
+            field[upper] = Bits(63, 60) | Bits(55, bottom_PAC_bit);
+        }
+        else {
+            field[upper] = Bits(63, bottom_PAC_bit);
+        }
+    }
+
+    const size_t count = ptrs.size();
+    size_t i = 0;
+#if defined(CSR_USE_NEON)
+    // Two pointers per vector, bit 55 is propagated to select the masks.
+    // On Linux, csr_u64_t is unsigned long long and uint64_t is unsigned long.
+    const uint64_t* vin = reinterpret_cast<const uint64_t*>(ptrs.data());
+    uint64_t* vout = reinterpret_cast<uint64_t*>(output);
+    const uint64x2_t keep_lower = vdupq_n_u64(~field[0]);
+    const uint64x2_t keep_upper = vdupq_n_u64(~field[1]);
+    const uint64x2_t set_upper = vdupq_n_u64(field[1]);
+    for (; i + 2 <= count; i += 2) {
+        const uint64x2_t ptr = vld1q_u64(vin + i);
+        const uint64x2_t upper = vreinterpretq_u64_s64(vshrq_n_s64(vreinterpretq_s64_u64(vshlq_n_u64(ptr, 8)), 63));
+        const uint64x2_t keep = vbslq_u64(upper, keep_upper, keep_lower);
+        vst1q_u64(vout + i, vorrq_u64(vandq_u64(ptr, keep), vandq_u64(upper, set_upper)));
+    }
+#endif
+    for (; i < count; i++) {
+        const int upper = (ptrs[i] >> 55) & 1;
+        output[i] = (ptrs[i] & ~field[upper]) | (upper ? field[upper] : 0);
+    }
+}
+
 // AddPACGA()
 // ==========
 // Returns a 64-bit value where the lower 32 bits are 0, and the upper 32 bits contain
@@ -412,7 +545,7 @@ csr_u64_t ArmPseudoCode::AddPACGA(csr_u64_t x, csr_u64_t y, const csr_pair_t& ke
 // See AddPAC() pseudo code in Arm manual for details.
 int ArmPseudoCode::pacTopBit(csr_u64_t address, bool is_instr)
 {
-    return EffectiveTBI(address, is_instr) ? 55 : 63;
+    return pacGeometry(address, is_instr).top_bit;
 }
 
 int ArmPseudoCode::pacSelBit(csr_u64_t address, bool is_instr)
@@ -447,25 +580,34 @@ int ArmPseudoCode::pacSelBit(csr_u64_t address, bool is_instr)
 
 int ArmPseudoCode::pacBottomBit(csr_u64_t address, bool is_instr)
 {
-    S1TTWParams walkparams;
-    const int top_bit_pos = pacTopBit(address, is_instr);
-    const int top_bit = (address >> top_bit_pos) & 1;
-    AArch64_GetS1TTWParams(walkparams, top_bit ? ~0ull : 0);
-    return 64 - AArch64_PACEffectiveTxSZ(walkparams);
+    return pacGeometry(address, is_instr).bottom_bit;
 }
 
 // Size in bits for PAC.
 int ArmPseudoCode::pacSize(csr_u64_t address, bool is_instr)
 {
-    const int top = pacTopBit(address, is_instr);
-    const int bottom = pacBottomBit(address, is_instr);
-    return std::max(0, top - bottom + (bottom <= 55 && 55 <= top ? 0 : 1));
+    return pacGeometry(address, is_instr).size;
 }
 
 // Mask for PAC.
 csr_u64_t ArmPseudoCode::pacMask(csr_u64_t address, bool is_instr)
 {
-    const int top = pacTopBit(address, is_instr);
-    const int bottom = pacBottomBit(address, is_instr);
-    return Bits(top, bottom) & ~(1ull << 55);
+    return pacGeometry(address, is_instr).mask;
+}
+
+// Get the cached geometry of the PAC field, compute it the first time.
+const ArmPseudoCode::PacGeometry& ArmPseudoCode::pacGeometry(csr_u64_t address, bool is_instr)
+{
+    PacGeometry& geo(_geometry[(is_instr ? 4 : 0) | ((address >> 54) & 2) | ((address >> 63) & 1)]);
+    if (!geo.valid) {
+        const int top = EffectiveTBI(address, is_instr) ? 55 : 63;
+        const int top_bit = (address >> top) & 1;
+        const int bottom = 64 - AArch64_PACEffectiveTxSZ(walkParams(top_bit ? VARange_UPPER : VARange_LOWER));
+        geo.top_bit = top;
+        geo.bottom_bit = bottom;
+        geo.size = std::max(0, top - bottom + (bottom <= 55 && 55 <= top ? 0 : 1));
+        geo.mask = Bits(top, bottom) & ~(1ull << 55);
+        geo.valid = true;
+    }
+    return geo;
 }
@@ -12,6 +12,7 @@
 #pragma once
 #include "regaccess.h"
 #include "armfeatures.h"
+#include "span.h"
 
 //
 // A class implementing some pseudo-code functions from the Arm Architecture Reference Manual.
@@ -22,8 +23,16 @@
 class ArmPseudoCode
 {
 public:
-    // Constructor.
+    // Constructor. The CPU features are loaded from the registers or copied from an
+    // already loaded instance, typically ArmFeatures::instance().
     ArmPseudoCode(RegAccess&);
+    ArmPseudoCode(RegAccess&, const ArmFeatures&);
+
+    // The translation parameters and the PAC field geometry are computed on first use and
+    // cached. Invalidate them after rewriting TCR_EL1, TCR2_EL1, SCTLR_EL1, MAIR_EL1, PIR_EL1:
+    // TCR_EL1 and TCR2_EL1 are read again from the kernel module, never from the snapshot or
+    // the cache file, and the cached values are recomputed on next use.
+    void invalidate();
 
     // Forbid copy (keep only one instance per RegAccess reference).
     ArmPseudoCode(ArmPseudoCode&&) = delete;
@@ -120,6 +129,7 @@ public:
     // AArch64.GetS1TTWParams()
     // ========================
     // Returns stage 1 translation table walk parameters from respective controlling System registers.
+    // The returned parameters are cached, see invalidate().
     void AArch64_GetS1TTWParams(S1TTWParams& walkparams, csr_u64_t va);
 
     // AArch64.S1TTWParamsEL10()
@@ -195,6 +205,17 @@ public:
     csr_u64_t AddPACGA(csr_u64_t x, csr_u64_t y);
     csr_u64_t AddPACGA(csr_u64_t x, csr_u64_t y, const csr_pair_t& key);
 
+    // Strip()
+    // =======
+    // Bulk version of Strip(), as XPACI or XPACD: the PAC field of each pointer is replaced
+    // with the extension of bit 55. The output array can be the same as the input one.
+    void stripPAC(csr_u64_t* output, Span<csr_u64_t> ptrs, bool is_instr);
+
+    // Bulk version of AddPAC() with one modifier per pointer, under the same key.
+    // The number of processed pointers is the smallest size of ptrs and modifiers.
+    // The output array can be the same as the input one.
+    void addPAC(csr_u64_t* output, Span<csr_u64_t> ptrs, Span<csr_u64_t> modifiers, const csr_pair_t& K, bool data);
+
     // Some intermediate functions, used to implement AddPAC(), also useful outside.
     // See AddPAC() pseudo code in Arm manual for details.
     int pacTopBit(csr_u64_t address, bool is_instr);
@@ -208,4 +229,26 @@ public:
 private:
     RegAccess&  _regs;
     ArmFeatures _feat;
+
+    // Cached stage 1 walk parameters, indexed by VARange.
+    S1TTWParams _walkparams[2];
+    bool        _walkparams_valid[2];
+    const S1TTWParams& walkParams(VARange varange);
+
+    // Cached geometry of the PAC field. It depends on the type of address (instruction or data)
+    // and on the address bits 55 and 63 only. Index: is_instr << 2 | bit 55 << 1 | bit 63.
+    struct PacGeometry {
+        bool      valid;
+        int       top_bit;
+        int       bottom_bit;
+        int       size;
+        csr_u64_t mask;
+    };
+    PacGeometry _geometry[8];
+    const PacGeometry& pacGeometry(csr_u64_t address, bool is_instr);
+
+    // The two parts of AddPAC(), before and after the computation of the PAC.
+    // PACExtendPointer() returns false when there is no PAC field, the pointer is then unchanged.
+    bool PACExtendPointer(csr_u64_t ptr, bool data, csr_u64_t& ext_ptr);
+    csr_u64_t PACInsert(csr_u64_t ptr, csr_u64_t PAC, bool data);
 };
@@ -0,0 +1,585 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Contention scaling of the atomic instructions: exclusive load and store
+// loops (LDXR/STXR) vs. FEAT_LSE (LDADD, SWP, CAS) and FEAT_LSE2 unaligned
+// atomics, on counters, spinlocks, MCS locks and a bounded MPMC queue.
+//
+// For each workload, each implementation of the atomic operations and each
+// number of threads (1, 2, 4, ... up to the maximum), all threads are bound
+// to distinct CPU cores, start at the same time and run for a fixed duration.
+// The fairness is the Jain index of the number of operations per thread,
+// from 1/threads (one thread did all operations) to 1 (all threads equal).
+//
+// The results are displayed in CSV format:
+// workload,variant,threads,ops_per_s,ns_per_op,fairness,min_ops,max_ops
+//
+//----------------------------------------------------------------------------
+
+#include "cputopology.h"
+#include "userfeatures.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    size_t      max_threads;
+    size_t      duration_ms;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -d ms : duration of each run in milliseconds (default: 200)" << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -t count : maximum number of threads (default: number of CPU cores)" << std::endl
+              << std::endl
+              << "The number of threads is 1, 2, 4, ... up to the maximum. The exit status is" << std::endl
+              << "non-zero when a workload returned inconsistent results." << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    max_threads(std::max(1u, std::thread::hardware_concurrency())),
+    duration_ms(200)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-d" && i+1 < argc) {
+            duration_ms = std::max<size_t>(1, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else if (arg == "-t" && i+1 < argc) {
+            max_threads = std::max<size_t>(1, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else {
+            fatal("invalid option '" + arg + "', try --help");
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Implementations of the atomic operations on a 64-bit word.
+// fetchAdd() is relaxed, exchange() and cas() are acquire-release.
+// cas() returns the previous value, the store was done if it is 'expected'.
+//----------------------------------------------------------------------------
+
+using Word = std::atomic<uint64_t>;
+
+// C++ library, as compiled (LSE, LL/SC or outline atomics, depending on the compiler options).
+struct StdAtomics
+{
+    static constexpr const char* name = "std";
+    static bool supported() { return true; }
+
+    static uint64_t fetchAdd(Word& w, uint64_t value)
+    {
+        return w.fetch_add(value, std::memory_order_relaxed);
+    }
+    static uint64_t exchange(Word& w, uint64_t value)
+    {
+        return w.exchange(value, std::memory_order_acq_rel);
+    }
+    static uint64_t cas(Word& w, uint64_t expected, uint64_t desired)
+    {
+        w.compare_exchange_strong(expected, desired, std::memory_order_acq_rel, std::memory_order_acquire);
+        return expected;
+    }
+};
+
+#if defined(__aarch64__)
+
+// Exclusive load and store loops, Armv8.0.
+struct LlscAtomics
+{
+    static constexpr const char* name = "llsc";
+    static bool supported() { return true; }
+
+    static uint64_t fetchAdd(Word& w, uint64_t value)
+    {
+        uint64_t old, tmp;
+        uint32_t fail;
+        asm volatile("1: ldxr  %0, [%3]\n"
+                     "   add   %1, %0, %4\n"
+                     "   stxr  %w2, %1, [%3]\n"
+                     "   cbnz  %w2, 1b\n"
+                     : "=&r" (old), "=&r" (tmp), "=&r" (fail) : "r" (&w), "r" (value) : "memory");
+        return old;
+    }
+    static uint64_t exchange(Word& w, uint64_t value)
+    {
+        uint64_t old;
+        uint32_t fail;
+        asm volatile("1: ldaxr %0, [%2]\n"
+                     "   stlxr %w1, %3, [%2]\n"
+                     "   cbnz  %w1, 1b\n"
+                     : "=&r" (old), "=&r" (fail) : "r" (&w), "r" (value) : "memory");
+        return old;
+    }
+    static uint64_t cas(Word& w, uint64_t expected, uint64_t desired)
+    {
+        uint64_t old;
+        uint32_t fail;
+        asm volatile("1: ldaxr %0, [%2]\n"
+                     "   cmp   %0, %3\n"
+                     "   b.ne  2f\n"
+                     "   stlxr %w1, %4, [%2]\n"
+                     "   cbnz  %w1, 1b\n"
+                     "   b     3f\n"
+                     "2: clrex\n"
+                     "3:\n"
+                     : "=&r" (old), "=&r" (fail) : "r" (&w), "r" (expected), "r" (desired) : "cc", "memory");
+        return old;
+    }
+};
+
+// Large System Extensions, Armv8.1. The instructions are encoded in hexadecimal
+// with fixed registers because older assemblers do not know them without -march.
+struct LseAtomics
+{
+    static constexpr const char* name = "lse";
+    static bool supported() { return UserFeatures::instance().FEAT_LSE(); }
+
+    static uint64_t fetchAdd(Word& w, uint64_t value)
+    {
+        register uint64_t x0 asm("x0") = value;
+        register Word* x1 asm("x1") = &w;
+        register uint64_t x2 asm("x2");
+        asm volatile(".inst 0xf8200022\n"   // ldadd x0, x2, [x1]
+                     : "=r" (x2) : "r" (x0), "r" (x1) : "memory");
+        return x2;
+    }
+    static uint64_t exchange(Word& w, uint64_t value)
+    {
+        register uint64_t x0 asm("x0") = value;
+        register Word* x1 asm("x1") = &w;
+        register uint64_t x2 asm("x2");
+        asm volatile(".inst 0xf8e08022\n"   // swpal x0, x2, [x1]
+                     : "=r" (x2) : "r" (x0), "r" (x1) : "memory");
+        return x2;
+    }
+    static uint64_t cas(Word& w, uint64_t expected, uint64_t desired)
+    {
+        register uint64_t x0 asm("x0") = expected;
+        register Word* x1 asm("x1") = &w;
+        register uint64_t x2 asm("x2") = desired;
+        asm volatile(".inst 0xc8e0fc22\n"   // casal x0, x2, [x1]
+                     : "+r" (x0) : "r" (x1), "r" (x2) : "memory");
+        return x0;
+    }
+};
+
+// Same instructions on an unaligned word, inside a 16-byte block (FEAT_LSE2).
+struct Lse2Atomics : public LseAtomics
+{
+    static constexpr const char* name = "lse2-unaligned";
+    static bool supported() { return UserFeatures::instance().FEAT_LSE2(); }
+};
+
+#endif
+
+
+//----------------------------------------------------------------------------
+// Shared data of one run, each object in its own cache line.
+//----------------------------------------------------------------------------
+
+static constexpr size_t CACHE_LINE = 64;
+static constexpr size_t QUEUE_SIZE = 1024;    // power of 2
+
+// Node of an MCS lock, one per thread.
+struct alignas(CACHE_LINE) McsNode {
+    Word next {0};
+    Word locked {0};
+};
+
+// Cell of the MPMC queue.
+struct QueueCell {
+    Word     sequence {0};
+    uint64_t value = 0;
+};
+
+struct Shared {
+    alignas(CACHE_LINE) Word counter {0};
+    alignas(CACHE_LINE) Word lock {0};
+    alignas(CACHE_LINE) uint64_t protected_count = 0;   // modified under the lock only
+    alignas(CACHE_LINE) uint8_t unaligned[CACHE_LINE] {};
+    alignas(CACHE_LINE) Word enqueue_pos {0};
+    alignas(CACHE_LINE) Word dequeue_pos {0};
+    alignas(CACHE_LINE) QueueCell cells[QUEUE_SIZE];
+    std::vector<McsNode> nodes;
+
+    Shared(size_t threads) : nodes(threads)
+    {
+        for (size_t i = 0; i < QUEUE_SIZE; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // The unaligned counter crosses an 8-byte boundary but not a 16-byte one.
+    Word& unalignedCounter() { return *reinterpret_cast<Word*>(unaligned + 4); }
+};
+
+
+//----------------------------------------------------------------------------
+// Workloads. Each function runs until 'stop' and returns the number of
+// operations. The results are checked by Check() after all threads stopped.
+//----------------------------------------------------------------------------
+
+enum Workload {COUNTER_ADD, COUNTER_CAS, COUNTER_UNALIGNED, SPINLOCK_SWP, SPINLOCK_CAS, MCS_LOCK, MPMC_QUEUE};
+
+static const char* WorkloadName(Workload workload)
+{
+    switch (workload) {
+        case COUNTER_ADD:       return "counter-add";
+        case COUNTER_CAS:       return "counter-cas";
+        case COUNTER_UNALIGNED: return "counter-unaligned";
+        case SPINLOCK_SWP:      return "spinlock-swp";
+        case SPINLOCK_CAS:      return "spinlock-cas";
+        case MCS_LOCK:          return "mcs-lock";
+        case MPMC_QUEUE:        return "mpmc-queue";
+        default:                return "unknown";
+    }
+}
+
+template <class A>
+static size_t CounterAdd(Word& counter, const std::atomic<bool>& stop)
+{
+    size_t ops = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        A::fetchAdd(counter, 1);
+        ops++;
+    }
+    return ops;
+}
+
+template <class A>
+static size_t CounterCas(Shared& sh, const std::atomic<bool>& stop)
+{
+    size_t ops = 0;
+    uint64_t value = sh.counter.load(std::memory_order_relaxed);
+    while (!stop.load(std::memory_order_relaxed)) {
+        uint64_t old;
+        while ((old = A::cas(sh.counter, value, value + 1)) != value) {
+            value = old;
+        }
+        value++;
+        ops++;
+    }
+    return ops;
+}
+
+// Test and test-and-set lock, acquired using SWP or CAS.
+template <class A, bool USE_CAS>
+static size_t SpinLock(Shared& sh, const std::atomic<bool>& stop)
+{
+    size_t ops = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        while ((USE_CAS ? A::cas(sh.lock, 0, 1) : A::exchange(sh.lock, 1)) != 0) {
+            while (sh.lock.load(std::memory_order_relaxed) != 0) {
+            }
+        }
+        sh.protected_count++;
+        sh.lock.store(0, std::memory_order_release);
+        ops++;
+    }
+    return ops;
+}
+
+// MCS queue lock, each thread spins on its own node.
+template <class A>
+static size_t McsLock(Shared& sh, size_t index, const std::atomic<bool>& stop)
+{
+    McsNode& node(sh.nodes[index]);
+    const uint64_t me = uint64_t(reinterpret_cast<uintptr_t>(&node));
+    size_t ops = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        node.next.store(0, std::memory_order_relaxed);
+        node.locked.store(1, std::memory_order_relaxed);
+        const uint64_t prev = A::exchange(sh.lock, me);
+        if (prev != 0) {
+            reinterpret_cast<McsNode*>(uintptr_t(prev))->next.store(me, std::memory_order_release);
+            while (node.locked.load(std::memory_order_acquire) != 0) {
+            }
+        }
+        sh.protected_count++;
+        uint64_t next = node.next.load(std::memory_order_acquire);
+        if (next == 0) {
+            if (A::cas(sh.lock, me, 0) == me) {
+                ops++;
+                continue;
+            }
+            while ((next = node.next.load(std::memory_order_acquire)) == 0) {
+            }
+        }
+        reinterpret_cast<McsNode*>(uintptr_t(next))->locked.store(0, std::memory_order_release);
+        ops++;
+    }
+    return ops;
+}
+
+// Bounded MPMC queue (Dmitry Vyukov), one operation is one enqueue and one dequeue.
+// The values are thread index + 1, their sum is accumulated in 'checksum'.
+template <class A>
+static size_t MpmcQueue(Shared& sh, size_t index, uint64_t& checksum, const std::atomic<bool>& stop)
+{
+    constexpr uint64_t mask = QUEUE_SIZE - 1;
+    size_t ops = 0;
+    checksum = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        // Enqueue. The queue cannot be full, there is at most one element per thread.
+        uint64_t pos = sh.enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            QueueCell& cell(sh.cells[pos & mask]);
+            const int64_t diff = int64_t(cell.sequence.load(std::memory_order_acquire)) - int64_t(pos);
+            if (diff == 0) {
+                const uint64_t old = A::cas(sh.enqueue_pos, pos, pos + 1);
+                if (old == pos) {
+                    cell.value = index + 1;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    break;
+                }
+                pos = old;
+            }
+            else {
+                pos = sh.enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        // Dequeue. The queue is transiently empty when a producer did not publish its cell yet.
+        pos = sh.dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            QueueCell& cell(sh.cells[pos & mask]);
+            const int64_t diff = int64_t(cell.sequence.load(std::memory_order_acquire)) - int64_t(pos + 1);
+            if (diff == 0) {
+                const uint64_t old = A::cas(sh.dequeue_pos, pos, pos + 1);
+                if (old == pos) {
+                    checksum += cell.value;
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    break;
+                }
+                pos = old;
+            }
+            else {
+                pos = sh.dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        ops++;
+    }
+    checksum -= ops * (index + 1);
+    return ops;
+}
+
+// Run a workload in one thread.
+template <class A>
+static size_t RunWorkload(Workload workload, Shared& sh, size_t index, uint64_t& checksum, const std::atomic<bool>& stop)
+{
+    switch (workload) {
+        case COUNTER_ADD:       return CounterAdd<A>(sh.counter, stop);
+        case COUNTER_CAS:       return CounterCas<A>(sh, stop);
+        case COUNTER_UNALIGNED: return CounterAdd<A>(sh.unalignedCounter(), stop);
+        case SPINLOCK_SWP:      return SpinLock<A, false>(sh, stop);
+        case SPINLOCK_CAS:      return SpinLock<A, true>(sh, stop);
+        case MCS_LOCK:          return McsLock<A>(sh, index, stop);
+        case MPMC_QUEUE:        return MpmcQueue<A>(sh, index, checksum, stop);
+        default:                return 0;
+    }
+}
+
+// Check the shared data after a run, given the total number of operations and the sum of the checksums.
+static bool Check(Workload workload, Shared& sh, uint64_t total, uint64_t checksum)
+{
+    switch (workload) {
+        case COUNTER_ADD:
+        case COUNTER_CAS:
+            return sh.counter.load() == total;
+        case COUNTER_UNALIGNED: {
+            uint64_t value = 0;
+            ::memcpy(&value, sh.unaligned + 4, sizeof(value));
+            return value == total;
+        }
+        case SPINLOCK_SWP:
+        case SPINLOCK_CAS:
+        case MCS_LOCK:
+            return sh.protected_count == total;
+        case MPMC_QUEUE:
+            return checksum == 0 && sh.enqueue_pos.load() == total && sh.dequeue_pos.load() == total;
+        default:
+            return false;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Run one workload with a given number of threads, display one CSV line.
+// Return false if the results are inconsistent.
+//----------------------------------------------------------------------------
+
+// Results of one thread.
+struct ThreadResult {
+    size_t   ops = 0;
+    uint64_t checksum = 0;
+    double   elapsed_ns = 0;
+    bool     bound = false;
+};
+
+template <class A>
+static bool RunBench(const Options& opt, Workload workload, size_t thread_count)
+{
+    const size_t cpus = std::max(1u, std::thread::hardware_concurrency());
+    std::unique_ptr<Shared> sh(new Shared(thread_count));
+    std::vector<ThreadResult> results(thread_count);
+    std::vector<std::thread> threads;
+    std::atomic<size_t> ready(0);
+    std::atomic<bool> go(false);
+    std::atomic<bool> stop(false);
+
+    for (size_t i = 0; i < thread_count; i++) {
+        threads.emplace_back([&, i]() {
+            ThreadResult& res(results[i]);
+            res.bound = CpuTopology::bindThread(i % cpus);
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+            }
+            const auto start = std::chrono::steady_clock::now();
+            res.ops = RunWorkload<A>(workload, *sh, i, res.checksum, stop);
+            res.elapsed_ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        });
+    }
+    while (ready.load() < thread_count) {
+        std::this_thread::yield();
+    }
+    go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::milliseconds(opt.duration_ms));
+    stop.store(true);
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    // Aggregate the results of all threads.
+    uint64_t total = 0;
+    uint64_t checksum = 0;
+    double sum_sq = 0;
+    double elapsed_ns = 0;
+    size_t min_ops = results[0].ops;
+    size_t max_ops = 0;
+    size_t unbound = 0;
+    for (const auto& res : results) {
+        total += res.ops;
+        checksum += res.checksum;
+        sum_sq += double(res.ops) * double(res.ops);
+        elapsed_ns = std::max(elapsed_ns, res.elapsed_ns);
+        min_ops = std::min(min_ops, res.ops);
+        max_ops = std::max(max_ops, res.ops);
+        unbound += !res.bound;
+    }
+    const double ops = elapsed_ns > 0 ? double(total) * 1e9 / elapsed_ns : 0.0;
+    const double fairness = sum_sq > 0 ? double(total) * double(total) / (double(thread_count) * sum_sq) : 0.0;
+
+    std::cout << WorkloadName(workload) << "," << A::name << "," << thread_count << ","
+              << Format("%.0f,%.2f,%.4f,%zu,%zu", ops, total > 0 ? elapsed_ns / double(total) : 0.0, fairness, min_ops, max_ops) << std::endl;
+    if (unbound > 0 && thread_count == 1) {
+        std::cout << "# threads cannot be bound to CPU cores" << std::endl;
+    }
+
+    const bool ok = Check(workload, *sh, total, checksum);
+    if (!ok) {
+        std::cerr << opt.command << ": " << WorkloadName(workload) << ", " << A::name << ", "
+                  << thread_count << " threads, inconsistent results" << std::endl;
+    }
+    return ok;
+}
+
+// Run one workload with all numbers of threads.
+template <class A>
+static bool RunAll(const Options& opt, Workload workload)
+{
+    if (!A::supported()) {
+        std::cout << "# " << WorkloadName(workload) << ", " << A::name << " not supported" << std::endl;
+        return true;
+    }
+    bool ok = true;
+    for (size_t count = 1; ; count = std::min(count * 2, opt.max_threads)) {
+        ok = RunBench<A>(opt, workload, count) && ok;
+        if (count >= opt.max_threads) {
+            break;
+        }
+    }
+    return ok;
+}
+
+
+//----------------------------------------------------------------------------
+// Application entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    const Options opt(argc, argv);
+    const UserFeatures& feat(UserFeatures::instance());
+
+    std::cout << "# lse," << int(feat.FEAT_LSE()) << std::endl
+              << "# lse2," << int(feat.FEAT_LSE2()) << std::endl
+              << "# max_threads," << opt.max_threads << std::endl
+              << "# duration_ms," << opt.duration_ms << std::endl
+              << "workload,variant,threads,ops_per_s,ns_per_op,fairness,min_ops,max_ops" << std::endl;
+
+    bool ok = true;
+    for (Workload workload : {COUNTER_ADD, COUNTER_CAS, COUNTER_UNALIGNED, SPINLOCK_SWP, SPINLOCK_CAS, MCS_LOCK, MPMC_QUEUE}) {
+        if (workload == COUNTER_UNALIGNED) {
+#if defined(__aarch64__)
+            ok = RunAll<Lse2Atomics>(opt, workload) && ok;
+#endif
+            continue;
+        }
+        ok = RunAll<StdAtomics>(opt, workload) && ok;
+#if defined(__aarch64__)
+        ok = RunAll<LlscAtomics>(opt, workload) && ok;
+        ok = RunAll<LseAtomics>(opt, workload) && ok;
+#endif
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
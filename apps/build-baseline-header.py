@@ -0,0 +1,112 @@
+#!/usr/bin/env python
+#----------------------------------------------------------------------------
+#
+# Arm64 CPU system registers tools
+# Copyright (c) 2023, Thierry Lelegard
+# BSD-2-Clause license, see the LICENSE file.
+#
+# Build a header file with a constexpr baseline of a target CPU, from a
+# directory of ../collect (cpusysregs-registers.txt, cpusysregs-features.txt).
+#
+# Usage: build-baseline-header.py [--name struct-name] collect-dir output.h
+#
+# The header defines a structure with the values of the identification
+# registers and all FEAT_xxx() features as constexpr static members, with
+# the same names as the accessors of ArmFeatures (see cpubaseline.h).
+#
+#----------------------------------------------------------------------------
+
+import os, sys, re
+
+# Identification registers which are kept in the baseline: same values on all CPU cores of the same type.
+ID_REGISTERS = re.compile(r'^(ID_\w+|MIDR_EL1|REVIDR_EL1|AIDR_EL1|CTR_EL0|DCZID_EL0|CLIDR_EL1)$')
+
+# Get the list of features which are known in this version of ArmFeatures.
+def known_features():
+    header = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'armfeatures.h')
+    features = set()
+    in_list = False
+    with open(header, 'r', encoding='utf-8') as input:
+        for line in input:
+            line = line.strip()
+            if line.startswith('// Begin generated features list'):
+                in_list = True
+            elif line.startswith('// End generated features list'):
+                break
+            elif in_list and line.startswith('FEAT_'):
+                features.add(line.rstrip(','))
+    return features
+
+# Get the identification registers from cpusysregs-registers.txt, as a list of (name, value).
+# The first line of each register contains its name and its binary value, groups of 4 bits.
+def get_registers(file_name):
+    registers = []
+    with open(file_name, 'r', encoding='utf-8') as input:
+        for line in input:
+            match = re.search(r'^(\w+):\s+([01][01 -]*)$', line.rstrip())
+            if match is not None and ID_REGISTERS.match(match.group(1)):
+                bits = re.sub(r'[ -]', '', match.group(2))
+                if len(bits) == 64:
+                    registers.append((match.group(1), int(bits, 2)))
+    return sorted(registers)
+
+# Get the features from cpusysregs-features.txt, as a list of (name, present).
+def get_features(file_name, known):
+    features = []
+    with open(file_name, 'r', encoding='utf-8') as input:
+        for line in input:
+            fields = line.strip().replace('.', '').split()
+            if len(fields) == 2 and fields[0] in known and fields[1] in ('yes', 'no'):
+                features.append((fields[0], fields[1] == 'yes'))
+    return sorted(features, key = lambda x: x[0].lower())
+
+# Get the core name from description.txt, if any.
+def get_core(file_name):
+    if os.path.isfile(file_name):
+        with open(file_name, 'r', encoding='utf-8') as input:
+            for line in input:
+                fields = line.split(':', 1)
+                if len(fields) == 2 and fields[0].strip() == 'core':
+                    return fields[1].strip()
+    return ''
+
+# Main code.
+args = sys.argv[1:]
+struct_name = None
+if len(args) >= 2 and args[0] == '--name':
+    struct_name = args[1]
+    args = args[2:]
+if len(args) != 2:
+    print('usage: %s [--name struct-name] collect-dir output.h' % sys.argv[0], file=sys.stderr)
+    exit(1)
+indir, output = args
+target = os.path.basename(os.path.normpath(indir))
+if struct_name is None:
+    struct_name = 'Baseline_' + re.sub(r'\W', '_', target)
+
+registers = get_registers(os.path.join(indir, 'cpusysregs-registers.txt'))
+features = get_features(os.path.join(indir, 'cpusysregs-features.txt'), known_features())
+core = get_core(os.path.join(indir, 'description.txt'))
+if not any(present for _, present in features):
+    print('%s: no feature found in %s' % (sys.argv[0], indir), file=sys.stderr)
+    exit(1)
+
+with open(output, 'w', encoding='utf-8') as out:
+    out.write('// Automatically generated by build-baseline-header.py from %s\n' % target)
+    out.write('// Do not edit, see cpubaseline.h for usage.\n\n')
+    out.write('#pragma once\n#include "cpubaseline.h"\n\n')
+    out.write('struct %s\n{\n' % struct_name)
+    out.write('    static constexpr const char* name = "%s";\n' % target)
+    out.write('    static constexpr const char* core = "%s";\n\n' % core)
+    out.write('    // Identification registers.\n')
+    for name, value in registers:
+        out.write('    static constexpr csr_u64_t %s = 0x%016X;\n' % (name, value))
+    out.write('\n    // Features, same as the ArmFeatures accessors.\n')
+    for name, present in features:
+        out.write('    static constexpr bool %s() { return %s; }\n' % (name, 'true' if present else 'false'))
+    out.write('\n    // All features which are present.\n')
+    out.write('    static constexpr ArmFeature features[] = {\n')
+    for name, present in features:
+        if present:
+            out.write('        ArmFeature::%s,\n' % name)
+    out.write('    };\n};\n')
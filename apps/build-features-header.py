@@ -5,33 +5,60 @@
 # Copyright (c) 2023, Thierry Lelegard
 # BSD-2-Clause license, see the LICENSE file.
 #
-# Build the temporary header files _armfeatures.h and _userfeatures.h.
+# Build temporary header files such as _userfeatures.h.
+#
+# With option --update, update the generated lists of features in the
+# header and source files of the class (see armfeatures.h).
 #
 #----------------------------------------------------------------------------
 
 import sys, re
 
-if len(sys.argv) != 3:
-    print('Usage: %s in-file out-file' % sys.argv[0], file=sys.stderr)
-    exit(1)
-
-class_name = None
-input_file = sys.argv[1]
-output_file = sys.argv[2]
+BEGIN_MARK = '// Begin generated features list'
+END_MARK = '// End generated features list'
 
-lines = []
-with open(input_file, 'r', encoding='utf-8') as input:
-    for line in input:
-        if class_name is None:
+# Get the class name and the sorted list of features from a header file.
+def get_features(input_file):
+    class_name = None
+    features = []
+    with open(input_file, 'r', encoding='utf-8') as input:
+        for line in input:
             match = re.search(r'^class\s+(\w+).*$', line.strip())
             if match is not None:
                 class_name = match.group(1)
-        else:
-            match = re.search(r'^bool\s+(FEAT_[^ (]+)\s*\(\).*$', line.strip())
-            if match is not None:
-                lines.append('    {"%s", &%s::%s},' % (match.group(1), class_name, match.group(1)))
+            elif class_name is not None:
+                match = re.search(r'^bool\s+(FEAT_[^ (]+)\s*\(\).*$', line.strip())
+                if match is not None:
+                    features.append((class_name, match.group(1)))
+    features.sort(key = lambda x: x[1].lower())
+    return features
+
+# Replace the generated list between the marks in a file.
+def update_file(file_name, make_line):
+    with open(file_name, 'r', encoding='utf-8', newline='') as input:
+        text = input.read()
+    eol = '\r\n' if '\r\n' in text else '\n'
+    lines = text.split(eol)
+    begin = [i for i, l in enumerate(lines) if BEGIN_MARK in l]
+    end = [i for i, l in enumerate(lines) if END_MARK in l]
+    if len(begin) != 1 or len(end) != 1 or begin[0] > end[0]:
+        print('%s: invalid or missing generated features marks' % file_name, file=sys.stderr)
+        exit(1)
+    indent = lines[begin[0]][:len(lines[begin[0]]) - len(lines[begin[0]].lstrip())]
+    lines[begin[0]+1:end[0]] = [indent + make_line(f) for f in features]
+    with open(file_name, 'w', encoding='utf-8', newline='') as output:
+        output.write(eol.join(lines))
 
-lines.sort(key = lambda x: x.lower())
-with open(output_file, 'w') as output:
-    for line in lines:
-        print(line, file=output)
+if len(sys.argv) == 4 and sys.argv[1] == '--update':
+    features = get_features(sys.argv[2])
+    update_file(sys.argv[2], lambda f: '%s,' % f[1])
+    update_file(sys.argv[3], lambda f: '{"%s", &%s::%s},' % (f[1], f[0], f[1]))
+elif len(sys.argv) == 3:
+    features = get_features(sys.argv[1])
+    with open(sys.argv[2], 'w') as output:
+        for f in features:
+            print('    {"%s", &%s::%s},' % (f[1], f[0], f[1]), file=output)
+else:
+    print('Usage: %s in-file out-file' % sys.argv[0], file=sys.stderr)
+    print('       %s --update header-file source-file' % sys.argv[0], file=sys.stderr)
+    exit(1)
@@ -0,0 +1,115 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Cache hierarchy geometry, from CLIDR_EL1 and CCSIDR_EL1.
+//
+//----------------------------------------------------------------------------
+
+#include "cacheinfo.h"
+#include "regaccess.h"
+#include "strutils.h"
+
+
+//----------------------------------------------------------------------------
+// Constructor.
+//----------------------------------------------------------------------------
+
+CacheInfo::CacheInfo(RegAccess* regs, csr_u64_t cpu)
+{
+    RegAccess& access(regs != nullptr ? *regs : RegAccess::shared());
+    csr_cache_info_t info;
+    if (!access.isOpen() || !access.readCacheInfo(info, cpu)) {
+        return;
+    }
+
+    _valid = true;
+    _clidr = info.clidr;
+    _ctr = info.ctr;
+    _line_size = size_t(4) << ((_ctr >> 16) & 0x0F);
+
+    for (int level = 1; level <= CSR_CACHE_LEVELS; level++) {
+        const int ctype = int((_clidr >> (3 * (level - 1))) & 0x07);
+        for (int instr = 1; instr >= 0; instr--) {
+            const int index = CSR_CACHE_INDEX(level, instr);
+            if ((info.valid & (csr_u64_t(1) << index)) != 0) {
+                const csr_u64_t ccsidr = info.ccsidr[index];
+                Cache cache;
+                cache.level = level;
+                cache.type = instr ? INSTRUCTION : (ctype == 4 ? UNIFIED : DATA);
+                cache.lineSize = size_t(16) << (ccsidr & 0x07);
+                if (info.ccidx) {
+                    // 64-bit format with FEAT_CCIDX.
+                    cache.ways = size_t((ccsidr >> 3) & 0x1FFFFF) + 1;
+                    cache.sets = size_t((ccsidr >> 32) & 0xFFFFFF) + 1;
+                }
+                else {
+                    cache.ways = size_t((ccsidr >> 3) & 0x3FF) + 1;
+                    cache.sets = size_t((ccsidr >> 13) & 0x7FFF) + 1;
+                }
+                _caches.push_back(cache);
+            }
+        }
+    }
+}
+
+const CacheInfo& CacheInfo::instance()
+{
+    static const CacheInfo info;
+    return info;
+}
+
+
+//----------------------------------------------------------------------------
+// Accessors.
+//----------------------------------------------------------------------------
+
+const CacheInfo::Cache* CacheInfo::dataCache(int level) const
+{
+    for (const auto& cache : _caches) {
+        if (cache.level == level && cache.type != INSTRUCTION) {
+            return &cache;
+        }
+    }
+    return nullptr;
+}
+
+size_t CacheInfo::writebackGranule() const
+{
+    const int cwg = int((_ctr >> 24) & 0x0F);
+    return cwg == 0 ? MAX_LINE_SIZE : size_t(4) << cwg;
+}
+
+size_t CacheInfo::fitElements(int level, size_t element_size, size_t share) const
+{
+    const Cache* cache = dataCache(level);
+    return cache == nullptr || element_size == 0 || share == 0 ? 0 : cache->size() / share / element_size;
+}
+
+std::string CacheInfo::Cache::toString() const
+{
+    static const char* const types[] = {"instruction", "data", "unified"};
+    const size_t total = size();
+    return Format("L%d %s, %zu %s, %zu-way, %zu sets, %zu-byte lines", level, types[type],
+                  total % (1024 * 1024) == 0 ? total / (1024 * 1024) : total / 1024,
+                  total % (1024 * 1024) == 0 ? "MB" : "KB", ways, sets, lineSize);
+}
+
+
+//----------------------------------------------------------------------------
+// Aligned allocation.
+//----------------------------------------------------------------------------
+
+void* CacheInfo::allocate(size_t size) const
+{
+    return ::operator new(alignUp(size == 0 ? 1 : size), std::align_val_t(_line_size));
+}
+
+void CacheInfo::deallocate(void* ptr) const
+{
+    if (ptr != nullptr) {
+        ::operator delete(ptr, std::align_val_t(_line_size));
+    }
+}
@@ -0,0 +1,119 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Cache hierarchy geometry, from CLIDR_EL1 and CCSIDR_EL1.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
+
+class RegAccess;
+
+//
+// Geometry of the caches of one CPU core, as read by the kernel module.
+//
+// The values come from the registers, not from the firmware tables which are
+// used by the operating system, and which are frequently wrong in virtual machines.
+// Without the kernel module, only default values are available.
+//
+class CacheInfo
+{
+public:
+    // Line size to use at compile time, in alignas(). Sufficient on most Arm cores.
+    // Use lineSize() at run time for the actual size.
+    static constexpr size_t DEFAULT_LINE_SIZE = 64;
+
+    // Largest possible line size, from CTR_EL0.CWG (2 KB).
+    static constexpr size_t MAX_LINE_SIZE = 2048;
+
+    // Type of cache.
+    enum Type {INSTRUCTION, DATA, UNIFIED};
+
+    // Description of one cache.
+    struct Cache {
+        int    level = 0;       // 1 to 7
+        Type   type = UNIFIED;
+        size_t lineSize = 0;    // in bytes
+        size_t sets = 0;
+        size_t ways = 0;
+
+        // Total size in bytes.
+        size_t size() const { return lineSize * sets * ways; }
+
+        // Description, e.g. "L1 data, 64 KB, 4-way, 64-byte lines"
+        std::string toString() const;
+    };
+
+    // Constructor: read the caches of a CPU core using the kernel module.
+    CacheInfo(RegAccess* regs = nullptr, csr_u64_t cpu = CSR_CPU_ANY);
+
+    // Get a process-wide instance, read on first use on any CPU core.
+    static const CacheInfo& instance();
+
+    // True when the registers were read.
+    bool valid() const { return _valid; }
+
+    // All caches, by increasing level, instruction cache first.
+    const std::vector<Cache>& caches() const { return _caches; }
+
+    // Data or unified cache at a given level, null pointer if there is none.
+    const Cache* dataCache(int level) const;
+
+    // Raw registers.
+    csr_u64_t clidr() const { return _clidr; }
+    csr_u64_t ctr() const { return _ctr; }
+
+    // Levels of coherence and unification, from CLIDR_EL1.
+    int levelOfCoherence() const { return int((_clidr >> 24) & 0x07); }
+    int levelOfUnification() const { return int((_clidr >> 27) & 0x07); }
+
+    // Smallest data cache line, from CTR_EL0.DminLine. This is the size to use for
+    // alignment and padding against false sharing. DEFAULT_LINE_SIZE if not read.
+    size_t lineSize() const { return _line_size; }
+
+    // Cache writeback granule, maximum size of memory which can be overwritten
+    // by a cache writeback, from CTR_EL0.CWG. This is MAX_LINE_SIZE if not reported.
+    size_t writebackGranule() const;
+
+    // Round a size up to a multiple of the line size.
+    size_t alignUp(size_t size) const { return (size + _line_size - 1) / _line_size * _line_size; }
+
+    // Number of elements of a given size which fit in a fraction (1/share) of the data
+    // cache at a given level, e.g. for tile sizes. Zero if there is no such cache.
+    size_t fitElements(int level, size_t element_size, size_t share = 2) const;
+
+    // Allocate and free memory which is aligned on the line size and padded to a multiple of it.
+    void* allocate(size_t size) const;
+    void deallocate(void* ptr) const;
+
+    //
+    // A standard allocator for containers, aligned on the line size of instance().
+    //
+    template <typename T>
+    class Allocator
+    {
+    public:
+        typedef T value_type;
+        Allocator() noexcept = default;
+        template <typename U> Allocator(const Allocator<U>&) noexcept {}
+        T* allocate(size_t n) { return static_cast<T*>(instance().allocate(n * sizeof(T))); }
+        void deallocate(T* p, size_t) noexcept { instance().deallocate(p); }
+        template <typename U> bool operator==(const Allocator<U>&) const noexcept { return true; }
+        template <typename U> bool operator!=(const Allocator<U>&) const noexcept { return false; }
+    };
+
+private:
+    bool      _valid = false;
+    csr_u64_t _clidr = 0;
+    csr_u64_t _ctr = 0;
+    size_t    _line_size = DEFAULT_LINE_SIZE;
+    std::vector<Cache> _caches;
+};
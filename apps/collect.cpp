@@ -4,8 +4,16 @@
 // Copyright (c) 2023, Thierry Lelegard
 // BSD-2-Clause license, see the LICENSE file.
 //
-// Collect tabular data about the PAC format. The output format is compatible
-// with the table at the end of docs/pac-format.md.
+// Collect information about the system.
+//
+// Without option, display tabular data about the PAC format. The output format
+// is compatible with the table at the end of docs/pac-format.md.
+//
+// With -o directory, create all cpusysregs-*.txt files in one pass. The CPU
+// features are loaded once and the independent subsystems are concurrently
+// probed, each in its own thread, with its own RegAccess instance. The same
+// information is also stored in a binary snapshot, cpusysregs-snapshot.bin,
+// which can be compared with another one using snapdiff.
 //
 //----------------------------------------------------------------------------
 
@@ -13,15 +21,82 @@
 #include "armfeatures.h"
 #include "armpseudocode.h"
 #include "regview.h"
+#include "reports.h"
+#include "regrecord.h"
 #include "strutils.h"
 
 #include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
 #include <cstddef>
 #include <cstdlib>
 
 #define WIDTH 15
 
 
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    std::string directory;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -o directory : create all cpusysregs-*.txt files and the binary snapshot" << std::endl
+              << "                 cpusysregs-snapshot.bin in this directory" << std::endl
+              << std::endl
+              << "Without -o, display the PAC format table on standard output." << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    directory()
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-o" && i+1 < argc) {
+            directory = argv[++i];
+        }
+        else {
+            fatal("invalid option '" + arg + "', try --help");
+        }
+    }
+}
+
+
 //----------------------------------------------------------------------------
 // Formatting functions.
 //----------------------------------------------------------------------------
@@ -63,10 +138,9 @@ std::string PacBits(ArmPseudoCode& code, csr_u64_t address, bool is_instr)
 // Check if PAC keys are identical in EL0 and EL1.
 //----------------------------------------------------------------------------
 
-std::string PacKeys(RegAccess& regs, int regid)
+std::string PacKeys(RegAccess& regs, const ArmFeatures& feat, int regid)
 {
     // Check if PAC is implemented.
-    ArmFeatures feat(regs);
     if (!feat.FEAT_PAuth()) {
         return Str("none");
     }
@@ -128,18 +202,16 @@ std::string PacKeys(RegAccess& regs, int regid)
 
 
 //----------------------------------------------------------------------------
-// Program entry point.
+// Table of PAC format, in Markdown.
 //----------------------------------------------------------------------------
 
-int main(int argc, char* argv[])
+void PacTable(std::ostream& out, RegAccess& regs, const ArmFeatures& feat)
 {
-    RegAccess regs(true, true);
-    ArmFeatures feat(regs);
-    ArmPseudoCode code(regs);
+    ArmPseudoCode code(regs, feat);
 
     const char* algo = (feat.FEAT_PACQARMA5() ? "QARMA5" : (feat.FEAT_PACQARMA3() ? "QARMA3" : (feat.FEAT_PACIMP() ? "private" : "none")));
 
-    std::cout << "| PAC algorithm        | " << Str(algo) << std::endl
+    out << "| PAC algorithm        | " << Str(algo) << std::endl
               << "| PAuth / PAuth2       | " << Bool(feat.FEAT_PAuth(), feat.FEAT_PAuth2()) << std::endl
               << "| EPAC / FPAC          | " << Bool(feat.FEAT_EPAC(), feat.FEAT_FPAC()) << std::endl
               << "| MTE tagging          | " << Bool(feat.addressTaggingEnabled()) << std::endl
@@ -163,11 +235,11 @@ int main(int argc, char* argv[])
               << "| instruction, upper   | " << Int(code.pacSelBit(~0ull, true), "bit ") << std::endl
               << "|                      | " << Str("") << std::endl
               << "| **EL0/EL1 PAC keys** | " << Str("") << std::endl
-              << "| DA                   | " << PacKeys(regs, CSR_REGID2_APDAKEY_EL1) << std::endl
-              << "| DB                   | " << PacKeys(regs, CSR_REGID2_APDBKEY_EL1) << std::endl
-              << "| IA                   | " << PacKeys(regs, CSR_REGID2_APIAKEY_EL1) << std::endl
-              << "| IB                   | " << PacKeys(regs, CSR_REGID2_APIBKEY_EL1) << std::endl
-              << "| Generic (PACGA)      | " << PacKeys(regs, CSR_REGID2_APGAKEY_EL1) << std::endl
+              << "| DA                   | " << PacKeys(regs, feat, CSR_REGID2_APDAKEY_EL1) << std::endl
+              << "| DB                   | " << PacKeys(regs, feat, CSR_REGID2_APDBKEY_EL1) << std::endl
+              << "| IA                   | " << PacKeys(regs, feat, CSR_REGID2_APIAKEY_EL1) << std::endl
+              << "| IB                   | " << PacKeys(regs, feat, CSR_REGID2_APIBKEY_EL1) << std::endl
+              << "| Generic (PACGA)      | " << PacKeys(regs, feat, CSR_REGID2_APGAKEY_EL1) << std::endl
               << "|                      | " << Str("") << std::endl
               << "| **TCR_EL1 register** | " << Str("") << std::endl
               << "| TBI0                 | " << Int(feat.TCR_EL1_TBI0()) << std::endl
@@ -176,5 +248,112 @@ int main(int argc, char* argv[])
               << "| TBI1                 | " << Int(feat.TCR_EL1_TBI1()) << std::endl
               << "| TBID1                | " << Int(feat.TCR_EL1_TBID1()) << std::endl
               << "| T1SZ                 | " << Int(feat.TCR_EL1_T1SZ()) << std::endl;
-    return EXIT_SUCCESS;
+}
+
+
+//----------------------------------------------------------------------------
+// Binary snapshot of the host, see HostSnapshot.
+//----------------------------------------------------------------------------
+
+void SnapshotReport(std::ostream& out, RegAccess& regs, const ArmFeatures& feat)
+{
+    RegRecordWriter records(out, RegRecordWriter::BINARY);
+
+    // All readable registers, read on any CPU core, then on each CPU core.
+    RegistersReport(out, regs, feat, false, &records);
+#if !defined(__APPLE__)
+    std::vector<int> regids;
+    for (const auto& desc : RegView::AllRegisters) {
+        if (desc.canRead(feat)) {
+            regids.push_back(desc.csr_index);
+        }
+    }
+    std::vector<std::vector<csr_multi_reg_t>> table;
+    if (regs.readOnAllCpus(regids, table)) {
+        for (size_t cpu = 0; cpu < table.size(); cpu++) {
+            for (size_t i = 0; i < regids.size() && i < table[cpu].size(); i++) {
+                const csr_multi_reg_t& reg(table[cpu][i]);
+                records.writeRegister(RegView::getRegister(regids[i]), reg.value, int(cpu), int(reg.status));
+            }
+        }
+    }
+#endif
+
+    // CPU features, as seen from the system registers and from user mode.
+    FeaturesReport(out, feat, &records);
+    UserFeaturesReport(out, &records);
+
+    // PAC geometry, for lower and upper addresses, data and instructions.
+    ArmPseudoCode code(regs, feat);
+    for (int i = 0; i < REGRECORD_PAC_COUNT; i++) {
+        const csr_u64_t address = (i & REGRECORD_PAC_UPPER) ? ~0ull : 0;
+        const bool is_instr = (i & REGRECORD_PAC_INSTR) != 0;
+        int value = 0;
+        switch (i & ~(REGRECORD_PAC_UPPER | REGRECORD_PAC_INSTR)) {
+            case REGRECORD_PAC_SIZE: value = code.pacSize(address, is_instr); break;
+            case REGRECORD_PAC_TOP_BIT: value = code.pacTopBit(address, is_instr); break;
+            case REGRECORD_PAC_BOTTOM_BIT: value = code.pacBottomBit(address, is_instr); break;
+            case REGRECORD_PAC_SEL_BIT: value = code.pacSelBit(address, is_instr); break;
+        }
+        records.writePAC(RegRecordPAC(i), value);
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Program entry point.
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    const Options opt(argc, argv);
+
+    // Load the CPU features once, before starting the threads.
+    const ArmFeatures& feat(ArmFeatures::instance());
+    if (opt.directory.empty()) {
+        RegAccess regs(true, true);
+        PacTable(std::cout, regs, feat);
+        return EXIT_SUCCESS;
+    }
+
+    // All reports, each of them is built in its own thread.
+    struct Report {
+        std::string file;
+        std::function<void(std::ostream&, RegAccess&)> build;
+        bool binary = false;
+    };
+    const std::vector<Report> reports {
+        {"cpusysregs-features.txt", [&feat](std::ostream& out, RegAccess& regs) { FeaturesReport(out, feat); }},
+        {"cpusysregs-pac.txt", [&feat](std::ostream& out, RegAccess& regs) { PACReport(out, regs, feat); }},
+        {"cpusysregs-registers.txt", [&opt, &feat](std::ostream& out, RegAccess& regs) { RegistersReport(out, regs, feat, true, nullptr, opt.command); }},
+        {"cpusysregs-pac-md.txt", [&feat](std::ostream& out, RegAccess& regs) { PacTable(out, regs, feat); }},
+        {"cpusysregs-user-features.txt", [](std::ostream& out, RegAccess& regs) { UserFeaturesReport(out); }},
+        {"cpusysregs-snapshot.bin", [&feat](std::ostream& out, RegAccess& regs) { SnapshotReport(out, regs, feat); }, true},
+        // Operating system view of the CPU features, same as linux-hwcaps or mac-sysctl.
+#if defined(__linux__)
+        {"cpusysregs-hwcaps.txt", [](std::ostream& out, RegAccess& regs) { HwcapsReport(out); }},
+#elif defined(__APPLE__)
+        {"cpusysregs-sysctl.txt", [](std::ostream& out, RegAccess& regs) { SysctlReport(out); }},
+#endif
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<char> success(reports.size(), 0);
+    for (size_t i = 0; i < reports.size(); i++) {
+        threads.emplace_back([&opt, &reports, &success, i]() {
+            const std::string path(opt.directory + "/" + reports[i].file);
+            std::ofstream out(path, reports[i].binary ? std::ios::out | std::ios::binary : std::ios::out);
+            if (!out) {
+                std::cerr << opt.command << ": cannot create " << path << std::endl;
+                return;
+            }
+            RegAccess regs(true, false);
+            reports[i].build(out, regs);
+            success[i] = bool(out);
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    return std::find(success.begin(), success.end(), 0) == success.end() ? EXIT_SUCCESS : EXIT_FAILURE;
 }
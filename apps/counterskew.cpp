@@ -0,0 +1,279 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Measure the skew and drift of the virtual counter between CPU cores.
+//
+// For each pair of CPU cores, two threads are bound to the two cores and
+// exchange counter values through one shared cache line. The reference
+// thread reads its counter, signals the other thread which replies with its
+// own counter value, then the reference thread reads its counter again.
+// The round with the shortest round trip gives the best estimate of the
+// offset: other core counter minus the middle of the round trip.
+//
+// The drift is the change of the offset with core 0 after a delay. Using the
+// kernel module, the offset of the virtual counter (CNTPCT_EL0 - CNTVCT_EL0)
+// is also read on each core, it must be identical on all cores.
+//
+//----------------------------------------------------------------------------
+
+#include "cpusysregs.h"
+#include "cputimer.h"
+#include "regaccess.h"
+#include "cputopology.h"
+#include "cacheinfo.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cinttypes>
+#include <clocale>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    size_t      rounds;
+    double      tolerance_ns;
+    size_t      delay_ms;
+    size_t      cpus;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -d ms : delay between the two measurements of the drift (default: 1000)" << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -n count : number of round trips per pair of CPU cores (default: 1000)" << std::endl
+              << "  -t ns : tolerance on the skew, in nanoseconds (default: 100)" << std::endl
+              << std::endl
+              << "The exit status is non-zero when some CPU cores are outside the tolerance." << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    rounds(1000),
+    tolerance_ns(100),
+    delay_ms(1000),
+    cpus(std::max(1u, std::thread::hardware_concurrency()))
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-d" && i+1 < argc) {
+            delay_ms = size_t(std::strtoull(argv[++i], nullptr, 0));
+        }
+        else if (arg == "-n" && i+1 < argc) {
+            rounds = std::max<size_t>(1, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else if (arg == "-t" && i+1 < argc) {
+            tolerance_ns = std::strtod(argv[++i], nullptr);
+        }
+        else {
+            fatal("invalid option '" + arg + "', try --help");
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Offset between the counters of two CPU cores.
+//----------------------------------------------------------------------------
+
+// The shared cache line for the round trips.
+struct alignas(CacheInfo::DEFAULT_LINE_SIZE) PingPong {
+    std::atomic<csr_u64_t> request {0};   // round number, set by the reference thread
+    std::atomic<csr_u64_t> response {0};  // round number, set by the other thread
+    csr_u64_t              counter = 0;   // counter value of the other thread
+};
+
+// Result of the measurement between two CPU cores, in counter ticks.
+struct Offset {
+    int64_t   offset = 0;  // other core minus reference core
+    csr_u64_t rtt = 0;     // shortest round trip, the uncertainty is half of it
+};
+
+// Measure the offset of the counter of 'other' relatively to 'ref'.
+static Offset MeasureOffset(const Options& opt, const CpuTimer& timer, size_t ref, size_t other)
+{
+    Offset result;
+    if (ref == other) {
+        return result;
+    }
+    PingPong pp;
+    std::thread responder([&opt, &timer, &pp, other]() {
+        CpuTopology::bindThread(other);
+        for (csr_u64_t round = 1; round <= opt.rounds; round++) {
+            while (pp.request.load(std::memory_order_acquire) != round) {
+            }
+            pp.counter = timer.read();
+            pp.response.store(round, std::memory_order_release);
+        }
+    });
+    std::thread reference([&opt, &timer, &pp, &result, ref]() {
+        CpuTopology::bindThread(ref);
+        result.rtt = ~csr_u64_t(0);
+        for (csr_u64_t round = 1; round <= opt.rounds; round++) {
+            const csr_u64_t start = timer.read();
+            pp.request.store(round, std::memory_order_release);
+            while (pp.response.load(std::memory_order_acquire) != round) {
+            }
+            const csr_u64_t end = timer.read();
+            if (end - start < result.rtt) {
+                result.rtt = end - start;
+                result.offset = int64_t(pp.counter - start) - int64_t(result.rtt / 2);
+            }
+        }
+    });
+    reference.join();
+    responder.join();
+    return result;
+}
+
+
+//----------------------------------------------------------------------------
+// Program entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    // Make sure printf knows how to format integers.
+    setlocale(LC_ALL, "en_US.UTF-8");
+
+    const Options opt(argc, argv);
+    const CpuTimer& timer(CpuTimer::instance());
+    const size_t cpus = opt.cpus;
+    int status = EXIT_SUCCESS;
+
+    std::cout << "Counter: " << timer.sourceName() << ", frequency: " << Format("%'" PRIu64, timer.frequency())
+              << " Hz, read overhead: " << Format("%.1f", timer.nanoseconds(timer.overhead())) << " ns" << std::endl;
+    if (timer.source() == CpuTimer::STEADY_CLOCK) {
+        std::cout << "Warning: no EL0 access to the virtual counter, using the system clock" << std::endl;
+    }
+#if defined(__APPLE__)
+    std::cout << "Warning: threads cannot be bound to CPU cores on macOS, the results are approximate" << std::endl;
+#endif
+
+    // Skew matrix, all pairs of CPU cores.
+    std::vector<std::vector<Offset>> matrix(cpus, std::vector<Offset>(cpus));
+    for (size_t ref = 0; ref < cpus; ref++) {
+        for (size_t other = 0; other < cpus; other++) {
+            matrix[ref][other] = MeasureOffset(opt, timer, ref, other);
+        }
+    }
+
+    std::cout << std::endl << "Skew matrix in ns: counter of column core minus counter of row core" << std::endl;
+    std::string line;
+    line.assign("     ");
+    for (size_t other = 0; other < cpus; other++) {
+        AppendFormat(line, " %7zu", other);
+    }
+    std::cout << line << std::endl;
+    double max_uncertainty = 0;
+    for (size_t ref = 0; ref < cpus; ref++) {
+        line.clear();
+        AppendFormat(line, "%4zu ", ref);
+        for (size_t other = 0; other < cpus; other++) {
+            const Offset& off(matrix[ref][other]);
+            AppendFormat(line, " %+7.0f", off.offset < 0 ? -timer.nanoseconds(csr_u64_t(-off.offset)) : timer.nanoseconds(csr_u64_t(off.offset)));
+            max_uncertainty = std::max(max_uncertainty, timer.nanoseconds(off.rtt / 2));
+        }
+        std::cout << line << std::endl;
+    }
+    std::cout << "Maximum uncertainty: " << Format("%.1f", max_uncertainty) << " ns (half of the shortest round trip)" << std::endl;
+
+    // Drift relatively to core 0.
+    if (cpus > 1 && opt.delay_ms > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(opt.delay_ms));
+        std::cout << std::endl << "Drift relatively to core 0 after " << opt.delay_ms << " ms:" << std::endl;
+        for (size_t other = 1; other < cpus; other++) {
+            const Offset off(MeasureOffset(opt, timer, 0, other));
+            const int64_t drift = off.offset - matrix[0][other].offset;
+            const double ns = drift < 0 ? -timer.nanoseconds(csr_u64_t(-drift)) : timer.nanoseconds(csr_u64_t(drift));
+            std::cout << Format("%4zu  %+.0f ns, %+.1f ppb", other, ns, ns * 1e3 / double(opt.delay_ms)) << std::endl;
+        }
+    }
+
+    // Cores outside the tolerance, relatively to core 0, after removing the uncertainty.
+    std::vector<std::string> outside;
+    for (size_t other = 1; other < cpus; other++) {
+        const Offset& off(matrix[0][other]);
+        const double skew = timer.nanoseconds(csr_u64_t(off.offset < 0 ? -off.offset : off.offset));
+        if (skew - timer.nanoseconds(off.rtt / 2) > opt.tolerance_ns) {
+            outside.push_back(Format("%zu", other));
+        }
+    }
+    if (outside.empty()) {
+        std::cout << std::endl << "All CPU cores within " << Format("%.0f", opt.tolerance_ns) << " ns of core 0" << std::endl;
+    }
+    else {
+        std::cout << std::endl << "CPU cores outside " << Format("%.0f", opt.tolerance_ns) << " ns of core 0: " << Join(outside) << std::endl;
+        status = EXIT_FAILURE;
+    }
+
+    // Offset of the virtual counter, as seen at EL1 on each core.
+    RegAccess regs;
+    std::vector<std::vector<csr_multi_reg_t>> table;
+    if (regs.isOpen() && regs.readOnAllCpus({CSR_REGID_CNTVCT_EL0, CSR_REGID_CNTPCT_EL0}, table)) {
+        std::cout << std::endl << "Virtual offset at EL1 (CNTPCT_EL0 - CNTVCT_EL0):" << std::endl;
+        bool first = true;
+        csr_u64_t ref_offset = 0;
+        bool identical = true;
+        for (size_t cpu = 0; cpu < table.size(); cpu++) {
+            if (table[cpu].size() < 2 || table[cpu][0].status != 0 || table[cpu][1].status != 0) {
+                std::cout << Format("%4zu  ", cpu) << "not available" << std::endl;
+                continue;
+            }
+            // Both counters are read in sequence, the result is the offset plus the time between the two reads.
+            const csr_u64_t offset = table[cpu][1].value.low - table[cpu][0].value.low;
+            std::cout << Format("%4zu  ", cpu) << ToHexa(offset) << std::endl;
+            if (first) {
+                ref_offset = offset;
+                first = false;
+            }
+            else if (timer.nanoseconds(offset > ref_offset ? offset - ref_offset : ref_offset - offset) > opt.tolerance_ns) {
+                identical = false;
+            }
+        }
+        if (!identical) {
+            std::cout << "Virtual offsets differ between CPU cores" << std::endl;
+            status = EXIT_FAILURE;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,74 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A baseline of CPU features for a known target CPU.
+//
+//----------------------------------------------------------------------------
+
+#include "cpubaseline.h"
+#include <cstdio>
+#include <cstdlib>
+
+
+//----------------------------------------------------------------------------
+// Constructor.
+//----------------------------------------------------------------------------
+
+CpuBaseline::CpuBaseline(std::string_view name, const ArmFeature* features, size_t count) :
+    _name(name)
+{
+    for (size_t i = 0; features != nullptr && i < count; i++) {
+        _features.set(features[i]);
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Features of the running CPU.
+//----------------------------------------------------------------------------
+
+const ArmFeatures& CpuBaseline::runningCpu()
+{
+    const ArmFeatures& cpu(ArmFeatures::instance());
+#if defined(__linux__) && defined(__aarch64__)
+    if (!cpu.isLoaded()) {
+        // Without kernel module and cache file, use the MRS emulation of the Linux kernel.
+        static const ArmFeatures direct = []() {
+            ArmFeatures feat;
+            feat.loadDirect();
+            return feat;
+        }();
+        return direct;
+    }
+#endif
+    return cpu;
+}
+
+
+//----------------------------------------------------------------------------
+// Startup self-check on the running CPU.
+//----------------------------------------------------------------------------
+
+bool CpuBaseline::check(const std::string& command, bool exit_on_error) const
+{
+    const ArmFeatures& cpu(runningCpu());
+    if (!cpu.isLoaded()) {
+        std::fprintf(stderr, "%s: cannot read the CPU features, the baseline %.*s is not checked\n",
+                     command.c_str(), int(_name.size()), _name.data());
+        return true;
+    }
+    const FeatureSet miss(missing(cpu));
+    if (miss.empty()) {
+        return true;
+    }
+    // Use stdio, this module is part of the core library, without iostream.
+    std::fprintf(stderr, "%s: this CPU does not satisfy the baseline %.*s, missing: %s\n",
+                 command.c_str(), int(_name.size()), _name.data(), miss.toNames(", ").c_str());
+    if (exit_on_error) {
+        std::exit(EXIT_FAILURE);
+    }
+    return false;
+}
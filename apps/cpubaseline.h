@@ -0,0 +1,67 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A baseline of CPU features for a known target CPU.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "armfeatures.h"
+#include <iterator>
+#include <string>
+#include <string_view>
+
+//
+// A baseline of CPU features for a known target CPU.
+//
+// The script build-baseline-header.py generates a header from a directory of ../collect.
+// The header defines a structure with the identification registers and the FEAT_xxx()
+// features of the target as constexpr static members, with the same names as the ArmFeatures
+// accessors. A binary which is built for that target can remove the runtime dispatch:
+//
+//   #include "_baseline.h"  // generated for the target, defines struct TargetBaseline
+//   if constexpr (TargetBaseline::FEAT_SVE()) { ... } else { ... }
+//
+// The binary must then check at startup that the running CPU has all features of the baseline:
+//
+//   CpuBaseline::of<TargetBaseline>().check(argv[0]);
+//
+class CpuBaseline
+{
+public:
+    // Constructor from a name and a list of features.
+    CpuBaseline(std::string_view name, const ArmFeature* features, size_t count);
+
+    // Build the baseline of a generated structure.
+    template <class BASELINE>
+    static CpuBaseline of() { return CpuBaseline(BASELINE::name, BASELINE::features, std::size(BASELINE::features)); }
+
+    // Name of the baseline, the collect directory it was generated from.
+    std::string_view name() const { return _name; }
+
+    // All features of the baseline.
+    const FeatureSet& features() const { return _features; }
+
+    // Features of the running CPU: ArmFeatures::instance() when loaded (kernel module or cache
+    // file). Otherwise, on Linux, the features are read at EL0 using the MRS emulation of the
+    // kernel. On other systems, the returned instance is not loaded, the features are unknown.
+    static const ArmFeatures& runningCpu();
+
+    // Features of the baseline which are missing on a CPU, empty when the CPU satisfies the baseline.
+    // When the features of the CPU are not loaded, they are unknown and nothing is reported as missing.
+    FeatureSet missing(const ArmFeatures& cpu = runningCpu()) const { return cpu.isLoaded() ? _features - cpu.features() : FeatureSet(); }
+    bool satisfiedBy(const ArmFeatures& cpu = runningCpu()) const { return missing(cpu).empty(); }
+
+    // Startup self-check on the running CPU. When some features are missing, display them
+    // on standard error, prefixed by the command name, and exit when exit_on_error is true.
+    // When the features of the running CPU are unknown, the check is skipped with a warning.
+    // Return true when the running CPU satisfies the baseline or when its features are unknown.
+    bool check(const std::string& command, bool exit_on_error = true) const;
+
+private:
+    std::string_view _name;
+    FeatureSet       _features;
+};
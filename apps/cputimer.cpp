@@ -0,0 +1,152 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Low-overhead time measurement, using the generic timer counters at EL0.
+//
+//----------------------------------------------------------------------------
+
+#include "cputimer.h"
+#include "regaccess.h"
+#include "userfeatures.h"
+#include "strutils.h"
+#include <algorithm>
+#include <cinttypes>
+
+
+//----------------------------------------------------------------------------
+// Timer constructor.
+//----------------------------------------------------------------------------
+
+CpuTimer::CpuTimer(bool physical, RegAccess* regs)
+{
+    // Check EL0 access to the counter: CNTKCTL_EL1.EL0PCTEN (bit 0) or EL0VCTEN (bit 1).
+    RegAccess& access(regs != nullptr ? *regs : RegAccess::shared());
+    bool el0_access = !physical;
+    csr_u64_t cntkctl = 0;
+    if (access.isOpen() && access.read(CSR_REGID_CNTKCTL_EL1, cntkctl)) {
+        el0_access = (cntkctl & (physical ? 0x01 : 0x02)) != 0;
+    }
+
+    if (el0_access) {
+        // CNTFRQ_EL0 is readable at EL0 when one of the counters is.
+        csr_mrs(_frequency, CSR_SREG_CNTFRQ_EL0);
+        if (_frequency == 0) {
+            _frequency = 1000000000;
+        }
+        else if (UserFeatures::instance().FEAT_ECV()) {
+            _source = physical ? CNTPCTSS : CNTVCTSS;
+        }
+        else {
+            _source = physical ? CNTPCT : CNTVCT;
+        }
+    }
+    calibrate();
+}
+
+const CpuTimer& CpuTimer::instance()
+{
+    static const CpuTimer timer;
+    return timer;
+}
+
+std::string CpuTimer::sourceName() const
+{
+    switch (_source) {
+        case CNTVCTSS: return "CNTVCTSS_EL0";
+        case CNTVCT: return "CNTVCT_EL0";
+        case CNTPCTSS: return "CNTPCTSS_EL0";
+        case CNTPCT: return "CNTPCT_EL0";
+        case STEADY_CLOCK:
+        default: return "steady_clock";
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Measure the read overhead and the resolution.
+//----------------------------------------------------------------------------
+
+void CpuTimer::calibrate()
+{
+    constexpr size_t WARMUP = 100;
+    constexpr size_t SAMPLES = 1001;
+    constexpr size_t INCREMENTS = 100;
+
+    // Warm up, then median of the difference between two consecutive reads.
+    for (size_t i = 0; i < WARMUP; i++) {
+        read();
+    }
+    std::vector<csr_u64_t> deltas(SAMPLES);
+    for (auto& d : deltas) {
+        const csr_u64_t start = read();
+        d = read() - start;
+    }
+    std::sort(deltas.begin(), deltas.end());
+    _overhead = deltas[SAMPLES / 2];
+
+    // Smallest non-zero increment of the counter.
+    _resolution = ~csr_u64_t(0);
+    for (size_t i = 0; i < INCREMENTS; i++) {
+        const csr_u64_t start = read();
+        csr_u64_t end = start;
+        while (end == start) {
+            end = read();
+        }
+        _resolution = std::min(_resolution, end - start);
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Latency histogram.
+//----------------------------------------------------------------------------
+
+TimerHistogram::TimerHistogram(const std::vector<csr_u64_t>& limits) :
+    _limits(limits.empty() ? std::vector<csr_u64_t>{1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000} : limits),
+    _buckets(_limits.size() + 1, 0)
+{
+}
+
+void TimerHistogram::add(csr_u64_t ns)
+{
+    const size_t i = size_t(std::upper_bound(_limits.begin(), _limits.end(), ns) - _limits.begin());
+    _buckets[i]++;
+    _min = _total == 0 ? ns : std::min(_min, ns);
+    _max = std::max(_max, ns);
+    _sum += ns;
+    _total++;
+}
+
+void TimerHistogram::add(const TimerHistogram& other)
+{
+    if (other._total > 0 && other._limits == _limits) {
+        for (size_t i = 0; i < _buckets.size(); i++) {
+            _buckets[i] += other._buckets[i];
+        }
+        _min = _total == 0 ? other._min : std::min(_min, other._min);
+        _max = std::max(_max, other._max);
+        _sum += other._sum;
+        _total += other._total;
+    }
+}
+
+void TimerHistogram::print(std::ostream& out, const std::string& title) const
+{
+    out << std::endl << title << ": " << Format("%'" PRIu64, _total) << " values";
+    if (_total > 0) {
+        out << Format(", min: %'" PRIu64 " ns, avg: %'" PRIu64 " ns, max: %'" PRIu64 " ns", _min, _sum / _total, _max);
+    }
+    out << std::endl;
+    csr_u64_t largest = 0;
+    for (auto b : _buckets) {
+        largest = std::max(largest, b);
+    }
+    for (size_t i = 0; largest > 0 && i < _buckets.size(); i++) {
+        const std::string label(i < _limits.size() ? Format("< %'" PRIu64 " ns", _limits[i]) : Format(">= %'" PRIu64 " ns", _limits.back()));
+        out << "  " << Pad(label, 14, ' ') << Format(" %'10" PRIu64 " ", _buckets[i])
+            << std::string(size_t((_buckets[i] * 50 + largest - 1) / largest), '#') << std::endl;
+    }
+}
@@ -0,0 +1,152 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Low-overhead time measurement, using the generic timer counters at EL0.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class RegAccess;
+
+//
+// A timer which reads the virtual or physical counter at EL0.
+//
+// With FEAT_ECV, the self-synchronized registers CNTVCTSS_EL0 or CNTPCTSS_EL0
+// are read, without ISB. Otherwise, CNTVCT_EL0 or CNTPCT_EL0 are read after an ISB.
+// When EL0 access to the counter is trapped (CNTKCTL_EL1), the timer falls back
+// to std::chrono::steady_clock, with a frequency of 1 GHz.
+//
+// The read overhead and the resolution of the counter are calibrated in the
+// constructor. The instance is read-only after construction and can be shared
+// between threads.
+//
+class CpuTimer
+{
+public:
+    // How the timer is read.
+    enum Source {CNTVCTSS, CNTVCT, CNTPCTSS, CNTPCT, STEADY_CLOCK};
+
+    // Constructor. Use the physical counter when 'physical' is true.
+    // CNTKCTL_EL1 is read using the kernel module when possible, to check EL0 access.
+    // When not accessible, EL0 access is assumed to the virtual counter only.
+    CpuTimer(bool physical = false, RegAccess* regs = nullptr);
+
+    // Get a process-wide instance on the virtual counter, calibrated on first use.
+    static const CpuTimer& instance();
+
+    // Read the counter.
+    inline csr_u64_t read() const;
+
+    // Timer characteristics.
+    Source source() const { return _source; }
+    std::string sourceName() const;
+    csr_u64_t frequency() const { return _frequency; }
+    csr_u64_t overhead() const { return _overhead; }      // counter ticks, median cost of one read
+    csr_u64_t resolution() const { return _resolution; }  // counter ticks, smallest non-zero increment
+
+    // Convert counter ticks in nanoseconds.
+    double nanoseconds(csr_u64_t ticks) const { return double(ticks) * 1e9 / double(_frequency); }
+
+    // Nanoseconds between two reads, without the read overhead.
+    double elapsed(csr_u64_t start, csr_u64_t end) const { return end - start > _overhead ? nanoseconds(end - start - _overhead) : 0.0; }
+
+private:
+    Source    _source = STEADY_CLOCK;
+    csr_u64_t _frequency = 1000000000;
+    csr_u64_t _overhead = 0;
+    csr_u64_t _resolution = 1;
+
+    // Measure the read overhead and the resolution.
+    void calibrate();
+};
+
+//
+// A latency histogram, with buckets in nanoseconds.
+//
+class TimerHistogram
+{
+public:
+    // Constructor. The limits are the upper bounds of the buckets, in increasing order.
+    // The default limits are 1, 2, 5, 10, 20, 50, 100, 200, 500 and 1000 micro-seconds.
+    TimerHistogram(const std::vector<csr_u64_t>& limits = std::vector<csr_u64_t>());
+
+    // Add a value, in nanoseconds.
+    void add(csr_u64_t ns);
+    void add(double ns) { add(csr_u64_t(ns + 0.5)); }
+
+    // Add all values of another histogram, which must have the same limits.
+    void add(const TimerHistogram& other);
+
+    // Statistics.
+    csr_u64_t count() const { return _total; }
+    csr_u64_t min() const { return _min; }
+    csr_u64_t max() const { return _max; }
+    csr_u64_t average() const { return _total == 0 ? 0 : _sum / _total; }
+
+    // Display the histogram.
+    void print(std::ostream& out, const std::string& title) const;
+
+private:
+    std::vector<csr_u64_t> _limits;
+    std::vector<csr_u64_t> _buckets;  // one more than limits
+    csr_u64_t _total = 0;
+    csr_u64_t _min = 0;
+    csr_u64_t _max = 0;
+    csr_u64_t _sum = 0;
+};
+
+//
+// Measure the duration of a scope, in a histogram.
+//
+class ScopedTimer
+{
+public:
+    ScopedTimer(TimerHistogram& histo, const CpuTimer& timer = CpuTimer::instance()) : _histo(histo), _timer(timer), _start(timer.read()) {}
+    ~ScopedTimer() { _histo.add(_timer.elapsed(_start, _timer.read())); }
+
+    ScopedTimer(ScopedTimer&&) = delete;
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(ScopedTimer&&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    TimerHistogram& _histo;
+    const CpuTimer& _timer;
+    csr_u64_t       _start;
+};
+
+// Read the counter.
+inline csr_u64_t CpuTimer::read() const
+{
+    csr_u64_t value = 0;
+    switch (_source) {
+        case CNTVCTSS:
+            csr_mrs(value, CSR_SREG_CNTVCTSS_EL0);
+            break;
+        case CNTVCT:
+            csr_isb();
+            csr_mrs(value, CSR_SREG_CNTVCT_EL0);
+            break;
+        case CNTPCTSS:
+            csr_mrs(value, CSR_SREG_CNTPCTSS_EL0);
+            break;
+        case CNTPCT:
+            csr_isb();
+            csr_mrs(value, CSR_SREG_CNTPCT_EL0);
+            break;
+        case STEADY_CLOCK:
+        default:
+            value = csr_u64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+            break;
+    }
+    return value;
+}
@@ -0,0 +1,289 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// CPU topology: core classes and clusters, from MIDR_EL1 and MPIDR_EL1.
+//
+//----------------------------------------------------------------------------
+
+#include "cputopology.h"
+#include "regaccess.h"
+#include "strutils.h"
+#include <algorithm>
+#include <fstream>
+#include <thread>
+
+#if defined(__linux__)
+    #include <sched.h>
+#endif
+
+
+//----------------------------------------------------------------------------
+// Known CPU cores.
+//----------------------------------------------------------------------------
+
+namespace {
+    struct KnownCore {
+        int implementer;
+        int part;
+        const char* name;
+        CpuTopology::Tier tier;
+    };
+
+    const KnownCore KnownCores[] = {
+        {0x41, 0xD03, "Cortex-A53",  CpuTopology::EFFICIENCY},
+        {0x41, 0xD04, "Cortex-A35",  CpuTopology::EFFICIENCY},
+        {0x41, 0xD05, "Cortex-A55",  CpuTopology::EFFICIENCY},
+        {0x41, 0xD07, "Cortex-A57",  CpuTopology::PERFORMANCE},
+        {0x41, 0xD08, "Cortex-A72",  CpuTopology::PERFORMANCE},
+        {0x41, 0xD09, "Cortex-A73",  CpuTopology::PERFORMANCE},
+        {0x41, 0xD0A, "Cortex-A75",  CpuTopology::PERFORMANCE},
+        {0x41, 0xD0B, "Cortex-A76",  CpuTopology::PERFORMANCE},
+        {0x41, 0xD0C, "Neoverse-N1", CpuTopology::PERFORMANCE},
+        {0x41, 0xD0D, "Cortex-A77",  CpuTopology::PERFORMANCE},
+        {0x41, 0xD40, "Neoverse-V1", CpuTopology::PERFORMANCE},
+        {0x41, 0xD41, "Cortex-A78",  CpuTopology::PERFORMANCE},
+        {0x41, 0xD44, "Cortex-X1",   CpuTopology::PRIME},
+        {0x41, 0xD46, "Cortex-A510", CpuTopology::EFFICIENCY},
+        {0x41, 0xD47, "Cortex-A710", CpuTopology::PERFORMANCE},
+        {0x41, 0xD48, "Cortex-X2",   CpuTopology::PRIME},
+        {0x41, 0xD49, "Neoverse-N2", CpuTopology::PERFORMANCE},
+        {0x41, 0xD4D, "Cortex-A715", CpuTopology::PERFORMANCE},
+        {0x41, 0xD4E, "Cortex-X3",   CpuTopology::PRIME},
+        {0x41, 0xD4F, "Neoverse-V2", CpuTopology::PERFORMANCE},
+        {0x41, 0xD80, "Cortex-A520", CpuTopology::EFFICIENCY},
+        {0x41, 0xD81, "Cortex-A720", CpuTopology::PERFORMANCE},
+        {0x41, 0xD82, "Cortex-X4",   CpuTopology::PRIME},
+        {0x61, 0x022, "Apple-M1-Icestorm",      CpuTopology::EFFICIENCY},
+        {0x61, 0x023, "Apple-M1-Firestorm",     CpuTopology::PERFORMANCE},
+        {0x61, 0x024, "Apple-M1-Pro-Icestorm",  CpuTopology::EFFICIENCY},
+        {0x61, 0x025, "Apple-M1-Pro-Firestorm", CpuTopology::PERFORMANCE},
+        {0x61, 0x028, "Apple-M1-Max-Icestorm",  CpuTopology::EFFICIENCY},
+        {0x61, 0x029, "Apple-M1-Max-Firestorm", CpuTopology::PERFORMANCE},
+        {0x61, 0x032, "Apple-M2-Blizzard",      CpuTopology::EFFICIENCY},
+        {0x61, 0x033, "Apple-M2-Avalanche",     CpuTopology::PERFORMANCE},
+        {0xC0, 0xAC3, "Ampere-1",    CpuTopology::PERFORMANCE},
+    };
+
+    const KnownCore* FindCore(csr_u64_t midr)
+    {
+        const int implementer = int((midr >> 24) & 0xFF);
+        const int part = int((midr >> 4) & 0xFFF);
+        for (const auto& core : KnownCores) {
+            if (core.implementer == implementer && core.part == part) {
+                return &core;
+            }
+        }
+        return nullptr;
+    }
+}
+
+std::string CpuTopology::coreName(csr_u64_t midr)
+{
+    const KnownCore* core = FindCore(midr);
+    return core != nullptr ? core->name : Format("0x%02X-0x%03X", int((midr >> 24) & 0xFF), int((midr >> 4) & 0xFFF));
+}
+
+CpuTopology::Tier CpuTopology::coreTier(csr_u64_t midr)
+{
+    const KnownCore* core = FindCore(midr);
+    return core != nullptr ? core->tier : BALANCED;
+}
+
+int CpuTopology::Cpu::affinity(int level) const
+{
+    switch (level) {
+        case 0: return int(mpidr & 0xFF);
+        case 1: return int((mpidr >> 8) & 0xFF);
+        case 2: return int((mpidr >> 16) & 0xFF);
+        case 3: return int((mpidr >> 32) & 0xFF);
+        default: return 0;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Constructor.
+//----------------------------------------------------------------------------
+
+CpuTopology::CpuTopology(RegAccess* regs)
+{
+    RegAccess& access(regs != nullptr ? *regs : RegAccess::shared());
+    std::vector<std::vector<csr_multi_reg_t>> table;
+
+    if (access.isOpen() && access.readOnAllCpus({CSR_REGID_MIDR_EL1, CSR_REGID_MPIDR_EL1, CSR_REGID_CTR_EL0}, table)) {
+        _per_core = true;
+        _cpus.resize(table.size());
+        for (size_t i = 0; i < table.size(); i++) {
+            Cpu& cpu(_cpus[i]);
+            cpu.index = i;
+            cpu.online = table[i].size() == 3 && table[i][0].status == 0 && table[i][1].status == 0;
+            if (cpu.online) {
+                cpu.midr = table[i][0].value.low;
+                cpu.mpidr = table[i][1].value.low;
+                cpu.ctr = table[i][2].status == 0 ? table[i][2].value.low : 0;
+            }
+        }
+    }
+    else {
+        // Read the registers on any core and assume that all cores are identical.
+        Cpu model;
+        model.online = true;
+        if (access.isOpen()) {
+            access.read(CSR_REGID_MIDR_EL1, model.midr);
+            access.read(CSR_REGID_CTR_EL0, model.ctr);
+        }
+        _cpus.resize(std::max<size_t>(1, std::thread::hardware_concurrency()), model);
+
+#if defined(__linux__)
+        // Without the kernel module, Linux exports MIDR_EL1 of each core in sysfs.
+        for (size_t i = 0; i < _cpus.size(); i++) {
+            std::ifstream in(Format("/sys/devices/system/cpu/cpu%zu/regs/identification/midr_el1", i));
+            std::string line;
+            csr_u64_t midr = 0;
+            if (std::getline(in, line) && line.compare(0, 2, "0x") == 0 && DecodeHexa(midr, line.substr(2))) {
+                _cpus[i].midr = midr;
+            }
+        }
+#endif
+        for (size_t i = 0; i < _cpus.size(); i++) {
+            _cpus[i].index = i;
+        }
+    }
+    build();
+}
+
+const CpuTopology& CpuTopology::instance()
+{
+    static const CpuTopology topology;
+    return topology;
+}
+
+
+//----------------------------------------------------------------------------
+// Build the classes and clusters.
+//----------------------------------------------------------------------------
+
+void CpuTopology::build()
+{
+    for (auto& cpu : _cpus) {
+        if (!cpu.online) {
+            continue;
+        }
+        // Core class: same MIDR_EL1, ignoring the revision.
+        const csr_u64_t midr = cpu.midr & ~csr_u64_t(0x0F);
+        size_t ci = 0;
+        while (ci < _classes.size() && _classes[ci].midr != midr) {
+            ci++;
+        }
+        if (ci == _classes.size()) {
+            _classes.emplace_back();
+            _classes[ci].midr = midr;
+            _classes[ci].name = coreName(midr);
+            _classes[ci].tier = coreTier(midr);
+        }
+        _classes[ci].cpus.push_back(cpu.index);
+        cpu.coreClass = ci;
+
+        // Cluster: affinity levels above the core. Without per-core MPIDR_EL1, one single cluster.
+        const csr_u64_t affinity = !_per_core ? 0 : cpu.mpidr & (cpu.multiThreaded() ? 0xFF00FF0000 : 0xFF00FFFF00);
+        size_t cl = 0;
+        while (cl < _clusters.size() && _clusters[cl].affinity != affinity) {
+            cl++;
+        }
+        if (cl == _clusters.size()) {
+            _clusters.emplace_back();
+            _clusters[cl].affinity = affinity;
+        }
+        _clusters[cl].cpus.push_back(cpu.index);
+        cpu.cluster = cl;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Sets of CPU cores for thread placement.
+//----------------------------------------------------------------------------
+
+CpuTopology::CpuSet CpuTopology::fastestClass() const
+{
+    const CoreClass* best = nullptr;
+    for (const auto& cl : _classes) {
+        if (best == nullptr || cl.tier > best->tier ||
+            (cl.tier == best->tier && ((cl.midr >> 4) & 0xFFF) > ((best->midr >> 4) & 0xFFF)))
+        {
+            best = &cl;
+        }
+    }
+    return best == nullptr ? CpuSet() : best->cpus;
+}
+
+CpuTopology::CpuSet CpuTopology::slowestClass() const
+{
+    const CoreClass* best = nullptr;
+    for (const auto& cl : _classes) {
+        if (best == nullptr || cl.tier < best->tier ||
+            (cl.tier == best->tier && ((cl.midr >> 4) & 0xFFF) < ((best->midr >> 4) & 0xFFF)))
+        {
+            best = &cl;
+        }
+    }
+    return best == nullptr ? CpuSet() : best->cpus;
+}
+
+CpuTopology::CpuSet CpuTopology::sameClass(size_t cpu) const
+{
+    return cpu < _cpus.size() && _cpus[cpu].online ? _classes[_cpus[cpu].coreClass].cpus : CpuSet();
+}
+
+CpuTopology::CpuSet CpuTopology::sameCluster(size_t cpu) const
+{
+    return cpu < _cpus.size() && _cpus[cpu].online ? _clusters[_cpus[cpu].cluster].cpus : CpuSet();
+}
+
+bool CpuTopology::bindThread(const CpuSet& cpus)
+{
+    if (cpus.empty()) {
+        return false;
+    }
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    return ::sched_setaffinity(0, sizeof(set), &set) == 0;
+#elif defined(WINDOWS)
+    DWORD_PTR mask = 0;
+    for (size_t cpu : cpus) {
+        if (cpu < 8 * sizeof(mask)) {
+            mask |= DWORD_PTR(1) << cpu;
+        }
+    }
+    return mask != 0 && ::SetThreadAffinityMask(::GetCurrentThread(), mask) != 0;
+#else
+    return false;
+#endif
+}
+
+std::string CpuTopology::cpuList(const CpuSet& cpus)
+{
+    std::string result;
+    for (size_t i = 0; i < cpus.size(); ) {
+        size_t last = i;
+        while (last + 1 < cpus.size() && cpus[last + 1] == cpus[last] + 1) {
+            last++;
+        }
+        if (!result.empty()) {
+            result.append(1, ',');
+        }
+        AppendFormat(result, "%zu", cpus[i]);
+        if (last > i) {
+            AppendFormat(result, "-%zu", cpus[last]);
+        }
+        i = last + 1;
+    }
+    return result;
+}
@@ -0,0 +1,118 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// CPU topology: core classes and clusters, from MIDR_EL1 and MPIDR_EL1.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include <string>
+#include <vector>
+
+class RegAccess;
+
+//
+// The topology of the system, from the identification registers of each CPU core.
+//
+// MIDR_EL1, MPIDR_EL1 and CTR_EL0 are read on all CPU cores using the kernel module.
+// Logical CPU cores with the same MIDR_EL1 (ignoring the revision) are in the same
+// core class. Logical CPU cores with the same upper affinity levels in MPIDR_EL1
+// are in the same cluster: they typically share the outer cache levels.
+//
+// Without the kernel module (or on macOS), the registers are read on the current
+// core only and all CPU cores are assumed identical, in one cluster.
+//
+class CpuTopology
+{
+public:
+    // A set of logical CPU core indexes, in increasing order.
+    typedef std::vector<size_t> CpuSet;
+
+    // Performance tier of a core class, from the known part numbers.
+    enum Tier {EFFICIENCY = 0, BALANCED = 1, PERFORMANCE = 2, PRIME = 3};
+
+    // Description of one logical CPU core.
+    struct Cpu {
+        size_t    index = 0;        // logical CPU core index
+        bool      online = false;   // false if the registers could not be read
+        csr_u64_t midr = 0;         // MIDR_EL1
+        csr_u64_t mpidr = 0;        // MPIDR_EL1
+        csr_u64_t ctr = 0;          // CTR_EL0
+        size_t    coreClass = 0;    // index in classes(), when online
+        size_t    cluster = 0;      // index in clusters(), when online
+
+        int implementer() const { return int((midr >> 24) & 0xFF); }
+        int variant() const { return int((midr >> 20) & 0x0F); }
+        int part() const { return int((midr >> 4) & 0xFFF); }
+        int revision() const { return int(midr & 0x0F); }
+
+        // Affinity levels 0 to 3 from MPIDR_EL1. When multi-threaded (MT bit),
+        // level 0 is the thread, level 1 the core, level 2 the cluster.
+        int affinity(int level) const;
+        bool multiThreaded() const { return (mpidr & (csr_u64_t(1) << 24)) != 0; }
+
+        // Smallest data and instruction cache line sizes in bytes, from CTR_EL0.
+        size_t dataLineSize() const { return size_t(4) << ((ctr >> 16) & 0x0F); }
+        size_t instrLineSize() const { return size_t(4) << (ctr & 0x0F); }
+    };
+
+    // Description of a class of identical CPU cores.
+    struct CoreClass {
+        csr_u64_t   midr = 0;  // MIDR_EL1, without revision
+        std::string name;      // core name, or implementer and part number when unknown
+        Tier        tier = BALANCED;
+        CpuSet      cpus;      // online CPU cores only
+    };
+
+    // Description of a cluster of CPU cores.
+    struct Cluster {
+        csr_u64_t affinity = 0;  // MPIDR_EL1 affinity bits above the core level
+        CpuSet    cpus;          // online CPU cores only
+    };
+
+    // Constructor: read the topology using the kernel module.
+    CpuTopology(RegAccess* regs = nullptr);
+
+    // Get a process-wide instance, read on first use.
+    static const CpuTopology& instance();
+
+    // True when the registers were read on each CPU core.
+    bool perCore() const { return _per_core; }
+
+    // Access the topology.
+    const std::vector<Cpu>& cpus() const { return _cpus; }
+    const std::vector<CoreClass>& classes() const { return _classes; }
+    const std::vector<Cluster>& clusters() const { return _clusters; }
+
+    // Sets of CPU cores for thread placement. Empty when 'cpu' is out of range.
+    // The fastest class is the class with the highest tier, then the most recent
+    // part number. Offline CPU cores are never included.
+    CpuSet fastestClass() const;
+    CpuSet slowestClass() const;
+    CpuSet sameClass(size_t cpu) const;
+    CpuSet sameCluster(size_t cpu) const;
+
+    // Bind the calling thread to a set of CPU cores, when supported (not on macOS).
+    static bool bindThread(const CpuSet& cpus);
+    static bool bindThread(size_t cpu) { return bindThread(CpuSet{cpu}); }
+
+    // Format a set of CPU cores as a list of ranges, as in Linux: "0-3,6".
+    static std::string cpuList(const CpuSet& cpus);
+
+    // Get the name of a CPU core and its performance tier from its MIDR_EL1.
+    static std::string coreName(csr_u64_t midr);
+    static Tier coreTier(csr_u64_t midr);
+
+private:
+    bool _per_core = false;
+    std::vector<Cpu> _cpus;
+    std::vector<CoreClass> _classes;
+    std::vector<Cluster> _clusters;
+
+    // Build the classes and clusters from the cpus.
+    void build();
+};
@@ -0,0 +1,59 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Demo program: compile-time dispatch on a target CPU baseline.
+//
+// The header _baseline.h is generated by build-baseline-header.py from a
+// directory of ../collect, as selected by the BASELINE make variable. The
+// code paths are selected at compile time using "if constexpr". At startup,
+// the program checks that the running CPU satisfies the baseline.
+//
+//----------------------------------------------------------------------------
+
+#include "cpubaseline.h"
+#include "_baseline.h"
+#include <iostream>
+#include <cstdlib>
+
+
+// Program entry point
+int main(int argc, char* argv[])
+{
+    const std::string command(argc < 1 ? "" : argv[0]);
+    const bool force = argc > 1 && std::string(argv[1]) == "-f";
+
+    // Startup self-check, exit if the CPU does not match, unless forced.
+    const CpuBaseline baseline(CpuBaseline::of<TargetBaseline>());
+    const bool ok = baseline.check(command, !force);
+
+    std::cout << "Baseline: " << baseline.name();
+    if (*TargetBaseline::core != '\0') {
+        std::cout << " (" << TargetBaseline::core << ")";
+    }
+    std::cout << ", " << baseline.features().count() << " features" << std::endl
+              << "Running CPU: " << (ok ? "satisfies the baseline" : "does not satisfy the baseline") << std::endl;
+
+    // Code paths which are selected at compile time, without runtime dispatch.
+    if constexpr (TargetBaseline::FEAT_SVE()) {
+        std::cout << "Vector code: SVE" << std::endl;
+    }
+    else {
+        std::cout << "Vector code: Advanced SIMD" << std::endl;
+    }
+    if constexpr (TargetBaseline::FEAT_LSE()) {
+        std::cout << "Atomics: LSE instructions" << std::endl;
+    }
+    else {
+        std::cout << "Atomics: load/store exclusive" << std::endl;
+    }
+    if constexpr (TargetBaseline::FEAT_PAuth()) {
+        std::cout << "Return addresses: signed with PAC" << std::endl;
+    }
+    else {
+        std::cout << "Return addresses: not signed" << std::endl;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -11,14 +11,20 @@
 #include "strutils.h"
 #include "regaccess.h"
 #include "armfeatures.h"
+#include "pmusession.h"
+#include "cputimer.h"
 #include <iostream>
 #include <string>
 #include <list>
+#include <map>
+#include <algorithm>
+#include <vector>
 #include <clocale>
 #include <chrono>
 #include <thread>
 #include <cinttypes>
 #include <clocale>
+#include <cstdlib>
 
 // Display a timer access permission.
 void PrintAccess(const char* name, bool enabled)
@@ -26,20 +32,6 @@ void PrintAccess(const char* name, bool enabled)
     std::cout << "EL0 access to " << name << " registers: " << (enabled ? "enabled" : "trapped") << std::endl;
 }
 
-// Get timer counter.
-inline csr_u64_t GetVirtualCounter()
-{
-    csr_u64_t counter = 0;
-    asm volatile("isb \n mrs %0, cntvct_el0" : "=r" (counter));
-    return counter;
-}
-inline csr_u64_t GetPhysicalCounter()
-{
-    csr_u64_t counter = 0;
-    asm volatile("isb \n mrs %0, cntpct_el0" : "=r" (counter));
-    return counter;
-}
-
 // Format a counter value. Including time difference with previous counter, ifthere is one.
 std::string CounterString(csr_u64_t counter, csr_u64_t previous = 0, csr_u64_t freq = 0)
 {
@@ -56,15 +48,143 @@ std::string CounterString(csr_u64_t counter, csr_u64_t previous = 0, csr_u64_t f
     }
 }
 
+// Sample the counters using the periodic sampler of the kernel module and display latency histograms.
+int SampleCounters(RegAccess& regs, csr_u64_t freq, csr_u64_t count, csr_u64_t period_us)
+{
+    const csr_u64_t period_ns = period_us * 1000;
+    if (freq == 0 || !regs.startSampler({CSR_REGID_CNTVCT_EL0, CSR_REGID_CNTPCT_EL0}, period_ns)) {
+        return EXIT_FAILURE;
+    }
+    std::cout << "Sampling " << Format("%'" PRIu64, count) << " counter values every " << Format("%'" PRIu64, period_us) << " micro-sec on all CPU cores ..." << std::endl;
+
+    // Drain the samples until the expected count is reached. Give up after twice the expected duration.
+    std::vector<csr_sample_t> all;
+    std::vector<csr_sample_t> samples;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(2 * count * period_us) + std::chrono::seconds(1);
+    bool success = true;
+    while (success && all.size() < count && std::chrono::steady_clock::now() < deadline) {
+        success = regs.readSamples(samples);
+        all.insert(all.end(), samples.begin(), samples.end());
+        if (samples.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    regs.stopSampler();
+    if (!success) {
+        return EXIT_FAILURE;
+    }
+
+    // Analyze the samples, per CPU core.
+    TimerHistogram wakeup;
+    TimerHistogram interval;
+    std::map<csr_u64_t, const csr_sample_t*> previous;
+    std::map<csr_u64_t, csr_u64_t> dropped;
+    csr_u64_t min_offset = ~csr_u64_t(0);
+    csr_u64_t max_offset = 0;
+    for (const auto& smp : all) {
+        if (smp.time_ns >= smp.expires_ns) {
+            wakeup.add(smp.time_ns - smp.expires_ns);
+        }
+        if (smp.status == 0) {
+            // Offset between physical and virtual counters.
+            const csr_u64_t offset = smp.values[1] - smp.values[0];
+            min_offset = std::min(min_offset, offset);
+            max_offset = std::max(max_offset, offset);
+            // Deviation from the sampling period, using the virtual counter, on consecutive samples.
+            const csr_sample_t* prev = previous[smp.cpu];
+            if (prev != nullptr && prev->seq + 1 == smp.seq && prev->values[0] < smp.values[0]) {
+                const csr_u64_t ns = ((smp.values[0] - prev->values[0]) * 1000000000) / freq;
+                interval.add(ns > period_ns ? ns - period_ns : period_ns - ns);
+            }
+            previous[smp.cpu] = &smp;
+        }
+        dropped[smp.cpu] = smp.dropped;
+    }
+
+    csr_u64_t total_dropped = 0;
+    for (const auto& it : dropped) {
+        total_dropped += it.second;
+    }
+    std::cout << "Received " << Format("%'zu", all.size()) << " samples from " << previous.size() << " CPU cores, "
+              << Format("%'" PRIu64, total_dropped) << " dropped" << std::endl;
+    if (max_offset >= min_offset) {
+        std::cout << "CNTPCT_EL0 - CNTVCT_EL0: " << ToHexa(min_offset);
+        if (max_offset != min_offset) {
+            std::cout << " to " << ToHexa(max_offset);
+        }
+        std::cout << std::endl;
+    }
+    wakeup.print(std::cout, "Timer wakeup latency");
+    interval.print(std::cout, "CNTVCT_EL0 interval deviation from sampling period");
+    return EXIT_SUCCESS;
+}
+
+// Measure a simple loop using the performance monitors, read at EL0.
+int MeasureLoop(RegAccess& regs)
+{
+    PmuSession pmu(regs);
+    const std::vector<csr_u64_t> events {PmuSession::INST_RETIRED, PmuSession::BR_MIS_PRED, PmuSession::L1D_CACHE_REFILL};
+    if (!pmu.open(events, true)) {
+        std::cerr << "cannot open PMU session, " << pmu.counterCount() << " event counters" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Keep the thread on the same CPU core, as much as possible, during the measurement.
+    std::vector<csr_u64_t> start;
+    std::vector<csr_u64_t> end;
+    volatile csr_u64_t sum = 0;
+    pmu.readAll(start);
+    for (csr_u64_t i = 0; i < 1000000; i++) {
+        sum = sum + (i & 7 ? i : i >> 1);
+    }
+    pmu.readAll(end);
+    pmu.close();
+
+    std::cout << "Loop of 1,000,000 iterations, " << pmu.counterCount() << " event counters available" << std::endl
+              << "Instructions retired: " << Format("%'" PRIu64, (end[0] - start[0]) & 0xFFFFFFFF) << std::endl
+              << "Mispredicted branches: " << Format("%'" PRIu64, (end[1] - start[1]) & 0xFFFFFFFF) << std::endl
+              << "L1 data cache refills: " << Format("%'" PRIu64, (end[2] - start[2]) & 0xFFFFFFFF) << std::endl
+              << "CPU cycles: " << Format("%'" PRIu64, end[3] - start[3]) << std::endl;
+    return EXIT_SUCCESS;
+}
+
 // Program entry point
 int main(int argc, char* argv[])
 {
     // Make sure printf knows how to format integers.
     setlocale(LC_ALL, "en_US.UTF-8");
 
+    // Command line: optional --sample [count [period-us]] or --pmu.
+    bool sample = false;
+    const bool pmu = argc == 2 && std::string(argv[1]) == "--pmu";
+    csr_u64_t sample_count = 10000;
+    csr_u64_t sample_period = 100;
+    if (argc > 1 && !pmu) {
+        sample = std::string(argv[1]) == "--sample";
+        if (sample && argc > 2) {
+            sample_count = std::strtoull(argv[2], nullptr, 0);
+        }
+        if (sample && argc > 3) {
+            sample_period = std::strtoull(argv[3], nullptr, 0);
+        }
+        if (!sample || argc > 4 || sample_count == 0 || sample_period == 0) {
+            std::cerr << "Usage: " << argv[0] << " [--sample [count [period-micro-sec]] | --pmu]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
     // Open the pseudo-device for the kernel module.
     RegAccess regs(true, true);
-    ArmFeatures feat(regs);
+    const ArmFeatures& feat(ArmFeatures::instance());
+
+    if (pmu) {
+        return MeasureLoop(regs);
+    }
+    csr_u64_t freq = 0;
+    regs.read(CSR_REGID_CNTFRQ_EL0, freq);
+    if (sample) {
+        return SampleCounters(regs, freq, sample_count, sample_period);
+    }
 
     // Get counter-timer kernel control register.
     csr_u64_t cntkctl = 0;
@@ -91,13 +211,17 @@ int main(int argc, char* argv[])
     }
     std::cout << std::endl;
 
-    // Get counter frequency.
-    csr_u64_t freq = 0;
-    asm("mrs %0, cntfrq_el0" : "=r" (freq));
+    // Counter frequency and EL0 timers, the highest resolution is 1 GHz.
+    const CpuTimer ptimer(true, &regs);
+    const CpuTimer vtimer(false, &regs);
     std::cout << std::endl << "Counter frequency: " << Format("%'" PRIu64, freq) << " Hz" << std::endl;
+    for (const CpuTimer* timer : {&ptimer, &vtimer}) {
+        std::cout << "EL0 timer using " << timer->sourceName() << ": read overhead: " << Format("%.1f", timer->nanoseconds(timer->overhead()))
+                  << " ns, resolution: " << Format("%.1f", timer->nanoseconds(timer->resolution())) << " ns" << std::endl;
+    }
 
     // Get physical counters.
-    csr_u64_t el0_phys1 = el0pcten ? GetPhysicalCounter() : 0;
+    csr_u64_t el0_phys1 = el0pcten ? ptimer.read() : 0;
     csr_u64_t el1_phys1 = 0;
     regs.read(CSR_REGID_CNTPCT_EL0, el1_phys1);
     std::cout << std::endl
@@ -105,7 +229,7 @@ int main(int argc, char* argv[])
               << "EL1 physical counter: " << CounterString(el1_phys1) << std::endl;
 
     // Get virtual counters.
-    csr_u64_t el0_virt1 = el0vcten ? GetVirtualCounter() : 0;
+    csr_u64_t el0_virt1 = el0vcten ? vtimer.read() : 0;
     csr_u64_t el1_virt1 = 0;
     regs.read(CSR_REGID_CNTVCT_EL0, el1_virt1);
     std::cout << std::endl
@@ -116,7 +240,7 @@ int main(int argc, char* argv[])
     std::this_thread::sleep_for(std::chrono::milliseconds(1000));
 
     // Get physical counters again.
-    csr_u64_t el0_phys2 = el0pcten ? GetPhysicalCounter() : 0;
+    csr_u64_t el0_phys2 = el0pcten ? ptimer.read() : 0;
     csr_u64_t el1_phys2 = 0;
     regs.read(CSR_REGID_CNTPCT_EL0, el1_phys2);
     std::cout << std::endl
@@ -124,7 +248,7 @@ int main(int argc, char* argv[])
               << "EL1 physical counter: " << CounterString(el1_phys2, el1_phys1, freq) << std::endl;
 
     // Get virtual counters again.
-    csr_u64_t el0_virt2 = el0vcten ? GetVirtualCounter() : 0;
+    csr_u64_t el0_virt2 = el0vcten ? vtimer.read() : 0;
     csr_u64_t el1_virt2 = 0;
     regs.read(CSR_REGID_CNTVCT_EL0, el1_virt2);
     std::cout << std::endl
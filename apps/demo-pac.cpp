@@ -45,15 +45,20 @@ void GetKey(RegAccess& regaccess, const std::string& title, csr_pair_t& key, int
     }
 }
 
-void SetKey(RegAccess& regaccess, const std::string& title, const csr_pair_t& key, int regid)
+void SwapKey(RegAccess& regaccess, const std::string& title, const csr_pair_t& key, int index)
 {
-    const auto& desc(RegView::getRegister(regid));
-    if (desc.features & RegView::WRITE) {
-        std::cout << Pad(title, WIDTH) << " " << ToHexa(key) << std::endl;
-        regaccess.write(regid, key);
+    // Write one key and get its previous value in one call.
+    const auto& desc(RegView::getRegister(CSR_REGID2_APIAKEY_EL1 + index));
+    csr_pac_keys_t keys;
+    Zero(&keys, sizeof(keys));
+    keys.set = 1 << index;
+    keys.keys[index] = key;
+    std::cout << Pad(title, WIDTH) << " " << ToHexa(key) << std::endl;
+    if ((desc.features & (RegView::READ | RegView::WRITE)) != (RegView::READ | RegView::WRITE)) {
+        std::cout << Pad(title, WIDTH) << " Cannot swap " << desc.name << " on this CPU" << std::endl;
     }
-    else {
-        std::cout << Pad(title, WIDTH) << " Cannot write " << desc.name << " on this CPU" << std::endl;
+    else if (regaccess.swapPacKeys(keys) && (keys.valid & keys.set)) {
+        std::cout << Pad("Previous key", WIDTH) << " " << ToHexa(keys.keys[index]) << std::endl;
     }
 }
 
@@ -79,7 +84,7 @@ std::string Status(csr_u64_t value, csr_u64_t expected)
 
 void TestGA(RegAccess& regaccess, const std::string& title, const csr_pair_t& key, csr_u64_t value, csr_u64_t modifier)
 {
-    ArmFeatures features(regaccess);
+    const ArmFeatures& features(ArmFeatures::instance());
     ArmPseudoCode code(regaccess);
 
     // PACGA in user mode.
@@ -119,7 +124,7 @@ void TestGA(RegAccess& regaccess, const std::string& title, const csr_pair_t& ke
 
 void TestKeyOneValue(RegAccess& regaccess, int regid, csr_u64_t value, csr_u64_t modifier)
 {
-    ArmFeatures features(regaccess);
+    const ArmFeatures& features(ArmFeatures::instance());
     ArmPseudoCode code(regaccess);
 
     std::string keyname;
@@ -265,7 +270,7 @@ int main(int argc, char* argv[])
 {
     // Open the pseudo-device for the kernel module.
     RegAccess regaccess(true, true);
-    ArmFeatures features(regaccess);
+    const ArmFeatures& features(ArmFeatures::instance());
 
     // This application makes sense only if PAC is implemented.
     if (!features.FEAT_PAuth()) {
@@ -288,13 +293,13 @@ int main(int argc, char* argv[])
     TestGA(regaccess, "PACGA", key0, value, modifier);
 
     const csr_pair_t key1 {0xDEADBEEFBADC0FFE, 0x0123456789ABCDEF};
-    SetKey(regaccess, "Update GA key", key1, CSR_REGID2_APGAKEY_EL1);
+    SwapKey(regaccess, "Update GA key", key1, CSR_PACKEY_GA);
 
     csr_pair_t key2;
     GetKey(regaccess, "Updated GA key", key2, CSR_REGID2_APGAKEY_EL1);
     TestGA(regaccess, "PACGA", key2, value, modifier);
 
-    SetKey(regaccess, "Restore GA key", key0, CSR_REGID2_APGAKEY_EL1);
+    SwapKey(regaccess, "Restore GA key", key0, CSR_PACKEY_GA);
     GetKey(regaccess, "Restored GA key", key2, CSR_REGID2_APGAKEY_EL1);
     TestGA(regaccess, "PACGA", key2, value, modifier);
 
@@ -0,0 +1,230 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Fast memory operations, using the Arm64 specific instructions.
+//
+//----------------------------------------------------------------------------
+
+#include "fastmem.h"
+#include "userfeatures.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define CSR_USE_NEON 1
+#endif
+
+
+//----------------------------------------------------------------------------
+// Zero memory.
+//----------------------------------------------------------------------------
+
+#if defined(__aarch64__)
+namespace {
+    // Zero a small area, typically the unaligned edges of a DC ZVA area.
+    void ZeroEdge(uint8_t* addr, size_t size)
+    {
+#if defined(CSR_USE_NEON)
+        const uint8x16_t zero = vdupq_n_u8(0);
+        for (; size >= 64; addr += 64, size -= 64) {
+            vst1q_u8(addr, zero);
+            vst1q_u8(addr + 16, zero);
+            vst1q_u8(addr + 32, zero);
+            vst1q_u8(addr + 48, zero);
+        }
+        for (; size >= 16; addr += 16, size -= 16) {
+            vst1q_u8(addr, zero);
+        }
+#endif
+        ::memset(addr, 0, size);
+    }
+}
+#endif
+
+void FastZero(void* addr, size_t size)
+{
+#if defined(__aarch64__)
+    // The block size is 4 to 2048 bytes, typically 64, zero when prohibited.
+    static const size_t block = UserFeatures::instance().dczBlockSize();
+    if (block != 0 && size >= FASTZERO_THRESHOLD && size >= 2 * block) {
+        uint8_t* start = static_cast<uint8_t*>(addr);
+        uint8_t* const end = start + size;
+        uint8_t* first = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(start) + block - 1) & ~uintptr_t(block - 1));
+        uint8_t* const last = reinterpret_cast<uint8_t*>(reinterpret_cast<uintptr_t>(end) & ~uintptr_t(block - 1));
+        ZeroEdge(start, size_t(first - start));
+        for (; first < last; first += block) {
+            asm volatile("dc zva, %0" : : "r" (first) : "memory");
+        }
+        ZeroEdge(last, size_t(end - last));
+        return;
+    }
+#endif
+    ::memset(addr, 0, size);
+}
+
+
+//----------------------------------------------------------------------------
+// Memory copy and set, NEON path.
+//----------------------------------------------------------------------------
+
+#if defined(CSR_USE_NEON)
+namespace {
+    void* NeonCopy(void* dst, const void* src, size_t size)
+    {
+        uint8_t* d = static_cast<uint8_t*>(dst);
+        const uint8_t* s = static_cast<const uint8_t*>(src);
+        for (; size >= 64; d += 64, s += 64, size -= 64) {
+            const uint8x16_t v0 = vld1q_u8(s);
+            const uint8x16_t v1 = vld1q_u8(s + 16);
+            const uint8x16_t v2 = vld1q_u8(s + 32);
+            const uint8x16_t v3 = vld1q_u8(s + 48);
+            vst1q_u8(d, v0);
+            vst1q_u8(d + 16, v1);
+            vst1q_u8(d + 32, v2);
+            vst1q_u8(d + 48, v3);
+        }
+        for (; size >= 16; d += 16, s += 16, size -= 16) {
+            vst1q_u8(d, vld1q_u8(s));
+        }
+        ::memcpy(d, s, size);
+        return dst;
+    }
+
+    void* NeonSet(void* dst, int value, size_t size)
+    {
+        uint8_t* d = static_cast<uint8_t*>(dst);
+        const uint8x16_t v = vdupq_n_u8(uint8_t(value));
+        for (; size >= 64; d += 64, size -= 64) {
+            vst1q_u8(d, v);
+            vst1q_u8(d + 16, v);
+            vst1q_u8(d + 32, v);
+            vst1q_u8(d + 48, v);
+        }
+        for (; size >= 16; d += 16, size -= 16) {
+            vst1q_u8(d, v);
+        }
+        ::memset(d, value, size);
+        return dst;
+    }
+}
+#endif
+
+
+//----------------------------------------------------------------------------
+// Memory copy and set, FEAT_MOPS path.
+// The instructions are encoded in hexadecimal with fixed registers because
+// older assemblers do not know them. Each operation is a sequence of prologue,
+// main and epilogue instructions which update the three registers.
+//----------------------------------------------------------------------------
+
+#if defined(__aarch64__)
+namespace {
+    void* MopsCopy(void* dst, const void* src, size_t size)
+    {
+        register void* x0 asm("x0") = dst;
+        register const void* x1 asm("x1") = src;
+        register size_t x2 asm("x2") = size;
+        asm volatile(".inst 0x19010440\n"   // cpyfp [x0]!, [x1]!, x2!
+                     ".inst 0x19410440\n"   // cpyfm [x0]!, [x1]!, x2!
+                     ".inst 0x19810440\n"   // cpyfe [x0]!, [x1]!, x2!
+                     : "+r" (x0), "+r" (x1), "+r" (x2) : : "cc", "memory");
+        return dst;
+    }
+
+    void* MopsSet(void* dst, int value, size_t size)
+    {
+        register void* x0 asm("x0") = dst;
+        register size_t x1 asm("x1") = size;
+        register uint64_t x2 asm("x2") = uint8_t(value);
+        asm volatile(".inst 0x19c20420\n"   // setp [x0]!, x1!, x2
+                     ".inst 0x19c24420\n"   // setm [x0]!, x1!, x2
+                     ".inst 0x19c28420\n"   // sete [x0]!, x1!, x2
+                     : "+r" (x0), "+r" (x1) : "r" (x2) : "cc", "memory");
+        return dst;
+    }
+}
+#endif
+
+
+//----------------------------------------------------------------------------
+// Runtime dispatch.
+//----------------------------------------------------------------------------
+
+FastCopyFunction GetFastCopy(FastMemPath path)
+{
+    switch (path) {
+        case FastMemPath::LIBC:
+            return ::memcpy;
+        case FastMemPath::NEON:
+#if defined(CSR_USE_NEON)
+            return NeonCopy;
+#else
+            return nullptr;
+#endif
+        case FastMemPath::MOPS:
+#if defined(__aarch64__)
+            return UserFeatures::instance().FEAT_MOPS() ? MopsCopy : nullptr;
+#else
+            return nullptr;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+FastSetFunction GetFastSet(FastMemPath path)
+{
+    switch (path) {
+        case FastMemPath::LIBC:
+            return ::memset;
+        case FastMemPath::NEON:
+#if defined(CSR_USE_NEON)
+            return NeonSet;
+#else
+            return nullptr;
+#endif
+        case FastMemPath::MOPS:
+#if defined(__aarch64__)
+            return UserFeatures::instance().FEAT_MOPS() ? MopsSet : nullptr;
+#else
+            return nullptr;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+FastMemPath FastMemBestPath()
+{
+    // Thread-safe initialization, the first time only.
+    static const FastMemPath best =
+        GetFastCopy(FastMemPath::MOPS) != nullptr ? FastMemPath::MOPS :
+        (GetFastCopy(FastMemPath::NEON) != nullptr ? FastMemPath::NEON : FastMemPath::LIBC);
+    return best;
+}
+
+const char* FastMemPathName(FastMemPath path)
+{
+    switch (path) {
+        case FastMemPath::LIBC: return "libc";
+        case FastMemPath::NEON: return "neon";
+        case FastMemPath::MOPS: return "mops";
+        default: return "unknown";
+    }
+}
+
+void* FastCopy(void* dst, const void* src, size_t size)
+{
+    static const FastCopyFunction func = GetFastCopy(FastMemBestPath());
+    return func(dst, src, size);
+}
+
+void* FastSet(void* dst, int value, size_t size)
+{
+    static const FastSetFunction func = GetFastSet(FastMemBestPath());
+    return func(dst, value, size);
+}
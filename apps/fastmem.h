@@ -0,0 +1,48 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Fast memory operations, using the Arm64 specific instructions.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include <cstddef>
+
+// Minimum size in bytes for which FastZero() uses DC ZVA. Below this size,
+// aligning on the DC ZVA block costs more than the stores it saves.
+constexpr size_t FASTZERO_THRESHOLD = 2048;
+
+// Zero memory using DC ZVA on the aligned blocks and NEON stores on the unaligned edges.
+// The block size comes from DCZID_EL0, see UserFeatures. When DC ZVA is prohibited or
+// the size is below FASTZERO_THRESHOLD, this is memset(). DC ZVA is only valid on normal
+// memory, never use FastZero() on device memory (memory-mapped I/O).
+void FastZero(void* addr, size_t size);
+
+// Implementations of the memory copy and set operations.
+enum class FastMemPath {
+    LIBC,  // memcpy() and memset() from the C library
+    NEON,  // 64-byte loops of NEON loads and stores
+    MOPS,  // FEAT_MOPS instructions CPYFP/CPYFM/CPYFE and SETP/SETM/SETE
+};
+
+// Signatures of the memory copy and set operations, same as memcpy() and memset().
+typedef void* (*FastCopyFunction)(void* dst, const void* src, size_t size);
+typedef void* (*FastSetFunction)(void* dst, int value, size_t size);
+
+// Get the implementation of a path, null pointer when it is not supported on this CPU.
+FastCopyFunction GetFastCopy(FastMemPath path);
+FastSetFunction GetFastSet(FastMemPath path);
+
+// Best supported path, MOPS, then NEON, then LIBC. Selected once at first use.
+FastMemPath FastMemBestPath();
+
+// Name of a path, e.g. "mops".
+const char* FastMemPathName(FastMemPath path);
+
+// Copy and set memory using the best supported path. Same semantics as memcpy()
+// and memset(): the areas of FastCopy() must not overlap.
+void* FastCopy(void* dst, const void* src, size_t size);
+void* FastSet(void* dst, int value, size_t size);
@@ -0,0 +1,313 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Query the CPU features of many hosts, from their collect directories or
+// binary snapshots. Also generate the FEATURES.md file in collect.
+//
+// Syntax: featuredb [options] directory|snapshot ...
+//
+//----------------------------------------------------------------------------
+
+#include "featureindex.h"
+#include "hostsnapshot.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#define SNAPSHOT_FILE    "cpusysregs-snapshot.bin"
+#define FEATURES_FILE    "cpusysregs-features.txt"
+#define REGISTERS_FILE   "cpusysregs-registers.txt"
+#define DESCRIPTION_FILE "description.txt"
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    std::vector<std::string> inputs;
+    FeatureSet with;
+    FeatureSet without;
+    bool count;
+    bool group_midr;
+    std::string markdown;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Query the CPU features of many hosts." << std::endl
+              << std::endl
+              << "Syntax: " << command << " [options] directory|snapshot ..." << std::endl
+              << std::endl
+              << "Each directory is a collect directory, with a binary snapshot " SNAPSHOT_FILE << std::endl
+              << "or a text file " FEATURES_FILE ". The CPU core name is read from " DESCRIPTION_FILE "." << std::endl
+              << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -c : only display the number of selected hosts" << std::endl
+              << "  -g : display the number of selected hosts per MIDR_EL1 value" << std::endl
+              << "  -m file : generate the Markdown table of features per CPU core (\"-\" for stdout)" << std::endl
+              << "  -q features : select hosts with these features, \"!\" before a name means absent" << std::endl
+              << std::endl
+              << "Example: " << command << " -q 'LSE2 SVE2 !BTI' hosts/*" << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    inputs(),
+    with(),
+    without(),
+    count(false),
+    group_midr(false),
+    markdown()
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-c") {
+            count = true;
+        }
+        else if (arg == "-g") {
+            group_midr = true;
+        }
+        else if (arg == "-m" && i+1 < argc) {
+            markdown = argv[++i];
+        }
+        else if (arg == "-q" && i+1 < argc) {
+            // Feature names, with or without FEAT_ prefix, separated by spaces or commas.
+            const std::string list(argv[++i]);
+            for (size_t start = 0; start < list.size(); ) {
+                const size_t end = std::min(list.find_first_of(" ,", start), list.size());
+                std::string name(list.substr(start, end - start));
+                const bool absent = !name.empty() && name[0] == '!';
+                if (absent) {
+                    name.erase(0, 1);
+                }
+                if (!name.empty()) {
+                    ArmFeature f;
+                    if (!FeatureSet::fromName(name, f) && !FeatureSet::fromName("FEAT_" + name, f)) {
+                        fatal("unknown feature " + name);
+                    }
+                    (absent ? without : with).set(f);
+                }
+                start = end + 1;
+            }
+        }
+        else if (!arg.empty() && arg[0] == '-') {
+            fatal("invalid option '" + arg + "', try --help");
+        }
+        else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty()) {
+        fatal("no input directory or snapshot, try --help");
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Load the hosts in the index.
+//----------------------------------------------------------------------------
+
+// Check if a file exists.
+bool FileExists(const std::string& path)
+{
+    return std::ifstream(path).good();
+}
+
+// Get the value of "core:" in a description file, empty if not found.
+std::string CoreName(const std::string& directory)
+{
+    std::ifstream in(directory + "/" DESCRIPTION_FILE);
+    std::string line;
+    while (std::getline(in, line)) {
+        const size_t colon = line.find(':');
+        if (colon != std::string::npos && line.compare(0, colon, "core") == 0) {
+            const size_t start = line.find_first_not_of(" \t", colon + 1);
+            const size_t end = line.find_last_not_of(" \t\r");
+            return start == std::string::npos ? std::string() : line.substr(start, end - start + 1);
+        }
+    }
+    return std::string();
+}
+
+// Load the features from a "sysregs -s" text output, as in collect directories before binary snapshots.
+bool LoadFeaturesText(const std::string& filename, FeatureSet& known, FeatureSet& present)
+{
+    std::ifstream in(filename);
+    std::string line;
+    while (std::getline(in, line)) {
+        // Format: "FEAT_xxx ........ yes"
+        const size_t end = line.find(' ');
+        ArmFeature f;
+        if (line.compare(0, 4, "FEAT") == 0 && end != std::string::npos && FeatureSet::fromName(std::string_view(line).substr(0, end), f)) {
+            known.set(f);
+            const size_t last = line.find_last_not_of(" \t\r");
+            if (last != std::string::npos && last >= 2 && line.compare(last - 2, 3, "yes") == 0) {
+                present.set(f);
+            }
+        }
+    }
+    return !known.empty();
+}
+
+// Load the MIDR_EL1 value from a "sysregs -a -v" text output, zero if not found.
+csr_u64_t LoadMIDRText(const std::string& filename)
+{
+    std::ifstream in(filename);
+    std::string line;
+    while (std::getline(in, line)) {
+        // Format: "MIDR_EL1: 0000 0000 ... - ... 0001", in binary.
+        if (line.compare(0, 10, "MIDR_EL1: ") == 0) {
+            csr_u64_t value = 0;
+            for (size_t i = 10; i < line.size(); i++) {
+                if (line[i] == '0' || line[i] == '1') {
+                    value = (value << 1) | csr_u64_t(line[i] - '0');
+                }
+            }
+            return value;
+        }
+    }
+    return 0;
+}
+
+// Load one input file or directory.
+bool LoadHost(const Options& opt, FeatureIndex& index, const std::string& input)
+{
+    FeatureIndex::Host host;
+    std::string snapshot_file(input);
+    std::string directory;
+    if (FileExists(input + "/" SNAPSHOT_FILE) || FileExists(input + "/" FEATURES_FILE)) {
+        directory = input;
+        while (directory.size() > 1 && (directory.back() == '/' || directory.back() == '\\')) {
+            directory.pop_back();
+        }
+        snapshot_file = directory + "/" SNAPSHOT_FILE;
+        host.name = directory.substr(directory.find_last_of("/\\") + 1);
+    }
+    else {
+        const size_t sep = input.find_last_of("/\\");
+        directory = sep == std::string::npos ? "." : input.substr(0, sep);
+        host.name = input;
+    }
+    host.core = CoreName(directory);
+
+    if (FileExists(snapshot_file)) {
+        HostSnapshot snapshot;
+        if (!snapshot.open(snapshot_file)) {
+            std::cerr << opt.command << ": " << snapshot.error() << std::endl;
+            return false;
+        }
+        if (!index.addHost(host, snapshot)) {
+            std::cerr << opt.command << ": no CPU feature in " << snapshot_file << std::endl;
+            return false;
+        }
+    }
+    else {
+        FeatureSet known;
+        FeatureSet present;
+        if (!LoadFeaturesText(directory + "/" FEATURES_FILE, known, present)) {
+            std::cerr << opt.command << ": no CPU feature in " << input << std::endl;
+            return false;
+        }
+        host.midr = LoadMIDRText(directory + "/" REGISTERS_FILE);
+        index.addHost(host, known, present);
+    }
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Program entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    const Options opt(argc, argv);
+    int status = EXIT_SUCCESS;
+
+    FeatureIndex index;
+    for (const auto& input : opt.inputs) {
+        if (!LoadHost(opt, index, input)) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    if (!opt.markdown.empty()) {
+        if (opt.markdown == "-") {
+            index.markdown(std::cout);
+        }
+        else {
+            std::ofstream out(opt.markdown);
+            index.markdown(out);
+            if (!out) {
+                opt.fatal("error writing " + opt.markdown);
+            }
+        }
+        if (opt.with.empty() && opt.without.empty() && !opt.count && !opt.group_midr) {
+            return status;
+        }
+    }
+
+    const FeatureIndex::Bits selection(index.select(opt.with, opt.without));
+    std::string line;
+    if (opt.count) {
+        std::cout << FeatureIndex::count(selection) << std::endl;
+    }
+    else if (opt.group_midr) {
+        for (const auto& it : index.countByMIDR(selection)) {
+            line.assign("0x");
+            AppendHexaDigits(line, it.first, 8);
+            line.append("  ");
+            AppendDecimal(line, static_cast<long long>(it.second));
+            line.append(1, '\n');
+            std::cout.write(line.data(), std::streamsize(line.size()));
+        }
+    }
+    else {
+        for (size_t i : index.hosts(selection)) {
+            const FeatureIndex::Host& host(index.host(i));
+            line.assign(host.name);
+            line.append("  0x");
+            AppendHexaDigits(line, host.midr, 8);
+            if (!host.core.empty()) {
+                line.append("  ");
+                line.append(host.core);
+            }
+            line.append(1, '\n');
+            std::cout.write(line.data(), std::streamsize(line.size()));
+        }
+    }
+    return status;
+}
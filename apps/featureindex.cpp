@@ -0,0 +1,269 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Columnar index of the CPU features of many hosts.
+//
+//----------------------------------------------------------------------------
+
+#include "featureindex.h"
+#include "strutils.h"
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define CSR_USE_NEON 1
+#endif
+
+
+//----------------------------------------------------------------------------
+// Bitwise operations on bit-vectors.
+//----------------------------------------------------------------------------
+
+namespace {
+    // Intersection of bit-vectors with the same size: dst &= src, or dst &= ~src when negate is true.
+    void AndBits(csr_u64_t* dst, const csr_u64_t* src, size_t words, bool negate)
+    {
+        size_t i = 0;
+#if defined(CSR_USE_NEON)
+        // On Linux, csr_u64_t is unsigned long long and uint64_t is unsigned long.
+        uint64_t* vdst = reinterpret_cast<uint64_t*>(dst);
+        const uint64_t* vsrc = reinterpret_cast<const uint64_t*>(src);
+        if (negate) {
+            for (; i + 4 <= words; i += 4) {
+                vst1q_u64(vdst + i, vbicq_u64(vld1q_u64(vdst + i), vld1q_u64(vsrc + i)));
+                vst1q_u64(vdst + i + 2, vbicq_u64(vld1q_u64(vdst + i + 2), vld1q_u64(vsrc + i + 2)));
+            }
+        }
+        else {
+            for (; i + 4 <= words; i += 4) {
+                vst1q_u64(vdst + i, vandq_u64(vld1q_u64(vdst + i), vld1q_u64(vsrc + i)));
+                vst1q_u64(vdst + i + 2, vandq_u64(vld1q_u64(vdst + i + 2), vld1q_u64(vsrc + i + 2)));
+            }
+        }
+#endif
+        for (; i < words; i++) {
+            dst[i] &= negate ? ~src[i] : src[i];
+        }
+    }
+
+    // Number of bits in the intersection of two bit-vectors with the same size, or in one bit-vector.
+    size_t CountBits(const csr_u64_t* bits1, const csr_u64_t* bits2, size_t words)
+    {
+        size_t count = 0;
+        size_t i = 0;
+#if defined(CSR_USE_NEON)
+        const uint64_t* v1 = reinterpret_cast<const uint64_t*>(bits1);
+        const uint64_t* v2 = reinterpret_cast<const uint64_t*>(bits2);
+        for (; i + 2 <= words; i += 2) {
+            const uint64x2_t v = bits2 == nullptr ? vld1q_u64(v1 + i) : vandq_u64(vld1q_u64(v1 + i), vld1q_u64(v2 + i));
+            count += vaddlvq_u8(vcntq_u8(vreinterpretq_u8_u64(v)));
+        }
+#endif
+        for (; i < words; i++) {
+            for (csr_u64_t w = bits2 == nullptr ? bits1[i] : bits1[i] & bits2[i]; w != 0; w &= w - 1) {
+                count++;
+            }
+        }
+        return count;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Constructor.
+//----------------------------------------------------------------------------
+
+FeatureIndex::FeatureIndex() :
+    _hosts(),
+    _present(size_t(ArmFeature::Count)),
+    _known(size_t(ArmFeature::Count)),
+    _midr()
+{
+}
+
+void FeatureIndex::setBit(Bits& bits, size_t index)
+{
+    if (index / 64 >= bits.size()) {
+        bits.resize(index / 64 + 1, 0);
+    }
+    bits[index / 64] |= csr_u64_t(1) << (index % 64);
+}
+
+
+//----------------------------------------------------------------------------
+// Add hosts.
+//----------------------------------------------------------------------------
+
+void FeatureIndex::addHost(const Host& host, const FeatureSet& known, const FeatureSet& present)
+{
+    const size_t index = _hosts.size();
+    _hosts.push_back(host);
+
+    // All bit-vectors keep the same size, one bit per host.
+    const size_t words = (_hosts.size() + 63) / 64;
+    for (size_t f = 0; f < size_t(ArmFeature::Count); f++) {
+        _present[f].resize(words, 0);
+        _known[f].resize(words, 0);
+        if (known.has(ArmFeature(f))) {
+            setBit(_known[f], index);
+            if (present.has(ArmFeature(f))) {
+                setBit(_present[f], index);
+            }
+        }
+    }
+    setBit(_midr[host.midr], index);
+}
+
+bool FeatureIndex::addHost(const Host& host, const HostSnapshot& snapshot)
+{
+    Host desc(host);
+    FeatureSet known;
+    FeatureSet present;
+    ArmFeature f;
+    for (const auto& rec : snapshot.records()) {
+        if (rec.type == REGRECORD_FEATURE && rec.cpu < 0 && FeatureSet::fromName(RegRecordWriter::name(rec), f)) {
+            known.set(f);
+            if (rec.low != 0) {
+                present.set(f);
+            }
+        }
+    }
+    const RegRecord* midr = snapshot.find(REGRECORD_REGISTER, "MIDR_EL1");
+    if (midr != nullptr && midr->status == 0) {
+        desc.midr = midr->low;
+    }
+    if (known.empty()) {
+        return false;
+    }
+    addHost(desc, known, present);
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Queries and aggregates.
+//----------------------------------------------------------------------------
+
+FeatureIndex::Bits FeatureIndex::select(const FeatureSet& with, const FeatureSet& without) const
+{
+    // Start with all hosts.
+    const size_t words = (_hosts.size() + 63) / 64;
+    Bits result(words, ~csr_u64_t(0));
+    if (_hosts.size() % 64 != 0) {
+        result[words - 1] = (csr_u64_t(1) << (_hosts.size() % 64)) - 1;
+    }
+    for (size_t f = 0; f < size_t(ArmFeature::Count); f++) {
+        if (with.has(ArmFeature(f))) {
+            AndBits(result.data(), _present[f].data(), words, false);
+        }
+        if (without.has(ArmFeature(f))) {
+            AndBits(result.data(), _present[f].data(), words, true);
+        }
+    }
+    return result;
+}
+
+size_t FeatureIndex::count(const Bits& selection)
+{
+    return CountBits(selection.data(), nullptr, selection.size());
+}
+
+std::vector<size_t> FeatureIndex::hosts(const Bits& selection) const
+{
+    std::vector<size_t> result;
+    result.reserve(count(selection));
+    for (size_t i = 0; i < selection.size(); i++) {
+        for (csr_u64_t w = selection[i]; w != 0; w &= w - 1) {
+            size_t bit = 0;
+            while (((w >> bit) & 1) == 0) {
+                bit++;
+            }
+            result.push_back(64 * i + bit);
+        }
+    }
+    return result;
+}
+
+std::map<csr_u64_t, size_t> FeatureIndex::countByMIDR(const Bits& selection) const
+{
+    std::map<csr_u64_t, size_t> result;
+    for (const auto& it : _midr) {
+        const size_t count = CountBits(selection.data(), it.second.data(), std::min(selection.size(), it.second.size()));
+        if (count > 0) {
+            result[it.first] = count;
+        }
+    }
+    return result;
+}
+
+
+//----------------------------------------------------------------------------
+// Generate the Markdown table of features per CPU core.
+//----------------------------------------------------------------------------
+
+void FeatureIndex::markdown(std::ostream& out) const
+{
+    // One host per core name, sorted by core name.
+    std::map<std::string, size_t> cores;
+    for (size_t i = 0; i < _hosts.size(); i++) {
+        if (!_hosts[i].core.empty()) {
+            cores.insert(std::make_pair(_hosts[i].core, i));
+        }
+    }
+
+    // Features which are known in at least one of these hosts, sorted by case-insensitive names.
+    std::vector<ArmFeature> ids;
+    for (size_t f = 0; f < size_t(ArmFeature::Count); f++) {
+        for (const auto& it : cores) {
+            if (isKnown(it.second, ArmFeature(f))) {
+                ids.push_back(ArmFeature(f));
+                break;
+            }
+        }
+    }
+    std::sort(ids.begin(), ids.end(), [](ArmFeature f1, ArmFeature f2) {
+        return ToLower(std::string(FeatureSet::name(f1))) < ToLower(std::string(FeatureSet::name(f2)));
+    });
+
+    const std::string title("Feature");
+    size_t width = title.length();
+    for (auto f : ids) {
+        width = std::max(width, FeatureSet::name(f).length());
+    }
+
+    std::string line;
+    line.append("| ");
+    AppendPad(line, title, width, ' ');
+    line.append(" |");
+    for (const auto& it : cores) {
+        line.append(1, ' ');
+        line.append(it.first);
+        line.append(" |");
+    }
+    line.append("\n| ");
+    line.append(width, '-');
+    line.append(" |");
+    for (const auto& it : cores) {
+        line.append(" :");
+        line.append(it.first.length() > 2 ? it.first.length() - 2 : 0, '-');
+        line.append(": |");
+    }
+    line.append(1, '\n');
+    out.write(line.data(), std::streamsize(line.size()));
+
+    for (auto f : ids) {
+        line.assign("| ");
+        AppendPad(line, FeatureSet::name(f), width, ' ');
+        line.append(" |");
+        for (const auto& it : cores) {
+            line.append(1, ' ');
+            AppendPad(line, isKnown(it.second, f) ? (has(it.second, f) ? "yes" : "no") : "", it.first.length(), ' ');
+            line.append(" |");
+        }
+        line.append(1, '\n');
+        out.write(line.data(), std::streamsize(line.size()));
+    }
+}
@@ -0,0 +1,77 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Columnar index of the CPU features of many hosts.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "armfeatures.h"
+#include "hostsnapshot.h"
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//
+// The index contains one bit-vector per feature, with one bit per host.
+// Queries and aggregates are bitwise operations on these bit-vectors.
+//
+// Each feature has two bit-vectors: "known" when the host reported the feature,
+// present or not, and "present". A host which was collected with another version
+// of the tools may not know all features. In queries, unknown features are absent.
+//
+class FeatureIndex
+{
+public:
+    // A bit-vector, one bit per host, in host order.
+    typedef std::vector<csr_u64_t> Bits;
+
+    // Description of one host.
+    struct Host {
+        std::string name;      // host name, typically the collect directory
+        std::string core;      // CPU core name, from description.txt, can be empty
+        csr_u64_t   midr = 0;  // MIDR_EL1 value, zero if unknown
+    };
+
+    // Constructor: an empty index.
+    FeatureIndex();
+
+    // Add a host with explicit feature sets. Features which are not in 'known' are unknown.
+    void addHost(const Host& host, const FeatureSet& known, const FeatureSet& present);
+
+    // Add a host from a snapshot. The MIDR_EL1 value is taken from the snapshot, when present.
+    // Return false if the snapshot contains no CPU feature.
+    bool addHost(const Host& host, const HostSnapshot& snapshot);
+
+    // Access the hosts.
+    size_t hostCount() const { return _hosts.size(); }
+    const Host& host(size_t index) const { return _hosts[index]; }
+    bool has(size_t index, ArmFeature f) const { return testBit(_present[size_t(f)], index); }
+    bool isKnown(size_t index, ArmFeature f) const { return testBit(_known[size_t(f)], index); }
+
+    // Select the hosts where all features of 'with' are present and all features of 'without' are absent.
+    Bits select(const FeatureSet& with, const FeatureSet& without = FeatureSet()) const;
+
+    // Aggregates on a selection of hosts.
+    static size_t count(const Bits& selection);
+    std::vector<size_t> hosts(const Bits& selection) const;
+    std::map<csr_u64_t, size_t> countByMIDR(const Bits& selection) const;
+
+    // Generate the Markdown table of features per CPU core (the FEATURES.md file in collect).
+    // There is one column per distinct core name, using the first host with that core.
+    void markdown(std::ostream& out) const;
+
+private:
+    std::vector<Host>         _hosts;
+    std::vector<Bits>         _present;  // indexed by ArmFeature
+    std::vector<Bits>         _known;    // indexed by ArmFeature
+    std::map<csr_u64_t, Bits> _midr;     // hosts with each MIDR_EL1 value
+
+    // Bits in a bit-vector.
+    static bool testBit(const Bits& bits, size_t index) { return index / 64 < bits.size() && ((bits[index / 64] >> (index % 64)) & 1) != 0; }
+    static void setBit(Bits& bits, size_t index);
+};
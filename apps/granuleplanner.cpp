@@ -0,0 +1,203 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Translation granule and TLB reach planner, from the stage 1 walk parameters.
+//
+//----------------------------------------------------------------------------
+
+#include "granuleplanner.h"
+#include "strutils.h"
+#include <algorithm>
+
+
+//----------------------------------------------------------------------------
+// Constructor.
+//----------------------------------------------------------------------------
+
+GranulePlanner::GranulePlanner(ArmPseudoCode& code, const ArmFeatures& features) :
+    _code(code),
+    _feat(features)
+{
+}
+
+
+//----------------------------------------------------------------------------
+// Supported granules.
+//----------------------------------------------------------------------------
+
+bool GranulePlanner::supported(TGx tgx) const
+{
+    switch (tgx) {
+        case ArmPseudoCode::TGx_4KB:  return _feat.ID_AA64MMFR0_EL1_TGran4() != 0x0F;
+        case ArmPseudoCode::TGx_16KB: return _feat.ID_AA64MMFR0_EL1_TGran16() != 0x00;
+        case ArmPseudoCode::TGx_64KB: return _feat.ID_AA64MMFR0_EL1_TGran64() != 0x0F;
+        default:                      return false;
+    }
+}
+
+bool GranulePlanner::supportsDS(TGx tgx) const
+{
+    switch (tgx) {
+        case ArmPseudoCode::TGx_4KB:  return _feat.ID_AA64MMFR0_EL1_TGran4() == 0x01;
+        case ArmPseudoCode::TGx_16KB: return _feat.ID_AA64MMFR0_EL1_TGran16() == 0x02;
+        default:                      return false;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Geometry of a translation table walk.
+//----------------------------------------------------------------------------
+
+GranulePlanner::Walk GranulePlanner::walk(VARange varange)
+{
+    // Any address in the range selects the walk parameters (bit 55).
+    ArmPseudoCode::S1TTWParams params;
+    _code.AArch64_GetS1TTWParams(params, varange == ArmPseudoCode::VARange_UPPER ? ~csr_u64_t(0) : 0);
+    return walk(params.tgx, _code.AArch64_PACEffectiveTxSZ(params), params.ds, params.d128, params.hpd);
+}
+
+GranulePlanner::Walk GranulePlanner::walk(TGx tgx, int txsz, bool ds, bool d128, bool hpd)
+{
+    Walk w;
+    w.tgx = tgx;
+    w.granule_bits = _code.TGxGranuleBits(tgx);
+    w.ds = ds && supportsDS(tgx);
+    w.d128 = d128 && _feat.FEAT_D128();
+    w.hpd = hpd;
+
+    // Same limits as the live configuration, out-of-range values are clamped.
+    w.txsz = std::clamp(txsz, _code.AArch64_S1MinTxSZ(w.d128, w.ds, tgx), _code.AArch64_MaxTxSZ(tgx));
+    w.input_bits = 64 - w.txsz;
+
+    // Each level resolves as many address bits as a table has entries: 8-byte or 16-byte descriptors.
+    const int stride = w.granule_bits - (w.d128 ? 4 : 3);
+    const int count = std::max(1, (w.input_bits - w.granule_bits + stride - 1) / stride);
+    const int start = std::max(-1, 4 - count);
+
+    for (int level = start; level <= 3; level++) {
+        Level lv;
+        lv.level = level;
+        const int size_bits = w.granule_bits + stride * (3 - level);
+        lv.size = csr_u64_t(1) << size_bits;
+        lv.entries = csr_u64_t(1) << (level == start ? std::max(0, w.input_bits - size_bits) : stride);
+
+        // Block and page descriptors, see "Translation table descriptor formats" in the Arm ARM.
+        switch (level) {
+            case 3:
+            case 2:
+                lv.leaf = true;
+                break;
+            case 1:
+                lv.leaf = tgx == ArmPseudoCode::TGx_4KB || (tgx == ArmPseudoCode::TGx_16KB && w.ds) || (tgx == ArmPseudoCode::TGx_64KB && _feat.FEAT_LPA());
+                break;
+            case 0:
+                lv.leaf = tgx == ArmPseudoCode::TGx_4KB && w.ds;
+                break;
+            default:
+                lv.leaf = false;
+                break;
+        }
+
+        // Number of entries in a range of the contiguous bit, see "The Contiguous bit" in the Arm ARM.
+        if (lv.leaf) {
+            switch (tgx) {
+                case ArmPseudoCode::TGx_4KB:  lv.contiguous = level >= 1 ? 16 : 0; break;
+                case ArmPseudoCode::TGx_16KB: lv.contiguous = level == 3 ? 128 : (level == 2 ? 32 : 0); break;
+                case ArmPseudoCode::TGx_64KB: lv.contiguous = level >= 2 ? 32 : 0; break;
+                default: break;
+            }
+        }
+        w.levels.push_back(lv);
+    }
+    return w;
+}
+
+
+//----------------------------------------------------------------------------
+// Mapping sizes and their cost for a working set.
+//----------------------------------------------------------------------------
+
+std::vector<GranulePlanner::Mapping> GranulePlanner::mappings(const Walk& walk)
+{
+    std::vector<Mapping> maps;
+    for (const auto& lv : walk.levels) {
+        if (lv.leaf) {
+            Mapping m;
+            m.level = lv.level;
+            m.size = lv.size;
+            maps.push_back(m);
+            if (lv.contiguous > 1) {
+                m.entries = lv.contiguous;
+                m.size = lv.size * lv.contiguous;
+                maps.push_back(m);
+            }
+        }
+    }
+    std::stable_sort(maps.begin(), maps.end(), [](const Mapping& a, const Mapping& b) { return a.size < b.size; });
+    return maps;
+}
+
+std::vector<GranulePlanner::Plan> GranulePlanner::plan(const Walk& walk, csr_u64_t working_set)
+{
+    std::vector<Plan> plans;
+    for (const auto& m : mappings(walk)) {
+        Plan p;
+        p.mapping = m;
+        p.tlb_entries = (working_set + m.size - 1) / m.size;
+        p.waste = p.tlb_entries * m.size - working_set;
+        plans.push_back(p);
+    }
+    return plans;
+}
+
+size_t GranulePlanner::recommend(const std::vector<Plan>& plans, csr_u64_t working_set)
+{
+    size_t best = 0;
+    for (size_t i = 0; i < plans.size(); i++) {
+        if (plans[i].tlb_entries > 0 && plans[i].waste <= working_set / MAX_WASTE_DIVISOR) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+
+//----------------------------------------------------------------------------
+// Text descriptions.
+//----------------------------------------------------------------------------
+
+std::string GranulePlanner::granuleName(TGx tgx)
+{
+    switch (tgx) {
+        case ArmPseudoCode::TGx_4KB:  return "4 KB";
+        case ArmPseudoCode::TGx_16KB: return "16 KB";
+        case ArmPseudoCode::TGx_64KB: return "64 KB";
+        default:                      return "unknown";
+    }
+}
+
+std::string GranulePlanner::sizeString(csr_u64_t size)
+{
+    static const char* const units[] = {"bytes", "KB", "MB", "GB", "TB", "PB", "EB"};
+    size_t unit = 0;
+    while (size >= 1024 && size % 1024 == 0 && unit + 1 < sizeof(units) / sizeof(units[0])) {
+        size /= 1024;
+        unit++;
+    }
+    return Format("%llu %s", (unsigned long long)size, units[unit]);
+}
+
+std::string GranulePlanner::Mapping::toString() const
+{
+    const char* const kind = level == 3 ? "page" : "block";
+    if (entries > 1) {
+        return Format("%s = %zu x %s contiguous %ss (level %d)", sizeString(size).c_str(), entries, sizeString(size / entries).c_str(), kind, level);
+    }
+    else {
+        return Format("%s %s (level %d)", sizeString(size).c_str(), kind, level);
+    }
+}
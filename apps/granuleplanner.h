@@ -0,0 +1,119 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Translation granule and TLB reach planner, from the stage 1 walk parameters.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "armpseudocode.h"
+#include <string>
+#include <vector>
+
+//
+// Translation granule and TLB reach planner.
+//
+// From the stage 1 walk parameters of the EL1&0 regime (TCR_EL1, as decoded by ArmPseudoCode)
+// and the supported granules (ID_AA64MMFR0_EL1), compute the levels of a translation table walk,
+// the size of the block or page at each level and the ranges of the contiguous bit. Each possible
+// mapping size is the memory which is covered by one TLB entry. For a given working set, the
+// planner computes the number of TLB entries and the wasted memory with each mapping size.
+//
+// The architecture does not expose the number of TLB entries, the TLB reach is computed
+// for a number of entries which is specified by the caller.
+//
+class GranulePlanner
+{
+public:
+    using TGx = ArmPseudoCode::TGx;
+    using VARange = ArmPseudoCode::VARange;
+
+    // Description of one level of a translation table walk.
+    struct Level {
+        int       level = 0;       // -1 to 3
+        csr_u64_t size = 0;        // memory mapped by one entry at this level, in bytes
+        csr_u64_t entries = 0;     // number of entries in one table at this level
+        bool      leaf = false;    // a block or page descriptor is allowed at this level
+        size_t    contiguous = 0;  // number of entries in a contiguous range, zero if not allowed
+    };
+
+    // Geometry of a translation table walk.
+    struct Walk {
+        TGx    tgx = ArmPseudoCode::TGx_4KB;
+        int    granule_bits = 0;   // 12, 14 or 16
+        int    txsz = 0;           // effective TxSZ
+        int    input_bits = 0;     // input address size, 64 - TxSZ
+        bool   ds = false;         // 52-bit addresses with 4 KB and 16 KB granules (FEAT_LPA2)
+        bool   d128 = false;       // 128-bit descriptors (FEAT_D128)
+        bool   hpd = false;        // hierarchical permissions disabled (FEAT_HPDS)
+        std::vector<Level> levels; // from the start level to level 3
+
+        // Start level of the walk and number of levels.
+        int startLevel() const { return levels.empty() ? 0 : levels.front().level; }
+        size_t levelCount() const { return levels.size(); }
+    };
+
+    // A possible mapping size, the memory which is covered by one TLB entry.
+    struct Mapping {
+        csr_u64_t size = 0;        // in bytes, also the required alignment of virtual and physical addresses
+        int       level = 0;       // level of the block or page descriptors
+        size_t    entries = 1;     // number of descriptors, more than one with the contiguous bit
+
+        bool contiguous() const { return entries > 1; }
+
+        // Description, e.g. "2 MB block (level 2)", "64 KB = 16 x 4 KB contiguous pages (level 3)"
+        std::string toString() const;
+    };
+
+    // Cost of mapping a working set with a given mapping size.
+    struct Plan {
+        Mapping   mapping;
+        csr_u64_t tlb_entries = 0; // number of TLB entries to cover the working set
+        csr_u64_t waste = 0;       // memory which is mapped beyond the working set, in bytes
+    };
+
+    // Maximum wasted memory in recommend(), as a fraction of the working set: 1/8.
+    static constexpr csr_u64_t MAX_WASTE_DIVISOR = 8;
+
+    // Constructor.
+    GranulePlanner(ArmPseudoCode& code, const ArmFeatures& features);
+
+    // Check if a translation granule is supported by the CPU (ID_AA64MMFR0_EL1.TGranX).
+    bool supported(TGx tgx) const;
+
+    // Check if 52-bit addresses (TCR_EL1.DS) are supported with a translation granule (FEAT_LPA2).
+    bool supportsDS(TGx tgx) const;
+
+    // Walk of the live configuration for a virtual address range, as set by the operating system.
+    Walk walk(VARange varange);
+
+    // Walk of a chosen configuration, using the same rules as the live configuration.
+    Walk walk(TGx tgx, int txsz, bool ds = false, bool d128 = false, bool hpd = false);
+
+    // All mapping sizes of a walk, by increasing size.
+    static std::vector<Mapping> mappings(const Walk& walk);
+
+    // Cost of mapping a working set with each mapping size of a walk, by increasing size.
+    static std::vector<Plan> plan(const Walk& walk, csr_u64_t working_set);
+
+    // Index of the recommended plan: the largest mapping size which wastes at most
+    // 1/MAX_WASTE_DIVISOR of the working set. This is the alignment and the granularity
+    // of huge pages or arenas. Return zero (the base page) if none is better.
+    static size_t recommend(const std::vector<Plan>& plans, csr_u64_t working_set);
+
+    // Memory which is covered by a number of TLB entries of a given mapping size.
+    static csr_u64_t tlbReach(const Mapping& mapping, csr_u64_t tlb_entries) { return mapping.size * tlb_entries; }
+
+    // Name of a granule, e.g. "4 KB".
+    static std::string granuleName(TGx tgx);
+
+    // Format a size in bytes with the largest exact unit, e.g. "2 MB", "48 KB".
+    static std::string sizeString(csr_u64_t size);
+
+private:
+    ArmPseudoCode&     _code;
+    const ArmFeatures& _feat;
+};
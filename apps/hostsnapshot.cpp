@@ -0,0 +1,159 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Read-only access to a binary snapshot of a host.
+//
+//----------------------------------------------------------------------------
+
+#include "hostsnapshot.h"
+#include "strutils.h"
+#include <algorithm>
+#include <cerrno>
+
+#if defined(__linux__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+
+//----------------------------------------------------------------------------
+// Map a snapshot file.
+//----------------------------------------------------------------------------
+
+bool HostSnapshot::open(const std::string& filename)
+{
+    close();
+    _error.clear();
+
+#if defined(__linux__) || defined(__APPLE__)
+
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) < 0) {
+        _error = filename + ": " + Error(errno);
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return false;
+    }
+    _size = size_t(st.st_size);
+    if (_size > 0) {
+        _base = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (_base == MAP_FAILED) {
+            _error = filename + ": " + Error(errno);
+            _base = nullptr;
+            _size = 0;
+        }
+    }
+    ::close(fd);
+
+#elif defined(WINDOWS)
+
+    const ::HANDLE file = ::CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    ::LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE || !::GetFileSizeEx(file, &size)) {
+        _error = filename + ": " + Error(int(::GetLastError()));
+        if (file != INVALID_HANDLE_VALUE) {
+            ::CloseHandle(file);
+        }
+        return false;
+    }
+    _size = size_t(size.QuadPart);
+    if (_size > 0) {
+        _mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        _base = _mapping == nullptr ? nullptr : ::MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+        if (_base == nullptr) {
+            _error = filename + ": " + Error(int(::GetLastError()));
+            _size = 0;
+        }
+    }
+    ::CloseHandle(file);
+
+#endif
+
+    if (!_error.empty()) {
+        close();
+        return false;
+    }
+    if (!RegRecordWriter::records(_base, _size, _records)) {
+        _error = filename + ": not a valid snapshot file";
+        close();
+        return false;
+    }
+
+    // Build the sorted index of records and count CPU cores.
+    _index.resize(_records.size());
+    for (size_t i = 0; i < _index.size(); i++) {
+        _index[i] = uint32_t(i);
+        _cpu_count = std::max(_cpu_count, _records[i].cpu + 1);
+    }
+    std::sort(_index.begin(), _index.end(), [this](uint32_t i1, uint32_t i2) {
+        const RegRecord& r2(_records[i2]);
+        return lessThan(_records[i1], r2.type, RegRecordWriter::name(r2), r2.cpu);
+    });
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Unmap the snapshot file.
+//----------------------------------------------------------------------------
+
+void HostSnapshot::close()
+{
+#if defined(__linux__) || defined(__APPLE__)
+    if (_base != nullptr) {
+        ::munmap(_base, _size);
+    }
+#elif defined(WINDOWS)
+    if (_base != nullptr) {
+        ::UnmapViewOfFile(_base);
+    }
+    if (_mapping != nullptr) {
+        ::CloseHandle(_mapping);
+        _mapping = nullptr;
+    }
+#endif
+    _base = nullptr;
+    _size = 0;
+    _records = Span<RegRecord>();
+    _index.clear();
+    _cpu_count = 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Find a record.
+//----------------------------------------------------------------------------
+
+bool HostSnapshot::lessThan(const RegRecord& rec, uint16_t type, std::string_view name, int32_t cpu)
+{
+    if (rec.type != type) {
+        return rec.type < type;
+    }
+    else if (rec.cpu != cpu) {
+        return rec.cpu < cpu;
+    }
+    else {
+        return RegRecordWriter::name(rec) < name;
+    }
+}
+
+const RegRecord* HostSnapshot::find(uint16_t type, std::string_view name, int32_t cpu) const
+{
+    const auto it = std::lower_bound(_index.begin(), _index.end(), 0, [this, type, name, cpu](uint32_t i, int) {
+        return lessThan(_records[i], type, name, cpu);
+    });
+    if (it != _index.end()) {
+        const RegRecord& rec(_records[*it]);
+        if (rec.type == type && rec.cpu == cpu && RegRecordWriter::name(rec) == name) {
+            return &rec;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,75 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Read-only access to a binary snapshot of a host.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "regrecord.h"
+#include "span.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+//
+// A host snapshot is a binary record stream (see RegRecordWriter), typically
+// cpusysregs-snapshot.bin as created by "collect -o". It contains all readable
+// registers (cpu -1), the same registers on each CPU core (cpu 0 to N-1, when
+// supported by the system), the CPU features, the user-mode features and the PAC
+// geometry. A binary output of "sysregs --binary" is also a valid host snapshot.
+//
+// The file is memory-mapped and the records are directly used from the mapped
+// memory, without copy. Only a sorted index of the records is built in memory.
+//
+// Records are searched by name, not by index: the CSR_REGID_ and ArmFeature
+// values are not stable across versions of the tools while names are.
+//
+class HostSnapshot
+{
+public:
+    // Constructor and destructor.
+    HostSnapshot() = default;
+    ~HostSnapshot() { close(); }
+
+    // Map a snapshot file. Return false on error, see error().
+    bool open(const std::string& filename);
+
+    // Unmap the snapshot file.
+    void close();
+
+    // Get the error message of the last open().
+    const std::string& error() const { return _error; }
+
+    // Get all records, in file order.
+    Span<RegRecord> records() const { return _records; }
+
+    // Find a record by name, return a null pointer if not found.
+    const RegRecord* find(uint16_t type, std::string_view name, int32_t cpu = -1) const;
+
+    // Number of CPU cores in the per-core tables, zero if there is no per-core table.
+    int cpuCount() const { return _cpu_count; }
+
+    // Forbid copy (the mapped memory is owned by the instance).
+    HostSnapshot(HostSnapshot&&) = delete;
+    HostSnapshot(const HostSnapshot&) = delete;
+    HostSnapshot& operator=(HostSnapshot&&) = delete;
+    HostSnapshot& operator=(const HostSnapshot&) = delete;
+
+private:
+    void*                 _base = nullptr;  // mapped file
+    size_t                _size = 0;        // mapped size
+    Span<RegRecord>       _records {};      // all records in mapped file
+    std::vector<uint32_t> _index {};        // indexes in _records, sorted by type, cpu, name
+    int                   _cpu_count = 0;
+    std::string           _error {};
+#if defined(WINDOWS)
+    ::HANDLE              _mapping = nullptr;
+#endif
+
+    // Record ordering in the index.
+    static bool lessThan(const RegRecord& rec, uint16_t type, std::string_view name, int32_t cpu);
+};
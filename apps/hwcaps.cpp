@@ -0,0 +1,207 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Linux hardware capabilities from the auxiliary vector, as a FeatureSet.
+//
+//----------------------------------------------------------------------------
+
+#include "hwcaps.h"
+#include <algorithm>
+
+#if defined(__linux__)
+    #include <sys/auxv.h>
+    // Not defined in older system headers.
+    #if !defined(AT_HWCAP3)
+        #define AT_HWCAP3 29
+    #endif
+#endif
+
+
+//----------------------------------------------------------------------------
+// Table of known hardware capabilities, sorted by name.
+// The bit indexes are part of the Linux kernel ABI (arch/arm64/include/uapi/asm/hwcap.h),
+// they do not depend on the version of the system headers on the build system.
+//----------------------------------------------------------------------------
+
+namespace {
+    constexpr Hwcaps::Cap AllCaps[] = {
+        {"AES",            0,  3, ArmFeature::FEAT_AES},
+        {"AFP",            1, 20, ArmFeature::FEAT_AFP},
+        {"ASIMD",          0,  1, ArmFeature::FEAT_AdvSIMD},
+        {"ASIMDDP",        0, 20, ArmFeature::FEAT_DotProd},
+        {"ASIMDFHM",       0, 23, ArmFeature::FEAT_FHM},
+        {"ASIMDHP",        0, 10, ArmFeature::Count},
+        {"ASIMDRDM",       0, 12, ArmFeature::FEAT_RDM},
+        {"ATOMICS",        0,  8, ArmFeature::FEAT_LSE},
+        {"BF16",           1, 14, ArmFeature::FEAT_BF16},
+        {"BTI",            1, 17, ArmFeature::FEAT_BTI},
+        {"CPUID",          0, 11, ArmFeature::Count},
+        {"CRC32",          0,  7, ArmFeature::FEAT_CRC32},
+        {"CSSC",           1, 34, ArmFeature::FEAT_CSSC},
+        {"DCPODP",         1,  0, ArmFeature::FEAT_DPB2},
+        {"DCPOP",          0, 16, ArmFeature::FEAT_DPB},
+        {"DGH",            1, 15, ArmFeature::FEAT_DGH},
+        {"DIT",            0, 24, ArmFeature::FEAT_DIT},
+        {"EBF16",          1, 32, ArmFeature::FEAT_EBF16},
+        {"ECV",            1, 19, ArmFeature::FEAT_ECV},
+        {"EVTSTRM",        0,  2, ArmFeature::Count},
+        {"F8CVT",          1, 51, ArmFeature::Count},
+        {"F8DP2",          1, 54, ArmFeature::Count},
+        {"F8DP4",          1, 53, ArmFeature::Count},
+        {"F8E4M3",         1, 55, ArmFeature::Count},
+        {"F8E5M2",         1, 56, ArmFeature::Count},
+        {"F8FMA",          1, 52, ArmFeature::Count},
+        {"FAMINMAX",       1, 50, ArmFeature::Count},
+        {"FCMA",           0, 14, ArmFeature::FEAT_FCMA},
+        {"FLAGM",          0, 27, ArmFeature::FEAT_FlagM},
+        {"FLAGM2",         1,  7, ArmFeature::FEAT_FlagM2},
+        {"FP",             0,  0, ArmFeature::FEAT_FP},
+        {"FPHP",           0,  9, ArmFeature::FEAT_FP16},
+        {"FPMR",           1, 48, ArmFeature::Count},
+        {"FRINT",          1,  8, ArmFeature::FEAT_FRINTTS},
+        {"GCS",            0, 32, ArmFeature::FEAT_GCS},
+        {"HBC",            1, 44, ArmFeature::FEAT_HBC},
+        {"I8MM",           1, 13, ArmFeature::FEAT_I8MM},
+        {"ILRCPC",         0, 26, ArmFeature::FEAT_LRCPC2},
+        {"JSCVT",          0, 13, ArmFeature::FEAT_JSCVT},
+        {"LRCPC",          0, 15, ArmFeature::FEAT_LRCPC},
+        {"LRCPC3",         1, 46, ArmFeature::FEAT_LRCPC3},
+        {"LSE128",         1, 47, ArmFeature::FEAT_LSE128},
+        {"LUT",            1, 49, ArmFeature::Count},
+        {"MOPS",           1, 43, ArmFeature::FEAT_MOPS},
+        {"MTE",            1, 18, ArmFeature::FEAT_MTE2},
+        {"MTE3",           1, 22, ArmFeature::FEAT_MTE3},
+        {"MTE_FAR",        2,  0, ArmFeature::FEAT_MTE_TAGGED_FAR},
+        {"MTE_STORE_ONLY", 2,  1, ArmFeature::FEAT_MTE_STORE_ONLY},
+        {"PACA",           0, 30, ArmFeature::FEAT_PAuth},
+        {"PACG",           0, 31, ArmFeature::Count},
+        {"PMULL",          0,  4, ArmFeature::FEAT_PMULL},
+        {"POE",            1, 63, ArmFeature::FEAT_S1POE},
+        {"RNG",            1, 16, ArmFeature::FEAT_RNG},
+        {"RPRES",          1, 21, ArmFeature::FEAT_RPRES},
+        {"RPRFM",          1, 35, ArmFeature::FEAT_RPRFM},
+        {"SB",             0, 29, ArmFeature::FEAT_SB},
+        {"SHA1",           0,  5, ArmFeature::FEAT_SHA1},
+        {"SHA2",           0,  6, ArmFeature::FEAT_SHA256},
+        {"SHA3",           0, 17, ArmFeature::FEAT_SHA3},
+        {"SHA512",         0, 21, ArmFeature::FEAT_SHA512},
+        {"SM3",            0, 18, ArmFeature::FEAT_SM3},
+        {"SM4",            0, 19, ArmFeature::FEAT_SM4},
+        {"SME",            1, 23, ArmFeature::FEAT_SME},
+        {"SME2",           1, 37, ArmFeature::FEAT_SME2},
+        {"SME2P1",         1, 38, ArmFeature::FEAT_SME2p1},
+        {"SME_B16B16",     1, 41, ArmFeature::Count},
+        {"SME_B16F32",     1, 28, ArmFeature::Count},
+        {"SME_BI32I32",    1, 40, ArmFeature::Count},
+        {"SME_F16F16",     1, 42, ArmFeature::FEAT_SME_F16F16},
+        {"SME_F16F32",     1, 27, ArmFeature::Count},
+        {"SME_F32F32",     1, 29, ArmFeature::Count},
+        {"SME_F64F64",     1, 25, ArmFeature::FEAT_SME_F64F64},
+        {"SME_F8F16",      1, 58, ArmFeature::Count},
+        {"SME_F8F32",      1, 59, ArmFeature::Count},
+        {"SME_FA64",       1, 30, ArmFeature::FEAT_SME_FA64},
+        {"SME_I16I32",     1, 39, ArmFeature::Count},
+        {"SME_I16I64",     1, 24, ArmFeature::FEAT_SME_I16I64},
+        {"SME_I8I32",      1, 26, ArmFeature::Count},
+        {"SME_LUTV2",      1, 57, ArmFeature::Count},
+        {"SME_SF8DP2",     1, 62, ArmFeature::Count},
+        {"SME_SF8DP4",     1, 61, ArmFeature::Count},
+        {"SME_SF8FMA",     1, 60, ArmFeature::Count},
+        {"SSBS",           0, 28, ArmFeature::FEAT_SSBS},
+        {"SVE",            0, 22, ArmFeature::FEAT_SVE},
+        {"SVE2",           1,  1, ArmFeature::FEAT_SVE2},
+        {"SVE2P1",         1, 36, ArmFeature::FEAT_SVE2p1},
+        {"SVEAES",         1,  2, ArmFeature::FEAT_SVE_AES},
+        {"SVEBF16",        1, 12, ArmFeature::Count},
+        {"SVEBITPERM",     1,  4, ArmFeature::FEAT_SVE_BitPerm},
+        {"SVEF32MM",       1, 10, ArmFeature::FEAT_F32MM},
+        {"SVEF64MM",       1, 11, ArmFeature::FEAT_F64MM},
+        {"SVEI8MM",        1,  9, ArmFeature::Count},
+        {"SVEPMULL",       1,  3, ArmFeature::FEAT_SVE_PMULL128},
+        {"SVESHA3",        1,  5, ArmFeature::FEAT_SVE_SHA3},
+        {"SVESM4",         1,  6, ArmFeature::FEAT_SVE_SM4},
+        {"SVE_B16B16",     1, 45, ArmFeature::FEAT_B16B16},
+        {"SVE_EBF16",      1, 33, ArmFeature::Count},
+        {"USCAT",          0, 25, ArmFeature::FEAT_LSE2},
+        {"WFXT",           1, 31, ArmFeature::FEAT_WFxT},
+    };
+
+    // Compare two names at compile time.
+    constexpr bool NameLess(const char* a, const char* b)
+    {
+        while (*a != 0 && *a == *b) {
+            a++;
+            b++;
+        }
+        return *a < *b;
+    }
+
+    constexpr bool SortedCaps()
+    {
+        for (size_t i = 1; i < std::size(AllCaps); i++) {
+            if (!NameLess(AllCaps[i-1].name, AllCaps[i].name)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    static_assert(SortedCaps(), "hardware capabilities must be sorted by name");
+}
+
+const Hwcaps::Cap* Hwcaps::begin()
+{
+    return AllCaps;
+}
+
+const Hwcaps::Cap* Hwcaps::end()
+{
+    return AllCaps + std::size(AllCaps);
+}
+
+const Hwcaps::Cap* Hwcaps::find(std::string_view name)
+{
+    const Cap* cap = std::lower_bound(begin(), end(), name, [](const Cap& c, std::string_view n) { return c.name < n; });
+    return cap != end() && cap->name == name ? cap : nullptr;
+}
+
+const FeatureSet& Hwcaps::mappedFeatures()
+{
+    static const FeatureSet mapped = []() {
+        FeatureSet fs;
+        for (const auto& cap : AllCaps) {
+            if (cap.feature != ArmFeature::Count) {
+                fs.set(cap.feature);
+            }
+        }
+        return fs;
+    }();
+    return mapped;
+}
+
+
+//----------------------------------------------------------------------------
+// Constructor: read the auxv words and decode them in one pass.
+//----------------------------------------------------------------------------
+
+Hwcaps::Hwcaps()
+{
+#if defined(__linux__)
+    _words[0] = ::getauxval(AT_HWCAP);
+    _words[1] = ::getauxval(AT_HWCAP2);
+    _words[2] = ::getauxval(AT_HWCAP3);
+#endif
+    for (const auto& cap : AllCaps) {
+        if (cap.feature != ArmFeature::Count && has(cap)) {
+            _features.set(cap.feature);
+        }
+    }
+}
+
+const Hwcaps& Hwcaps::instance()
+{
+    static const Hwcaps caps;
+    return caps;
+}
@@ -0,0 +1,65 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Linux hardware capabilities from the auxiliary vector, as a FeatureSet.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "armfeatures.h"
+
+//
+// Linux hardware capabilities, as returned by getauxval(AT_HWCAP, AT_HWCAP2, AT_HWCAP3).
+//
+// The three auxv words are read once in the constructor. The capabilities are then
+// decoded in one pass into a FeatureSet, the same type as ArmFeatures::features(),
+// so that the kernel and system register views can be compared with set operations.
+// On other systems, all words are zero and the feature set is empty.
+//
+class Hwcaps
+{
+public:
+    // Number of auxv words: AT_HWCAP, AT_HWCAP2, AT_HWCAP3.
+    static constexpr size_t WORDS = 3;
+
+    // Description of one hardware capability.
+    struct Cap {
+        const char* name;     // name of the HWCAP_ define, without prefix
+        unsigned    word;     // 0 for AT_HWCAP, 1 for AT_HWCAP2, 2 for AT_HWCAP3
+        unsigned    bit;      // bit index in the auxv word (kernel ABI)
+        ArmFeature  feature;  // corresponding FEAT_xxx, ArmFeature::Count if there is none
+    };
+
+    // Constructor: read the auxv words.
+    Hwcaps();
+
+    // Get a process-wide instance, read on first use.
+    static const Hwcaps& instance();
+
+    // Raw auxv words.
+    csr_u64_t word(size_t index) const { return index < WORDS ? _words[index] : 0; }
+
+    // Check a hardware capability.
+    bool has(const Cap& cap) const { return (word(cap.word) >> cap.bit) & 1; }
+
+    // The Arm features which are reported by the hardware capabilities.
+    const FeatureSet& features() const { return _features; }
+
+    // All known hardware capabilities, sorted by name.
+    static const Cap* begin();
+    static const Cap* end();
+
+    // Find a hardware capability by name (case sensitive), null pointer if unknown.
+    static const Cap* find(std::string_view name);
+
+    // All Arm features which have a corresponding hardware capability.
+    // Use it as a mask to compare with ArmFeatures::features().
+    static const FeatureSet& mappedFeatures();
+
+private:
+    std::array<csr_u64_t, WORDS> _words {};
+    FeatureSet _features;
+};
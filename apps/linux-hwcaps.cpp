@@ -5,38 +5,39 @@
 // BSD-2-Clause license, see the LICENSE file.
 //
 // Linux demo program: display HWCAP as returned by getauxval().
+// Using "-c" (compare), display the Arm features where the HWCAP and the
+// system registers, as read by the kernel module, disagree.
 //
 //----------------------------------------------------------------------------
 
+#include "hwcaps.h"
+#include "armfeatures.h"
+#include "reports.h"
 #include "strutils.h"
 
 #include <iostream>
-#include <vector>
-#include <cstddef>
 #include <cstdlib>
-#include <sys/auxv.h>
-#include <asm/hwcap.h>
 
-// Hardware capabilities.
-struct CapName {
-    std::string name;
-    unsigned long type;
-    unsigned long flag;
-};
-const std::vector<CapName> AllCapNames {
-    // Automatically generated file:
-    #include "_hwcaps.h"
-};
 
 // Program entry point
 int main(int argc, char* argv[])
 {
-    size_t name_width = 0;
-    for (const auto& cap : AllCapNames) {
-        name_width = std::max(name_width, cap.name.length());
-    }
-    for (const auto& cap : AllCapNames) {
-        std::cout << Pad(cap.name + " ", name_width + 1) << " " << YesNo(::getauxval(cap.type) & cap.flag) << std::endl;
+    const bool compare = argc > 1 && std::string(argv[1]) == "-c";
+    const Hwcaps& caps(Hwcaps::instance());
+
+    if (compare) {
+        // Features reported by one view only, among features which have a HWCAP.
+        const ArmFeatures& sysregs(ArmFeatures::instance());
+        const FeatureSet diff((caps.features() ^ sysregs.features()) & Hwcaps::mappedFeatures());
+        for (const auto& cap : caps) {
+            if (cap.feature != ArmFeature::Count && diff.has(cap.feature)) {
+                std::cout << FeatureSet::name(cap.feature) << ": HWCAP " << cap.name << " " << YesNo(caps.has(cap))
+                          << ", system registers " << YesNo(sysregs.features().has(cap.feature)) << std::endl;
+            }
+        }
+        return diff.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
     }
+
+    HwcapsReport(std::cout);
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,292 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Capture Statistical Profiling Extension (SPE) records on all CPU cores
+// and aggregate the samples by instruction address.
+// The kernel module must be loaded with "spe=1".
+//
+//----------------------------------------------------------------------------
+
+#include "cpusysregs.h"
+#include "strutils.h"
+#include "regaccess.h"
+#include "spedecoder.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cinttypes>
+#include <clocale>
+#include <cstdlib>
+#include <string>
+#include <map>
+#include <vector>
+
+// Bits in PMSCR_EL1: EL0 sampling, EL1 sampling, timestamp.
+#define PMSCR_E0SPE (1 << 0)
+#define PMSCR_E1SPE (1 << 1)
+#define PMSCR_TS    (1 << 5)
+
+// Bits in PMSFCR_EL1: filter by type, filter by latency, branches, loads, stores.
+#define PMSFCR_FT   (1 << 1)
+#define PMSFCR_FL   (1 << 2)
+#define PMSFCR_B    (1 << 16)
+#define PMSFCR_LD   (1 << 17)
+#define PMSFCR_ST   (1 << 18)
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    std::string output_file;
+    std::string input_file;
+    csr_spe_config_t config;
+    size_t duration_ms;
+    size_t top;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -b size : profiling buffer size per CPU core in kB (default: 1024)" << std::endl
+              << "  -d file : decode and aggregate records from a file, no capture" << std::endl
+              << "  -f type : sample only this operation type, repeat for several (branch, load, store)" << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -i interval : sampling interval in operations (default: 4096)" << std::endl
+              << "  -k : sample kernel code only" << std::endl
+              << "  -l cycles : sample only operations with a larger total latency" << std::endl
+              << "  -n count : number of displayed instruction addresses (default: 20)" << std::endl
+              << "  -o file : save the raw records of all CPU cores in a file" << std::endl
+              << "  -t ms : capture duration in milliseconds (default: 1000)" << std::endl
+              << "  -u : sample userland code only" << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    output_file(),
+    input_file(),
+    config(),
+    duration_ms(1000),
+    top(20)
+{
+    config.buffer_size = 1024 * 1024;
+    config.interval = 4096;
+    config.pmscr = PMSCR_E0SPE | PMSCR_E1SPE | PMSCR_TS;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-b" && i+1 < argc) {
+            config.buffer_size = std::strtoull(argv[++i], nullptr, 0) * 1024;
+            if (config.buffer_size < CSR_SPE_MIN_BUFFER || config.buffer_size > CSR_SPE_MAX_BUFFER || config.buffer_size % CSR_SPE_MIN_BUFFER != 0) {
+                fatal(Format("buffer size must be a multiple of %d kB, from %d kB to %d kB", CSR_SPE_MIN_BUFFER / 1024, CSR_SPE_MIN_BUFFER / 1024, CSR_SPE_MAX_BUFFER / 1024));
+            }
+        }
+        else if (arg == "-d" && i+1 < argc) {
+            input_file = argv[++i];
+        }
+        else if (arg == "-f" && i+1 < argc) {
+            const std::string type(argv[++i]);
+            config.pmsfcr |= PMSFCR_FT;
+            if (type == "branch") {
+                config.pmsfcr |= PMSFCR_B;
+            }
+            else if (type == "load") {
+                config.pmsfcr |= PMSFCR_LD;
+            }
+            else if (type == "store") {
+                config.pmsfcr |= PMSFCR_ST;
+            }
+            else {
+                fatal("invalid operation type " + type);
+            }
+        }
+        else if (arg == "-i" && i+1 < argc) {
+            config.interval = std::strtoull(argv[++i], nullptr, 0);
+        }
+        else if (arg == "-k") {
+            config.pmscr &= ~csr_u64_t(PMSCR_E0SPE);
+        }
+        else if (arg == "-l" && i+1 < argc) {
+            config.pmsfcr |= PMSFCR_FL;
+            config.pmslatfr = std::strtoull(argv[++i], nullptr, 0) & 0xFFF;
+        }
+        else if (arg == "-n" && i+1 < argc) {
+            top = size_t(std::strtoull(argv[++i], nullptr, 0));
+        }
+        else if (arg == "-o" && i+1 < argc) {
+            output_file = argv[++i];
+        }
+        else if (arg == "-t" && i+1 < argc) {
+            duration_ms = size_t(std::strtoull(argv[++i], nullptr, 0));
+        }
+        else if (arg == "-u") {
+            config.pmscr &= ~csr_u64_t(PMSCR_E1SPE);
+        }
+        else {
+            usage();
+        }
+    }
+    if ((config.pmscr & (PMSCR_E0SPE | PMSCR_E1SPE)) == 0) {
+        fatal("-k and -u are mutually exclusive");
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Capture the profiling records of all CPU cores.
+//----------------------------------------------------------------------------
+
+bool Capture(const Options& opt, std::vector<uint8_t>& records)
+{
+    RegAccess regs(true, true);
+    if (!regs.startProfiling(opt.config)) {
+        return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(opt.duration_ms));
+    if (!regs.stopProfiling()) {
+        return false;
+    }
+
+    // Collect the records of all CPU cores. The records of each core end on a record boundary.
+    const unsigned int cpus = std::thread::hardware_concurrency();
+    std::vector<uint8_t> data;
+    csr_u64_t pmbsr = 0;
+    for (unsigned int cpu = 0; cpu < cpus; cpu++) {
+        if (!regs.readProfiling(int(cpu), data, pmbsr)) {
+            return false;
+        }
+        if (pmbsr != 0) {
+            std::cerr << "CPU " << cpu << ": profiling stopped before end, PMBSR_EL1: " << ToHexa(pmbsr) << std::endl;
+        }
+        records.insert(records.end(), data.begin(), data.end());
+    }
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Aggregate the samples by instruction address.
+//----------------------------------------------------------------------------
+
+struct Aggregate
+{
+    csr_u64_t pc = 0;
+    csr_u64_t samples = 0;
+    csr_u64_t latency = 0;
+    csr_u64_t mispredicted = 0;
+    csr_u64_t l1d_refill = 0;
+    csr_u64_t llc_miss = 0;
+    std::map<int, csr_u64_t> sources {};
+};
+
+void Report(const Options& opt, const std::vector<SpeDecoder::Record>& records)
+{
+    std::map<csr_u64_t, Aggregate> by_pc;
+    for (const auto& rec : records) {
+        Aggregate& agg(by_pc[rec.pc]);
+        agg.pc = rec.pc;
+        agg.samples++;
+        agg.latency += rec.total_latency;
+        agg.mispredicted += (rec.events & SpeDecoder::EV_MISPREDICTED) != 0;
+        agg.l1d_refill += (rec.events & SpeDecoder::EV_L1D_REFILL) != 0;
+        agg.llc_miss += (rec.events & SpeDecoder::EV_LLC_MISS) != 0;
+        if (rec.data_source >= 0) {
+            agg.sources[rec.data_source]++;
+        }
+    }
+
+    // Sort by decreasing number of samples.
+    std::vector<const Aggregate*> sorted;
+    for (const auto& it : by_pc) {
+        sorted.push_back(&it.second);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Aggregate* a, const Aggregate* b) { return a->samples > b->samples; });
+
+    std::cout << Format("%'zu samples, %'zu instruction addresses", records.size(), sorted.size()) << std::endl << std::endl;
+    std::cout << "Address               Samples       %  Avg-lat  Mispred  L1D-refill  LLC-miss  Data sources" << std::endl;
+    for (size_t i = 0; i < sorted.size() && i < opt.top; i++) {
+        const Aggregate& agg(*sorted[i]);
+        std::string sources;
+        for (const auto& src : agg.sources) {
+            sources += Format(" %d:%" PRIu64, src.first, src.second);
+        }
+        std::cout << Format("0x%016" PRIX64 " %'9" PRIu64 " %6.2f %8" PRIu64 " %8" PRIu64 " %11" PRIu64 " %9" PRIu64 " ",
+                            agg.pc, agg.samples, (100.0 * double(agg.samples)) / double(records.size()),
+                            agg.latency / agg.samples, agg.mispredicted, agg.l1d_refill, agg.llc_miss)
+                  << sources << std::endl;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Application entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    // Make sure printf knows how to format integers.
+    setlocale(LC_ALL, "en_US.UTF-8");
+
+    const Options opt(argc, argv);
+    std::vector<uint8_t> raw;
+
+    if (!opt.input_file.empty()) {
+        // Decode records from a file.
+        std::ifstream in(opt.input_file, std::ios::binary);
+        if (!in) {
+            opt.fatal("cannot open " + opt.input_file);
+        }
+        raw.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    else if (!Capture(opt, raw)) {
+        return EXIT_FAILURE;
+    }
+
+    if (!opt.output_file.empty()) {
+        std::ofstream out(opt.output_file, std::ios::binary);
+        if (!out.write(reinterpret_cast<const char*>(raw.data()), std::streamsize(raw.size()))) {
+            opt.fatal("error writing " + opt.output_file);
+        }
+    }
+
+    std::vector<SpeDecoder::Record> records;
+    size_t error_offset = 0;
+    if (!SpeDecoder::decode(raw.data(), raw.size(), records, &error_offset)) {
+        std::cerr << opt.command << ": invalid SPE packet at offset " << error_offset << ", decoding stopped" << std::endl;
+    }
+    Report(opt, records);
+    return EXIT_SUCCESS;
+}
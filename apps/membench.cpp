@@ -0,0 +1,193 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Benchmark of the memory copy and set paths of the fastmem module.
+//
+// For each size, from 16 bytes to the maximum size, by powers of 2, the
+// C library memcpy() and memset() are compared with the NEON and FEAT_MOPS
+// implementations, when supported. Small sizes are repeated in each sample
+// to get a measurable duration. The path which is selected by FastCopy()
+// and FastSet() on this system is reported in the header.
+//
+// The results are displayed in CSV format.
+//
+//----------------------------------------------------------------------------
+
+#include "fastmem.h"
+#include "strutils.h"
+#include "userfeatures.h"
+#include "cacheinfo.h"
+#include "cputimer.h"
+
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    size_t      max_size;
+    size_t      samples;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -m size : maximum size in bytes, rounded down to a power of 2 (default: 16 MB)" << std::endl
+              << "  -s count : number of measured samples, the median is reported (default: 21)" << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    max_size(16 * 1024 * 1024),
+    samples(21)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-m" && i+1 < argc) {
+            max_size = std::max<size_t>(16, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else if (arg == "-s" && i+1 < argc) {
+            samples = std::max<size_t>(1, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else {
+            fatal("invalid option " + arg + ", try --help");
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Time measurement, using the virtual counter (see CpuTimer).
+//----------------------------------------------------------------------------
+
+// Number of warm-up samples.
+static constexpr size_t BENCH_WARMUP = 3;
+
+// Minimum number of bytes per sample, small sizes are repeated.
+static constexpr size_t BENCH_MIN_BYTES = 64 * 1024;
+
+// Time a function which processes 'size' bytes, display one CSV line.
+static void Bench(const Options& opt, const std::string& operation, FastMemPath path, size_t size, const std::function<void()>& func)
+{
+    const CpuTimer& timer(CpuTimer::instance());
+    const size_t repeat = std::max<size_t>(1, BENCH_MIN_BYTES / size);
+    std::vector<double> ns(opt.samples);
+    for (size_t i = 0; i < BENCH_WARMUP; i++) {
+        func();
+    }
+    for (auto& t : ns) {
+        const csr_u64_t start = timer.read();
+        for (size_t i = 0; i < repeat; i++) {
+            func();
+        }
+        t = timer.elapsed(start, timer.read()) / double(repeat);
+    }
+    std::sort(ns.begin(), ns.end());
+    const double median = ns[ns.size() / 2];
+    const double p99 = ns[(ns.size() * 99 + 99) / 100 - 1];
+
+    std::cout << size << "," << operation << "," << FastMemPathName(path) << ","
+              << Format("%.1f,%.1f,%.2f", median, p99, median > 0 ? double(size) / median : 0.0) << std::endl;
+}
+
+
+//----------------------------------------------------------------------------
+// Application entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    const Options opt(argc, argv);
+    const CpuTimer& timer(CpuTimer::instance());
+
+    size_t max_size = 16;
+    while (max_size * 2 <= opt.max_size) {
+        max_size *= 2;
+    }
+
+    // Allocate the source and destination buffers, touch all pages once.
+    const CacheInfo& cache(CacheInfo::instance());
+    uint8_t* const src = static_cast<uint8_t*>(cache.allocate(max_size));
+    uint8_t* const dst = static_cast<uint8_t*>(cache.allocate(max_size));
+    for (size_t i = 0; i < max_size; i++) {
+        src[i] = uint8_t(i * 7 + 1);
+    }
+    ::memset(dst, 0, max_size);
+
+    std::cout << "# counter_frequency," << timer.frequency() << std::endl
+              << "# timer," << timer.sourceName() << std::endl
+              << "# mops," << int(UserFeatures::instance().FEAT_MOPS()) << std::endl
+              << "# best_path," << FastMemPathName(FastMemBestPath()) << std::endl
+              << "size,operation,path,median_ns,p99_ns,median_bytes_per_ns" << std::endl;
+
+    int status = EXIT_SUCCESS;
+    for (FastMemPath path : {FastMemPath::LIBC, FastMemPath::NEON, FastMemPath::MOPS}) {
+        const FastCopyFunction copy = GetFastCopy(path);
+        const FastSetFunction set = GetFastSet(path);
+        if (copy == nullptr || set == nullptr) {
+            std::cout << "# path " << FastMemPathName(path) << " not supported" << std::endl;
+            continue;
+        }
+
+        // Check the results once, on an unaligned size.
+        const size_t check_size = std::min<size_t>(max_size, 1000);
+        ::memset(dst, 0, max_size);
+        copy(dst + 1, src, check_size - 1);
+        bool ok = dst[0] == 0 && ::memcmp(dst + 1, src, check_size - 1) == 0;
+        set(dst + 1, 0x5A, check_size - 2);
+        ok = ok && dst[0] == 0 && dst[check_size - 1] == src[check_size - 2] &&
+             std::all_of(dst + 1, dst + check_size - 1, [](uint8_t b) { return b == 0x5A; });
+        if (!ok) {
+            std::cerr << opt.command << ": " << FastMemPathName(path) << " path error" << std::endl;
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        for (size_t size = 16; size <= max_size; size *= 2) {
+            Bench(opt, "copy", path, size, [&]() { copy(dst, src, size); });
+            Bench(opt, "set", path, size, [&]() { set(dst, 0x5A, size); });
+        }
+    }
+
+    cache.deallocate(dst);
+    cache.deallocate(src);
+    return status;
+}
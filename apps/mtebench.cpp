@@ -0,0 +1,251 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Benchmark of the cost of MTE (Memory Tagging Extension).
+//
+// For each tag check fault mode (none, sync, async, asymm), the same tests
+// are run on tagged and untagged memory: allocation and deallocation of
+// blocks of various sizes using MtePool, sequential loads and stores in a
+// buffer. The overhead is the relative difference of the median durations.
+// The requested mode (prctl) and the active mode (SCTLR_EL1.TCF0 as read
+// by the kernel module in the context of the thread) are reported.
+//
+// The results are displayed in CSV format.
+//
+//----------------------------------------------------------------------------
+
+#include "mtepool.h"
+#include "armfeatures.h"
+#include "regaccess.h"
+#include "strutils.h"
+#include "userfeatures.h"
+#include "cputimer.h"
+
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    size_t      buffer_size;
+    size_t      count;
+    size_t      samples;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -b size : buffer size in bytes for the loads and stores (default: 1 MB)" << std::endl
+              << "  -c count : number of allocated blocks per sample (default: 4096)" << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -s count : number of measured samples, the median is reported (default: 21)" << std::endl
+              << std::endl
+              << "MTE is used on Linux only, with FEAT_MTE2. The asymmetric mode is active only" << std::endl
+              << "when configured in /sys/devices/system/cpu/cpu*/mte_tcf_preferred." << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    buffer_size(1024 * 1024),
+    count(4096),
+    samples(21)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-b" && i+1 < argc) {
+            buffer_size = std::max<size_t>(MtePool::GRANULE, size_t(std::strtoull(argv[++i], nullptr, 0)) & ~(MtePool::GRANULE - 1));
+        }
+        else if (arg == "-c" && i+1 < argc) {
+            count = std::max<size_t>(1, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else if (arg == "-s" && i+1 < argc) {
+            samples = std::max<size_t>(1, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else {
+            fatal("invalid option " + arg + ", try --help");
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Time measurement, using the virtual counter (see CpuTimer).
+//----------------------------------------------------------------------------
+
+// Number of warm-up samples.
+static constexpr size_t BENCH_WARMUP = 3;
+
+// Time a function, return the median duration in nanoseconds.
+static double Bench(const Options& opt, const std::function<void()>& func)
+{
+    const CpuTimer& timer(CpuTimer::instance());
+    std::vector<double> ns(opt.samples);
+    for (size_t i = 0; i < BENCH_WARMUP; i++) {
+        func();
+    }
+    for (auto& t : ns) {
+        const csr_u64_t start = timer.read();
+        func();
+        t = timer.elapsed(start, timer.read());
+    }
+    std::sort(ns.begin(), ns.end());
+    return ns[ns.size() / 2];
+}
+
+// Display one CSV line. The durations are per operation.
+static void Report(const std::string& mode, const std::string& test, size_t size, double untagged, double tagged)
+{
+    std::cout << mode << "," << test << "," << size << ","
+              << Format("%.2f,%.2f,%.1f", untagged, tagged, untagged > 0 ? (tagged - untagged) * 100.0 / untagged : 0.0) << std::endl;
+}
+
+// Prevent the compiler from removing the computations.
+static volatile uint64_t sink = 0;
+
+
+//----------------------------------------------------------------------------
+// Tests
+//----------------------------------------------------------------------------
+
+// Allocation and deallocation of opt.count blocks, nanoseconds per pair.
+static double BenchPool(const Options& opt, MtePool& pool)
+{
+    std::vector<void*> blocks(opt.count);
+    return Bench(opt, [&]() {
+        for (auto& b : blocks) {
+            b = pool.allocate();
+        }
+        for (auto b : blocks) {
+            pool.deallocate(b);
+        }
+    }) / double(opt.count);
+}
+
+// Sequential loads and stores in a buffer of 64-bit words, nanoseconds per KB.
+static double BenchLoad(const Options& opt, const uint64_t* buffer)
+{
+    const size_t words = opt.buffer_size / sizeof(uint64_t);
+    return Bench(opt, [&]() {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < words; i++) {
+            sum += buffer[i];
+        }
+        sink = sink + sum;
+    }) * 1024.0 / double(opt.buffer_size);
+}
+
+static double BenchStore(const Options& opt, uint64_t* buffer)
+{
+    const size_t words = opt.buffer_size / sizeof(uint64_t);
+    return Bench(opt, [&]() {
+        for (size_t i = 0; i < words; i++) {
+            buffer[i] = i;
+        }
+        sink = sink + buffer[words - 1];
+    }) * 1024.0 / double(opt.buffer_size);
+}
+
+
+//----------------------------------------------------------------------------
+// Application entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    const Options opt(argc, argv);
+    const CpuTimer& timer(CpuTimer::instance());
+    const bool supported = MtePool::supported();
+
+    RegAccess regs;
+    const ArmFeatures features(regs);
+    std::cout << "# counter_frequency," << timer.frequency() << std::endl
+              << "# timer," << timer.sourceName() << std::endl
+              << "# user_mte2," << int(UserFeatures::instance().FEAT_MTE2()) << std::endl;
+    if (regs.isOpen()) {
+        std::cout << "# mte," << int(features.FEAT_MTE()) << std::endl
+                  << "# mte2," << int(features.FEAT_MTE2()) << std::endl
+                  << "# mte3," << int(features.FEAT_MTE3()) << std::endl
+                  << "# tbi0," << int(features.AddressTaggingEnabled0()) << std::endl;
+    }
+    if (!supported) {
+        std::cout << "# MTE not available to applications, only untagged memory is measured" << std::endl;
+    }
+
+    // Untagged and tagged buffers for the loads and stores.
+    std::vector<uint64_t> plain(opt.buffer_size / sizeof(uint64_t), 1);
+    uint64_t* tagged = static_cast<uint64_t*>(MtePool::mapTagged(opt.buffer_size));
+    if (tagged != nullptr) {
+        tagged = static_cast<uint64_t*>(MtePool::randomTag(tagged));
+        MtePool::tagArea(tagged, opt.buffer_size);
+        std::fill(tagged, tagged + opt.buffer_size / sizeof(uint64_t), 1);
+    }
+
+    std::cout << "mode,test,size,untagged_ns,tagged_ns,overhead_percent" << std::endl;
+
+    for (MtePool::Mode mode : {MtePool::NONE, MtePool::SYNC, MtePool::ASYNC, MtePool::ASYMM}) {
+        if (!MtePool::setMode(mode)) {
+            std::cout << "# mode " << MtePool::modeName(mode) << " not supported" << std::endl;
+            continue;
+        }
+        MtePool::Mode active = MtePool::NONE;
+        const bool known = MtePool::activeMode(active, &regs);
+        const std::string name(MtePool::modeName(mode));
+        std::cout << "# mode " << name << ", requested: " << MtePool::modeName(MtePool::requestedMode())
+                  << ", active: " << (known ? MtePool::modeName(active) : "unknown (no kernel module)") << std::endl;
+
+        for (size_t size : {16, 64, 256, 4096, 65536}) {
+            MtePool untagged_pool(size, 1024 * 1024, false);
+            MtePool tagged_pool(size, 1024 * 1024, true);
+            const double u = BenchPool(opt, untagged_pool);
+            Report(name, "alloc+free", size, u, tagged_pool.tagged() ? BenchPool(opt, tagged_pool) : u);
+        }
+        const double ul = BenchLoad(opt, plain.data());
+        Report(name, "load_per_kb", opt.buffer_size, ul, tagged != nullptr ? BenchLoad(opt, tagged) : ul);
+        const double us = BenchStore(opt, plain.data());
+        Report(name, "store_per_kb", opt.buffer_size, us, tagged != nullptr ? BenchStore(opt, tagged) : us);
+
+        if (!supported) {
+            break;
+        }
+    }
+
+    MtePool::setMode(MtePool::NONE);
+    MtePool::unmapTagged(tagged, opt.buffer_size);
+    return EXIT_SUCCESS;
+}
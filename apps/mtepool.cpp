@@ -0,0 +1,274 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Pool allocator of memory blocks with MTE tags (Memory Tagging Extension).
+//
+//----------------------------------------------------------------------------
+
+#include "mtepool.h"
+#include "regaccess.h"
+#include "userfeatures.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#if defined(__linux__)
+    #include <sys/mman.h>
+    #include <sys/prctl.h>
+    // These definitions are missing in older system headers.
+    #if !defined(PROT_MTE)
+        #define PROT_MTE 0x20
+    #endif
+    #if !defined(PR_SET_TAGGED_ADDR_CTRL)
+        #define PR_SET_TAGGED_ADDR_CTRL 55
+        #define PR_GET_TAGGED_ADDR_CTRL 56
+        #define PR_TAGGED_ADDR_ENABLE (1UL << 0)
+    #endif
+    #if !defined(PR_MTE_TCF_SHIFT)
+        #define PR_MTE_TCF_SHIFT 1
+        #define PR_MTE_TCF_SYNC  (1UL << PR_MTE_TCF_SHIFT)
+        #define PR_MTE_TCF_ASYNC (2UL << PR_MTE_TCF_SHIFT)
+        #define PR_MTE_TCF_MASK  (3UL << PR_MTE_TCF_SHIFT)
+        #define PR_MTE_TAG_SHIFT 3
+    #endif
+    #if defined(__aarch64__)
+        #define MTE_AVAILABLE 1
+    #endif
+#endif
+
+
+//----------------------------------------------------------------------------
+// MTE instructions. They are encoded in hexadecimal because older assemblers
+// do not know them without -march=armv8.5-a+memtag (see _CSR_DEFINE_GPR).
+//----------------------------------------------------------------------------
+
+#if defined(MTE_AVAILABLE)
+
+// Insert a random tag in a pointer, excluding the tags in the mask: irg ptr, ptr, exclude
+#define mte_irg(ptr,exclude) asm volatile(_CSR_DEFINE_GPR ".inst 0x9ac01000|((.csr_gpr_%1)<<16)|((.csr_gpr_%0)<<5)|(.csr_gpr_%0)" : "+r" (ptr) : "r" (exclude))
+
+// Add the tag of a pointer to an exclusion mask: gmi mask, ptr, mask
+#define mte_gmi(mask,ptr) asm volatile(_CSR_DEFINE_GPR ".inst 0x9ac01400|((.csr_gpr_%0)<<16)|((.csr_gpr_%1)<<5)|(.csr_gpr_%0)" : "+r" (mask) : "r" (ptr))
+
+// Store the tag of a pointer in one or two granules: stg ptr, [ptr] / st2g ptr, [ptr]
+#define mte_stg(ptr)  asm volatile(_CSR_DEFINE_GPR ".inst 0xd9200800|((.csr_gpr_%0)<<5)|(.csr_gpr_%0)" : : "r" (ptr) : "memory")
+#define mte_st2g(ptr) asm volatile(_CSR_DEFINE_GPR ".inst 0xd9a00800|((.csr_gpr_%0)<<5)|(.csr_gpr_%0)" : : "r" (ptr) : "memory")
+
+// Zero a DC ZVA block and store the tag of a pointer in all its granules: dc gzva, ptr
+#define mte_dc_gzva(ptr) asm volatile(_CSR_DEFINE_GPR ".inst 0xd50b7480|(.csr_gpr_%0)" : : "r" (ptr) : "memory")
+
+#endif
+
+
+//----------------------------------------------------------------------------
+// Tag check fault modes.
+//----------------------------------------------------------------------------
+
+bool MtePool::supported()
+{
+#if defined(MTE_AVAILABLE)
+    return UserFeatures::instance().FEAT_MTE2();
+#else
+    return false;
+#endif
+}
+
+bool MtePool::setMode(Mode mode)
+{
+#if defined(MTE_AVAILABLE)
+    if (!supported()) {
+        return false;
+    }
+    // Tag 0 is excluded from IRG, it remains the tag of untagged memory.
+    unsigned long ctrl = PR_TAGGED_ADDR_ENABLE | (0xFFFEUL << PR_MTE_TAG_SHIFT);
+    switch (mode) {
+        case SYNC: ctrl |= PR_MTE_TCF_SYNC; break;
+        case ASYNC: ctrl |= PR_MTE_TCF_ASYNC; break;
+        case ASYMM: ctrl |= PR_MTE_TCF_SYNC | PR_MTE_TCF_ASYNC; break;
+        case NONE:
+        default: break;
+    }
+    return ::prctl(PR_SET_TAGGED_ADDR_CTRL, ctrl, 0, 0, 0) == 0;
+#else
+    return mode == NONE;
+#endif
+}
+
+MtePool::Mode MtePool::requestedMode()
+{
+#if defined(MTE_AVAILABLE)
+    const int ctrl = ::prctl(PR_GET_TAGGED_ADDR_CTRL, 0, 0, 0, 0);
+    if (ctrl >= 0) {
+        const bool sync = (ctrl & PR_MTE_TCF_SYNC) != 0;
+        const bool async = (ctrl & PR_MTE_TCF_ASYNC) != 0;
+        return sync && async ? ASYMM : (sync ? SYNC : (async ? ASYNC : NONE));
+    }
+#endif
+    return NONE;
+}
+
+bool MtePool::activeMode(Mode& mode, RegAccess* regs)
+{
+    RegAccess& access(regs != nullptr ? *regs : RegAccess::shared());
+    csr_u64_t sctlr = 0;
+    mode = NONE;
+    if (!access.isOpen() || !access.read(CSR_REGID_SCTLR_EL1, sctlr)) {
+        return false;
+    }
+    mode = Mode((sctlr >> 38) & 0x03);
+    return true;
+}
+
+std::string MtePool::modeName(Mode mode)
+{
+    switch (mode) {
+        case NONE: return "none";
+        case SYNC: return "sync";
+        case ASYNC: return "async";
+        case ASYMM: return "asymm";
+        default: return "unknown";
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Tagged memory.
+//----------------------------------------------------------------------------
+
+void* MtePool::mapTagged(size_t size)
+{
+#if defined(MTE_AVAILABLE)
+    if (supported()) {
+        void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_MTE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+#endif
+    return nullptr;
+}
+
+void MtePool::unmapTagged(void* ptr, size_t size)
+{
+#if defined(__linux__)
+    if (ptr != nullptr) {
+        ::munmap(reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(ptr) & ~TAG_MASK), size);
+    }
+#endif
+}
+
+void* MtePool::randomTag(void* ptr)
+{
+#if defined(MTE_AVAILABLE)
+    if (supported()) {
+        uint64_t exclude = 0;
+        mte_gmi(exclude, ptr);
+        mte_irg(ptr, exclude);
+    }
+#endif
+    return ptr;
+}
+
+void MtePool::tagArea(void* ptr, size_t size)
+{
+#if defined(MTE_AVAILABLE)
+    uint8_t* addr = static_cast<uint8_t*>(ptr);
+    uint8_t* const end = addr + size;
+
+    // Large areas: DC GZVA on the aligned blocks (zeroes the data at the same time).
+    const size_t block = UserFeatures::instance().dczBlockSize();
+    if (block != 0 && size >= GZVA_MIN_BLOCKS * block) {
+        const uintptr_t tag = reinterpret_cast<uintptr_t>(addr) & TAG_MASK;
+        const uintptr_t first = ((reinterpret_cast<uintptr_t>(addr) & ~TAG_MASK) + block - 1) & ~uintptr_t(block - 1);
+        const uintptr_t last = (reinterpret_cast<uintptr_t>(end) & ~TAG_MASK) & ~uintptr_t(block - 1);
+        tagArea(addr, first - (reinterpret_cast<uintptr_t>(addr) & ~TAG_MASK));
+        for (uintptr_t p = first; p < last; p += block) {
+            const uintptr_t tagged = p | tag;
+            mte_dc_gzva(tagged);
+        }
+        tagArea(reinterpret_cast<void*>(last | tag), size_t((reinterpret_cast<uintptr_t>(end) & ~TAG_MASK) - last));
+        return;
+    }
+
+    // Small areas: two granules at a time.
+    for (; addr + 2 * GRANULE <= end; addr += 2 * GRANULE) {
+        mte_st2g(addr);
+    }
+    if (addr < end) {
+        mte_stg(addr);
+    }
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Pool of blocks.
+//----------------------------------------------------------------------------
+
+MtePool::MtePool(size_t block_size, size_t slab_size, bool tagged) :
+    _tagged(tagged && supported()),
+    _block_size(std::max<size_t>(GRANULE, (block_size + GRANULE - 1) & ~(GRANULE - 1))),
+    _slab_size(std::max(slab_size, _block_size)),
+    _slab_used(_slab_size)
+{
+}
+
+MtePool::~MtePool()
+{
+    for (void* slab : _slabs) {
+        if (_tagged) {
+            unmapTagged(slab, _slab_size);
+        }
+        else {
+            ::operator delete(slab, std::align_val_t(GRANULE));
+        }
+    }
+}
+
+void* MtePool::allocateNew()
+{
+    if (_slab_used + _block_size > _slab_size) {
+        void* slab = _tagged ? mapTagged(_slab_size) : ::operator new(_slab_size, std::align_val_t(GRANULE), std::nothrow);
+        if (slab == nullptr) {
+            return nullptr;
+        }
+        _slabs.push_back(slab);
+        _slab_used = 0;
+    }
+    // The new memory of the slab has tag 0.
+    void* ptr = static_cast<uint8_t*>(_slabs.back()) + _slab_used;
+    _slab_used += _block_size;
+    return ptr;
+}
+
+void* MtePool::allocate()
+{
+    void* ptr = _free;
+    if (ptr != nullptr) {
+        ::memcpy(&_free, ptr, sizeof(void*));
+    }
+    else if ((ptr = allocateNew()) == nullptr) {
+        return nullptr;
+    }
+    if (_tagged) {
+        // New random tag, different from the current one (the tag of the free block).
+        ptr = randomTag(ptr);
+        tagArea(ptr, _block_size);
+    }
+    return ptr;
+}
+
+void MtePool::deallocate(void* ptr)
+{
+    if (ptr == nullptr) {
+        return;
+    }
+    if (_tagged) {
+        // Retag the free block, the previous pointer is now invalid.
+        ptr = randomTag(ptr);
+        tagArea(ptr, _block_size);
+    }
+    ::memcpy(ptr, &_free, sizeof(void*));
+    _free = ptr;
+}
@@ -0,0 +1,102 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Pool allocator of memory blocks with MTE tags (Memory Tagging Extension).
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class RegAccess;
+
+//
+// A pool of fixed-size memory blocks, tagged with MTE.
+//
+// The memory is allocated in slabs, mapped with PROT_MTE. Each allocated block
+// gets a new random tag (IRG, excluding the previous tag of the block), which
+// is stored using ST2G and STG, or DC GZVA for the aligned interior of large
+// blocks. A freed block is tagged again with another tag, so that an access
+// through a dangling pointer is a tag check fault.
+//
+// MTE is available to applications on Linux only, with FEAT_MTE2. Otherwise,
+// or when 'tagged' is false, the pool is a plain untagged pool, for comparison.
+// The content of an allocated block is unspecified. A pool is not thread-safe.
+//
+class MtePool
+{
+public:
+    // Size of an MTE tag granule: the alignment and size unit of the blocks.
+    static constexpr size_t GRANULE = 16;
+
+    // Tag bits in a pointer (bits 59:56).
+    static constexpr uintptr_t TAG_MASK = uintptr_t(0x0F) << 56;
+
+    // Minimum number of DC ZVA blocks in an area to tag it using DC GZVA.
+    static constexpr size_t GZVA_MIN_BLOCKS = 4;
+
+    // Tag check fault modes, same values as SCTLR_EL1.TCF0.
+    enum Mode {NONE = 0, SYNC = 1, ASYNC = 2, ASYMM = 3};
+
+    // Check if MTE can be used by the application.
+    static bool supported();
+
+    // Set the tag check fault mode of the calling thread, using prctl(). With ASYMM, the kernel
+    // selects the preferred mode of each CPU core: asymmetric only when configured as "asymm"
+    // in /sys/devices/system/cpu/cpuN/mte_tcf_preferred, synchronous otherwise.
+    static bool setMode(Mode mode);
+
+    // Get the tag check fault mode which was requested by the calling thread, using prctl().
+    static Mode requestedMode();
+
+    // Get the active tag check fault mode of the calling thread, from SCTLR_EL1.TCF0 as read
+    // by the kernel module, which is executed in the context of the calling thread.
+    static bool activeMode(Mode& mode, RegAccess* regs = nullptr);
+
+    // Name of a mode, e.g. "sync".
+    static std::string modeName(Mode mode);
+
+    // Constructor. The block size is rounded up to a multiple of GRANULE.
+    MtePool(size_t block_size, size_t slab_size = 1024 * 1024, bool tagged = true);
+    ~MtePool();
+
+    // Pool characteristics.
+    bool tagged() const { return _tagged; }
+    size_t blockSize() const { return _block_size; }
+    size_t slabCount() const { return _slabs.size(); }
+
+    // Allocate and free blocks. Return a tagged pointer, or a null pointer when the system is out of memory.
+    void* allocate();
+    void deallocate(void* ptr);
+
+    // Insert a new random tag in a pointer, different from its current tag.
+    static void* randomTag(void* ptr);
+
+    // Tag a memory area, with the tag of the pointer. The address and size shall be multiples of GRANULE.
+    static void tagArea(void* ptr, size_t size);
+
+    // Map and unmap memory with PROT_MTE, at least the size of GRANULE. Return a null pointer on error.
+    static void* mapTagged(size_t size);
+    static void unmapTagged(void* ptr, size_t size);
+
+    MtePool(const MtePool&) = delete;
+    MtePool& operator=(const MtePool&) = delete;
+
+private:
+    bool   _tagged = false;
+    size_t _block_size = GRANULE;
+    size_t _slab_size = 0;
+    size_t _slab_used = 0;           // bytes used in the last slab
+    void*  _free = nullptr;          // list of free blocks, the first word is the next one
+    std::vector<void*> _slabs;
+
+    // Allocate a block which was never used, from the last slab.
+    void* allocateNew();
+};
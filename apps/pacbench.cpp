@@ -0,0 +1,462 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Micro-benchmark of the pointer authentication instructions.
+//
+// The instructions PACIA, AUTIA, PACGA and XPACI are timed on three paths:
+// at EL0 in the current process ("user"), in the kernel module using one
+// command per instruction or one batch command ("kernel", "kernel_batch"),
+// and using the software emulation of ArmPseudoCode ("soft").
+//
+// For each of them, the throughput is measured on independent operations
+// and the latency on a chain of dependent operations. The cost of the
+// function prologues and epilogues which are generated by the compiler
+// with -mbranch-protection=pac-ret+bti is measured on indirect calls.
+//
+// The results are displayed in CSV format.
+//
+//----------------------------------------------------------------------------
+
+#include "cpusysregs.h"
+#include "armfeatures.h"
+#include "armpseudocode.h"
+#include "strutils.h"
+#include "regaccess.h"
+#include "userfeatures.h"
+#include "cputimer.h"
+
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <cinttypes>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    size_t      count;
+    size_t      samples;
+    double      mhz;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -c count : number of operations per sample (default: 1024)" << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -m mhz : CPU frequency in MHz, to display results in cycles" << std::endl
+              << "  -s count : number of measured samples, the median is reported (default: 101)" << std::endl
+              << std::endl
+              << "The kernel paths are measured only when the cpusysregs module is loaded." << std::endl
+              << "Failed authentications are measured only without FEAT_FPAC (they raise an" << std::endl
+              << "exception with FEAT_FPAC)." << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    count(1024),
+    samples(101),
+    mhz(0.0)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-c" && i+1 < argc) {
+            count = size_t(std::strtoull(argv[++i], nullptr, 0));
+            // Multiple of 8 for the unrolled throughput loops.
+            count = std::max<size_t>(8, count & ~size_t(7));
+            if (count > CSR_INSTR_BATCH_MAX) {
+                fatal(Format("count must be from 8 to %d", CSR_INSTR_BATCH_MAX));
+            }
+        }
+        else if (arg == "-m" && i+1 < argc) {
+            mhz = std::atof(argv[++i]);
+        }
+        else if (arg == "-s" && i+1 < argc) {
+            samples = std::max<size_t>(1, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else {
+            fatal("invalid option " + arg + ", try --help");
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Time measurement, using the virtual counter (see CpuTimer).
+//----------------------------------------------------------------------------
+
+// Number of warm-up samples.
+static constexpr size_t BENCH_WARMUP = 10;
+
+// Time a function which executes opt.count operations, display one CSV line.
+static void Bench(const Options& opt, const std::string& path, const std::string& instr, const std::string& mode, const std::function<void()>& func)
+{
+    const CpuTimer& timer(CpuTimer::instance());
+    std::vector<double> ns(opt.samples);
+    for (size_t i = 0; i < BENCH_WARMUP; i++) {
+        func();
+    }
+    for (auto& t : ns) {
+        const csr_u64_t start = timer.read();
+        func();
+        t = timer.elapsed(start, timer.read()) / double(opt.count);
+    }
+    std::sort(ns.begin(), ns.end());
+    const double median = ns[ns.size() / 2];
+    const double p99 = ns[(ns.size() * 99 + 99) / 100 - 1];
+
+    std::cout << path << "," << instr << "," << mode << ","
+              << Format("%.2f,%.2f,", median, p99)
+              << (opt.mhz > 0 ? Format("%.1f,%.1f", median * opt.mhz / 1000, p99 * opt.mhz / 1000) : ",") << std::endl;
+}
+
+// Prevent the compiler from removing the computations.
+static volatile uint64_t sink = 0;
+
+// Repeat a statement 8 times, for independent operations on a0..a7.
+#define EIGHT(op) op(a0); op(a1); op(a2); op(a3); op(a4); op(a5); op(a6); op(a7)
+#define SINK8() sink = sink + (a0 ^ a1 ^ a2 ^ a3 ^ a4 ^ a5 ^ a6 ^ a7)
+
+
+//----------------------------------------------------------------------------
+// Leaf functions with and without branch protection.
+// With -mbranch-protection=bti, the entry of all functions which can be
+// called indirectly is a BTI C. With pac-ret, all non-leaf functions start
+// with PACIASP (an implicit BTI C) and end with AUTIASP. The BTI landing
+// pads are checked only in guarded pages (PROT_BTI) but the cost of the
+// instructions is the same.
+//----------------------------------------------------------------------------
+
+#if !defined(_MSC_VER)
+
+#if defined(__APPLE__)
+    #define BENCH_SYMBOL(name) "_" #name
+#else
+    #define BENCH_SYMBOL(name) #name
+#endif
+
+extern "C" {
+    void pacbench_plain();
+    void pacbench_bti();
+    void pacbench_pacret();
+}
+
+asm(".text\n"
+    ".p2align 4\n"
+    BENCH_SYMBOL(pacbench_plain) ":\n"
+    "    ret\n"
+    ".p2align 4\n"
+    BENCH_SYMBOL(pacbench_bti) ":\n"
+    "    hint #34\n"     // bti c
+    "    ret\n"
+    ".p2align 4\n"
+    BENCH_SYMBOL(pacbench_pacret) ":\n"
+    "    hint #25\n"     // paciasp
+    "    hint #29\n"     // autiasp
+    "    ret\n");
+
+static void BenchCalls(const Options& opt, const std::string& name, void (*func)())
+{
+    void (* volatile target)() = func;
+    Bench(opt, "user", name, "call", [&]() {
+        for (size_t i = 0; i < opt.count; i++) {
+            target();
+        }
+    });
+}
+
+#endif
+
+
+//----------------------------------------------------------------------------
+// Hardware instructions at EL0.
+//----------------------------------------------------------------------------
+
+#define PACIA(x) csr_pacia(x, modifier)
+#define AUTIA(x) csr_autia(x, modifier)
+#define XPACI(x) csr_xpaci(x)
+
+static void BenchUser(const Options& opt, bool fpac)
+{
+    const uint64_t value = uint64_t(&sink);
+    const uint64_t modifier = 0x477D469DEC0B8762;
+    uint64_t signed_value = value;
+    csr_pacia(signed_value, modifier);
+
+    // PACIA: throughput on 8 independent chains, latency on one chain.
+    Bench(opt, "user", "pacia", "throughput", [&]() {
+        uint64_t a0 = value, a1 = value + 1, a2 = value + 2, a3 = value + 3, a4 = value + 4, a5 = value + 5, a6 = value + 6, a7 = value + 7;
+        for (size_t i = 0; i < opt.count; i += 8) {
+            EIGHT(PACIA);
+        }
+        SINK8();
+    });
+    Bench(opt, "user", "pacia", "latency", [&]() {
+        uint64_t x = value;
+        for (size_t i = 0; i < opt.count; i++) {
+            csr_pacia(x, modifier);
+        }
+        sink = sink + x;
+    });
+
+    // AUTIA: throughput on independent authentications of the same signed pointer.
+    // The latency is measured on a chain of PACIA+AUTIA pairs, per pair.
+    Bench(opt, "user", "autia", "throughput", [&]() {
+        uint64_t a0, a1, a2, a3, a4, a5, a6, a7;
+        for (size_t i = 0; i < opt.count; i += 8) {
+            a0 = a1 = a2 = a3 = a4 = a5 = a6 = a7 = signed_value;
+            EIGHT(AUTIA);
+            SINK8();
+        }
+    });
+    Bench(opt, "user", "pacia+autia", "latency", [&]() {
+        uint64_t x = value;
+        for (size_t i = 0; i < opt.count; i++) {
+            csr_pacia(x, modifier);
+            csr_autia(x, modifier);
+        }
+        sink = sink + x;
+    });
+
+    // Failed authentication, only without FEAT_FPAC: a corrupted PAC returns an invalid pointer.
+    if (!fpac) {
+        const uint64_t corrupted = signed_value ^ (uint64_t(1) << 50);
+        Bench(opt, "user", "autia_fail", "throughput", [&]() {
+            uint64_t a0, a1, a2, a3, a4, a5, a6, a7;
+            for (size_t i = 0; i < opt.count; i += 8) {
+                a0 = a1 = a2 = a3 = a4 = a5 = a6 = a7 = corrupted;
+                EIGHT(AUTIA);
+                SINK8();
+            }
+        });
+    }
+
+    // PACGA: throughput on 8 independent chains, latency on one chain.
+    Bench(opt, "user", "pacga", "throughput", [&]() {
+        uint64_t a0 = value, a1 = value + 1, a2 = value + 2, a3 = value + 3, a4 = value + 4, a5 = value + 5, a6 = value + 6, a7 = value + 7;
+        for (size_t i = 0; i < opt.count; i += 8) {
+            csr_pacga(a0, a0, modifier); csr_pacga(a1, a1, modifier);
+            csr_pacga(a2, a2, modifier); csr_pacga(a3, a3, modifier);
+            csr_pacga(a4, a4, modifier); csr_pacga(a5, a5, modifier);
+            csr_pacga(a6, a6, modifier); csr_pacga(a7, a7, modifier);
+        }
+        SINK8();
+    });
+    Bench(opt, "user", "pacga", "latency", [&]() {
+        uint64_t x = value;
+        for (size_t i = 0; i < opt.count; i++) {
+            csr_pacga(x, x, modifier);
+        }
+        sink = sink + x;
+    });
+
+    // XPACI: throughput on independent strips of the same signed pointer, latency on one chain.
+    Bench(opt, "user", "xpaci", "throughput", [&]() {
+        uint64_t a0, a1, a2, a3, a4, a5, a6, a7;
+        for (size_t i = 0; i < opt.count; i += 8) {
+            a0 = a1 = a2 = a3 = a4 = a5 = a6 = a7 = signed_value;
+            EIGHT(XPACI);
+            SINK8();
+        }
+    });
+    Bench(opt, "user", "xpaci", "latency", [&]() {
+        uint64_t x = signed_value;
+        for (size_t i = 0; i < opt.count; i++) {
+            csr_xpaci(x);
+        }
+        sink = sink + x;
+    });
+
+#if !defined(_MSC_VER)
+    // Cost of branch protection in function prologues and epilogues.
+    BenchCalls(opt, "ret", pacbench_plain);
+    BenchCalls(opt, "bti+ret", pacbench_bti);
+    BenchCalls(opt, "paciasp+autiasp+ret", pacbench_pacret);
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Hardware instructions in the kernel module.
+// The instructions cannot be chained in kernel, only the cost per command
+// (dominated by the system call) and per batched instruction are measured.
+//----------------------------------------------------------------------------
+
+static void BenchKernel(const Options& opt, RegAccess& regs, bool fpac)
+{
+    const csr_u64_t value = csr_u64_t(&sink);
+    const csr_u64_t modifier = 0x477D469DEC0B8762;
+
+    // Get a pointer which is signed in kernel.
+    csr_instr_t signed_args;
+    signed_args.value = value;
+    signed_args.modifier = modifier;
+    regs.executeInstr(CSR_INSTR_PACIA, signed_args);
+
+    struct Test {
+        const char* name;
+        int instr;
+        csr_u64_t value;
+    };
+    std::vector<Test> tests {
+        {"pacia", CSR_INSTR_PACIA, value},
+        {"autia", CSR_INSTR_AUTIA, signed_args.value},
+        {"pacga", CSR_INSTR_PACGA, value},
+        {"xpaci", CSR_INSTR_XPACI, signed_args.value},
+    };
+    if (!fpac) {
+        tests.push_back({"autia_fail", CSR_INSTR_AUTIA, signed_args.value ^ (csr_u64_t(1) << 50)});
+    }
+
+    std::vector<csr_instr_item_t> items(opt.count);
+    for (const auto& test : tests) {
+        // Skip instructions which are not supported by the loaded kernel module.
+        csr_instr_t args;
+        args.value = test.value;
+        args.modifier = modifier;
+        if (!regs.executeInstr(test.instr, args)) {
+            std::cout << "# kernel module does not support " << test.name << std::endl;
+            continue;
+        }
+        Bench(opt, "kernel", test.name, "call", [&]() {
+            for (size_t i = 0; i < opt.count; i++) {
+                args.value = test.value;
+                regs.executeInstr(test.instr, args);
+            }
+        });
+        Bench(opt, "kernel_batch", test.name, "throughput", [&]() {
+            for (auto& it : items) {
+                it.instr = csr_u64_t(test.instr);
+                it.args.value = test.value;
+                it.args.modifier = modifier;
+            }
+            regs.executeInstrBatch(items);
+        });
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Software emulation. The PAC algorithm is the one of the current CPU.
+// The software AUTIA is a recomputation of the PAC and a comparison.
+//----------------------------------------------------------------------------
+
+static void BenchSoft(const Options& opt, RegAccess& regs)
+{
+    ArmPseudoCode code(regs);
+    const csr_pair_t key {0xEC2802D4E0A488E9, 0x84BE85CE9804E94B};
+    const csr_u64_t value = csr_u64_t(&sink);
+    const csr_u64_t modifier = 0x477D469DEC0B8762;
+    const csr_u64_t signed_value = code.AddPAC(value, modifier, key, false);
+
+    std::vector<csr_u64_t> values(opt.count), modifiers(opt.count, modifier), output(opt.count);
+    for (size_t i = 0; i < opt.count; i++) {
+        values[i] = value + 16 * i;
+    }
+
+    Bench(opt, "soft", "pacia", "throughput", [&]() {
+        code.addPAC(output.data(), values, modifiers, key, false);
+    });
+    Bench(opt, "soft", "pacia", "latency", [&]() {
+        csr_u64_t x = value;
+        for (size_t i = 0; i < opt.count; i++) {
+            x = code.AddPAC(x, modifier, key, false);
+        }
+        sink = sink + x;
+    });
+    Bench(opt, "soft", "autia", "throughput", [&]() {
+        size_t ok = 0;
+        for (size_t i = 0; i < opt.count; i++) {
+            ok += code.AddPAC(value, modifier, key, false) == signed_value;
+        }
+        sink = sink + ok;
+    });
+    Bench(opt, "soft", "pacga", "throughput", [&]() {
+        for (size_t i = 0; i < opt.count; i++) {
+            output[i] = code.AddPACGA(values[i], modifier, key);
+        }
+    });
+    Bench(opt, "soft", "pacga", "latency", [&]() {
+        csr_u64_t x = value;
+        for (size_t i = 0; i < opt.count; i++) {
+            x = code.AddPACGA(x, modifier, key);
+        }
+        sink = sink + x;
+    });
+    for (auto& v : values) {
+        v = signed_value;
+    }
+    Bench(opt, "soft", "xpaci", "throughput", [&]() {
+        code.stripPAC(output.data(), values, true);
+    });
+}
+
+
+//----------------------------------------------------------------------------
+// Application entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    Options opt(argc, argv);
+    const UserFeatures& ufeat(UserFeatures::instance());
+    if (!ufeat.FEAT_PAuth()) {
+        opt.fatal("pointer authentication is not available in user mode");
+    }
+
+    RegAccess regs;
+    const bool kernel = regs.isOpen();
+    const bool fpac = ufeat.FEAT_FPAC();
+    const std::string algo(kernel ? ArmFeatures(regs).pacAlgo() : "");
+
+    const CpuTimer& timer(CpuTimer::instance());
+    std::cout << "# counter_frequency," << timer.frequency() << std::endl
+              << "# timer," << timer.sourceName() << std::endl
+              << "# timer_overhead_ns," << Format("%.1f", timer.nanoseconds(timer.overhead())) << std::endl
+              << "# fpac," << int(fpac) << std::endl
+              << "# bti," << int(ufeat.FEAT_BTI()) << std::endl
+              << "# kernel," << int(kernel) << std::endl
+              << "# pac_algorithm," << algo << std::endl
+              << "path,instruction,mode,median_ns_per_op,p99_ns_per_op,median_cycles_per_op,p99_cycles_per_op" << std::endl;
+
+    BenchUser(opt, fpac);
+    if (kernel) {
+        BenchKernel(opt, regs, fpac);
+        BenchSoft(opt, regs);
+    }
+    return EXIT_SUCCESS;
+}
@@ -37,7 +37,7 @@ int main(int argc, char* argv[])
     RegAccess regaccess(true, true);
 
     // Check PAC capabilities.
-    ArmFeatures features(regaccess);
+    const ArmFeatures& features(ArmFeatures::instance());
     if (!features.FEAT_PAuth()) {
         std::cerr << "Pointer authentication is not supported on this CPU" << std::endl;
         return EXIT_FAILURE;
@@ -55,11 +55,9 @@ int main(int argc, char* argv[])
               << "Modifier:  " << ToHexa(modifier) << std::endl
               << "Value:     " << ToHexa(value) << std::endl;
 
-    // Set PACGA key, then verify it.
-    regaccess.write(CSR_REGID2_APGAKEY_EL1, key);
+    // Set PACGA key and verify it in the same call.
     csr_pair_t check;
-    regaccess.read(CSR_REGID2_APGAKEY_EL1, check);
-    if (::memcmp(&check, &key, sizeof(key))) {
+    if (!regaccess.writeVerify(CSR_REGID2_APGAKEY_EL1, key, check) || ::memcmp(&check, &key, sizeof(key))) {
         std::cerr << "Key verification failed, APGAKEY register = " << ToHexa(check) << std::endl;
         return EXIT_FAILURE;
         
@@ -0,0 +1,227 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Strip the PAC field from the signed pointers in memory dump files. The PAC
+// field geometry is the one of the current system (TCR_EL1 configuration).
+//
+// Each aligned 64-bit word of the file is a candidate. A word is considered as
+// a signed pointer only when it has a PAC field and, once stripped, it points
+// inside one of the memory mappings of the dumped process. All other words,
+// hashes, floating point values, tables, are left unchanged. The mappings are
+// read from a file in the format of /proc/PID/maps, saved with the dump.
+//
+// The result is written in a separate file, the input file is not modified.
+//
+// Syntax: pacstrip [-i] [-n] [-m maps] [-p pid] [-o output] file ...
+//
+//----------------------------------------------------------------------------
+
+#include "regaccess.h"
+#include "armpseudocode.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <clocale>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+//----------------------------------------------------------------------------
+// Address ranges of the memory mappings of the dumped process.
+//----------------------------------------------------------------------------
+
+class Mappings
+{
+public:
+    // Load a file in the format of /proc/PID/maps: "start-end perms offset dev inode path".
+    bool load(const std::string& filename);
+
+    // Check if an address is inside a mapping.
+    bool contains(csr_u64_t address) const;
+
+    bool empty() const { return _ranges.empty(); }
+
+private:
+    std::vector<std::pair<csr_u64_t, csr_u64_t>> _ranges;  // [start, end), sorted by start
+};
+
+bool Mappings::load(const std::string& filename)
+{
+    std::ifstream in(filename);
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        char* end = nullptr;
+        const csr_u64_t start = std::strtoull(line.c_str(), &end, 16);
+        if (end != nullptr && *end == '-') {
+            const csr_u64_t last = std::strtoull(end + 1, &end, 16);
+            if (last > start) {
+                _ranges.push_back(std::make_pair(start, last));
+            }
+        }
+    }
+    std::sort(_ranges.begin(), _ranges.end());
+    return true;
+}
+
+bool Mappings::contains(csr_u64_t address) const
+{
+    // First range which starts after the address, the candidate is the previous one.
+    auto it = std::upper_bound(_ranges.begin(), _ranges.end(), std::make_pair(address, ~csr_u64_t(0)));
+    return it != _ranges.begin() && address < (--it)->second;
+}
+
+
+//----------------------------------------------------------------------------
+// Strip the signed pointers in a memory area, return the number of modified pointers.
+//----------------------------------------------------------------------------
+
+static size_t StripArea(ArmPseudoCode& code, const Mappings& maps, csr_u64_t* ptrs, size_t count, bool is_instr)
+{
+    std::vector<csr_u64_t> stripped(count);
+    code.stripPAC(stripped.data(), Span<csr_u64_t>(ptrs, count), is_instr);
+    size_t modified = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (stripped[i] != ptrs[i] && maps.contains(stripped[i])) {
+            ptrs[i] = stripped[i];
+            modified++;
+        }
+    }
+    return modified;
+}
+
+
+//----------------------------------------------------------------------------
+// Strip one file into an output file (empty in dry run mode), return false on error.
+//----------------------------------------------------------------------------
+
+static bool StripFile(ArmPseudoCode& code, const Mappings& maps, const std::string& input, const std::string& output, bool is_instr)
+{
+    std::ifstream in(input, std::ios::binary);
+    if (!in) {
+        std::cerr << input << ": cannot open" << std::endl;
+        return false;
+    }
+    std::ofstream out;
+    if (!output.empty()) {
+        out.open(output, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << output << ": cannot create" << std::endl;
+            return false;
+        }
+    }
+
+    // Process the file by chunks. A trailing partial word is copied unchanged.
+    constexpr size_t CHUNK = 64 * 1024;
+    std::vector<csr_u64_t> data(CHUNK);
+    size_t count = 0;
+    size_t modified = 0;
+    for (;;) {
+        in.read(reinterpret_cast<char*>(data.data()), CHUNK * sizeof(csr_u64_t));
+        const size_t bytes = size_t(in.gcount());
+        if (bytes == 0) {
+            break;
+        }
+        const size_t words = bytes / sizeof(csr_u64_t);
+        count += words;
+        modified += StripArea(code, maps, data.data(), words, is_instr);
+        if (out.is_open() && !out.write(reinterpret_cast<const char*>(data.data()), std::streamsize(bytes))) {
+            std::cerr << output << ": write error" << std::endl;
+            return false;
+        }
+    }
+    if (in.bad()) {
+        std::cerr << input << ": read error" << std::endl;
+        return false;
+    }
+    if (out.is_open() && !out.flush()) {
+        std::cerr << output << ": write error" << std::endl;
+        return false;
+    }
+
+    std::cout << input << ": " << Format("%'zu", count) << " words, " << Format("%'zu", modified)
+              << (output.empty() ? " pointers would be modified" : " pointers modified in " + output) << std::endl;
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Application entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    // Make sure printf knows how to format integers.
+    setlocale(LC_ALL, "en_US.UTF-8");
+
+    bool is_instr = false;
+    bool dry_run = false;
+    bool usage = false;
+    std::string maps_file;
+    std::string output;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg(argv[i]);
+        if (arg == "-i") {
+            is_instr = true;
+        }
+        else if (arg == "-n") {
+            dry_run = true;
+        }
+        else if (arg == "-m" && i + 1 < argc) {
+            maps_file = argv[++i];
+        }
+        else if (arg == "-p" && i + 1 < argc) {
+            maps_file = std::string("/proc/") + argv[++i] + "/maps";
+        }
+        else if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        }
+        else if (!arg.empty() && arg[0] != '-') {
+            files.push_back(arg);
+        }
+        else {
+            usage = true;
+        }
+    }
+    if (usage || files.empty() || (!output.empty() && files.size() > 1)) {
+        std::cerr << "Usage: " << argv[0] << " [-i] [-n] [-m maps] [-p pid] [-o output] file ..." << std::endl
+                  << "  -i : the pointers are instruction addresses (default: data)" << std::endl
+                  << "  -m : memory mappings of the dumped process, /proc/PID/maps format (default: file.maps)" << std::endl
+                  << "  -n : dry run, count the pointers to modify, do not create output files" << std::endl
+                  << "  -o : output file, with one single input file (default: file.stripped)" << std::endl
+                  << "  -p : use the current memory mappings of a process (same as -m /proc/pid/maps)" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    RegAccess regs(true, true);
+    ArmPseudoCode code(regs);
+    bool success = true;
+    for (const auto& name : files) {
+        // Without mappings, no word can be identified as a pointer.
+        Mappings maps;
+        const std::string mfile(maps_file.empty() ? name + ".maps" : maps_file);
+        if (!maps.load(mfile) || maps.empty()) {
+            std::cerr << name << ": no memory mapping in " << mfile << ", use -m or -p" << std::endl;
+            success = false;
+            continue;
+        }
+        const std::string out(dry_run ? std::string() : (output.empty() ? name + ".stripped" : output));
+        if (out == name) {
+            std::cerr << name << ": the output file must be different from the input file" << std::endl;
+            success = false;
+            continue;
+        }
+        success = StripFile(code, maps, name, out, is_instr) && success;
+    }
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,489 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Cross-validation of hardware PAC against the software implementation,
+// on random (value, modifier, key) tuples, using all CPU cores.
+//
+// Each worker thread is bound to one CPU core. For each chunk of tuples,
+// it writes a random key on its core, executes the PAC instructions in
+// kernel mode in one batch command (and optionally at EL0), and compares
+// the results with software QARMA or ArmPseudoCode::AddPAC().
+//
+// Only the data keys and the generic key are used. Changing the instruction
+// keys may crash the system, see demo-pac.cpp.
+//
+//----------------------------------------------------------------------------
+
+#include "cpusysregs.h"
+#include "armfeatures.h"
+#include "armpseudocode.h"
+#include "strutils.h"
+#include "regaccess.h"
+#include "cputopology.h"
+#include "qarma64.h"
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <cinttypes>
+#include <clocale>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    int         key_index;  // CSR_PACKEY_xx
+    csr_u64_t   count;
+    csr_u64_t   chunk;
+    csr_u64_t   seed;
+    size_t      threads;
+    size_t      max_report;
+    bool        user;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -c size : number of tuples per chunk, with the same key (default: 4096)" << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -k key : key to test, da, db or ga (default: ga)" << std::endl
+              << "  -m count : maximum number of reported mismatches (default: 10)" << std::endl
+              << "  -n count : total number of tuples (default: 10,000,000)" << std::endl
+              << "  -s seed : seed of the pseudo-random generator (default: from the clock)" << std::endl
+              << "  -t count : number of worker threads (default: all CPU cores)" << std::endl
+              << "  -u : also execute the instructions at EL0" << std::endl
+              << std::endl
+              << "At EL0, the operating system may restore the keys of the process on return" << std::endl
+              << "from the kernel. In that case, EL0 mismatches are expected." << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    key_index(CSR_PACKEY_GA),
+    count(10000000),
+    chunk(4096),
+    seed(csr_u64_t(std::chrono::steady_clock::now().time_since_epoch().count())),
+    threads(std::max(1u, std::thread::hardware_concurrency())),
+    max_report(10),
+    user(false)
+{
+    const size_t cpus = threads;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-c" && i+1 < argc) {
+            chunk = std::strtoull(argv[++i], nullptr, 0);
+            if (chunk < 1 || chunk > CSR_INSTR_BATCH_MAX) {
+                fatal(Format("chunk size must be from 1 to %d", CSR_INSTR_BATCH_MAX));
+            }
+        }
+        else if (arg == "-k" && i+1 < argc) {
+            const std::string key(ToLower(argv[++i]));
+            if (key == "da") {
+                key_index = CSR_PACKEY_DA;
+            }
+            else if (key == "db") {
+                key_index = CSR_PACKEY_DB;
+            }
+            else if (key == "ga") {
+                key_index = CSR_PACKEY_GA;
+            }
+            else {
+                fatal("invalid key " + key + ", must be da, db or ga");
+            }
+        }
+        else if (arg == "-m" && i+1 < argc) {
+            max_report = size_t(std::strtoull(argv[++i], nullptr, 0));
+        }
+        else if (arg == "-n" && i+1 < argc) {
+            count = std::strtoull(argv[++i], nullptr, 0);
+        }
+        else if (arg == "-s" && i+1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 0);
+        }
+        else if (arg == "-t" && i+1 < argc) {
+            threads = size_t(std::strtoull(argv[++i], nullptr, 0));
+        }
+        else if (arg == "-u") {
+            user = true;
+        }
+        else {
+            usage();
+        }
+    }
+
+    // Workers on the same core would overwrite the keys of each other.
+    if (threads < 1 || threads > cpus) {
+        fatal(Format("number of threads must be from 1 to %zu", cpus));
+    }
+    if ((count + chunk - 1) / chunk > 0xFFFFFFFF) {
+        fatal("too many chunks, use a larger chunk size");
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Work-stealing pool of chunk indices.
+// Each worker initially owns an equal share of the chunks, as a range [next, end)
+// in one atomic word. When its share is exhausted, a worker steals the upper half
+// of the largest remaining share of another worker.
+//----------------------------------------------------------------------------
+
+class WorkPool
+{
+public:
+    WorkPool(csr_u64_t chunks, size_t workers);
+
+    // Get the next chunk to process by a worker. Return false when all chunks are done.
+    bool next(size_t worker, csr_u64_t& chunk);
+
+private:
+    std::vector<std::atomic<csr_u64_t>> _shares;
+
+    static csr_u64_t pack(csr_u64_t first, csr_u64_t end) { return (end << 32) | first; }
+    static uint32_t first(csr_u64_t share) { return uint32_t(share); }
+    static uint32_t end(csr_u64_t share) { return uint32_t(share >> 32); }
+};
+
+WorkPool::WorkPool(csr_u64_t chunks, size_t workers) :
+    _shares(workers)
+{
+    for (size_t i = 0; i < workers; i++) {
+        _shares[i] = pack(chunks * i / workers, chunks * (i + 1) / workers);
+    }
+}
+
+bool WorkPool::next(size_t worker, csr_u64_t& chunk)
+{
+    for (;;) {
+        // Take the first chunk of our own share.
+        csr_u64_t share = _shares[worker].load();
+        while (first(share) < end(share)) {
+            if (_shares[worker].compare_exchange_weak(share, share + 1)) {
+                chunk = first(share);
+                return true;
+            }
+        }
+
+        // Find the largest remaining share.
+        size_t victim = 0;
+        uint32_t largest = 0;
+        for (size_t i = 0; i < _shares.size(); i++) {
+            share = _shares[i].load();
+            if (first(share) < end(share) && end(share) - first(share) > largest) {
+                largest = end(share) - first(share);
+                victim = i;
+            }
+        }
+        if (largest == 0) {
+            return false;
+        }
+
+        // Steal its upper half (or its last chunk). Our own share is empty, no other thief touches it.
+        share = _shares[victim].load();
+        if (first(share) < end(share)) {
+            const uint32_t middle = first(share) + (end(share) - first(share)) / 2;
+            if (_shares[victim].compare_exchange_strong(share, pack(first(share), middle))) {
+                _shares[worker].store(pack(middle, end(share)));
+            }
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Results of the workers.
+//----------------------------------------------------------------------------
+
+class Results
+{
+public:
+    std::atomic<csr_u64_t> tuples {0};
+    std::atomic<csr_u64_t> kernel_errors {0};
+    std::atomic<csr_u64_t> user_errors {0};
+    std::atomic<csr_u64_t> aut_errors {0};
+    std::atomic<csr_u64_t> retries {0};
+    std::atomic<csr_u64_t> failures {0};
+
+    // Report one mismatch, up to a maximum number.
+    void report(size_t max_report, const std::string& where, const csr_pair_t& key, csr_u64_t value, csr_u64_t modifier, csr_u64_t hard, csr_u64_t soft);
+
+private:
+    std::mutex _mutex;
+    size_t     _reported = 0;
+};
+
+void Results::report(size_t max_report, const std::string& where, const csr_pair_t& key, csr_u64_t value, csr_u64_t modifier, csr_u64_t hard, csr_u64_t soft)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_reported++ < max_report) {
+        std::cout << "Mismatch (" << where << "): key " << ToHexa(key) << ", value " << ToHexa(value)
+                  << ", modifier " << ToHexa(modifier) << ", hardware " << ToHexa(hard) << ", software " << ToHexa(soft) << std::endl;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Worker thread.
+//----------------------------------------------------------------------------
+
+// Deterministic pseudo-random generator (splitmix64), one sequence per chunk.
+static csr_u64_t Random(csr_u64_t& state)
+{
+    csr_u64_t z = (state += 0x9E3779B97F4A7C15);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    return z ^ (z >> 31);
+}
+
+static void Worker(const Options& opt, RegAccess& regs, WorkPool& pool, Results& results, size_t index)
+{
+    CpuTopology::bindThread(index);
+
+    const ArmFeatures& features(ArmFeatures::instance());
+    ArmPseudoCode code(regs);
+    Qarma64 qarma(features.pacQARMA());
+    const bool generic = opt.key_index == CSR_PACKEY_GA;
+    const bool check_aut = !generic && !features.FEAT_FPAC();
+    const int pac_instr = opt.key_index == CSR_PACKEY_DA ? CSR_INSTR_PACDA : opt.key_index == CSR_PACKEY_DB ? CSR_INSTR_PACDB : CSR_INSTR_PACGA;
+    const int aut_instr = opt.key_index == CSR_PACKEY_DA ? CSR_INSTR_AUTDA : CSR_INSTR_AUTDB;
+    const csr_u64_t canonical = ArmPseudoCode::Bits(47, 0);
+
+    // Same 64-bit type as Qarma64, csr_u64_t may be a different one.
+    std::vector<Qarma64::text_t> values;
+    std::vector<Qarma64::tweak_t> modifiers;
+    std::vector<Qarma64::text_t> soft;
+    std::vector<csr_instr_item_t> items;
+    csr_pac_keys_t keys;
+    csr_pac_keys_t initial;
+    bool swapped = false;
+
+    csr_u64_t chunk = 0;
+    while (pool.next(index, chunk)) {
+
+        // Generate the tuples of the chunk, the same ones for a given seed.
+        const csr_u64_t first = chunk * opt.chunk;
+        const size_t count = size_t(std::min(opt.chunk, opt.count - first));
+        csr_u64_t state = opt.seed ^ (chunk * 0xD1B54A32D192ED03);
+        Zero(&keys, sizeof(keys));
+        keys.set = 1 << opt.key_index;
+        csr_pair_t& key(keys.keys[opt.key_index]);
+        key.high = Random(state);
+        key.low = Random(state);
+        const csr_pair_t chunk_key(key);
+        values.resize(count);
+        modifiers.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            values[i] = Random(state);
+            modifiers[i] = Random(state);
+            // Addresses are mostly canonical user addresses, sometimes anything.
+            if (!generic && (values[i] & 0x0F) != 0) {
+                values[i] &= canonical;
+            }
+        }
+
+        // Software reference. The generic key is a truncated QARMA, direct on the batch.
+        soft.resize(count);
+        if (generic) {
+            qarma.encryptBatch(soft.data(), values, modifiers, qarma.makeKey(chunk_key.high, chunk_key.low));
+            for (auto& s : soft) {
+                s &= ArmPseudoCode::Bits(63, 32);
+            }
+        }
+        else {
+            for (size_t i = 0; i < count; i++) {
+                soft[i] = code.AddPAC(values[i], modifiers[i], chunk_key, true);
+            }
+        }
+
+        // Hardware computation. Retry when the key was changed on the core in the meantime.
+        bool done = false;
+        for (int attempt = 0; !done && attempt < 3; attempt++) {
+            keys.set = 1 << opt.key_index;
+            keys.keys[opt.key_index] = chunk_key;
+            if (!regs.swapPacKeys(keys) || !(keys.valid & keys.set)) {
+                results.failures++;
+                return;
+            }
+            if (!swapped) {
+                initial = keys;
+                swapped = true;
+            }
+
+            items.resize(count);
+            for (size_t i = 0; i < count; i++) {
+                items[i].instr = pac_instr;
+                items[i].args.value = values[i];
+                items[i].args.modifier = modifiers[i];
+            }
+            if (!regs.executeInstrBatch(items)) {
+                results.failures++;
+                return;
+            }
+
+            // Check that the key is still the same, all keys are read when nothing is set.
+            keys.set = 0;
+            done = regs.swapPacKeys(keys) && keys.keys[opt.key_index].high == chunk_key.high && keys.keys[opt.key_index].low == chunk_key.low;
+            if (!done) {
+                results.retries++;
+            }
+        }
+        if (!done) {
+            results.failures++;
+            continue;
+        }
+
+        // Compare the kernel results, then authenticate them.
+        csr_u64_t errors = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (items[i].status != 0 || items[i].args.value != soft[i]) {
+                errors++;
+                results.report(opt.max_report, "kernel", chunk_key, values[i], modifiers[i], items[i].args.value, soft[i]);
+            }
+        }
+        results.kernel_errors += errors;
+
+        if (check_aut) {
+            // The values are now the signed pointers, with the same modifiers.
+            for (auto& item : items) {
+                item.instr = aut_instr;
+            }
+            if (regs.executeInstrBatch(items)) {
+                errors = 0;
+                for (size_t i = 0; i < count; i++) {
+                    // Only canonical addresses are restored by AUT.
+                    if ((values[i] & ~canonical) == 0 && items[i].args.value != values[i]) {
+                        errors++;
+                        results.report(opt.max_report, "kernel AUT", chunk_key, values[i], modifiers[i], items[i].args.value, values[i]);
+                    }
+                }
+                results.aut_errors += errors;
+            }
+        }
+
+        // Same instructions at EL0, with the key which is active in userland.
+        if (opt.user) {
+            errors = 0;
+            for (size_t i = 0; i < count; i++) {
+                csr_u64_t hard = values[i];
+                if (opt.key_index == CSR_PACKEY_DA) {
+                    csr_pacda(hard, modifiers[i]);
+                }
+                else if (opt.key_index == CSR_PACKEY_DB) {
+                    csr_pacdb(hard, modifiers[i]);
+                }
+                else {
+                    csr_pacga(hard, values[i], modifiers[i]);
+                }
+                if (hard != soft[i]) {
+                    errors++;
+                    results.report(opt.max_report, "user", chunk_key, values[i], modifiers[i], hard, soft[i]);
+                }
+            }
+            results.user_errors += errors;
+        }
+
+        results.tuples += count;
+    }
+
+    // Restore the initial key on this core.
+    if (swapped) {
+        initial.set = 1 << opt.key_index;
+        regs.swapPacKeys(initial);
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Program entry point.
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    // Make sure printf knows how to format integers.
+    setlocale(LC_ALL, "en_US.UTF-8");
+
+    Options opt(argc, argv);
+    RegAccess regs(true, true);
+    const ArmFeatures& features(ArmFeatures::instance());
+
+    if (!features.FEAT_PAuth()) {
+        std::cout << "PAC is not implemented in this CPU" << std::endl;
+        return EXIT_SUCCESS;
+    }
+    if (features.pacQARMA() <= 0) {
+        std::cerr << "PAC algorithm is " << features.pacAlgo() << ", no software reference" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    static const char* const key_names[CSR_PACKEY_COUNT] = {"IA", "IB", "DA", "DB", "GA"};
+    std::cout << "Algorithm: " << features.pacAlgo() << ", key " << key_names[opt.key_index]
+              << ", seed " << ToHexa(opt.seed) << ", " << opt.threads << " threads" << std::endl;
+    if (opt.key_index != CSR_PACKEY_GA && features.FEAT_FPAC()) {
+        std::cout << "FEAT_FPAC is implemented, AUT instructions are not tested" << std::endl;
+    }
+
+    WorkPool pool((opt.count + opt.chunk - 1) / opt.chunk, opt.threads);
+    Results results;
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < opt.threads; i++) {
+        workers.emplace_back(Worker, std::cref(opt), std::ref(regs), std::ref(pool), std::ref(results), i);
+    }
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const csr_u64_t tuples = results.tuples;
+    const csr_u64_t errors = results.kernel_errors + results.aut_errors + results.user_errors;
+    std::cout << "Tuples:            " << Format("%'" PRIu64, tuples) << std::endl
+              << "Kernel mismatches: " << Format("%'" PRIu64, csr_u64_t(results.kernel_errors)) << std::endl
+              << "AUT failures:      " << Format("%'" PRIu64, csr_u64_t(results.aut_errors)) << std::endl;
+    if (opt.user) {
+        std::cout << "EL0 mismatches:    " << Format("%'" PRIu64, csr_u64_t(results.user_errors)) << std::endl;
+    }
+    std::cout << "Key changes lost:  " << Format("%'" PRIu64, csr_u64_t(results.retries)) << std::endl
+              << "Failed chunks:     " << Format("%'" PRIu64, csr_u64_t(results.failures)) << std::endl
+              << "Duration:          " << Format("%.3f", seconds) << " seconds" << std::endl
+              << "Throughput:        " << Format("%'.0f", seconds > 0 ? double(tuples) / seconds : 0.0) << " tuples/second" << std::endl;
+
+    return errors == 0 && results.failures == 0 && tuples == opt.count ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,99 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A class to program the performance monitors and read them from userland.
+//
+//----------------------------------------------------------------------------
+
+#include "pmusession.h"
+
+// Bits in PMCR_EL0: enable, reset event counters, reset cycle counter, 64-bit cycle counter.
+#define PMCR_E  (1 << 0)
+#define PMCR_P  (1 << 1)
+#define PMCR_C  (1 << 2)
+#define PMCR_LC (1 << 6)
+
+// Bits in PMUSERENR_EL0: EL0 access, cycle counter read, event counter read.
+#define PMUSERENR_EN (1 << 0)
+#define PMUSERENR_CR (1 << 2)
+#define PMUSERENR_ER (1 << 3)
+
+// Bit in PMEVTYPER<n>_EL0 and PMCCFILTR_EL0: don't count at EL1.
+#define PMEVTYPER_P (csr_u64_t(1) << 31)
+
+
+//----------------------------------------------------------------------------
+// Open the session.
+//----------------------------------------------------------------------------
+
+bool PmuSession::open(const std::vector<csr_u64_t>& events, bool user_only)
+{
+    if (!close()) {
+        return false;
+    }
+
+    // Get the number of implemented event counters. Fail if PMUv3 is not implemented.
+    csr_u64_t pmcr = 0;
+    if (!_regs.read(CSR_REGID_PMCR_EL0, pmcr)) {
+        return false;
+    }
+    _counters = (pmcr >> 11) & 0x1F;
+    if (events.size() > _counters) {
+        return false;
+    }
+
+    // New state of the performance monitors.
+    csr_pmu_state_t state {};
+    state.pmcr = PMCR_E | PMCR_P | PMCR_C | PMCR_LC;
+    state.userenr = PMUSERENR_EN | PMUSERENR_CR | PMUSERENR_ER;
+    state.cntenset = csr_u64_t(1) << CSR_PMU_CYCLE_COUNTER;
+    state.ccfiltr = user_only ? PMEVTYPER_P : 0;
+    for (size_t i = 0; i < events.size(); i++) {
+        state.evtyper[i] = (events[i] & 0xFFFF) | (user_only ? PMEVTYPER_P : 0);
+        state.cntenset |= csr_u64_t(1) << i;
+    }
+
+    // Program all CPU cores, keep the previous state.
+    if (!_regs.swapPmu(state) || state.status != 0) {
+        return false;
+    }
+    _saved = state;
+    _events = events;
+    _open = true;
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Close the session and restore the previous state.
+//----------------------------------------------------------------------------
+
+bool PmuSession::close()
+{
+    if (_open) {
+        csr_pmu_state_t state = _saved;
+        if (!_regs.swapPmu(state)) {
+            return false;
+        }
+        _open = false;
+        _events.clear();
+    }
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Read all programmed event counters, then the cycle counter.
+//----------------------------------------------------------------------------
+
+void PmuSession::readAll(std::vector<csr_u64_t>& values) const
+{
+    values.resize(_events.size() + 1);
+    for (size_t i = 0; i < _events.size(); i++) {
+        values[i] = readCounter(i);
+    }
+    values[_events.size()] = readCycles();
+}
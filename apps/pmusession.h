@@ -0,0 +1,121 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A class to program the performance monitors and read them from userland.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "regaccess.h"
+
+//
+// A class to program the performance monitors (PMUv3) and read them from userland.
+//
+// When the session is open, the event counters are programmed and reset on all CPU cores
+// and the EL0 access to the counters is enabled. The counters are then directly read in
+// userland using readCycles() and readCounter(), without system call. The CPU cores are
+// counted separately: the calling thread should be pinned to one CPU core while measuring.
+// The previous state of the performance monitors is restored when the session is closed.
+//
+// Warning: this conflicts with any other user of the PMU, such as perf on Linux.
+//
+class PmuSession
+{
+public:
+    // Constructor and destructor.
+    PmuSession(RegAccess& regs) : _regs(regs) {}
+    ~PmuSession() { close(); }
+
+    // Forbid copy (keep only one instance per PMU configuration).
+    PmuSession(PmuSession&&) = delete;
+    PmuSession(const PmuSession&) = delete;
+    PmuSession& operator=(PmuSession&&) = delete;
+    PmuSession& operator=(const PmuSession&) = delete;
+
+    // Some common architectural events (PMEVTYPER<n>_EL0.evtCount).
+    enum : csr_u64_t {
+        SW_INCR             = 0x0000,
+        L1I_CACHE_REFILL    = 0x0001,
+        L1D_CACHE_REFILL    = 0x0003,
+        L1D_CACHE           = 0x0004,
+        L1D_TLB_REFILL      = 0x0005,
+        INST_RETIRED        = 0x0008,
+        EXC_TAKEN           = 0x0009,
+        BR_MIS_PRED         = 0x0010,
+        CPU_CYCLES          = 0x0011,
+        BR_PRED             = 0x0012,
+        MEM_ACCESS          = 0x0013,
+        L1I_CACHE           = 0x0014,
+        L2D_CACHE           = 0x0016,
+        L2D_CACHE_REFILL    = 0x0017,
+        BUS_ACCESS          = 0x0019,
+        INST_SPEC           = 0x001B,
+        BR_RETIRED          = 0x0021,
+        BR_MIS_PRED_RETIRED = 0x0022,
+        STALL_FRONTEND      = 0x0023,
+        STALL_BACKEND       = 0x0024,
+        L1D_TLB             = 0x0025,
+        L1I_TLB             = 0x0026,
+        LL_CACHE_MISS_RD    = 0x0037,
+    };
+
+    // Open the session: program the event counters, in this order, and the cycle counter.
+    // With user_only, count at EL0 only. Otherwise, count at EL0 and EL1.
+    // Return false if the PMU is not accessible or if there are not enough event counters.
+    bool open(const std::vector<csr_u64_t>& events, bool user_only = false);
+
+    // Close the session and restore the previous state of the performance monitors.
+    bool close();
+
+    // Check if the session is open.
+    bool isOpen() const { return _open; }
+
+    // Number of programmed event counters and implemented event counters (valid after open()).
+    size_t eventCount() const { return _events.size(); }
+    size_t counterCount() const { return _counters; }
+
+    // Read the 64-bit cycle counter at EL0 (session must be open).
+    static csr_u64_t readCycles()
+    {
+        csr_u64_t value = 0;
+        csr_mrs(value, CSR_SREG_PMCCNTR_EL0);
+        return value;
+    }
+
+    // Read an event counter at EL0 (session must be open). The index is in the order of the events in open().
+    // Event counters are 32-bit wide on most implementations, compute differences modulo 2^32.
+    static csr_u64_t readCounter(size_t index);
+
+    // Read all programmed event counters, in the order of the events in open(), followed by the cycle counter.
+    void readAll(std::vector<csr_u64_t>& values) const;
+
+private:
+    RegAccess&             _regs;
+    bool                   _open = false;
+    size_t                 _counters = 0;
+    std::vector<csr_u64_t> _events {};
+    csr_pmu_state_t        _saved {};   // state of the performance monitors before open()
+};
+
+// Read an event counter at EL0. The index in PMEVCNTR<n>_EL0 must be a constant.
+inline csr_u64_t PmuSession::readCounter(size_t index)
+{
+#define _CSR_PMEVCNTR(n) case n: csr_mrs(value, CSR_SREG_PMEVCNTRn_EL0(n)); break
+    csr_u64_t value = 0;
+    switch (index) {
+        _CSR_PMEVCNTR(0);  _CSR_PMEVCNTR(1);  _CSR_PMEVCNTR(2);  _CSR_PMEVCNTR(3);
+        _CSR_PMEVCNTR(4);  _CSR_PMEVCNTR(5);  _CSR_PMEVCNTR(6);  _CSR_PMEVCNTR(7);
+        _CSR_PMEVCNTR(8);  _CSR_PMEVCNTR(9);  _CSR_PMEVCNTR(10); _CSR_PMEVCNTR(11);
+        _CSR_PMEVCNTR(12); _CSR_PMEVCNTR(13); _CSR_PMEVCNTR(14); _CSR_PMEVCNTR(15);
+        _CSR_PMEVCNTR(16); _CSR_PMEVCNTR(17); _CSR_PMEVCNTR(18); _CSR_PMEVCNTR(19);
+        _CSR_PMEVCNTR(20); _CSR_PMEVCNTR(21); _CSR_PMEVCNTR(22); _CSR_PMEVCNTR(23);
+        _CSR_PMEVCNTR(24); _CSR_PMEVCNTR(25); _CSR_PMEVCNTR(26); _CSR_PMEVCNTR(27);
+        _CSR_PMEVCNTR(28); _CSR_PMEVCNTR(29); _CSR_PMEVCNTR(30);
+        default: break;
+    }
+    return value;
+#undef _CSR_PMEVCNTR
+}
@@ -0,0 +1,128 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Scoped control of the PSTATE modes which are writable at EL0: DIT and SSBS.
+//
+//----------------------------------------------------------------------------
+
+#include "pstate.h"
+#include "userfeatures.h"
+#include <cstdint>
+
+#if defined(__linux__)
+    #include <sys/prctl.h>
+#endif
+
+// The registers are accessed using their generic names because older assemblers
+// do not know "dit" and "ssbs". The mode is one bit in the register value.
+#define CSR_DIT_BIT  (uint64_t(1) << 24)   // S3_3_C4_C2_5
+#define CSR_SSBS_BIT (uint64_t(1) << 12)   // S3_3_C4_C2_6
+
+
+//----------------------------------------------------------------------------
+// PSTATE.DIT
+//----------------------------------------------------------------------------
+
+bool ScopedDIT::supported()
+{
+#if defined(__aarch64__)
+    return UserFeatures::instance().FEAT_DIT();
+#else
+    return false;
+#endif
+}
+
+bool ScopedDIT::get()
+{
+    uint64_t value = 0;
+#if defined(__aarch64__)
+    if (supported()) {
+        asm volatile("mrs %0, s3_3_c4_c2_5" : "=r" (value));
+    }
+#endif
+    return (value & CSR_DIT_BIT) != 0;
+}
+
+bool ScopedDIT::set(bool dit)
+{
+#if defined(__aarch64__)
+    if (supported()) {
+        const uint64_t value = dit ? CSR_DIT_BIT : 0;
+        asm volatile("msr s3_3_c4_c2_5, %0" : : "r" (value) : "memory");
+    }
+#endif
+    return supported() && get() == dit;
+}
+
+ScopedDIT::ScopedDIT(bool dit) :
+    _previous(get()),
+    _applied(supported() && (_previous == dit || set(dit)))
+{
+}
+
+ScopedDIT::~ScopedDIT()
+{
+    if (get() != _previous) {
+        set(_previous);
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// PSTATE.SSBS
+//----------------------------------------------------------------------------
+
+bool ScopedSSBS::supported()
+{
+#if defined(__aarch64__)
+    return UserFeatures::instance().FEAT_SSBS();
+#else
+    return false;
+#endif
+}
+
+bool ScopedSSBS::get()
+{
+    uint64_t value = 0;
+#if defined(__aarch64__)
+    if (supported()) {
+        asm volatile("mrs %0, s3_3_c4_c2_6" : "=r" (value));
+    }
+#endif
+    return (value & CSR_SSBS_BIT) != 0;
+}
+
+bool ScopedSSBS::set(bool ssbs)
+{
+#if defined(__aarch64__)
+    if (supported()) {
+#if defined(__linux__) && defined(PR_SPEC_STORE_BYPASS)
+        // Update the per-thread control first, the kernel would restore the previous mode
+        // on the next thread switch. With PR_SPEC_ENABLE, the bypass is allowed (SSBS set).
+        const int ctrl = ::prctl(PR_GET_SPECULATION_CTRL, PR_SPEC_STORE_BYPASS, 0, 0, 0);
+        if (ctrl >= 0 && (ctrl & PR_SPEC_PRCTL) != 0) {
+            ::prctl(PR_SET_SPECULATION_CTRL, PR_SPEC_STORE_BYPASS, ssbs ? PR_SPEC_ENABLE : PR_SPEC_DISABLE, 0, 0);
+        }
+#endif
+        const uint64_t value = ssbs ? CSR_SSBS_BIT : 0;
+        asm volatile("msr s3_3_c4_c2_6, %0" : : "r" (value) : "memory");
+    }
+#endif
+    return supported() && get() == ssbs;
+}
+
+ScopedSSBS::ScopedSSBS(bool ssbs) :
+    _previous(get()),
+    _applied(supported() && (_previous == ssbs || set(ssbs)))
+{
+}
+
+ScopedSSBS::~ScopedSSBS()
+{
+    if (get() != _previous) {
+        set(_previous);
+    }
+}
@@ -0,0 +1,83 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Scoped control of the PSTATE modes which are writable at EL0: DIT and SSBS.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+//
+// Scoped control of PSTATE.DIT (Data Independent Timing, FEAT_DIT).
+//
+// When PSTATE.DIT is set, the execution time of the data processing instructions, the
+// cryptographic instructions and most Advanced SIMD instructions is independent of the
+// values of their operands. Cryptographic code should run with DIT set. The constructor
+// sets the requested mode, the destructor restores the previous one. PSTATE.DIT is private
+// to the thread. Without FEAT_DIT, or on Windows, the object does nothing.
+//
+class ScopedDIT
+{
+public:
+    // Constructor: set or clear PSTATE.DIT.
+    ScopedDIT(bool dit = true);
+
+    // Destructor: restore the previous PSTATE.DIT.
+    ~ScopedDIT();
+
+    // Check if the requested mode is active, always false when not supported.
+    bool applied() const { return _applied; }
+
+    // Check if PSTATE.DIT is accessible (FEAT_DIT), get or set it for the current thread.
+    // Return false if the mode cannot be set.
+    static bool supported();
+    static bool get();
+    static bool set(bool dit);
+
+    ScopedDIT(const ScopedDIT&) = delete;
+    ScopedDIT& operator=(const ScopedDIT&) = delete;
+
+private:
+    bool _previous;
+    bool _applied;
+};
+
+//
+// Scoped control of PSTATE.SSBS (Speculative Store Bypass Safe, FEAT_SSBS).
+//
+// When PSTATE.SSBS is clear, a load cannot speculatively bypass an earlier store to an
+// unresolved address, this is the mitigation of Spectre variant 4. When it is set, the
+// bypass is allowed and the code runs faster. PSTATE.SSBS is private to the thread.
+//
+// On Linux, the kernel forces PSTATE.SSBS when switching threads, according to the
+// per-thread speculation control. The per-thread control is also updated using prctl()
+// when the kernel allows it. Without FEAT_SSBS, or on Windows, the object does nothing.
+//
+class ScopedSSBS
+{
+public:
+    // Constructor: set or clear PSTATE.SSBS. Clearing SSBS enables the mitigation.
+    ScopedSSBS(bool ssbs = false);
+
+    // Destructor: restore the previous PSTATE.SSBS.
+    ~ScopedSSBS();
+
+    // Check if the requested mode is active, always false when not supported.
+    bool applied() const { return _applied; }
+
+    // Check if PSTATE.SSBS is accessible (FEAT_SSBS), get or set it for the current thread.
+    // Return false if the mode cannot be set.
+    static bool supported();
+    static bool get();
+    static bool set(bool ssbs);
+
+    ScopedSSBS(const ScopedSSBS&) = delete;
+    ScopedSSBS& operator=(const ScopedSSBS&) = delete;
+
+private:
+    bool _previous;
+    bool _applied;
+};
@@ -31,10 +31,27 @@
 
 #include "qarma64.h"
 
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define CSR_USE_NEON 1
+#endif
+
 Qarma64::Qarma64(int rounds, size_t sbox_index) :
-    _rounds(rounds),
-    _sbox_index(sbox_index)
+    _rounds(std::min(std::max(rounds, 1), MAX_ROUNDS)),
+    _sbox_index(0)
 {
+    setSbox(sbox_index);
+}
+
+void Qarma64::setSbox(size_t index)
+{
+    _sbox_index = std::min<size_t>(index, 2);
+
+    // Tables on bytes, two cells at a time.
+    for (int b = 0; b < 256; b++) {
+        _sub[b] = uint8_t(sbox[_sbox_index][b >> 4] << 4) | sbox[_sbox_index][b & 0xF];
+        _sub_inv[b] = uint8_t(sbox_inv[_sbox_index][b >> 4] << 4) | sbox_inv[_sbox_index][b & 0xF];
+    }
 }
 
 const Qarma64::const_t Qarma64::c[8] = {
@@ -54,11 +71,6 @@ const Qarma64::sbox_t Qarma64::sbox_inv[3] = {
     { 5, 14, 13,  8, 10, 11,  1,  9,  2,  6, 15,  0,  4, 12,  7,  3}
 };
 
-const int Qarma64::t[16]     = { 0, 11,  6, 13, 10,  1, 12,  7,  5, 14,  3,  8, 15,  4,  9,  2 };
-const int Qarma64::t_inv[16] = { 0,  5, 15, 10, 13,  8,  2,  7, 11, 14,  4,  1,  6,  3,  9, 12 };
-const int Qarma64::h[16]     = { 6,  5, 14, 15,  0,  1,  2,  3,  7, 12, 13,  4,  8,  9, 10, 11 };
-const int Qarma64::h_inv[16] = { 4,  5,  6,  7, 11,  1,  0,  8, 12, 13, 14, 15,  9, 10,  2,  3 };
-
 #define Q     Qarma64::M
 #define M_inv Qarma64::M
 
@@ -264,7 +276,7 @@ Qarma64::key_t Qarma64::backward_update_key(key_t T)
     return cell2text(temp);
 }
 
-Qarma64::text_t Qarma64::encrypt(text_t plaintext, tweak_t tweak, key_t w0, key_t k0)
+Qarma64::text_t Qarma64::encryptReference(text_t plaintext, tweak_t tweak, key_t w0, key_t k0)
 {
     key_t w1 = ((w0 >> 1) | (w0 << (64 - 1))) ^ (w0 >> (16 * m - 1));
     key_t k1 = k0;
@@ -288,7 +300,7 @@ Qarma64::text_t Qarma64::encrypt(text_t plaintext, tweak_t tweak, key_t w0, key_
     return is;
 }
 
-Qarma64::text_t Qarma64::decrypt(text_t plaintext, tweak_t tweak, key_t w0, key_t k0)
+Qarma64::text_t Qarma64::decryptReference(text_t plaintext, tweak_t tweak, key_t w0, key_t k0)
 {
     key_t w1 = w0;
     w0 = ((w0 >> 1) | (w0 << (64 - 1))) ^ (w0 >> (16 * m - 1));
@@ -332,3 +344,272 @@ Qarma64::text_t Qarma64::decrypt(text_t plaintext, tweak_t tweak, key_t w0, key_
     is ^= w1;
     return is;
 }
+
+//----------------------------------------------------------------------------
+// Word-parallel implementation.
+//----------------------------------------------------------------------------
+
+constexpr Qarma64::Permutation Qarma64::make_permutation(const int* p)
+{
+    Permutation perm {0, {}, {}};
+    for (int i = 0; i < 16; i++) {
+        // Cell i is in bits 4*(15-i) to 4*(15-i)+3, it receives cell p[i].
+        const int shift = 4 * (p[i] - i);
+        int g = 0;
+        while (g < perm.count && perm.shift[g] != shift) {
+            g++;
+        }
+        if (g == perm.count) {
+            perm.shift[perm.count++] = shift;
+        }
+        perm.mask[g] |= text_t(0xF) << (4 * (15 - i));
+    }
+    return perm;
+}
+
+const Qarma64::Permutation Qarma64::perm_t = make_permutation(t);
+const Qarma64::Permutation Qarma64::perm_t_inv = make_permutation(t_inv);
+const Qarma64::Permutation Qarma64::perm_h = make_permutation(h);
+const Qarma64::Permutation Qarma64::perm_h_inv = make_permutation(h_inv);
+
+Qarma64::text_t Qarma64::permute(text_t is, const Permutation& perm)
+{
+    text_t res = 0;
+    for (int g = 0; g < perm.count; g++) {
+        res |= (perm.shift[g] >= 0 ? is << perm.shift[g] : is >> -perm.shift[g]) & perm.mask[g];
+    }
+    return res;
+}
+
+Qarma64::text_t Qarma64::mix_columns(text_t is)
+{
+    // Each row is 16 bits. M is circulant: row x = rot1(row x+1) ^ rot2(row x+2) ^ rot1(row x+3),
+    // where rotN is a left rotation of each cell by N bits. Rotating the word by 16 bits
+    // moves row x+1 in row x. The same matrix is used for M, M_inv and Q.
+    const text_t r1 = ((is << 16) | (is >> 48)) ^ ((is << 48) | (is >> 16));
+    const text_t r2 = (is << 32) | (is >> 32);
+    return (((r1 << 1) & 0xEEEEEEEEEEEEEEEE) | ((r1 >> 3) & 0x1111111111111111)) ^
+           (((r2 << 2) & 0xCCCCCCCCCCCCCCCC) | ((r2 >> 2) & 0x3333333333333333));
+}
+
+Qarma64::text_t Qarma64::sub_cells(text_t is, const uint8_t* table)
+{
+    text_t res = 0;
+    for (int i = 0; i < 64; i += 8) {
+        res |= text_t(table[(is >> i) & 0xFF]) << i;
+    }
+    return res;
+}
+
+Qarma64::text_t Qarma64::forward64(text_t is, key_t tk, int r) const
+{
+    is ^= tk;
+    if (r != 0) {
+        is = mix_columns(permute(is, perm_t));
+    }
+    return sub_cells(is, _sub);
+}
+
+Qarma64::text_t Qarma64::backward64(text_t is, key_t tk, int r) const
+{
+    is = sub_cells(is, _sub_inv);
+    if (r != 0) {
+        is = permute(mix_columns(is), perm_t_inv);
+    }
+    return is ^ tk;
+}
+
+Qarma64::text_t Qarma64::pseudo_reflect64(text_t is, key_t tk)
+{
+    return permute(mix_columns(permute(is, perm_t)) ^ tk, perm_t_inv);
+}
+
+// Cells 0, 1, 3, 4, 8, 11, 13 of the tweak go through the LFSR.
+static constexpr uint64_t QARMA_LFSR_CELLS = 0xFF0FF000F00F0F00;
+
+Qarma64::key_t Qarma64::forward_update_key64(key_t T)
+{
+    T = permute(T, perm_h);
+    // LFSR on each cell: (b0^b1, b3, b2, b1).
+    const key_t lfsr = ((T >> 1) & 0x7777777777777777) | (((T ^ (T >> 1)) & 0x1111111111111111) << 3);
+    return (T & ~QARMA_LFSR_CELLS) | (lfsr & QARMA_LFSR_CELLS);
+}
+
+// Key schedule. Decryption is an encryption with w0 and w1 swapped (after omega),
+// k0 ^ alpha as core key and M(k0) as reflector key.
+Qarma64::Key::Key(key_t w0, key_t k0, int rounds) :
+    _rounds(std::min(std::max(rounds, 1), MAX_ROUNDS)),
+    _encrypt(),
+    _decrypt()
+{
+    _encrypt.w0 = w0;
+    _encrypt.w1 = omega(w0);
+    _encrypt.k1 = k0;
+    _decrypt.w0 = omega(w0);
+    _decrypt.w1 = w0;
+    _decrypt.k1 = mix_columns(k0);
+    for (int i = 0; i < MAX_ROUNDS; i++) {
+        _encrypt.forward[i] = k0 ^ c[i];
+        _encrypt.backward[i] = k0 ^ c[i] ^ alpha;
+        _decrypt.forward[i] = k0 ^ alpha ^ c[i];
+        _decrypt.backward[i] = k0 ^ c[i];
+    }
+}
+
+// Common structure of encryption and decryption, with different key schedules.
+// The tweaks of the forward rounds are kept for the backward rounds.
+Qarma64::text_t Qarma64::crypt64(text_t is, tweak_t tweak, const Key::Schedule& ks, int rounds) const
+{
+    tweak_t tweaks[MAX_ROUNDS];
+    is ^= ks.w0;
+
+    for (int i = 0; i < rounds; i++) {
+        tweaks[i] = tweak;
+        is = forward64(is, ks.forward[i] ^ tweak, i);
+        tweak = forward_update_key64(tweak);
+    }
+
+    is = forward64(is, ks.w1 ^ tweak, 1);
+    is = pseudo_reflect64(is, ks.k1);
+    is = backward64(is, ks.w0 ^ tweak, 1);
+
+    for (int i = rounds - 1; i >= 0; i--) {
+        is = backward64(is, ks.backward[i] ^ tweaks[i], i);
+    }
+
+    return is ^ ks.w1;
+}
+
+Qarma64::text_t Qarma64::encrypt(text_t plaintext, tweak_t tweak, key_t w0, key_t k0)
+{
+    return encrypt(plaintext, tweak, makeKey(w0, k0));
+}
+
+Qarma64::text_t Qarma64::decrypt(text_t plaintext, tweak_t tweak, key_t w0, key_t k0)
+{
+    return decrypt(plaintext, tweak, makeKey(w0, k0));
+}
+
+void Qarma64::encryptBatch(text_t* output, Span<text_t> texts, Span<tweak_t> tweaks, key_t w0, key_t k0) const
+{
+    encryptBatch(output, texts, tweaks, makeKey(w0, k0));
+}
+
+void Qarma64::decryptBatch(text_t* output, Span<text_t> texts, Span<tweak_t> tweaks, key_t w0, key_t k0) const
+{
+    decryptBatch(output, texts, tweaks, makeKey(w0, k0));
+}
+
+
+//----------------------------------------------------------------------------
+// NEON implementation, same operations as the word-parallel one, two words per vector.
+//----------------------------------------------------------------------------
+
+#if defined(CSR_USE_NEON)
+namespace {
+
+    // Permutation of cells by groups, see Qarma64::permute().
+    inline uint64x2_t neon_permute(uint64x2_t x, int count, const int* shift, const uint64_t* mask)
+    {
+        uint64x2_t res = vdupq_n_u64(0);
+        for (int g = 0; g < count; g++) {
+            // A negative shift count is a right shift.
+            res = vorrq_u64(res, vandq_u64(vshlq_u64(x, vdupq_n_s64(shift[g])), vdupq_n_u64(mask[g])));
+        }
+        return res;
+    }
+
+    template <int N>
+    inline uint64x2_t neon_rotl(uint64x2_t x)
+    {
+        return vorrq_u64(vshlq_n_u64(x, N), vshrq_n_u64(x, 64 - N));
+    }
+
+    inline uint64x2_t neon_mix_columns(uint64x2_t x)
+    {
+        const uint64x2_t r1 = veorq_u64(neon_rotl<16>(x), neon_rotl<48>(x));
+        const uint64x2_t r2 = neon_rotl<32>(x);
+        return veorq_u64(vorrq_u64(vandq_u64(vshlq_n_u64(r1, 1), vdupq_n_u64(0xEEEEEEEEEEEEEEEE)), vandq_u64(vshrq_n_u64(r1, 3), vdupq_n_u64(0x1111111111111111))),
+                         vorrq_u64(vandq_u64(vshlq_n_u64(r2, 2), vdupq_n_u64(0xCCCCCCCCCCCCCCCC)), vandq_u64(vshrq_n_u64(r2, 2), vdupq_n_u64(0x3333333333333333))));
+    }
+
+    // S-box on all 32 cells of the vector, one TBL lookup per half byte.
+    inline uint64x2_t neon_sub_cells(uint64x2_t x, uint8x16_t sbox)
+    {
+        const uint8x16_t b = vreinterpretq_u8_u64(x);
+        const uint8x16_t lo = vqtbl1q_u8(sbox, vandq_u8(b, vdupq_n_u8(0x0F)));
+        const uint8x16_t hi = vqtbl1q_u8(sbox, vshrq_n_u8(b, 4));
+        return vreinterpretq_u64_u8(vorrq_u8(vshlq_n_u8(hi, 4), lo));
+    }
+
+    // LFSR on selected cells, see Qarma64::forward_update_key64().
+    inline uint64x2_t neon_lfsr(uint64x2_t x, uint64x2_t cells)
+    {
+        const uint64x2_t lfsr = vorrq_u64(vandq_u64(vshrq_n_u64(x, 1), vdupq_n_u64(0x7777777777777777)),
+                                          vshlq_n_u64(vandq_u64(veorq_u64(x, vshrq_n_u64(x, 1)), vdupq_n_u64(0x1111111111111111)), 3));
+        return vbslq_u64(cells, lfsr, x);
+    }
+}
+#endif
+
+void Qarma64::crypt_batch(text_t* output, Span<text_t> texts, Span<tweak_t> tweaks, const Key::Schedule& ks, int rounds) const
+{
+    const size_t count = std::min(texts.size(), tweaks.size());
+    size_t index = 0;
+
+#if defined(CSR_USE_NEON)
+    #define PERM(p) p.count, p.shift, p.mask
+    const uint8x16_t sb = vld1q_u8(sbox[_sbox_index]);
+    const uint8x16_t sb_inv = vld1q_u8(sbox_inv[_sbox_index]);
+    const uint64x2_t lfsr_cells = vdupq_n_u64(QARMA_LFSR_CELLS);
+    const uint64x2_t vw0 = vdupq_n_u64(ks.w0);
+    const uint64x2_t vw1 = vdupq_n_u64(ks.w1);
+    const uint64x2_t vk1 = vdupq_n_u64(ks.k1);
+
+    // Four values per iteration, in two independent vectors to hide the latencies.
+    for (; index + 4 <= count; index += 4) {
+        uint64x2_t is[2], tw[2], tws[MAX_ROUNDS][2];
+        for (int j = 0; j < 2; j++) {
+            is[j] = veorq_u64(vld1q_u64(texts.data() + index + 2 * j), vw0);
+            tw[j] = vld1q_u64(tweaks.data() + index + 2 * j);
+        }
+        for (int i = 0; i < rounds; i++) {
+            const uint64x2_t kc = vdupq_n_u64(ks.forward[i]);
+            for (int j = 0; j < 2; j++) {
+                tws[i][j] = tw[j];
+                is[j] = veorq_u64(is[j], veorq_u64(kc, tw[j]));
+                if (i != 0) {
+                    is[j] = neon_mix_columns(neon_permute(is[j], PERM(perm_t)));
+                }
+                is[j] = neon_sub_cells(is[j], sb);
+                tw[j] = neon_lfsr(neon_permute(tw[j], PERM(perm_h)), lfsr_cells);
+            }
+        }
+        for (int j = 0; j < 2; j++) {
+            // Forward, pseudo-reflect, backward.
+            is[j] = neon_sub_cells(neon_mix_columns(neon_permute(veorq_u64(is[j], veorq_u64(vw1, tw[j])), PERM(perm_t))), sb);
+            is[j] = neon_permute(veorq_u64(neon_mix_columns(neon_permute(is[j], PERM(perm_t))), vk1), PERM(perm_t_inv));
+            is[j] = veorq_u64(neon_permute(neon_mix_columns(neon_sub_cells(is[j], sb_inv)), PERM(perm_t_inv)), veorq_u64(vw0, tw[j]));
+        }
+        for (int i = rounds - 1; i >= 0; i--) {
+            const uint64x2_t kc = vdupq_n_u64(ks.backward[i]);
+            for (int j = 0; j < 2; j++) {
+                is[j] = neon_sub_cells(is[j], sb_inv);
+                if (i != 0) {
+                    is[j] = neon_permute(neon_mix_columns(is[j]), PERM(perm_t_inv));
+                }
+                is[j] = veorq_u64(is[j], veorq_u64(kc, tws[i][j]));
+            }
+        }
+        for (int j = 0; j < 2; j++) {
+            vst1q_u64(output + index + 2 * j, veorq_u64(is[j], vw1));
+        }
+    }
+    #undef PERM
+#endif
+
+    // Remaining values, or all of them without NEON.
+    for (; index < count; index++) {
+        output[index] = crypt64(texts[index], tweaks[index], ks, rounds);
+    }
+}
@@ -31,6 +31,7 @@
 
 #pragma once
 
+#include "span.h"
 #include <algorithm>
 #include <cstddef>
 #include <cinttypes>
@@ -51,18 +52,62 @@ public:
     // SBOX index 2 is the default in Armv8.3-a.
     Qarma64(int rounds = 5, size_t sbox_index = 2);
 
+    // Maximum number of rounds.
+    static constexpr int MAX_ROUNDS = 8;
+
+    // Precomputed key schedule for one key and one number of rounds. Build it once to
+    // encrypt or decrypt many values under the same key. The S-box is not part of the
+    // key schedule, it remains the one of the Qarma64 instance which uses it.
+    class Key
+    {
+    public:
+        Key(key_t w0 = 0, key_t k0 = 0, int rounds = 5);
+        int rounds() const { return _rounds; }
+    private:
+        friend class Qarma64;
+        // Keys in one direction: whitening keys, reflector key, round keys with constants.
+        struct Schedule {
+            key_t w0, w1, k1;
+            key_t forward[MAX_ROUNDS];   // k0 ^ c[i]
+            key_t backward[MAX_ROUNDS];  // k0 ^ c[i] ^ alpha
+        };
+        int      _rounds;
+        Schedule _encrypt;
+        Schedule _decrypt;
+    };
+
+    // Build a key schedule with the current number of rounds.
+    Key makeKey(key_t w0, key_t k0) const { return Key(w0, k0, _rounds); }
+
     text_t encrypt(text_t plaintext, tweak_t tweak, key_t w0, key_t k0);
     text_t decrypt(text_t plaintext, tweak_t tweak, key_t w0, key_t k0);
+    text_t encrypt(text_t plaintext, tweak_t tweak, const Key& key) const { return crypt64(plaintext, tweak, key._encrypt, key._rounds); }
+    text_t decrypt(text_t plaintext, tweak_t tweak, const Key& key) const { return crypt64(plaintext, tweak, key._decrypt, key._rounds); }
 
-    void setRounds(int rounds) { _rounds = std::max(rounds, 1); }
+    // Encrypt or decrypt a batch of values, each one with its own tweak, under the same key.
+    // The number of processed values is the smallest size of texts and tweaks, the output
+    // array must be large enough. On Arm64, four values are processed in parallel with NEON.
+    void encryptBatch(text_t* output, Span<text_t> texts, Span<tweak_t> tweaks, key_t w0, key_t k0) const;
+    void decryptBatch(text_t* output, Span<text_t> texts, Span<tweak_t> tweaks, key_t w0, key_t k0) const;
+    void encryptBatch(text_t* output, Span<text_t> texts, Span<tweak_t> tweaks, const Key& key) const { crypt_batch(output, texts, tweaks, key._encrypt, key._rounds); }
+    void decryptBatch(text_t* output, Span<text_t> texts, Span<tweak_t> tweaks, const Key& key) const { crypt_batch(output, texts, tweaks, key._decrypt, key._rounds); }
+
+    // Reference implementation, cell by cell, as in the paper. Much slower, same results.
+    text_t encryptReference(text_t plaintext, tweak_t tweak, key_t w0, key_t k0);
+    text_t decryptReference(text_t plaintext, tweak_t tweak, key_t w0, key_t k0);
+
+    // The number of rounds is limited to 1 to MAX_ROUNDS, the size of the round constants.
+    void setRounds(int rounds) { _rounds = std::min(std::max(rounds, 1), MAX_ROUNDS); }
     size_t getRounds() { return _rounds; }
 
-    void setSbox(size_t index) { _sbox_index = std::min<size_t>(index, 2); }
+    void setSbox(size_t index);
     size_t getSbox() { return _sbox_index; }
 
 private:
-    int    _rounds;
-    size_t _sbox_index;
+    int     _rounds;
+    size_t  _sbox_index;
+    uint8_t _sub[256];      // current S-box on the two cells of a byte
+    uint8_t _sub_inv[256];  // same with inverse S-box
 
     typedef uint64_t const_t;
     typedef uint8_t cell_t;
@@ -78,15 +123,39 @@ private:
     static key_t forward_update_key(key_t T);
     static key_t backward_update_key(key_t T);
 
+    // Word-parallel implementation: the 16 cells stay in a 64-bit word, cell 0 in the
+    // most significant nibble. A permutation of cells is made of groups of cells which
+    // move by the same distance, one shift and one mask per group.
+    struct Permutation {
+        int    count;
+        int    shift[16];  // left shift when positive, right shift when negative
+        text_t mask[16];   // destination cells of the group
+    };
+    static constexpr Permutation make_permutation(const int* p);
+    static text_t permute(text_t is, const Permutation& perm);
+    static text_t mix_columns(text_t is);
+    static text_t sub_cells(text_t is, const uint8_t* table);
+    text_t forward64(text_t is, key_t tk, int r) const;
+    text_t backward64(text_t is, key_t tk, int r) const;
+    static text_t pseudo_reflect64(text_t is, key_t tk);
+    static key_t forward_update_key64(key_t T);
+    static key_t omega(key_t w0) { return ((w0 >> 1) | (w0 << (64 - 1))) ^ (w0 >> (16 * m - 1)); }
+    text_t crypt64(text_t is, tweak_t tweak, const Key::Schedule& ks, int rounds) const;
+    void crypt_batch(text_t* output, Span<text_t> texts, Span<tweak_t> tweaks, const Key::Schedule& ks, int rounds) const;
+
     static constexpr size_t MAX_LENGTH = 64;
     static constexpr size_t m = MAX_LENGTH / 16;
     static constexpr const_t alpha = 0xC0AC29B7C97C50DD;
     static const const_t c[8];
     static const sbox_t sbox[3];
     static const sbox_t sbox_inv[3];
-    static const int t[16];
-    static const int t_inv[16];
-    static const int h[16];
-    static const int h_inv[16];
+    static constexpr int t[16]     = { 0, 11,  6, 13, 10,  1, 12,  7,  5, 14,  3,  8, 15,  4,  9,  2 };
+    static constexpr int t_inv[16] = { 0,  5, 15, 10, 13,  8,  2,  7, 11, 14,  4,  1,  6,  3,  9, 12 };
+    static constexpr int h[16]     = { 6,  5, 14, 15,  0,  1,  2,  3,  7, 12, 13,  4,  8,  9, 10, 11 };
+    static constexpr int h_inv[16] = { 4,  5,  6,  7, 11,  1,  0,  8, 12, 13, 14, 15,  9, 10,  2,  3 };
     static const cell_t M[16];
+    static const Permutation perm_t;
+    static const Permutation perm_t_inv;
+    static const Permutation perm_h;
+    static const Permutation perm_h_inv;
 };
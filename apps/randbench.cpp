@@ -0,0 +1,220 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Benchmark of the hardware random numbers (RNDR, RNDRRS) against the
+// random source of the operating system.
+//
+// For each buffer size, the buffer is filled using RandomSource on the user
+// path (RNDR at EL0) and the kernel path (batch command of the kernel module),
+// with RNDR and RNDRRS, and using getrandom() on Linux or getentropy() on macOS.
+//
+// The results are displayed in CSV format.
+//
+//----------------------------------------------------------------------------
+
+#include "randomsource.h"
+#include "strutils.h"
+#include "regaccess.h"
+#include "userfeatures.h"
+#include "cputimer.h"
+
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+    #include <sys/random.h>
+#elif defined(__APPLE__)
+    #include <unistd.h>
+    #include <sys/random.h>
+#endif
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    size_t      max_size;
+    size_t      samples;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -m size : maximum buffer size in bytes (default: 1 MB)" << std::endl
+              << "  -s count : number of measured samples, the median is reported (default: 21)" << std::endl
+              << std::endl
+              << "Buffer sizes are 8 bytes to the maximum size, by powers of 8." << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    max_size(1024 * 1024),
+    samples(21)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-m" && i+1 < argc) {
+            max_size = std::max<size_t>(8, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else if (arg == "-s" && i+1 < argc) {
+            samples = std::max<size_t>(1, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else {
+            fatal("invalid option " + arg + ", try --help");
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Time measurement, using the virtual counter (see CpuTimer).
+//----------------------------------------------------------------------------
+
+// Number of warm-up samples.
+static constexpr size_t BENCH_WARMUP = 2;
+
+// Time a function which fills 'size' bytes, display one CSV line.
+// The function returns false on error, which stops the measurement.
+static void Bench(const Options& opt, const std::string& source, size_t size, const std::function<bool()>& func)
+{
+    const CpuTimer& timer(CpuTimer::instance());
+    std::vector<double> ns(opt.samples);
+    for (size_t i = 0; i < BENCH_WARMUP; i++) {
+        if (!func()) {
+            std::cout << "# " << source << " failed at size " << size << std::endl;
+            return;
+        }
+    }
+    for (auto& t : ns) {
+        const csr_u64_t start = timer.read();
+        func();
+        t = timer.elapsed(start, timer.read());
+    }
+    std::sort(ns.begin(), ns.end());
+    const double median = ns[ns.size() / 2];
+    const double p99 = ns[(ns.size() * 99 + 99) / 100 - 1];
+
+    std::cout << size << "," << source << ","
+              << Format("%.1f,%.1f,%.1f", median, p99, median > 0 ? double(size) * 1000.0 / median : 0.0) << std::endl;
+}
+
+
+//----------------------------------------------------------------------------
+// Random source of the operating system.
+//----------------------------------------------------------------------------
+
+#if defined(__linux__)
+    #define SYSTEM_RANDOM "getrandom"
+#elif defined(__APPLE__)
+    #define SYSTEM_RANDOM "getentropy"
+#endif
+
+#if defined(SYSTEM_RANDOM)
+static bool SystemRandom(uint8_t* buffer, size_t size)
+{
+#if defined(__linux__)
+    while (size > 0) {
+        const ssize_t ret = ::getrandom(buffer, size, 0);
+        if (ret <= 0) {
+            return false;
+        }
+        buffer += ret;
+        size -= size_t(ret);
+    }
+#else
+    // getentropy() is limited to 256 bytes per call.
+    for (size_t done = 0; done < size; done += 256) {
+        if (::getentropy(buffer + done, std::min<size_t>(256, size - done)) != 0) {
+            return false;
+        }
+    }
+#endif
+    return true;
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Application entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    const Options opt(argc, argv);
+    const CpuTimer& timer(CpuTimer::instance());
+    RegAccess regs;
+
+    // All available hardware sources.
+    std::list<RandomSource> sources;
+    for (bool reseeded : {false, true}) {
+        for (RandomSource::Path path : {RandomSource::USER, RandomSource::KERNEL}) {
+            sources.emplace_back(reseeded, &regs);
+            if (!sources.back().setPath(path)) {
+                sources.pop_back();
+            }
+        }
+    }
+
+    std::cout << "# counter_frequency," << timer.frequency() << std::endl
+              << "# timer," << timer.sourceName() << std::endl
+              << "# user_rng," << int(UserFeatures::instance().FEAT_RNG()) << std::endl
+              << "# kernel," << int(regs.isOpen()) << std::endl
+              << "size,source,median_ns,p99_ns,mbytes_per_s" << std::endl;
+
+    if (sources.empty()) {
+        std::cout << "# no hardware random source, FEAT_RNG not available" << std::endl;
+    }
+
+    std::vector<uint64_t> buffer((opt.max_size + 7) / 8);
+    uint8_t* const data = reinterpret_cast<uint8_t*>(buffer.data());
+    for (size_t size = 8; size <= opt.max_size; size *= 8) {
+        for (const auto& src : sources) {
+            Bench(opt, src.pathName(), size, [&]() { return src.fill(data, size); });
+        }
+#if defined(SYSTEM_RANDOM)
+        Bench(opt, SYSTEM_RANDOM, size, [&]() { return SystemRandom(data, size); });
+#endif
+    }
+
+    for (const auto& src : sources) {
+        if (src.retries() > 0) {
+            std::cout << "# " << src.pathName() << " retries," << src.retries() << std::endl;
+        }
+    }
+    return EXIT_SUCCESS;
+}
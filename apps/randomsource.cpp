@@ -0,0 +1,150 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Hardware random numbers, from RNDR or RNDRRS (FEAT_RNG).
+//
+//----------------------------------------------------------------------------
+
+#include "randomsource.h"
+#include "regaccess.h"
+#include "userfeatures.h"
+#include <algorithm>
+#include <cstring>
+
+
+//----------------------------------------------------------------------------
+// Constructor.
+//----------------------------------------------------------------------------
+
+RandomSource::RandomSource(bool reseeded, RegAccess* regs) :
+    _reseeded(reseeded),
+    _regs(regs != nullptr ? regs : &RegAccess::shared())
+{
+    if (!probe(USER)) {
+        probe(KERNEL);
+    }
+}
+
+const RandomSource& RandomSource::instance()
+{
+    // Thread-safe initialization, the first time only.
+    static const RandomSource source;
+    return source;
+}
+
+bool RandomSource::setPath(Path path)
+{
+    return path == NONE ? (_path = NONE, true) : probe(path);
+}
+
+bool RandomSource::probe(Path path)
+{
+    uint64_t value = 0;
+    if ((path == USER && UserFeatures::instance().FEAT_RNG() && fillUser(&value, 1)) ||
+        (path == KERNEL && _regs->isOpen() && fillKernel(&value, 1)))
+    {
+        _path = path;
+        return true;
+    }
+    return false;
+}
+
+std::string RandomSource::pathName() const
+{
+    switch (_path) {
+        case USER: return _reseeded ? "user-rndrrs" : "user-rndr";
+        case KERNEL: return _reseeded ? "kernel-rndrrs" : "kernel-rndr";
+        case NONE:
+        default: return "none";
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Fill buffers.
+//----------------------------------------------------------------------------
+
+bool RandomSource::fill(uint64_t* values, size_t count) const
+{
+    switch (_path) {
+        case USER: return fillUser(values, count);
+        case KERNEL: return fillKernel(values, count);
+        case NONE:
+        default: return false;
+    }
+}
+
+bool RandomSource::fill(void* buffer, size_t size) const
+{
+    // Fill the complete 64-bit words in place, then the last partial word.
+    uint8_t* data = static_cast<uint8_t*>(buffer);
+    const size_t words = size / sizeof(uint64_t);
+    const size_t tail = size % sizeof(uint64_t);
+    uint64_t last = 0;
+    if (reinterpret_cast<uintptr_t>(data) % alignof(uint64_t) == 0) {
+        if (!fill(reinterpret_cast<uint64_t*>(data), words)) {
+            return false;
+        }
+    }
+    else {
+        for (size_t i = 0; i < words; i++) {
+            if (!next(last)) {
+                return false;
+            }
+            ::memcpy(data + i * sizeof(uint64_t), &last, sizeof(uint64_t));
+        }
+    }
+    if (tail > 0) {
+        if (!next(last)) {
+            return false;
+        }
+        ::memcpy(data + words * sizeof(uint64_t), &last, tail);
+    }
+    return true;
+}
+
+bool RandomSource::fillUser(uint64_t* values, size_t count) const
+{
+    csr_u64_t value = 0;
+    int ok = 0;
+    for (size_t i = 0; i < count; i++) {
+        int retry = 0;
+        for (ok = 0; !ok && retry < CSR_RANDOM_RETRY; retry++) {
+            if (_reseeded) {
+                csr_rndr(value, ok, CSR_SREG_RNDRRS);
+            }
+            else {
+                csr_rndr(value, ok, CSR_SREG_RNDR);
+            }
+        }
+        if (retry > 1) {
+            _retries.fetch_add(retry - 1, std::memory_order_relaxed);
+        }
+        if (!ok) {
+            return false;
+        }
+        values[i] = value;
+    }
+    return true;
+}
+
+bool RandomSource::fillKernel(uint64_t* values, size_t count) const
+{
+    csr_random_t rnd;
+    while (count > 0) {
+        rnd.count = std::min<size_t>(count, CSR_RANDOM_MAX);
+        rnd.reseeded = _reseeded;
+        if (!_regs->readRandom(rnd) || rnd.status != 0 || rnd.count == 0) {
+            return false;
+        }
+        for (size_t i = 0; i < rnd.count; i++) {
+            values[i] = rnd.values[i];
+        }
+        values += rnd.count;
+        count -= rnd.count;
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Hardware random numbers, from RNDR or RNDRRS (FEAT_RNG).
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class RegAccess;
+
+//
+// A source of random numbers, using the RNDR or RNDRRS instructions.
+//
+// When FEAT_RNG is visible at EL0, the instructions are directly executed in
+// the application. Otherwise, the kernel module fills buffers of up to
+// CSR_RANDOM_MAX values in one call. When no entropy is available in a
+// reasonable time, the instruction fails (NZCV) and is retried up to
+// CSR_RANDOM_RETRY times before reporting an error.
+//
+// The user path can be used from any thread. The kernel path uses one RegAccess
+// instance, use one RandomSource per thread when the kernel path is used concurrently.
+//
+class RandomSource
+{
+public:
+    // How the random numbers are read.
+    enum Path {NONE, USER, KERNEL};
+
+    // Constructor. Use RNDRRS (reseeded before each read) instead of RNDR when 'reseeded' is true.
+    // The kernel path is used only when FEAT_RNG is not visible at EL0.
+    RandomSource(bool reseeded = false, RegAccess* regs = nullptr);
+
+    // Force a path, for benchmarks. Return false if the path is not available.
+    bool setPath(Path path);
+
+    // Get a process-wide instance on RNDR, initialized on first use.
+    static const RandomSource& instance();
+
+    // Source characteristics.
+    bool valid() const { return _path != NONE; }
+    Path path() const { return _path; }
+    bool reseeded() const { return _reseeded; }
+    std::string pathName() const;
+
+    // Fill a buffer with random bytes or 64-bit values. Return false on failure of the entropy source.
+    bool fill(void* buffer, size_t size) const;
+    bool fill(uint64_t* values, size_t count) const;
+
+    // Get one random value.
+    bool next(uint64_t& value) const { return fill(&value, 1); }
+
+    // Total number of failed reads which were retried.
+    uint64_t retries() const { return _retries.load(std::memory_order_relaxed); }
+
+private:
+    bool       _reseeded = false;
+    Path       _path = NONE;
+    RegAccess* _regs = nullptr;
+    mutable std::atomic<uint64_t> _retries {0};
+
+    // Check if a path is working.
+    bool probe(Path path);
+
+    // Read values on the user and kernel paths.
+    bool fillUser(uint64_t* values, size_t count) const;
+    bool fillKernel(uint64_t* values, size_t count) const;
+};
@@ -10,13 +10,24 @@
 
 #include "regaccess.h"
 #include "strutils.h"
+#include "restrictions.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdio>
 #include <cstdlib>
+#include <mutex>
+#include <ostream>
+#include <thread>
 
 #if defined(__linux__)
     #include <unistd.h>
     #include <fcntl.h>
     #include <sys/ioctl.h>
+    #include <sys/mman.h>
+    #include <poll.h>
 #elif defined(__APPLE__)
     #include <unistd.h>
     #include <sys/socket.h>
@@ -30,11 +41,13 @@
 // Constructor and destructor.
 //----------------------------------------------------------------------------
 
+thread_local RegAccess::SysError RegAccess::_error = CSR_SUCCESS;
+thread_local std::string RegAccess::_error_ref;
+thread_local size_t RegAccess::_error_count = 0;
+
 RegAccess::RegAccess(bool print_errors, bool exit_on_open_error) :
     _fd(CSR_INVALID_SYSHANDLE),
-    _print_errors(print_errors),
-    _error(CSR_SUCCESS),
-    _error_ref()
+    _print_errors(print_errors)
 {
 #if defined(__linux__)
 
@@ -76,7 +89,8 @@ RegAccess::RegAccess(bool print_errors, bool exit_on_open_error) :
 #elif defined(WINDOWS)
 
     // Open the pseudo-device for the kernel driver.
-    _fd = ::CreateFileA(CSR_DEVICE_NAME, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    // Overlapped I/O: several threads can use the same handle without serializing their requests.
+    _fd = ::CreateFileA(CSR_DEVICE_NAME, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
     if (_fd == INVALID_HANDLE_VALUE) {
         setError(::GetLastError(), "Error opening " CSR_DEVICE_NAME ", kernel driver probably not loaded", false, exit_on_open_error);
         return;
@@ -86,6 +100,18 @@ RegAccess::RegAccess(bool print_errors, bool exit_on_open_error) :
 }
 
 
+//----------------------------------------------------------------------------
+// Process-wide shared instance.
+//----------------------------------------------------------------------------
+
+RegAccess& RegAccess::shared()
+{
+    // Thread-safe initialization, the first time only.
+    static RegAccess instance;
+    return instance;
+}
+
+
 //----------------------------------------------------------------------------
 // Close the kernel module, check if open.
 //----------------------------------------------------------------------------
@@ -112,20 +138,69 @@ void RegAccess::close()
 }
 
 
+//----------------------------------------------------------------------------
+// Windows: DeviceIoControl() on the overlapped device handle.
+//----------------------------------------------------------------------------
+
+#if defined(WINDOWS)
+bool RegAccess::deviceControl(::DWORD cmd, void* in, size_t in_size, void* out, size_t out_size, ::DWORD* retsize)
+{
+    // One event per thread, reused by all requests of this thread, on all devices.
+    struct ThreadEvent {
+        ::HANDLE handle = ::CreateEventA(nullptr, TRUE, FALSE, nullptr);
+        ~ThreadEvent() { if (handle != nullptr) { ::CloseHandle(handle); } }
+    };
+    static thread_local ThreadEvent event;
+
+    // The driver completes the requests in the dispatch routine, DeviceIoControl() then
+    // succeeds at once and the wait is only a fallback. To reduce the number of calls,
+    // use executeRequests(), one call per CSR_REQUESTS_MAX requests.
+    ::OVERLAPPED overlapped;
+    Zero(&overlapped, sizeof(overlapped));
+    overlapped.hEvent = event.handle;
+    ::DWORD size = 0;
+    const bool success = ::DeviceIoControl(_fd, cmd, in, ::DWORD(in_size), out, ::DWORD(out_size), &size, &overlapped) ||
+                         (::GetLastError() == ERROR_IO_PENDING && ::GetOverlappedResult(_fd, &overlapped, &size, TRUE));
+    if (retsize != nullptr) {
+        *retsize = size;
+    }
+    return success;
+}
+#endif
+
+
 //----------------------------------------------------------------------------
 // Error reporting.
 //----------------------------------------------------------------------------
 
-void RegAccess::printLastError(const std::string& label, std::ostream& file) const
+std::string RegAccess::lastErrorMessage(const std::string& label) const
 {
+    std::string message;
     if (_error != CSR_SUCCESS) {
         if (!label.empty()) {
-            file << label << ": ";
+            message.append(label);
+            message.append(": ");
         }
         if (!_error_ref.empty()) {
-            file << _error_ref << ": ";
+            message.append(_error_ref);
+            message.append(": ");
         }
-        file << Error(_error) << std::endl;
+        message.append(Error(_error));
+    }
+    return message;
+}
+
+void RegAccess::printLastError(const std::string& label) const
+{
+    if (_error != CSR_SUCCESS) {
+        std::fprintf(stderr, "%s\n", lastErrorMessage(label).c_str());
+    }
+}
+
+void RegAccess::printLastError(const std::string& label, std::ostream& file) const
+{
+    if (_error != CSR_SUCCESS) {
+        file << lastErrorMessage(label) << std::endl;
     }
 }
 
@@ -133,6 +208,7 @@ bool RegAccess::setError(SysError code, const std::string& ref, bool close_fd, b
 {
     _error = code;
     _error_ref = ref;
+    _error_count++;
     if (close_fd) {
         close();
     }
@@ -146,6 +222,181 @@ bool RegAccess::setError(SysError code, const std::string& ref, bool close_fd, b
 }
 
 
+//----------------------------------------------------------------------------
+// Instrumentation counters.
+//----------------------------------------------------------------------------
+
+namespace {
+    std::atomic<bool> StatsEnabled(false);
+}
+
+// Counters of one thread, in a process-wide list while the thread is alive.
+// Each counter is written by its thread only and read by any thread, using relaxed
+// atomics (no read-modify-write instruction). The counters of terminated threads
+// are accumulated in the list.
+class RegAccess::ThreadStats
+{
+public:
+    ThreadStats();
+    ~ThreadStats();
+    ThreadStats(const ThreadStats&) = delete;
+    ThreadStats& operator=(const ThreadStats&) = delete;
+
+    // Get the instance of the calling thread.
+    static ThreadStats& instance()
+    {
+        thread_local ThreadStats stats;
+        return stats;
+    }
+
+    // Record one call.
+    void record(int index, csr_u64_t ns, bool error);
+
+    // Process-wide list of threads, statistics of terminated threads and baseline of resetStats().
+    // Built on first use, not at static initialization.
+    struct Registry {
+        std::mutex mutex;
+        std::vector<ThreadStats*> threads;
+        std::vector<CallStats> terminated {std::vector<CallStats>(STATS_COUNT)};
+        std::vector<CallStats> baseline {std::vector<CallStats>(STATS_COUNT)};
+    };
+    static Registry& registry()
+    {
+        static Registry reg;
+        return reg;
+    }
+
+    // Add the statistics of all threads. The mutex shall be held by the caller.
+    static void addAll(std::vector<CallStats>& stats);
+
+private:
+    struct Counters {
+        std::atomic<csr_u64_t> calls {0};
+        std::atomic<csr_u64_t> errors {0};
+        std::atomic<csr_u64_t> total_ns {0};
+        std::atomic<csr_u64_t> max_ns {0};
+    };
+    std::array<Counters, STATS_COUNT> _counters;
+
+    // Add the statistics of this thread.
+    void addTo(std::vector<CallStats>& stats) const;
+};
+
+RegAccess::ThreadStats::ThreadStats()
+{
+    Registry& reg(registry());
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.threads.push_back(this);
+}
+
+RegAccess::ThreadStats::~ThreadStats()
+{
+    Registry& reg(registry());
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    addTo(reg.terminated);
+    reg.threads.erase(std::find(reg.threads.begin(), reg.threads.end(), this));
+}
+
+void RegAccess::ThreadStats::record(int index, csr_u64_t ns, bool error)
+{
+    Counters& c(_counters[size_t(index)]);
+    c.calls.store(c.calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    c.errors.store(c.errors.load(std::memory_order_relaxed) + error, std::memory_order_relaxed);
+    c.total_ns.store(c.total_ns.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    if (ns > c.max_ns.load(std::memory_order_relaxed)) {
+        c.max_ns.store(ns, std::memory_order_relaxed);
+    }
+}
+
+void RegAccess::ThreadStats::addTo(std::vector<CallStats>& stats) const
+{
+    for (size_t i = 0; i < _counters.size(); i++) {
+        stats[i].calls += _counters[i].calls.load(std::memory_order_relaxed);
+        stats[i].errors += _counters[i].errors.load(std::memory_order_relaxed);
+        stats[i].total_ns += _counters[i].total_ns.load(std::memory_order_relaxed);
+        stats[i].max_ns = std::max(stats[i].max_ns, _counters[i].max_ns.load(std::memory_order_relaxed));
+    }
+}
+
+void RegAccess::ThreadStats::addAll(std::vector<CallStats>& stats)
+{
+    const Registry& reg(registry());
+    for (size_t i = 0; i < STATS_COUNT; i++) {
+        stats[i].calls += reg.terminated[i].calls;
+        stats[i].errors += reg.terminated[i].errors;
+        stats[i].total_ns += reg.terminated[i].total_ns;
+        stats[i].max_ns = std::max(stats[i].max_ns, reg.terminated[i].max_ns);
+    }
+    for (const auto* ts : reg.threads) {
+        ts->addTo(stats);
+    }
+}
+
+// Time one call to the kernel module, from constructor to destructor.
+// The call failed if setError() was called in between.
+class RegAccess::StatsProbe
+{
+public:
+    StatsProbe(int index) :
+        _index(StatsEnabled.load(std::memory_order_relaxed) ? index : -1),
+        _errors(_error_count),
+        _start(_index < 0 ? std::chrono::steady_clock::time_point() : std::chrono::steady_clock::now())
+    {
+    }
+    ~StatsProbe()
+    {
+        if (_index >= 0) {
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count();
+            ThreadStats::instance().record(_index, csr_u64_t(ns), _error_count != _errors);
+        }
+    }
+    StatsProbe(const StatsProbe&) = delete;
+    StatsProbe& operator=(const StatsProbe&) = delete;
+
+private:
+    int    _index;
+    size_t _errors;
+    std::chrono::steady_clock::time_point _start;
+};
+
+void RegAccess::enableStats(bool enable)
+{
+    StatsEnabled.store(enable, std::memory_order_relaxed);
+}
+
+bool RegAccess::statsEnabled()
+{
+    return StatsEnabled.load(std::memory_order_relaxed);
+}
+
+void RegAccess::getStats(std::vector<CallStats>& stats)
+{
+    stats.assign(STATS_COUNT, CallStats());
+    ThreadStats::Registry& reg(ThreadStats::registry());
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    ThreadStats::addAll(stats);
+    for (size_t i = 0; i < STATS_COUNT; i++) {
+        const CallStats& base(reg.baseline[i]);
+        stats[i].calls -= base.calls;
+        stats[i].errors -= base.errors;
+        stats[i].total_ns -= base.total_ns;
+        // The maximum cannot be reset, keep it only when there are new calls.
+        if (stats[i].calls == 0) {
+            stats[i].max_ns = 0;
+        }
+    }
+}
+
+void RegAccess::resetStats()
+{
+    std::vector<CallStats> stats(STATS_COUNT);
+    ThreadStats::Registry& reg(ThreadStats::registry());
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    ThreadStats::addAll(stats);
+    reg.baseline.swap(stats);
+}
+
+
 //----------------------------------------------------------------------------
 // Read CPU registers.
 //----------------------------------------------------------------------------
@@ -155,6 +406,7 @@ bool RegAccess::read(int regid, csr_u64_t& reg)
     if (!csr_regid_is_single(regid)) {
         return setError(EINVAL, "invalid register id");
     }
+    StatsProbe probe(regid);
 #if defined(__linux__)
     if (::ioctl(_fd, CSR_IOC_GET_REG(regid), &reg) < 0) {
         return setError(errno, "ioctl(GET_REG)");
@@ -165,8 +417,8 @@ bool RegAccess::read(int regid, csr_u64_t& reg)
         return setError(errno, "getsockopt(GET_REG)");
     }
 #elif defined(WINDOWS)
-    ::ULONG retsize = 0;
-    if (!::DeviceIoControl(_fd, CSR_IOC_GET_REG(regid), nullptr, 0, &reg, sizeof(reg), &retsize, nullptr)) {
+    ::DWORD retsize = 0;
+    if (!deviceControl(CSR_IOC_GET_REG(regid), nullptr, 0, &reg, sizeof(reg), &retsize)) {
         return setError(::GetLastError(), "DeviceIoControl(GET_REG)");
     }
     if (retsize < sizeof(reg)) {
@@ -185,6 +437,7 @@ bool RegAccess::read(int regid, csr_pair_t& reg)
     if (!csr_regid_is_pair(regid)) {
         return setError(EINVAL, "invalid register pair id");
     }
+    StatsProbe probe(regid);
 #if defined(__linux__)
     if (::ioctl(_fd, CSR_IOC_GET_REG2(regid), &reg) < 0) {
         return setError(errno, "ioctl(GET_REG2)");
@@ -195,8 +448,8 @@ bool RegAccess::read(int regid, csr_pair_t& reg)
         return setError(errno, "getsockopt(GET_REG2)");
     }
 #elif defined(WINDOWS)
-    ::ULONG retsize = 0;
-    if (!::DeviceIoControl(_fd, CSR_IOC_GET_REG(regid), nullptr, 0, &reg, sizeof(reg), &retsize, nullptr)) {
+    ::DWORD retsize = 0;
+    if (!deviceControl(CSR_IOC_GET_REG(regid), nullptr, 0, &reg, sizeof(reg), &retsize)) {
         return setError(::GetLastError(), "DeviceIoControl(GET_REG)");
     }
     if (retsize < sizeof(reg)) {
@@ -207,6 +460,121 @@ bool RegAccess::read(int regid, csr_pair_t& reg)
 }
 
 
+//----------------------------------------------------------------------------
+// Read several CPU registers in one call.
+//----------------------------------------------------------------------------
+
+bool RegAccess::readMany(std::vector<csr_multi_reg_t>& regs, csr_u64_t cpu)
+{
+    StatsProbe probe(STATS_MULTI);
+
+    // Command buffer: csr_multi_t header, followed by registers. All sizes are multiple of 64 bits.
+    static_assert(sizeof(csr_multi_t) % sizeof(csr_u64_t) == 0 && sizeof(csr_multi_reg_t) % sizeof(csr_u64_t) == 0);
+    std::vector<csr_u64_t> buffer;
+
+    // Process the list by chunks of CSR_MULTI_MAX registers.
+    for (size_t first = 0; first < regs.size(); first += CSR_MULTI_MAX) {
+        const size_t count = std::min<size_t>(regs.size() - first, CSR_MULTI_MAX);
+        const size_t size = CSR_MULTI_SIZE(count);
+        buffer.resize(size / sizeof(csr_u64_t));
+        csr_multi_t* multi = reinterpret_cast<csr_multi_t*>(buffer.data());
+        csr_multi_reg_t* multi_regs = CSR_MULTI_REGS(multi);
+        multi->count = count;
+        multi->cpu = cpu;
+        for (size_t i = 0; i < count; i++) {
+            multi_regs[i] = regs[first + i];
+        }
+#if defined(__linux__)
+        if (::ioctl(_fd, CSR_IOC_GET_MULTI, multi) < 0) {
+            return setError(errno, "ioctl(GET_MULTI)");
+        }
+#elif defined(__APPLE__)
+        ::socklen_t len = ::socklen_t(size);
+        if (::getsockopt(_fd, SYSPROTO_CONTROL, CSR_SOCKOPT_GET_MULTI, multi, &len) < 0)  {
+            return setError(errno, "getsockopt(GET_MULTI)");
+        }
+#elif defined(WINDOWS)
+        ::DWORD retsize = 0;
+        if (!deviceControl(CSR_IOC_GET_MULTI, multi, size, multi, size, &retsize)) {
+            return setError(::GetLastError(), "DeviceIoControl(GET_MULTI)");
+        }
+        if (retsize < size) {
+            return setError(ERROR_INVALID_DATA, Format("DeviceIoControl(GET_MULTI) returned size too short: ", retsize));
+        }
+#endif
+        for (size_t i = 0; i < count; i++) {
+            regs[first + i] = multi_regs[i];
+        }
+    }
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Read several CPU registers on all CPU cores.
+//----------------------------------------------------------------------------
+
+bool RegAccess::readOnAllCpus(const std::vector<int>& regids, std::vector<std::vector<csr_multi_reg_t>>& table)
+{
+    StatsProbe probe(STATS_ALLCPUS);
+    table.clear();
+
+#if defined(__APPLE__)
+
+    return setError(ENOTSUP, "all-CPU read not supported on macOS");
+
+#else
+
+    // Initial guess of the number of CPU cores. The kernel module returns the actual value.
+    size_t cpus = std::max<size_t>(1, std::thread::hardware_concurrency());
+    std::vector<csr_u64_t> buffer;
+
+    // Process the list of registers by chunks, within the limits of the kernel module.
+    for (size_t first = 0; first < regids.size(); ) {
+        const size_t count = std::min<size_t>({regids.size() - first, CSR_MULTI_MAX, std::max<size_t>(1, CSR_ALLCPUS_MAX / cpus)});
+        const size_t size = CSR_ALLCPUS_SIZE(count, cpus);
+        buffer.resize(size / sizeof(csr_u64_t));
+        csr_allcpus_t* all = reinterpret_cast<csr_allcpus_t*>(buffer.data());
+        all->count = count;
+        all->cpus = cpus;
+        csr_multi_reg_t* regs = CSR_ALLCPUS_REGS(all, 0);
+        for (size_t i = 0; i < count; i++) {
+            regs[i].regid = csr_u64_t(regids[first + i]);
+        }
+#if defined(__linux__)
+        if (::ioctl(_fd, CSR_IOC_GET_ALLCPUS, all) < 0) {
+            return setError(errno, "ioctl(GET_ALLCPUS)");
+        }
+#elif defined(WINDOWS)
+        ::DWORD retsize = 0;
+        if (!deviceControl(CSR_IOC_GET_ALLCPUS, all, size, all, size, &retsize)) {
+            return setError(::GetLastError(), "DeviceIoControl(GET_ALLCPUS)");
+        }
+        if (retsize < CSR_ALLCPUS_SIZE(count, std::min<size_t>(cpus, all->cpus))) {
+            return setError(ERROR_INVALID_DATA, Format("DeviceIoControl(GET_ALLCPUS) returned size too short: ", retsize));
+        }
+#endif
+        if (all->cpus > cpus) {
+            // More CPU cores than expected, restart from the beginning with the actual number.
+            cpus = all->cpus;
+            first = 0;
+            table.clear();
+            continue;
+        }
+        cpus = all->cpus;
+        table.resize(cpus);
+        for (size_t cpu = 0; cpu < table.size(); cpu++) {
+            const csr_multi_reg_t* cpu_regs = CSR_ALLCPUS_REGS(all, cpu);
+            table[cpu].insert(table[cpu].end(), cpu_regs, cpu_regs + count);
+        }
+        first += count;
+    }
+    return true;
+
+#endif
+}
+
+
 //----------------------------------------------------------------------------
 // Write CPU registers.
 //----------------------------------------------------------------------------
@@ -216,6 +584,7 @@ bool RegAccess::write(int regid, csr_u64_t reg)
     if (!csr_regid_is_single(regid)) {
         return setError(EINVAL, "invalid register id");
     }
+    StatsProbe probe(regid);
 #if defined(__linux__)
     if (::ioctl(_fd, CSR_IOC_SET_REG(regid), &reg) < 0) {
         return setError(errno, "ioctl(SET_REG)");
@@ -225,7 +594,7 @@ bool RegAccess::write(int regid, csr_u64_t reg)
         return setError(errno, "setsockopt(SET_REG)");
     }
 #elif defined(WINDOWS)
-    if (!::DeviceIoControl(_fd, CSR_IOC_SET_REG(regid), const_cast<csr_u64_t*>(&reg), sizeof(reg), nullptr, 0, nullptr, nullptr)) {
+    if (!deviceControl(CSR_IOC_SET_REG(regid), const_cast<csr_u64_t*>(&reg), sizeof(reg), nullptr, 0, nullptr)) {
         return setError(::GetLastError(), "DeviceIoControl(SET_REG)");
     }
 #endif
@@ -240,6 +609,7 @@ bool RegAccess::write(int regid, const csr_pair_t& reg)
     if (!csr_regid_is_pair(regid)) {
         return setError(EINVAL, "invalid register pair id");
     }
+    StatsProbe probe(regid);
 #if defined(__linux__)
     if (::ioctl(_fd, CSR_IOC_SET_REG2(regid), &reg) < 0) {
         return setError(errno, "ioctl(SET_REG2)");
@@ -249,7 +619,7 @@ bool RegAccess::write(int regid, const csr_pair_t& reg)
         return setError(errno, "setsockopt(SET_REG2)");
     }
 #elif defined(WINDOWS)
-    if (!::DeviceIoControl(_fd, CSR_IOC_SET_REG(regid), const_cast<csr_pair_t*>(&reg), sizeof(reg), nullptr, 0, nullptr, nullptr)) {
+    if (!deviceControl(CSR_IOC_SET_REG(regid), const_cast<csr_pair_t*>(&reg), sizeof(reg), nullptr, 0, nullptr)) {
         return setError(::GetLastError(), "DeviceIoControl(SET_REG)");
     }
 #endif
@@ -263,6 +633,7 @@ bool RegAccess::write(int regid, const csr_pair_t& reg)
 
 bool RegAccess::executeInstr(int instr, csr_instr_t& args)
 {
+    StatsProbe probe(STATS_INSTR);
 #if defined(__linux__)
     if (::ioctl(_fd, CSR_IOC_INSTR(instr), &args) < 0) {
         return setError(errno, "ioctl(INSTR)");
@@ -273,8 +644,8 @@ bool RegAccess::executeInstr(int instr, csr_instr_t& args)
         return setError(errno, "getsockopt(INSTR)");
     }
 #elif defined(WINDOWS)
-    ::ULONG retsize = 0;
-    if (!::DeviceIoControl(_fd, CSR_IOC_INSTR(instr), &args, sizeof(args), &args, sizeof(args), &retsize, nullptr)) {
+    ::DWORD retsize = 0;
+    if (!deviceControl(CSR_IOC_INSTR(instr), &args, sizeof(args), &args, sizeof(args), &retsize)) {
         return setError(::GetLastError(), "DeviceIoControl(INSTR)");
     }
     if (retsize < sizeof(args)) {
@@ -283,3 +654,503 @@ bool RegAccess::executeInstr(int instr, csr_instr_t& args)
 #endif
     return true;
 }
+
+
+//----------------------------------------------------------------------------
+// Write CPU registers and read them back.
+//----------------------------------------------------------------------------
+
+bool RegAccess::writeVerify(int regid, csr_u64_t reg, csr_u64_t& observed)
+{
+    if (!csr_regid_is_single(regid)) {
+        return setError(EINVAL, "invalid register id");
+    }
+    StatsProbe probe(regid);
+    observed = reg;
+#if defined(__linux__)
+    if (::ioctl(_fd, CSR_IOC_SETGET_REG(regid), &observed) < 0) {
+        return setError(errno, "ioctl(SETGET_REG)");
+    }
+#elif defined(__APPLE__)
+    ::socklen_t len = sizeof(observed);
+    if (::getsockopt(_fd, SYSPROTO_CONTROL, CSR_SOCKOPT_SETGET_REG(regid), &observed, &len) < 0)  {
+        return setError(errno, "getsockopt(SETGET_REG)");
+    }
+#elif defined(WINDOWS)
+    ::DWORD retsize = 0;
+    if (!deviceControl(CSR_IOC_SETGET_REG(regid), &observed, sizeof(observed), &observed, sizeof(observed), &retsize)) {
+        return setError(::GetLastError(), "DeviceIoControl(SETGET_REG)");
+    }
+    if (retsize < sizeof(observed)) {
+        return setError(ERROR_INVALID_DATA, Format("DeviceIoControl(SETGET_REG) returned size too short: ", retsize));
+    }
+#endif
+    return true;
+}
+
+bool RegAccess::writeVerify(int regid, const csr_pair_t& reg, csr_pair_t& observed)
+{
+    if (csr_regid_is_single(regid)) {
+        observed.high = 0;
+        return writeVerify(regid, reg.low, observed.low);
+    }
+    if (!csr_regid_is_pair(regid)) {
+        return setError(EINVAL, "invalid register pair id");
+    }
+    StatsProbe probe(regid);
+    observed = reg;
+#if defined(__linux__)
+    if (::ioctl(_fd, CSR_IOC_SETGET_REG2(regid), &observed) < 0) {
+        return setError(errno, "ioctl(SETGET_REG2)");
+    }
+#elif defined(__APPLE__)
+    ::socklen_t len = sizeof(observed);
+    if (::getsockopt(_fd, SYSPROTO_CONTROL, CSR_SOCKOPT_SETGET_REG(regid), &observed, &len) < 0)  {
+        return setError(errno, "getsockopt(SETGET_REG2)");
+    }
+#elif defined(WINDOWS)
+    ::DWORD retsize = 0;
+    if (!deviceControl(CSR_IOC_SETGET_REG(regid), &observed, sizeof(observed), &observed, sizeof(observed), &retsize)) {
+        return setError(::GetLastError(), "DeviceIoControl(SETGET_REG)");
+    }
+    if (retsize < sizeof(observed)) {
+        return setError(ERROR_INVALID_DATA, Format("DeviceIoControl(SETGET_REG) returned size too short: ", retsize));
+    }
+#endif
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Read and write all PAC keys at once.
+//----------------------------------------------------------------------------
+
+bool RegAccess::swapPacKeys(csr_pac_keys_t& keys)
+{
+    StatsProbe probe(STATS_OTHER);
+#if defined(CSR_AVOID_PAC_KEY_REGISTERS)
+    return setError(ENOTSUP, "PAC key registers not accessible on this platform");
+#elif defined(__linux__)
+    if (::ioctl(_fd, CSR_IOC_SWAP_PAC_KEYS, &keys) < 0) {
+        return setError(errno, "ioctl(SWAP_PAC_KEYS)");
+    }
+#elif defined(__APPLE__)
+    ::socklen_t len = sizeof(keys);
+    if (::getsockopt(_fd, SYSPROTO_CONTROL, CSR_SOCKOPT_SWAP_PAC_KEYS, &keys, &len) < 0)  {
+        return setError(errno, "getsockopt(SWAP_PAC_KEYS)");
+    }
+#elif defined(WINDOWS)
+    ::DWORD retsize = 0;
+    if (!deviceControl(CSR_IOC_SWAP_PAC_KEYS, &keys, sizeof(keys), &keys, sizeof(keys), &retsize)) {
+        return setError(::GetLastError(), "DeviceIoControl(SWAP_PAC_KEYS)");
+    }
+    if (retsize < sizeof(keys)) {
+        return setError(ERROR_INVALID_DATA, Format("DeviceIoControl(SWAP_PAC_KEYS) returned size too short: ", retsize));
+    }
+#endif
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Swap the performance monitors state on all CPU cores.
+//----------------------------------------------------------------------------
+
+bool RegAccess::swapPmu(csr_pmu_state_t& state)
+{
+    StatsProbe probe(STATS_OTHER);
+#if defined(__linux__)
+    if (::ioctl(_fd, CSR_IOC_SWAP_PMU, &state) < 0) {
+        return setError(errno, "ioctl(SWAP_PMU)");
+    }
+#elif defined(__APPLE__)
+    return setError(ENOTSUP, "performance monitors not accessible on this platform");
+#elif defined(WINDOWS)
+    ::DWORD retsize = 0;
+    if (!deviceControl(CSR_IOC_SWAP_PMU, &state, sizeof(state), &state, sizeof(state), &retsize)) {
+        return setError(::GetLastError(), "DeviceIoControl(SWAP_PMU)");
+    }
+    if (retsize < sizeof(state)) {
+        return setError(ERROR_INVALID_DATA, Format("DeviceIoControl(SWAP_PMU) returned size too short: ", retsize));
+    }
+#endif
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Read the geometry of all caches on one CPU core.
+//----------------------------------------------------------------------------
+
+bool RegAccess::readCacheInfo(csr_cache_info_t& info, csr_u64_t cpu)
+{
+    StatsProbe probe(STATS_OTHER);
+    info = csr_cache_info_t();
+    info.cpu = cpu;
+#if defined(__linux__)
+    if (::ioctl(_fd, CSR_IOC_GET_CACHES, &info) < 0) {
+        return setError(errno, "ioctl(GET_CACHES)");
+    }
+#elif defined(__APPLE__)
+    ::socklen_t len = sizeof(info);
+    if (::getsockopt(_fd, SYSPROTO_CONTROL, CSR_SOCKOPT_GET_CACHES, &info, &len) < 0)  {
+        return setError(errno, "getsockopt(GET_CACHES)");
+    }
+#elif defined(WINDOWS)
+    ::DWORD retsize = 0;
+    if (!deviceControl(CSR_IOC_GET_CACHES, &info, sizeof(info), &info, sizeof(info), &retsize)) {
+        return setError(::GetLastError(), "DeviceIoControl(GET_CACHES)");
+    }
+    if (retsize < sizeof(info)) {
+        return setError(ERROR_INVALID_DATA, Format("DeviceIoControl(GET_CACHES) returned size too short: ", retsize));
+    }
+#endif
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Fill a buffer of random numbers in the kernel module.
+//----------------------------------------------------------------------------
+
+bool RegAccess::readRandom(csr_random_t& rnd)
+{
+    StatsProbe probe(STATS_OTHER);
+    if (rnd.count > CSR_RANDOM_MAX) {
+        rnd.count = CSR_RANDOM_MAX;
+    }
+#if defined(__linux__)
+    if (::ioctl(_fd, CSR_IOC_GET_RANDOM, &rnd) < 0) {
+        return setError(errno, "ioctl(GET_RANDOM)");
+    }
+#elif defined(__APPLE__)
+    ::socklen_t len = sizeof(rnd);
+    if (::getsockopt(_fd, SYSPROTO_CONTROL, CSR_SOCKOPT_GET_RANDOM, &rnd, &len) < 0)  {
+        return setError(errno, "getsockopt(GET_RANDOM)");
+    }
+#elif defined(WINDOWS)
+    ::DWORD retsize = 0;
+    if (!deviceControl(CSR_IOC_GET_RANDOM, &rnd, sizeof(rnd), &rnd, sizeof(rnd), &retsize)) {
+        return setError(::GetLastError(), "DeviceIoControl(GET_RANDOM)");
+    }
+    if (retsize < sizeof(rnd)) {
+        return setError(ERROR_INVALID_DATA, Format("DeviceIoControl(GET_RANDOM) returned size too short: %u", unsigned(retsize)));
+    }
+#endif
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Execute a batch of PACxx or AUTxx in kernel mode.
+//----------------------------------------------------------------------------
+
+bool RegAccess::executeInstrBatch(std::vector<csr_instr_item_t>& items)
+{
+    StatsProbe probe(STATS_INSTR_BATCH);
+
+    // Command buffer: csr_instr_batch_t header, followed by instructions. All sizes are multiple of 64 bits.
+    static_assert(sizeof(csr_instr_batch_t) % sizeof(csr_u64_t) == 0 && sizeof(csr_instr_item_t) % sizeof(csr_u64_t) == 0);
+    std::vector<csr_u64_t> buffer;
+
+    // Process the list by chunks of CSR_INSTR_BATCH_MAX instructions.
+    for (size_t first = 0; first < items.size(); first += CSR_INSTR_BATCH_MAX) {
+        const size_t count = std::min<size_t>(items.size() - first, CSR_INSTR_BATCH_MAX);
+        const size_t size = CSR_INSTR_BATCH_SIZE(count);
+        buffer.resize(size / sizeof(csr_u64_t));
+        csr_instr_batch_t* batch = reinterpret_cast<csr_instr_batch_t*>(buffer.data());
+        csr_instr_item_t* batch_items = CSR_INSTR_BATCH_ITEMS(batch);
+        batch->count = count;
+        std::copy(items.begin() + first, items.begin() + first + count, batch_items);
+#if defined(__linux__)
+        if (::ioctl(_fd, CSR_IOC_INSTR_BATCH, batch) < 0) {
+            return setError(errno, "ioctl(INSTR_BATCH)");
+        }
+#elif defined(__APPLE__)
+        ::socklen_t len = ::socklen_t(size);
+        if (::getsockopt(_fd, SYSPROTO_CONTROL, CSR_SOCKOPT_INSTR_BATCH, batch, &len) < 0)  {
+            return setError(errno, "getsockopt(INSTR_BATCH)");
+        }
+#elif defined(WINDOWS)
+        ::DWORD retsize = 0;
+        if (!deviceControl(CSR_IOC_INSTR_BATCH, batch, size, batch, size, &retsize)) {
+            return setError(::GetLastError(), "DeviceIoControl(INSTR_BATCH)");
+        }
+        if (retsize < size) {
+            return setError(ERROR_INVALID_DATA, Format("DeviceIoControl(INSTR_BATCH) returned size too short: ", retsize));
+        }
+#endif
+        std::copy(batch_items, batch_items + count, items.begin() + first);
+    }
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Execute a batch of register and instruction requests.
+//----------------------------------------------------------------------------
+
+bool RegAccess::executeRequests(std::vector<csr_request_t>& reqs, csr_u64_t cpu)
+{
+    StatsProbe probe(STATS_REQUESTS);
+#if defined(__linux__) || defined(__APPLE__) || defined(WINDOWS)
+    // Command buffer: csr_requests_t header, followed by requests. All sizes are multiple of 64 bits.
+    static_assert(sizeof(csr_requests_t) % sizeof(csr_u64_t) == 0 && sizeof(csr_request_t) % sizeof(csr_u64_t) == 0);
+    std::vector<csr_u64_t> buffer;
+
+    // Process the list by chunks of CSR_REQUESTS_MAX requests.
+    for (size_t first = 0; first < reqs.size(); first += CSR_REQUESTS_MAX) {
+        const size_t count = std::min<size_t>(reqs.size() - first, CSR_REQUESTS_MAX);
+        const size_t size = CSR_REQUESTS_SIZE(count);
+        buffer.resize(size / sizeof(csr_u64_t));
+        csr_requests_t* batch = reinterpret_cast<csr_requests_t*>(buffer.data());
+        csr_request_t* batch_reqs = CSR_REQUESTS_ITEMS(batch);
+        batch->count = count;
+        batch->cpu = cpu;
+        std::copy(reqs.begin() + first, reqs.begin() + first + count, batch_reqs);
+#if defined(__linux__)
+        if (::ioctl(_fd, CSR_IOC_REQUESTS, batch) < 0) {
+            return setError(errno, "ioctl(REQUESTS)");
+        }
+#elif defined(__APPLE__)
+        ::socklen_t len = ::socklen_t(size);
+        if (::getsockopt(_fd, SYSPROTO_CONTROL, CSR_SOCKOPT_REQUESTS, batch, &len) < 0)  {
+            return setError(errno, "getsockopt(REQUESTS)");
+        }
+        if (len < size) {
+            return setError(EINVAL, Format("getsockopt(REQUESTS) returned size too short: %u", unsigned(len)));
+        }
+#elif defined(WINDOWS)
+        ::DWORD retsize = 0;
+        if (!deviceControl(CSR_IOC_REQUESTS, batch, size, batch, size, &retsize)) {
+            return setError(::GetLastError(), "DeviceIoControl(REQUESTS)");
+        }
+        if (retsize < size) {
+            return setError(ERROR_INVALID_DATA, Format("DeviceIoControl(REQUESTS) returned size too short: %u", unsigned(retsize)));
+        }
+#endif
+        std::copy(batch_reqs, batch_reqs + count, reqs.begin() + first);
+    }
+    return true;
+#else
+    return setError(ENOTSUP, "request batch not supported on this platform");
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Periodic sampler of the kernel module.
+//----------------------------------------------------------------------------
+
+bool RegAccess::startSampler(const std::vector<int>& regids, csr_u64_t period_ns)
+{
+#if defined(__linux__)
+    if (regids.empty() || regids.size() > CSR_SAMPLER_MAX_REGS) {
+        return setError(EINVAL, Format("startSampler: invalid number of registers: %zu", regids.size()));
+    }
+    csr_sampler_t params {};
+    params.period_ns = period_ns;
+    params.count = regids.size();
+    std::copy(regids.begin(), regids.end(), params.regids);
+    if (::ioctl(_fd, CSR_IOC_SAMPLER_START, &params) < 0) {
+        return setError(errno, "ioctl(SAMPLER_START)");
+    }
+    return true;
+#else
+    return setError(ENOTSUP, "periodic sampler not supported on this platform");
+#endif
+}
+
+bool RegAccess::stopSampler()
+{
+#if defined(__linux__)
+    if (::ioctl(_fd, CSR_IOC_SAMPLER_STOP) < 0) {
+        return setError(errno, "ioctl(SAMPLER_STOP)");
+    }
+    return true;
+#else
+    return setError(ENOTSUP, "periodic sampler not supported on this platform");
+#endif
+}
+
+bool RegAccess::readSamples(std::vector<csr_sample_t>& samples, size_t max_count)
+{
+#if defined(__linux__)
+    samples.resize(max_count);
+    if (max_count == 0) {
+        return true;
+    }
+    const ssize_t size = ::read(_fd, samples.data(), samples.size() * sizeof(csr_sample_t));
+    if (size < 0) {
+        samples.clear();
+        return setError(errno, "read(samples)");
+    }
+    samples.resize(size_t(size) / sizeof(csr_sample_t));
+    return true;
+#else
+    samples.clear();
+    return setError(ENOTSUP, "periodic sampler not supported on this platform");
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Register watch.
+//----------------------------------------------------------------------------
+
+bool RegAccess::startWatch(const std::vector<int>& regids, csr_u64_t period_ns)
+{
+#if defined(__linux__)
+    if (regids.empty() || regids.size() > CSR_WATCH_MAX_REGS) {
+        return setError(EINVAL, Format("startWatch: invalid number of registers: %zu", regids.size()));
+    }
+    csr_watch_t params {};
+    params.period_ns = period_ns;
+    params.count = regids.size();
+    std::copy(regids.begin(), regids.end(), params.regids);
+    if (::ioctl(_fd, CSR_IOC_WATCH_START, &params) < 0) {
+        return setError(errno, "ioctl(WATCH_START)");
+    }
+    return true;
+#else
+    return setError(ENOTSUP, "register watch not supported on this platform");
+#endif
+}
+
+bool RegAccess::stopWatch()
+{
+#if defined(__linux__)
+    if (::ioctl(_fd, CSR_IOC_WATCH_STOP) < 0) {
+        return setError(errno, "ioctl(WATCH_STOP)");
+    }
+    return true;
+#else
+    return setError(ENOTSUP, "register watch not supported on this platform");
+#endif
+}
+
+bool RegAccess::waitForChange(csr_watch_event_t& event, int timeout_ms)
+{
+    event = csr_watch_event_t {};
+#if defined(__linux__)
+    struct pollfd pfd {};
+    pfd.fd = _fd;
+    pfd.events = POLLPRI;
+    const int count = ::poll(&pfd, 1, timeout_ms);
+    if (count < 0 && errno != EINTR) {
+        return setError(errno, "poll(watch)");
+    }
+    if (count > 0 && ::ioctl(_fd, CSR_IOC_WATCH_READ, &event) < 0) {
+        return setError(errno, "ioctl(WATCH_READ)");
+    }
+    return true;
+#else
+    return setError(ENOTSUP, "register watch not supported on this platform");
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Statistical profiling.
+//----------------------------------------------------------------------------
+
+bool RegAccess::startProfiling(const csr_spe_config_t& config)
+{
+#if defined(__linux__)
+    if (::ioctl(_fd, CSR_IOC_SPE_START, &config) < 0) {
+        return setError(errno, "ioctl(SPE_START)");
+    }
+    return true;
+#else
+    return setError(ENOTSUP, "statistical profiling not supported on this platform");
+#endif
+}
+
+bool RegAccess::stopProfiling()
+{
+#if defined(__linux__)
+    if (::ioctl(_fd, CSR_IOC_SPE_STOP) < 0) {
+        return setError(errno, "ioctl(SPE_STOP)");
+    }
+    return true;
+#else
+    return setError(ENOTSUP, "statistical profiling not supported on this platform");
+#endif
+}
+
+bool RegAccess::readProfiling(int cpu, std::vector<uint8_t>& records, csr_u64_t& pmbsr)
+{
+    records.clear();
+    pmbsr = 0;
+#if defined(__linux__)
+    // Read by chunks, the first request returns the total size.
+    csr_spe_read_t req {};
+    req.cpu = csr_u64_t(cpu);
+    do {
+        records.resize(std::max<size_t>(records.size() + CSR_SPE_MIN_BUFFER, size_t(req.total)));
+        req.offset = req.offset + req.size;
+        req.address = reinterpret_cast<csr_u64_t>(records.data() + req.offset);
+        req.size = records.size() - req.offset;
+        if (::ioctl(_fd, CSR_IOC_SPE_READ, &req) < 0) {
+            records.clear();
+            return setError(errno, "ioctl(SPE_READ)");
+        }
+    } while (req.size > 0 && req.offset + req.size < req.total);
+    records.resize(size_t(req.offset + req.size));
+    pmbsr = req.pmbsr;
+    return true;
+#else
+    return setError(ENOTSUP, "statistical profiling not supported on this platform");
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Get the snapshot of immutable registers.
+//----------------------------------------------------------------------------
+
+const csr_snapshot_t* RegAccess::snapshot()
+{
+    // Thread-safe initialization, the first time only.
+    static const csr_snapshot_t* const snap = loadSnapshot();
+    return snap;
+}
+
+const csr_snapshot_t* RegAccess::loadSnapshot()
+{
+#if defined(__linux__)
+
+    // Map the snapshot page, read-only. The mapping remains valid after closing the device.
+    const int fd = ::open(CSR_DEVICE_PATH, O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    void* addr = ::mmap(nullptr, sizeof(csr_snapshot_t), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return nullptr;
+    }
+    const csr_snapshot_t* snap = reinterpret_cast<const csr_snapshot_t*>(addr);
+    if (!csr_snapshot_is_valid(snap)) {
+        ::munmap(addr, sizeof(csr_snapshot_t));
+        return nullptr;
+    }
+    return snap;
+
+#elif defined(__APPLE__)
+
+    // Get a copy of the snapshot from the kernel extension.
+    static csr_snapshot_t snap;
+    RegAccess& regaccess(shared());
+    ::socklen_t len = sizeof(snap);
+    if (!regaccess.isOpen() || ::getsockopt(regaccess._fd, SYSPROTO_CONTROL, CSR_SOCKOPT_GET_SNAPSHOT, &snap, &len) < 0) {
+        return nullptr;
+    }
+    return csr_snapshot_is_valid(&snap) ? &snap : nullptr;
+
+#else
+
+    return nullptr;
+
+#endif
+}
@@ -10,7 +10,9 @@
 
 #pragma once
 #include "cpusysregs.h"
-#include <iostream>
+#include <iosfwd>
+#include <string>
+#include <vector>
 
 //
 // A class to access Arm64 system registers.
@@ -18,6 +20,10 @@
 // Most methods return true on success and false on error.
 // Use error reporting methods to print errors.
 //
+// All access methods are thread-safe: several threads can use the same instance at
+// the same time, on the same file descriptor. The error state is per thread, like errno:
+// lastError() returns the last error in the calling thread, from any instance.
+//
 class RegAccess
 {
 public:
@@ -30,16 +36,27 @@ public:
     // Check if the kernel module was successfully open.
     bool isOpen() const;
 
+    // Get a process-wide instance, opened on first use, to share between components and threads.
+    // There is no automatic error reporting on this instance.
+    static RegAccess& shared();
+
     // Forbid copy (keep only one instance per file descriptor).
     RegAccess(RegAccess&&) = delete;
     RegAccess(const RegAccess&) = delete;
     RegAccess& operator=(RegAccess&&) = delete;
     RegAccess& operator=(const RegAccess&) = delete;
 
-    // Error reporting.
+    // Error reporting, in the calling thread.
     int lastError() const { return _error; }
     void clearError() { _error = 0; }
-    void printLastError(const std::string& label = std::string(), std::ostream& file = std::cerr) const;
+
+    // Message of the last error, prefixed by a label, empty if there is no error.
+    std::string lastErrorMessage(const std::string& label = std::string()) const;
+
+    // Print the last error, if any, on standard error or on a stream.
+    // The standard error is accessed using stdio, without the static initialization of iostream.
+    void printLastError(const std::string& label = std::string()) const;
+    void printLastError(const std::string& label, std::ostream& file) const;
 
     // Read/write one CPU register.
     bool read(int regid, csr_u64_t& reg);
@@ -50,9 +67,130 @@ public:
     bool read(int regid, csr_pair_t& reg);
     bool write(int regid, const csr_pair_t& reg);
 
+    // Write a CPU register (or pair of registers) and read it back in the same call to the kernel module.
+    // The observed value is returned. It may differ from the written value (RES0 bits, unimplemented fields).
+    bool writeVerify(int regid, csr_u64_t reg, csr_u64_t& observed);
+    bool writeVerify(int regid, const csr_pair_t& reg, csr_pair_t& observed);
+
+    // Read several CPU registers in one call to the kernel module (or a few calls for large lists).
+    // The regid field of each element shall be set. The value and status of each register are returned.
+    // A status other than zero is not an error, the corresponding register is simply not available.
+    // The registers are read on the specified CPU core or on any core with CSR_CPU_ANY (macOS supports CSR_CPU_ANY only).
+    // Return false on system error only.
+    bool readMany(std::vector<csr_multi_reg_t>& regs, csr_u64_t cpu = CSR_CPU_ANY);
+
+    // Read several CPU registers on all CPU cores, in one call to the kernel module (or a few calls for large lists).
+    // The returned table is indexed by CPU core number. Each element contains all registers in the same order as regids.
+    // Registers from offline CPU cores have status 3. Not supported on macOS.
+    // Return false on system error only.
+    bool readOnAllCpus(const std::vector<int>& regids, std::vector<std::vector<csr_multi_reg_t>>& table);
+
     // Execute a PACxx or AUTxx in kernel mode.
     bool executeInstr(int instr, csr_instr_t& args);
 
+    // Read all PAC keys and write the selected ones (keys.set mask) in one call, without interruption.
+    // On return, keys.keys[] contain the previous values and keys.valid the mask of supported keys.
+    // With keys.set == 0, simply read all keys at once.
+    bool swapPacKeys(csr_pac_keys_t& keys);
+
+    // Write the performance monitors state on all CPU cores and return the previous state (Linux, Windows).
+    // On return, state.status is 2 if PMUv3 is not implemented.
+    bool swapPmu(csr_pmu_state_t& state);
+
+    // Read the geometry of all caches on one CPU core (CSR_CPU_ANY is the only choice on macOS).
+    // Each cache is selected in CSSELR_EL1 and read in the kernel module, without interruption.
+    bool readCacheInfo(csr_cache_info_t& info, csr_u64_t cpu = CSR_CPU_ANY);
+
+    // Fill a buffer of random numbers from RNDR or RNDRRS in the kernel module, with FEAT_RNG.
+    // The count and reseeded fields shall be set. On return, count is the number of values and
+    // status indicates an entropy source failure or missing feature. Return false on system error only.
+    bool readRandom(csr_random_t& rnd);
+
+    // Execute a batch of PACxx or AUTxx in kernel mode, in one call to the kernel module (or a few calls for large lists).
+    // The instr and args fields of each element shall be set. The status and result of each instruction are returned.
+    // Return false on system error only.
+    bool executeInstrBatch(std::vector<csr_instr_item_t>& items);
+
+    // Execute a batch of register reads, register writes and instructions, in one call to the kernel
+    // module (or a few calls for large lists), in sequence, on the same CPU core.
+    // A large list is split in chunks of CSR_REQUESTS_MAX, which may run on distinct cores when cpu is CSR_CPU_ANY.
+    // On macOS, cpu must be CSR_CPU_ANY.
+    // The op, id, value (and modifier) of each element shall be set. The status and value of each request are returned.
+    // Return false on system error only.
+    bool executeRequests(std::vector<csr_request_t>& reqs, csr_u64_t cpu = CSR_CPU_ANY);
+
+    // Start the periodic sampler of the kernel module (Linux only).
+    // The registers (up to CSR_SAMPLER_MAX_REGS single registers) are read on all CPU cores every period_ns nanoseconds.
+    // The samples of a previous session, if not yet read, are lost. The sampler is stopped when this object is closed.
+    bool startSampler(const std::vector<int>& regids, csr_u64_t period_ns);
+
+    // Stop the periodic sampler. The samples which are not yet read remain available.
+    bool stopSampler();
+
+    // Read the available samples, up to max_count, from the periodic sampler.
+    // The vector is resized to the number of read samples, possibly zero when no sample is available.
+    bool readSamples(std::vector<csr_sample_t>& samples, size_t max_count = CSR_SAMPLER_RING_SIZE);
+
+    // Start the register watch of the kernel module (Linux only).
+    // The registers (up to CSR_WATCH_MAX_REGS single registers) are compared on all CPU cores every period_ns
+    // nanoseconds (at least CSR_WATCH_MIN_PERIOD) and when a CPU core comes online. Only one watch at a time
+    // in the system. The watch is stopped when this object is closed.
+    bool startWatch(const std::vector<int>& regids, csr_u64_t period_ns);
+
+    // Stop the register watch.
+    bool stopWatch();
+
+    // Wait until the watched registers change, up to timeout_ms milliseconds (negative: no timeout).
+    // The event describes the first change since the previous call. On timeout or when interrupted by
+    // a signal, return true with event.changed set to zero. Return false on system error only.
+    bool waitForChange(csr_watch_event_t& event, int timeout_ms = -1);
+
+    // Start the statistical profiling on all CPU cores (Linux only, module loaded with "spe=1").
+    // The records of a previous session, if not yet read, are lost. The profiling is stopped when this object is closed.
+    bool startProfiling(const csr_spe_config_t& config);
+
+    // Stop the statistical profiling. The profiling records remain available.
+    bool stopProfiling();
+
+    // Read all profiling records of one CPU core, after stopping the profiling.
+    // The returned PMBSR_EL1 value indicates why the profiling stopped on that CPU core, if it stopped before.
+    bool readProfiling(int cpu, std::vector<uint8_t>& records, csr_u64_t& pmbsr);
+
+    // Get the snapshot of immutable registers from the kernel module (Linux, macOS).
+    // The kernel module is accessed the first time only, then the snapshot is kept for the whole process.
+    // Return a null pointer if the snapshot is not available.
+    static const csr_snapshot_t* snapshot();
+
+    // Instrumentation counters of one register or command.
+    struct CallStats {
+        csr_u64_t calls = 0;     // number of calls
+        csr_u64_t errors = 0;    // number of failed calls
+        csr_u64_t total_ns = 0;  // cumulative latency, in nanoseconds
+        csr_u64_t max_ns = 0;    // maximum latency, in nanoseconds
+    };
+
+    // Indexes of the commands in the statistics, after the register ids.
+    enum : int {
+        STATS_MULTI = _CSR_REGID2_END,  // readMany()
+        STATS_ALLCPUS,                  // readOnAllCpus()
+        STATS_INSTR,                    // executeInstr()
+        STATS_INSTR_BATCH,              // executeInstrBatch()
+        STATS_REQUESTS,                 // executeRequests()
+        STATS_OTHER,                    // PAC keys, PMU, caches, random numbers
+        STATS_COUNT
+    };
+
+    // Enable or disable the instrumentation counters, process-wide, disabled by default.
+    // When enabled, each call to the kernel module is timed and counted, per register id (read, write,
+    // writeVerify) or per command, in counters of the calling thread. When disabled, the cost is one test per call.
+    static void enableStats(bool enable = true);
+    static bool statsEnabled();
+
+    // Get the statistics of all threads, since the start of the process or the last resetStats().
+    // The vector is indexed by register id or STATS_ value and contains STATS_COUNT elements.
+    static void getStats(std::vector<CallStats>& stats);
+    static void resetStats();
+
 private:
 
     // File descriptor, device handle, per system.
@@ -70,12 +208,27 @@ private:
 
     SysHandle   _fd;            // file descriptor to access the kernel module
     bool        _print_errors;  // automatic error reporting
-    SysError    _error;         // last error code
-    std::string _error_ref;     // reference of last error
+
+    // Error state, per thread.
+    static thread_local SysError    _error;      // last error code
+    static thread_local std::string _error_ref;  // reference of last error
+    static thread_local size_t      _error_count;  // number of errors, for the statistics
+
+    // Instrumentation counters, see regaccess.cpp.
+    class ThreadStats;
+    class StatsProbe;
 
     // Close the kernel module.
     void close();
 
+#if defined(WINDOWS)
+    // Same as DeviceIoControl() on the device, wait for the completion of the overlapped I/O.
+    bool deviceControl(::DWORD cmd, void* in, size_t in_size, void* out, size_t out_size, ::DWORD* retsize);
+#endif
+
+    // Load the snapshot of immutable registers, called once.
+    static const csr_snapshot_t* loadSnapshot();
+
     // Set error code and return false. Report when necessary.
     bool setError(SysError code, const std::string& ref, bool close_fd = false, bool exit_on_error = false);
 };
@@ -0,0 +1,105 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A class to decode large series of values of a system register.
+//
+//----------------------------------------------------------------------------
+
+#include "regdecoder.h"
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define CSR_USE_NEON 1
+#endif
+
+
+//----------------------------------------------------------------------------
+// Constructor: precompute the shift and mask of each bitfield.
+//----------------------------------------------------------------------------
+
+RegDecoder::RegDecoder(const RegView::Register& reg) :
+    _reg(reg)
+{
+    _fields.reserve(reg.fields.size());
+    for (const auto& bf : reg.fields) {
+        FieldMask fm {0, 0, 0};
+        if (bf.msb < 64) {
+            fm.shift = bf.lsb;
+            fm.mask = bf.msb - bf.lsb >= 63 ? ~csr_u64_t(0) : (csr_u64_t(1) << (bf.msb - bf.lsb + 1)) - 1;
+            fm.inplace = fm.mask << fm.shift;
+        }
+        _fields.push_back(fm);
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Extract one column.
+//----------------------------------------------------------------------------
+
+void RegDecoder::extract(const csr_u64_t* in, csr_u64_t* out, size_t count, int shift, csr_u64_t mask)
+{
+    size_t i = 0;
+#if defined(CSR_USE_NEON)
+    // Process 4 values per iteration in two 128-bit vectors.
+    const int64x2_t vshift = vdupq_n_s64(-shift);
+    const uint64x2_t vmask = vdupq_n_u64(mask);
+    // On Linux, csr_u64_t is unsigned long long and uint64_t is unsigned long.
+    const uint64_t* vin = reinterpret_cast<const uint64_t*>(in);
+    uint64_t* vout = reinterpret_cast<uint64_t*>(out);
+    for (; i + 4 <= count; i += 4) {
+        const uint64x2_t v0 = vld1q_u64(vin + i);
+        const uint64x2_t v1 = vld1q_u64(vin + i + 2);
+        vst1q_u64(vout + i, vandq_u64(vshlq_u64(v0, vshift), vmask));
+        vst1q_u64(vout + i + 2, vandq_u64(vshlq_u64(v1, vshift), vmask));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = (in[i] >> shift) & mask;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Decode a series of values in columns.
+//----------------------------------------------------------------------------
+
+void RegDecoder::decode(Span<csr_u64_t> values, std::vector<std::vector<csr_u64_t>>& columns) const
+{
+    columns.resize(_fields.size());
+    for (size_t f = 0; f < _fields.size(); f++) {
+        columns[f].resize(values.size());
+        extract(values.data(), columns[f].data(), values.size(), _fields[f].shift, _fields[f].mask);
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Decode a series of values, only the changed bitfields.
+//----------------------------------------------------------------------------
+
+void RegDecoder::decodeChanges(Span<csr_u64_t> values, std::vector<Change>& changes, const csr_u64_t* initial) const
+{
+    // Mask of all bits in all known bitfields.
+    csr_u64_t known = 0;
+    for (const auto& fm : _fields) {
+        known |= fm.inplace;
+    }
+
+    for (size_t i = 0; i < values.size(); i++) {
+        const csr_u64_t previous = i > 0 ? values[i-1] : (initial != nullptr ? *initial : 0);
+        // Without initial value, report all bitfields of the first value.
+        const csr_u64_t diff = i == 0 && initial == nullptr ? known : (previous ^ values[i]) & known;
+        // Most consecutive values are identical, skip them at once.
+        if (diff != 0) {
+            for (size_t f = 0; f < _fields.size(); f++) {
+                if ((diff & _fields[f].inplace) != 0) {
+                    changes.push_back(Change{i, f, (previous >> _fields[f].shift) & _fields[f].mask, (values[i] >> _fields[f].shift) & _fields[f].mask});
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,66 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A class to decode large series of values of a system register.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "regview.h"
+#include "span.h"
+#include <vector>
+
+//
+// A class to decode large series of values of a system register, typically offline logs.
+//
+// The bitfields of the register are extracted in columns, one array per bitfield.
+// The shift and mask of each bitfield are computed once in the constructor.
+// Only 64-bit registers are decoded. The bitfields in the high part of a pair of
+// registers are ignored and always decoded as zero.
+//
+class RegDecoder
+{
+public:
+    // Constructor.
+    RegDecoder(const RegView::Register& reg);
+
+    // Get the register description.
+    const RegView::Register& reg() const { return _reg; }
+
+    // Number of bitfields, the order is the same as in the register description.
+    size_t fieldCount() const { return _fields.size(); }
+
+    // Decode a series of values. The columns vector is resized to the number of bitfields.
+    // columns[f][i] is the value of bitfield f in values[i].
+    void decode(Span<csr_u64_t> values, std::vector<std::vector<csr_u64_t>>& columns) const;
+
+    // Description of a change in the value of a bitfield.
+    struct Change {
+        size_t    index;     // index in the series of values
+        size_t    field;     // bitfield index in the register description
+        csr_u64_t previous;  // previous value of the bitfield
+        csr_u64_t value;     // new value of the bitfield
+    };
+
+    // Decode a series of values and return only the bitfields which changed from the previous value.
+    // The first value is compared with the initial value, when specified. Otherwise, all bitfields
+    // of the first value are returned, as changes from zero. The changes are appended to 'changes'.
+    void decodeChanges(Span<csr_u64_t> values, std::vector<Change>& changes, const csr_u64_t* initial = nullptr) const;
+
+private:
+    // Shift and mask of one bitfield.
+    struct FieldMask {
+        int       shift;     // lsb of the bitfield
+        csr_u64_t mask;      // mask after shift
+        csr_u64_t inplace;   // mask before shift
+    };
+
+    const RegView::Register& _reg;
+    std::vector<FieldMask>   _fields {};
+
+    // Extract one column.
+    static void extract(const csr_u64_t* in, csr_u64_t* out, size_t count, int shift, csr_u64_t mask);
+};
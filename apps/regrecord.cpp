@@ -0,0 +1,213 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Machine-readable streams of register and feature values.
+//
+//----------------------------------------------------------------------------
+
+#include "regrecord.h"
+#include "strutils.h"
+#include <algorithm>
+
+
+//----------------------------------------------------------------------------
+// Constructor.
+//----------------------------------------------------------------------------
+
+RegRecordWriter::RegRecordWriter(std::ostream& out, Format format) :
+    _out(out),
+    _format(format)
+{
+}
+
+
+//----------------------------------------------------------------------------
+// Write one register value.
+//----------------------------------------------------------------------------
+
+void RegRecordWriter::writeRegister(const RegView::Register& desc, const csr_pair_t& value, int cpu, int status)
+{
+    if (_format == BINARY) {
+        writeBinary(REGRECORD_REGISTER, desc.csr_index, desc.name, value, cpu, status);
+        return;
+    }
+
+    _buffer.assign("{\"type\":\"register\",\"name\":");
+    AppendJSONString(_buffer, desc.name);
+    _buffer.append(",\"csr_index\":");
+    AppendDecimal(_buffer, desc.csr_index);
+    if (cpu >= 0) {
+        _buffer.append(",\"cpu\":");
+        AppendDecimal(_buffer, cpu);
+    }
+    if (status != 0) {
+        _buffer.append(",\"status\":");
+        AppendDecimal(_buffer, status);
+    }
+    else {
+        // The raw value is a string because JSON numbers are not precise beyond 53 bits.
+        _buffer.append(",\"value\":\"0x");
+        if (desc.isPair()) {
+            AppendHexaDigits(_buffer, value.high, 16);
+        }
+        AppendHexaDigits(_buffer, value.low, 16);
+        _buffer.append("\",\"fields\":[");
+        for (size_t i = 0; i < desc.fields.size(); i++) {
+            const RegView::BitField& bf(desc.fields[i]);
+            const csr_u64_t bfval = RegView::Register::fieldValue(bf, value);
+            const RegView::Name* valname = RegView::Register::findValue(bf, bfval);
+            _buffer.append(i > 0 ? ",{\"name\":" : "{\"name\":");
+            AppendJSONString(_buffer, bf.name);
+            _buffer.append(",\"msb\":");
+            AppendDecimal(_buffer, bf.msb);
+            _buffer.append(",\"lsb\":");
+            AppendDecimal(_buffer, bf.lsb);
+            _buffer.append(",\"value\":");
+            AppendDecimal(_buffer, static_cast<long long>(bfval));
+            if (valname != nullptr) {
+                _buffer.append(",\"meaning\":");
+                AppendJSONString(_buffer, valname->name);
+            }
+            else if (!bf.values.empty()) {
+                _buffer.append(",\"meaning\":\"reserved\"");
+            }
+            _buffer.append(1, '}');
+        }
+        _buffer.append(1, ']');
+    }
+    _buffer.append("}\n");
+    _out.write(_buffer.data(), std::streamsize(_buffer.size()));
+}
+
+
+//----------------------------------------------------------------------------
+// Write the presence of one CPU feature.
+//----------------------------------------------------------------------------
+
+void RegRecordWriter::writeFeature(ArmFeature feature, bool present)
+{
+    const std::string_view name(FeatureSet::name(feature));
+    if (_format == BINARY) {
+        writeBinary(REGRECORD_FEATURE, int(feature), name, csr_pair_t{present ? 1u : 0u, 0}, -1, 0);
+        return;
+    }
+
+    _buffer.assign("{\"type\":\"feature\",\"name\":");
+    AppendJSONString(_buffer, name);
+    _buffer.append(",\"index\":");
+    AppendDecimal(_buffer, int(feature));
+    _buffer.append(present ? ",\"value\":true}\n" : ",\"value\":false}\n");
+    _out.write(_buffer.data(), std::streamsize(_buffer.size()));
+}
+
+
+//----------------------------------------------------------------------------
+// Write the presence of one feature, as seen in user mode.
+//----------------------------------------------------------------------------
+
+void RegRecordWriter::writeUserFeature(int index, std::string_view name, bool present)
+{
+    if (_format == BINARY) {
+        writeBinary(REGRECORD_USER_FEATURE, index, name, csr_pair_t{present ? 1u : 0u, 0}, -1, 0);
+        return;
+    }
+
+    _buffer.assign("{\"type\":\"user_feature\",\"name\":");
+    AppendJSONString(_buffer, name);
+    _buffer.append(",\"index\":");
+    AppendDecimal(_buffer, index);
+    _buffer.append(present ? ",\"value\":true}\n" : ",\"value\":false}\n");
+    _out.write(_buffer.data(), std::streamsize(_buffer.size()));
+}
+
+
+//----------------------------------------------------------------------------
+// Write one PAC geometry value.
+//----------------------------------------------------------------------------
+
+std::string RegRecordWriter::pacName(int index)
+{
+    static const char* const items[] = {"size", "top_bit", "bottom_bit", "sel_bit"};
+    if (index < 0 || index >= REGRECORD_PAC_COUNT) {
+        return std::string();
+    }
+    std::string name(items[index / 4]);
+    name.append(index & REGRECORD_PAC_INSTR ? ".instruction" : ".data");
+    name.append(index & REGRECORD_PAC_UPPER ? ".upper" : ".lower");
+    return name;
+}
+
+void RegRecordWriter::writePAC(RegRecordPAC index, int value)
+{
+    const std::string name(pacName(index));
+    if (_format == BINARY) {
+        writeBinary(REGRECORD_PAC, index, name, csr_pair_t{csr_u64_t(value), 0}, -1, 0);
+        return;
+    }
+
+    _buffer.assign("{\"type\":\"pac\",\"name\":");
+    AppendJSONString(_buffer, name);
+    _buffer.append(",\"index\":");
+    AppendDecimal(_buffer, index);
+    _buffer.append(",\"value\":");
+    AppendDecimal(_buffer, value);
+    _buffer.append("}\n");
+    _out.write(_buffer.data(), std::streamsize(_buffer.size()));
+}
+
+
+//----------------------------------------------------------------------------
+// Write a binary record.
+//----------------------------------------------------------------------------
+
+void RegRecordWriter::writeBinary(uint16_t type, int index, std::string_view name, const csr_pair_t& value, int cpu, int status)
+{
+    if (!_header) {
+        RegRecordHeader header;
+        Zero(&header, sizeof(header));
+        std::copy(std::begin(REGRECORD_MAGIC), std::end(REGRECORD_MAGIC), header.magic);
+        header.version = REGRECORD_VERSION;
+        header.record_size = sizeof(RegRecord);
+        _out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        _header = true;
+    }
+
+    RegRecord rec;
+    Zero(&rec, sizeof(rec));
+    rec.type = type;
+    rec.status = uint16_t(status);
+    rec.index = int32_t(index);
+    rec.cpu = int32_t(cpu);
+    rec.low = value.low;
+    rec.high = value.high;
+    name.copy(rec.name, std::min(name.size(), sizeof(rec.name) - 1));
+    _out.write(reinterpret_cast<const char*>(&rec), sizeof(rec));
+}
+
+
+//----------------------------------------------------------------------------
+// Get the records from a binary record stream in memory.
+//----------------------------------------------------------------------------
+
+bool RegRecordWriter::records(const void* data, size_t size, Span<RegRecord>& records)
+{
+    records = Span<RegRecord>();
+    const RegRecordHeader* header = reinterpret_cast<const RegRecordHeader*>(data);
+    if (data == nullptr || size < sizeof(RegRecordHeader) ||
+        !std::equal(std::begin(REGRECORD_MAGIC), std::end(REGRECORD_MAGIC), header->magic) ||
+        header->version != REGRECORD_VERSION ||
+        header->record_size != sizeof(RegRecord))
+    {
+        return false;
+    }
+    records = Span<RegRecord>(reinterpret_cast<const RegRecord*>(header + 1), (size - sizeof(RegRecordHeader)) / sizeof(RegRecord));
+    return true;
+}
+
+std::string_view RegRecordWriter::name(const RegRecord& rec)
+{
+    return std::string_view(rec.name, std::find(rec.name, rec.name + sizeof(rec.name), '\0') - rec.name);
+}
@@ -0,0 +1,124 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Machine-readable streams of register and feature values.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include "regview.h"
+#include "armfeatures.h"
+#include "span.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+//
+// A stream of records, one per register value or per CPU feature.
+//
+// Two formats are supported:
+// - JSON lines: one JSON object per line, with the decoded bitfields.
+// - Binary: a RegRecordHeader, followed by fixed-size RegRecord structures.
+//   Readers shall ignore records with unknown types, new types can be added
+//   without changing the version.
+//   The binary stream can be memory-mapped and indexed directly, see
+//   RegRecordWriter::records(). The byte order is the native one (little
+//   endian on Arm64). The bitfields are not included, they can be decoded
+//   from the raw value with RegView or RegDecoder.
+//
+// Each record is written in the output stream as soon as it is produced.
+//
+
+// Header of a binary record stream.
+struct RegRecordHeader {
+    char     magic[8];     // REGRECORD_MAGIC
+    uint32_t version;      // REGRECORD_VERSION
+    uint32_t record_size;  // sizeof(RegRecord)
+};
+
+// One fixed-size binary record.
+struct RegRecord {
+    uint16_t  type;       // REGRECORD_REGISTER, REGRECORD_FEATURE, etc.
+    uint16_t  status;     // 0 on success, same as csr_multi_reg_t status otherwise
+    int32_t   index;      // CSR_REGID_ value, ArmFeature index, etc.
+    int32_t   cpu;        // CPU core index, -1 when not specified
+    uint32_t  reserved;   // zero
+    csr_u64_t low;        // register value, 1/0 for a feature, PAC geometry value
+    csr_u64_t high;       // high part of a pair of registers, zero otherwise
+    char      name[32];   // nul-terminated name, truncated if necessary
+};
+
+static_assert(sizeof(RegRecordHeader) == 16, "invalid RegRecordHeader layout");
+static_assert(sizeof(RegRecord) == 64, "invalid RegRecord layout");
+
+constexpr char REGRECORD_MAGIC[8] = {'C', 'S', 'R', 'R', 'E', 'C', 'S', '\0'};
+constexpr uint32_t REGRECORD_VERSION = 1;
+constexpr uint16_t REGRECORD_REGISTER = 1;
+constexpr uint16_t REGRECORD_FEATURE = 2;
+constexpr uint16_t REGRECORD_USER_FEATURE = 3;  // index in the list of UserFeatures
+constexpr uint16_t REGRECORD_PAC = 4;           // index is a RegRecordPAC value
+
+// Index of PAC geometry records: an item, plus 1 for upper addresses, plus 2 for instructions.
+enum RegRecordPAC {
+    REGRECORD_PAC_SIZE       = 0,   // pacSize()
+    REGRECORD_PAC_TOP_BIT    = 4,   // pacTopBit()
+    REGRECORD_PAC_BOTTOM_BIT = 8,   // pacBottomBit()
+    REGRECORD_PAC_SEL_BIT    = 12,  // pacSelBit()
+    REGRECORD_PAC_UPPER      = 1,
+    REGRECORD_PAC_INSTR      = 2,
+    REGRECORD_PAC_COUNT      = 16,
+};
+
+//
+// A writer of register and feature records.
+//
+class RegRecordWriter
+{
+public:
+    // Output formats.
+    enum Format {JSON, BINARY};
+
+    // Constructor. The binary header is written with the first record.
+    RegRecordWriter(std::ostream& out, Format format);
+
+    // Write one register value.
+    void writeRegister(const RegView::Register& desc, const csr_pair_t& value, int cpu = -1, int status = 0);
+
+    // Write the presence of one CPU feature.
+    void writeFeature(ArmFeature feature, bool present);
+
+    // Write the presence of one feature, as seen in user mode (see UserFeatures).
+    void writeUserFeature(int index, std::string_view name, bool present);
+
+    // Write one PAC geometry value, as computed by ArmPseudoCode.
+    void writePAC(RegRecordPAC index, int value);
+
+    // Get the name of a PAC geometry record index, "size.data.lower" for instance.
+    static std::string pacName(int index);
+
+    // Get the records from a binary record stream in memory, typically a mapped file.
+    // Return false if the header is invalid. A truncated last record is ignored.
+    static bool records(const void* data, size_t size, Span<RegRecord>& records);
+
+    // Get the name in a record, as a string.
+    static std::string_view name(const RegRecord& rec);
+
+    // Cannot be copied or moved.
+    RegRecordWriter(RegRecordWriter&&) = delete;
+    RegRecordWriter(const RegRecordWriter&) = delete;
+    RegRecordWriter& operator=(RegRecordWriter&&) = delete;
+    RegRecordWriter& operator=(const RegRecordWriter&) = delete;
+
+private:
+    std::ostream& _out;
+    Format        _format;
+    bool          _header = false;  // binary header already written
+    std::string   _buffer {};       // reusable buffer for JSON lines
+
+    // Write a binary record.
+    void writeBinary(uint16_t type, int index, std::string_view name, const csr_pair_t& value, int cpu, int status);
+};
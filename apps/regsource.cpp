@@ -0,0 +1,168 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Selection of the fastest correct path to read the identification registers.
+//
+//----------------------------------------------------------------------------
+
+#include "regsource.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    // Candidate registers, in the range which is emulated by Linux: Op0=3, Op1=0, CRn=0, CRm=0,2-7.
+    // Same list as ArmFeatures::loadDirect(). The dependent registers are after PFR0 and PFR1.
+    constexpr int Candidates[] = {
+        CSR_REGID_ID_AA64ISAR0_EL1,
+        CSR_REGID_ID_AA64ISAR1_EL1,
+        CSR_REGID_ID_AA64ISAR2_EL1,
+        CSR_REGID_ID_AA64PFR0_EL1,
+        CSR_REGID_ID_AA64PFR1_EL1,
+        CSR_REGID_ID_AA64PFR2_EL1,
+        CSR_REGID_ID_AA64DFR0_EL1,
+        CSR_REGID_ID_AA64DFR1_EL1,
+        CSR_REGID_ID_AA64MMFR0_EL1,
+        CSR_REGID_ID_AA64MMFR1_EL1,
+        CSR_REGID_ID_AA64MMFR2_EL1,
+        CSR_REGID_ID_AA64MMFR3_EL1,
+        CSR_REGID_CTR_EL0,
+        CSR_REGID_ID_AA64SMFR0_EL1,
+        CSR_REGID_ID_AA64ZFR0_EL1,
+    };
+
+    // Elapsed nanoseconds since a start time.
+    csr_u64_t ElapsedNS(std::chrono::steady_clock::time_point start)
+    {
+        return csr_u64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    // Read a register using the kernel path of ArmFeatures::load(): snapshot or ioctl.
+    // The ioctl reads a list of one register: a missing register is a status, not an error.
+    bool ReadKernel(RegAccess& regs, std::vector<csr_multi_reg_t>& one, csr_u64_t& value, bool& snapshot)
+    {
+        const csr_snapshot_t* snap = RegAccess::snapshot();
+        const csr_multi_reg_t* found = snap == nullptr ? nullptr : csr_snapshot_find(snap, int(one[0].regid));
+        snapshot = found != nullptr;
+        if (found == nullptr && !regs.readMany(one)) {
+            return false;
+        }
+        value = found != nullptr ? found->value.low : one[0].value.low;
+        return (found != nullptr ? found->status : one[0].status) == 0;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Read a register at EL0.
+//----------------------------------------------------------------------------
+
+bool RegSource::isCandidate(int regid)
+{
+#if defined(__linux__)
+    for (int id : Candidates) {
+        if (id == regid) {
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+bool RegSource::readDirect(int regid, csr_u64_t& value)
+{
+#if defined(__linux__)
+    // MRS needs the register encoding as an immediate.
+    switch (regid) {
+        case CSR_REGID_ID_AA64ISAR0_EL1: csr_mrs(value, CSR_SREG_ID_AA64ISAR0_EL1); return true;
+        case CSR_REGID_ID_AA64ISAR1_EL1: csr_mrs(value, CSR_SREG_ID_AA64ISAR1_EL1); return true;
+        case CSR_REGID_ID_AA64ISAR2_EL1: csr_mrs(value, CSR_SREG_ID_AA64ISAR2_EL1); return true;
+        case CSR_REGID_ID_AA64PFR0_EL1:  csr_mrs(value, CSR_SREG_ID_AA64PFR0_EL1); return true;
+        case CSR_REGID_ID_AA64PFR1_EL1:  csr_mrs(value, CSR_SREG_ID_AA64PFR1_EL1); return true;
+        case CSR_REGID_ID_AA64PFR2_EL1:  csr_mrs(value, CSR_SREG_ID_AA64PFR2_EL1); return true;
+        case CSR_REGID_ID_AA64DFR0_EL1:  csr_mrs(value, CSR_SREG_ID_AA64DFR0_EL1); return true;
+        case CSR_REGID_ID_AA64DFR1_EL1:  csr_mrs(value, CSR_SREG_ID_AA64DFR1_EL1); return true;
+        case CSR_REGID_ID_AA64MMFR0_EL1: csr_mrs(value, CSR_SREG_ID_AA64MMFR0_EL1); return true;
+        case CSR_REGID_ID_AA64MMFR1_EL1: csr_mrs(value, CSR_SREG_ID_AA64MMFR1_EL1); return true;
+        case CSR_REGID_ID_AA64MMFR2_EL1: csr_mrs(value, CSR_SREG_ID_AA64MMFR2_EL1); return true;
+        case CSR_REGID_ID_AA64MMFR3_EL1: csr_mrs(value, CSR_SREG_ID_AA64MMFR3_EL1); return true;
+        case CSR_REGID_CTR_EL0:          csr_mrs(value, CSR_SREG_CTR_EL0); return true;
+        case CSR_REGID_ID_AA64SMFR0_EL1: csr_mrs(value, CSR_SREG_ID_AA64SMFR0_EL1); return true;
+        case CSR_REGID_ID_AA64ZFR0_EL1:  csr_mrs(value, CSR_SREG_ID_AA64ZFR0_EL1); return true;
+        default: break;
+    }
+#endif
+    return false;
+}
+
+
+//----------------------------------------------------------------------------
+// Probe all candidate registers.
+//----------------------------------------------------------------------------
+
+RegSource::RegSource(RegAccess& regs) :
+    _probes()
+{
+    csr_u64_t pfr0 = 0;
+    csr_u64_t pfr1 = 0;
+
+    for (int regid : Candidates) {
+        Probe probe;
+        probe.regid = regid;
+
+        // Kernel path, the reference value.
+        csr_u64_t reference = 0;
+        std::vector<csr_multi_reg_t> one {csr_multi_reg_t{csr_u64_t(regid), 0, {0, 0}}};
+        probe.kernel_ok = regs.isOpen();
+        for (size_t i = 0; probe.kernel_ok && i < PROBE_COUNT; i++) {
+            const auto start = std::chrono::steady_clock::now();
+            probe.kernel_ok = ReadKernel(regs, one, reference, probe.snapshot);
+            const csr_u64_t ns = ElapsedNS(start);
+            probe.kernel_ns = i == 0 ? ns : std::min(probe.kernel_ns, ns);
+        }
+        if (regid == CSR_REGID_ID_AA64PFR0_EL1) {
+            pfr0 = reference;
+        }
+        else if (regid == CSR_REGID_ID_AA64PFR1_EL1) {
+            pfr1 = reference;
+        }
+
+        // EL0 path, only when the value can be verified and the register exists.
+        const bool exists = (regid != CSR_REGID_ID_AA64SMFR0_EL1 || csr_has_sme(pfr1)) && (regid != CSR_REGID_ID_AA64ZFR0_EL1 || csr_has_sve(pfr0));
+        if (probe.kernel_ok && exists && isCandidate(regid)) {
+            probe.direct_ok = true;
+            for (size_t i = 0; probe.direct_ok && i < PROBE_COUNT; i++) {
+                csr_u64_t value = 0;
+                const auto start = std::chrono::steady_clock::now();
+                probe.direct_ok = readDirect(regid, value);
+                const csr_u64_t ns = ElapsedNS(start);
+                probe.direct_ns = i == 0 ? ns : std::min(probe.direct_ns, ns);
+                probe.masked = probe.masked || value != reference;
+            }
+            if (probe.direct_ok && !probe.masked && probe.direct_ns < probe.kernel_ns) {
+                probe.path = DIRECT;
+            }
+        }
+        _probes.push_back(probe);
+    }
+    regs.clearError();
+}
+
+const RegSource& RegSource::instance(RegAccess& regs)
+{
+    // Thread-safe initialization, the first time only.
+    static const RegSource source(regs);
+    return source;
+}
+
+RegSource::Path RegSource::path(int regid) const
+{
+    for (const auto& probe : _probes) {
+        if (probe.regid == regid) {
+            return probe.path;
+        }
+    }
+    return KERNEL;
+}
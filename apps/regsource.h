@@ -0,0 +1,70 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Selection of the fastest correct path to read the identification registers.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "regaccess.h"
+#include <vector>
+
+//
+// Selection of the fastest correct path to read the identification registers.
+//
+// On Linux, the identification registers can be read at EL0 using MRS: the instruction
+// traps in the kernel which emulates it. They can also be read by the kernel module, from
+// its snapshot without system call or with one ioctl. In a virtual machine, both paths may
+// also trap to the hypervisor. Which one is cheaper depends on the host.
+//
+// The probe measures the latency of each path once per register. The EL0 path is selected
+// only when it is faster and returns the same value as the kernel module: the Linux emulation
+// hides the fields which are not exposed to applications and reports the same sanitized value
+// on all CPU cores. Without the kernel module, nothing can be verified and the EL0 path is
+// never selected. On other systems, there is no EL0 emulation.
+//
+class RegSource
+{
+public:
+    // Path to read a register.
+    enum Path {KERNEL, DIRECT};
+
+    // Result of the probe for one register.
+    struct Probe {
+        int       regid = 0;
+        Path      path = KERNEL;      // selected path
+        bool      kernel_ok = false;  // successfully read by the kernel module
+        bool      direct_ok = false;  // successfully read at EL0
+        bool      masked = false;     // the EL0 value is different, some fields are masked
+        bool      snapshot = false;   // the kernel path uses the snapshot, without system call
+        csr_u64_t kernel_ns = 0;      // minimum latency of the kernel path in nanoseconds
+        csr_u64_t direct_ns = 0;      // minimum latency of the EL0 path in nanoseconds
+    };
+
+    // Number of reads per register and path during the probe. The minimum latency is kept.
+    static constexpr size_t PROBE_COUNT = 8;
+
+    // Constructor: probe all candidate registers using a kernel module access.
+    RegSource(RegAccess& regs);
+
+    // Get a process-wide instance, probed on first use only, thread-safe.
+    static const RegSource& instance(RegAccess& regs = RegAccess::shared());
+
+    // Selected path for a register, KERNEL for all registers which are not candidates.
+    Path path(int regid) const;
+
+    // Results of the probe, in the order of the candidate registers.
+    const std::vector<Probe>& probes() const { return _probes; }
+
+    // Check if a register can be read at EL0 on this system.
+    static bool isCandidate(int regid);
+
+    // Read a register at EL0, using MRS. Return false if the register is not a candidate.
+    static bool readDirect(int regid, csr_u64_t& value);
+
+private:
+    std::vector<Probe> _probes;
+};
@@ -0,0 +1,436 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Load test of the kernel module: concurrent register reads, PAC instructions
+// and request batches from 1 to N threads, bound to distinct CPU cores.
+//
+// For each workload and each number of threads, all threads start at the
+// same time and issue the same number of calls. The latency of each call is
+// recorded in a histogram. The aggregated throughput is the total number of
+// calls divided by the elapsed time of the slowest thread.
+//
+// The results are checked under contention: a register which cannot change
+// (MIDR_EL1) must be identical in all calls of a bound thread and a pointer
+// which is signed (PACIA) must be authenticated (AUTIA) without error. In a
+// request batch (RegAccess::executeRequests), each request must return its
+// expected value and status, including the invalid requests.
+//
+//----------------------------------------------------------------------------
+
+#include "cpusysregs.h"
+#include "cputimer.h"
+#include "cputopology.h"
+#include "regaccess.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <cinttypes>
+#include <clocale>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    size_t      calls;
+    size_t      max_threads;
+    bool        separate;
+    bool        verbose;
+    bool        do_read;
+    bool        do_pac;
+    bool        do_batch;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -b : request batches only (reads, writes, PACIA, invalid requests)" << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -n count : number of calls per thread (default: 20000)" << std::endl
+              << "  -p : PAC instructions only (PACIA, AUTIA)" << std::endl
+              << "  -r : register reads only (MIDR_EL1)" << std::endl
+              << "  -s : separate file descriptor per thread (default: one shared descriptor)" << std::endl
+              << "  -t count : maximum number of threads (default: number of CPU cores)" << std::endl
+              << "  -v : verbose, display the latency histograms" << std::endl
+              << std::endl
+              << "The number of threads is 1, 2, 4, ... up to the maximum. The exit status is" << std::endl
+              << "non-zero when some calls failed or returned inconsistent results." << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    calls(20000),
+    max_threads(std::max(1u, std::thread::hardware_concurrency())),
+    separate(false),
+    verbose(false),
+    do_read(true),
+    do_pac(true),
+    do_batch(true)
+{
+    bool read_only = false;
+    bool pac_only = false;
+    bool batch_only = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-b") {
+            batch_only = true;
+        }
+        else if (arg == "-n" && i+1 < argc) {
+            calls = std::max<size_t>(1, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else if (arg == "-p") {
+            pac_only = true;
+        }
+        else if (arg == "-r") {
+            read_only = true;
+        }
+        else if (arg == "-s") {
+            separate = true;
+        }
+        else if (arg == "-t" && i+1 < argc) {
+            max_threads = std::max<size_t>(1, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else if (arg == "-v") {
+            verbose = true;
+        }
+        else {
+            fatal("invalid option '" + arg + "', try --help");
+        }
+    }
+    if (read_only || pac_only || batch_only) {
+        do_read = read_only;
+        do_pac = pac_only;
+        do_batch = batch_only;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// One thread of the load test.
+//----------------------------------------------------------------------------
+
+// Workloads.
+enum Workload {READ, PAC, BATCH};
+
+// Requests in the batch workload, with their expected status.
+enum {
+    BATCH_MIDR,       // read MIDR_EL1, 0
+    BATCH_SIGN1,      // PACIA, same result as BATCH_SIGN2
+    BATCH_SIGN2,      // PACIA
+    BATCH_ROWRITE,    // write MIDR_EL1, 1 (not writable)
+    BATCH_BADREG,     // read an invalid register, 1
+    BATCH_BADOP,      // invalid request type, 1
+    BATCH_TPIDR,      // write and read back TPIDR_EL0 with its current value, 0 (Linux only)
+    BATCH_COUNT
+};
+
+// Build a batch of requests. The pointer is signed with the given modifier.
+static std::vector<csr_request_t> BuildBatch(csr_u64_t pointer, csr_u64_t modifier)
+{
+    std::vector<csr_request_t> reqs(BATCH_COUNT);
+    reqs[BATCH_MIDR]    = csr_request_t{CSR_REQ_GET, CSR_REGID_MIDR_EL1, 0, {0, 0}, 0};
+    reqs[BATCH_SIGN1]   = csr_request_t{CSR_REQ_INSTR, CSR_INSTR_PACIA, 0, {pointer, 0}, modifier};
+    reqs[BATCH_SIGN2]   = reqs[BATCH_SIGN1];
+    reqs[BATCH_ROWRITE] = csr_request_t{CSR_REQ_SET, CSR_REGID_MIDR_EL1, 0, {0, 0}, 0};
+    reqs[BATCH_BADREG]  = csr_request_t{CSR_REQ_GET, _CSR_REGID2_END, 0, {0, 0}, 0};
+    reqs[BATCH_BADOP]   = csr_request_t{_CSR_REQ_END, CSR_REGID_MIDR_EL1, 0, {0, 0}, 0};
+#if defined(__linux__) && defined(__aarch64__)
+    // Linux saves TPIDR_EL0 per thread and the requests run in the context of the calling
+    // thread (CSR_CPU_ANY). Writing back the value which is read at EL0 does not change it.
+    csr_u64_t tpidr = 0;
+    csr_mrs(tpidr, CSR_SREG_TPIDR_EL0);
+    reqs[BATCH_TPIDR] = csr_request_t{CSR_REQ_SETGET, CSR_REGID_TPIDR_EL0, 0, {tpidr, 0}, 0};
+#else
+    reqs.resize(BATCH_TPIDR);
+#endif
+    return reqs;
+}
+
+// Check the results of a batch, return the number of unexpected results.
+static size_t CheckBatch(const std::vector<csr_request_t>& reqs, const std::vector<csr_request_t>& sent, const csr_u64_t* midr)
+{
+    size_t mismatches = 0;
+    mismatches += reqs[BATCH_MIDR].status != 0 || (midr != nullptr && reqs[BATCH_MIDR].value.low != *midr);
+    mismatches += reqs[BATCH_SIGN1].status != reqs[BATCH_SIGN2].status ||
+                  (reqs[BATCH_SIGN1].status == 0 && reqs[BATCH_SIGN1].value.low != reqs[BATCH_SIGN2].value.low);
+    mismatches += reqs[BATCH_ROWRITE].status != 1;
+    mismatches += reqs[BATCH_BADREG].status != 1;
+    mismatches += reqs[BATCH_BADOP].status != 1;
+    if (reqs.size() > BATCH_TPIDR) {
+        mismatches += reqs[BATCH_TPIDR].status != 0 || reqs[BATCH_TPIDR].value.low != sent[BATCH_TPIDR].value.low;
+    }
+    return mismatches;
+}
+
+// Latency buckets in nanoseconds, a kernel call is typically a few micro-seconds.
+static const std::vector<csr_u64_t> LatencyLimits {250, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 1000000};
+
+// Results of one thread.
+struct ThreadResult {
+    TimerHistogram histo {LatencyLimits};
+    double         elapsed_ns = 0;
+    size_t         errors = 0;
+    size_t         mismatches = 0;
+    bool           bound = false;
+};
+
+// Body of one thread.
+static void StressThread(const Options& opt, Workload workload, RegAccess& regs, size_t cpu, std::atomic<bool>& go, ThreadResult& result)
+{
+    const CpuTimer& timer(CpuTimer::instance());
+    result.bound = CpuTopology::bindThread(cpu);
+
+    // Reference value of the register, read before the start.
+    csr_u64_t reference = 0;
+    const bool check_reg = result.bound && regs.read(CSR_REGID_MIDR_EL1, reference);
+
+    // A pointer-like value to sign, different in each thread.
+    const csr_u64_t pointer = csr_u64_t(reinterpret_cast<uintptr_t>(&result)) & 0x0000FFFFFFFFFFF0;
+
+    // The request batch is built once, the modifier is the thread index.
+    const std::vector<csr_request_t> batch(BuildBatch(pointer, cpu));
+    std::vector<csr_request_t> reqs;
+
+    while (!go.load(std::memory_order_acquire)) {
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < opt.calls; i++) {
+        if (workload == READ) {
+            csr_u64_t value = 0;
+            bool ok = false;
+            {
+                ScopedTimer st(result.histo, timer);
+                ok = regs.read(CSR_REGID_MIDR_EL1, value);
+            }
+            if (!ok) {
+                result.errors++;
+            }
+            else if (check_reg && value != reference) {
+                result.mismatches++;
+            }
+        }
+        else if (workload == BATCH) {
+            reqs = batch;
+            bool ok = false;
+            {
+                ScopedTimer st(result.histo, timer);
+                ok = regs.executeRequests(reqs);
+            }
+            if (!ok) {
+                result.errors++;
+            }
+            else {
+                result.mismatches += CheckBatch(reqs, batch, check_reg ? &reference : nullptr);
+            }
+        }
+        else {
+            // Sign and authenticate, two calls, the modifier is the call index.
+            csr_instr_t args {pointer, csr_u64_t(i)};
+            bool ok = false;
+            {
+                ScopedTimer st(result.histo, timer);
+                ok = regs.executeInstr(CSR_INSTR_PACIA, args);
+            }
+            if (ok) {
+                ScopedTimer st(result.histo, timer);
+                ok = regs.executeInstr(CSR_INSTR_AUTIA, args);
+            }
+            if (!ok) {
+                result.errors++;
+            }
+            else if (args.value != pointer) {
+                result.mismatches++;
+            }
+        }
+    }
+    result.elapsed_ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+
+//----------------------------------------------------------------------------
+// Run one workload with a given number of threads, display one line.
+// Return false if some calls failed or were inconsistent.
+//----------------------------------------------------------------------------
+
+static bool RunStress(const Options& opt, Workload workload, size_t thread_count)
+{
+    const size_t cpus = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::unique_ptr<RegAccess>> separate;
+    std::vector<ThreadResult> results(thread_count);
+    std::vector<std::thread> threads;
+    std::atomic<bool> go(false);
+
+    for (size_t i = 0; i < thread_count; i++) {
+        RegAccess* regs = &RegAccess::shared();
+        if (opt.separate) {
+            separate.emplace_back(new RegAccess);
+            regs = separate.back().get();
+        }
+        threads.emplace_back(StressThread, std::cref(opt), workload, std::ref(*regs), i % cpus, std::ref(go), std::ref(results[i]));
+    }
+    go.store(true, std::memory_order_release);
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    // Aggregate the results of all threads.
+    TimerHistogram histo(LatencyLimits);
+    double elapsed_ns = 0;
+    size_t errors = 0;
+    size_t mismatches = 0;
+    size_t unbound = 0;
+    for (const auto& res : results) {
+        histo.add(res.histo);
+        elapsed_ns = std::max(elapsed_ns, res.elapsed_ns);
+        errors += res.errors;
+        mismatches += res.mismatches;
+        unbound += !res.bound;
+    }
+    const double ops = elapsed_ns > 0 ? double(histo.count()) * 1e9 / elapsed_ns : 0.0;
+    const char* const name = workload == READ ? "read" : (workload == PAC ? "pac" : "batch");
+
+    std::cout << Format("%-6s %7zu %'14.0f %'8" PRIu64 " %'8" PRIu64 " %'10" PRIu64 " %7zu %10zu",
+                        name, thread_count, ops, histo.min(), histo.average(), histo.max(), errors, mismatches) << std::endl;
+    if (unbound > 0 && thread_count == 1) {
+        std::cout << "# threads cannot be bound to CPU cores, the register values are not checked" << std::endl;
+    }
+    if (opt.verbose) {
+        histo.print(std::cout, Format("%s, %zu threads, latency per call", name, thread_count));
+        std::cout << std::endl;
+    }
+    return errors == 0 && mismatches == 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Check a batch which is longer than CSR_REQUESTS_MAX, split in several calls.
+// Valid and invalid reads are interleaved, the status of each request is checked.
+// The MIDR values are checked only when all calls run on the same core (bound).
+// Return false if some results are unexpected.
+//----------------------------------------------------------------------------
+
+static bool CheckLongBatch(const Options& opt, RegAccess& regs, csr_u64_t midr, bool bound)
+{
+    std::vector<csr_request_t> reqs(CSR_REQUESTS_MAX + 3);
+    for (size_t i = 0; i < reqs.size(); i++) {
+        reqs[i] = csr_request_t{CSR_REQ_GET, csr_u64_t(i % 3 == 2 ? _CSR_REGID2_END : CSR_REGID_MIDR_EL1), 0, {0, 0}, 0};
+    }
+    if (!regs.executeRequests(reqs)) {
+        regs.printLastError(opt.command);
+        return false;
+    }
+    size_t mismatches = 0;
+    for (size_t i = 0; i < reqs.size(); i++) {
+        mismatches += i % 3 == 2 ? reqs[i].status != 1 : reqs[i].status != 0 || (bound && reqs[i].value.low != midr);
+    }
+    std::cout << Format("long batch: %zu requests, %zu mismatches", reqs.size(), mismatches) << std::endl;
+    return mismatches == 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Program entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    // Make sure printf knows how to format integers.
+    setlocale(LC_ALL, "en_US.UTF-8");
+
+    const Options opt(argc, argv);
+    const CpuTimer& timer(CpuTimer::instance());
+    RegAccess& regs(RegAccess::shared());
+    int status = EXIT_SUCCESS;
+
+    if (!regs.isOpen()) {
+        opt.fatal("kernel module not loaded");
+    }
+
+    // Make sure that the workloads are supported before starting threads.
+    csr_u64_t value = 0;
+    bool do_read = opt.do_read;
+    bool do_pac = opt.do_pac;
+    bool do_batch = opt.do_batch;
+    if (do_read && !regs.read(CSR_REGID_MIDR_EL1, value)) {
+        std::cerr << opt.command << ": cannot read MIDR_EL1, skipping register reads" << std::endl;
+        do_read = false;
+    }
+    csr_instr_t args {0, 0};
+    if (do_pac && !regs.executeInstr(CSR_INSTR_PACIA, args)) {
+        std::cerr << opt.command << ": PAC instructions not supported, skipping PAC workload" << std::endl;
+        do_pac = false;
+    }
+    // The probe and the long batch must run on the same core, the MIDR may differ between cores.
+    // The stress threads are explicitly bound to their own core and are not affected.
+    const bool bound = CpuTopology::bindThread(0);
+    std::vector<csr_request_t> probe(BuildBatch(0, 0));
+    if (do_batch && (!regs.executeRequests(probe) || probe[BATCH_MIDR].status != 0)) {
+        std::cerr << opt.command << ": request batches not supported, skipping batch workload" << std::endl;
+        do_batch = false;
+    }
+    regs.clearError();
+
+    std::cout << "Counter: " << timer.sourceName() << ", read overhead: " << Format("%.1f", timer.nanoseconds(timer.overhead()))
+              << " ns, calls per thread: " << opt.calls << ", " << (opt.separate ? "one file descriptor per thread" : "shared file descriptor")
+              << std::endl << std::endl
+              << "load   threads          ops/s   min ns   avg ns     max ns  errors mismatches" << std::endl;
+
+    for (Workload workload : {READ, PAC, BATCH}) {
+        if ((workload == READ && !do_read) || (workload == PAC && !do_pac) || (workload == BATCH && !do_batch)) {
+            continue;
+        }
+        for (size_t count = 1; ; count = std::min(count * 2, opt.max_threads)) {
+            if (!RunStress(opt, workload, count)) {
+                status = EXIT_FAILURE;
+            }
+            if (count >= opt.max_threads) {
+                break;
+            }
+        }
+    }
+    if (do_batch) {
+        std::cout << std::endl;
+        if (!CheckLongBatch(opt, regs, probe[BATCH_MIDR].value.low, bound)) {
+            status = EXIT_FAILURE;
+        }
+    }
+    return status;
+}
@@ -12,6 +12,7 @@
 #include "restrictions.h"
 #include "armfeatures.h"
 #include "strutils.h"
+#include <list>
 
 #if defined(CSR_AVOID_PAC_KEY_REGISTERS)
     #define READ_PAC  0
@@ -49,13 +50,6 @@
     #define WRITE_CNTPS_CTL_EL1 RegView::WRITE
 #endif
 
-// Map view of AllRegisters, indexed by CMD_REG_ values and names.
-std::map<int, RegView::Register> RegView::AllRegistersByIndex;
-std::map<std::string, RegView::Register> RegView::AllRegistersByName;
-
-// A dummy empty description.
-const RegView::Register RegView::EmptyRegister {"", INVALID, 0, {}};
-
 
 //----------------------------------------------------------------------------
 // Check CPU features
@@ -63,7 +57,11 @@ const RegView::Register RegView::EmptyRegister {"", INVALID, 0, {}};
 
 bool RegView::Register::isSupported(RegAccess& ra) const
 {
-    ArmFeatures feat(ra);
+    return isSupported(ArmFeatures::instance());
+}
+
+bool RegView::Register::isSupported(const ArmFeatures& feat) const
+{
     return (!(features & NEED_PAC) || feat.FEAT_PAuth()) &&
            (!(features & NEED_PACGA) || feat.hasPACGA()) &&
            (!(features & NEED_CSV2_2) || feat.FEAT_CSV2_2()) &&
@@ -136,1058 +134,975 @@ std::string RegView::Register::featuresList() const
 // Descriptions of all known registers.
 //----------------------------------------------------------------------------
 
-const std::list<RegView::Register> RegView::AllRegisters {
-    /* --------
-     * Template for copy/paste on new registers:
-    {
-        "", CSR_REGID_, READ,
-        {
-            {"",    63, 60, {{0, "none"}, {1, ""}}},
-            {"",    59, 56, {{0, "none"}, {1, ""}}},
-            {"",    55, 52, {{0, "none"}, {1, ""}}},
-            {"",    51, 48, {{0, "none"}, {1, ""}}},
-            {"",    47, 44, {{0, "none"}, {1, ""}}},
-            {"",    43, 40, {{0, "none"}, {1, ""}}},
-            {"",    39, 36, {{0, "none"}, {1, ""}}},
-            {"",    35, 32, {{0, "none"}, {1, ""}}},
-            {"",    31, 28, {{0, "none"}, {1, ""}}},
-            {"",    27, 24, {{0, "none"}, {1, ""}}},
-            {"",    23, 20, {{0, "none"}, {1, ""}}},
-            {"",    19, 16, {{0, "none"}, {1, ""}}},
-            {"",    15, 12, {{0, "none"}, {1, ""}}},
-            {"",    11,  8, {{0, "none"}, {1, ""}}},
-            {"",     7,  4, {{0, "none"}, {1, ""}}},
-            {"",     3,  0, {{0, "none"}, {1, ""}}},
-        }
-    },
-    -------- */
-    {
-        "APDAKEY_EL1", CSR_REGID2_APDAKEY_EL1, READ_PAC | WRITE_PAC | NEED_PAC, {}
-    },
-    {
-        "APDBKEY_EL1", CSR_REGID2_APDBKEY_EL1, READ_PAC | WRITE_PAC | NEED_PAC, {}
-    },
-    {
-        "APGAKEY_EL1", CSR_REGID2_APGAKEY_EL1, READ_PAC | WRITE_PAC | NEED_PACGA, {}
-    },
-    {
-        "APIAKEY_EL1", CSR_REGID2_APIAKEY_EL1, READ_PAC | WRITE_PAC | NEED_PAC, {}
-    },
-    {
-        "APIBKEY_EL1", CSR_REGID2_APIBKEY_EL1, READ_PAC | WRITE_PAC | NEED_PAC, {}
-    },
-    {
-        "CNTFRQ_EL0", CSR_REGID_CNTFRQ_EL0, READ,
-        {
-            {"Clock frequency", 31, 0, {}},
-        }
-    },
-    {
-        "CNTKCTL_EL1", CSR_REGID_CNTKCTL_EL1, READ | WRITE,
-        {
-            {"EVNTIS",  17, 17, {}},
-            {"EL0PTEN",  9,  9, {}},
-            {"EL0VTEN",  8,  8, {}},
-            {"EVNTI",    7,  4, {}},
-            {"EVNTDIR",  3,  3, {}},
-            {"EVNTEN",   2,  2, {}},
-            {"EL0VCTEN", 1,  1, {}},
-            {"EL0PCTEN", 0,  0, {}},
-        }
-    },
-    {
-        "CNTPCT_EL0", CSR_REGID_CNTPCT_EL0, READ, {}
-    },
-    {
-        "CNTPS_CTL_EL1", CSR_REGID_CNTPS_CTL_EL1, READ_CNTPS_CTL_EL1 | WRITE_CNTPS_CTL_EL1,
-        {
-            {"ISTATUS", 2, 2, {}},
-            {"IMASK",   1, 1, {}},
-            {"ENABLE",  0, 0, {}},
-        }
-    },
-    {
-        "CNTVCT_EL0", CSR_REGID_CNTVCT_EL0, READ, {}
-    },
-    {
-        "CTR_EL0", CSR_REGID_CTR_EL0, READ_CTR_EL0,
-        {
-            {"TminLine", 37, 32, {}},
-            {"DIC",      29, 29, {}},
-            {"IDC",      28, 28, {}},
-            {"CWG",      27, 24, {}},
-            {"ERG",      23, 20, {}},
-            {"DminLine", 19, 16, {}},
-            {"L1Ip",     15, 14, {{0, "VPIPT"}, {1, "AIVIVT"}, {2, "VIPT"}, {3, "PIPT"}}},
-            {"IminLine",  3,  0, {}},
-        }
-    },
-    {
-        "HCR_EL2", CSR_REGID_HCR_EL2, 0, {
-            {"TWEDEL",   63, 60, {}},
-            {"TWEDEn",   59, 59, {}},
-            {"TID5",     58, 58, {{0, "none"}, {1, "trap"}}},
-            {"DCT",      57, 57, {{0, "untagged"}, {1, "tagged"}}},
-            {"ATA",      56, 56, {{0, "forbidden"}, {1, "allowed"}}},
-            {"TTLBOS",   55, 55, {{0, "none"}, {1, "trap"}}},
-            {"TTLBIS",   54, 54, {{0, "none"}, {1, "trap"}}},
-            {"EnSCXT",   53, 53, {{0, "none"}, {1, "trap"}}},
-            {"TOCU",     52, 52, {{0, "none"}, {1, "trap"}}},
-            {"AMVOFFEN", 51, 51, {{0, "disabled"}, {1, "enabled"}}},
-            {"TICAB",    50, 50, {{0, "none"}, {1, "trap"}}},
-            {"TID4",     49, 49, {{0, "none"}, {1, "trap"}}},
-            {"GPF",      48, 48, {{0, "none"}, {1, "trap"}}},
-            {"FIEN",     47, 47, {{0, "trap"}, {1, "none"}}},
-            {"FWB",      46, 46, {}},
-            {"NV2",      45, 45, {}},
-            {"AT",       44, 44, {{0, "none"}, {1, "trap"}}},
-            {"NV1",      43, 43, {}},
-            {"NV",       42, 42, {}},
-            {"API",      41, 41, {{0, "trap"}, {1, "none"}}},
-            {"APK",      40, 40, {{0, "trap"}, {1, "none"}}},
-            {"TME",      39, 39, {{0, "undefined"}, {1, "normal"}}},
-            {"MIOCNCE",  38, 38, {}},
-            {"TEA",      37, 37, {}},
-            {"TERR",     36, 36, {{0, "none"}, {1, "trap"}}},
-            {"TLOR",     35, 35, {{0, "none"}, {1, "trap"}}},
-            {"E2H",      34, 34, {{0, "disabled"}, {1, "enabled"}}},
-            {"ID",       33, 33, {}},
-            {"CD",       32, 32, {}},
-            {"RW",       31, 31, {}},
-            {"TRVM",     30, 30, {{0, "none"}, {1, "trap"}}},
-            {"HCD",      29, 29, {{0, "none"}, {1, "undefined"}}},
-            {"TDZ",      28, 28, {}},
-            {"TGE",      27, 27, {}},
-            {"TVM",      26, 26, {{0, "none"}, {1, "trap"}}},
-            {"TTLB",     25, 25, {{0, "none"}, {1, "trap"}}},
-            {"TPU",      24, 24, {{0, "none"}, {1, "trap"}}},
-            {"TPCP",     23, 23, {{0, "none"}, {1, "trap"}}},
-            {"TSW",      22, 22, {}},
-            {"TACR",     21, 21, {{0, "none"}, {1, "trap"}}},
-            {"TIDCP",    20, 20, {{0, "none"}, {1, "trap"}}},
-            {"TSC",      19, 19, {{0, "none"}, {1, "trap"}}},
-            {"TID3",     18, 18, {{0, "none"}, {1, "trap"}}},
-            {"TID2",     17, 17, {{0, "none"}, {1, "trap"}}},
-            {"TID1",     16, 16, {{0, "none"}, {1, "trap"}}},
-            {"TID0",     15, 15, {{0, "none"}, {1, "trap"}}},
-            {"TWE",      14, 14, {{0, "none"}, {1, "trap"}}},
-            {"TWI",      13, 13, {{0, "none"}, {1, "trap"}}},
-            {"DC",       12, 12, {}},
-            {"BSU",      11, 10, {{0, "none"}, {1, "inner shareable"}, {2, "outer shareable"}, {3, "full system"}}},
-            {"FB",        9,  9, {}},
-            {"VSE",       8,  8, {}},
-            {"VI",        7,  7, {{0, "none"}, {1, "IRQ pending"}}},
-            {"VF",        6,  6, {{0, "none"}, {1, "IRQ pending"}}},
-            {"AMO",       5,  5, {}},
-            {"IMO",       4,  4, {}},
-            {"FMO",       3,  3, {}},
-            {"PTW",       2,  2, {}},
-            {"SWIO",      1,  1, {}},
-            {"VM",        0,  0, {{0, "disabled"}, {1, "enabled"}}},
-        }
-    },
-    {
-        "ID_AA64AFR0_EL1", CSR_REGID_ID_AA64AFR0_EL1, READ, {}
-    },
-    {
-        "ID_AA64AFR1_EL1", CSR_REGID_ID_AA64AFR1_EL1, READ, {}
-    },
-    {
-        "ID_AA64DFR0_EL1", CSR_REGID_ID_AA64DFR0_EL1, READ,
-        {
-            {"HPMN0",       63, 60, {{0, "none"}, {1, "HPMN0"}}},
-            {"ExtTrcBuff",  59, 56, {}},
-            {"BRBE",        55, 52, {{0, "none"}, {1, "BRBE"}, {2, "BRBEv1p1"}}},
-            {"MTPMU",       51, 48, {}},
-            {"TraceBuffer", 47, 44, {{0, "none"}, {1, "TRBE"}}},
-            {"TraceFilt",   43, 40, {{0, "none"}, {1, "TRBF"}}},
-            {"DoubleLock",  39, 36, {{0, "DoubleLock"}, {15, "none"}}},
-            {"PMSVer",      35, 32, {}},
-            {"CTX_CMPs",    31, 28, {}},
-            {"SEBEP",       27, 24, {}},
-            {"WRPs",        23, 20, {}},
-            {"PMSS",        19, 16, {}},
-            {"BRPs",        15, 12, {}},
-            {"PMUVer",      11,  8, {}},
-            {"TraceVer",     7,  4, {}},
-            {"DebugVer",     3,  0, {}},
-        }
-    },
-    {
-        "ID_AA64DFR1_EL1", CSR_REGID_ID_AA64DFR1_EL1, READ,
-        {
-            {"ABL_CMPs", 63, 56, {}},
-            {"EBEP",     51, 48, {}},
-            {"ITE",      47, 44, {}},
-            {"ABLE",     43, 40, {}},
-            {"PMICNTR",  39, 36, {}},
-            {"SPMU",     35, 32, {}},
-            {"CTX_CMPs", 31, 24, {}},
-            {"WRPs",     23, 16, {}},
-            {"BRPs",     15,  8, {}},
-            {"SYSPMUID",  7,  0, {}},
-        }
-    },
-    {
-        "ID_AA64ISAR0_EL1", CSR_REGID_ID_AA64ISAR0_EL1, READ,
-        {
-            {"RNDR",   63, 60, {{0, "none"}, {1, "RNG"}}},
-            {"TLB",    59, 56, {{0, "none"}, {1, "TLBIOS"}, {2, "TLBIOS+TLBIRANGE"}}},
-            {"TS",     55, 52, {{0, "none"}, {1, "FlagM"}, {2, "FlagM2"}}},
-            {"FHM",    51, 48, {{0, "none"}, {1, "FHM"}}},
-            {"DP",     47, 44, {{0, "none"}, {1, "DotProd"}}},
-            {"SM4",    43, 40, {{0, "none"}, {1, "SM4"}}},
-            {"SM3",    39, 36, {{0, "none"}, {1, "SM3"}}},
-            {"SHA3",   35, 32, {{0, "none"}, {1, "SHA3"}}},
-            {"RDM",    31, 28, {{0, "none"}, {1, "RDM"}}},
-            {"TME",    27, 24, {{0, "none"}, {1, "TME"}}},
-            {"Atomic", 23, 20, {{0, "none"}, {2, "LSE"}}},
-            {"CRC32",  19, 16, {{0, "none"}, {1, "CRC32"}}},
-            {"SHA2",   15, 12, {{0, "none"}, {1, "SHA256"}, {2, "SHA256+SHA512"}}},
-            {"SHA1",   11,  8, {{0, "none"}, {1, "SHA1"}}},
-            {"AES",     7,  4, {{0, "none"}, {1, "AES"}, {2, "AES+PMULL"}}},
-        }
-    },
-    {
-        "ID_AA64ISAR1_EL1", CSR_REGID_ID_AA64ISAR1_EL1, READ,
-        {
-            {"LS64",    63, 60, {{0, "none"}, {1, "LS64"}, {2, "LS64+LS64_V"}, {3, "LS64+LS64_V+LS64_ACCDATA"}}},
-            {"XS",      59, 56, {{0, "none"}, {1, "XS"}}},
-            {"I8MM",    55, 52, {{0, "none"}, {1, "I8MM"}}},
-            {"DGH",     51, 48, {{0, "none"}, {1, "BF16"}, {2, "EBF16"}}},
-            {"BF16",    47, 44, {{0, "none"}, {1, "AMUv1p1"}}},
-            {"SPECRES", 43, 40, {{0, "none"}, {1, "SHA256v1"}}},
-            {"SB",      39, 36, {{0, "none"}, {1, "SB"}}},
-            {"FRINTTS", 35, 32, {{0, "none"}, {1, "FRINTTS"}}},
-            {"GPI",     31, 28, {{0, "none"}, {1, "PACIMP"}}},
-            {"GPA",     27, 24, {{0, "none"}, {1, "PACQARMA5"}}},
-            {"LRCPC",   23, 20, {{0, "none"}, {1, "LRCPC"}, {2, "LRCPC2"}}},
-            {"FCMA",    19, 16, {{0, "none"}, {1, "FCMA"}}},
-            {"JSCVT",   15, 12, {{0, "none"}, {1, "JSCVT"}}},
-            {"API",     11,  8, {{0, "none"}, {1, "IMP PAuth"}, {2, "IMP PAuth+EPAC"}, {3, "IMP PAuth+EPAC+PAuth2"},
-                                 {4, "IMP PAuth+EPAC+PAuth2+FPAC"}, {5, "IMP PAuth+EPAC+PAuth2+FPAC+FPACCOMBINE"}}},
-            {"APA",      7,  4, {{0, "none"}, {1, "QARMA5 PAuth"}, {2, "QARMA5 PAuth+EPAC"}, {3, "QARMA5 PAuth+EPAC+PAuth2"},
-                                 {4, "QARMA5 PAuth+EPAC+PAuth2+FPAC"}, {5, "QARMA5 PAuth+EPAC+PAuth2+FPAC+FPACCOMBINE"}}},
-            {"DPB",      3,  0, {{0, "none"}, {1, "DPB"}, {2, "DPB2"}}},
-        }
-    },
-    {
-        "ID_AA64ISAR2_EL1", CSR_REGID_ID_AA64ISAR2_EL1, READ,
-        {
-            {"CSSC",         55, 52, {{0, "none"}, {1, "CSSC"}}},
-            {"RPRFM",        51, 48, {{0, "none"}, {1, "RPRFM"}}},
-            {"PRFMSLC",      43, 40, {{0, "none"}, {1, "PRFMSLC"}}},
-            {"SYSINSTR_128", 39, 36, {{0, "none"}, {1, "SYSINSTR_128"}}},
-            {"SYSREG_128",   35, 32, {{0, "none"}, {1, "SYSREG_128"}}},
-            {"CLRBHB",       31, 28, {{0, "none"}, {1, "CLRBHB"}}},
-            {"PAC_frac",     27, 24, {{0, "none"}, {1, "ConstPACField"}}},
-            {"BC",           23, 20, {{0, "none"}, {1, "HBC"}}},
-            {"MOPS",         19, 16, {{0, "none"}, {1, "MOPS"}}},
-            {"APA3",         15, 12, {{0, "none"}, {1, "QARMA3 PAuth"}, {2, "QARMA3 PAuth+EPAC"},
-                                      {3, "QARMA3 PAuth+EPAC+PAuth2"}, {4, "QARMA3 PAuth+EPAC+PAuth2+FPAC"},
-                                      {5, "QARMA3 PAuth+EPAC+PAuth2+FPAC+FPACCOMBINE"}}},
-            {"GPA3",         11,  8, {{0, "none"}, {1, "PACQARMA3"}}},
-            {"RPRES",         7,  4, {{0, "none"}, {1, "RPRES"}}},
-            {"WFxT",          3,  0, {{0, "none"}, {1, "WFxT"}}},
-        }
-    },
-    {
-        "ID_AA64MMFR0_EL1", CSR_REGID_ID_AA64MMFR0_EL1, READ,
-        {
-            {"ECV",       63, 60, {{0, "none"}}},
-            {"FGT",       59, 56, {{0, "none"}}},
-            {"ExS",       47, 44, {{0, "none"}}},
-            {"TGran4_2",  43, 40, {{0, "none"}}},
-            {"TGran64_2", 39, 36, {{0, "none"}}},
-            {"TGran16_2", 35, 32, {{0, "none"}}},
-            {"TGran4",    31, 28, {{0, "none"}}},
-            {"TGran64",   27, 24, {{0, "none"}}},
-            {"TGran16",   23, 20, {{0, "none"}}},
-            {"BigEndEL0", 19, 16, {{0, "none"}, {1, "mixed"}}},
-            {"SNSMem",    15, 12, {{0, "none"}, {1, "distinct"}}},
-            {"BigEnd",    11,  8, {{0, "none"}, {1, "mixed"}}},
-            {"ASIDBits",   7,  4, {{0, "8 bits"}, {1, "16 bits"}}},
-            {"PARange",    3,  0, {{0, "32 bits, 4GB"}, {1, "36 bits, 64GB"}, {2, "40 bits, 1TB"}, {3, "42 bits, 4TB"},
-                                   {4, "44 bits, 16TB"}, {5, "48 bits, 256TB"}, {6, "52 bits, 4PBB"}}},
-        }
-    },
-    {
-        "ID_AA64MMFR1_EL1", CSR_REGID_ID_AA64MMFR1_EL1, READ,
-        {
-            {"ECBHB",    63, 60, {{0, "none"}, {1, "ECBHB"}}},
-            {"CMOW",     59, 56, {{0, "none"}, {1, "CMOW"}}},
-            {"TIDCP1",   55, 52, {{0, "none"}, {1, "TIDCP1"}}},
-            {"nTLBPA",   51, 48, {}},
-            {"AFP",      47, 44, {{0, "none"}, {1, "AFP"}}},
-            {"HCX",      43, 40, {{0, "none"}, {1, "HCX"}}},
-            {"ETS",      39, 36, {{0, "none"}, {1, "ETS"}}},
-            {"TWED",     35, 32, {{0, "none"}, {1, "TWED"}}},
-            {"XNX",      31, 28, {{0, "none"}, {1, "XNX"}}},
-            {"SpecSEI",  27, 24, {}},
-            {"PAN",      23, 20, {{0, "none"}, {1, "PAN"}, {2, "PAN2"}, {3, "PAN3"}}},
-            {"LO",       19, 16, {{0, "none"}, {1, "LOR"}}},
-            {"HPDS",     15, 12, {{0, "none"}, {1, "HPDS"}, {2, "HPDS2"}}},
-            {"VH",       11,  8, {{0, "none"}, {1, "VHE"}}},
-            {"VMIDBits",  7,  4, {{0, "8 bits"}, {2, "16 bits"}}},
-            {"HAFDBS",    3,  0, {{0, "none"}}},
-        }
-    },
-    {
-        "ID_AA64MMFR2_EL1", CSR_REGID_ID_AA64MMFR2_EL1, READ,
-        {
-            {"E0PD",    63, 60, {{0, "none"}, {1, "E0PD"}}},
-            {"EVT",     59, 56, {{0, "none"}}},
-            {"BBM",     55, 52, {}},
-            {"TTL",     51, 48, {{0, "none"}, {1, "TTL"}}},
-            {"FWB",     43, 40, {{0, "none"}, {1, "S2FWB"}}},
-            {"IDS",     39, 36, {{0, "none"}, {1, "IDST"}}},
-            {"AT",      35, 32, {{0, "none"}, {1, "LSE2"}}},
-            {"ST",      31, 28, {}},
-            {"NV",      27, 24, {}},
-            {"CCIDX",   23, 20, {{0, "32-bit"}, {1, "64-bit"}}},
-            {"VARange", 19, 16, {{0, "48-bit VA"}, {1, "52-bit VA"}}},
-            {"IESB",    15, 12, {{0, "none"}, {1, "IESB"}}},
-            {"LSM",     11,  8, {{0, "none"}, {1, "LSMAOC"}}},
-            {"UAO",      7,  4, {{0, "none"}, {1, "UAO"}}},
-            {"CnP",      3,  0, {{0, "none"}, {1, "TTCNP"}}},
-        }
-    },
-    {
-        "ID_AA64MMFR3_EL1", CSR_REGID_ID_AA64MMFR3_EL1, READ,
-        {
-            {"Spec_FPACC", 63, 60, {}},
-            {"ADERR",      59, 56, {}},
-            {"SDERR",      55, 52, {}},
-            {"ANERR",      47, 44, {}},
-            {"SNERR",      43, 40, {}},
-            {"D128_2",     39, 36, {}},
-            {"D128",       35, 32, {}},
-            {"MEC",        31, 28, {}},
-            {"AIE",        27, 24, {}},
-            {"S2POE",      23, 20, {}},
-            {"S1POE",      19, 16, {}},
-            {"S2PIE",      15, 12, {}},
-            {"S1PIE",      11,  8, {}},
-            {"SCTLRX",      7,  4, {}},
-            {"TCRX",        3,  0, {}},
-        }
-    },
-    {
-        "ID_AA64MMFR4_EL1", CSR_REGID_ID_AA64MMFR4_EL1, READ,
-        {
-            {"EIESB",  7,  4, {}},
-        }
-    },
-    {
-        "ID_AA64PFR0_EL1", CSR_REGID_ID_AA64PFR0_EL1, READ,
-        {
-            {"CSV3",    63, 60, {{0, "undefined"}, {1, "safe"}}},
-            {"CSV2",    59, 56, {{0, "none"}, {1, "CSV2"}, {2, "CSV2_2"}, {3, "CSV2_3"}}},
-            {"RME",     55, 52, {{0, "none"}, {1, "RMEv1"}}},
-            {"DIT",     51, 48, {{0, "none"}, {1, "DIT"}}},
-            {"AMU",     47, 44, {{0, "none"}, {1, "AMUv1p1"}}},
-            {"MPAM",    43, 40, {{0, "v0"}, {1, "v1"}}},
-            {"SEL2",    39, 36, {{0, "none"}, {1, "Secure EL2"}}},
-            {"SVE",     35, 32, {{0, "none"}, {1, "SVE"}}},
-            {"RAS",     31, 28, {{0, "none"}, {1, "RAS"}, {2, "RASv1p1"}}},
-            {"GIC",     27, 24, {{0, "none"}, {1, "3.0+4.0"}, {3, "4.1"}}},
-            {"AdvSIMD", 23, 20, {{0, "basic"}, {1, "basic+FP16"}, {15, "none"}}},
-            {"FP",      19, 16, {{0, "FP"}, {1, "FP+FP16"}, {15, "none"}}},
-            {"EL3",     15, 12, {{0, "none"}, {1, "AArch64-only"}, {2, "AArch64+32"}}},
-            {"EL2",     11,  8, {{0, "none"}, {1, "AArch64-only"}, {2, "AArch64+32"}}},
-            {"EL1",      7,  4, {{1, "AArch64-only"}, {2, "AArch64+32"}}},
-            {"EL0",      3,  0, {{1, "AArch64-only"}, {2, "AArch64+32"}}},
-        }
-    },
-    {
-        "ID_AA64PFR1_EL1", CSR_REGID_ID_AA64PFR1_EL1, READ,
-        {
-            {"PFAR",      63, 60, {{0, "none"}, {1, "PFAR"}}},
-            {"DF2",       59, 56, {{0, "none"}, {1, "DoubleFault2"}}},
-            {"MTEX",      55, 52, {}},
-            {"THE",       51, 48, {{0, "none"}, {1, "THE"}}},
-            {"GCS",       47, 44, {{0, "none"}, {1, "GCS"}}},
-            {"MTE_frac",  43, 40, {}},
-            {"NMI",       39, 36, {{0, "none"}, {1, "NMI"}}},
-            {"CSV2_frac", 35, 32, {{0, "none"}, {1, "CSV2_1p1"}, {2, "CSV2_1p2"}}},
-            {"RNDR_trap", 31, 28, {{0, "none"}, {1, "RNG_TRAP"}}},
-            {"SME",       27, 24, {{0, "none"}, {1, "SME"}}},
-            {"MPAM_frac", 19, 16, {{0, "v.0"}, {1, "v.1"}}},
-            {"RAS_frac",  15, 12, {{0, "none"}, {1, "VARv1p1"}}},
-            {"MTE",       11,  8, {{0, "none"}, {1, "MTE"}, {2, "MTE2"}, {3, "MTE3"}}},
-            {"SSBS",       7,  4, {{0, "none"}, {1, "SSBS"}, {2, "SSBS2"}}},
-            {"BT",         3,  0, {{0, "none"}, {1, "BTI"}}},
-        }
-    },
-    {
-        "ID_AA64PFR2_EL1", CSR_REGID_ID_AA64PFR2_EL1, READ,
-        {
-            {"MTEFAR",       11,  8, {{0, "none"}, {1, "MTE4"}}},
-            {"MTESTOREONLY",  7,  4, {{0, "none"}, {1, "MTE_STORE_ONLY"}}},
-            {"MTEPERM",       3,  0, {{0, "none"}, {1, "MTE_PERM"}}},
-        }
-    },
-    {
-        "ID_AA64SMFR0_EL1", CSR_REGID_ID_AA64SMFR0_EL1, READ | NEED_SME,
-        {
-            {"FA64",    63, 63, {{0, "none"}, {1, "SME_FA64"}}},
-            {"SMEver",  59, 56, {}},
-            {"I16I64",  55, 52, {{0, "none"}, {15, "SME_I16I64"}}},
-            {"F64F64",  48, 48, {{0, "none"}, {1, "SME_F16F64"}}},
-            {"I16I32",  47, 44, {}},
-            {"B16B16",  43, 43, {}},
-            {"F16F16",  42, 42, {}},
-            {"I8I32",   39, 36, {}},
-            {"F16F32",  35, 35, {}},
-            {"B16F32",  34, 34, {}},
-            {"BI32I32", 33, 33, {}},
-            {"F32F32",  32, 32, {}},
-        }
-    },
-    {
-        "ID_AA64ZFR0_EL1", CSR_REGID_ID_AA64ZFR0_EL1, READ | NEED_SVE,
-        {
-            {"F64MM",   59, 56, {{0, "none"}, {1, "F64MM"}}},
-            {"F32MM",   55, 52, {{0, "none"}, {1, "F32MM"}}},
-            {"I8MM",    47, 44, {{0, "none"}, {1, "I8MM"}}},
-            {"SM4",     43, 40, {{0, "none"}, {1, "SVE_SM4"}}},
-            {"SHA3",    35, 32, {{0, "none"}, {1, "SVE_SHA3"}}},
-            {"BF16",    23, 20, {{0, "none"}, {1, "BF16"}, {2, "EBF16"}}},
-            {"BitPerm", 19, 16, {{0, "none"}, {1, "SVE_BitPerm"}}},
-            {"AES",      7,  4, {{0, "none"}, {1, "SVE_AES"}, {2, "SVE_AES+SVE_AES"}}},
-            {"SVEver",   3,  0, {{0, "none"}, {1, "SVE2"}}},
-        }
-    },
-    {
-        "ID_ISAR0_EL1", CSR_REGID_ID_ISAR0_EL1, READ,
-        {
-            {"Divide",    27, 24, {}},
-            {"Debug",     23, 20, {}},
-            {"Coproc",    19, 16, {}},
-            {"CmpBranch", 15, 12, {}},
-            {"BitField",  11,  8, {}},
-            {"BitCount",   7,  4, {}},
-            {"Swap",       3,  0, {}},
-        }
-    },
-    {
-        "ID_ISAR1_EL1", CSR_REGID_ID_ISAR1_EL1, READ,
-        {
-            {"Jazelle",   31, 28, {}},
-            {"Interwork", 27, 24, {}},
-            {"Immediate", 23, 20, {}},
-            {"IfThen",    19, 16, {}},
-            {"Extend",    15, 12, {}},
-            {"Except_AR", 11,  8, {}},
-            {"Except",     7,  4, {}},
-            {"Endian",     3,  0, {}},
-        }
-    },
-    {
-        "ID_ISAR2_EL1", CSR_REGID_ID_ISAR2_EL1, READ,
-        {
-            {"Reversal",       31, 28, {}},
-            {"PSR_AR",         27, 24, {}},
-            {"MultU",          23, 20, {}},
-            {"MultS",          19, 16, {}},
-            {"Mult",           15, 12, {}},
-            {"MultiAccessInt", 11,  8, {}},
-            {"MemHint",         7,  4, {}},
-            {"LoadStore",       3,  0, {}},
-        }
-    },
-    {
-        "ID_ISAR3_EL1", CSR_REGID_ID_ISAR3_EL1, READ,
-        {
-            {"T32EE",     31, 28, {}},
-            {"TrueNOP",   27, 24, {}},
-            {"T32Copy",   23, 20, {}},
-            {"TabBranch", 19, 16, {}},
-            {"SynchPrim", 15, 12, {}},
-            {"SVC",       11,  8, {}},
-            {"SIMD",       7,  4, {}},
-            {"Saturate",   3,  0, {}},
-        }
-    },
-    {
-        "ID_ISAR4_EL1", CSR_REGID_ID_ISAR4_EL1, READ,
-        {
-            {"SWP_frac",       31, 28, {}},
-            {"PSR_M",          27, 24, {}},
-            {"SynchPrim_frac", 23, 20, {}},
-            {"Barrier",        19, 16, {}},
-            {"SMC",            15, 12, {}},
-            {"Writeback",      11,  8, {}},
-            {"WithShifts",      7,  4, {}},
-            {"Unpriv",          3,  0, {}},
-        }
-    },
-    {
-        "ID_ISAR5_EL1", CSR_REGID_ID_ISAR5_EL1, READ,
-        {
-            {"VCMA",  31, 28, {}},
-            {"RDM",   27, 24, {}},
-            {"CRC32", 19, 16, {}},
-            {"SHA2",  15, 12, {}},
-            {"SHA1",  11,  8, {}},
-            {"AES",    7,  4, {}},
-            {"SEVL",   3,  0, {}},
-        }
-    },
-    {
-        "ID_ISAR6_EL1", CSR_REGID_ID_ISAR6_EL1, READ,
-        {
-            {"I8MM",    27, 24, {}},
-            {"BF16",    23, 20, {}},
-            {"SPECRES", 19, 16, {}},
-            {"SB",      15, 12, {}},
-            {"FHM",     11,  8, {}},
-            {"DP",       7,  4, {}},
-            {"JSCVT",    3,  0, {}},
-        }
-    },
-    {
-        "ID_MMFR0_EL1", CSR_REGID_ID_MMFR0_EL1, READ,
-        {
-            {"InnerShr", 31, 28, {}},
-            {"FCSE",     27, 24, {}},
-            {"AuxReg",   23, 20, {}},
-            {"TCM",      19, 16, {}},
-            {"ShareLvl", 15, 12, {}},
-            {"OuterShr", 11,  8, {}},
-            {"PMSA",      7,  4, {}},
-            {"VMSA",      3,  0, {}},
-        }
-    },
-    {
-        "ID_MMFR1_EL1", CSR_REGID_ID_MMFR1_EL1, READ,
-        {
-            {"BPred",    31, 28, {}},
-            {"L1TstCln", 27, 24, {}},
-            {"L1Uni",    23, 20, {}},
-            {"L1Hvd",    19, 16, {}},
-            {"L1UniSW",  15, 12, {}},
-            {"L1HvdSW",  11,  8, {}},
-            {"L1UniVA",   7,  4, {}},
-            {"L1HvdVA",   3,  0, {}},
-        }
-    },
-    {
-        "ID_MMFR2_EL1", CSR_REGID_ID_MMFR2_EL1, READ,
-        {
-            {"HWAccFlg", 31, 28, {}},
-            {"WFIStall", 27, 24, {}},
-            {"MemBarr",  23, 20, {}},
-            {"UniTLB",   19, 16, {}},
-            {"HvdTLB",   15, 12, {}},
-            {"L1HvdRng", 11,  8, {}},
-            {"L1HvdBG",   7,  4, {}},
-            {"L1HvdFG",   3,  0, {}},
-        }
-    },
-    {
-        "ID_MMFR3_EL1", CSR_REGID_ID_MMFR3_EL1, READ,
-        {
-            {"Supersec",  31, 28, {}},
-            {"CMemSz",    27, 24, {}},
-            {"CohWalk",   23, 20, {}},
-            {"PAN",       19, 16, {}},
-            {"MaintBcst", 15, 12, {}},
-            {"BPMaint",   11,  8, {}},
-            {"CMaintSW",   7,  4, {}},
-            {"CMaintVA",   3,  0, {}},
-        }
-    },
-    {
-        "ID_MMFR4_EL1", CSR_REGID_ID_MMFR4_EL1, READ,
-        {
-            {"EVT",    31, 28, {}},
-            {"CCIDX",  27, 24, {}},
-            {"LSM",    23, 20, {}},
-            {"HPDS",   19, 16, {}},
-            {"CnP",    15, 12, {}},
-            {"XNX",    11,  8, {}},
-            {"AC2",     7,  4, {}},
-            {"SpecSEI", 3,  0, {}},
-        }
-    },
-    {
-        "ID_MMFR5_EL1", CSR_REGID_ID_MMFR5_EL1, READ,
-        {
-            {"nTLBPA",  7,  4, {}},
-            {"ETS",  3,  0, {}},
-        }
-    },
-    {
-        "ID_PFR0_EL1", CSR_REGID_ID_PFR0_EL1, READ,
-        {
-            {"RAS",    31, 28, {}},
-            {"DIT",    27, 24, {}},
-            {"AMU",    23, 20, {}},
-            {"CSV2",   19, 16, {}},
-            {"State3", 15, 12, {}},
-            {"State2", 11,  8, {}},
-            {"State1",  7,  4, {}},
-            {"State0",  3,  0, {}},
-        }
-    },
-    {
-        "ID_PFR1_EL1", CSR_REGID_ID_PFR1_EL1, READ,
-        {
-            {"GIC",            31, 28, {}},
-            {"Virt_frac",      27, 24, {}},
-            {"Sec_frac",       23, 20, {}},
-            {"GenTimer",       19, 16, {}},
-            {"Virtualization", 15, 12, {}},
-            {"MProgMod",       11,  8, {}},
-            {"Security",        7,  4, {}},
-            {"ProgMod",         3,  0, {}},
-        }
-    },
-    {
-        "ID_PFR2_EL1", CSR_REGID_ID_PFR2_EL1, READ,
-        {
-            {"RAS_frac", 11,  8, {}},
-            {"SSBS",      7,  4, {}},
-            {"CSV3",      3,  0, {}},
-        }
-    },
-    {
-        "MAIR_EL1", CSR_REGID_MAIR_EL1, READ,
-        {
-            {"Attr7", 63, 56, {}},
-            {"Attr6", 55, 48, {}},
-            {"Attr5", 47, 40, {}},
-            {"Attr4", 39, 32, {}},
-            {"Attr3", 31, 24, {}},
-            {"Attr2", 23, 16, {}},
-            {"Attr1", 15,  8, {}},
-            {"Attr0",  7,  0, {}},
-        }
-    },
-    {
-        "MAIR2_EL1", CSR_REGID_MAIR2_EL1, READ | NEED_AIE,
-        {
-            {"Attr7", 63, 56, {}},
-            {"Attr6", 55, 48, {}},
-            {"Attr5", 47, 40, {}},
-            {"Attr4", 39, 32, {}},
-            {"Attr3", 31, 24, {}},
-            {"Attr2", 23, 16, {}},
-            {"Attr1", 15,  8, {}},
-            {"Attr0",  7,  0, {}},
-        }
-    },
-    {
-        "MIDR_EL1", CSR_REGID_MIDR_EL1, READ,
-        {
-            {"Implementer",  31, 24, {{0x41, "Arm"}, {0x61, "Apple"}, {0xC0, "Ampere"}}},
-            {"Variant",      23, 20, {}},
-            {"Architecture", 19, 16, {{1, "v4"}, {2, "v4T"}, {3, "v5"}, {4, "v5T"}, {5, "v5TE"},
-                                      {6, "v5TEJ"}, {7, "v6"}, {15, "By features"}}},
-            {"PartNum",      15,  4, {}},
-            {"Revision",      3,  0, {}},
-        }
-    },
-    {
-        "MPIDR_EL1", CSR_REGID_MPIDR_EL1, READ,
-        {
-            {"Aff3", 39, 32, {}},
-            {"U",    30, 30, {{0, "Multiprocessor"}, {1, "Uniprocessor"}}},
-            {"MT",   24, 24, {{0, "Independent perf."}, {1, "Interdependent perf."}}},
-            {"Aff2", 23, 16, {}},
-            {"Aff1", 15,  8, {}},
-            {"Aff0",  7,  0, {}},
-        }
-    },
-    {
-        "PIR_EL1", CSR_REGID_PIR_EL1, READ | NEED_S1PIE,
-        {
-            {"Perm15", 63, 60, {}},
-            {"Perm14", 59, 56, {}},
-            {"Perm13", 55, 52, {}},
-            {"Perm12", 51, 48, {}},
-            {"Perm11", 47, 44, {}},
-            {"Perm10", 43, 40, {}},
-            {"Perm9",  39, 36, {}},
-            {"Perm8",  35, 32, {}},
-            {"Perm7",  31, 28, {}},
-            {"Perm6",  27, 24, {}},
-            {"Perm5",  23, 20, {}},
-            {"Perm4",  19, 16, {}},
-            {"Perm3",  15, 12, {}},
-            {"Perm2",  11,  8, {}},
-            {"Perm1",   7,  4, {}},
-            {"Perm0",   3,  0, {}},
-        }
-    },
-    {
-        "PIRE0_EL1", CSR_REGID_PIRE0_EL1, READ | NEED_S1PIE,
-        {
-            {"Perm15", 63, 60, {}},
-            {"Perm14", 59, 56, {}},
-            {"Perm13", 55, 52, {}},
-            {"Perm12", 51, 48, {}},
-            {"Perm11", 47, 44, {}},
-            {"Perm10", 43, 40, {}},
-            {"Perm9",  39, 36, {}},
-            {"Perm8",  35, 32, {}},
-            {"Perm7",  31, 28, {}},
-            {"Perm6",  27, 24, {}},
-            {"Perm5",  23, 20, {}},
-            {"Perm4",  19, 16, {}},
-            {"Perm3",  15, 12, {}},
-            {"Perm2",  11,  8, {}},
-            {"Perm1",   7,  4, {}},
-            {"Perm0",   3,  0, {}},
-        }
-    },
-    {
-        "PMCCFILTR_EL0", CSR_REGID_PMCCFILTR_EL0, READ | NEED_PMUv3,
-        {
-            {"P",   31, 31, {}},
-            {"U",   30, 30, {}},
-            {"NSK", 29, 29, {}},
-            {"NSU", 28, 28, {}},
-            {"NSH", 27, 27, {}},
-            {"M",   26, 26, {}},
-            {"SH",  24, 24, {}},
-            {"T",   23, 23, {}},
-            {"RLK", 22, 22, {}},
-            {"RLU", 21, 21, {}},
-            {"RLH", 20, 20, {}},
-        }
-    },
-    {
-        "PMCCNTR_EL0", CSR_REGID_PMCCNTR_EL0, READ | NEED_PMUv3, {}
-    },
+namespace {
+
+    // The descriptions are written as one flat list of entries. Each register
+    // is followed by its bitfields, and each bitfield by its known values.
+    enum EntryType {REG, FIELD, VALUE};
+
+    struct Entry {
+        EntryType        type;
+        std::string_view name;
+        csr_u64_t        value;
+        int              arg1;  // csr_index or msb
+        int              arg2;  // features or lsb
+    };
+
+    constexpr Entry Reg(std::string_view name, int csr_index, int features) { return Entry{REG, name, 0, csr_index, features}; }
+    constexpr Entry Field(std::string_view name, int msb, int lsb) { return Entry{FIELD, name, 0, msb, lsb}; }
+    constexpr Entry Value(csr_u64_t value, std::string_view name) { return Entry{VALUE, name, value, 0, 0}; }
+
+    // Deriving from RegView gives direct access to READ, WRITE, NEED_xxx.
+    struct RegTable : public RegView
+    {
+        static constexpr Entry Entries[] = {
+            /* --------
+             * Template for copy/paste on new registers:
+            Reg("", CSR_REGID_, READ),
+                Field("", 63, 60), Value(0, "none"), Value(1, ""),
+                Field("", 59, 56), Value(0, "none"), Value(1, ""),
+                Field("", 55, 52), Value(0, "none"), Value(1, ""),
+                Field("", 51, 48), Value(0, "none"), Value(1, ""),
+                Field("", 47, 44), Value(0, "none"), Value(1, ""),
+                Field("", 43, 40), Value(0, "none"), Value(1, ""),
+                Field("", 39, 36), Value(0, "none"), Value(1, ""),
+                Field("", 35, 32), Value(0, "none"), Value(1, ""),
+                Field("", 31, 28), Value(0, "none"), Value(1, ""),
+                Field("", 27, 24), Value(0, "none"), Value(1, ""),
+                Field("", 23, 20), Value(0, "none"), Value(1, ""),
+                Field("", 19, 16), Value(0, "none"), Value(1, ""),
+                Field("", 15, 12), Value(0, "none"), Value(1, ""),
+                Field("", 11,  8), Value(0, "none"), Value(1, ""),
+                Field("",  7,  4), Value(0, "none"), Value(1, ""),
+                Field("",  3,  0), Value(0, "none"), Value(1, ""),
+            -------- */
+        Reg("APDAKEY_EL1", CSR_REGID2_APDAKEY_EL1, READ_PAC | WRITE_PAC | NEED_PAC),
+        Reg("APDBKEY_EL1", CSR_REGID2_APDBKEY_EL1, READ_PAC | WRITE_PAC | NEED_PAC),
+        Reg("APGAKEY_EL1", CSR_REGID2_APGAKEY_EL1, READ_PAC | WRITE_PAC | NEED_PACGA),
+        Reg("APIAKEY_EL1", CSR_REGID2_APIAKEY_EL1, READ_PAC | WRITE_PAC | NEED_PAC),
+        Reg("APIBKEY_EL1", CSR_REGID2_APIBKEY_EL1, READ_PAC | WRITE_PAC | NEED_PAC),
+        Reg("CLIDR_EL1", CSR_REGID_CLIDR_EL1, READ),
+            Field("ICB",    32, 30),
+            Field("LoUU",   29, 27),
+            Field("LoC",    26, 24),
+            Field("LoUIS",  23, 21),
+            Field("Ctype7", 20, 18), Value(0, "none"), Value(1, "instruction"), Value(2, "data"), Value(3, "separate"), Value(4, "unified"),
+            Field("Ctype6", 17, 15), Value(0, "none"), Value(1, "instruction"), Value(2, "data"), Value(3, "separate"), Value(4, "unified"),
+            Field("Ctype5", 14, 12), Value(0, "none"), Value(1, "instruction"), Value(2, "data"), Value(3, "separate"), Value(4, "unified"),
+            Field("Ctype4", 11,  9), Value(0, "none"), Value(1, "instruction"), Value(2, "data"), Value(3, "separate"), Value(4, "unified"),
+            Field("Ctype3",  8,  6), Value(0, "none"), Value(1, "instruction"), Value(2, "data"), Value(3, "separate"), Value(4, "unified"),
+            Field("Ctype2",  5,  3), Value(0, "none"), Value(1, "instruction"), Value(2, "data"), Value(3, "separate"), Value(4, "unified"),
+            Field("Ctype1",  2,  0), Value(0, "none"), Value(1, "instruction"), Value(2, "data"), Value(3, "separate"), Value(4, "unified"),
+        Reg("CNTFRQ_EL0", CSR_REGID_CNTFRQ_EL0, READ),
+            Field("Clock frequency", 31, 0),
+        Reg("CNTKCTL_EL1", CSR_REGID_CNTKCTL_EL1, READ | WRITE),
+            Field("EVNTIS",   17, 17),
+            Field("EL0PTEN",   9,  9),
+            Field("EL0VTEN",   8,  8),
+            Field("EVNTI",     7,  4),
+            Field("EVNTDIR",   3,  3),
+            Field("EVNTEN",    2,  2),
+            Field("EL0VCTEN",  1,  1),
+            Field("EL0PCTEN",  0,  0),
+        Reg("CNTPCT_EL0", CSR_REGID_CNTPCT_EL0, READ),
+        Reg("CNTPS_CTL_EL1", CSR_REGID_CNTPS_CTL_EL1, READ_CNTPS_CTL_EL1 | WRITE_CNTPS_CTL_EL1),
+            Field("ISTATUS", 2, 2),
+            Field("IMASK",   1, 1),
+            Field("ENABLE",  0, 0),
+        Reg("CNTVCT_EL0", CSR_REGID_CNTVCT_EL0, READ),
+        Reg("CSSELR_EL1", CSR_REGID_CSSELR_EL1, READ),
+            Field("TnD",   4, 4), Value(0, "data or unified"), Value(1, "separate allocation tag"),
+            Field("Level", 3, 1),
+            Field("InD",   0, 0), Value(0, "data or unified"), Value(1, "instruction"),
+        Reg("CTR_EL0", CSR_REGID_CTR_EL0, READ_CTR_EL0),
+            Field("TminLine", 37, 32),
+            Field("DIC",      29, 29),
+            Field("IDC",      28, 28),
+            Field("CWG",      27, 24),
+            Field("ERG",      23, 20),
+            Field("DminLine", 19, 16),
+            Field("L1Ip",     15, 14), Value(0, "VPIPT"), Value(1, "AIVIVT"), Value(2, "VIPT"), Value(3, "PIPT"),
+            Field("IminLine",  3,  0),
+        Reg("HCR_EL2", CSR_REGID_HCR_EL2, 0),
+            Field("TWEDEL",   63, 60),
+            Field("TWEDEn",   59, 59),
+            Field("TID5",     58, 58), Value(0, "none"), Value(1, "trap"),
+            Field("DCT",      57, 57), Value(0, "untagged"), Value(1, "tagged"),
+            Field("ATA",      56, 56), Value(0, "forbidden"), Value(1, "allowed"),
+            Field("TTLBOS",   55, 55), Value(0, "none"), Value(1, "trap"),
+            Field("TTLBIS",   54, 54), Value(0, "none"), Value(1, "trap"),
+            Field("EnSCXT",   53, 53), Value(0, "none"), Value(1, "trap"),
+            Field("TOCU",     52, 52), Value(0, "none"), Value(1, "trap"),
+            Field("AMVOFFEN", 51, 51), Value(0, "disabled"), Value(1, "enabled"),
+            Field("TICAB",    50, 50), Value(0, "none"), Value(1, "trap"),
+            Field("TID4",     49, 49), Value(0, "none"), Value(1, "trap"),
+            Field("GPF",      48, 48), Value(0, "none"), Value(1, "trap"),
+            Field("FIEN",     47, 47), Value(0, "trap"), Value(1, "none"),
+            Field("FWB",      46, 46),
+            Field("NV2",      45, 45),
+            Field("AT",       44, 44), Value(0, "none"), Value(1, "trap"),
+            Field("NV1",      43, 43),
+            Field("NV",       42, 42),
+            Field("API",      41, 41), Value(0, "trap"), Value(1, "none"),
+            Field("APK",      40, 40), Value(0, "trap"), Value(1, "none"),
+            Field("TME",      39, 39), Value(0, "undefined"), Value(1, "normal"),
+            Field("MIOCNCE",  38, 38),
+            Field("TEA",      37, 37),
+            Field("TERR",     36, 36), Value(0, "none"), Value(1, "trap"),
+            Field("TLOR",     35, 35), Value(0, "none"), Value(1, "trap"),
+            Field("E2H",      34, 34), Value(0, "disabled"), Value(1, "enabled"),
+            Field("ID",       33, 33),
+            Field("CD",       32, 32),
+            Field("RW",       31, 31),
+            Field("TRVM",     30, 30), Value(0, "none"), Value(1, "trap"),
+            Field("HCD",      29, 29), Value(0, "none"), Value(1, "undefined"),
+            Field("TDZ",      28, 28),
+            Field("TGE",      27, 27),
+            Field("TVM",      26, 26), Value(0, "none"), Value(1, "trap"),
+            Field("TTLB",     25, 25), Value(0, "none"), Value(1, "trap"),
+            Field("TPU",      24, 24), Value(0, "none"), Value(1, "trap"),
+            Field("TPCP",     23, 23), Value(0, "none"), Value(1, "trap"),
+            Field("TSW",      22, 22),
+            Field("TACR",     21, 21), Value(0, "none"), Value(1, "trap"),
+            Field("TIDCP",    20, 20), Value(0, "none"), Value(1, "trap"),
+            Field("TSC",      19, 19), Value(0, "none"), Value(1, "trap"),
+            Field("TID3",     18, 18), Value(0, "none"), Value(1, "trap"),
+            Field("TID2",     17, 17), Value(0, "none"), Value(1, "trap"),
+            Field("TID1",     16, 16), Value(0, "none"), Value(1, "trap"),
+            Field("TID0",     15, 15), Value(0, "none"), Value(1, "trap"),
+            Field("TWE",      14, 14), Value(0, "none"), Value(1, "trap"),
+            Field("TWI",      13, 13), Value(0, "none"), Value(1, "trap"),
+            Field("DC",       12, 12),
+            Field("BSU",      11, 10), Value(0, "none"), Value(1, "inner shareable"), Value(2, "outer shareable"), Value(3, "full system"),
+            Field("FB",        9,  9),
+            Field("VSE",       8,  8),
+            Field("VI",        7,  7), Value(0, "none"), Value(1, "IRQ pending"),
+            Field("VF",        6,  6), Value(0, "none"), Value(1, "IRQ pending"),
+            Field("AMO",       5,  5),
+            Field("IMO",       4,  4),
+            Field("FMO",       3,  3),
+            Field("PTW",       2,  2),
+            Field("SWIO",      1,  1),
+            Field("VM",        0,  0), Value(0, "disabled"), Value(1, "enabled"),
+        Reg("ID_AA64AFR0_EL1", CSR_REGID_ID_AA64AFR0_EL1, READ),
+        Reg("ID_AA64AFR1_EL1", CSR_REGID_ID_AA64AFR1_EL1, READ),
+        Reg("ID_AA64DFR0_EL1", CSR_REGID_ID_AA64DFR0_EL1, READ),
+            Field("HPMN0",       63, 60), Value(0, "none"), Value(1, "HPMN0"),
+            Field("ExtTrcBuff",  59, 56),
+            Field("BRBE",        55, 52), Value(0, "none"), Value(1, "BRBE"), Value(2, "BRBEv1p1"),
+            Field("MTPMU",       51, 48),
+            Field("TraceBuffer", 47, 44), Value(0, "none"), Value(1, "TRBE"),
+            Field("TraceFilt",   43, 40), Value(0, "none"), Value(1, "TRBF"),
+            Field("DoubleLock",  39, 36), Value(0, "DoubleLock"), Value(15, "none"),
+            Field("PMSVer",      35, 32),
+            Field("CTX_CMPs",    31, 28),
+            Field("SEBEP",       27, 24),
+            Field("WRPs",        23, 20),
+            Field("PMSS",        19, 16),
+            Field("BRPs",        15, 12),
+            Field("PMUVer",      11,  8),
+            Field("TraceVer",     7,  4),
+            Field("DebugVer",     3,  0),
+        Reg("ID_AA64DFR1_EL1", CSR_REGID_ID_AA64DFR1_EL1, READ),
+            Field("ABL_CMPs", 63, 56),
+            Field("EBEP",     51, 48),
+            Field("ITE",      47, 44),
+            Field("ABLE",     43, 40),
+            Field("PMICNTR",  39, 36),
+            Field("SPMU",     35, 32),
+            Field("CTX_CMPs", 31, 24),
+            Field("WRPs",     23, 16),
+            Field("BRPs",     15,  8),
+            Field("SYSPMUID",  7,  0),
+        Reg("ID_AA64ISAR0_EL1", CSR_REGID_ID_AA64ISAR0_EL1, READ),
+            Field("RNDR",   63, 60), Value(0, "none"), Value(1, "RNG"),
+            Field("TLB",    59, 56), Value(0, "none"), Value(1, "TLBIOS"), Value(2, "TLBIOS+TLBIRANGE"),
+            Field("TS",     55, 52), Value(0, "none"), Value(1, "FlagM"), Value(2, "FlagM2"),
+            Field("FHM",    51, 48), Value(0, "none"), Value(1, "FHM"),
+            Field("DP",     47, 44), Value(0, "none"), Value(1, "DotProd"),
+            Field("SM4",    43, 40), Value(0, "none"), Value(1, "SM4"),
+            Field("SM3",    39, 36), Value(0, "none"), Value(1, "SM3"),
+            Field("SHA3",   35, 32), Value(0, "none"), Value(1, "SHA3"),
+            Field("RDM",    31, 28), Value(0, "none"), Value(1, "RDM"),
+            Field("TME",    27, 24), Value(0, "none"), Value(1, "TME"),
+            Field("Atomic", 23, 20), Value(0, "none"), Value(2, "LSE"),
+            Field("CRC32",  19, 16), Value(0, "none"), Value(1, "CRC32"),
+            Field("SHA2",   15, 12), Value(0, "none"), Value(1, "SHA256"), Value(2, "SHA256+SHA512"),
+            Field("SHA1",   11,  8), Value(0, "none"), Value(1, "SHA1"),
+            Field("AES",     7,  4), Value(0, "none"), Value(1, "AES"), Value(2, "AES+PMULL"),
+        Reg("ID_AA64ISAR1_EL1", CSR_REGID_ID_AA64ISAR1_EL1, READ),
+            Field("LS64",    63, 60), Value(0, "none"), Value(1, "LS64"), Value(2, "LS64+LS64_V"), Value(3, "LS64+LS64_V+LS64_ACCDATA"),
+            Field("XS",      59, 56), Value(0, "none"), Value(1, "XS"),
+            Field("I8MM",    55, 52), Value(0, "none"), Value(1, "I8MM"),
+            Field("DGH",     51, 48), Value(0, "none"), Value(1, "BF16"), Value(2, "EBF16"),
+            Field("BF16",    47, 44), Value(0, "none"), Value(1, "AMUv1p1"),
+            Field("SPECRES", 43, 40), Value(0, "none"), Value(1, "SHA256v1"),
+            Field("SB",      39, 36), Value(0, "none"), Value(1, "SB"),
+            Field("FRINTTS", 35, 32), Value(0, "none"), Value(1, "FRINTTS"),
+            Field("GPI",     31, 28), Value(0, "none"), Value(1, "PACIMP"),
+            Field("GPA",     27, 24), Value(0, "none"), Value(1, "PACQARMA5"),
+            Field("LRCPC",   23, 20), Value(0, "none"), Value(1, "LRCPC"), Value(2, "LRCPC2"),
+            Field("FCMA",    19, 16), Value(0, "none"), Value(1, "FCMA"),
+            Field("JSCVT",   15, 12), Value(0, "none"), Value(1, "JSCVT"),
+            Field("API",     11,  8), Value(0, "none"), Value(1, "IMP PAuth"), Value(2, "IMP PAuth+EPAC"), Value(3, "IMP PAuth+EPAC+PAuth2"), Value(4, "IMP PAuth+EPAC+PAuth2+FPAC"), Value(5, "IMP PAuth+EPAC+PAuth2+FPAC+FPACCOMBINE"),
+            Field("APA",      7,  4), Value(0, "none"), Value(1, "QARMA5 PAuth"), Value(2, "QARMA5 PAuth+EPAC"), Value(3, "QARMA5 PAuth+EPAC+PAuth2"), Value(4, "QARMA5 PAuth+EPAC+PAuth2+FPAC"), Value(5, "QARMA5 PAuth+EPAC+PAuth2+FPAC+FPACCOMBINE"),
+            Field("DPB",      3,  0), Value(0, "none"), Value(1, "DPB"), Value(2, "DPB2"),
+        Reg("ID_AA64ISAR2_EL1", CSR_REGID_ID_AA64ISAR2_EL1, READ),
+            Field("CSSC",         55, 52), Value(0, "none"), Value(1, "CSSC"),
+            Field("RPRFM",        51, 48), Value(0, "none"), Value(1, "RPRFM"),
+            Field("PRFMSLC",      43, 40), Value(0, "none"), Value(1, "PRFMSLC"),
+            Field("SYSINSTR_128", 39, 36), Value(0, "none"), Value(1, "SYSINSTR_128"),
+            Field("SYSREG_128",   35, 32), Value(0, "none"), Value(1, "SYSREG_128"),
+            Field("CLRBHB",       31, 28), Value(0, "none"), Value(1, "CLRBHB"),
+            Field("PAC_frac",     27, 24), Value(0, "none"), Value(1, "ConstPACField"),
+            Field("BC",           23, 20), Value(0, "none"), Value(1, "HBC"),
+            Field("MOPS",         19, 16), Value(0, "none"), Value(1, "MOPS"),
+            Field("APA3",         15, 12), Value(0, "none"), Value(1, "QARMA3 PAuth"), Value(2, "QARMA3 PAuth+EPAC"), Value(3, "QARMA3 PAuth+EPAC+PAuth2"), Value(4, "QARMA3 PAuth+EPAC+PAuth2+FPAC"), Value(5, "QARMA3 PAuth+EPAC+PAuth2+FPAC+FPACCOMBINE"),
+            Field("GPA3",         11,  8), Value(0, "none"), Value(1, "PACQARMA3"),
+            Field("RPRES",         7,  4), Value(0, "none"), Value(1, "RPRES"),
+            Field("WFxT",          3,  0), Value(0, "none"), Value(1, "WFxT"),
+        Reg("ID_AA64MMFR0_EL1", CSR_REGID_ID_AA64MMFR0_EL1, READ),
+            Field("ECV",       63, 60), Value(0, "none"),
+            Field("FGT",       59, 56), Value(0, "none"),
+            Field("ExS",       47, 44), Value(0, "none"),
+            Field("TGran4_2",  43, 40), Value(0, "none"),
+            Field("TGran64_2", 39, 36), Value(0, "none"),
+            Field("TGran16_2", 35, 32), Value(0, "none"),
+            Field("TGran4",    31, 28), Value(0, "none"),
+            Field("TGran64",   27, 24), Value(0, "none"),
+            Field("TGran16",   23, 20), Value(0, "none"),
+            Field("BigEndEL0", 19, 16), Value(0, "none"), Value(1, "mixed"),
+            Field("SNSMem",    15, 12), Value(0, "none"), Value(1, "distinct"),
+            Field("BigEnd",    11,  8), Value(0, "none"), Value(1, "mixed"),
+            Field("ASIDBits",   7,  4), Value(0, "8 bits"), Value(1, "16 bits"),
+            Field("PARange",    3,  0), Value(0, "32 bits, 4GB"), Value(1, "36 bits, 64GB"), Value(2, "40 bits, 1TB"), Value(3, "42 bits, 4TB"), Value(4, "44 bits, 16TB"), Value(5, "48 bits, 256TB"), Value(6, "52 bits, 4PBB"),
+        Reg("ID_AA64MMFR1_EL1", CSR_REGID_ID_AA64MMFR1_EL1, READ),
+            Field("ECBHB",    63, 60), Value(0, "none"), Value(1, "ECBHB"),
+            Field("CMOW",     59, 56), Value(0, "none"), Value(1, "CMOW"),
+            Field("TIDCP1",   55, 52), Value(0, "none"), Value(1, "TIDCP1"),
+            Field("nTLBPA",   51, 48),
+            Field("AFP",      47, 44), Value(0, "none"), Value(1, "AFP"),
+            Field("HCX",      43, 40), Value(0, "none"), Value(1, "HCX"),
+            Field("ETS",      39, 36), Value(0, "none"), Value(1, "ETS"),
+            Field("TWED",     35, 32), Value(0, "none"), Value(1, "TWED"),
+            Field("XNX",      31, 28), Value(0, "none"), Value(1, "XNX"),
+            Field("SpecSEI",  27, 24),
+            Field("PAN",      23, 20), Value(0, "none"), Value(1, "PAN"), Value(2, "PAN2"), Value(3, "PAN3"),
+            Field("LO",       19, 16), Value(0, "none"), Value(1, "LOR"),
+            Field("HPDS",     15, 12), Value(0, "none"), Value(1, "HPDS"), Value(2, "HPDS2"),
+            Field("VH",       11,  8), Value(0, "none"), Value(1, "VHE"),
+            Field("VMIDBits",  7,  4), Value(0, "8 bits"), Value(2, "16 bits"),
+            Field("HAFDBS",    3,  0), Value(0, "none"),
+        Reg("ID_AA64MMFR2_EL1", CSR_REGID_ID_AA64MMFR2_EL1, READ),
+            Field("E0PD",    63, 60), Value(0, "none"), Value(1, "E0PD"),
+            Field("EVT",     59, 56), Value(0, "none"),
+            Field("BBM",     55, 52),
+            Field("TTL",     51, 48), Value(0, "none"), Value(1, "TTL"),
+            Field("FWB",     43, 40), Value(0, "none"), Value(1, "S2FWB"),
+            Field("IDS",     39, 36), Value(0, "none"), Value(1, "IDST"),
+            Field("AT",      35, 32), Value(0, "none"), Value(1, "LSE2"),
+            Field("ST",      31, 28),
+            Field("NV",      27, 24),
+            Field("CCIDX",   23, 20), Value(0, "32-bit"), Value(1, "64-bit"),
+            Field("VARange", 19, 16), Value(0, "48-bit VA"), Value(1, "52-bit VA"),
+            Field("IESB",    15, 12), Value(0, "none"), Value(1, "IESB"),
+            Field("LSM",     11,  8), Value(0, "none"), Value(1, "LSMAOC"),
+            Field("UAO",      7,  4), Value(0, "none"), Value(1, "UAO"),
+            Field("CnP",      3,  0), Value(0, "none"), Value(1, "TTCNP"),
+        Reg("ID_AA64MMFR3_EL1", CSR_REGID_ID_AA64MMFR3_EL1, READ),
+            Field("Spec_FPACC", 63, 60),
+            Field("ADERR",      59, 56),
+            Field("SDERR",      55, 52),
+            Field("ANERR",      47, 44),
+            Field("SNERR",      43, 40),
+            Field("D128_2",     39, 36),
+            Field("D128",       35, 32),
+            Field("MEC",        31, 28),
+            Field("AIE",        27, 24),
+            Field("S2POE",      23, 20),
+            Field("S1POE",      19, 16),
+            Field("S2PIE",      15, 12),
+            Field("S1PIE",      11,  8),
+            Field("SCTLRX",      7,  4),
+            Field("TCRX",        3,  0),
+        Reg("ID_AA64MMFR4_EL1", CSR_REGID_ID_AA64MMFR4_EL1, READ),
+            Field("EIESB", 7, 4),
+        Reg("ID_AA64PFR0_EL1", CSR_REGID_ID_AA64PFR0_EL1, READ),
+            Field("CSV3",    63, 60), Value(0, "undefined"), Value(1, "safe"),
+            Field("CSV2",    59, 56), Value(0, "none"), Value(1, "CSV2"), Value(2, "CSV2_2"), Value(3, "CSV2_3"),
+            Field("RME",     55, 52), Value(0, "none"), Value(1, "RMEv1"),
+            Field("DIT",     51, 48), Value(0, "none"), Value(1, "DIT"),
+            Field("AMU",     47, 44), Value(0, "none"), Value(1, "AMUv1p1"),
+            Field("MPAM",    43, 40), Value(0, "v0"), Value(1, "v1"),
+            Field("SEL2",    39, 36), Value(0, "none"), Value(1, "Secure EL2"),
+            Field("SVE",     35, 32), Value(0, "none"), Value(1, "SVE"),
+            Field("RAS",     31, 28), Value(0, "none"), Value(1, "RAS"), Value(2, "RASv1p1"),
+            Field("GIC",     27, 24), Value(0, "none"), Value(1, "3.0+4.0"), Value(3, "4.1"),
+            Field("AdvSIMD", 23, 20), Value(0, "basic"), Value(1, "basic+FP16"), Value(15, "none"),
+            Field("FP",      19, 16), Value(0, "FP"), Value(1, "FP+FP16"), Value(15, "none"),
+            Field("EL3",     15, 12), Value(0, "none"), Value(1, "AArch64-only"), Value(2, "AArch64+32"),
+            Field("EL2",     11,  8), Value(0, "none"), Value(1, "AArch64-only"), Value(2, "AArch64+32"),
+            Field("EL1",      7,  4), Value(1, "AArch64-only"), Value(2, "AArch64+32"),
+            Field("EL0",      3,  0), Value(1, "AArch64-only"), Value(2, "AArch64+32"),
+        Reg("ID_AA64PFR1_EL1", CSR_REGID_ID_AA64PFR1_EL1, READ),
+            Field("PFAR",      63, 60), Value(0, "none"), Value(1, "PFAR"),
+            Field("DF2",       59, 56), Value(0, "none"), Value(1, "DoubleFault2"),
+            Field("MTEX",      55, 52),
+            Field("THE",       51, 48), Value(0, "none"), Value(1, "THE"),
+            Field("GCS",       47, 44), Value(0, "none"), Value(1, "GCS"),
+            Field("MTE_frac",  43, 40),
+            Field("NMI",       39, 36), Value(0, "none"), Value(1, "NMI"),
+            Field("CSV2_frac", 35, 32), Value(0, "none"), Value(1, "CSV2_1p1"), Value(2, "CSV2_1p2"),
+            Field("RNDR_trap", 31, 28), Value(0, "none"), Value(1, "RNG_TRAP"),
+            Field("SME",       27, 24), Value(0, "none"), Value(1, "SME"),
+            Field("MPAM_frac", 19, 16), Value(0, "v.0"), Value(1, "v.1"),
+            Field("RAS_frac",  15, 12), Value(0, "none"), Value(1, "VARv1p1"),
+            Field("MTE",       11,  8), Value(0, "none"), Value(1, "MTE"), Value(2, "MTE2"), Value(3, "MTE3"),
+            Field("SSBS",       7,  4), Value(0, "none"), Value(1, "SSBS"), Value(2, "SSBS2"),
+            Field("BT",         3,  0), Value(0, "none"), Value(1, "BTI"),
+        Reg("ID_AA64PFR2_EL1", CSR_REGID_ID_AA64PFR2_EL1, READ),
+            Field("MTEFAR",       11, 8), Value(0, "none"), Value(1, "MTE4"),
+            Field("MTESTOREONLY",  7, 4), Value(0, "none"), Value(1, "MTE_STORE_ONLY"),
+            Field("MTEPERM",       3, 0), Value(0, "none"), Value(1, "MTE_PERM"),
+        Reg("ID_AA64SMFR0_EL1", CSR_REGID_ID_AA64SMFR0_EL1, READ | NEED_SME),
+            Field("FA64",    63, 63), Value(0, "none"), Value(1, "SME_FA64"),
+            Field("SMEver",  59, 56),
+            Field("I16I64",  55, 52), Value(0, "none"), Value(15, "SME_I16I64"),
+            Field("F64F64",  48, 48), Value(0, "none"), Value(1, "SME_F16F64"),
+            Field("I16I32",  47, 44),
+            Field("B16B16",  43, 43),
+            Field("F16F16",  42, 42),
+            Field("I8I32",   39, 36),
+            Field("F16F32",  35, 35),
+            Field("B16F32",  34, 34),
+            Field("BI32I32", 33, 33),
+            Field("F32F32",  32, 32),
+        Reg("ID_AA64ZFR0_EL1", CSR_REGID_ID_AA64ZFR0_EL1, READ | NEED_SVE),
+            Field("F64MM",   59, 56), Value(0, "none"), Value(1, "F64MM"),
+            Field("F32MM",   55, 52), Value(0, "none"), Value(1, "F32MM"),
+            Field("I8MM",    47, 44), Value(0, "none"), Value(1, "I8MM"),
+            Field("SM4",     43, 40), Value(0, "none"), Value(1, "SVE_SM4"),
+            Field("SHA3",    35, 32), Value(0, "none"), Value(1, "SVE_SHA3"),
+            Field("BF16",    23, 20), Value(0, "none"), Value(1, "BF16"), Value(2, "EBF16"),
+            Field("BitPerm", 19, 16), Value(0, "none"), Value(1, "SVE_BitPerm"),
+            Field("AES",      7,  4), Value(0, "none"), Value(1, "SVE_AES"), Value(2, "SVE_AES+SVE_AES"),
+            Field("SVEver",   3,  0), Value(0, "none"), Value(1, "SVE2"),
+        Reg("ID_ISAR0_EL1", CSR_REGID_ID_ISAR0_EL1, READ),
+            Field("Divide",    27, 24),
+            Field("Debug",     23, 20),
+            Field("Coproc",    19, 16),
+            Field("CmpBranch", 15, 12),
+            Field("BitField",  11,  8),
+            Field("BitCount",   7,  4),
+            Field("Swap",       3,  0),
+        Reg("ID_ISAR1_EL1", CSR_REGID_ID_ISAR1_EL1, READ),
+            Field("Jazelle",   31, 28),
+            Field("Interwork", 27, 24),
+            Field("Immediate", 23, 20),
+            Field("IfThen",    19, 16),
+            Field("Extend",    15, 12),
+            Field("Except_AR", 11,  8),
+            Field("Except",     7,  4),
+            Field("Endian",     3,  0),
+        Reg("ID_ISAR2_EL1", CSR_REGID_ID_ISAR2_EL1, READ),
+            Field("Reversal",       31, 28),
+            Field("PSR_AR",         27, 24),
+            Field("MultU",          23, 20),
+            Field("MultS",          19, 16),
+            Field("Mult",           15, 12),
+            Field("MultiAccessInt", 11,  8),
+            Field("MemHint",         7,  4),
+            Field("LoadStore",       3,  0),
+        Reg("ID_ISAR3_EL1", CSR_REGID_ID_ISAR3_EL1, READ),
+            Field("T32EE",     31, 28),
+            Field("TrueNOP",   27, 24),
+            Field("T32Copy",   23, 20),
+            Field("TabBranch", 19, 16),
+            Field("SynchPrim", 15, 12),
+            Field("SVC",       11,  8),
+            Field("SIMD",       7,  4),
+            Field("Saturate",   3,  0),
+        Reg("ID_ISAR4_EL1", CSR_REGID_ID_ISAR4_EL1, READ),
+            Field("SWP_frac",       31, 28),
+            Field("PSR_M",          27, 24),
+            Field("SynchPrim_frac", 23, 20),
+            Field("Barrier",        19, 16),
+            Field("SMC",            15, 12),
+            Field("Writeback",      11,  8),
+            Field("WithShifts",      7,  4),
+            Field("Unpriv",          3,  0),
+        Reg("ID_ISAR5_EL1", CSR_REGID_ID_ISAR5_EL1, READ),
+            Field("VCMA",  31, 28),
+            Field("RDM",   27, 24),
+            Field("CRC32", 19, 16),
+            Field("SHA2",  15, 12),
+            Field("SHA1",  11,  8),
+            Field("AES",    7,  4),
+            Field("SEVL",   3,  0),
+        Reg("ID_ISAR6_EL1", CSR_REGID_ID_ISAR6_EL1, READ),
+            Field("I8MM",    27, 24),
+            Field("BF16",    23, 20),
+            Field("SPECRES", 19, 16),
+            Field("SB",      15, 12),
+            Field("FHM",     11,  8),
+            Field("DP",       7,  4),
+            Field("JSCVT",    3,  0),
+        Reg("ID_MMFR0_EL1", CSR_REGID_ID_MMFR0_EL1, READ),
+            Field("InnerShr", 31, 28),
+            Field("FCSE",     27, 24),
+            Field("AuxReg",   23, 20),
+            Field("TCM",      19, 16),
+            Field("ShareLvl", 15, 12),
+            Field("OuterShr", 11,  8),
+            Field("PMSA",      7,  4),
+            Field("VMSA",      3,  0),
+        Reg("ID_MMFR1_EL1", CSR_REGID_ID_MMFR1_EL1, READ),
+            Field("BPred",    31, 28),
+            Field("L1TstCln", 27, 24),
+            Field("L1Uni",    23, 20),
+            Field("L1Hvd",    19, 16),
+            Field("L1UniSW",  15, 12),
+            Field("L1HvdSW",  11,  8),
+            Field("L1UniVA",   7,  4),
+            Field("L1HvdVA",   3,  0),
+        Reg("ID_MMFR2_EL1", CSR_REGID_ID_MMFR2_EL1, READ),
+            Field("HWAccFlg", 31, 28),
+            Field("WFIStall", 27, 24),
+            Field("MemBarr",  23, 20),
+            Field("UniTLB",   19, 16),
+            Field("HvdTLB",   15, 12),
+            Field("L1HvdRng", 11,  8),
+            Field("L1HvdBG",   7,  4),
+            Field("L1HvdFG",   3,  0),
+        Reg("ID_MMFR3_EL1", CSR_REGID_ID_MMFR3_EL1, READ),
+            Field("Supersec",  31, 28),
+            Field("CMemSz",    27, 24),
+            Field("CohWalk",   23, 20),
+            Field("PAN",       19, 16),
+            Field("MaintBcst", 15, 12),
+            Field("BPMaint",   11,  8),
+            Field("CMaintSW",   7,  4),
+            Field("CMaintVA",   3,  0),
+        Reg("ID_MMFR4_EL1", CSR_REGID_ID_MMFR4_EL1, READ),
+            Field("EVT",     31, 28),
+            Field("CCIDX",   27, 24),
+            Field("LSM",     23, 20),
+            Field("HPDS",    19, 16),
+            Field("CnP",     15, 12),
+            Field("XNX",     11,  8),
+            Field("AC2",      7,  4),
+            Field("SpecSEI",  3,  0),
+        Reg("ID_MMFR5_EL1", CSR_REGID_ID_MMFR5_EL1, READ),
+            Field("nTLBPA", 7, 4),
+            Field("ETS",    3, 0),
+        Reg("ID_PFR0_EL1", CSR_REGID_ID_PFR0_EL1, READ),
+            Field("RAS",    31, 28),
+            Field("DIT",    27, 24),
+            Field("AMU",    23, 20),
+            Field("CSV2",   19, 16),
+            Field("State3", 15, 12),
+            Field("State2", 11,  8),
+            Field("State1",  7,  4),
+            Field("State0",  3,  0),
+        Reg("ID_PFR1_EL1", CSR_REGID_ID_PFR1_EL1, READ),
+            Field("GIC",            31, 28),
+            Field("Virt_frac",      27, 24),
+            Field("Sec_frac",       23, 20),
+            Field("GenTimer",       19, 16),
+            Field("Virtualization", 15, 12),
+            Field("MProgMod",       11,  8),
+            Field("Security",        7,  4),
+            Field("ProgMod",         3,  0),
+        Reg("ID_PFR2_EL1", CSR_REGID_ID_PFR2_EL1, READ),
+            Field("RAS_frac", 11, 8),
+            Field("SSBS",      7, 4),
+            Field("CSV3",      3, 0),
+        Reg("MAIR_EL1", CSR_REGID_MAIR_EL1, READ),
+            Field("Attr7", 63, 56),
+            Field("Attr6", 55, 48),
+            Field("Attr5", 47, 40),
+            Field("Attr4", 39, 32),
+            Field("Attr3", 31, 24),
+            Field("Attr2", 23, 16),
+            Field("Attr1", 15,  8),
+            Field("Attr0",  7,  0),
+        Reg("MAIR2_EL1", CSR_REGID_MAIR2_EL1, READ | NEED_AIE),
+            Field("Attr7", 63, 56),
+            Field("Attr6", 55, 48),
+            Field("Attr5", 47, 40),
+            Field("Attr4", 39, 32),
+            Field("Attr3", 31, 24),
+            Field("Attr2", 23, 16),
+            Field("Attr1", 15,  8),
+            Field("Attr0",  7,  0),
+        Reg("MIDR_EL1", CSR_REGID_MIDR_EL1, READ),
+            Field("Implementer",  31, 24), Value(0x41, "Arm"), Value(0x61, "Apple"), Value(0xC0, "Ampere"),
+            Field("Variant",      23, 20),
+            Field("Architecture", 19, 16), Value(1, "v4"), Value(2, "v4T"), Value(3, "v5"), Value(4, "v5T"), Value(5, "v5TE"), Value(6, "v5TEJ"), Value(7, "v6"), Value(15, "By features"),
+            Field("PartNum",      15,  4),
+            Field("Revision",      3,  0),
+        Reg("MPIDR_EL1", CSR_REGID_MPIDR_EL1, READ),
+            Field("Aff3", 39, 32),
+            Field("U",    30, 30), Value(0, "Multiprocessor"), Value(1, "Uniprocessor"),
+            Field("MT",   24, 24), Value(0, "Independent perf."), Value(1, "Interdependent perf."),
+            Field("Aff2", 23, 16),
+            Field("Aff1", 15,  8),
+            Field("Aff0",  7,  0),
+        Reg("PIR_EL1", CSR_REGID_PIR_EL1, READ | NEED_S1PIE),
+            Field("Perm15", 63, 60),
+            Field("Perm14", 59, 56),
+            Field("Perm13", 55, 52),
+            Field("Perm12", 51, 48),
+            Field("Perm11", 47, 44),
+            Field("Perm10", 43, 40),
+            Field("Perm9",  39, 36),
+            Field("Perm8",  35, 32),
+            Field("Perm7",  31, 28),
+            Field("Perm6",  27, 24),
+            Field("Perm5",  23, 20),
+            Field("Perm4",  19, 16),
+            Field("Perm3",  15, 12),
+            Field("Perm2",  11,  8),
+            Field("Perm1",   7,  4),
+            Field("Perm0",   3,  0),
+        Reg("PIRE0_EL1", CSR_REGID_PIRE0_EL1, READ | NEED_S1PIE),
+            Field("Perm15", 63, 60),
+            Field("Perm14", 59, 56),
+            Field("Perm13", 55, 52),
+            Field("Perm12", 51, 48),
+            Field("Perm11", 47, 44),
+            Field("Perm10", 43, 40),
+            Field("Perm9",  39, 36),
+            Field("Perm8",  35, 32),
+            Field("Perm7",  31, 28),
+            Field("Perm6",  27, 24),
+            Field("Perm5",  23, 20),
+            Field("Perm4",  19, 16),
+            Field("Perm3",  15, 12),
+            Field("Perm2",  11,  8),
+            Field("Perm1",   7,  4),
+            Field("Perm0",   3,  0),
+        Reg("PMCCFILTR_EL0", CSR_REGID_PMCCFILTR_EL0, READ | NEED_PMUv3),
+            Field("P",   31, 31),
+            Field("U",   30, 30),
+            Field("NSK", 29, 29),
+            Field("NSU", 28, 28),
+            Field("NSH", 27, 27),
+            Field("M",   26, 26),
+            Field("SH",  24, 24),
+            Field("T",   23, 23),
+            Field("RLK", 22, 22),
+            Field("RLU", 21, 21),
+            Field("RLH", 20, 20),
+        Reg("PMCCNTR_EL0", CSR_REGID_PMCCNTR_EL0, READ | NEED_PMUv3),
+        Reg("PMCNTENSET_EL0", CSR_REGID_PMCNTENSET_EL0, READ | NEED_PMUv3),
+            Field("C", 31, 31),
+            Field("P", 30,  0),
+        Reg("PMCR_EL0", CSR_REGID_PMCR_EL0, READ | NEED_PMUv3),
+            Field("FZS",    32, 32),
+            Field("IMP",    31, 24),
+            Field("IDCODE", 23, 16),
+            Field("N",      15, 11),
+            Field("FZ0",     9,  9),
+            Field("LP",      7,  7),
+            Field("LC",      6,  6),
+            Field("DP",      5,  5),
+            Field("X",       4,  4),
+            Field("D",       3,  3),
+            Field("C",       2,  2),
+            Field("P",       1,  1),
+            Field("E",       0,  0),
+        Reg("PMMIR_EL1", CSR_REGID_PMMIR_EL1, READ | NEED_PMUv3p4),
+            Field("EDGE",      27, 24),
+            Field("THWIDTH",   23, 20),
+            Field("BUS_WIDTH", 19, 16),
+            Field("BUS_SLOTS", 15,  8),
+            Field("SLOTS",      7,  0),
+        Reg("PMOVSSET_EL0", CSR_REGID_PMOVSSET_EL0, READ | NEED_PMUv3),
+            Field("C", 31, 31),
+            Field("P", 30,  0),
+        Reg("PMSIDR_EL1", CSR_REGID_PMSIDR_EL1, READ_PMSIDR | NEED_SPE),
+            Field("CRR",       25, 25), Value(0, "none"), Value(1, "SPE_CRR"),
+            Field("PBT",       24, 24), Value(0, "none"), Value(1, "SPEv1p2"),
+            Field("Format",    23, 20),
+            Field("CountSize", 19, 16), Value(2, "12-bit saturating"), Value(3, "16-bit saturating"),
+            Field("MaxSize",   15, 12), Value(4, "16 bytes"), Value(5, "32 bytes"), Value(6, "64 bytes"), Value(7, "128 bytes"), Value(8, "256 bytes"), Value(9, "512 bytes"), Value(10, "1KB"), Value(11, "2KB"),
+            Field("Interval",  11,  8), Value(0, "256"), Value(2, "512"), Value(3, "768"), Value(4, "1024"), Value(5, "1536"), Value(6, "2048"), Value(7, "3072"), Value(8, "4096"),
+            Field("FDS",        7,  7),
+            Field("FNE",        6,  6),
+            Field("ERnd",       5,  5),
+            Field("LDS",        4,  4),
+            Field("ArchInst",   3,  3),
+            Field("FL",         2,  2),
+            Field("FT",         1,  1),
+            Field("FE",         0,  0),
+        Reg("PMUSERENR_EL0", CSR_REGID_PMUSERENR_EL0, READ | NEED_PMUv3),
+            Field("ER", 3, 3),
+            Field("CR", 2, 2),
+            Field("SW", 1, 1),
+            Field("EN", 0, 0),
+        Reg("REVIDR_EL1", CSR_REGID_REVIDR_EL1, READ),
+        Reg("RNDR", CSR_REGID_RNDR, READ | NEED_RNG),
+        Reg("RNDRRS", CSR_REGID_RNDRRS, READ | NEED_RNG),
+        Reg("SCR_EL3", CSR_REGID_SCR_EL3, 0),
+            Field("NSE",       62, 62),
+            Field("FGTEn2",    59, 59), Value(0, "trap"), Value(1, "none"),
+            Field("EnIDCP128", 55, 55),
+            Field("PFAREn",    53, 53),
+            Field("TWERR",     52, 52),
+            Field("TMEA",      51, 51),
+            Field("MECEn",     49, 49),
+            Field("GPF",       48, 48), Value(0, "none"), Value(1, "exception"),
+            Field("D128En",    47, 47),
+            Field("AIEn",      46, 46),
+            Field("PIEn",      45, 45),
+            Field("SCTLR2En",  44, 44),
+            Field("TCR2En",    43, 43),
+            Field("RCWMASKEn", 42, 42),
+            Field("EnTP2",     41, 41), Value(0, "trap"), Value(1, "none"),
+            Field("TRNDR",     40, 40), Value(0, "none"), Value(1, "trap"),
+            Field("GCSEn",     39, 39),
+            Field("HXEn",      38, 38), Value(0, "trap"), Value(1, "none"),
+            Field("ADEn",      37, 37), Value(0, "trap"), Value(1, "none"),
+            Field("EnAS0",     36, 36), Value(0, "trap"), Value(1, "none"),
+            Field("AMVOFFEN",  35, 35), Value(0, "trap"), Value(1, "none"),
+            Field("TME",       34, 34), Value(0, "undefined"), Value(1, "none"),
+            Field("TWEDEL",    33, 30),
+            Field("TWEDEn",    29, 29), Value(0, "imp"), Value(1, "twedel"),
+            Field("ECVEn",     28, 28), Value(0, "trap"), Value(1, "none"),
+            Field("FGTEn",     27, 27), Value(0, "trap"), Value(1, "none"),
+            Field("ATA",       26, 26), Value(0, "trap"), Value(1, "none"),
+            Field("EnSCXT",    25, 25), Value(0, "trap"), Value(1, "none"),
+            Field("FIEN",      21, 21), Value(0, "trap"), Value(1, "none"),
+            Field("NMEA",      20, 20),
+            Field("EASE",      19, 19), Value(0, "exception"), Value(1, "interrupt"),
+            Field("EEL2",      18, 18), Value(0, "disabled"), Value(1, "enabled"),
+            Field("API",       17, 17), Value(0, "trap"), Value(1, "none"),
+            Field("APK",       16, 16), Value(0, "trap"), Value(1, "none"),
+            Field("TERR",      15, 15), Value(0, "none"), Value(1, "trap"),
+            Field("TLOR",      14, 14), Value(0, "none"), Value(1, "trap"),
+            Field("TWE",       13, 13), Value(0, "none"), Value(1, "trap"),
+            Field("TWI",       12, 12), Value(0, "none"), Value(1, "trap"),
+            Field("ST",        11, 11), Value(0, "trap"), Value(1, "none"),
+            Field("RW",        10, 10), Value(0, "aarch32"), Value(1, "aarch64"),
+            Field("SIF",        9,  9), Value(0, "permitted"), Value(1, "not permitted"),
+            Field("HCE",        8,  8), Value(0, "undefined"), Value(1, "enabled"),
+            Field("SMD",        7,  7), Value(0, "enabled"), Value(1, "undefined"),
+            Field("EA",         3,  3), Value(0, "none"), Value(1, "el3"),
+            Field("FIQ",        2,  2), Value(0, "none"), Value(1, "el3"),
+            Field("IRQ",        1,  1), Value(0, "none"), Value(1, "el3"),
+            Field("NS",         0,  0),
+        Reg("SCTLR_EL1", CSR_REGID_SCTLR_EL1, READ | WRITE),
+            Field("TIDCP",     63, 63), Value(0, "none"), Value(1, "trap EL0 access to system registers"),
+            Field("SPINTMASK", 62, 62), Value(0, "none"), Value(1, "SPINTMASK"),
+            Field("NMI",       61, 61), Value(0, "none"), Value(1, "NMI"),
+            Field("EnTP2",     60, 60), Value(0, "none"), Value(1, "EnTP2"),
+            Field("TCSO",      59, 59), Value(0, "none"), Value(1, "unchecked"),
+            Field("TCSO0",     58, 58), Value(0, "none"), Value(1, "unchecked"),
+            Field("EPAN",      57, 57), Value(0, "none"), Value(1, "EPAN"),
+            Field("EnALS",     56, 56), Value(0, "none"), Value(1, "EnALS"),
+            Field("EnAS0",     55, 55), Value(0, "none"), Value(1, "EnAS0"),
+            Field("EnASR",     54, 54), Value(0, "none"), Value(1, "EnASR"),
+            Field("TME",       53, 53), Value(0, "none"), Value(1, "TME"),
+            Field("TME0",      52, 52), Value(0, "none"), Value(1, "TME0"),
+            Field("TMT",       51, 51), Value(0, "none"), Value(1, "TMT"),
+            Field("TMT0",      50, 50), Value(0, "none"), Value(1, "TMT0"),
+            Field("TWEDEL",    49, 46), Value(0, "none"), Value(1, "TWEDEL"),
+            Field("TWEDEn",    45, 45), Value(0, "none"), Value(1, "TWEDEn"),
+            Field("DSSBS",     44, 44), Value(0, "none"), Value(1, "DSSBS"),
+            Field("ATA",       43, 43), Value(0, "none"), Value(1, "ATA"),
+            Field("ATA0",      42, 42), Value(0, "none"), Value(1, "ATA0"),
+            Field("TCF",       41, 40), Value(0, "EL1 tag check faults ignored"), Value(1, "EL1 tag check faults synchronous"), Value(2, "EL1 tag check faults asynchronous"), Value(3, "EL1 tag check faults asymmetric"),
+            Field("TCF0",      39, 38), Value(0, "EL0 tag check faults ignored"), Value(1, "EL0 tag check faults synchronous"), Value(2, "EL0 tag check faults asynchronous"), Value(3, "EL0 tag check faults asymmetric"),
+            Field("ITFSB",     37, 37), Value(0, "none"), Value(1, "ITFSB"),
+            Field("BT1",       36, 36), Value(0, "BTI at EL1: PACIxSP is compatible with BTYPE:11"), Value(1, "BTI at EL1: PACIxSP NOT compatible with BTYPE:11"),
+            Field("BT0",       35, 35), Value(0, "BTI at EL0: PACIxSP is compatible with BTYPE:11"), Value(1, "BTI at EL0: PACIxSP NOT compatible with BTYPE:11"),
+            Field("MSCEn",     33, 33), Value(0, "none"), Value(1, "MSCEn"),
+            Field("CMOW",      32, 32), Value(0, "none"), Value(1, "CMOW"),
+            Field("EnIA",      31, 31), Value(0, "PACIA key NOT enabled"), Value(1, "PACIA key enabled"),
+            Field("EnIB",      30, 30), Value(0, "PACIB key NOT enabled"), Value(1, "PACIB key enabled"),
+            Field("LSMAOE",    29, 29), Value(0, "none"), Value(1, "LSMAOE"),
+            Field("nTLSMD",    28, 28), Value(0, "none"), Value(1, "nTLSMD"),
+            Field("EnDA",      27, 27), Value(0, "PACDA key NOT enabled"), Value(1, "PACDA key enabled"),
+            Field("UCI",       26, 26), Value(0, "none"), Value(1, "UCI"),
+            Field("EE",        25, 25), Value(0, "TT EL1 is little endian"), Value(1, "TT EL1 is big endian"),
+            Field("E0E",       24, 24), Value(0, "EL0 data access is little endian"), Value(1, "EL0 data access is big endian"),
+            Field("SPAN",      23, 23), Value(0, "none"), Value(1, "SPAN"),
+            Field("EIS",       22, 22), Value(0, "none"), Value(1, "EIS"),
+            Field("IESB",      21, 21), Value(0, "none"), Value(1, "IESB"),
+            Field("TSCTX",     20, 20), Value(0, "none"), Value(1, "TSCTX"),
+            Field("WXN",       19, 19), Value(0, "none"), Value(1, "WXN"),
+            Field("nTWE",      18, 18), Value(0, "none"), Value(1, "nTWE"),
+            Field("nTWI",      16, 16), Value(0, "none"), Value(1, "nTWI"),
+            Field("UCT",       15, 15), Value(0, "none"), Value(1, "UCT"),
+            Field("DZE",       14, 14), Value(0, "none"), Value(1, "DZE"),
+            Field("EnDB",      13, 13), Value(0, "PACDB key NOT enabled"), Value(1, "PACDB key enabled"),
+            Field("I",         12, 12), Value(0, "none"), Value(1, "I"),
+            Field("EOS",       11, 11), Value(0, "none"), Value(1, "EOS"),
+            Field("EnRCTX",    10, 10), Value(0, "none"), Value(1, "EnRCTX"),
+            Field("UMA",        9,  9), Value(0, "none"), Value(1, "UMA"),
+            Field("SED",        8,  8), Value(0, "none"), Value(1, "SED"),
+            Field("ITD",        7,  7), Value(0, "none"), Value(1, "ITD"),
+            Field("nAA",        6,  6), Value(0, "none"), Value(1, "nAA"),
+            Field("CP15BEN",    5,  5), Value(0, "none"), Value(1, "CP15BEN"),
+            Field("SA0",        4,  4), Value(0, "none"), Value(1, "SA0"),
+            Field("SA",         3,  3), Value(0, "none"), Value(1, "SA"),
+            Field("C",          2,  2), Value(0, "none"), Value(1, "C"),
+            Field("A",          1,  1), Value(0, "none"), Value(1, "A"),
+            Field("M",          0,  0), Value(0, "none"), Value(1, "M"),
+        Reg("SCTLR2_EL1", CSR_REGID_SCTLR2_EL1, READ | WRITE | NEED_SCTLR2),
+            Field("EnIDCP128", 6, 6),
+            Field("EASE",      5, 5),
+            Field("EnANERR",   4, 4),
+            Field("EnADERR",   3, 3),
+            Field("NMEA",      2, 2),
+        Reg("SCXTNUM_EL0", CSR_REGID_SCXTNUM_EL0, READ | WRITE | NEED_CSV2_2),
+        Reg("SCXTNUM_EL1", CSR_REGID_SCXTNUM_EL1, READ | WRITE | NEED_CSV2_2),
+        Reg("SMCR_EL1", CSR_REGID_SMCR_EL1, READ | NEED_SME),
+            Field("FA64", 31, 31), Value(0, "FA64 disabled"), Value(1, "FA64 enabled in streaming mode"),
+            Field("EZT0", 30, 30), Value(0, "ZT0 trapped"), Value(1, "ZT0 enabled"),
+            Field("LEN",   3,  0),
+        Reg("TCR_EL1", CSR_REGID_TCR_EL1, READ),
+            Field("MTX1",   61, 61), Value(0, "none"), Value(1, "logical address tag"),
+            Field("MTX0",   60, 60), Value(0, "none"), Value(1, "logical address tag"),
+            Field("DS",     59, 59), Value(0, "48-bit addresses"), Value(1, "52-bit addresses"),
+            Field("TCMA1",  58, 58), Value(0, "none"), Value(1, "unchecked"),
+            Field("TCMA0",  57, 57), Value(0, "none"), Value(1, "unchecked"),
+            Field("E0PD1",  56, 56), Value(0, "none"), Value(1, "fault"),
+            Field("E0PD0",  55, 55), Value(0, "none"), Value(1, "fault"),
+            Field("NFD1",   54, 54), Value(0, "none"), Value(1, "stage 1 disabled"),
+            Field("NFD0",   53, 53), Value(0, "none"), Value(1, "stage 1 disabled"),
+            Field("TBID1",  52, 52), Value(0, "instr+data"), Value(1, "data"),
+            Field("TBID0",  51, 51), Value(0, "instr+data"), Value(1, "data"),
+            Field("HWU162", 50, 50), Value(0, "bit62-reserved"), Value(1, "bit62-impl-def"),
+            Field("HWU161", 49, 49), Value(0, "bit61-reserved"), Value(1, "bit61-impl-def"),
+            Field("HWU160", 48, 48), Value(0, "bit60-reserved"), Value(1, "bit60-impl-def"),
+            Field("HWU159", 47, 47), Value(0, "bit59-reserved"), Value(1, "bit59-impl-def"),
+            Field("HWU062", 46, 46), Value(0, "bit62-reserved"), Value(1, "bit62-impl-def"),
+            Field("HWU061", 45, 45), Value(0, "bit61-reserved"), Value(1, "bit61-impl-def"),
+            Field("HWU060", 44, 44), Value(0, "bit60-reserved"), Value(1, "bit60-impl-def"),
+            Field("HWU059", 43, 43), Value(0, "bit59-reserved"), Value(1, "bit59-impl-def"),
+            Field("HPD1",   42, 42), Value(0, "enabled"), Value(1, "disabled"),
+            Field("HPD0",   41, 41), Value(0, "enabled"), Value(1, "disabled"),
+            Field("HD",     40, 40), Value(0, "disabled"), Value(1, "enabled"),
+            Field("HA",     39, 39), Value(0, "disabled"), Value(1, "enabled"),
+            Field("TBI1",   38, 38), Value(0, "used"), Value(1, "ignored"),
+            Field("TBI0",   37, 37), Value(0, "used"), Value(1, "ignored"),
+            Field("AS",     36, 36), Value(0, "ignored"), Value(1, "used"),
+            Field("IPS",    34, 32), Value(0, "32 bits, 4GB"), Value(1, "36 bits, 64 GB"), Value(2, "40 bits, 1 TB"), Value(3, "42 bits, 4 TB"), Value(4, "44 bits, 16 TB"), Value(5, "48 bits, 256 TB"), Value(6, "52 bits, 4 PB"),
+            Field("TG1",    31, 30), Value(1, "16 kB"), Value(2, "4 kB"), Value(3, "64 kB"),
+            Field("SH1",    29, 28), Value(0, "Non shareable"), Value(2, "Outer shareable"), Value(3, "Inner shareable"),
+            Field("ORGN1",  27, 26), Value(0, "Normal memory, Outer Non-cacheable"), Value(1, "Normal memory, Outer Write-Back Read-Allocate Write-Allocate Cacheable"), Value(2, "Normal memory, Outer Write-Through Read-Allocate No Write-Allocate Cacheable"), Value(3, "Normal memory, Outer Write-Back Read-Allocate No Write-Allocate Cacheable"),
+            Field("IRGN1",  25, 24), Value(0, "Normal memory, Inner Non-cacheable"), Value(1, "Normal memory, Inner Write-Back Read-Allocate Write-Allocate Cacheable"), Value(2, "Normal memory, Inner Write-Through Read-Allocate No Write-Allocate Cacheable"), Value(3, "Normal memory, Inner Write-Back Read-Allocate No Write-Allocate Cacheable"),
+            Field("EPD1",   23, 23), Value(0, "Translation table walks using TTBR1_EL1"), Value(1, "TLB miss using TTBR1_EL1 generates a Translation fault"),
+            Field("A1",     22, 22), Value(0, "TTBR0_EL1.ASID defines the ASID"), Value(1, "TTBR1_EL1.ASID defines the ASID"),
+            Field("T1SZ",   21, 16),
+            Field("TG0",    15, 14), Value(0, "4 kB"), Value(1, "64 kB"), Value(2, "16 kB"),
+            Field("SH0",    13, 12), Value(0, "Non shareable"), Value(2, "Outer shareable"), Value(3, "Inner shareable"),
+            Field("ORGN0",  11, 10), Value(0, "Normal memory, Outer Non-cacheable"), Value(1, "Normal memory, Outer Write-Back Read-Allocate Write-Allocate Cacheable"), Value(2, "Normal memory, Outer Write-Through Read-Allocate No Write-Allocate Cacheable"), Value(3, "Normal memory, Outer Write-Back Read-Allocate No Write-Allocate Cacheable"),
+            Field("IRGN0",   9,  8), Value(0, "Normal memory, Inner Non-cacheable"), Value(1, "Normal memory, Inner Write-Back Read-Allocate Write-Allocate Cacheable"), Value(2, "Normal memory, Inner Write-Through Read-Allocate No Write-Allocate Cacheable"), Value(3, "Normal memory, Inner Write-Back Read-Allocate No Write-Allocate Cacheable"),
+            Field("EPD0",    7,  7), Value(0, "Translation table walks using TTBR0_EL1"), Value(1, "TLB miss using TTBR0_EL1 generates a Translation fault"),
+            Field("T0SZ",    5,  0),
+        Reg("TCR2_EL1", CSR_REGID_TCR2_EL1, READ | NEED_TCR2),
+            Field("DisCH1", 15, 15),
+            Field("DisCH0", 14, 14),
+            Field("HAFT",   11, 11),
+            Field("PTTWI",  10, 10),
+            Field("D128",    5,  5),
+            Field("AIE",     4,  4),
+            Field("POE",     3,  3),
+            Field("E0POE",   2,  2),
+            Field("PIE",     1,  1),
+            Field("PnCH",    0,  0),
+        Reg("TPIDRRO_EL0", CSR_REGID_TPIDRRO_EL0, READ_TPIDR | WRITE_TPIDR),
+        Reg("TPIDR_EL0", CSR_REGID_TPIDR_EL0, READ_TPIDR | WRITE_TPIDR),
+        Reg("TPIDR_EL1", CSR_REGID_TPIDR_EL1, READ_TPIDR | WRITE_TPIDR),
+        Reg("TTBR0_EL1", CSR_REGID_TTBR0_EL1, READ),
+            Field("ASID",  63, 48),
+            Field("BADDR", 47,  1),
+            Field("CnP",    0,  0), Value(0, "differ"), Value(1, "common"),
+        Reg("TTBR1_EL1", CSR_REGID_TTBR1_EL1, READ),
+            Field("ASID",  63, 48),
+            Field("BADDR", 47,  1),
+            Field("CnP",    0,  0), Value(0, "differ"), Value(1, "common"),
+        Reg("TRCDEVARCH", CSR_REGID_TRCDEVARCH, READ | NEED_ETE),
+            Field("ARCHITECT", 31, 21),
+            Field("PRESENT",   20, 20), Value(0, "not present"), Value(1, "present"),
+            Field("REVISION",  19, 16), Value(0, "ETEv1.0"), Value(1, "ETEv1.1"), Value(2, "ETEv1.2"),
+            Field("ARCHVER",   15, 12), Value(5, "ETEv1"),
+            Field("ARCHPART",  11,  0), Value(0xA13, "Arm PE trace architecture"),
+        Reg("ZCR_EL1", CSR_REGID_ZCR_EL1, READ | NEED_SVE),
+            Field("LEN", 3, 0),
+        };
+    };
+
+    constexpr size_t EntryCount = sizeof(RegTable::Entries) / sizeof(RegTable::Entries[0]);
+
+    // Count entries of a given type.
+    constexpr size_t CountEntries(EntryType type)
     {
-        "PMCR_EL0", CSR_REGID_PMCR_EL0, READ | NEED_PMUv3,
-        {
-            {"FZS",    32, 32, {}},
-            {"IMP",    31, 24, {}},
-            {"IDCODE", 23, 16, {}},
-            {"N",      15, 11, {}},
-            {"FZ0",     9,  9, {}},
-            {"LP",      7,  7, {}},
-            {"LC",      6,  6, {}},
-            {"DP",      5,  5, {}},
-            {"X",       4,  4, {}},
-            {"D",       3,  3, {}},
-            {"C",       2,  2, {}},
-            {"P",       1,  1, {}},
-            {"E",       0,  0, {}},
+        size_t count = 0;
+        for (size_t i = 0; i < EntryCount; i++) {
+            count += RegTable::Entries[i].type == type;
         }
-    },
+        return count;
+    }
+
+    // Count the consecutive entries of a given type, starting at an index.
+    constexpr size_t CountFollowing(size_t index, EntryType type)
     {
-        "PMMIR_EL1", CSR_REGID_PMMIR_EL1, READ | NEED_PMUv3p4,
-        {
-            {"EDGE",      27, 24, {}},
-            {"THWIDTH",   23, 20, {}},
-            {"BUS_WIDTH", 19, 16, {}},
-            {"BUS_SLOTS", 15,  8, {}},
-            {"SLOTS",      7,  0, {}},
+        size_t count = 0;
+        while (index + count < EntryCount && RegTable::Entries[index + count].type == type) {
+            count++;
         }
-    },
-    {
-        "PMSIDR_EL1", CSR_REGID_PMSIDR_EL1, READ_PMSIDR | NEED_SPE,
-        {
-            {"CRR",       25, 25, {{0, "none"}, {1, "SPE_CRR"}}},
-            {"PBT",       24, 24, {{0, "none"}, {1, "SPEv1p2"}}},
-            {"Format",    23, 20, {}},
-            {"CountSize", 19, 16, {{2, "12-bit saturating"}, {3, "16-bit saturating"}}},
-            {"MaxSize",   15, 12, {{4, "16 bytes"}, {5, "32 bytes"}, {6, "64 bytes"}, {7, "128 bytes"},
-                                   {8, "256 bytes"}, {9, "512 bytes"}, {10, "1KB"}, {11, "2KB"}}},
-            {"Interval",  11,  8, {{0, "256"}, {2, "512"}, {3, "768"}, {4, "1024"},
-                                   {5, "1536"}, {6, "2048"}, {7, "3072"}, {8, "4096"}}},
-            {"FDS",        7,  7, {}},
-            {"FNE",        6,  6, {}},
-            {"ERnd",       5,  5, {}},
-            {"LDS",        4,  4, {}},
-            {"ArchInst",   3,  3, {}},
-            {"FL",         2,  2, {}},
-            {"FT",         1,  1, {}},
-            {"FE",         0,  0, {}},
+        return count;
+    }
+
+    // Compare two register names, case insensitive.
+    constexpr char UpperChar(char c) { return c >= 'a' && c <= 'z' ? char(c - 'a' + 'A') : c; }
+    constexpr int CompareNames(std::string_view a, std::string_view b)
+    {
+        for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+            const char ca = UpperChar(a[i]);
+            const char cb = UpperChar(b[i]);
+            if (ca != cb) {
+                return ca < cb ? -1 : 1;
+            }
         }
-    },
+        return a.size() == b.size() ? 0 : (a.size() < b.size() ? -1 : 1);
+    }
+
+    // Check the consistency of the table.
+    constexpr bool CheckEntries()
     {
-        "PMUSERENR_EL0", CSR_REGID_PMUSERENR_EL0, READ | NEED_PMUv3,
-        {
-            {"ER", 3, 3, {}},
-            {"CR", 2, 2, {}},
-            {"SW", 1, 1, {}},
-            {"EN", 0, 0, {}},
+        if (EntryCount == 0 || RegTable::Entries[0].type != REG) {
+            return false;
         }
-    },
-    {
-        "REVIDR_EL1", CSR_REGID_REVIDR_EL1, READ, {}
-    },
-    {
-        "RNDR", CSR_REGID_RNDR, READ | NEED_RNG, {}
-    },
-    {
-        "RNDRRS", CSR_REGID_RNDRRS, READ | NEED_RNG, {}
-    },
-    {
-        "SCR_EL3", CSR_REGID_SCR_EL3, 0,
-        {
-            {"NSE",       62, 62, {}},
-            {"FGTEn2",    59, 59, {{0, "trap"}, {1, "none"}}},
-            {"EnIDCP128", 55, 55, {}},
-            {"PFAREn",    53, 53, {}},
-            {"TWERR",     52, 52, {}},
-            {"TMEA",      51, 51, {}},
-            {"MECEn",     49, 49, {}},
-            {"GPF",       48, 48, {{0, "none"}, {1, "exception"}}},
-            {"D128En",    47, 47, {}},
-            {"AIEn",      46, 46, {}},
-            {"PIEn",      45, 45, {}},
-            {"SCTLR2En",  44, 44, {}},
-            {"TCR2En",    43, 43, {}},
-            {"RCWMASKEn", 42, 42, {}},
-            {"EnTP2",     41, 41, {{0, "trap"}, {1, "none"}}},
-            {"TRNDR",     40, 40, {{0, "none"}, {1, "trap"}}},
-            {"GCSEn",     39, 39, {}},
-            {"HXEn",      38, 38, {{0, "trap"}, {1, "none"}}},
-            {"ADEn",      37, 37, {{0, "trap"}, {1, "none"}}},
-            {"EnAS0",     36, 36, {{0, "trap"}, {1, "none"}}},
-            {"AMVOFFEN",  35, 35, {{0, "trap"}, {1, "none"}}},
-            {"TME",       34, 34, {{0, "undefined"}, {1, "none"}}},
-            {"TWEDEL",    33, 30, {}},
-            {"TWEDEn",    29, 29, {{0, "imp"}, {1, "twedel"}}},
-            {"ECVEn",     28, 28, {{0, "trap"}, {1, "none"}}},
-            {"FGTEn",     27, 27, {{0, "trap"}, {1, "none"}}},
-            {"ATA",       26, 26, {{0, "trap"}, {1, "none"}}},
-            {"EnSCXT",    25, 25, {{0, "trap"}, {1, "none"}}},
-            {"FIEN",      21, 21, {{0, "trap"}, {1, "none"}}},
-            {"NMEA",      20, 20, {}},
-            {"EASE",      19, 19, {{0, "exception"}, {1, "interrupt"}}},
-            {"EEL2",      18, 18, {{0, "disabled"}, {1, "enabled"}}},
-            {"API",       17, 17, {{0, "trap"}, {1, "none"}}},
-            {"APK",       16, 16, {{0, "trap"}, {1, "none"}}},
-            {"TERR",      15, 15, {{0, "none"}, {1, "trap"}}},
-            {"TLOR",      14, 14, {{0, "none"}, {1, "trap"}}},
-            {"TWE",       13, 13, {{0, "none"}, {1, "trap"}}},
-            {"TWI",       12, 12, {{0, "none"}, {1, "trap"}}},
-            {"ST",        11, 11, {{0, "trap"}, {1, "none"}}},
-            {"RW",        10, 10, {{0, "aarch32"}, {1, "aarch64"}}},
-            {"SIF",        9,  9, {{0, "permitted"}, {1, "not permitted"}}},
-            {"HCE",        8,  8, {{0, "undefined"}, {1, "enabled"}}},
-            {"SMD",        7,  7, {{0, "enabled"}, {1, "undefined"}}},
-            {"EA",         3,  3, {{0, "none"}, {1, "el3"}}},
-            {"FIQ",        2,  2, {{0, "none"}, {1, "el3"}}},
-            {"IRQ",        1,  1, {{0, "none"}, {1, "el3"}}},
-            {"NS",         0,  0, {}},
+        for (size_t i = 0; i < EntryCount; i++) {
+            const Entry& e(RegTable::Entries[i]);
+            if (e.type == REG && (e.arg1 <= CSR_REGID_INVALID || e.arg1 == _CSR_REGID_END || e.arg1 >= _CSR_REGID2_END)) {
+                return false;
+            }
+            if (e.type == FIELD && (e.arg2 < 0 || e.arg1 < e.arg2 || e.arg1 > 127 || e.arg1 - e.arg2 > 63)) {
+                return false;
+            }
+            if (e.type == VALUE && RegTable::Entries[i-1].type == REG) {
+                return false;
+            }
         }
-    },
+        return true;
+    }
+    static_assert(CheckEntries(), "invalid register description table");
+
+    // Pools of all values, all bitfields and all registers, in the order of the table.
+    constexpr size_t NameCount = CountEntries(VALUE);
+    constexpr size_t FieldCount = CountEntries(FIELD);
+    constexpr size_t RegisterCount = CountEntries(REG);
+
+    constexpr std::array<RegView::Name, NameCount> BuildNames()
     {
-        "SCTLR_EL1", CSR_REGID_SCTLR_EL1, READ | WRITE,
-        {
-            {"TIDCP",     63, 63, {{0, "none"}, {1, "trap EL0 access to system registers"}}},
-            {"SPINTMASK", 62, 62, {{0, "none"}, {1, "SPINTMASK"}}},
-            {"NMI",       61, 61, {{0, "none"}, {1, "NMI"}}},
-            {"EnTP2",     60, 60, {{0, "none"}, {1, "EnTP2"}}},
-            {"TCSO",      59, 59, {{0, "none"}, {1, "unchecked"}}},
-            {"TCSO0",     58, 58, {{0, "none"}, {1, "unchecked"}}},
-            {"EPAN",      57, 57, {{0, "none"}, {1, "EPAN"}}},
-            {"EnALS",     56, 56, {{0, "none"}, {1, "EnALS"}}},
-            {"EnAS0",     55, 55, {{0, "none"}, {1, "EnAS0"}}},
-            {"EnASR",     54, 54, {{0, "none"}, {1, "EnASR"}}},
-            {"TME",       53, 53, {{0, "none"}, {1, "TME"}}},
-            {"TME0",      52, 52, {{0, "none"}, {1, "TME0"}}},
-            {"TMT",       51, 51, {{0, "none"}, {1, "TMT"}}},
-            {"TMT0",      50, 50, {{0, "none"}, {1, "TMT0"}}},
-            {"TWEDEL",    49, 46, {{0, "none"}, {1, "TWEDEL"}}},
-            {"TWEDEn",    45, 45, {{0, "none"}, {1, "TWEDEn"}}},
-            {"DSSBS",     44, 44, {{0, "none"}, {1, "DSSBS"}}},
-            {"ATA",       43, 43, {{0, "none"}, {1, "ATA"}}},
-            {"ATA0",      42, 42, {{0, "none"}, {1, "ATA0"}}},
-            {"TCF",       41, 40, {{0, "none"}, {1, "TCF"}}},
-            {"TCF0",      39, 38, {{0, "none"}, {1, "TCF0"}}},
-            {"ITFSB",     37, 37, {{0, "none"}, {1, "ITFSB"}}},
-            {"BT1",       36, 36, {{0, "BTI at EL1: PACIxSP is compatible with BTYPE:11"},
-                                   {1, "BTI at EL1: PACIxSP NOT compatible with BTYPE:11"}}},
-            {"BT0",       35, 35, {{0, "BTI at EL0: PACIxSP is compatible with BTYPE:11"},
-                                   {1, "BTI at EL0: PACIxSP NOT compatible with BTYPE:11"}}},
-            {"MSCEn",     33, 33, {{0, "none"}, {1, "MSCEn"}}},
-            {"CMOW",      32, 32, {{0, "none"}, {1, "CMOW"}}},
-            {"EnIA",      31, 31, {{0, "PACIA key NOT enabled"}, {1, "PACIA key enabled"}}},
-            {"EnIB",      30, 30, {{0, "PACIB key NOT enabled"}, {1, "PACIB key enabled"}}},
-            {"LSMAOE",    29, 29, {{0, "none"}, {1, "LSMAOE"}}},
-            {"nTLSMD",    28, 28, {{0, "none"}, {1, "nTLSMD"}}},
-            {"EnDA",      27, 27, {{0, "PACDA key NOT enabled"}, {1, "PACDA key enabled"}}},
-            {"UCI",       26, 26, {{0, "none"}, {1, "UCI"}}},
-            {"EE",        25, 25, {{0, "TT EL1 is little endian"}, {1, "TT EL1 is big endian"}}},
-            {"E0E",       24, 24, {{0, "EL0 data access is little endian"}, {1, "EL0 data access is big endian"}}},
-            {"SPAN",      23, 23, {{0, "none"}, {1, "SPAN"}}},
-            {"EIS",       22, 22, {{0, "none"}, {1, "EIS"}}},
-            {"IESB",      21, 21, {{0, "none"}, {1, "IESB"}}},
-            {"TSCTX",     20, 20, {{0, "none"}, {1, "TSCTX"}}},
-            {"WXN",       19, 19, {{0, "none"}, {1, "WXN"}}},
-            {"nTWE",      18, 18, {{0, "none"}, {1, "nTWE"}}},
-            {"nTWI",      16, 16, {{0, "none"}, {1, "nTWI"}}},
-            {"UCT",       15, 15, {{0, "none"}, {1, "UCT"}}},
-            {"DZE",       14, 14, {{0, "none"}, {1, "DZE"}}},
-            {"EnDB",      13, 13, {{0, "PACDB key NOT enabled"}, {1, "PACDB key enabled"}}},
-            {"I",         12, 12, {{0, "none"}, {1, "I"}}},
-            {"EOS",       11, 11, {{0, "none"}, {1, "EOS"}}},
-            {"EnRCTX",    10, 10, {{0, "none"}, {1, "EnRCTX"}}},
-            {"UMA",        9,  9, {{0, "none"}, {1, "UMA"}}},
-            {"SED",        8,  8, {{0, "none"}, {1, "SED"}}},
-            {"ITD",        7,  7, {{0, "none"}, {1, "ITD"}}},
-            {"nAA",        6,  6, {{0, "none"}, {1, "nAA"}}},
-            {"CP15BEN",    5,  5, {{0, "none"}, {1, "CP15BEN"}}},
-            {"SA0",        4,  4, {{0, "none"}, {1, "SA0"}}},
-            {"SA",         3,  3, {{0, "none"}, {1, "SA"}}},
-            {"C",          2,  2, {{0, "none"}, {1, "C"}}},
-            {"A",          1,  1, {{0, "none"}, {1, "A"}}},
-            {"M",          0,  0, {{0, "none"}, {1, "M"}}},
+        std::array<RegView::Name, NameCount> names {};
+        size_t count = 0;
+        for (size_t i = 0; i < EntryCount; i++) {
+            if (RegTable::Entries[i].type == VALUE) {
+                names[count++] = RegView::Name{RegTable::Entries[i].value, RegTable::Entries[i].name};
+            }
         }
-    },
-    {
-        "SCTLR2_EL1", CSR_REGID_SCTLR2_EL1, READ | WRITE | NEED_SCTLR2,
-        {
-            {"EnIDCP128",  6,  6, {}},
-            {"EASE",       5,  5, {}},
-            {"EnANERR",    4,  4, {}},
-            {"EnADERR",    3,  3, {}},
-            {"NMEA",       2,  2, {}},
+        return names;
+    }
+    constexpr auto AllNames = BuildNames();
+
+    constexpr std::array<RegView::BitField, FieldCount> BuildFields()
+    {
+        std::array<RegView::BitField, FieldCount> fields {};
+        size_t count = 0;
+        size_t first_name = 0;
+        for (size_t i = 0; i < EntryCount; i++) {
+            const Entry& e(RegTable::Entries[i]);
+            if (e.type == FIELD) {
+                const size_t name_count = CountFollowing(i + 1, VALUE);
+                fields[count++] = RegView::BitField{e.name, e.arg1, e.arg2, Span<RegView::Name>(AllNames.data() + first_name, name_count)};
+                first_name += name_count;
+            }
         }
-    },
-    {
-        "SCXTNUM_EL0", CSR_REGID_SCXTNUM_EL0, READ | WRITE | NEED_CSV2_2, {}
-    },
-    {
-        "SCXTNUM_EL1", CSR_REGID_SCXTNUM_EL1, READ | WRITE | NEED_CSV2_2, {}
-    },
-    {
-        "TCR_EL1", CSR_REGID_TCR_EL1, READ,
-        {
-            {"MTX1",   61, 61, {{0, "none"}, {1, "logical address tag"}}},
-            {"MTX0",   60, 60, {{0, "none"}, {1, "logical address tag"}}},
-            {"DS",     59, 59, {{0, "48-bit addresses"}, {1, "52-bit addresses"}}},
-            {"TCMA1",  58, 58, {{0, "none"}, {1, "unchecked"}}},
-            {"TCMA0",  57, 57, {{0, "none"}, {1, "unchecked"}}},
-            {"E0PD1",  56, 56, {{0, "none"}, {1, "fault"}}},
-            {"E0PD0",  55, 55, {{0, "none"}, {1, "fault"}}},
-            {"NFD1",   54, 54, {{0, "none"}, {1, "stage 1 disabled"}}},
-            {"NFD0",   53, 53, {{0, "none"}, {1, "stage 1 disabled"}}},
-            {"TBID1",  52, 52, {{0, "instr+data"}, {1, "data"}}},
-            {"TBID0",  51, 51, {{0, "instr+data"}, {1, "data"}}},
-            {"HWU162", 50, 50, {{0, "bit62-reserved"}, {1, "bit62-impl-def"}}},
-            {"HWU161", 49, 49, {{0, "bit61-reserved"}, {1, "bit61-impl-def"}}},
-            {"HWU160", 48, 48, {{0, "bit60-reserved"}, {1, "bit60-impl-def"}}},
-            {"HWU159", 47, 47, {{0, "bit59-reserved"}, {1, "bit59-impl-def"}}},
-            {"HWU062", 46, 46, {{0, "bit62-reserved"}, {1, "bit62-impl-def"}}},
-            {"HWU061", 45, 45, {{0, "bit61-reserved"}, {1, "bit61-impl-def"}}},
-            {"HWU060", 44, 44, {{0, "bit60-reserved"}, {1, "bit60-impl-def"}}},
-            {"HWU059", 43, 43, {{0, "bit59-reserved"}, {1, "bit59-impl-def"}}},
-            {"HPD1",   42, 42, {{0, "enabled"}, {1, "disabled"}}},
-            {"HPD0",   41, 41, {{0, "enabled"}, {1, "disabled"}}},
-            {"HD",     40, 40, {{0, "disabled"}, {1, "enabled"}}},
-            {"HA",     39, 39, {{0, "disabled"}, {1, "enabled"}}},
-            {"TBI1",   38, 38, {{0, "used"}, {1, "ignored"}}},
-            {"TBI0",   37, 37, {{0, "used"}, {1, "ignored"}}},
-            {"AS",     36, 36, {{0, "ignored"}, {1, "used"}}},
-            {"IPS",    34, 32, {{0, "32 bits, 4GB"}, {1, "36 bits, 64 GB"}, {2, "40 bits, 1 TB"}, {3, "42 bits, 4 TB"},
-                                {4, "44 bits, 16 TB"}, {5, "48 bits, 256 TB"}, {6, "52 bits, 4 PB"}}},
-            {"TG1",    31, 30, {{1, "16 kB"}, {2, "4 kB"}, {3, "64 kB"}}},
-            {"SH1",    29, 28, {{0, "Non shareable"}, {2, "Outer shareable"}, {3, "Inner shareable"}}},
-            {"ORGN1",  27, 26, {{0, "Normal memory, Outer Non-cacheable"},
-                                {1, "Normal memory, Outer Write-Back Read-Allocate Write-Allocate Cacheable"},
-                                {2, "Normal memory, Outer Write-Through Read-Allocate No Write-Allocate Cacheable"},
-                                {3, "Normal memory, Outer Write-Back Read-Allocate No Write-Allocate Cacheable"}}},
-            {"IRGN1",  25, 24, {{0, "Normal memory, Inner Non-cacheable"},
-                                {1, "Normal memory, Inner Write-Back Read-Allocate Write-Allocate Cacheable"},
-                                {2, "Normal memory, Inner Write-Through Read-Allocate No Write-Allocate Cacheable"},
-                                {3, "Normal memory, Inner Write-Back Read-Allocate No Write-Allocate Cacheable"}}},
-            {"EPD1",   23, 23, {{0, "Translation table walks using TTBR1_EL1"},
-                                {1, "TLB miss using TTBR1_EL1 generates a Translation fault"}}},
-            {"A1",     22, 22, {{0, "TTBR0_EL1.ASID defines the ASID"},
-                                {1, "TTBR1_EL1.ASID defines the ASID"}}},
-            {"T1SZ",   21, 16, {}},
-            {"TG0",    15, 14, {{0, "4 kB"}, {1, "64 kB"}, {2, "16 kB"}}},
-            {"SH0",    13, 12, {{0, "Non shareable"}, {2, "Outer shareable"}, {3, "Inner shareable"}}},
-            {"ORGN0",  11, 10, {{0, "Normal memory, Outer Non-cacheable"},
-                                {1, "Normal memory, Outer Write-Back Read-Allocate Write-Allocate Cacheable"},
-                                {2, "Normal memory, Outer Write-Through Read-Allocate No Write-Allocate Cacheable"},
-                                {3, "Normal memory, Outer Write-Back Read-Allocate No Write-Allocate Cacheable"}}},
-            {"IRGN0",   9,  8, {{0, "Normal memory, Inner Non-cacheable"},
-                                {1, "Normal memory, Inner Write-Back Read-Allocate Write-Allocate Cacheable"},
-                                {2, "Normal memory, Inner Write-Through Read-Allocate No Write-Allocate Cacheable"},
-                                {3, "Normal memory, Inner Write-Back Read-Allocate No Write-Allocate Cacheable"}}},
-            {"EPD0",    7,  7, {{0, "Translation table walks using TTBR0_EL1"},
-                                {1, "TLB miss using TTBR0_EL1 generates a Translation fault"}}},
-            {"T0SZ",    5,  0, {}},
+        return fields;
+    }
+    constexpr auto AllFields = BuildFields();
+
+    constexpr std::array<RegView::Register, RegisterCount> BuildRegisters()
+    {
+        std::array<RegView::Register, RegisterCount> regs {};
+        size_t count = 0;
+        size_t first_field = 0;
+        for (size_t i = 0; i < EntryCount; i++) {
+            const Entry& e(RegTable::Entries[i]);
+            if (e.type == REG) {
+                // Count the bitfields until next register.
+                size_t field_count = 0;
+                for (size_t j = i + 1; j < EntryCount && RegTable::Entries[j].type != REG; j++) {
+                    field_count += RegTable::Entries[j].type == FIELD;
+                }
+                regs[count++] = RegView::Register{e.name, e.arg1, e.arg2, Span<RegView::BitField>(AllFields.data() + first_field, field_count)};
+                first_field += field_count;
+            }
         }
-    },
+        return regs;
+    }
+    constexpr auto AllRegistersPool = BuildRegisters();
+
+    // Index of registers in AllRegistersPool, by csr_index. Unused csr_index values are -1.
+    constexpr std::array<int, _CSR_REGID2_END> BuildIndexTable()
     {
-        "TCR2_EL1", CSR_REGID_TCR2_EL1, READ | NEED_TCR2,
-        {
-            {"DisCH1", 15, 15, {}},
-            {"DisCH0", 14, 14, {}},
-            {"HAFT",   11, 11, {}},
-            {"PTTWI",  10, 10, {}},
-            {"D128",    5,  5, {}},
-            {"AIE",     4,  4, {}},
-            {"POE",     3,  3, {}},
-            {"E0POE",   2,  2, {}},
-            {"PIE",     1,  1, {}},
-            {"PnCH",    0,  0, {}},
+        std::array<int, _CSR_REGID2_END> index {};
+        for (auto& i : index) {
+            i = -1;
         }
-    },
-    {
-        "TPIDRRO_EL0", CSR_REGID_TPIDRRO_EL0, READ_TPIDR | WRITE_TPIDR, {}
-    },
-    {
-        "TPIDR_EL0", CSR_REGID_TPIDR_EL0, READ_TPIDR | WRITE_TPIDR, {}
-    },
-    {
-        "TPIDR_EL1", CSR_REGID_TPIDR_EL1, READ_TPIDR | WRITE_TPIDR, {}
-    },
-    {
-        "TTBR0_EL1", CSR_REGID_TTBR0_EL1, READ,
-        {
-            {"ASID",  63, 48, {}},
-            {"BADDR", 47,  1, {}},
-            {"CnP",    0,  0, {{0, "differ"}, {1, "common"}}},
+        for (size_t i = 0; i < RegisterCount; i++) {
+            index[size_t(AllRegistersPool[i].csr_index)] = int(i);
         }
-    },
-    {
-        "TTBR1_EL1", CSR_REGID_TTBR1_EL1, READ,
-        {
-            {"ASID",  63, 48, {}},
-            {"BADDR", 47,  1, {}},
-            {"CnP",    0,  0, {{0, "differ"}, {1, "common"}}},
+        return index;
+    }
+    constexpr auto RegistersByIndex = BuildIndexTable();
+
+    // Index of registers in AllRegistersPool, sorted by name, case insensitive.
+    constexpr std::array<int, RegisterCount> BuildNameTable()
+    {
+        std::array<int, RegisterCount> index {};
+        for (size_t i = 0; i < RegisterCount; i++) {
+            // Insertion sort, this is only done at compile time.
+            size_t j = i;
+            while (j > 0 && CompareNames(AllRegistersPool[size_t(index[j-1])].name, AllRegistersPool[i].name) > 0) {
+                index[j] = index[j-1];
+                j--;
+            }
+            index[j] = int(i);
         }
-    },
+        return index;
+    }
+    constexpr auto RegistersByName = BuildNameTable();
+
+    // Check that each register is described only once.
+    constexpr bool CheckUniqueRegisters()
     {
-        "TRCDEVARCH", CSR_REGID_TRCDEVARCH, READ | NEED_ETE,
-        {
-            {"ARCHITECT", 31, 21, {}},
-            {"PRESENT",   20, 20, {{0, "not present"}, {1, "present"}}},
-            {"REVISION",  19, 16, {{0, "ETEv1.0"}, {1, "ETEv1.1"}, {2, "ETEv1.2"}}},
-            {"ARCHVER",   15, 12, {{5, "ETEv1"}}},
-            {"ARCHPART",  11,  0, {{0xA13, "Arm PE trace architecture"}}},
+        size_t used = 0;
+        for (int i : RegistersByIndex) {
+            used += i >= 0;
         }
-    },
-};
-
-
-//----------------------------------------------------------------------------
-// Initialize AllRegistersByIndex and AllRegistersByName.
-//----------------------------------------------------------------------------
-
-void RegView::initializeCache()
-{
-    if (AllRegistersByIndex.empty() || AllRegistersByName.empty()) {
-        for (const auto& reg : AllRegisters) {
-            AllRegistersByIndex[reg.csr_index] = reg;
-            AllRegistersByName[ToUpper(reg.name)] = reg;
+        for (size_t i = 1; i < RegisterCount; i++) {
+            if (CompareNames(AllRegistersPool[size_t(RegistersByName[i-1])].name, AllRegistersPool[size_t(RegistersByName[i])].name) == 0) {
+                return false;
+            }
         }
+        return used == RegisterCount;
     }
+    static_assert(CheckUniqueRegisters(), "duplicate register in description table");
+
+    // A dummy empty description.
+    constexpr RegView::Register EmptyRegister {"", RegView::INVALID, 0, {}};
 }
 
+const Span<RegView::Register> RegView::AllRegisters(AllRegistersPool);
+
 
 //----------------------------------------------------------------------------
 // Get the description of register by its csr_index or name.
@@ -1195,16 +1110,32 @@ void RegView::initializeCache()
 
 const RegView::Register& RegView::getRegister(int csr_index)
 {
-    initializeCache();
-    const auto iter(AllRegistersByIndex.find(csr_index));
-    return iter == AllRegistersByIndex.end() ? EmptyRegister : iter->second;
+    if (csr_index < 0 || size_t(csr_index) >= RegistersByIndex.size() || RegistersByIndex[size_t(csr_index)] < 0) {
+        return EmptyRegister;
+    }
+    return AllRegistersPool[size_t(RegistersByIndex[size_t(csr_index)])];
 }
 
-const RegView::Register& RegView::getRegister(const std::string& name)
+const RegView::Register& RegView::getRegister(std::string_view name)
 {
-    initializeCache();
-    const auto iter(AllRegistersByName.find(ToUpper(name)));
-    return iter == AllRegistersByName.end() ? EmptyRegister : iter->second;
+    // Binary search in the sorted index.
+    size_t low = 0;
+    size_t high = RegistersByName.size();
+    while (low < high) {
+        const size_t mid = (low + high) / 2;
+        const Register& reg(AllRegistersPool[size_t(RegistersByName[mid])]);
+        const int cmp = CompareNames(reg.name, name);
+        if (cmp == 0) {
+            return reg;
+        }
+        else if (cmp < 0) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return EmptyRegister;
 }
 
 
@@ -1222,6 +1153,38 @@ std::string RegView::Register::hexa(const csr_pair_t& value) const
     return isPair() ? ToHexa(value) : ToHexa(value.low);
 }
 
+void RegView::Register::appendHexa(std::string& out, const csr_pair_t& value) const
+{
+    if (isPair()) {
+        AppendHexa(out, value);
+    }
+    else {
+        AppendHexa(out, value.low);
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Extract the value of a bitfield and find its description.
+//----------------------------------------------------------------------------
+
+csr_u64_t RegView::Register::fieldValue(const BitField& bf, const csr_pair_t& value)
+{
+    return bf.lsb >= 64 ?
+        ((value.high << (127 - bf.msb)) >> (63 - bf.msb + bf.lsb)) :
+        ((value.low << (63 - bf.msb)) >> (63 - bf.msb + bf.lsb));
+}
+
+const RegView::Name* RegView::Register::findValue(const BitField& bf, csr_u64_t bfval)
+{
+    for (const auto& nm : bf.values) {
+        if (nm.value == bfval) {
+            return &nm;
+        }
+    }
+    return nullptr;
+}
+
 
 //----------------------------------------------------------------------------
 // Display a detailed descriptions of one register value.
@@ -1237,17 +1200,32 @@ void RegView::Register::display(std::ostream& out, csr_u64_t value) const
 
 void RegView::Register::display(std::ostream& out, const csr_pair_t& value) const
 {
+    std::string buffer;
+    display(out, value, buffer);
+}
+
+void RegView::Register::display(std::ostream& out, const csr_pair_t& value, std::string& buffer) const
+{
+    // The complete description is built in the buffer and written at once.
+    buffer.clear();
+
     // Print the register content as a suite of 4-bit binary values.
-    out << name << ": ";
+    buffer.append(name);
+    buffer.append(": ");
     if (isPair()) {
-        out << ToBinary(value.high) << std::endl << std::string(name.length() + 2, ' ');
+        AppendBinary(buffer, value.high);
+        buffer.append(1, '\n');
+        buffer.append(name.length() + 2, ' ');
     }
-    out << ToBinary(value.low) << std::endl << std::endl;
+    AppendBinary(buffer, value.low);
+    buffer.append("\n\n");
 
     // Print the details of the register content.
     if (fields.empty()) {
         // No bitfield defined, just display the value in hexadecimal.
-        out << "  Value: " << hexa(value) << std::endl;
+        buffer.append("  Value: ");
+        appendHexa(buffer, value);
+        buffer.append(1, '\n');
     }
     else {
         // Print the various bit fields.
@@ -1257,23 +1235,30 @@ void RegView::Register::display(std::ostream& out, const csr_pair_t& value) cons
         }
         for (const auto& bf : fields) {
             // Value of the bitfield.
-            const csr_u64_t bfval = bf.lsb >= 64 ?
-                ((value.high << (127 - bf.msb)) >> (63 - bf.msb + bf.lsb)) :
-                ((value.low << (63 - bf.msb)) >> (63 - bf.msb + bf.lsb));
+            const csr_u64_t bfval = fieldValue(bf, value);
+            // Print the bitfield description.
+            buffer.append("  ");
+            buffer.append(bf.name);
+            buffer.append(1, ':');
+            buffer.append(name_width - bf.name.length(), ' ');
+            buffer.append(" 0x");
+            AppendHexaDigits(buffer, bfval, (bf.msb - bf.lsb) / 4 + 1);
+            buffer.append(" (");
             // Look for a name for this value.
-            std::string valname(bf.values.empty() ? Format("%lld", bfval) : "reserved");
-            for (const auto& nm : bf.values) {
-                if (nm.value == bfval) {
-                    valname = nm.name;
-                    break;
-                }
+            const Name* valname = findValue(bf, bfval);
+            if (valname != nullptr) {
+                buffer.append(valname->name);
             }
-            // Print the bitfield description.
-            const int hexwidth = (bf.msb - bf.lsb) / 4 + 1;
-            out << "  " << Pad(bf.name + ":", name_width + 1, ' ')
-                << " " << Format("0x%0*llX", hexwidth, bfval) << " (" << valname << ")" << std::endl;
+            else if (bf.values.empty()) {
+                AppendDecimal(buffer, static_cast<long long>(bfval));
+            }
+            else {
+                buffer.append("reserved");
+            }
+            buffer.append(")\n");
         }
     }
+    out.write(buffer.data(), std::streamsize(buffer.size()));
 }
 
 
@@ -1290,3 +1275,13 @@ bool RegView::Register::canWrite(RegAccess& ra) const
 {
     return (features & RegView::WRITE) && isSupported(ra);
 }
+
+bool RegView::Register::canRead(const ArmFeatures& feat) const
+{
+    return (features & RegView::READ) && isSupported(feat);
+}
+
+bool RegView::Register::canWrite(const ArmFeatures& feat) const
+{
+    return (features & RegView::WRITE) && isSupported(feat);
+}
@@ -11,29 +11,32 @@
 #pragma once
 #include "cpusysregs.h"
 #include "regaccess.h"
+#include "armfeatures.h"
+#include "span.h"
 #include <ostream>
 #include <string>
-#include <list>
-#include <map>
+#include <string_view>
 
 //
 // A class with static fields to describe Arm64 system registers.
+// All descriptions are constant tables which are built at compile time.
+// There is no initialization and no heap allocation at run time.
 //
 class RegView
 {
 public:
     // Description of one value in a bitfield in a register.
     struct Name {
-        csr_u64_t   value;
-        std::string name;
+        csr_u64_t        value;
+        std::string_view name;
     };
 
     // Description of one bit-field in a register.
     struct BitField {
-        std::string     name;    // bitfield name
-        int             msb;     // most significant bit index
-        int             lsb;     // least significant bit index
-        std::list<Name> values;  // known values, end with a NULL name
+        std::string_view name;    // bitfield name
+        int              msb;     // most significant bit index
+        int              lsb;     // least significant bit index
+        Span<Name>       values;  // known values
     };
 
     // Define the properties and condition of existence of a register.
@@ -60,10 +63,10 @@ public:
     class Register
     {
     public:
-        std::string         name;       // register name
+        std::string_view    name;       // register name
         int                 csr_index;  // CSR_REGID_ or CSR_REGID2_ value from cpusysregs.h
         int                 features;   // required features (bit mask)
-        std::list<BitField> fields;     // known bitfields
+        Span<BitField>      fields;     // known bitfields
 
         // Get a string version of the features field.
         std::string featuresList() const;
@@ -77,35 +80,37 @@ public:
         // Format an hexa value of the register.
         std::string hexa(csr_u64_t value) const;
         std::string hexa(const csr_pair_t& value) const;
+        void appendHexa(std::string& out, const csr_pair_t& value) const;
+
+        // Extract the value of a bitfield and find its description (null if none).
+        static csr_u64_t fieldValue(const BitField& bf, const csr_pair_t& value);
+        static const Name* findValue(const BitField& bf, csr_u64_t bfval);
 
         // Display a detailed descriptions of one register value.
         void display(std::ostream& out, csr_u64_t value) const;
         void display(std::ostream& out, const csr_pair_t& value) const;
 
+        // Same as display(), using a reusable buffer to avoid heap allocations on successive calls.
+        void display(std::ostream& out, const csr_pair_t& value, std::string& buffer) const;
+
         // Check if the register is supported on this CPU.
+        // Use the ArmFeatures versions when checking many registers, to load the CPU features only once.
         bool isSupported(RegAccess&) const;
         bool canRead(RegAccess&) const;
         bool canWrite(RegAccess&) const;
+        bool isSupported(const ArmFeatures&) const;
+        bool canRead(const ArmFeatures&) const;
+        bool canWrite(const ArmFeatures&) const;
     };
 
     // This value of 'csr_index' fields indicates an invalid register description.
     static constexpr int INVALID = ~0;
 
     // Descriptions of all known registers.
-    static const std::list<Register> AllRegisters;
+    static const Span<Register> AllRegisters;
 
     // Get the description of register by its csr_index or name (case insensitive).
+    // Return an invalid description if not found.
     static const Register& getRegister(int csr_index);
-    static const Register& getRegister(const std::string& name);
-
-private:
-    // A dummy empty description.
-    static const Register EmptyRegister;
-
-    // Map view of AllRegisters, indexed by CMD_REG_ values and names.
-    static std::map<int, Register> AllRegistersByIndex;
-    static std::map<std::string, Register> AllRegistersByName;
-
-    // Initialize AllRegistersByIndex and AllRegistersByName.
-    static void initializeCache();
+    static const Register& getRegister(std::string_view name);
 };
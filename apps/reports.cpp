@@ -0,0 +1,481 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Standard text reports on the CPU, shared by sysregs, collect and the demo programs.
+//
+//----------------------------------------------------------------------------
+
+#include "reports.h"
+#include "armpseudocode.h"
+#include "granuleplanner.h"
+#include "regview.h"
+#include "cacheinfo.h"
+#include "userfeatures.h"
+#include "hwcaps.h"
+#include "strutils.h"
+#include <iostream>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+#if defined(__APPLE__)
+    #include <sys/types.h>
+    #include <sys/sysctl.h>
+#endif
+
+
+//----------------------------------------------------------------------------
+// Summary of CPU features.
+//----------------------------------------------------------------------------
+
+void FeaturesReport(std::ostream& out, const ArmFeatures& features, RegRecordWriter* records)
+{
+    if (records != nullptr) {
+        for (size_t i = 0; i < size_t(ArmFeature::Count); i++) {
+            records->writeFeature(ArmFeature(i), features.has(ArmFeature(i)));
+        }
+        return;
+    }
+
+    size_t name_width = 0;
+    for (size_t i = 0; i < size_t(ArmFeature::Count); i++) {
+        name_width = std::max(name_width, FeatureSet::name(ArmFeature(i)).length());
+    }
+    for (size_t i = 0; i < size_t(ArmFeature::Count); i++) {
+        out << Pad(std::string(FeatureSet::name(ArmFeature(i))) + " ", name_width + 2) << " " << YesNo(features.has(ArmFeature(i))) << std::endl;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Latency of the paths to read the identification registers.
+//----------------------------------------------------------------------------
+
+void RegSourceReport(std::ostream& out, const RegSource& source)
+{
+    out << std::endl << Format("%-24s %10s %10s  %s", "Register", "Kernel ns", "EL0 ns", "Selected path") << std::endl;
+    for (const auto& probe : source.probes()) {
+        const RegView::Register& desc(RegView::getRegister(probe.regid));
+        const std::string name(desc.isValid() ? std::string(desc.name) : Format("regid %d", probe.regid));
+        const std::string kernel(probe.kernel_ok ? Format("%'" PRIu64, uint64_t(probe.kernel_ns)) : std::string("-"));
+        const std::string direct(probe.direct_ok ? Format("%'" PRIu64, uint64_t(probe.direct_ns)) : std::string("-"));
+        std::string path(probe.path == RegSource::DIRECT ? "EL0 (MRS emulation)" : "kernel");
+        if (probe.path == RegSource::KERNEL && probe.snapshot) {
+            path += " (snapshot)";
+        }
+        if (probe.masked) {
+            path += ", EL0 value masked";
+        }
+        out << Format("%-24s %10s %10s  %s", name.c_str(), kernel.c_str(), direct.c_str(), path.c_str()) << std::endl;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Summary of PAC features.
+//----------------------------------------------------------------------------
+
+namespace {
+    void PACLayout(ArmPseudoCode& code, std::ostream& out, bool upper, bool is_instr)
+    {
+        const csr_u64_t address = upper ? ~0ull : 0;
+        const int top = code.pacTopBit(address, is_instr);
+        const int sel = code.pacSelBit(address, is_instr);
+        const int bottom = code.pacBottomBit(address, is_instr);
+
+        std::string layout;
+        if (bottom < 55 && 55 < top) {
+            layout = Format("%d:56,54:%d", top, bottom);
+        }
+        else {
+            layout = Format("%d:%d", top == 55 ? 54 : top, bottom == 55 ? 56 : bottom);
+        }
+
+        out << Format("  %-5s (%s): PAC size: %2d bits, bit range: %11s (top: %2d, sel: %2d, bottom: %2d)",
+                      is_instr ? "Instr" : "Data", upper ? "upper" : "lower",
+                      code.pacSize(address, is_instr), layout.c_str(), top, sel, bottom)
+            << std::endl;
+    }
+}
+
+void PACReport(std::ostream& out, RegAccess& regs, const ArmFeatures& feat)
+{
+    out << std::endl
+        << "Summary: PAC: " << YesNo(feat.FEAT_PAuth())
+        << ", PACGA: " << YesNo(feat.hasPACGA())
+        << std::endl
+        << "PAuth: " << YesNo(feat.FEAT_PAuth())
+        << ", PAuth2: " << YesNo(feat.FEAT_PAuth2())
+        << ", EPAC: " << YesNo(feat.FEAT_EPAC())
+        << ", FPAC: " << YesNo(feat.FEAT_FPAC())
+        << ", FPACCOMBINE: " << YesNo(feat.FEAT_FPACCOMBINE())
+        << ", CONSTPACFIELD: " << YesNo(feat.FEAT_CONSTPACFIELD())
+        << std::endl
+        << "Algorithms: QARMA3: " << YesNo(feat.FEAT_PACQARMA3())
+        << ", QARMA5: " << YesNo(feat.FEAT_PACQARMA5())
+        << ", implementation-defined: " << YesNo(feat.FEAT_PACIMP())
+        << std::endl
+        << "Memory tagging: " << YesNo(feat.addressTaggingEnabled()) << std::endl;
+    if (feat.FEAT_PAuth()) {
+        ArmPseudoCode code(regs, feat);
+        out << "Detailed PAC layout:" << std::endl
+            << "  TCR_EL1: TBI0=" << feat.TCR_EL1_TBI0()
+            << ", TBID0=" << feat.TCR_EL1_TBID0()
+            << ", T0SZ=" << feat.TCR_EL1_T0SZ()
+            << ", TBI1=" << feat.TCR_EL1_TBI1()
+            << ", TBID1=" << feat.TCR_EL1_TBID1()
+            << ", T1SZ=" << feat.TCR_EL1_T1SZ()
+            << std::endl;
+        PACLayout(code, out, false, false);
+        PACLayout(code, out, true, false);
+        PACLayout(code, out, false, true);
+        PACLayout(code, out, true, true);
+    }
+    out << std::endl;
+}
+
+
+//----------------------------------------------------------------------------
+// All readable system registers.
+//----------------------------------------------------------------------------
+
+void RegistersReport(std::ostream& out, RegAccess& regaccess, const ArmFeatures& features, bool verbose, RegRecordWriter* records, const std::string& command)
+{
+    size_t name_width = 0;
+    if (!verbose && records == nullptr) {
+        for (const auto& desc : RegView::AllRegisters) {
+            name_width = std::max(name_width, desc.name.length());
+        }
+        out << std::endl;
+    }
+
+    // Collect all registers which are readable and compatible with the CPU features.
+    std::vector<const RegView::Register*> descs;
+    std::vector<csr_multi_reg_t> regs;
+    for (const auto& desc : RegView::AllRegisters) {
+        if (desc.canRead(features)) {
+            descs.push_back(&desc);
+            regs.push_back(csr_multi_reg_t{csr_u64_t(desc.csr_index), 0, {0, 0}});
+        }
+    }
+
+    // Read all registers at once and display them.
+    // The same formatting buffer is reused for all registers.
+    std::string buffer;
+    if (regaccess.readMany(regs)) {
+        for (size_t i = 0; i < regs.size(); i++) {
+            const RegView::Register& desc(*descs[i]);
+            if (records != nullptr) {
+                records->writeRegister(desc, regs[i].value, -1, int(regs[i].status));
+            }
+            else if (regs[i].status != 0) {
+                std::cerr << command << ": error reading " << desc.name << ": "
+                          << (regs[i].status == 2 ? "CPU feature not supported" : "unknown register") << std::endl;
+            }
+            else if (verbose) {
+                out << std::endl;
+                desc.display(out, regs[i].value, buffer);
+            }
+            else {
+                buffer.clear();
+                AppendPad(buffer, desc.name, name_width, ' ');
+                buffer.append("  ");
+                desc.appendHexa(buffer, regs[i].value);
+                buffer.append(1, '\n');
+                out.write(buffer.data(), std::streamsize(buffer.size()));
+            }
+        }
+    }
+    if (records == nullptr) {
+        out << std::endl;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// CPU topology.
+//----------------------------------------------------------------------------
+
+void TopologyReport(std::ostream& out, const CpuTopology& topology)
+{
+    if (!topology.perCore()) {
+        out << "Warning: registers not read on each CPU core, assuming identical cores" << std::endl;
+    }
+    out << "CPU   MIDR_EL1    MPIDR_EL1         Aff3.2.1.0   Line  Class  Cluster  Core" << std::endl;
+    for (const auto& cpu : topology.cpus()) {
+        if (!cpu.online) {
+            out << Format("%3zu   offline", cpu.index) << std::endl;
+            continue;
+        }
+        const CpuTopology::CoreClass& cl(topology.classes()[cpu.coreClass]);
+        out << Format("%3zu   0x%08X  0x%010" PRIX64 "  %3d.%d.%d.%d %6zu  %5zu  %7zu  %s r%dp%d",
+                      cpu.index, int(cpu.midr), uint64_t(cpu.mpidr),
+                      cpu.affinity(3), cpu.affinity(2), cpu.affinity(1), cpu.affinity(0),
+                      cpu.dataLineSize(), cpu.coreClass, cpu.cluster, cl.name.c_str(), cpu.variant(), cpu.revision())
+            << std::endl;
+    }
+
+    static const char* const tiers[] = {"efficiency", "balanced", "performance", "prime"};
+    out << std::endl;
+    for (size_t i = 0; i < topology.classes().size(); i++) {
+        const CpuTopology::CoreClass& cl(topology.classes()[i]);
+        out << "Class " << i << ": " << cl.name << " (" << tiers[cl.tier] << "), CPU " << CpuTopology::cpuList(cl.cpus) << std::endl;
+        const CacheInfo caches(nullptr, topology.perCore() && !cl.cpus.empty() ? cl.cpus.front() : CSR_CPU_ANY);
+        for (const auto& cache : caches.caches()) {
+            out << "  " << cache.toString() << std::endl;
+        }
+    }
+    for (size_t i = 0; i < topology.clusters().size(); i++) {
+        out << "Cluster " << i << ": CPU " << CpuTopology::cpuList(topology.clusters()[i].cpus) << std::endl;
+    }
+    out << "Fastest class: CPU " << CpuTopology::cpuList(topology.fastestClass()) << std::endl;
+}
+
+
+//----------------------------------------------------------------------------
+// Translation granules and TLB reach.
+//----------------------------------------------------------------------------
+
+namespace {
+    void WalkReport(std::ostream& out, const GranulePlanner::Walk& walk, csr_u64_t working_set, csr_u64_t tlb_entries)
+    {
+        out << "  Levels: " << walk.levelCount() << " (" << walk.startLevel() << " to 3)"
+            << ", DS: " << walk.ds << ", D128: " << walk.d128 << ", HPD: " << walk.hpd << std::endl
+            << "  Level   Entry size  Entries  Descriptors  Contiguous range" << std::endl;
+        for (const auto& lv : walk.levels) {
+            out << Format("  %5d  %11s  %7" PRIu64 "  %-11s  %s", lv.level, GranulePlanner::sizeString(lv.size).c_str(), uint64_t(lv.entries),
+                          lv.level == 3 ? "page" : (lv.leaf ? "block/table" : "table"),
+                          lv.contiguous == 0 ? "-" : Format("%zu entries, %s", lv.contiguous, GranulePlanner::sizeString(lv.size * lv.contiguous).c_str()).c_str())
+                << std::endl;
+        }
+
+        out << "  TLB reach with " << tlb_entries << " entries:" << std::endl;
+        const auto maps(GranulePlanner::mappings(walk));
+        for (const auto& m : maps) {
+            out << "    " << Pad(m.toString() + " ", 48) << " " << GranulePlanner::sizeString(GranulePlanner::tlbReach(m, tlb_entries)) << std::endl;
+        }
+
+        if (working_set > 0) {
+            const auto plans(GranulePlanner::plan(walk, working_set));
+            const size_t best = GranulePlanner::recommend(plans, working_set);
+            out << "  Working set of " << GranulePlanner::sizeString(working_set) << ":" << std::endl;
+            for (size_t i = 0; i < plans.size(); i++) {
+                const GranulePlanner::Plan& p(plans[i]);
+                out << Format("    %-48s %'12" PRIu64 " TLB entries, wasted: %s%s", p.mapping.toString().c_str(), uint64_t(p.tlb_entries),
+                              GranulePlanner::sizeString(p.waste).c_str(), i == best ? " (recommended)" : "")
+                    << std::endl;
+            }
+            if (best < plans.size()) {
+                const GranulePlanner::Plan& p(plans[best]);
+                out << "  Recommended: map with " << p.mapping.toString() << ", align huge pages and arenas on "
+                    << GranulePlanner::sizeString(p.mapping.size) << ", "
+                    << (p.tlb_entries <= tlb_entries ? "fits" : "exceeds") << " the TLB reach" << std::endl;
+            }
+        }
+    }
+}
+
+void TranslationReport(std::ostream& out, RegAccess& regs, const ArmFeatures& feat, csr_u64_t working_set, csr_u64_t tlb_entries)
+{
+    ArmPseudoCode code(regs, feat);
+    GranulePlanner planner(code, feat);
+    static const GranulePlanner::TGx granules[] = {ArmPseudoCode::TGx_4KB, ArmPseudoCode::TGx_16KB, ArmPseudoCode::TGx_64KB};
+
+    out << std::endl << "Supported granules:";
+    for (auto tgx : granules) {
+        out << " " << GranulePlanner::granuleName(tgx) << ": " << YesNo(planner.supported(tgx));
+        if (tgx != ArmPseudoCode::TGx_64KB) {
+            out << " (52-bit: " << YesNo(planner.supportsDS(tgx)) << ")";
+        }
+        out << (tgx == ArmPseudoCode::TGx_64KB ? "" : ",");
+    }
+    out << std::endl
+        << "TTCNP: " << YesNo(feat.FEAT_TTCNP())
+        << ", BBM level: " << feat.ID_AA64MMFR2_EL1_BBM()
+        << ", TLBIRANGE: " << YesNo(feat.FEAT_TLBIRANGE())
+        << ", HPDS: " << YesNo(feat.FEAT_HPDS())
+        << ", LPA: " << YesNo(feat.FEAT_LPA())
+        << ", LPA2: " << YesNo(feat.FEAT_LPA2())
+        << ", D128: " << YesNo(feat.FEAT_D128())
+        << std::endl;
+
+    for (auto range : {ArmPseudoCode::VARange_LOWER, ArmPseudoCode::VARange_UPPER}) {
+        const GranulePlanner::Walk walk(planner.walk(range));
+        const bool lower = range == ArmPseudoCode::VARange_LOWER;
+        out << std::endl << (lower ? "Lower range (TTBR0_EL1, T0SZ=" : "Upper range (TTBR1_EL1, T1SZ=") << walk.txsz << "): "
+            << GranulePlanner::granuleName(walk.tgx) << " granule, " << walk.input_bits << "-bit addresses" << std::endl;
+        WalkReport(out, walk, working_set, tlb_entries);
+    }
+
+    // Same address size as the user space, with the other supported granules.
+    const GranulePlanner::Walk user(planner.walk(ArmPseudoCode::VARange_LOWER));
+    for (auto tgx : granules) {
+        if (tgx != user.tgx && planner.supported(tgx)) {
+            const GranulePlanner::Walk walk(planner.walk(tgx, user.txsz));
+            out << std::endl << "Alternative: " << GranulePlanner::granuleName(tgx) << " granule, " << walk.input_bits << "-bit addresses" << std::endl;
+            WalkReport(out, walk, working_set, tlb_entries);
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Features which are visible in user mode.
+//----------------------------------------------------------------------------
+
+namespace {
+    struct UserFeature {
+        std::string name;                   // Feature name
+        bool (UserFeatures::*get)() const;  // Method to get that feature
+    };
+    const std::vector<UserFeature> AllUserFeatures {
+        // Automatically generated file:
+        #include "_userfeatures.h"
+    };
+}
+
+void UserFeaturesReport(std::ostream& out, RegRecordWriter* records)
+{
+    const UserFeatures& features(UserFeatures::instance());
+    if (records != nullptr) {
+        for (size_t i = 0; i < AllUserFeatures.size(); i++) {
+            records->writeUserFeature(int(i), AllUserFeatures[i].name, (features.*AllUserFeatures[i].get)());
+        }
+        return;
+    }
+    size_t name_width = 0;
+    for (const auto& feat : AllUserFeatures) {
+        name_width = std::max(name_width, feat.name.length());
+    }
+    for (const auto& feat : AllUserFeatures) {
+        out << Pad(feat.name + " ", name_width + 2) << " " << YesNo((features.*feat.get)()) << std::endl;
+    }
+    out << Pad("DC ZVA block size ", name_width + 2) << " "
+        << (features.dczProhibited() ? std::string("prohibited") : std::to_string(features.dczBlockSize())) << std::endl;
+}
+
+
+//----------------------------------------------------------------------------
+// Hardware capabilities of Linux.
+//----------------------------------------------------------------------------
+
+void HwcapsReport(std::ostream& out)
+{
+    const Hwcaps& caps(Hwcaps::instance());
+    size_t name_width = 0;
+    for (const auto& cap : caps) {
+        name_width = std::max(name_width, std::string(cap.name).length());
+    }
+    for (const auto& cap : caps) {
+        out << Pad(std::string(cap.name) + " ", name_width + 1) << " " << YesNo(caps.has(cap)) << std::endl;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Arm features of macOS.
+//----------------------------------------------------------------------------
+
+#if defined(__APPLE__)
+void SysctlReport(std::ostream& out, bool verbose)
+{
+    // List of hw.optional.arm sysctl.
+    struct Param {
+        std::string name;
+        std::string sysctl;
+    };
+    static const std::vector<Param> AllParams {
+        // Automatically generated file:
+        #include "_sysctl.h"
+    };
+
+    size_t name_width = 0;
+    for (const auto& param : AllParams) {
+        name_width = std::max(name_width, param.name.length());
+    }
+
+    // Resolve all names to OID's first, each name is parsed only once by the kernel.
+    struct Oid {
+        int    mib[CTL_MAXNAME];
+        size_t count;
+    };
+    std::vector<Oid> oids(AllParams.size());
+    std::vector<bool> resolved(AllParams.size());
+    for (size_t i = 0; i < AllParams.size(); i++) {
+        oids[i].count = CTL_MAXNAME;
+        resolved[i] = ::sysctlnametomib(AllParams[i].sysctl.c_str(), oids[i].mib, &oids[i].count) == 0;
+        if (!resolved[i]) {
+            ::perror(AllParams[i].sysctl.c_str());
+        }
+    }
+
+    // Then read all values using the OID's, in a packed bitmap.
+    std::vector<bool> values(AllParams.size());
+    for (size_t i = 0; i < AllParams.size(); i++) {
+        int value = 0;
+        size_t len = sizeof(value);
+        if (!resolved[i]) {
+            continue;
+        }
+        if (::sysctl(oids[i].mib, u_int(oids[i].count), &value, &len, nullptr, 0) < 0) {
+            ::perror(AllParams[i].sysctl.c_str());
+            resolved[i] = false;
+        }
+        else {
+            values[i] = value != 0;
+        }
+    }
+
+    for (size_t i = 0; i < AllParams.size(); i++) {
+        if (resolved[i]) {
+            out << Pad(AllParams[i].name + " ", name_width + 1) << " " << Pad(YesNo(values[i]), 3, ' ', false);
+            if (verbose) {
+                out << "  OID:";
+                for (size_t n = 0; n < oids[i].count; n++) {
+                    out << " " << oids[i].mib[n];
+                }
+            }
+            out << std::endl;
+        }
+    }
+}
+#endif
+
+
+//----------------------------------------------------------------------------
+// Instrumentation counters of RegAccess.
+//----------------------------------------------------------------------------
+
+void StatsReport(std::ostream& out)
+{
+    static const char* const commands[] = {"(read many)", "(read all CPUs)", "(instruction)", "(instruction batch)", "(requests)", "(other)"};
+    static_assert(sizeof(commands) / sizeof(commands[0]) == RegAccess::STATS_COUNT - RegAccess::STATS_MULTI);
+
+    std::vector<RegAccess::CallStats> stats;
+    RegAccess::getStats(stats);
+    std::vector<size_t> order;
+    for (size_t i = 0; i < stats.size(); i++) {
+        if (stats[i].calls > 0) {
+            order.push_back(i);
+        }
+    }
+    std::sort(order.begin(), order.end(), [&stats](size_t a, size_t b) { return stats[a].total_ns > stats[b].total_ns; });
+
+    csr_u64_t calls = 0;
+    csr_u64_t total_ns = 0;
+    out << std::endl << Format("%-24s %10s %8s %10s %10s %12s", "Register or command", "Calls", "Errors", "Avg ns", "Max ns", "Total us") << std::endl;
+    for (size_t i : order) {
+        const RegAccess::CallStats& st(stats[i]);
+        const std::string name(int(i) >= RegAccess::STATS_MULTI ? commands[i - RegAccess::STATS_MULTI] :
+                               RegView::getRegister(int(i)).isValid() ? std::string(RegView::getRegister(int(i)).name) : Format("regid %zu", i));
+        out << Format("%-24s %'10" PRIu64 " %'8" PRIu64 " %'10" PRIu64 " %'10" PRIu64 " %'12.1f",
+                      name.c_str(), st.calls, st.errors, st.total_ns / st.calls, st.max_ns, double(st.total_ns) / 1000.0) << std::endl;
+        calls += st.calls;
+        total_ns += st.total_ns;
+    }
+    out << Format("Total: %'" PRIu64 " calls to the kernel module, %'.1f us", calls, double(total_ns) / 1000.0) << std::endl;
+}
@@ -0,0 +1,59 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Standard text reports on the CPU, shared by sysregs, collect and the demo programs.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "regaccess.h"
+#include "armfeatures.h"
+#include "regrecord.h"
+#include "cputopology.h"
+#include <ostream>
+#include <string>
+
+// Summary of CPU features, same as "sysregs -s".
+// With a record writer, the features are written as records instead of text.
+void FeaturesReport(std::ostream& out, const ArmFeatures& features, RegRecordWriter* records = nullptr);
+
+// Latency of the two paths to read the identification registers, at the end of "sysregs -s".
+void RegSourceReport(std::ostream& out, const RegSource& source);
+
+// Summary of PAC features, same as "sysregs -p".
+void PACReport(std::ostream& out, RegAccess& regs, const ArmFeatures& features);
+
+// All readable system registers, same as "sysregs -a" or "sysregs -a -v".
+// With a record writer, the registers are written as records instead of text.
+// Errors are reported on standard error, prefixed by the command name.
+void RegistersReport(std::ostream& out, RegAccess& regs, const ArmFeatures& features, bool verbose,
+                     RegRecordWriter* records = nullptr, const std::string& command = std::string());
+
+// CPU topology, core classes with their caches and clusters, same as "sysregs -t".
+void TopologyReport(std::ostream& out, const CpuTopology& topology);
+
+// Translation granules, walk levels, contiguous ranges and TLB reach, same as "sysregs -g".
+// With a non-zero working set in bytes, the cost of each mapping size is displayed with a
+// recommendation. The TLB reach is computed for the specified number of TLB entries.
+void TranslationReport(std::ostream& out, RegAccess& regs, const ArmFeatures& features,
+                       csr_u64_t working_set = 0, csr_u64_t tlb_entries = 1024);
+
+// Features which are visible in user mode (class UserFeatures) and the DC ZVA block size,
+// same as demo-userfeatures. With a record writer, the features are written as records instead of text.
+void UserFeaturesReport(std::ostream& out, RegRecordWriter* records = nullptr);
+
+// Hardware capabilities of Linux (class Hwcaps), as returned by getauxval(), same as linux-hwcaps.
+void HwcapsReport(std::ostream& out);
+
+#if defined(__APPLE__)
+// Arm features of macOS, as returned by sysctl(), same as mac-sysctl.
+// With verbose, the OID of each sysctl is also displayed.
+void SysctlReport(std::ostream& out, bool verbose = false);
+#endif
+
+// Instrumentation counters of RegAccess, same as "sysregs --stats".
+// The registers and commands are sorted by decreasing cumulative latency.
+void StatsReport(std::ostream& out);
@@ -0,0 +1,312 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Compare two binary host snapshots, as created by "collect -o" or by
+// "sysregs --binary". Registers are compared field by field, using the
+// register descriptions of RegView.
+//
+// Syntax: snapdiff [-q] [-x name,...] file1 file2
+//
+//----------------------------------------------------------------------------
+
+#include "hostsnapshot.h"
+#include "regview.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    std::vector<std::string> files;
+    std::vector<std::string> excluded;
+    bool quiet;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+
+    // Check if a register is excluded.
+    bool isExcluded(std::string_view name) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Compare two binary host snapshots." << std::endl
+              << std::endl
+              << "Syntax: " << command << " [options] file1 file2" << std::endl
+              << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -q : quiet, only report the differences in the exit status" << std::endl
+              << "  -x name,... : exclude these registers from the comparison" << std::endl
+              << std::endl
+              << "The exit status is zero when the two snapshots are identical." << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    files(),
+    excluded(),
+    quiet(false)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-q") {
+            quiet = true;
+        }
+        else if (arg == "-x" && i+1 < argc) {
+            const std::string list(ToUpper(argv[++i]));
+            for (size_t start = 0; start <= list.size(); ) {
+                const size_t end = std::min(list.find(',', start), list.size());
+                if (end > start) {
+                    excluded.push_back(list.substr(start, end - start));
+                }
+                start = end + 1;
+            }
+        }
+        else if (!arg.empty() && arg[0] == '-') {
+            fatal("invalid option '" + arg + "', try --help");
+        }
+        else {
+            files.push_back(arg);
+        }
+    }
+    if (files.size() != 2) {
+        fatal("specify two snapshot files, try --help");
+    }
+}
+
+bool Options::isExcluded(std::string_view name) const
+{
+    return std::find(excluded.begin(), excluded.end(), name) != excluded.end();
+}
+
+
+//----------------------------------------------------------------------------
+// Comparison of two snapshots.
+//----------------------------------------------------------------------------
+
+class SnapDiff
+{
+public:
+    // Constructor.
+    SnapDiff(const Options& opt, const HostSnapshot& snap1, const HostSnapshot& snap2, std::ostream& out);
+
+    // Compare the two snapshots, return the number of differences.
+    size_t compare();
+
+private:
+    const Options&      _opt;
+    const HostSnapshot& _snap1;
+    const HostSnapshot& _snap2;
+    std::ostream&       _out;
+    std::string         _buffer {};  // reusable output buffer
+    size_t              _diffs = 0;
+
+    // Start a line: "CPU n: " prefix for per-core records.
+    void startLine(const RegRecord& rec);
+
+    // Flush the output buffer.
+    void flush();
+
+    // Compare two records with the same type and name. One of them may be null.
+    void compare(const RegRecord* rec1, const RegRecord* rec2);
+    void compareRegisters(const RegRecord& rec1, const RegRecord& rec2);
+};
+
+SnapDiff::SnapDiff(const Options& opt, const HostSnapshot& snap1, const HostSnapshot& snap2, std::ostream& out) :
+    _opt(opt),
+    _snap1(snap1),
+    _snap2(snap2),
+    _out(out)
+{
+}
+
+void SnapDiff::startLine(const RegRecord& rec)
+{
+    if (rec.cpu >= 0) {
+        _buffer.append("CPU ");
+        AppendDecimal(_buffer, rec.cpu);
+        _buffer.append(": ");
+    }
+}
+
+void SnapDiff::flush()
+{
+    if (!_opt.quiet) {
+        _out.write(_buffer.data(), std::streamsize(_buffer.size()));
+    }
+    _buffer.clear();
+}
+
+size_t SnapDiff::compare()
+{
+    // All records from the first file, in file order, then the ones which are only in the second file.
+    for (const auto& rec : _snap1.records()) {
+        compare(&rec, _snap2.find(rec.type, RegRecordWriter::name(rec), rec.cpu));
+    }
+    for (const auto& rec : _snap2.records()) {
+        if (_snap1.find(rec.type, RegRecordWriter::name(rec), rec.cpu) == nullptr) {
+            compare(nullptr, &rec);
+        }
+    }
+    return _diffs;
+}
+
+void SnapDiff::compare(const RegRecord* rec1, const RegRecord* rec2)
+{
+    const RegRecord& rec(rec1 != nullptr ? *rec1 : *rec2);
+    const std::string_view name(RegRecordWriter::name(rec));
+    if (rec.type < REGRECORD_REGISTER || rec.type > REGRECORD_PAC || (rec.type == REGRECORD_REGISTER && _opt.isExcluded(name))) {
+        return; // unknown record type or excluded register
+    }
+
+    if (rec1 == nullptr || rec2 == nullptr) {
+        startLine(rec);
+        _buffer.append(name);
+        _buffer.append(": only in ");
+        _buffer.append(_opt.files[rec1 == nullptr ? 1 : 0]);
+        _buffer.append(1, '\n');
+        _diffs++;
+    }
+    else if (rec1->status != rec2->status) {
+        startLine(rec);
+        _buffer.append(name);
+        _buffer.append(": ");
+        _buffer.append(rec1->status == 0 ? "readable" : "not readable");
+        _buffer.append(" -> ");
+        _buffer.append(rec2->status == 0 ? "readable" : "not readable");
+        _buffer.append(1, '\n');
+        _diffs++;
+    }
+    else if (rec1->status != 0 || (rec1->low == rec2->low && rec1->high == rec2->high)) {
+        // Identical values or unreadable in both snapshots.
+    }
+    else if (rec.type == REGRECORD_REGISTER) {
+        compareRegisters(*rec1, *rec2);
+    }
+    else if (rec.type == REGRECORD_FEATURE || rec.type == REGRECORD_USER_FEATURE) {
+        _buffer.append(rec.type == REGRECORD_FEATURE ? "feature " : "user feature ");
+        _buffer.append(name);
+        _buffer.append(": ");
+        _buffer.append(YesNo(rec1->low != 0));
+        _buffer.append(" -> ");
+        _buffer.append(YesNo(rec2->low != 0));
+        _buffer.append(1, '\n');
+        _diffs++;
+    }
+    else if (rec.type == REGRECORD_PAC) {
+        _buffer.append("PAC ");
+        _buffer.append(name);
+        _buffer.append(": ");
+        AppendDecimal(_buffer, static_cast<long long>(rec1->low));
+        _buffer.append(" -> ");
+        AppendDecimal(_buffer, static_cast<long long>(rec2->low));
+        _buffer.append(1, '\n');
+        _diffs++;
+    }
+    flush();
+}
+
+void SnapDiff::compareRegisters(const RegRecord& rec1, const RegRecord& rec2)
+{
+    const std::string_view name(RegRecordWriter::name(rec1));
+    const RegView::Register& desc(RegView::getRegister(name));
+    const csr_pair_t value1{rec1.low, rec1.high};
+    const csr_pair_t value2{rec2.low, rec2.high};
+
+    // Full register value. Unknown registers in this version are pairs when a high part is present.
+    const bool pair = desc.isValid() ? desc.isPair() : (rec1.high | rec2.high) != 0;
+    startLine(rec1);
+    _buffer.append(name);
+    _buffer.append(": ");
+    pair ? AppendHexa(_buffer, value1) : AppendHexa(_buffer, value1.low);
+    _buffer.append(" -> ");
+    pair ? AppendHexa(_buffer, value2) : AppendHexa(_buffer, value2.low);
+    _buffer.append(1, '\n');
+    _diffs++;
+
+    // Modified bitfields, when the register is known in this version.
+    for (const auto& bf : desc.fields) {
+        const csr_u64_t bfval1 = RegView::Register::fieldValue(bf, value1);
+        const csr_u64_t bfval2 = RegView::Register::fieldValue(bf, value2);
+        if (bfval1 != bfval2) {
+            const int hexwidth = (bf.msb - bf.lsb) / 4 + 1;
+            const RegView::Name* valname1 = RegView::Register::findValue(bf, bfval1);
+            const RegView::Name* valname2 = RegView::Register::findValue(bf, bfval2);
+            _buffer.append("  ");
+            startLine(rec1);
+            _buffer.append(name);
+            _buffer.append(1, '.');
+            _buffer.append(bf.name);
+            _buffer.append(": 0x");
+            AppendHexaDigits(_buffer, bfval1, hexwidth);
+            if (valname1 != nullptr) {
+                _buffer.append(" (");
+                _buffer.append(valname1->name);
+                _buffer.append(1, ')');
+            }
+            _buffer.append(" -> 0x");
+            AppendHexaDigits(_buffer, bfval2, hexwidth);
+            if (valname2 != nullptr) {
+                _buffer.append(" (");
+                _buffer.append(valname2->name);
+                _buffer.append(1, ')');
+            }
+            _buffer.append(1, '\n');
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Program entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    const Options opt(argc, argv);
+
+    HostSnapshot snap1;
+    HostSnapshot snap2;
+    if (!snap1.open(opt.files[0])) {
+        opt.fatal(snap1.error());
+    }
+    if (!snap2.open(opt.files[1])) {
+        opt.fatal(snap2.error());
+    }
+
+    SnapDiff diff(opt, snap1, snap2, std::cout);
+    return diff.compare() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,50 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A read-only view of a contiguous array.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include <cstddef>
+#include <array>
+#include <vector>
+
+//
+// A read-only view of a contiguous array of elements, similar to std::span in C++20.
+// The Span does not own the elements, the array must outlive the Span.
+//
+template <typename T>
+class Span
+{
+public:
+    // Constructors.
+    constexpr Span() = default;
+    constexpr Span(const T* data, size_t size) : _data(data), _size(size) {}
+    template <size_t N>
+    constexpr Span(const T (&data)[N]) : _data(data), _size(N) {}
+    template <size_t N>
+    constexpr Span(const std::array<T,N>& data) : _data(data.data()), _size(N) {}
+    Span(const std::vector<T>& data) : _data(data.data()), _size(data.size()) {}
+
+    // Accessors.
+    constexpr const T* data() const { return _data; }
+    constexpr size_t size() const { return _size; }
+    constexpr bool empty() const { return _size == 0; }
+    constexpr const T* begin() const { return _data; }
+    constexpr const T* end() const { return _data + _size; }
+    constexpr const T& operator[](size_t index) const { return _data[index]; }
+
+    // Get a subset of the elements.
+    constexpr Span subspan(size_t offset, size_t count) const
+    {
+        return offset >= _size ? Span() : Span(_data + offset, count < _size - offset ? count : _size - offset);
+    }
+
+private:
+    const T* _data = nullptr;
+    size_t   _size = 0;
+};
@@ -0,0 +1,150 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A class to decode the records of the Statistical Profiling Extension (SPE).
+//
+//----------------------------------------------------------------------------
+
+#include "spedecoder.h"
+
+// Packet headers.
+#define SPE_PADDING        0x00
+#define SPE_END            0x01
+#define SPE_TIMESTAMP      0x71
+#define SPE_EXTENDED_MASK  0xFC
+#define SPE_EXTENDED       0x20
+#define SPE_ADDRESS_MASK   0xF8
+#define SPE_ADDRESS        0xB0
+#define SPE_COUNTER_MASK   0xF8
+#define SPE_COUNTER        0x98
+#define SPE_EVENTS_MASK    0xCF
+#define SPE_EVENTS         0x42
+#define SPE_SOURCE_MASK    0xCF
+#define SPE_SOURCE         0x43
+#define SPE_OPTYPE_MASK    0xFC
+#define SPE_OPTYPE         0x48
+
+// Address packet index.
+#define SPE_ADDR_PC        0
+#define SPE_ADDR_BRANCH    1
+#define SPE_ADDR_DATA_VA   2
+#define SPE_ADDR_DATA_PA   3
+
+// Counter packet index.
+#define SPE_COUNT_TOTAL    0
+#define SPE_COUNT_ISSUE    1
+#define SPE_COUNT_XLAT     2
+
+// Sign-extend a 56-bit virtual address.
+static inline csr_u64_t SignExtend56(csr_u64_t addr)
+{
+    addr &= 0x00FFFFFFFFFFFFFF;
+    return (addr & 0x0080000000000000) != 0 ? (addr | 0xFF00000000000000) : addr;
+}
+
+
+//----------------------------------------------------------------------------
+// Decode a buffer of SPE records.
+//----------------------------------------------------------------------------
+
+bool SpeDecoder::decode(const uint8_t* data, size_t size, std::vector<Record>& records, size_t* error_offset)
+{
+    Record rec;
+    bool in_record = false;
+
+    for (size_t i = 0; i < size; ) {
+        const size_t start = i;
+        csr_u64_t header = data[i++];
+
+        if (header == SPE_PADDING) {
+            continue;
+        }
+        if (header == SPE_END) {
+            if (in_record) {
+                records.push_back(rec);
+            }
+            rec = Record();
+            in_record = false;
+            continue;
+        }
+
+        // Extended header: the index extension is in the first byte.
+        csr_u64_t ext = 0;
+        if ((header & SPE_EXTENDED_MASK) == SPE_EXTENDED) {
+            if (i >= size) {
+                break;
+            }
+            ext = header & 0x03;
+            header = data[i++];
+        }
+
+        // All other packets have a payload, with size in bits 5:4 of the header.
+        const size_t psize = size_t(1) << ((header >> 4) & 0x03);
+        if (i + psize > size) {
+            break; // truncated record at end of buffer
+        }
+        csr_u64_t payload = 0;
+        for (size_t b = 0; b < psize; b++) {
+            payload |= csr_u64_t(data[i + b]) << (8 * b);
+        }
+        i += psize;
+        in_record = true;
+
+        if (header == SPE_TIMESTAMP) {
+            // The timestamp packet also ends a record.
+            rec.timestamp = payload;
+            records.push_back(rec);
+            rec = Record();
+            in_record = false;
+        }
+        else if ((header & SPE_ADDRESS_MASK) == SPE_ADDRESS) {
+            switch ((ext << 3) | (header & 0x07)) {
+                case SPE_ADDR_PC:
+                    rec.pc = SignExtend56(payload);
+                    rec.el = int(payload >> 61) & 0x03;
+                    break;
+                case SPE_ADDR_BRANCH:
+                    rec.branch_target = SignExtend56(payload);
+                    break;
+                case SPE_ADDR_DATA_VA:
+                    rec.data_address = SignExtend56(payload);
+                    break;
+                case SPE_ADDR_DATA_PA:
+                    rec.physical_address = payload & 0x00FFFFFFFFFFFFFF;
+                    break;
+                default:
+                    break;
+            }
+        }
+        else if ((header & SPE_COUNTER_MASK) == SPE_COUNTER) {
+            switch ((ext << 3) | (header & 0x07)) {
+                case SPE_COUNT_TOTAL: rec.total_latency = payload; break;
+                case SPE_COUNT_ISSUE: rec.issue_latency = payload; break;
+                case SPE_COUNT_XLAT: rec.translation_latency = payload; break;
+                default: break;
+            }
+        }
+        else if ((header & SPE_EVENTS_MASK) == SPE_EVENTS) {
+            rec.events = payload;
+        }
+        else if ((header & SPE_SOURCE_MASK) == SPE_SOURCE) {
+            rec.data_source = int(payload);
+        }
+        else if ((header & SPE_OPTYPE_MASK) == SPE_OPTYPE) {
+            rec.op_class = int(header & 0x03);
+            rec.op_subclass = int(payload);
+        }
+        else if (ext != 0) {
+            // Unknown extended packet, cannot be a valid stream.
+            if (error_offset != nullptr) {
+                *error_offset = start;
+            }
+            return false;
+        }
+        // Other packets (context, unknown) are ignored.
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A class to decode the records of the Statistical Profiling Extension (SPE).
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//
+// A class to decode the records of the Statistical Profiling Extension (SPE).
+// See section D10 "The Statistical Profiling Extension" and D17 "Statistical Profiling
+// Extension Sample Record Specification" of the Arm Architecture Reference Manual.
+//
+class SpeDecoder
+{
+public:
+    // Bits in the events packet.
+    enum : csr_u64_t {
+        EV_EXCEPTION     = 1 << 0,
+        EV_RETIRED       = 1 << 1,
+        EV_L1D_ACCESS    = 1 << 2,
+        EV_L1D_REFILL    = 1 << 3,
+        EV_TLB_ACCESS    = 1 << 4,
+        EV_TLB_WALK      = 1 << 5,
+        EV_NOT_TAKEN     = 1 << 6,
+        EV_MISPREDICTED  = 1 << 7,
+        EV_LLC_ACCESS    = 1 << 8,
+        EV_LLC_MISS      = 1 << 9,
+        EV_REMOTE_ACCESS = 1 << 10,
+    };
+
+    // Classes of operation in the operation type packet.
+    enum {
+        OP_OTHER      = 0,
+        OP_LOAD_STORE = 1,
+        OP_BRANCH     = 2,
+        OP_NONE       = -1,
+    };
+
+    // One decoded sample record. Fields which are not present in the record are zero.
+    struct Record {
+        csr_u64_t pc = 0;                   // virtual address of the sampled instruction
+        int       el = 0;                   // exception level of the sampled instruction
+        csr_u64_t branch_target = 0;        // virtual address of the branch target
+        csr_u64_t data_address = 0;         // virtual address of the data access, without tag
+        csr_u64_t physical_address = 0;     // physical address of the data access
+        csr_u64_t timestamp = 0;            // timestamp, when enabled in PMSCR_EL1
+        csr_u64_t events = 0;               // mask of EV_xxx
+        csr_u64_t total_latency = 0;        // cycles from dispatch to completion
+        csr_u64_t issue_latency = 0;        // cycles from dispatch to issue
+        csr_u64_t translation_latency = 0;  // cycles of address translation
+        int       data_source = -1;         // implementation-defined data source, -1 if none
+        int       op_class = OP_NONE;       // operation class, OP_xxx
+        int       op_subclass = 0;          // operation subclass (load/store, conditional branch, etc.)
+    };
+
+    // Decode a buffer of SPE records and append them to a vector.
+    // A truncated record at end of buffer is ignored.
+    // Return false on invalid packet, with the offset of the packet in error_offset (if not null).
+    static bool decode(const uint8_t* data, size_t size, std::vector<Record>& records, size_t* error_offset = nullptr);
+};
@@ -24,12 +24,16 @@ std::string YesNo(bool value)
 
 std::string ToHexa(csr_u64_t value)
 {
-    return Format("%08llX-%08llX", value >> 32, value & 0xFFFFFFFF);
+    char buf[HEXA_WIDTH];
+    return std::string(buf, ToHexa(buf, value));
 }
 
 std::string ToHexa(csr_u64_t hi, csr_u64_t lo)
 {
-    return Format("%08llX-%08llX-%08llX-%08llX", hi >> 32, hi & 0xFFFFFFFF, lo >> 32, lo & 0xFFFFFFFF);
+    char buf[HEXA_PAIR_WIDTH];
+    char* end = ToHexa(buf, hi);
+    *end++ = '-';
+    return std::string(buf, ToHexa(end, lo));
 }
 
 std::string ToHexa(const csr_pair_t& pair)
@@ -39,18 +43,162 @@ std::string ToHexa(const csr_pair_t& pair)
 
 std::string ToBinary(csr_u64_t value)
 {
-    std::string str;
-    str.reserve(82);
-    for (int shift = 63; shift >= 0; --shift) {
-        if (shift == 31) {
-            str += " - ";
+    char buf[BINARY_WIDTH];
+    return std::string(buf, ToBinary(buf, value));
+}
+
+
+//----------------------------------------------------------------------------
+// Fixed-width formatting into a caller-supplied buffer.
+//----------------------------------------------------------------------------
+
+namespace {
+    // Two hexadecimal digits for each byte value, built at compile time.
+    struct HexaTable {
+        char digits[256][2];
+        constexpr HexaTable() : digits()
+        {
+            constexpr char hex[] = "0123456789ABCDEF";
+            for (int i = 0; i < 256; i++) {
+                digits[i][0] = hex[i >> 4];
+                digits[i][1] = hex[i & 0x0F];
+            }
+        }
+    };
+    constexpr HexaTable HexaPairs;
+
+    // Four binary digits for each nibble value, built at compile time.
+    struct BinaryTable {
+        char digits[16][4];
+        constexpr BinaryTable() : digits()
+        {
+            for (int i = 0; i < 16; i++) {
+                for (int bit = 0; bit < 4; bit++) {
+                    digits[i][bit] = ((i >> (3 - bit)) & 1) ? '1' : '0';
+                }
+            }
+        }
+    };
+    constexpr BinaryTable BinaryNibbles;
+}
+
+char* ToHexaDigits(char* out, csr_u64_t value, int digits)
+{
+    // Leading zeroes beyond 64 bits, then an odd number of digits starts with a single one.
+    for (; digits > 16; digits--) {
+        *out++ = '0';
+    }
+    if (digits & 1) {
+        *out++ = HexaPairs.digits[(value >> (4 * --digits)) & 0x0F][1];
+    }
+    while (digits > 0) {
+        digits -= 2;
+        const char* pair = HexaPairs.digits[(value >> (4 * digits)) & 0xFF];
+        *out++ = pair[0];
+        *out++ = pair[1];
+    }
+    return out;
+}
+
+char* ToHexa(char* out, csr_u64_t value)
+{
+    out = ToHexaDigits(out, value >> 32, 8);
+    *out++ = '-';
+    return ToHexaDigits(out, value, 8);
+}
+
+char* ToHexa(char* out, const csr_pair_t& pair)
+{
+    out = ToHexa(out, pair.high);
+    *out++ = '-';
+    return ToHexa(out, pair.low);
+}
+
+char* ToBinary(char* out, csr_u64_t value)
+{
+    for (int shift = 60; shift >= 0; shift -= 4) {
+        ::memcpy(out, BinaryNibbles.digits[(value >> shift) & 0x0F], 4);
+        out += 4;
+        if (shift == 32) {
+            ::memcpy(out, " - ", 3);
+            out += 3;
+        }
+        else if (shift > 0) {
+            *out++ = ' ';
+        }
+    }
+    return out;
+}
+
+
+//----------------------------------------------------------------------------
+// Appender-style formatting at the end of a reusable string.
+//----------------------------------------------------------------------------
+
+namespace {
+    // Append a fixed-width output, using a function writing into a buffer.
+    template <typename FUNC>
+    inline void AppendFixed(std::string& out, size_t width, FUNC func)
+    {
+        const size_t pos = out.size();
+        out.resize(pos + width);
+        out.resize(size_t(func(&out[pos]) - out.data()));
+    }
+}
+
+void AppendHexa(std::string& out, csr_u64_t value)
+{
+    AppendFixed(out, HEXA_WIDTH, [value](char* buf) { return ToHexa(buf, value); });
+}
+
+void AppendHexa(std::string& out, const csr_pair_t& value)
+{
+    AppendFixed(out, HEXA_PAIR_WIDTH, [&value](char* buf) { return ToHexa(buf, value); });
+}
+
+void AppendHexaDigits(std::string& out, csr_u64_t value, int digits)
+{
+    AppendFixed(out, size_t(std::max(0, digits)), [value, digits](char* buf) { return ToHexaDigits(buf, value, digits); });
+}
+
+void AppendBinary(std::string& out, csr_u64_t value)
+{
+    AppendFixed(out, BINARY_WIDTH, [value](char* buf) { return ToBinary(buf, value); });
+}
+
+void AppendDecimal(std::string& out, long long value)
+{
+    // Build the digits backward in a local buffer, the largest value has 20 characters.
+    char buf[24];
+    char* start = buf + sizeof(buf);
+    unsigned long long uval = value < 0 ? 0 - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value);
+    do {
+        *--start = char('0' + uval % 10);
+        uval /= 10;
+    } while (uval != 0);
+    if (value < 0) {
+        *--start = '-';
+    }
+    out.append(start, buf + sizeof(buf) - start);
+}
+
+void AppendJSONString(std::string& out, std::string_view str)
+{
+    out.append(1, '"');
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            out.append(1, '\\');
+            out.append(1, c);
         }
-        else if (shift < 63 && shift % 4 == 3) {
-            str += ' ';
+        else if ((unsigned char)(c) < 0x20) {
+            out.append("\\u00");
+            AppendHexaDigits(out, (unsigned char)(c), 2);
+        }
+        else {
+            out.append(1, c);
         }
-        str += (int(value >> shift) & 1) ? '1' : '0';
     }
-    return str;
+    out.append(1, '"');
 }
 
 
@@ -124,6 +272,33 @@ std::string Format(const char* fmt, ...)
     return buf;
 }
 
+void AppendFormat(std::string& out, const char* fmt, ...)
+{
+    va_list ap;
+
+    // First try to format in the current capacity of the string.
+    const size_t pos = out.size();
+    out.resize(std::max(out.capacity(), pos + 1));
+    va_start(ap, fmt);
+    int len = ::vsnprintf(&out[pos], out.size() - pos, fmt, ap);
+    va_end(ap);
+
+    if (len < 0) {
+        out.resize(pos); // error
+    }
+    else if (pos + size_t(len) < out.size()) {
+        out.resize(pos + size_t(len));
+    }
+    else {
+        // Not enough space, enlarge and format again.
+        out.resize(pos + size_t(len) + 1);
+        va_start(ap, fmt);
+        len = ::vsnprintf(&out[pos], out.size() - pos, fmt, ap);
+        va_end(ap);
+        out.resize(pos + size_t(std::max(0, len)));
+    }
+}
+
 
 //----------------------------------------------------------------------------
 // Case conversions.
@@ -150,13 +325,23 @@ std::string ToUpper(const std::string& s)
 
 std::string Pad(const std::string& str, size_t width, char pad, bool right)
 {
-    std::string res(str);
-    if (str.length() < width) {
-        res.insert(right ? res.end() : res.begin(), width - str.length(), pad);
-    }
+    std::string res;
+    AppendPad(res, str, width, pad, right);
     return res;
 }
 
+void AppendPad(std::string& out, std::string_view str, size_t width, char pad, bool right)
+{
+    const size_t padding = str.length() < width ? width - str.length() : 0;
+    if (!right) {
+        out.append(padding, pad);
+    }
+    out.append(str);
+    if (right) {
+        out.append(padding, pad);
+    }
+}
+
 
 //----------------------------------------------------------------------------
 // Transform an errno value into an error message string.
@@ -12,6 +12,7 @@
 #include "cpusysregs.h"
 #include <cstring>
 #include <string>
+#include <string_view>
 
 // Zero memory.
 CSR_INLINE void Zero(void* addr, size_t size) { ::memset(addr, 0, size); }
@@ -23,12 +24,34 @@ std::string ToHexa(csr_u64_t hi, csr_u64_t lo);
 std::string ToHexa(const csr_pair_t&);
 std::string ToBinary(csr_u64_t);
 
+// Fixed-width formatting of integers into a caller-supplied buffer, without heap allocation.
+// The output is not nul-terminated. The returned value is the end of the output.
+constexpr size_t HEXA_WIDTH = 17;       // XXXXXXXX-XXXXXXXX
+constexpr size_t HEXA_PAIR_WIDTH = 35;  // XXXXXXXX-XXXXXXXX-XXXXXXXX-XXXXXXXX
+constexpr size_t BINARY_WIDTH = 81;     // 0000 0000 ... 0000 - 0000 ... 0000
+char* ToHexa(char* out, csr_u64_t);
+char* ToHexa(char* out, const csr_pair_t&);
+char* ToHexaDigits(char* out, csr_u64_t value, int digits); // the 'digits' least significant hexa digits
+char* ToBinary(char* out, csr_u64_t);
+
+// Appender-style formatting at the end of a reusable string.
+// There is no heap allocation when the capacity of the string is sufficient.
+void AppendHexa(std::string&, csr_u64_t);
+void AppendHexa(std::string&, const csr_pair_t&);
+void AppendHexaDigits(std::string&, csr_u64_t value, int digits);
+void AppendBinary(std::string&, csr_u64_t);
+void AppendDecimal(std::string&, long long);
+
+// Append a JSON string literal, with quotes and escaped characters.
+void AppendJSONString(std::string&, std::string_view);
+
 // Decode hexadecimal strings, return false on invalid input.
 bool DecodeHexa(csr_u64_t&, const std::string&, const std::string& sep = "-_., \t\r\n");
 bool DecodeHexa(csr_pair_t&, const std::string&, const std::string& sep = "-_., \t\r\n");
 
 // Format a C++ string in a printf-way.
 std::string Format(const char* fmt, ...);
+void AppendFormat(std::string& out, const char* fmt, ...);
 
 // Case conversions.
 std::string ToLower(const std::string&);
@@ -36,10 +59,13 @@ std::string ToUpper(const std::string&);
 
 // Pad a string to a given width.
 std::string Pad(const std::string& str, size_t width, char pad = '.', bool right = true);
+void AppendPad(std::string& out, std::string_view str, size_t width, char pad = '.', bool right = true);
 
 // Join a container of strings.
 template <class CONTAINER>
 std::string Join(const CONTAINER& container, const std::string& separator = ", ", bool noempty = false);
+template <class CONTAINER>
+void AppendJoin(std::string& out, const CONTAINER& container, std::string_view separator = ", ", bool noempty = false);
 
 // Transform an errno value into an error message string.
 std::string Error(int);
@@ -49,13 +75,20 @@ template <class CONTAINER>
 std::string Join(const CONTAINER& container, const std::string& separator, bool noempty)
 {
     std::string res;
+    AppendJoin(res, container, separator, noempty);
+    return res;
+}
+
+template <class CONTAINER>
+void AppendJoin(std::string& out, const CONTAINER& container, std::string_view separator, bool noempty)
+{
+    const size_t start = out.size();
     for (auto iter = container.begin(); iter != container.end(); ++iter) {
         if (!noempty || !iter->empty()) {
-            if (!res.empty()) {
-                res.append(separator);
+            if (out.size() > start) {
+                out.append(separator);
             }
-            res.append(*iter);
+            out.append(*iter);
         }
     }
-    return res;
 }
@@ -12,14 +12,28 @@
 #include "strutils.h"
 #include "regaccess.h"
 #include "regview.h"
+#include "regdecoder.h"
 #include "armfeatures.h"
-#include "armpseudocode.h"
+#include "regrecord.h"
+#include "reports.h"
 
 #include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <csignal>
 #include <cstddef>
 #include <cstdlib>
 #include <string>
 #include <list>
+#include <memory>
+#include <vector>
+
+#if defined(WINDOWS)
+    #include <io.h>
+    #include <fcntl.h>
+#endif
 
 
 //----------------------------------------------------------------------------
@@ -37,16 +51,32 @@ public:
     std::string read_register;
     std::string write_register;
     std::string display_register;
+    std::string decode_register;
+    std::string decode_file;
+    std::string watch_registers;
+    csr_u64_t watch_interval;  // microseconds
+    csr_u64_t watch_count;
+    csr_u64_t watch_cpu;
+    csr_u64_t working_set;  // bytes
+    csr_u64_t tlb_entries;
     csr_pair_t write_value;
     csr_pair_t display_value;
     bool all_registers;
     bool binary;
+    bool all_cpus;
+    bool changes_only;
     bool force;
     bool list_registers;
     bool cpu_summary;
     bool direct_load;
+    bool granules;
     bool pac_summary;
+    bool topology;
     bool verbose;
+    bool json;
+    bool binary_records;
+    bool watch_notify;
+    bool stats;
 
     // Print help and exits.
     void usage() const;
@@ -62,16 +92,32 @@ void Options::usage() const
               << std::endl
               << "  -a : read all supported Arm64 system registers" << std::endl
               << "  -b : display register value in binary (default: hex)" << std::endl
+              << "  -c : with -r, read the register on all CPU cores" << std::endl
+              << "  -C : with -D, display only the bitfields which changed from the previous value" << std::endl
               << "  -d name value : display the value in the named register format" << std::endl
+              << "  -D name file : decode a file of hexa values of the named register, one per line, in CSV format" << std::endl
               << "  -f : force read/write register, even if not supposed to" << std::endl
+              << "  -g : display the translation granules, walk levels, contiguous ranges and TLB reach" << std::endl
               << "  -h : display this help text" << std::endl
               << "  -l : list all supported Arm64 system registers" << std::endl
               << "  -p : summary of supported PAC features" << std::endl
               << "  -r name : read the content of the named register" << std::endl
               << "  -s : summary of CPU features" << std::endl
               << "  -S : same as -s but read registers at EL0 (maybe partial, may fail)" << std::endl
+              << "  -t : display the CPU topology, core classes, caches and clusters" << std::endl
               << "  -w name hex-value : write the value in the named register" << std::endl
               << "  -v : verbose, display register analysis and fields" << std::endl
+              << "  --binary : with -a, -d, -r, -s, output fixed-size binary records" << std::endl
+              << "  --json : with -a, -d, -r, -s, output one JSON object per line" << std::endl
+              << "  --watch name,... : periodically read the named registers, display the changed bitfields" << std::endl
+              << "  --interval us : with --watch, interval between samples in microseconds (default: 1000)" << std::endl
+              << "  --count n : with --watch, stop after n samples (default: until interrupted)" << std::endl
+              << "  --cpu n : with --watch, read the registers on CPU core n (default: any)" << std::endl
+              << "  --notify : with --watch, let the kernel module compare the registers on all CPU cores" << std::endl
+              << "             every --interval and wake up on changes only (Linux only, minimum interval: 1000)" << std::endl
+              << "  --working-set bytes : with -g, recommend a mapping size for a working set" << std::endl
+              << "  --tlb-entries n : with -g, number of TLB entries for the TLB reach (default: 1024)" << std::endl
+              << "  --stats : display the number and latency of calls to the kernel module, per register (on stderr)" << std::endl
               << std::endl;
     ::exit(EXIT_FAILURE);
 }
@@ -87,16 +133,32 @@ Options::Options(int argc, char* argv[]) :
     read_register(),
     write_register(),
     display_register(),
+    decode_register(),
+    decode_file(),
+    watch_registers(),
+    watch_interval(1000),
+    watch_count(0),
+    watch_cpu(CSR_CPU_ANY),
+    working_set(0),
+    tlb_entries(1024),
     write_value{0, 0},
     display_value{0, 0},
     all_registers(false),
     binary(false),
+    all_cpus(false),
+    changes_only(false),
     force(false),
     list_registers(false),
     cpu_summary(false),
     direct_load(false),
+    granules(false),
     pac_summary(false),
-    verbose(false)
+    topology(false),
+    verbose(false),
+    json(false),
+    binary_records(false),
+    watch_notify(false),
+    stats(false)
 {
     for (int i = 1; i < argc; ++i) {
         const std::string arg(argv[i]);
@@ -118,15 +180,28 @@ Options::Options(int argc, char* argv[]) :
                 fatal("invalid hexa value to display");
             }
         }
+        else if (arg == "-D" && i+2 < argc) {
+            decode_register = argv[++i];
+            decode_file = argv[++i];
+        }
         else if (arg == "-a") {
             all_registers = true;
         }
         else if (arg == "-b") {
             binary = true;
         }
+        else if (arg == "-c") {
+            all_cpus = true;
+        }
+        else if (arg == "-C") {
+            changes_only = true;
+        }
         else if (arg == "-f") {
             force = true;
         }
+        else if (arg == "-g") {
+            granules = true;
+        }
         else if (arg == "-l") {
             list_registers = true;
         }
@@ -139,13 +214,49 @@ Options::Options(int argc, char* argv[]) :
         else if (arg == "-S") {
             cpu_summary = direct_load = true;
         }
+        else if (arg == "-t") {
+            topology = true;
+        }
         else if (arg == "-v") {
             verbose = true;
         }
+        else if (arg == "--json") {
+            json = true;
+        }
+        else if (arg == "--binary") {
+            binary_records = true;
+        }
+        else if (arg == "--watch" && i+1 < argc) {
+            watch_registers = argv[++i];
+        }
+        else if (arg == "--interval" && i+1 < argc) {
+            watch_interval = std::strtoull(argv[++i], nullptr, 0);
+        }
+        else if (arg == "--count" && i+1 < argc) {
+            watch_count = std::strtoull(argv[++i], nullptr, 0);
+        }
+        else if (arg == "--cpu" && i+1 < argc) {
+            watch_cpu = std::strtoull(argv[++i], nullptr, 0);
+        }
+        else if (arg == "--notify") {
+            watch_notify = true;
+        }
+        else if (arg == "--working-set" && i+1 < argc) {
+            working_set = std::strtoull(argv[++i], nullptr, 0);
+        }
+        else if (arg == "--tlb-entries" && i+1 < argc) {
+            tlb_entries = std::max<csr_u64_t>(1, std::strtoull(argv[++i], nullptr, 0));
+        }
+        else if (arg == "--stats") {
+            stats = true;
+        }
         else {
             fatal("invalid option '" + arg + "', try --help");
         }
     }
+    if (json && binary_records) {
+        fatal("--json and --binary are mutually exclusive");
+    }
 }
 
 
@@ -170,7 +281,7 @@ void ListRegisters(const Options& opt, std::ostream& out)
         << Pad("", name_width, '-') << "  " << Pad("", feature_width, '-') << std::endl;
 
     for (const auto& desc : RegView::AllRegisters) {
-        out << Pad(desc.name, name_width, ' ') << "  "
+        out << Pad(std::string(desc.name), name_width, ' ') << "  "
             << desc.featuresList() << std::endl;
     }
     out << std::endl;
@@ -181,9 +292,12 @@ void ListRegisters(const Options& opt, std::ostream& out)
 // Read or display a register
 //----------------------------------------------------------------------------
 
-void DisplayRegisterValue(const Options& opt, const RegView::Register& desc, const csr_pair_t& reg, std::ostream& out)
+void DisplayRegisterValue(const Options& opt, const RegView::Register& desc, const csr_pair_t& reg, std::ostream& out, RegRecordWriter* records, int cpu = -1)
 {
-    if (opt.verbose) {
+    if (records != nullptr) {
+        records->writeRegister(desc, reg, cpu);
+    }
+    else if (opt.verbose) {
         out << std::endl;
         desc.display(out, reg);
         out << std::endl;
@@ -199,7 +313,7 @@ void DisplayRegisterValue(const Options& opt, const RegView::Register& desc, con
     }
 }
 
-void ReadRegister(const Options& opt, std::ostream& out)
+void ReadRegister(const Options& opt, std::ostream& out, RegRecordWriter* records)
 {
     RegAccess regaccess(false, true);
 
@@ -211,23 +325,109 @@ void ReadRegister(const Options& opt, std::ostream& out)
         opt.fatal("register " + opt.read_register + " is not readable on this CPU, try -f at your own risks");
     }
 
+    if (opt.all_cpus) {
+        // Read the register on all CPU cores at once.
+        std::vector<std::vector<csr_multi_reg_t>> table;
+        if (!regaccess.readOnAllCpus({desc.csr_index}, table)) {
+            regaccess.printLastError(opt.command + ": error reading " + opt.read_register);
+        }
+        for (size_t cpu = 0; cpu < table.size(); cpu++) {
+            if (records != nullptr) {
+                records->writeRegister(desc, table[cpu][0].value, int(cpu), int(table[cpu][0].status));
+                continue;
+            }
+            out << "CPU " << cpu << ": ";
+            if (table[cpu][0].status == 0) {
+                DisplayRegisterValue(opt, desc, table[cpu][0].value, out, nullptr);
+            }
+            else {
+                out << (table[cpu][0].status == 3 ? "offline" : "not readable") << std::endl;
+            }
+        }
+        return;
+    }
+
     csr_pair_t reg;
     if (!regaccess.read(desc.csr_index, reg)) {
         regaccess.printLastError(opt.command + ": error reading " + opt.read_register);
     }
     else {
-        DisplayRegisterValue(opt, desc, reg, out);
+        DisplayRegisterValue(opt, desc, reg, out, records);
     }
 }
 
-void DisplayRegister(const Options& opt, std::ostream& out)
+void DisplayRegister(const Options& opt, std::ostream& out, RegRecordWriter* records)
 {
     const auto& desc(RegView::getRegister(opt.display_register));
     if (!desc.isValid()) {
         opt.fatal("unknown register " + opt.display_register + ", try -l");
     }
     else {
-        DisplayRegisterValue(opt, desc, opt.display_value, out);
+        DisplayRegisterValue(opt, desc, opt.display_value, out, records);
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Decode a file of register values
+//----------------------------------------------------------------------------
+
+void DecodeFile(const Options& opt, std::ostream& out)
+{
+    const auto& desc(RegView::getRegister(opt.decode_register));
+    if (!desc.isValid()) {
+        opt.fatal("unknown register " + opt.decode_register + ", try -l");
+    }
+
+    // Load all values, one per line, with optional 0x prefix.
+    std::ifstream in(opt.decode_file);
+    if (!in) {
+        opt.fatal("cannot open " + opt.decode_file);
+    }
+    std::vector<csr_u64_t> values;
+    std::string line;
+    for (size_t line_number = 1; std::getline(in, line); line_number++) {
+        const size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos) {
+            continue; // empty line
+        }
+        const bool prefix = line.compare(start, 2, "0x") == 0 || line.compare(start, 2, "0X") == 0;
+        csr_u64_t value = 0;
+        if (!DecodeHexa(value, line.substr(prefix ? start + 2 : start))) {
+            opt.fatal(Format("%s: invalid hexa value at line %zu", opt.decode_file.c_str(), line_number));
+        }
+        values.push_back(value);
+    }
+
+    const RegDecoder decoder(desc);
+    if (opt.changes_only) {
+        std::vector<RegDecoder::Change> changes;
+        decoder.decodeChanges(values, changes);
+        out << "index,field,previous,value" << std::endl;
+        for (const auto& ch : changes) {
+            out << ch.index << "," << desc.fields[ch.field].name << "," << Format("0x%llX,0x%llX", ch.previous, ch.value) << std::endl;
+        }
+    }
+    else if (desc.fields.empty()) {
+        // No bitfield, just the values.
+        out << "value" << std::endl;
+        for (auto val : values) {
+            out << Format("0x%llX", val) << std::endl;
+        }
+    }
+    else {
+        std::vector<std::vector<csr_u64_t>> columns;
+        decoder.decode(values, columns);
+        for (size_t f = 0; f < desc.fields.size(); f++) {
+            out << (f > 0 ? "," : "") << desc.fields[f].name;
+        }
+        out << std::endl;
+        for (size_t i = 0; i < values.size(); i++) {
+            for (size_t f = 0; f < columns.size(); f++) {
+                out << (f > 0 ? ",0x" : "0x") << Format("%llX", columns[f][i]);
+            }
+            out << std::endl;
+        }
     }
 }
 
@@ -250,9 +450,25 @@ void WriteRegister(const Options& opt, std::ostream& out)
     if (opt.verbose) {
         out << opt.command << ": writing " << desc.hexa(opt.write_value) << " " << desc.name << std::endl;
     }
-    if (!regaccess.write(desc.csr_index, opt.write_value)) {
+    if (!desc.canRead(regaccess)) {
+        // Write-only register, cannot verify.
+        if (!regaccess.write(desc.csr_index, opt.write_value)) {
+            regaccess.printLastError(opt.command + ": error writing " + opt.write_register);
+        }
+        return;
+    }
+
+    // Write and read back the register in one call.
+    csr_pair_t observed;
+    if (!regaccess.writeVerify(desc.csr_index, opt.write_value, observed)) {
         regaccess.printLastError(opt.command + ": error writing " + opt.write_register);
     }
+    else if (observed.low != opt.write_value.low || (desc.isPair() && observed.high != opt.write_value.high)) {
+        std::cerr << opt.command << ": warning: " << desc.name << " reads back as " << desc.hexa(observed) << std::endl;
+    }
+    else if (opt.verbose) {
+        out << opt.command << ": verified " << desc.hexa(observed) << " " << desc.name << std::endl;
+    }
 }
 
 
@@ -260,122 +476,277 @@ void WriteRegister(const Options& opt, std::ostream& out)
 // Read all registers
 //----------------------------------------------------------------------------
 
-void ReadAllRegisters(const Options& opt, std::ostream& out)
+void ReadAllRegisters(const Options& opt, std::ostream& out, RegRecordWriter* records)
 {
-    size_t name_width = 0;
-    if (!opt.verbose) {
-        for (const auto& desc : RegView::AllRegisters) {
-            name_width = std::max(name_width, desc.name.length());
-        }
-        out << std::endl;
-    }
-
-    // Loop on all registers.
     RegAccess regaccess(true, true);
-    for (const auto& desc : RegView::AllRegisters) {
-        csr_pair_t reg;
-        // Check if this register is readable and compatible with the CPU features.
-        if (desc.canRead(regaccess) && regaccess.read(desc.csr_index, reg)) {
-            if (opt.verbose) {
-                out << std::endl;
-                desc.display(out, reg);
-            }
-            else {
-                out << Pad(desc.name, name_width, ' ') << "  " << desc.hexa(reg) << std::endl;
-            }
-        }
-    }
-    out << std::endl;
+    RegistersReport(out, regaccess, ArmFeatures::instance(), opt.verbose, records, opt.command);
 }
 
 
 //----------------------------------------------------------------------------
-// Display a summary of PAC features.
+// Watch registers and display the changes.
 //----------------------------------------------------------------------------
 
-void PACLayout(ArmPseudoCode& code, std::ostream& out, bool upper, bool is_instr)
+// Set by SIGINT to stop the watch loop.
+static volatile std::sig_atomic_t WatchInterrupted = 0;
+
+extern "C" void WatchSignalHandler(int)
 {
-    const csr_u64_t address = upper ? ~0ull : 0;
-    const int top = code.pacTopBit(address, is_instr);
-    const int sel = code.pacSelBit(address, is_instr);
-    const int bottom = code.pacBottomBit(address, is_instr);
+    WatchInterrupted = 1;
+}
 
-    std::string layout;
-    if (bottom < 55 && 55 < top) {
-        layout = Format("%d:56,54:%d", top, bottom);
+// Display the changes in one register, all bitfields when previous is null.
+void DisplayChanges(const RegView::Register& desc, const csr_pair_t& value, const csr_pair_t* previous, double seconds, std::string& buffer, std::ostream& out)
+{
+    buffer.clear();
+    if (desc.fields.empty()) {
+        if (previous == nullptr || previous->low != value.low || previous->high != value.high) {
+            AppendFormat(buffer, "[%.6f] ", seconds);
+            buffer.append(desc.name);
+            buffer.append(": ");
+            if (previous != nullptr) {
+                desc.appendHexa(buffer, *previous);
+                buffer.append(" -> ");
+            }
+            desc.appendHexa(buffer, value);
+            buffer.append(1, '\n');
+        }
     }
     else {
-        layout = Format("%d:%d", top == 55 ? 54 : top, bottom == 55 ? 56 : bottom);
+        for (const auto& bf : desc.fields) {
+            const csr_u64_t bfval = RegView::Register::fieldValue(bf, value);
+            const csr_u64_t bfprev = previous == nullptr ? 0 : RegView::Register::fieldValue(bf, *previous);
+            if (previous == nullptr || bfval != bfprev) {
+                const int hexwidth = (bf.msb - bf.lsb) / 4 + 1;
+                AppendFormat(buffer, "[%.6f] ", seconds);
+                buffer.append(desc.name);
+                buffer.append(1, '.');
+                buffer.append(bf.name);
+                buffer.append(": ");
+                if (previous != nullptr) {
+                    buffer.append("0x");
+                    AppendHexaDigits(buffer, bfprev, hexwidth);
+                    buffer.append(" -> ");
+                }
+                buffer.append("0x");
+                AppendHexaDigits(buffer, bfval, hexwidth);
+                const RegView::Name* valname = RegView::Register::findValue(bf, bfval);
+                if (valname != nullptr) {
+                    buffer.append(" (");
+                    buffer.append(valname->name);
+                    buffer.append(1, ')');
+                }
+                buffer.append(1, '\n');
+            }
+        }
     }
-
-    out << Format("  %-5s (%s): PAC size: %2d bits, bit range: %11s (top: %2d, sel: %2d, bottom: %2d)",
-                  is_instr ? "Instr" : "Data", upper ? "upper" : "lower",
-                  code.pacSize(address, is_instr), layout.c_str(), top, sel, bottom)
-        << std::endl;
+    out.write(buffer.data(), std::streamsize(buffer.size()));
 }
 
-void PointerAuthenticationSummary(const Options& opt, std::ostream& out)
+// Watch registers using the kernel module, wake up only on changes.
+bool NotifyChanges(const Options& opt, RegAccess& regaccess, const std::vector<const RegView::Register*>& descs, std::ostream& out)
 {
-    RegAccess regaccess(true, true);
-    ArmFeatures feat(regaccess);
+    std::vector<int> regids;
+    for (const auto* desc : descs) {
+        regids.push_back(desc->csr_index);
+    }
+
+    // Initial values on all CPU cores, then start the watch in the kernel.
+    using clock = std::chrono::steady_clock;
+    const clock::time_point start_time = clock::now();
+    std::vector<std::vector<csr_multi_reg_t>> previous;
+    std::vector<std::vector<csr_multi_reg_t>> current;
+    if (!regaccess.readOnAllCpus(regids, previous) ||
+        !regaccess.startWatch(regids, std::max<csr_u64_t>(opt.watch_interval * 1000, CSR_WATCH_MIN_PERIOD)))
+    {
+        regaccess.printLastError(opt.command);
+        return false;
+    }
+    std::string buffer;
+    for (size_t i = 0; i < descs.size(); i++) {
+        for (const auto& cpu : previous) {
+            if (cpu.size() == descs.size() && cpu[i].status == 0) {
+                DisplayChanges(*descs[i], cpu[i].value, nullptr, 0.0, buffer, out);
+                break;
+            }
+        }
+    }
+    out.flush();
+
+    // The event only tells that something changed, read again on all CPU cores for the details.
+    csr_u64_t events = 0;
+    csr_u64_t changes = 0;
+    bool success = true;
+    while (!WatchInterrupted && (opt.watch_count == 0 || events < opt.watch_count)) {
+        csr_watch_event_t event;
+        if (!regaccess.waitForChange(event, 500)) {
+            regaccess.printLastError(opt.command);
+            success = false;
+            break;
+        }
+        if (event.changed == 0) {
+            continue;
+        }
+        events++;
+        if (!regaccess.readOnAllCpus(regids, current)) {
+            regaccess.printLastError(opt.command);
+            success = false;
+            break;
+        }
+        const double seconds = std::chrono::duration<double>(clock::now() - start_time).count();
+        for (size_t cpu = 0; cpu < current.size() && cpu < previous.size(); cpu++) {
+            bool header = false;
+            for (size_t i = 0; i < descs.size() && i < current[cpu].size() && i < previous[cpu].size(); i++) {
+                const csr_multi_reg_t& prev(previous[cpu][i]);
+                const csr_multi_reg_t& cur(current[cpu][i]);
+                if (cur.status == 0 && prev.status == 0 && (cur.value.low != prev.value.low || cur.value.high != prev.value.high)) {
+                    if (!header) {
+                        out << Format("[%.6f] CPU %zu:", seconds, cpu) << std::endl;
+                        header = true;
+                    }
+                    DisplayChanges(*descs[i], cur.value, &prev.value, seconds, buffer, out);
+                    changes++;
+                }
+            }
+        }
+        out.flush();
+        previous.swap(current);
+    }
+    regaccess.stopWatch();
 
-    out << std::endl
-        << "Summary: PAC: " << YesNo(feat.FEAT_PAuth())
-        << ", PACGA: " << YesNo(feat.hasPACGA())
-        << std::endl
-        << "PAuth: " << YesNo(feat.FEAT_PAuth())
-        << ", PAuth2: " << YesNo(feat.FEAT_PAuth2())
-        << ", EPAC: " << YesNo(feat.FEAT_EPAC())
-        << ", FPAC: " << YesNo(feat.FEAT_FPAC())
-        << ", FPACCOMBINE: " << YesNo(feat.FEAT_FPACCOMBINE())
-        << ", CONSTPACFIELD: " << YesNo(feat.FEAT_CONSTPACFIELD())
-        << std::endl
-        << "Algorithms: QARMA3: " << YesNo(feat.FEAT_PACQARMA3())
-        << ", QARMA5: " << YesNo(feat.FEAT_PACQARMA5())
-        << ", implementation-defined: " << YesNo(feat.FEAT_PACIMP())
-        << std::endl
-        << "Memory tagging: " << YesNo(feat.addressTaggingEnabled()) << std::endl;
-    if (feat.FEAT_PAuth()) {
-        ArmPseudoCode code(regaccess);
-        out << "Detailed PAC layout:" << std::endl
-            << "  TCR_EL1: TBI0=" << feat.TCR_EL1_TBI0()
-            << ", TBID0=" << feat.TCR_EL1_TBID0()
-            << ", T0SZ=" << feat.TCR_EL1_T0SZ()
-            << ", TBI1=" << feat.TCR_EL1_TBI1()
-            << ", TBID1=" << feat.TCR_EL1_TBID1()
-            << ", T1SZ=" << feat.TCR_EL1_T1SZ()
-            << std::endl;
-        PACLayout(code, out, false, false);
-        PACLayout(code, out, true, false);
-        PACLayout(code, out, false, true);
-        PACLayout(code, out, true, true);
+    const double elapsed = std::chrono::duration<double>(clock::now() - start_time).count();
+    std::cerr << opt.command << ": " << Format("%llu change events in %.3f seconds, %llu register changes", events, elapsed, changes)
+              << std::endl;
+    return success;
+}
+
+bool WatchRegisters(const Options& opt, std::ostream& out)
+{
+    // Get the list of registers to watch, read them at once.
+    // The errors are reported here, with the name of the command.
+    RegAccess regaccess(false, true);
+    std::vector<const RegView::Register*> descs;
+    std::vector<csr_multi_reg_t> regs;
+    size_t start = 0;
+    while (start < opt.watch_registers.size()) {
+        size_t end = opt.watch_registers.find(',', start);
+        end = end == std::string::npos ? opt.watch_registers.size() : end;
+        const std::string name(opt.watch_registers.substr(start, end - start));
+        start = end + 1;
+        if (!name.empty()) {
+            const auto& desc(RegView::getRegister(name));
+            if (!desc.isValid()) {
+                opt.fatal("unknown register " + name + ", try -l");
+            }
+            if (!opt.force && !desc.canRead(regaccess)) {
+                opt.fatal("register " + name + " is not readable on this CPU, try -f at your own risks");
+            }
+            descs.push_back(&desc);
+            regs.push_back(csr_multi_reg_t{csr_u64_t(desc.csr_index), 0, {0, 0}});
+        }
     }
-    out << std::endl;
+    if (regs.empty()) {
+        opt.fatal("no register to watch");
+    }
+
+    // Stop on Ctrl-C, display the summary.
+    WatchInterrupted = 0;
+    std::signal(SIGINT, WatchSignalHandler);
+    if (opt.watch_notify) {
+        return NotifyChanges(opt, regaccess, descs, out);
+    }
+
+    // The rate limiter schedules the samples at fixed deadlines. When a sample
+    // is late, the next deadlines restart from the current time, the missed
+    // samples are not compensated by a burst.
+    using clock = std::chrono::steady_clock;
+    const clock::duration interval = std::chrono::microseconds(opt.watch_interval);
+    const clock::time_point start_time = clock::now();
+    clock::time_point deadline = start_time;
+    std::vector<csr_multi_reg_t> previous;
+    std::string buffer;
+    csr_u64_t samples = 0;
+    csr_u64_t changes = 0;
+    csr_u64_t late = 0;
+
+    bool success = true;
+    while (!WatchInterrupted && (opt.watch_count == 0 || samples < opt.watch_count)) {
+        if (!regaccess.readMany(regs, opt.watch_cpu)) {
+            regaccess.printLastError(opt.command);
+            success = false;
+            break;
+        }
+        const double seconds = std::chrono::duration<double>(clock::now() - start_time).count();
+        for (size_t i = 0; i < regs.size(); i++) {
+            const bool first = previous.empty();
+            if (regs[i].status != 0) {
+                if (first || previous[i].status != regs[i].status) {
+                    out << Format("[%.6f] ", seconds) << descs[i]->name << ": "
+                        << (regs[i].status == 2 ? "CPU feature not supported" : "not readable") << std::endl;
+                }
+            }
+            else if (first || previous[i].status != 0) {
+                DisplayChanges(*descs[i], regs[i].value, nullptr, seconds, buffer, out);
+            }
+            else if (previous[i].value.low != regs[i].value.low || previous[i].value.high != regs[i].value.high) {
+                DisplayChanges(*descs[i], regs[i].value, &previous[i].value, seconds, buffer, out);
+                changes++;
+            }
+        }
+        out.flush();
+        previous.swap(regs);
+        if (regs.empty()) {
+            regs = previous;
+        }
+        samples++;
+
+        // Wait for the next sample.
+        deadline += interval;
+        const clock::time_point now = clock::now();
+        if (deadline < now) {
+            late += opt.watch_interval > 0;
+            deadline = now;
+        }
+        else {
+            std::this_thread::sleep_until(deadline);
+        }
+    }
+
+    const double elapsed = std::chrono::duration<double>(clock::now() - start_time).count();
+    std::cerr << opt.command << ": " << Format("%llu samples in %.3f seconds, %.1f samples/s, %llu changes, %llu late samples",
+                                               samples, elapsed, elapsed > 0 ? double(samples) / elapsed : 0.0, changes, late)
+              << std::endl;
+    return success;
 }
 
 
 //----------------------------------------------------------------------------
-// Descriptions of all Arm features.
+// Display a summary of PAC features.
 //----------------------------------------------------------------------------
 
-class Feature
+void PointerAuthenticationSummary(const Options& opt, std::ostream& out)
 {
-public:
-    std::string name;                  // Feature name
-    bool (ArmFeatures::*get)() const;  // Method to get that feature
-};
+    RegAccess regaccess(true, true);
+    PACReport(out, regaccess, ArmFeatures::instance());
+}
 
-const std::list<Feature> AllArmFeatures {
-    // Automatically generated file:
-    #include "_armfeatures.h"
-};
+
+//----------------------------------------------------------------------------
+// Display the translation granules and TLB reach.
+//----------------------------------------------------------------------------
+
+void GranulesSummary(const Options& opt, std::ostream& out)
+{
+    RegAccess regaccess(true, true);
+    TranslationReport(out, regaccess, ArmFeatures::instance(), opt.working_set, opt.tlb_entries);
+}
 
 
 //----------------------------------------------------------------------------
 // Display a summary of CPU features.
 //----------------------------------------------------------------------------
 
-void FeaturesSummary(const Options& opt, std::ostream& out)
+void FeaturesSummary(const Options& opt, std::ostream& out, RegRecordWriter* records)
 {
     ArmFeatures features;
     if (opt.direct_load) {
@@ -383,17 +754,13 @@ void FeaturesSummary(const Options& opt, std::ostream& out)
         features.loadDirect();
     }
     else {
-        // Read system registers at EL1 (call the kernel module).
+        // Read system registers at EL1 (call the kernel module) or EL0 when faster and identical.
         RegAccess regaccess(true, true);
-        features.load(regaccess);
-    }
-
-    size_t name_width = 0;
-    for (const auto& feat : AllArmFeatures) {
-        name_width = std::max(name_width, feat.name.length());
+        features.loadFastest(regaccess);
     }
-    for (const auto& feat : AllArmFeatures) {
-        out << Pad(feat.name + " ", name_width + 2) << " " << YesNo((features.*feat.get)()) << std::endl;
+    FeaturesReport(out, features, records);
+    if (!opt.direct_load && records == nullptr) {
+        RegSourceReport(out, RegSource::instance());
     }
 }
 
@@ -405,27 +772,57 @@ void FeaturesSummary(const Options& opt, std::ostream& out)
 int main(int argc, char* argv[])
 {
     const Options opt(argc, argv);
+    if (opt.stats) {
+        RegAccess::enableStats();
+    }
+
+    // Optional machine-readable output, instead of text.
+    std::unique_ptr<RegRecordWriter> records;
+    if (opt.json || opt.binary_records) {
+#if defined(WINDOWS)
+        if (opt.binary_records) {
+            _setmode(_fileno(stdout), _O_BINARY);
+        }
+#endif
+        records.reset(new RegRecordWriter(std::cout, opt.json ? RegRecordWriter::JSON : RegRecordWriter::BINARY));
+    }
 
     if (opt.list_registers) {
         ListRegisters(opt, std::cout);
     }
     if (opt.all_registers) {
-        ReadAllRegisters(opt, std::cout);
+        ReadAllRegisters(opt, std::cout, records.get());
     }
     if (!opt.display_register.empty()) {
-        DisplayRegister(opt, std::cout);
+        DisplayRegister(opt, std::cout, records.get());
+    }
+    if (!opt.decode_register.empty()) {
+        DecodeFile(opt, std::cout);
     }
     if (!opt.write_register.empty()) {
         WriteRegister(opt, std::cout);
     }
     if (!opt.read_register.empty()) {
-        ReadRegister(opt, std::cout);
+        ReadRegister(opt, std::cout, records.get());
+    }
+    if (!opt.watch_registers.empty() && !WatchRegisters(opt, std::cout)) {
+        return EXIT_FAILURE;
     }
     if (opt.pac_summary) {
         PointerAuthenticationSummary(opt, std::cout);
     }
     if (opt.cpu_summary) {
-        FeaturesSummary(opt, std::cout);
+        FeaturesSummary(opt, std::cout, records.get());
+    }
+    if (opt.granules) {
+        GranulesSummary(opt, std::cout);
+    }
+    if (opt.topology) {
+        TopologyReport(std::cout, CpuTopology::instance());
+    }
+    if (opt.stats) {
+        // On standard error, not mixed with machine-readable output.
+        StatsReport(std::cerr);
     }
 
     return EXIT_SUCCESS;
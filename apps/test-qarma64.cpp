@@ -7,19 +7,173 @@
 // Test program for QARMA implementation.
 // Test vectors from https://eprint.iacr.org/2016/444.pdf
 //
+// With option --bench, time the implementations and display CSV results.
+//
 //----------------------------------------------------------------------------
 
 #include "qarma64.h"
 #include "strutils.h"
+#include "userfeatures.h"
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#if defined(__aarch64__) || defined(__arm64__) || defined(_M_ARM64)
+    #define ARM64 1
+#endif
 
 static const char* Status(uint64_t value, uint64_t expected)
 {
     return value == expected ? "ok" : "FAIL";
 }
 
-int main()
+
+//----------------------------------------------------------------------------
+// Benchmark mode.
+//----------------------------------------------------------------------------
+
+// Timer in nanoseconds, using the virtual counter on Arm64.
+#if defined(ARM64) && !defined(_MSC_VER)
+static uint64_t CounterFrequency()
+{
+    uint64_t freq = 0;
+    asm volatile("mrs %0, cntfrq_el0" : "=r" (freq));
+    return freq;
+}
+static uint64_t Counter()
+{
+    uint64_t counter = 0;
+    asm volatile("isb \n mrs %0, cntvct_el0" : "=r" (counter));
+    return counter;
+}
+#else
+static uint64_t CounterFrequency()
+{
+    return 1000000000;
+}
+static uint64_t Counter()
+{
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+#endif
+
+// Number of blocks per sample, number of warm-up and measured samples.
+static constexpr size_t BENCH_BLOCKS = 1024;
+static constexpr size_t BENCH_WARMUP = 10;
+static constexpr size_t BENCH_SAMPLES = 201;
+
+// Time a function which processes BENCH_BLOCKS blocks, display one CSV line.
+// The CPU frequency in MHz is optional, used to convert times in cycles.
+static void Bench(const std::string& name, int sbox, int rounds, double mhz, const std::function<void()>& func)
+{
+    static const double freq = double(CounterFrequency());
+    std::vector<double> ns(BENCH_SAMPLES);
+    for (size_t i = 0; i < BENCH_WARMUP; i++) {
+        func();
+    }
+    for (auto& t : ns) {
+        const uint64_t start = Counter();
+        func();
+        t = double(Counter() - start) * 1e9 / freq / BENCH_BLOCKS;
+    }
+    std::sort(ns.begin(), ns.end());
+    const double median = ns[ns.size() / 2];
+    const double p99 = ns[(ns.size() * 99 + 99) / 100 - 1];
+
+    std::cout << name << "," << (sbox < 0 ? "" : std::to_string(sbox)) << "," << (rounds < 0 ? "" : std::to_string(rounds)) << ","
+              << Format("%.2f,%.2f,", median, p99)
+              << (mhz > 0 ? Format("%.1f,%.1f", median * mhz / 1000, p99 * mhz / 1000) : ",") << std::endl;
+}
+
+static int Benchmark(double mhz)
 {
+    std::cout << "# counter_frequency," << CounterFrequency() << std::endl
+              << "function,sbox,rounds,median_ns_per_block,p99_ns_per_block,median_cycles_per_block,p99_cycles_per_block" << std::endl;
+
+    std::vector<uint64_t> texts(BENCH_BLOCKS), tweaks(BENCH_BLOCKS), output(BENCH_BLOCKS);
+    uint64_t x = 0x9E3779B97F4A7C15;
+    for (size_t i = 0; i < BENCH_BLOCKS; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        texts[i] = x;
+        tweaks[i] = x * 0xD1B54A32D192ED03;
+    }
+    const uint64_t w0 = 0x84BE85CE9804E94B;
+    const uint64_t k0 = 0xEC2802D4E0A488E9;
+    volatile uint64_t sink = 0;
+
+    Qarma64 qarma;
+    for (int sbox = 0; sbox <= 2; sbox++) {
+        qarma.setSbox(size_t(sbox));
+        for (int rounds = 5; rounds <= 7; rounds++) {
+            qarma.setRounds(rounds);
+            const Qarma64::Key key(qarma.makeKey(w0, k0));
+            Bench("encryptReference", sbox, rounds, mhz, [&]() {
+                for (size_t i = 0; i < BENCH_BLOCKS; i++) {
+                    output[i] = qarma.encryptReference(texts[i], tweaks[i], w0, k0);
+                }
+            });
+            Bench("encrypt", sbox, rounds, mhz, [&]() {
+                for (size_t i = 0; i < BENCH_BLOCKS; i++) {
+                    output[i] = qarma.encrypt(texts[i], tweaks[i], w0, k0);
+                }
+            });
+            Bench("encrypt_key", sbox, rounds, mhz, [&]() {
+                for (size_t i = 0; i < BENCH_BLOCKS; i++) {
+                    output[i] = qarma.encrypt(texts[i], tweaks[i], key);
+                }
+            });
+            Bench("encryptBatch", sbox, rounds, mhz, [&]() {
+                qarma.encryptBatch(output.data(), texts, tweaks, key);
+            });
+            Bench("decrypt", sbox, rounds, mhz, [&]() {
+                for (size_t i = 0; i < BENCH_BLOCKS; i++) {
+                    output[i] = qarma.decrypt(texts[i], tweaks[i], w0, k0);
+                }
+            });
+            Bench("decryptBatch", sbox, rounds, mhz, [&]() {
+                qarma.decryptBatch(output.data(), texts, tweaks, key);
+            });
+            sink = sink + output[0];
+        }
+    }
+
+#if defined(ARM64)
+    // Hardware PACGA with the current key of the process, as a dependent chain (latency).
+    if (UserFeatures::instance().FEAT_PAuth()) {
+        Bench("pacga_latency", -1, -1, mhz, [&]() {
+            uint64_t value = texts[0];
+            for (size_t i = 0; i < BENCH_BLOCKS; i++) {
+                csr_pacga(value, value, tweaks[i]);
+            }
+            sink = sink + value;
+        });
+    }
+#endif
+
+    return EXIT_SUCCESS;
+}
+
+
+//----------------------------------------------------------------------------
+// Program entry point.
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1) {
+        if (std::strcmp(argv[1], "--bench") == 0) {
+            return Benchmark(argc > 2 ? std::atof(argv[2]) : 0.0);
+        }
+        std::cerr << "Usage: " << argv[0] << " [--bench [cpu-mhz]]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
     const uint64_t w0 = 0x84BE85CE9804E94B;
     const uint64_t k0 = 0xEC2802D4E0A488E9;
     const uint64_t tweak = 0x477D469DEC0B8762;
@@ -50,7 +204,41 @@ int main()
 
             std::cout << "QARMA" << qarma.getRounds()
                       << " encrypt: " << ToHexa(cipher) << "  " << Status(cipher, ciphertext[sbox][rounds - 5]) << std::endl
-                      << "       decrypt: " << ToHexa(plain) << "  " << Status(plain, plaintext) << std::endl
+                      << "       decrypt: " << ToHexa(plain) << "  " << Status(plain, plaintext) << std::endl;
+
+            // Compare with the reference implementation on pseudo-random values.
+            uint64_t x = 0x9E3779B97F4A7C15 * (4 * sbox + size_t(rounds));
+            uint64_t errors = 0;
+            for (int i = 0; i < 10000; i++) {
+                uint64_t v[4];
+                for (auto& val : v) {
+                    // xorshift64
+                    x ^= x << 13;
+                    x ^= x >> 7;
+                    x ^= x << 17;
+                    val = x;
+                }
+                errors += qarma.encrypt(v[0], v[1], v[2], v[3]) != qarma.encryptReference(v[0], v[1], v[2], v[3]);
+                errors += qarma.decrypt(v[0], v[1], v[2], v[3]) != qarma.decryptReference(v[0], v[1], v[2], v[3]);
+            }
+            std::cout << "     reference: " << errors << " errors       " << Status(errors, 0) << std::endl;
+
+            // Batch encryption, with a count which is not a multiple of the parallel width.
+            std::vector<uint64_t> texts(1027), tweaks(texts.size()), ciphers(texts.size()), plains(texts.size());
+            for (size_t i = 0; i < texts.size(); i++) {
+                texts[i] = plaintext + 0x0123456789ABCDEF * i;
+                tweaks[i] = tweak ^ (0xFEDCBA9876543210 * i);
+            }
+            const Qarma64::Key key(qarma.makeKey(w0, k0));
+            qarma.encryptBatch(ciphers.data(), texts, tweaks, key);
+            qarma.decryptBatch(plains.data(), ciphers, tweaks, w0, k0);
+            errors = 0;
+            for (size_t i = 0; i < texts.size(); i++) {
+                errors += ciphers[i] != qarma.encrypt(texts[i], tweaks[i], w0, k0);
+                errors += plains[i] != qarma.decrypt(ciphers[i], tweaks[i], key);
+                errors += plains[i] != texts[i];
+            }
+            std::cout << "         batch: " << errors << " errors       " << Status(errors, 0) << std::endl
                       << std::endl;
         }
     }
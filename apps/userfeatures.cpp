@@ -31,259 +31,148 @@
 
 
 //----------------------------------------------------------------------------
-// Constructor.
+// Description of how to get each feature.
 //----------------------------------------------------------------------------
 
-UserFeatures::UserFeatures()
+// All features, in one single list for all systems: F(bit, hwcap-type, hwcap-flag, sysctl-name, eval).
+// On Linux, the hwcap is used when eval is null, otherwise eval uses the system registers.
+// On macOS, only the sysctl name is used. The irrelevant arguments are never expanded.
+#define CSR_USER_FEATURES(F) \
+    F(BIT_AES,     AT_HWCAP, HWCAP_AES, "hw.optional.arm.FEAT_AES", nullptr) \
+    F(BIT_BF16,    AT_HWCAP2, HWCAP2_BF16, "hw.optional.arm.FEAT_BF16", nullptr) \
+    F(BIT_BTI,     AT_HWCAP2, HWCAP2_BTI, "hw.optional.arm.FEAT_BTI", nullptr) \
+    F(BIT_CRC32,   AT_HWCAP, HWCAP_CRC32, "hw.optional.armv8_crc32", nullptr) \
+    F(BIT_CSV2,    0, 0, "hw.optional.arm.FEAT_CSV2", [](const Regs& r){ return bool((r.pfr0 >> 56) & 0x0F); }) \
+    F(BIT_CSV3,    0, 0, "hw.optional.arm.FEAT_CSV3", [](const Regs& r){ return bool((r.pfr0 >> 60) & 0x0F); }) \
+    F(BIT_DIT,     AT_HWCAP, HWCAP_DIT, "hw.optional.arm.FEAT_DIT", nullptr) \
+    F(BIT_DOTPROD, 0, 0, "hw.optional.arm.FEAT_DotProd", [](const Regs& r){ return bool((r.isar0 >> 44) & 0x0F); }) \
+    F(BIT_DPB,     0, 0, "hw.optional.arm.FEAT_DPB", [](const Regs& r){ return (r.isar1 & 0x0F) >= 1; }) \
+    F(BIT_DPB2,    0, 0, "hw.optional.arm.FEAT_DPB2", [](const Regs& r){ return (r.isar1 & 0x0F) >= 2; }) \
+    F(BIT_ECV,     AT_HWCAP2, HWCAP2_ECV, "hw.optional.arm.FEAT_ECV", nullptr) \
+    F(BIT_FCMA,    AT_HWCAP, HWCAP_FCMA, "hw.optional.arm.FEAT_FCMA", nullptr) \
+    F(BIT_FHM,     0, 0, "hw.optional.arm.FEAT_FHM", [](const Regs& r){ return bool((r.isar0 >> 48) & 0x0F); }) \
+    F(BIT_FLAGM,   AT_HWCAP, HWCAP_FLAGM, "hw.optional.arm.FEAT_FlagM", nullptr) \
+    F(BIT_FLAGM2,  AT_HWCAP2, HWCAP2_FLAGM2, "hw.optional.arm.FEAT_FlagM2", nullptr) \
+    F(BIT_FP16,    0, 0, "hw.optional.arm.FEAT_FP16", [](const Regs& r){ uint64_t fp = (r.pfr0 >> 16) & 0x0F; return fp > 0 && fp < 15; }) \
+    F(BIT_FPAC,    0, 0, "hw.optional.arm.FEAT_FPAC", [](const Regs& r){ return ((r.isar1 >> 8) & 0x0F) >= 4 || ((r.isar1 >> 4) & 0x0F) >= 4 || ((r.isar2 >> 12) & 0x0F) >= 4; }) \
+    F(BIT_FRINTTS, 0, 0, "hw.optional.arm.FEAT_FRINTTS", [](const Regs& r){ return bool((r.isar1 >> 32) & 0x0F); }) \
+    F(BIT_I8MM,    AT_HWCAP2, HWCAP2_I8MM, "hw.optional.arm.FEAT_I8MM", nullptr) \
+    F(BIT_JSCVT,   AT_HWCAP, HWCAP_JSCVT, "hw.optional.arm.FEAT_JSCVT", nullptr) \
+    F(BIT_LRCPC,   AT_HWCAP, HWCAP_LRCPC, "hw.optional.arm.FEAT_LRCPC", nullptr) \
+    F(BIT_LRCPC2,  0, 0, "hw.optional.arm.FEAT_LRCPC2", [](const Regs& r){ return ((r.isar1 >> 20) & 0x0F) >= 2; }) \
+    F(BIT_LSE,     0, 0, "hw.optional.arm.FEAT_LSE", [](const Regs& r){ return ((r.isar0 >> 20) & 0x0F) >= 2; }) \
+    F(BIT_LSE2,    0, 0, "hw.optional.arm.FEAT_LSE2", [](const Regs& r){ return ((r.mmfr2 >> 32) & 0x0F) >= 1; }) \
+    F(BIT_MOPS,    0, 0, "hw.optional.arm.FEAT_MOPS", [](const Regs& r){ return ((r.isar2 >> 16) & 0x0F) >= 1; }) \
+    F(BIT_MTE2,    0, 0, "hw.optional.arm.FEAT_MTE2", [](const Regs& r){ return ((r.pfr1 >> 8) & 0x0F) >= 2; }) \
+    F(BIT_PAUTH,   0, 0, "hw.optional.arm.FEAT_PAuth", [](const Regs& r){ return ((r.isar1 >> 8) & 0x0F) >= 1 || ((r.isar1 >> 4) & 0x0F) >= 1 || ((r.isar2 >> 12) & 0x0F) >= 1; }) \
+    F(BIT_PAUTH2,  0, 0, "hw.optional.arm.FEAT_PAuth2", [](const Regs& r){ return ((r.isar1 >> 8) & 0x0F) >= 3 || ((r.isar1 >> 4) & 0x0F) >= 3 || ((r.isar2 >> 12) & 0x0F) >= 3; }) \
+    F(BIT_PMULL,   AT_HWCAP, HWCAP_PMULL, "hw.optional.arm.FEAT_PMULL", nullptr) \
+    F(BIT_RDM,     0, 0, "hw.optional.arm.FEAT_RDM", [](const Regs& r){ return bool((r.isar0 >> 28) & 0x0F); }) \
+    F(BIT_RNG,     0, 0, "hw.optional.arm.FEAT_RNG", [](const Regs& r){ return bool((r.isar0 >> 60) & 0x0F); }) \
+    F(BIT_SB,      AT_HWCAP, HWCAP_SB, "hw.optional.arm.FEAT_SB", nullptr) \
+    F(BIT_SHA1,    AT_HWCAP, HWCAP_SHA1, "hw.optional.arm.FEAT_SHA1", nullptr) \
+    F(BIT_SHA256,  AT_HWCAP, HWCAP_SHA2, "hw.optional.arm.FEAT_SHA256", nullptr) \
+    F(BIT_SHA512,  AT_HWCAP, HWCAP_SHA512, "hw.optional.arm.FEAT_SHA512", nullptr) \
+    F(BIT_SHA3,    AT_HWCAP, HWCAP_SHA3, "hw.optional.arm.FEAT_SHA3", nullptr) \
+    F(BIT_SME,     0, 0, "hw.optional.arm.FEAT_SME", [](const Regs& r){ return ((r.pfr1 >> 24) & 0x0F) >= 1; }) \
+    F(BIT_SPECRES, 0, 0, "hw.optional.arm.FEAT_SPECRES", [](const Regs& r){ return bool((r.isar1 >> 40) & 0x0F); }) \
+    F(BIT_SSBS,    AT_HWCAP, HWCAP_SSBS, "hw.optional.arm.FEAT_SSBS", nullptr) \
+    F(BIT_SVE,     0, 0, "hw.optional.arm.FEAT_SVE", [](const Regs& r){ return ((r.pfr0 >> 32) & 0x0F) >= 1; }) \
+    F(BIT_WFXT,    0, 0, "hw.optional.arm.FEAT_WFxT", [](const Regs& r){ return (r.isar2 & 0x0F) >= 2; })
+
 #if defined(__linux__)
-    : _reg_loaded(false), _isar0(0), _isar1(0), _isar2(0), _pfr0(0), _mmfr2(0)
+    // Use getauxval() (eval is null) or system registers as emulated by Linux kernel at EL0.
+    #define FEATURE(bit,type,flag,name,eval) {(bit), (type), (flag), (eval)},
+#elif defined(__APPLE__)
+    // Use sysctl.
+    #define FEATURE(bit,type,flag,name,eval) {(bit), (name)},
 #endif
-{
-}
 
 
 //----------------------------------------------------------------------------
-// Set a feature.
+// Constructor: load all features at once.
 //----------------------------------------------------------------------------
 
+UserFeatures::UserFeatures() :
+    _bits(0)
+{
 #if defined(__linux__)
 
-    #define FEATURE(feat,type,flag,name,eval) feature((feat), (type), (flag), (eval))
+    static const struct {
+        unsigned int bit;
+        unsigned long type;
+        unsigned long flag;
+        bool (*eval)(const Regs&);
+    } features[] = {
+        CSR_USER_FEATURES(FEATURE)
+    };
+
+    // Get all hardware capabilities and system registers once.
+    const unsigned long hwcap = ::getauxval(AT_HWCAP);
+    const unsigned long hwcap2 = ::getauxval(AT_HWCAP2);
+    Regs regs {0, 0, 0, 0, 0, 0};
+    asm("mrs %0, id_aa64pfr0_el1"  : "=r" (regs.pfr0));
+    asm("mrs %0, id_aa64pfr1_el1"  : "=r" (regs.pfr1));
+    asm("mrs %0, id_aa64isar0_el1" : "=r" (regs.isar0));
+    asm("mrs %0, id_aa64isar1_el1" : "=r" (regs.isar1));
+    #if !defined(NO_AA64ISAR2)
+        asm("mrs %0, id_aa64isar2_el1" : "=r" (regs.isar2));
+        asm("mrs %0, id_aa64mmfr2_el1" : "=r" (regs.mmfr2));
+    #endif
 
-    bool UserFeatures::feature(InitBool& feat, unsigned long type, unsigned long flag, std::function<bool()> eval)
-    {
-        if (!feat.loaded) {
-            // First time, feature not yet loaded.
-            if (eval == nullptr) {
-                // Use getauxval() to get the feature.
-                feat.value = (::getauxval(type) & (flag)) != 0;
-            }
-            else {
-                // Use system registers as emulated by Linux kernel at EL0.
-                if (!_reg_loaded) {
-                    // System registers not yet loaded.
-                    asm("mrs %0, id_aa64pfr0_el1"  : "=r" (_pfr0));
-                    asm("mrs %0, id_aa64isar0_el1" : "=r" (_isar0));
-                    asm("mrs %0, id_aa64isar1_el1" : "=r" (_isar1));
-                    #if defined(NO_AA64ISAR2)
-                        _isar2 = _mmfr2 = 0;
-                    #else
-                        asm("mrs %0, id_aa64isar2_el1" : "=r" (_isar2));
-                        asm("mrs %0, id_aa64mmfr2_el1" : "=r" (_mmfr2));
-                    #endif
-                    _reg_loaded = true;
-                }
-                // Call the lambda function to extract the feature from the register values.
-                feat.value = eval();
-            }
-            feat.loaded = true;
+    for (const auto& feat : features) {
+        bool value = false;
+        if (feat.eval != nullptr) {
+            value = feat.eval(regs);
         }
-        return feat.value;
+        else {
+            value = ((feat.type == AT_HWCAP2 ? hwcap2 : hwcap) & feat.flag) != 0;
+        }
+        _bits |= uint64_t(value) << feat.bit;
     }
 
 #elif defined(__APPLE__)
 
-    #define FEATURE(feat,type,flag,name,eval) feature((feat), (name))
-
-    bool UserFeatures::feature(InitBool& feat, const char* name)
-    {
-        if (!feat.loaded) {
-            // First time, feature not yet loaded.
+    static const struct {
+        unsigned int bit;
+        const char* name;
+    } features[] = {
+        CSR_USER_FEATURES(FEATURE)
+    };
+
+    // The sysctl values cannot change, they are read once per process, thread-safe.
+    // Each name is parsed once by the kernel. Later constructions only copy the bitmap.
+    static const uint64_t bits = []() {
+        uint64_t result = 0;
+        for (const auto& feat : features) {
             int val = 0;
             size_t len = sizeof(val);
-            feat.value = ::sysctlbyname(name, &val, &len, nullptr, 0) == 0 && val != 0;
-            feat.loaded = true;
+            if (::sysctlbyname(feat.name, &val, &len, nullptr, 0) == 0 && val != 0) {
+                result |= uint64_t(1) << feat.bit;
+            }
         }
-        return feat.value;
-    }
-
-#elif defined(WINDOWS)
-
-    // No way to get ARM features in user mode on Windows.
-    #define FEATURE(feat,type,flag,name,eval) (false)
+        return result;
+    }();
+    _bits = bits;
 
 #endif
 
+#if defined(__linux__) || defined(__APPLE__)
+    // DCZID_EL0 is always accessible at EL0, DZP reflects SCTLR_EL1.DZE as set by the kernel.
+    asm("mrs %0, dczid_el0" : "=r" (_dczid));
+#endif
 
-//----------------------------------------------------------------------------
-// Processor features.
-//----------------------------------------------------------------------------
-
-bool UserFeatures::FEAT_AES()
-{
-    return FEATURE(_aes, AT_HWCAP, HWCAP_AES, "hw.optional.arm.FEAT_AES", nullptr);
-}
-
-bool UserFeatures::FEAT_BF16()
-{
-    return FEATURE(_bf16, AT_HWCAP2, HWCAP2_BF16, "hw.optional.arm.FEAT_BF16", nullptr);
-}
-
-bool UserFeatures::FEAT_BTI()
-{
-    return FEATURE(_bti, AT_HWCAP2, HWCAP2_BTI, "hw.optional.arm.FEAT_BTI", nullptr);
-}
-
-bool UserFeatures::FEAT_CRC32()
-{
-    return FEATURE(_crc32, AT_HWCAP, HWCAP_CRC32, "hw.optional.armv8_crc32", nullptr);
-}
-
-bool UserFeatures::FEAT_CSV2()
-{
-    return FEATURE(_csv2, 0, 0, "hw.optional.arm.FEAT_CSV2", [this](){ return bool((_pfr0 >> 56) & 0x0F); });
-}
-
-bool UserFeatures::FEAT_CSV3()
-{
-    return FEATURE(_csv3, 0, 0, "hw.optional.arm.FEAT_CSV3", [this](){ return bool((_pfr0 >> 60) & 0x0F); });
-}
-
-bool UserFeatures::FEAT_DIT()
-{
-    return FEATURE(_dit, AT_HWCAP, HWCAP_DIT, "hw.optional.arm.FEAT_DIT", nullptr);
-}
-
-bool UserFeatures::FEAT_DotProd()
-{
-    return FEATURE(_dotprod, 0, 0, "hw.optional.arm.FEAT_DotProd", [this](){ return bool((_isar0 >> 44) & 0x0F); });
-}
-
-bool UserFeatures::FEAT_DPB()
-{
-    return FEATURE(_dpb, 0, 0, "hw.optional.arm.FEAT_DPB", [this](){ return (_isar1 & 0x0F) >= 1; });
-}
-
-bool UserFeatures::FEAT_DPB2()
-{
-    return FEATURE(_dpb2, 0, 0, "hw.optional.arm.FEAT_DPB2", [this](){ return (_isar1 & 0x0F) >= 2; });
-}
-
-bool UserFeatures::FEAT_ECV()
-{
-    return FEATURE(_ecv, AT_HWCAP2, HWCAP2_ECV, "hw.optional.arm.FEAT_ECV", nullptr);
-}
-
-bool UserFeatures::FEAT_FCMA()
-{
-    return FEATURE(_fcma, AT_HWCAP, HWCAP_FCMA, "hw.optional.arm.FEAT_FCMA", nullptr);
-}
-
-bool UserFeatures::FEAT_FHM()
-{
-    return FEATURE(_fhm, 0, 0, "hw.optional.arm.FEAT_FHM", [this](){ return bool((_isar0 >> 48) & 0x0F); });
-}
-
-bool UserFeatures::FEAT_FlagM()
-{
-    return FEATURE(_flagm, AT_HWCAP, HWCAP_FLAGM, "hw.optional.arm.FEAT_FlagM", nullptr);
-}
-
-bool UserFeatures::FEAT_FlagM2()
-{
-    return FEATURE(_flagm2, AT_HWCAP2, HWCAP2_FLAGM2, "hw.optional.arm.FEAT_FlagM2", nullptr);
-}
-
-bool UserFeatures::FEAT_FP16()
-{
-    return FEATURE(_fp16, 0, 0, "hw.optional.arm.FEAT_FP16",
-                   [this](){ uint64_t fp = (_pfr0 >> 16) & 0x0F; return fp > 0 && fp < 15; });
-}
-
-bool UserFeatures::FEAT_FPAC()
-{
-    return FEATURE(_fpac, 0, 0, "hw.optional.arm.FEAT_FPAC",
-                   [this](){ return ((_isar1 >> 8) & 0x0F) >= 4 || ((_isar1 >> 4) & 0x0F) >= 4 || ((_isar2 >> 12) & 0x0F) >= 4; });
-}
-
-bool UserFeatures::FEAT_FRINTTS()
-{
-    return FEATURE(_frintts, 0, 0, "hw.optional.arm.FEAT_FRINTTS", [this](){ return bool((_isar1 >> 32) & 0x0F); });
-}
-
-bool UserFeatures::FEAT_I8MM()
-{
-    return FEATURE(_i8mm, AT_HWCAP2, HWCAP2_I8MM, "hw.optional.arm.FEAT_I8MM", nullptr);
-}
-
-bool UserFeatures::FEAT_JSCVT()
-{
-    return FEATURE(_jscvt, AT_HWCAP, HWCAP_JSCVT, "hw.optional.arm.FEAT_JSCVT", nullptr);
-}
-
-bool UserFeatures::FEAT_LRCPC()
-{
-    return FEATURE(_lrcpc, AT_HWCAP, HWCAP_LRCPC, "hw.optional.arm.FEAT_LRCPC", nullptr);
-}
-
-bool UserFeatures::FEAT_LRCPC2()
-{
-    return FEATURE(_lrcpc2, 0, 0, "hw.optional.arm.FEAT_LRCPC2", [this](){ return ((_isar1 >> 20) & 0x0F) >= 2; });
-}
-
-bool UserFeatures::FEAT_LSE()
-{
-    return FEATURE(_lse, 0, 0, "hw.optional.arm.FEAT_LSE", [this](){ return ((_isar0 >> 20) & 0x0F) >= 2; });
-}
-
-bool UserFeatures::FEAT_LSE2()
-{
-    return FEATURE(_lse2, 0, 0, "hw.optional.arm.FEAT_LSE2", [this](){ return ((_mmfr2 >> 32) & 0x0F) >= 1; });
-}
-
-bool UserFeatures::FEAT_PAuth()
-{
-    return FEATURE(_pauth, 0, 0, "hw.optional.arm.FEAT_PAuth",
-                   [this](){ return ((_isar1 >> 8) & 0x0F) >= 1 || ((_isar1 >> 4) & 0x0F) >= 1 || ((_isar2 >> 12) & 0x0F) >= 1; });
-}
-
-bool UserFeatures::FEAT_PAuth2()
-{
-    return FEATURE(_pauth2, 0, 0, "hw.optional.arm.FEAT_PAuth2",
-                   [this](){ return ((_isar1 >> 8) & 0x0F) >= 3 || ((_isar1 >> 4) & 0x0F) >= 3 || ((_isar2 >> 12) & 0x0F) >= 3; });
-}
-
-bool UserFeatures::FEAT_PMULL()
-{
-    return FEATURE(_pmull, AT_HWCAP, HWCAP_PMULL, "hw.optional.arm.FEAT_PMULL", nullptr);
-}
-
-bool UserFeatures::FEAT_RDM()
-{
-    return FEATURE(_rdm, 0, 0, "hw.optional.arm.FEAT_RDM", [this](){ return bool((_isar0 >> 28) & 0x0F); });
-}
-
-bool UserFeatures::FEAT_SB()
-{
-    return FEATURE(_sb, AT_HWCAP, HWCAP_SB, "hw.optional.arm.FEAT_SB", nullptr);
-}
-
-bool UserFeatures::FEAT_SHA1()
-{
-    return FEATURE(_sha1, AT_HWCAP, HWCAP_SHA1, "hw.optional.arm.FEAT_SHA1", nullptr);
-}
-
-bool UserFeatures::FEAT_SHA256()
-{
-    return FEATURE(_sha256, AT_HWCAP, HWCAP_SHA2, "hw.optional.arm.FEAT_SHA256", nullptr);
-}
-
-bool UserFeatures::FEAT_SHA512()
-{
-    return FEATURE(_sha512, AT_HWCAP, HWCAP_SHA512, "hw.optional.arm.FEAT_SHA512", nullptr);
+    // On Windows: no way to get ARM features in user mode, all features are false.
 }
 
-bool UserFeatures::FEAT_SHA3()
-{
-    return FEATURE(_sha3, AT_HWCAP, HWCAP_SHA3, "hw.optional.arm.FEAT_SHA3", nullptr);
-}
 
-bool UserFeatures::FEAT_SPECRES()
-{
-    return FEATURE(_specres, 0, 0, "hw.optional.arm.FEAT_SPECRES", [this](){ return bool((_isar1 >> 40) & 0x0F); });
-}
+//----------------------------------------------------------------------------
+// Process-wide instance.
+//----------------------------------------------------------------------------
 
-bool UserFeatures::FEAT_SSBS()
+const UserFeatures& UserFeatures::instance()
 {
-    return FEATURE(_ssbs, AT_HWCAP, HWCAP_SSBS, "hw.optional.arm.FEAT_SSBS", nullptr);
+    // Thread-safe initialization, the first time only.
+    static const UserFeatures features;
+    return features;
 }
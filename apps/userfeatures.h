@@ -11,116 +11,138 @@
 //----------------------------------------------------------------------------
 
 #pragma once
-#include <functional>
+#include <cstddef>
 #include <cstdint>
 
 //
 // A class describing the features of an Arm64 processor as seen from
 // userland, without accessing the kernel module, Linux and macOS.
 //
+// All features are loaded at once in the constructor, in a bitmap. The object is then
+// immutable and can be used from any thread. Each feature check is an inline bit test.
+//
 class UserFeatures
 {
 public:
-    // Constructor.
+    // Constructor: load all features.
     UserFeatures();
 
+    // Get a process-wide instance, loaded only once, thread-safe.
+    static const UserFeatures& instance();
+
     // Processor features, using same names as Arm Architecture Reference Manual.
-    bool FEAT_AES();
-    bool FEAT_BF16();
-    bool FEAT_BTI();
-    bool FEAT_CRC32();
-    bool FEAT_CSV2();
-    bool FEAT_CSV3();
-    bool FEAT_DIT();
-    bool FEAT_DotProd();
-    bool FEAT_DPB();
-    bool FEAT_DPB2();
-    bool FEAT_ECV();
-    bool FEAT_FCMA();
-    bool FEAT_FHM();
-    bool FEAT_FlagM();
-    bool FEAT_FlagM2();
-    bool FEAT_FP16();
-    bool FEAT_FPAC();
-    bool FEAT_FRINTTS();
-    bool FEAT_I8MM();
-    bool FEAT_JSCVT();
-    bool FEAT_LRCPC();
-    bool FEAT_LRCPC2();
-    bool FEAT_LSE();
-    bool FEAT_LSE2();
-    bool FEAT_PAuth();
-    bool FEAT_PAuth2();
-    bool FEAT_PMULL();
-    bool FEAT_RDM();
-    bool FEAT_SB();
-    bool FEAT_SHA1();
-    bool FEAT_SHA256();
-    bool FEAT_SHA512();
-    bool FEAT_SHA3();
-    bool FEAT_SPECRES();
-    bool FEAT_SSBS();
+    bool FEAT_AES() const { return has(BIT_AES); }
+    bool FEAT_BF16() const { return has(BIT_BF16); }
+    bool FEAT_BTI() const { return has(BIT_BTI); }
+    bool FEAT_CRC32() const { return has(BIT_CRC32); }
+    bool FEAT_CSV2() const { return has(BIT_CSV2); }
+    bool FEAT_CSV3() const { return has(BIT_CSV3); }
+    bool FEAT_DIT() const { return has(BIT_DIT); }
+    bool FEAT_DotProd() const { return has(BIT_DOTPROD); }
+    bool FEAT_DPB() const { return has(BIT_DPB); }
+    bool FEAT_DPB2() const { return has(BIT_DPB2); }
+    bool FEAT_ECV() const { return has(BIT_ECV); }
+    bool FEAT_FCMA() const { return has(BIT_FCMA); }
+    bool FEAT_FHM() const { return has(BIT_FHM); }
+    bool FEAT_FlagM() const { return has(BIT_FLAGM); }
+    bool FEAT_FlagM2() const { return has(BIT_FLAGM2); }
+    bool FEAT_FP16() const { return has(BIT_FP16); }
+    bool FEAT_FPAC() const { return has(BIT_FPAC); }
+    bool FEAT_FRINTTS() const { return has(BIT_FRINTTS); }
+    bool FEAT_I8MM() const { return has(BIT_I8MM); }
+    bool FEAT_JSCVT() const { return has(BIT_JSCVT); }
+    bool FEAT_LRCPC() const { return has(BIT_LRCPC); }
+    bool FEAT_LRCPC2() const { return has(BIT_LRCPC2); }
+    bool FEAT_LSE() const { return has(BIT_LSE); }
+    bool FEAT_LSE2() const { return has(BIT_LSE2); }
+    bool FEAT_MOPS() const { return has(BIT_MOPS); }
+    bool FEAT_MTE2() const { return has(BIT_MTE2); }
+    bool FEAT_PAuth() const { return has(BIT_PAUTH); }
+    bool FEAT_PAuth2() const { return has(BIT_PAUTH2); }
+    bool FEAT_PMULL() const { return has(BIT_PMULL); }
+    bool FEAT_RDM() const { return has(BIT_RDM); }
+    bool FEAT_RNG() const { return has(BIT_RNG); }
+    bool FEAT_SB() const { return has(BIT_SB); }
+    bool FEAT_SHA1() const { return has(BIT_SHA1); }
+    bool FEAT_SHA256() const { return has(BIT_SHA256); }
+    bool FEAT_SHA512() const { return has(BIT_SHA512); }
+    bool FEAT_SHA3() const { return has(BIT_SHA3); }
+    bool FEAT_SME() const { return has(BIT_SME); }
+    bool FEAT_SPECRES() const { return has(BIT_SPECRES); }
+    bool FEAT_SSBS() const { return has(BIT_SSBS); }
+    bool FEAT_SVE() const { return has(BIT_SVE); }
+    bool FEAT_WFxT() const { return has(BIT_WFXT); }
+
+    // DC ZVA block size in bytes, from DCZID_EL0. Zero when DC ZVA is prohibited
+    // at EL0 (DZP bit) or when DCZID_EL0 cannot be read (Windows).
+    size_t dczBlockSize() const { return dczProhibited() ? 0 : size_t(4) << (_dczid & 0x0F); }
+    bool dczProhibited() const { return (_dczid & 0x10) != 0; }
 
 private:
-    // Each feature is loaded once.
-    struct InitBool {
-        bool loaded;
-        bool value;
-        InitBool() : loaded(false), value(false) {}
+    // Bit index of each feature.
+    enum : unsigned int {
+        BIT_AES,
+        BIT_BF16,
+        BIT_BTI,
+        BIT_CRC32,
+        BIT_CSV2,
+        BIT_CSV3,
+        BIT_DIT,
+        BIT_DOTPROD,
+        BIT_DPB,
+        BIT_DPB2,
+        BIT_ECV,
+        BIT_FCMA,
+        BIT_FHM,
+        BIT_FLAGM,
+        BIT_FLAGM2,
+        BIT_FP16,
+        BIT_FPAC,
+        BIT_FRINTTS,
+        BIT_I8MM,
+        BIT_JSCVT,
+        BIT_LRCPC,
+        BIT_LRCPC2,
+        BIT_LSE,
+        BIT_LSE2,
+        BIT_MOPS,
+        BIT_MTE2,
+        BIT_PAUTH,
+        BIT_PAUTH2,
+        BIT_PMULL,
+        BIT_RDM,
+        BIT_RNG,
+        BIT_SB,
+        BIT_SHA1,
+        BIT_SHA256,
+        BIT_SHA512,
+        BIT_SHA3,
+        BIT_SME,
+        BIT_SPECRES,
+        BIT_SSBS,
+        BIT_SVE,
+        BIT_WFXT,
+        BIT_COUNT
     };
+    static_assert(BIT_COUNT <= 64, "too many features for a 64-bit bitmap");
+
+    // Bitmap of all features.
+    uint64_t _bits;
 
-    // List of features.
-    InitBool _aes;
-    InitBool _bf16;
-    InitBool _bti;
-    InitBool _crc32;
-    InitBool _csv2;
-    InitBool _csv3;
-    InitBool _dit;
-    InitBool _dotprod;
-    InitBool _dpb;
-    InitBool _dpb2;
-    InitBool _ecv;
-    InitBool _fcma;
-    InitBool _fhm;
-    InitBool _flagm;
-    InitBool _flagm2;
-    InitBool _fp16;
-    InitBool _fpac;
-    InitBool _frintts;
-    InitBool _i8mm;
-    InitBool _jscvt;
-    InitBool _lrcpc;
-    InitBool _lrcpc2;
-    InitBool _lse;
-    InitBool _lse2;
-    InitBool _pauth;
-    InitBool _pauth2;
-    InitBool _pmull;
-    InitBool _rdm;
-    InitBool _sb;
-    InitBool _sha1;
-    InitBool _sha256;
-    InitBool _sha512;
-    InitBool _sha3;
-    InitBool _specres;
-    InitBool _ssbs;
+    // DCZID_EL0, always accessible at EL0. Initially prohibited (DZP set).
+    uint64_t _dczid = 0x10;
+
+    // Check a feature.
+    bool has(unsigned int bit) const { return (_bits >> bit) & 1; }
 
     // On Linux, some selected registers are available at EL0.
     // Some Arm features are only available there.
-#if defined(__linux__)
-    bool     _reg_loaded;
-    uint64_t _isar0;
-    uint64_t _isar1;
-    uint64_t _isar2;
-    uint64_t _pfr0;
-    uint64_t _mmfr2;
-#endif
-
-    // Initialize a feature.
-#if defined(__linux__)
-    bool feature(InitBool& feat, unsigned long type, unsigned long flag, std::function<bool()> eval);
-#elif defined(__APPLE__)
-    bool feature(InitBool& feat, const char* name);
-#endif
+    struct Regs {
+        uint64_t isar0;
+        uint64_t isar1;
+        uint64_t isar2;
+        uint64_t pfr0;
+        uint64_t pfr1;
+        uint64_t mmfr2;
+    };
 };
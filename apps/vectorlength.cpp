@@ -0,0 +1,117 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// SVE and SME vector lengths of the current thread.
+//
+//----------------------------------------------------------------------------
+
+#include "vectorlength.h"
+#include "regaccess.h"
+#include "userfeatures.h"
+#include <algorithm>
+
+#if defined(__linux__)
+    #include <sys/prctl.h>
+    // These definitions are missing in older system headers.
+    #if !defined(PR_SVE_SET_VL)
+        #define PR_SVE_SET_VL 50
+        #define PR_SVE_GET_VL 51
+        #define PR_SVE_VL_LEN_MASK 0xFFFF
+        #define PR_SVE_VL_INHERIT (1 << 17)
+    #endif
+    #if !defined(PR_SME_SET_VL)
+        #define PR_SME_SET_VL 63
+        #define PR_SME_GET_VL 64
+    #endif
+    // The SME length mask and flags are identical to the SVE ones.
+#endif
+
+
+//----------------------------------------------------------------------------
+// Constructor.
+//----------------------------------------------------------------------------
+
+VectorLength::VectorLength(Extension ext) :
+    _ext(ext)
+{
+    const size_t initial = current(ext);
+    if (initial == 0) {
+        return;
+    }
+#if defined(__linux__)
+    // Keep the initial flags to restore them (PR_xxx_VL_INHERIT).
+    const int get = ext == SME ? PR_SME_GET_VL : PR_SVE_GET_VL;
+    const int setcmd = ext == SME ? PR_SME_SET_VL : PR_SVE_SET_VL;
+    const int saved = ::prctl(get, 0, 0, 0, 0);
+
+    _changeable = true;
+    for (size_t bytes = MIN_BYTES; bytes <= MAX_BYTES; bytes += MIN_BYTES) {
+        const size_t actual = set(ext, bytes);
+        if (actual != 0 && std::find(_lengths.begin(), _lengths.end(), actual) == _lengths.end()) {
+            _lengths.push_back(actual);
+        }
+    }
+    if (saved >= 0) {
+        ::prctl(setcmd, saved & (PR_SVE_VL_LEN_MASK | PR_SVE_VL_INHERIT), 0, 0, 0);
+    }
+    std::sort(_lengths.begin(), _lengths.end());
+#else
+    _lengths.push_back(initial);
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Get and set the vector length of the calling thread.
+//----------------------------------------------------------------------------
+
+size_t VectorLength::current(Extension ext)
+{
+#if defined(__linux__)
+    const int vl = ::prctl(ext == SME ? PR_SME_GET_VL : PR_SVE_GET_VL, 0, 0, 0, 0);
+    return vl < 0 ? 0 : size_t(vl & PR_SVE_VL_LEN_MASK);
+#elif defined(__aarch64__)
+    // RDVL and RDSVL are undefined instructions without SVE or SME.
+    register size_t x0 asm("x0") = 0;
+    if (ext == SVE && UserFeatures::instance().FEAT_SVE()) {
+        asm volatile(".inst 0x04bf5020" : "=r" (x0));  // rdvl x0, #1
+    }
+    else if (ext == SME && UserFeatures::instance().FEAT_SME()) {
+        asm volatile(".inst 0x04bf5820" : "=r" (x0));  // rdsvl x0, #1
+    }
+    return x0;
+#else
+    return 0;
+#endif
+}
+
+size_t VectorLength::set(Extension ext, size_t bytes, bool inherit)
+{
+#if defined(__linux__)
+    const unsigned long arg = (bytes & PR_SVE_VL_LEN_MASK) | (inherit ? PR_SVE_VL_INHERIT : 0);
+    const int vl = ::prctl(ext == SME ? PR_SME_SET_VL : PR_SVE_SET_VL, arg, 0, 0, 0);
+    return vl < 0 ? 0 : size_t(vl & PR_SVE_VL_LEN_MASK);
+#else
+    // Cannot be changed, succeed only when this is the current length.
+    const size_t vl = current(ext);
+    return vl == bytes ? vl : 0;
+#endif
+}
+
+size_t VectorLength::kernelLength(Extension ext, RegAccess* regs)
+{
+    RegAccess& access(regs != nullptr ? *regs : RegAccess::shared());
+    csr_u64_t value = 0;
+    if (!access.isOpen() || !access.read(ext == SME ? CSR_REGID_SMCR_EL1 : CSR_REGID_ZCR_EL1, value)) {
+        return 0;
+    }
+    return size_t((value & 0x0F) + 1) * MIN_BYTES;
+}
+
+std::string VectorLength::name(Extension ext)
+{
+    return ext == SME ? "SME" : "SVE";
+}
@@ -0,0 +1,79 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// SVE and SME vector lengths of the current thread.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class RegAccess;
+
+//
+// The vector lengths of SVE or SME, in bytes.
+//
+// On Linux, the vector length of a thread is set by the kernel. It can be changed
+// using prctl(2) to any length which is supported by all CPU cores. The supported
+// lengths are probed by requesting all possible lengths: the kernel selects the
+// largest supported length which is not greater than the requested one.
+//
+// On macOS, the vector length cannot be changed, only the current one is reported
+// (RDVL or RDSVL instruction). On Windows, SVE and SME are not reported.
+//
+class VectorLength
+{
+public:
+    // Vector extension.
+    enum Extension {SVE, SME};
+
+    // Architectural limits of the vector length in bytes (128 to 2048 bits).
+    static constexpr size_t MIN_BYTES = 16;
+    static constexpr size_t MAX_BYTES = 256;
+
+    // Constructor: probe the supported vector lengths of an extension.
+    // The vector length of the calling thread is restored after probing.
+    VectorLength(Extension ext = SVE);
+
+    // The extension which was probed.
+    Extension extension() const { return _ext; }
+
+    // True when the extension is usable by applications.
+    bool supported() const { return !_lengths.empty(); }
+
+    // True when the vector length can be changed (Linux only).
+    bool changeable() const { return _changeable; }
+
+    // Supported vector lengths in bytes, by increasing order. Empty when not supported.
+    const std::vector<size_t>& lengths() const { return _lengths; }
+
+    // Largest supported vector length in bytes, zero when not supported.
+    size_t maxLength() const { return _lengths.empty() ? 0 : _lengths.back(); }
+
+    // Current vector length of the calling thread in bytes, zero when not supported.
+    static size_t current(Extension ext);
+
+    // Set the vector length of the calling thread. Return the actual vector length,
+    // possibly lower than requested, or zero on error. When 'inherit' is true, the
+    // vector length is kept after fork() and exec(), otherwise exec() resets it.
+    static size_t set(Extension ext, size_t bytes, bool inherit = false);
+
+    // Vector length which is programmed in ZCR_EL1 or SMCR_EL1 (LEN field), as read
+    // by the kernel module. This is a constraint, the effective length can be lower.
+    // It is normally the vector length of the calling thread, zero if not read.
+    static size_t kernelLength(Extension ext, RegAccess* regs = nullptr);
+
+    // Extension name, "SVE" or "SME".
+    static std::string name(Extension ext);
+
+private:
+    Extension _ext = SVE;
+    bool _changeable = false;
+    std::vector<size_t> _lengths;
+};
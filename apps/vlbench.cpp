@@ -0,0 +1,358 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Benchmark of a set of kernels at each supported SVE vector length.
+//
+// The vector length of the process is successively set to each supported
+// SVE vector length (Linux only) and the same kernels are executed: memory
+// copy (C library and SVE loop) and dot product (scalar and SVE loop). The
+// SVE kernels are vector-length agnostic, the same code runs at all lengths.
+//
+// An external command can be re-executed at each vector length, typically
+// samples/compile-accel/bench-accel for the crypto samples. The vector length
+// is inherited by the command. The output of the command is not modified.
+//
+// The SME vector lengths are reported but not used: the kernels do not run
+// in streaming mode.
+//
+//----------------------------------------------------------------------------
+
+#include "vectorlength.h"
+#include "userfeatures.h"
+#include "cacheinfo.h"
+#include "cputimer.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+    #include <unistd.h>
+    #include <sys/wait.h>
+#endif
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    size_t      max_size;
+    size_t      samples;
+    std::vector<char*> exec;  // external command, null-terminated
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Syntax: " << command << " [options] [command [arguments ...]]" << std::endl
+              << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -m size : maximum size in bytes of the kernels (default: 1 MB)" << std::endl
+              << "  -s count : number of measured samples, the median is reported (default: 21)" << std::endl
+              << std::endl
+              << "Without command, the built-in kernels are run at each SVE vector length." << std::endl
+              << "With a command, it is executed at each SVE vector length instead (Linux only)." << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    max_size(1024 * 1024),
+    samples(21)
+{
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-m" && i+1 < argc) {
+            max_size = std::max<size_t>(64, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else if (arg == "-s" && i+1 < argc) {
+            samples = std::max<size_t>(1, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else {
+            fatal("invalid option " + arg + ", try --help");
+        }
+    }
+    // All remaining arguments are the external command.
+    for (; i < argc; ++i) {
+        exec.push_back(argv[i]);
+    }
+    if (!exec.empty()) {
+        exec.push_back(nullptr);
+#if !defined(__linux__)
+        fatal("commands can be re-executed at each vector length on Linux only");
+#endif
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// The kernels. The SVE instructions are encoded in hexadecimal with fixed
+// registers because older assemblers do not know them without +sve. The
+// loops are predicated by WHILELO, b.eq is b.none and b.mi is b.first.
+//----------------------------------------------------------------------------
+
+namespace {
+    void LibcCopy(void* dst, const void* src, size_t size)
+    {
+        ::memcpy(dst, src, size);
+    }
+
+    float ScalarDot(const float* a, const float* b, size_t count)
+    {
+        float sum = 0;
+        for (size_t i = 0; i < count; i++) {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+
+#if defined(__aarch64__)
+    void SveCopy(void* dst, const void* src, size_t size)
+    {
+        register void* x0 asm("x0") = dst;
+        register const void* x1 asm("x1") = src;
+        register size_t x2 asm("x2") = size;
+        register size_t x3 asm("x3") = 0;
+        asm volatile(".inst 0x25221c60\n"   // whilelo p0.b, x3, x2
+                     "b.eq 2f\n"
+                     "1:\n"
+                     ".inst 0xa4034020\n"   // ld1b {z0.b}, p0/z, [x1, x3]
+                     ".inst 0xe4034000\n"   // st1b {z0.b}, p0, [x0, x3]
+                     ".inst 0x0430e3e3\n"   // incb x3
+                     ".inst 0x25221c60\n"   // whilelo p0.b, x3, x2
+                     "b.mi 1b\n"
+                     "2:\n"
+                     : "+r" (x3) : "r" (x0), "r" (x1), "r" (x2) : "v0", "cc", "memory");
+    }
+
+    float SveDot(const float* a, const float* b, size_t count)
+    {
+        register const float* x0 asm("x0") = a;
+        register const float* x1 asm("x1") = b;
+        register size_t x2 asm("x2") = count;
+        register size_t x3 asm("x3") = 0;
+        uint32_t bits = 0;
+        asm volatile(".inst 0x25b8c000\n"   // mov z0.s, #0
+                     ".inst 0x25a21c60\n"   // whilelo p0.s, x3, x2
+                     "b.eq 2f\n"
+                     "1:\n"
+                     ".inst 0xa5434001\n"   // ld1w {z1.s}, p0/z, [x0, x3, lsl #2]
+                     ".inst 0xa5434022\n"   // ld1w {z2.s}, p0/z, [x1, x3, lsl #2]
+                     ".inst 0x65a20020\n"   // fmla z0.s, p0/m, z1.s, z2.s
+                     ".inst 0x04b0e3e3\n"   // incw x3
+                     ".inst 0x25a21c60\n"   // whilelo p0.s, x3, x2
+                     "b.mi 1b\n"
+                     "2:\n"
+                     ".inst 0x2598e3e0\n"   // ptrue p0.s
+                     ".inst 0x65802000\n"   // faddv s0, p0, z0.s
+                     "fmov %w0, s0\n"
+                     : "=&r" (bits), "+r" (x3) : "r" (x0), "r" (x1), "r" (x2) : "v0", "v1", "v2", "cc", "memory");
+        float result;
+        ::memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Time measurement, using the virtual counter (see CpuTimer).
+//----------------------------------------------------------------------------
+
+// Number of warm-up samples.
+static constexpr size_t BENCH_WARMUP = 3;
+
+// Minimum number of bytes per sample, small sizes are repeated.
+static constexpr size_t BENCH_MIN_BYTES = 64 * 1024;
+
+// Time a kernel which processes 'size' bytes, display one CSV line.
+static void Bench(const Options& opt, size_t vl, const std::string& kernel, size_t size, const std::function<void()>& func)
+{
+    const CpuTimer& timer(CpuTimer::instance());
+    const size_t repeat = std::max<size_t>(1, BENCH_MIN_BYTES / size);
+    std::vector<double> ns(opt.samples);
+    for (size_t i = 0; i < BENCH_WARMUP; i++) {
+        func();
+    }
+    for (auto& t : ns) {
+        const csr_u64_t start = timer.read();
+        for (size_t i = 0; i < repeat; i++) {
+            func();
+        }
+        t = timer.elapsed(start, timer.read()) / double(repeat);
+    }
+    std::sort(ns.begin(), ns.end());
+    const double median = ns[ns.size() / 2];
+
+    std::cout << 8 * vl << "," << kernel << "," << size << ","
+              << Format("%.1f,%.2f", median, median > 0 ? double(size) / median : 0.0) << std::endl;
+}
+
+// Run all built-in kernels at the current vector length. Return false on error.
+static bool RunKernels(const Options& opt, size_t vl, uint8_t* src, uint8_t* dst)
+{
+    const float* a = reinterpret_cast<const float*>(src);
+    const float* b = reinterpret_cast<const float*>(dst);
+    bool ok = true;
+
+    for (size_t size = 64; size <= opt.max_size; size *= 4) {
+        const size_t count = size / (2 * sizeof(float));
+        volatile float sink = 0;
+        Bench(opt, vl, "libc_copy", size, [&]() { LibcCopy(dst, src, size); });
+        Bench(opt, vl, "scalar_dot", size, [&]() { sink = ScalarDot(a, b, count); });
+#if defined(__aarch64__)
+        if (vl > 0) {
+            Bench(opt, vl, "sve_copy", size, [&]() { SveCopy(dst, src, size); });
+            Bench(opt, vl, "sve_dot", size, [&]() { sink = SveDot(a, b, count); });
+        }
+#endif
+    }
+
+#if defined(__aarch64__)
+    // Check the SVE kernels once, on an unaligned size (partial last vector).
+    if (vl > 0) {
+        const size_t size = std::min<size_t>(opt.max_size, 1000) - 1;
+        ::memset(dst, 0, size + 1);
+        SveCopy(dst, src, size);
+        ok = ::memcmp(dst, src, size) == 0 && dst[size] == 0;
+        const size_t count = size / (2 * sizeof(float));
+        const float ref = ScalarDot(a, a, count);
+        ok = ok && std::fabs(SveDot(a, a, count) - ref) <= std::fabs(ref) * 1e-4f;
+    }
+#endif
+    return ok;
+}
+
+
+//----------------------------------------------------------------------------
+// Run an external command at the current vector length.
+//----------------------------------------------------------------------------
+
+static bool RunCommand(const Options& opt, size_t vl)
+{
+#if defined(__linux__)
+    std::cout << "# vector_length_bits," << 8 * vl << std::endl;
+    std::cout.flush();
+    const pid_t pid = ::fork();
+    if (pid < 0) {
+        opt.fatal("fork error");
+    }
+    else if (pid == 0) {
+        // Child process: keep the vector length across exec().
+        if (vl > 0) {
+            VectorLength::set(VectorLength::SVE, vl, true);
+        }
+        ::execvp(opt.exec[0], opt.exec.data());
+        std::cerr << opt.command << ": cannot execute " << opt.exec[0] << std::endl;
+        ::_exit(EXIT_FAILURE);
+    }
+    int wstatus = 0;
+    return ::waitpid(pid, &wstatus, 0) == pid && WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0;
+#else
+    return false;
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Application entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    const Options opt(argc, argv);
+    const CpuTimer& timer(CpuTimer::instance());
+    const VectorLength sve(VectorLength::SVE);
+    const VectorLength sme(VectorLength::SME);
+    const size_t initial = VectorLength::current(VectorLength::SVE);
+
+    std::cout << "# counter_frequency," << timer.frequency() << std::endl
+              << "# timer," << timer.sourceName() << std::endl;
+    for (const VectorLength* vl : {&sve, &sme}) {
+        const std::string name(ToLower(VectorLength::name(vl->extension())));
+        std::vector<std::string> bits;
+        for (size_t len : vl->lengths()) {
+            bits.push_back(std::to_string(8 * len));
+        }
+        std::cout << "# " << name << "_vector_lengths_bits," << (bits.empty() ? "none" : Join(bits, ",")) << std::endl
+                  << "# " << name << "_vector_length_changeable," << int(vl->changeable()) << std::endl
+                  << "# " << name << "_kernel_vector_length_bits," << 8 * VectorLength::kernelLength(vl->extension()) << std::endl;
+    }
+
+    // Without SVE, the kernels or the command run once, with a zero vector length.
+    std::vector<size_t> lengths(sve.lengths());
+    if (lengths.empty()) {
+        lengths.push_back(0);
+    }
+
+    // Allocate the source and destination buffers, fill with small floats to limit rounding errors.
+    const CacheInfo& cache(CacheInfo::instance());
+    uint8_t* const src = static_cast<uint8_t*>(cache.allocate(opt.max_size));
+    uint8_t* const dst = static_cast<uint8_t*>(cache.allocate(opt.max_size));
+    float* const fsrc = reinterpret_cast<float*>(src);
+    for (size_t i = 0; i < opt.max_size / sizeof(float); i++) {
+        fsrc[i] = float(i % 16) / 16.0f;
+    }
+    ::memcpy(dst, src, opt.max_size);
+
+    if (opt.exec.empty()) {
+        std::cout << "vector_length_bits,kernel,size,median_ns,median_bytes_per_ns" << std::endl;
+    }
+
+    int status = EXIT_SUCCESS;
+    for (size_t vl : lengths) {
+        if (vl > 0 && sve.changeable() && VectorLength::set(VectorLength::SVE, vl) != vl) {
+            std::cerr << opt.command << ": cannot set SVE vector length to " << 8 * vl << " bits" << std::endl;
+            status = EXIT_FAILURE;
+            continue;
+        }
+        if (opt.exec.empty() ? !RunKernels(opt, vl, src, dst) : !RunCommand(opt, vl)) {
+            std::cerr << opt.command << ": error at vector length " << 8 * vl << " bits" << std::endl;
+            status = EXIT_FAILURE;
+        }
+    }
+
+    // Restore the initial vector length.
+    if (initial > 0 && sve.changeable()) {
+        VectorLength::set(VectorLength::SVE, initial);
+    }
+    cache.deallocate(dst);
+    cache.deallocate(src);
+    return status;
+}
@@ -0,0 +1,298 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Wake-up latency and CPU usage of the wait methods of WaitWord (WFET, WFE,
+// bounded spinning) against a futex (Linux) and pure spinning.
+//
+// A notifier thread and a waiter thread are bound to two distinct CPU cores.
+// For each round, the waiter starts waiting, the notifier waits for a fixed
+// delay and stores the current counter value. The wake-up latency is the
+// difference between the counter values after and before the notification.
+// The CPU usage is the CPU time of the waiter divided by the elapsed time.
+// The number of checks of the value per wait shows if the waiter sleeps.
+//
+// The results are displayed in CSV format:
+// method,waits,median_ns,p99_ns,max_ns,cpu_percent,polls_per_wait
+//
+//----------------------------------------------------------------------------
+
+#include "waitword.h"
+#include "cputimer.h"
+#include "cputopology.h"
+#include "userfeatures.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+    #include <unistd.h>
+    #include <sys/syscall.h>
+    #include <linux/futex.h>
+#endif
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    size_t      rounds;
+    size_t      delay_us;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -d us : delay before each notification in microseconds (default: 200)" << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -n count : number of notifications per method (default: 1000)" << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    rounds(1000),
+    delay_us(200)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-d" && i+1 < argc) {
+            delay_us = size_t(std::strtoull(argv[++i], nullptr, 0));
+        }
+        else if (arg == "-n" && i+1 < argc) {
+            rounds = std::max<size_t>(1, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else {
+            fatal("invalid option '" + arg + "', try --help");
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Methods: the methods of WaitWord, followed by the references.
+//----------------------------------------------------------------------------
+
+enum Method {WW_SPIN, WW_WFE, WW_WFET, PURE_SPIN, FUTEX};
+
+static const char* MethodName(Method method)
+{
+    switch (method) {
+        case WW_SPIN:   return "waitword-spin";
+        case WW_WFE:    return "waitword-wfe";
+        case WW_WFET:   return "waitword-wfet";
+        case PURE_SPIN: return "pure-spin";
+        case FUTEX:     return "futex";
+        default:        return "unknown";
+    }
+}
+
+static bool Supported(Method method)
+{
+    switch (method) {
+        case WW_SPIN:   return WaitWord::supported(WaitWord::SPIN);
+        case WW_WFE:    return WaitWord::supported(WaitWord::WFE);
+        case WW_WFET:   return WaitWord::supported(WaitWord::WFET);
+        case PURE_SPIN: return true;
+#if defined(__linux__)
+        case FUTEX:     return true;
+#endif
+        default:        return false;
+    }
+}
+
+#if defined(__linux__)
+static void FutexWait(std::atomic<uint32_t>& word, uint32_t old)
+{
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, old, nullptr, nullptr, 0);
+}
+
+static void FutexWake(std::atomic<uint32_t>& word)
+{
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+#endif
+
+// CPU time of the current thread in nanoseconds, zero when unknown.
+static double ThreadCpuTime()
+{
+#if defined(__linux__) || defined(__APPLE__)
+    struct timespec ts {};
+    if (::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return double(ts.tv_sec) * 1e9 + double(ts.tv_nsec);
+    }
+#endif
+    return 0.0;
+}
+
+
+//----------------------------------------------------------------------------
+// Run one method, display one CSV line.
+//----------------------------------------------------------------------------
+
+// Shared data, the waited words in distinct cache lines.
+struct Shared {
+    WaitWord                          word;
+    alignas(64) std::atomic<uint64_t> spin_word {0};
+    alignas(64) std::atomic<uint32_t> futex_word {0};
+    alignas(64) std::atomic<uint64_t> stamp {0};
+    alignas(64) std::atomic<size_t>   ready {0};
+};
+
+static void RunMethod(const Options& opt, Method method)
+{
+    const CpuTimer& timer(CpuTimer::instance());
+    const size_t cpus = std::max(1u, std::thread::hardware_concurrency());
+    Shared sh;
+    std::vector<double> latency(opt.rounds);
+    size_t polls = 0;
+    double cpu_ns = 0;
+    double elapsed_ns = 0;
+
+    // The waiter: signals that it is ready, waits and measures the wake-up latency.
+    std::thread waiter([&]() {
+        CpuTopology::bindThread(cpus > 1 ? 1 : 0);
+        const double cpu_start = ThreadCpuTime();
+        const auto start = std::chrono::steady_clock::now();
+        uint64_t old = 0;
+        for (size_t r = 0; r < opt.rounds; r++) {
+            size_t count = 1;
+            sh.ready.store(r + 1, std::memory_order_release);
+            switch (method) {
+                case WW_SPIN:
+                case WW_WFE:
+                case WW_WFET:
+                    // Same order as the methods of WaitWord.
+                    sh.word.wait(old, WaitWord::INFINITE, WaitWord::Method(method), &count);
+                    old = sh.word.load();
+                    break;
+                case PURE_SPIN:
+                    while (sh.spin_word.load(std::memory_order_acquire) == old) {
+                        count++;
+                    }
+                    old = sh.spin_word.load();
+                    break;
+                case FUTEX:
+#if defined(__linux__)
+                    while (sh.futex_word.load(std::memory_order_acquire) == uint32_t(old)) {
+                        FutexWait(sh.futex_word, uint32_t(old));
+                        count++;
+                    }
+#endif
+                    old = sh.futex_word.load();
+                    break;
+                default:
+                    break;
+            }
+            const csr_u64_t now = timer.read();
+            latency[r] = timer.elapsed(sh.stamp.load(std::memory_order_acquire), now);
+            polls += count;
+        }
+        elapsed_ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        cpu_ns = ThreadCpuTime() - cpu_start;
+    });
+
+    // The notifier, in this thread: waits for the waiter, then for the delay, and notifies.
+    CpuTopology::bindThread(0);
+    for (size_t r = 0; r < opt.rounds; r++) {
+        while (sh.ready.load(std::memory_order_acquire) <= r) {
+        }
+        const auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(opt.delay_us);
+        while (std::chrono::steady_clock::now() < end) {
+        }
+        sh.stamp.store(timer.read(), std::memory_order_release);
+        switch (method) {
+            case WW_SPIN:
+            case WW_WFE:
+            case WW_WFET:
+                sh.word.store(r + 1);
+                break;
+            case PURE_SPIN:
+                sh.spin_word.store(r + 1, std::memory_order_release);
+                break;
+            case FUTEX:
+                sh.futex_word.store(uint32_t(r + 1), std::memory_order_release);
+#if defined(__linux__)
+                FutexWake(sh.futex_word);
+#endif
+                break;
+            default:
+                break;
+        }
+    }
+    waiter.join();
+
+    std::sort(latency.begin(), latency.end());
+    const double median = latency[latency.size() / 2];
+    const double p99 = latency[(latency.size() * 99 + 99) / 100 - 1];
+    std::cout << MethodName(method) << "," << opt.rounds << ","
+              << Format("%.0f,%.0f,%.0f,%.1f,%.1f", median, p99, latency.back(),
+                        elapsed_ns > 0 ? 100.0 * cpu_ns / elapsed_ns : 0.0, double(polls) / double(opt.rounds))
+              << std::endl;
+}
+
+
+//----------------------------------------------------------------------------
+// Application entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    const Options opt(argc, argv);
+    const CpuTimer& timer(CpuTimer::instance());
+
+    std::cout << "# counter_frequency," << timer.frequency() << std::endl
+              << "# timer," << timer.sourceName() << std::endl
+              << "# wfxt," << int(UserFeatures::instance().FEAT_WFxT()) << std::endl
+              << "# event_period_ns," << WaitWord::eventPeriod() << std::endl
+              << "# best_method," << WaitWord::methodName(WaitWord::bestMethod()) << std::endl
+              << "# delay_us," << opt.delay_us << std::endl
+              << "method,waits,median_ns,p99_ns,max_ns,cpu_percent,polls_per_wait" << std::endl;
+
+    for (Method method : {PURE_SPIN, FUTEX, WW_SPIN, WW_WFE, WW_WFET}) {
+        if (Supported(method)) {
+            RunMethod(opt, method);
+        }
+        else {
+            std::cout << "# method " << MethodName(method) << " not supported" << std::endl;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,217 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Low-latency wait and notify on a 64-bit word, using WFE and WFET.
+//
+//----------------------------------------------------------------------------
+
+#include "waitword.h"
+#include "regaccess.h"
+#include "userfeatures.h"
+#include <chrono>
+#include <thread>
+
+#if defined(__linux__)
+    #include <sys/auxv.h>
+    #include <asm/hwcap.h>
+#endif
+
+// Period of the event stream as set by Linux (ARCH_TIMER_EVT_STREAM_FREQ, 10 kHz).
+#define CSR_LINUX_EVTSTRM_NS 100000
+
+
+//----------------------------------------------------------------------------
+// Virtual counter and wait instructions.
+//----------------------------------------------------------------------------
+
+namespace {
+    // Read the virtual counter. On other architectures, a monotonic clock in nanoseconds.
+    uint64_t Counter()
+    {
+#if defined(__aarch64__) || defined(_M_ARM64)
+        csr_u64_t value = 0;
+        csr_mrs(value, CSR_SREG_CNTVCT_EL0);
+        return value;
+#else
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    // Frequency of the counter in Hz.
+    uint64_t Frequency()
+    {
+#if defined(__aarch64__) || defined(_M_ARM64)
+        static const uint64_t frequency = []() {
+            csr_u64_t value = 0;
+            csr_mrs(value, CSR_SREG_CNTFRQ_EL0);
+            return value == 0 ? uint64_t(1000000000) : uint64_t(value);
+        }();
+        return frequency;
+#else
+        return 1000000000;
+#endif
+    }
+
+    // Convert nanoseconds in counter ticks.
+    uint64_t Ticks(uint64_t ns)
+    {
+        return uint64_t(double(ns) * double(Frequency()) / 1e9);
+    }
+
+#if defined(__aarch64__)
+    // Load-acquire exclusive, arms the exclusive monitor on the word.
+    uint64_t LoadExclusive(const std::atomic<uint64_t>& word)
+    {
+        uint64_t value;
+        asm volatile("ldaxr %0, [%1]" : "=r" (value) : "r" (&word) : "memory");
+        return value;
+    }
+
+    // WFET is encoded in hexadecimal with a fixed register because older assemblers do not know it.
+    void WaitEventDeadline(uint64_t deadline)
+    {
+        register uint64_t x0 asm("x0") = deadline;
+        asm volatile(".inst 0xd5031000" : : "r" (x0) : "memory");   // wfet x0
+    }
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Supported methods.
+//----------------------------------------------------------------------------
+
+bool WaitWord::supported(Method method)
+{
+    switch (method) {
+        case SPIN:
+            return true;
+#if defined(__aarch64__)
+        case WFE:
+            return true;
+        case WFET:
+            return UserFeatures::instance().FEAT_WFxT();
+#endif
+        default:
+            return false;
+    }
+}
+
+WaitWord::Method WaitWord::bestMethod()
+{
+    return supported(WFET) ? WFET : (supported(WFE) ? WFE : SPIN);
+}
+
+const char* WaitWord::methodName(Method method)
+{
+    switch (method) {
+        case SPIN: return "spin";
+        case WFE:  return "wfe";
+        case WFET: return "wfet";
+        default:   return "unknown";
+    }
+}
+
+uint64_t WaitWord::eventPeriod()
+{
+    static const uint64_t period = []() -> uint64_t {
+        // The event is generated on a transition of one bit of the counter, CNTKCTL_EL1.EVNTI,
+        // plus 8 with CNTKCTL_EL1.EVNTIS (FEAT_ECV). The period is two transitions of that bit.
+        RegAccess& regs(RegAccess::shared());
+        csr_u64_t cntkctl = 0;
+        if (regs.isOpen() && regs.read(CSR_REGID_CNTKCTL_EL1, cntkctl)) {
+            if ((cntkctl & (1 << 2)) == 0) {
+                return 0;
+            }
+            const int eventi = int((cntkctl >> 4) & 0x0F) + (UserFeatures::instance().FEAT_ECV() && (cntkctl & (1 << 17)) != 0 ? 8 : 0);
+            return uint64_t(double(uint64_t(1) << (eventi + 1)) * 1e9 / double(Frequency()));
+        }
+        regs.clearError();
+#if defined(__linux__) && defined(__aarch64__) && defined(HWCAP_EVTSTRM)
+        if ((::getauxval(AT_HWCAP) & HWCAP_EVTSTRM) != 0) {
+            return CSR_LINUX_EVTSTRM_NS;
+        }
+#endif
+        return 0;
+    }();
+    return period;
+}
+
+
+//----------------------------------------------------------------------------
+// Wait until the value changes or the timeout expires.
+//----------------------------------------------------------------------------
+
+bool WaitWord::wait(uint64_t old, uint64_t timeout_ns, Method method, size_t* polls) const
+{
+    // Without event stream, WFE may sleep past the deadline. A timeout which is
+    // shorter than the period would be late by up to one period, spinning is more accurate.
+    const uint64_t period = eventPeriod();
+    if (method == WFET && !supported(WFET)) {
+        method = WFE;
+    }
+    if (method == WFE && (!supported(WFE) || (timeout_ns != INFINITE && (period == 0 || timeout_ns < period)))) {
+        method = SPIN;
+    }
+
+    const uint64_t start = Counter();
+    const uint64_t deadline = timeout_ns == INFINITE ? INFINITE : start + Ticks(timeout_ns);
+    size_t count = 0;
+    bool changed = false;
+
+#if defined(__aarch64__)
+    if (method == WFE || method == WFET) {
+        // A store to the word after LDAXR clears the monitor and generates the wake-up event.
+        for (;;) {
+            count++;
+            if (LoadExclusive(_value) != old) {
+                changed = true;
+                break;
+            }
+            if (deadline != INFINITE && Counter() >= deadline) {
+                break;
+            }
+            if (method == WFET) {
+                WaitEventDeadline(deadline);
+            }
+            else {
+                asm volatile("wfe" : : : "memory");
+            }
+        }
+        asm volatile("clrex" : : : "memory");
+        if (polls != nullptr) {
+            *polls = count;
+        }
+        return changed;
+    }
+#endif
+
+    // Bounded spinning, then let other threads run between the checks.
+    const uint64_t spin_end = start + Ticks(period > 0 ? period : SPIN_LIMIT_NS);
+    for (;;) {
+        count++;
+        if (load() != old) {
+            changed = true;
+            break;
+        }
+        const uint64_t now = Counter();
+        if (now >= deadline) {
+            break;
+        }
+        if (now < spin_end) {
+#if defined(__aarch64__)
+            asm volatile("yield" : : : "memory");
+#endif
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+    if (polls != nullptr) {
+        *polls = count;
+    }
+    return changed;
+}
@@ -0,0 +1,83 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Low-latency wait and notify on a 64-bit word, using WFE and WFET.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//
+// Low-latency wait and notify on a 64-bit word, without system call.
+//
+// A waiter loads the word with LDAXR, which arms the exclusive monitor of its core, then
+// waits for an event. A store to the word by another core clears the monitor, which wakes
+// up the waiter, without SEV. Between the events, the core is in a low-power state instead
+// of spinning. The operating system still accounts the waiting time as CPU time.
+//
+// Methods, the best supported one is used by default:
+// - WFET: wait with a deadline on the virtual counter CNTVCT_EL0 (FEAT_WFxT).
+// - WFE: wait without deadline. A timeout is checked when the event stream
+//   (CNTKCTL_EL1.EVNTEN) wakes up the core, with a granularity of one period.
+//   A timeout which is shorter than the period is spent spinning.
+// - SPIN: spin with the YIELD hint during at most one event period (or SPIN_LIMIT_NS
+//   when unknown), then yield the thread to the scheduler between the checks.
+//
+class WaitWord
+{
+public:
+    // Wait methods.
+    enum Method {SPIN, WFE, WFET};
+
+    // Timeout value for an infinite wait.
+    static constexpr uint64_t INFINITE = ~uint64_t(0);
+
+    // Spinning limit in nanoseconds when the event stream period is unknown.
+    static constexpr uint64_t SPIN_LIMIT_NS = 50000;
+
+    // Constructor.
+    WaitWord(uint64_t value = 0) : _value(value) {}
+
+    // Get the current value of the word (acquire).
+    uint64_t load() const { return _value.load(std::memory_order_acquire); }
+
+    // Store a new value (release). The store wakes up all waiters.
+    void store(uint64_t value) { _value.store(value, std::memory_order_release); }
+
+    // Wait until the value is different from 'old' or the timeout expires, in nanoseconds.
+    // Return true when the value changed, false on timeout. When 'polls' is not null, it
+    // receives the number of times the value was checked.
+    bool wait(uint64_t old, uint64_t timeout_ns = INFINITE, size_t* polls = nullptr) const
+    {
+        return wait(old, timeout_ns, bestMethod(), polls);
+    }
+
+    // Same with an explicit method. An unsupported method falls back to the next one.
+    bool wait(uint64_t old, uint64_t timeout_ns, Method method, size_t* polls = nullptr) const;
+
+    // Check if a method is supported on this system.
+    static bool supported(Method method);
+
+    // Best supported method.
+    static Method bestMethod();
+
+    // Name of a method.
+    static const char* methodName(Method method);
+
+    // Period of the event stream in nanoseconds, zero if disabled or unknown. The period
+    // is read in CNTKCTL_EL1 using the kernel module. Otherwise, on Linux, HWCAP_EVTSTRM
+    // indicates that the kernel enabled it with its default period of 100 microseconds.
+    static uint64_t eventPeriod();
+
+    WaitWord(const WaitWord&) = delete;
+    WaitWord& operator=(const WaitWord&) = delete;
+
+private:
+    alignas(64) std::atomic<uint64_t> _value;
+};
@@ -0,0 +1,182 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Benchmark of FastZero() (DC ZVA) against memset(), across sizes.
+//
+// For each size, from 64 bytes to the maximum size, by powers of 2, the
+// same buffer is zeroed using memset() and FastZero(). The buffer is first
+// touched once so that page faults are not measured. Large sizes exceed the
+// caches and measure the memory bandwidth, where DC ZVA avoids reading the
+// lines before overwriting them.
+//
+// The results are displayed in CSV format.
+//
+//----------------------------------------------------------------------------
+
+#include "fastmem.h"
+#include "strutils.h"
+#include "userfeatures.h"
+#include "cacheinfo.h"
+#include "cputimer.h"
+
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    size_t      max_size;
+    size_t      offset;
+    size_t      samples;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -m size : maximum size in bytes, rounded down to a power of 2 (default: 64 MB)" << std::endl
+              << "  -o bytes : offset of the buffer from a cache line boundary (default: 0)" << std::endl
+              << "  -s count : number of measured samples, the median is reported (default: 21)" << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    max_size(64 * 1024 * 1024),
+    offset(0),
+    samples(21)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-m" && i+1 < argc) {
+            max_size = std::max<size_t>(64, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else if (arg == "-o" && i+1 < argc) {
+            offset = size_t(std::strtoull(argv[++i], nullptr, 0));
+            if (offset >= CacheInfo::MAX_LINE_SIZE) {
+                fatal(Format("offset must be less than %zu", CacheInfo::MAX_LINE_SIZE));
+            }
+        }
+        else if (arg == "-s" && i+1 < argc) {
+            samples = std::max<size_t>(1, size_t(std::strtoull(argv[++i], nullptr, 0)));
+        }
+        else {
+            fatal("invalid option " + arg + ", try --help");
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Time measurement, using the virtual counter (see CpuTimer).
+//----------------------------------------------------------------------------
+
+// Number of warm-up samples.
+static constexpr size_t BENCH_WARMUP = 3;
+
+// Time a function which zeroes 'size' bytes, display one CSV line.
+static void Bench(const Options& opt, const std::string& name, size_t size, const std::function<void()>& func)
+{
+    const CpuTimer& timer(CpuTimer::instance());
+    std::vector<double> ns(opt.samples);
+    for (size_t i = 0; i < BENCH_WARMUP; i++) {
+        func();
+    }
+    for (auto& t : ns) {
+        const csr_u64_t start = timer.read();
+        func();
+        t = timer.elapsed(start, timer.read());
+    }
+    std::sort(ns.begin(), ns.end());
+    const double median = ns[ns.size() / 2];
+    const double p99 = ns[(ns.size() * 99 + 99) / 100 - 1];
+
+    std::cout << size << "," << name << ","
+              << Format("%.1f,%.1f,%.2f", median, p99, median > 0 ? double(size) / median : 0.0) << std::endl;
+}
+
+
+//----------------------------------------------------------------------------
+// Application entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    const Options opt(argc, argv);
+    const UserFeatures& ufeat(UserFeatures::instance());
+    const CpuTimer& timer(CpuTimer::instance());
+
+    size_t max_size = 64;
+    while (max_size * 2 <= opt.max_size) {
+        max_size *= 2;
+    }
+
+    // Allocate one buffer for all sizes, touch all pages once.
+    const CacheInfo& cache(CacheInfo::instance());
+    uint8_t* const base = static_cast<uint8_t*>(cache.allocate(max_size + opt.offset));
+    uint8_t* const buffer = base + opt.offset;
+    ::memset(base, 0xFF, max_size + opt.offset);
+
+    std::cout << "# counter_frequency," << timer.frequency() << std::endl
+              << "# timer," << timer.sourceName() << std::endl
+              << "# dczid_prohibited," << int(ufeat.dczProhibited()) << std::endl
+              << "# dczid_block_size," << ufeat.dczBlockSize() << std::endl
+              << "# fastzero_threshold," << FASTZERO_THRESHOLD << std::endl
+              << "# offset," << opt.offset << std::endl
+              << "size,function,median_ns,p99_ns,median_bytes_per_ns" << std::endl;
+
+    int status = EXIT_SUCCESS;
+    for (size_t size = 64; size <= max_size; size *= 2) {
+        Bench(opt, "memset", size, [&]() { ::memset(buffer, 0, size); });
+        Bench(opt, "fastzero", size, [&]() { FastZero(buffer, size); });
+
+        // Check the result once per size, the bytes around the area must be untouched.
+        ::memset(base, 0xFF, max_size + opt.offset);
+        FastZero(buffer, size);
+        const bool ok = (opt.offset == 0 || buffer[-1] == 0xFF) && (size == max_size || buffer[size] == 0xFF) &&
+            std::all_of(buffer, buffer + size, [](uint8_t b) { return b == 0; });
+        if (!ok) {
+            std::cerr << opt.command << ": FastZero() error at size " << size << std::endl;
+            status = EXIT_FAILURE;
+        }
+    }
+
+    cache.deallocate(base);
+    return status;
+}
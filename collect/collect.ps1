@@ -39,13 +39,16 @@ $OS = (Get-WmiObject -class Win32_OperatingSystem)
 Write-Output "Windows version $($OS.Version)" | Out-File -Encoding ascii "$DestDir\cpusysregs-system.txt"
 Write-Output $OS.Caption | Out-File -Encoding ascii -Append "$DestDir\cpusysregs-system.txt"
 
-. $BinDir\sysregs -s    | Out-File -Encoding ascii "$DestDir\cpusysregs-features.txt"
-. $BinDir\sysregs -p    | Out-File -Encoding ascii "$DestDir\cpusysregs-pac.txt"
-. $BinDir\sysregs -a -v | Out-File -Encoding ascii "$DestDir\cpusysregs-registers.txt"
-. $BinDir\demo-pac      | Out-File -Encoding ascii "$DestDir\cpusysregs-demo-pac-1.txt"
-. $BinDir\demo-pac      | Out-File -Encoding ascii "$DestDir\cpusysregs-demo-pac-2.txt"
-. $BinDir\demo-pac      | Out-File -Encoding ascii "$DestDir\cpusysregs-demo-pac-3.txt"
-. $BinDir\demo-userfeatures | Out-File -Encoding ascii "$DestDir\cpusysregs-user-features.txt"
-. $BinDir\collect           | Out-File -Encoding ascii "$DestDir\cpusysregs-pac-md.txt"
+# Features, PAC, registers and user features, in one pass.
+. $BinDir\collect -o $DestDir
+
+# The PAC demo modifies the PAC keys, run it after all other probes.
+. $BinDir\demo-pac          | Out-File -Encoding ascii "$DestDir\cpusysregs-demo-pac-1.txt"
+. $BinDir\demo-pac          | Out-File -Encoding ascii "$DestDir\cpusysregs-demo-pac-2.txt"
+. $BinDir\demo-pac          | Out-File -Encoding ascii "$DestDir\cpusysregs-demo-pac-3.txt"
+. $BinDir\pacbench          | Out-File -Encoding ascii "$DestDir\cpusysregs-pac-bench.csv"
+. $BinDir\membench          | Out-File -Encoding ascii "$DestDir\cpusysregs-mem-bench.csv"
+. $BinDir\atomicbench       | Out-File -Encoding ascii "$DestDir\cpusysregs-atomic-bench.csv"
+. $BinDir\waitbench         | Out-File -Encoding ascii "$DestDir\cpusysregs-wait-bench.csv"
 
 Get-ChildItem $DestDir/cpusysregs-*.txt
@@ -54,13 +54,34 @@ echo "Creating cpusysregs-* files"
     [[ $SYSTEM == Darwin ]] && clang --version
 ) | expand >$DESTDIR/cpusysregs-system.txt
 
-apps/sysregs -s >$DESTDIR/cpusysregs-features.txt
-apps/sysregs -p >$DESTDIR/cpusysregs-pac.txt
-apps/sysregs -a -v >$DESTDIR/cpusysregs-registers.txt
+# Features, PAC, registers, user features, hwcaps or sysctl, in one pass.
+apps/collect -o $DESTDIR
+
+# The PAC demo modifies the PAC keys, run it after all other probes.
 apps/demo-pac >$DESTDIR/cpusysregs-demo-pac-1.txt
 apps/demo-pac >$DESTDIR/cpusysregs-demo-pac-2.txt
 apps/demo-pac >$DESTDIR/cpusysregs-demo-pac-3.txt
-apps/demo-userfeatures >$DESTDIR/cpusysregs-user-features.txt
-apps/collect >$DESTDIR/cpusysregs-pac-md.txt
+apps/pacbench >$DESTDIR/cpusysregs-pac-bench.csv
+
+# Memory copy and set paths, C library vs. NEON and FEAT_MOPS.
+apps/membench >$DESTDIR/cpusysregs-mem-bench.csv
+
+# Contention scaling of the atomic instructions, LL/SC vs. LSE, on all CPU cores.
+apps/atomicbench >$DESTDIR/cpusysregs-atomic-bench.csv
+
+# Wake-up latency of WFE and WFET waits vs. futex and spinning.
+apps/waitbench >$DESTDIR/cpusysregs-wait-bench.csv
+
+# Throughput of the accelerated instructions, limited buffer sizes to keep it short.
+make -C samples/compile-accel
+samples/compile-accel/bench-accel -M 1m -d 20 >$DESTDIR/cpusysregs-accel-bench.csv
+
+# Cost of the DIT and SSBS modes on the same kernels.
+make -C samples/pstate-modes
+samples/pstate-modes/modebench >$DESTDIR/cpusysregs-mode-bench.csv
+
+# Kernels and crypto samples at each SVE vector length, the length can be changed on Linux only.
+apps/vlbench >$DESTDIR/cpusysregs-vl-bench.csv
+[[ $SYSTEM == Linux ]] && apps/vlbench samples/compile-accel/bench-accel -M 1m -d 20 >$DESTDIR/cpusysregs-vl-accel-bench.csv
 
-ls -l $DESTDIR/cpusysregs-*.txt
+ls -l $DESTDIR/cpusysregs-*
@@ -139,6 +139,10 @@ typedef struct {
 // ID_AA64MMFR3_EL1 system register.
 #define csr_has_s1pie(mmfr3) ((mmfr3) & 0x0000000000000F00llu)
 
+// This macro checks if the 64-bit format of CCSIDR_EL1 is used (FEAT_CCIDX),
+// based on the value of the ID_AA64MMFR2_EL1 system register.
+#define csr_has_ccidx(mmfr2) ((mmfr2) & 0x0000000000F00000llu)
+
 
 //----------------------------------------------------------------------------
 // List of system registers which are handled by the kernel module.
@@ -230,6 +234,12 @@ enum {
     CSR_REGID_PMCCNTR_EL0,      // Performance Monitors Cycle Count Register
     CSR_REGID_PMCR_EL0,         // Performance Monitors Control Register
     CSR_REGID_PMUSERENR_EL0,    // Performance Monitors User Enable Register
+    CSR_REGID_PMCNTENSET_EL0,   // Performance Monitors Count Enable Set register
+    CSR_REGID_PMOVSSET_EL0,     // Performance Monitors Overflow Flag Status Set register
+    CSR_REGID_CLIDR_EL1,        // Cache Level ID Register
+    CSR_REGID_CSSELR_EL1,       // Cache Size Selection Register
+    CSR_REGID_ZCR_EL1,          // SVE Control Register (EL1)
+    CSR_REGID_SMCR_EL1,         // SME Control Register (EL1)
     // -----------------------  // End of individual registers
     _CSR_REGID_END,
     // -----------------------  // Registers which come in pair
@@ -263,7 +273,7 @@ CSR_INLINE int csr_regid_is_valid(int regid)
 
 //----------------------------------------------------------------------------
 // Pointer authentication commands.
-// The PACxx and AUTxx instructions can be delegated into the kernel module.
+// The PACxx, AUTxx and XPACx instructions can be delegated into the kernel module.
 // The purpose is to exhibit potential differences between user and kernel.
 //----------------------------------------------------------------------------
 
@@ -281,6 +291,8 @@ enum {
     CSR_INSTR_AUTIB,
     CSR_INSTR_AUTDA,
     CSR_INSTR_AUTDB,
+    CSR_INSTR_XPACI,
+    CSR_INSTR_XPACD,
     _CSR_INSTR_END
 };
 
@@ -290,6 +302,376 @@ typedef struct {
     csr_u64_t modifier;  // modifier, read-only
 } csr_instr_t;
 
+// Maximum number of instructions in one batch command.
+#define CSR_INSTR_BATCH_MAX 16384
+
+// Description of one instruction in a batch command.
+typedef struct {
+    csr_u64_t   instr;   // CSR_INSTR_ value, read-only
+    csr_u64_t   status;  // 0=success, 1=unknown instruction, write-only
+    csr_instr_t args;    // instruction parameters, as in a single instruction command
+} csr_instr_item_t;
+
+// Header of a batch of instructions.
+// In memory, the header is immediately followed by 'count' csr_instr_item_t structures.
+typedef struct {
+    csr_u64_t count;     // number of instructions after this header, read-only
+} csr_instr_batch_t;
+
+// Size in bytes of a batch command with 'count' instructions.
+#define CSR_INSTR_BATCH_SIZE(count) (sizeof(csr_instr_batch_t) + (count) * sizeof(csr_instr_item_t))
+
+// Address of the first instruction in a batch command.
+#define CSR_INSTR_BATCH_ITEMS(batch) ((csr_instr_item_t*)((char*)(batch) + sizeof(csr_instr_batch_t)))
+
+
+//----------------------------------------------------------------------------
+// Request batch commands.
+// A list of register reads, register writes and instructions, executed in
+// sequence on the same CPU core, in one call to the kernel module.
+//----------------------------------------------------------------------------
+
+// Maximum number of requests in one batch command.
+#define CSR_REQUESTS_MAX 1024
+
+// Types of requests.
+enum {
+    CSR_REQ_GET,     // read a register
+    CSR_REQ_SET,     // write a register
+    CSR_REQ_SETGET,  // write a register and read it back
+    CSR_REQ_INSTR,   // execute a PACxx, AUTxx or XPACx instruction
+    _CSR_REQ_END
+};
+
+// Description of one request in a batch command.
+typedef struct {
+    csr_u64_t  op;        // CSR_REQ_ value, read-only
+    csr_u64_t  id;        // CSR_REGID_ or CSR_REGID2_ value for registers, CSR_INSTR_ value for instructions, read-only
+    csr_u64_t  status;    // 0=success, 1=unknown register, instruction or request, 2=CPU feature missing, 3=not read back, write-only
+    csr_pair_t value;     // register value or value to sign or authenticate (low), read/write depending on op
+    csr_u64_t  modifier;  // instruction modifier, read-only
+} csr_request_t;
+
+// Header of a batch of requests.
+// In memory, the header is immediately followed by 'count' csr_request_t structures.
+typedef struct {
+    csr_u64_t count;     // number of requests after this header, read-only
+    csr_u64_t cpu;       // CPU core on which the requests are executed or CSR_CPU_ANY, read-only
+} csr_requests_t;
+
+// Size in bytes of a batch command with 'count' requests.
+#define CSR_REQUESTS_SIZE(count) (sizeof(csr_requests_t) + (count) * sizeof(csr_request_t))
+
+// Address of the first request in a batch command.
+#define CSR_REQUESTS_ITEMS(batch) ((csr_request_t*)((char*)(batch) + sizeof(csr_requests_t)))
+
+
+//----------------------------------------------------------------------------
+// PAC keys commands.
+// All PAC keys can be read and written at once, without interruption.
+//----------------------------------------------------------------------------
+
+// Index of PAC keys in a csr_pac_keys_t, in the same order as the CSR_REGID2_APxxKEY_EL1 registers.
+enum {
+    CSR_PACKEY_IA,
+    CSR_PACKEY_IB,
+    CSR_PACKEY_DA,
+    CSR_PACKEY_DB,
+    CSR_PACKEY_GA,
+    CSR_PACKEY_COUNT
+};
+
+// Parameters for a PAC keys swap. All keys are first read, then the selected keys are written.
+typedef struct {
+    csr_u64_t  set;                     // bit mask of keys to write (1 << CSR_PACKEY_xx), read-only
+    csr_u64_t  valid;                   // bit mask of keys which are supported on this CPU, write-only
+    csr_pair_t keys[CSR_PACKEY_COUNT];  // new keys on input, previous keys on output, read/write
+} csr_pac_keys_t;
+
+
+//----------------------------------------------------------------------------
+// Performance monitors commands (Linux and Windows).
+// The PMUv3 state is swapped on all CPU cores at once: the new configuration
+// is written on all cores and the previous configuration is returned. When the
+// EL0 access is enabled in PMUSERENR_EL0, the counters can be directly read
+// in userland. Warning: this conflicts with any other user of the PMU (perf).
+//----------------------------------------------------------------------------
+
+// Maximum number of event counters (PMEVCNTR<n>_EL0, n = 0 to 30).
+#define CSR_PMU_MAX_COUNTERS 31
+
+// Bit in a counter mask (PMCNTENSET_EL0) for the cycle counter.
+#define CSR_PMU_CYCLE_COUNTER 31
+
+// State of the performance monitors on one CPU core.
+typedef struct {
+    csr_u64_t pmcr;                               // PMCR_EL0, read/write
+    csr_u64_t userenr;                            // PMUSERENR_EL0, read/write
+    csr_u64_t cntenset;                           // PMCNTENSET_EL0, mask of enabled counters, read/write
+    csr_u64_t ccfiltr;                            // PMCCFILTR_EL0, read/write
+    csr_u64_t evtyper[CSR_PMU_MAX_COUNTERS];      // PMEVTYPER<n>_EL0, read/write
+    csr_u64_t counters;                           // number of implemented event counters (PMCR_EL0.N), write-only
+    csr_u64_t status;                             // 0=success, 2=CPU feature missing, write-only
+} csr_pmu_state_t;
+
+
+//----------------------------------------------------------------------------
+// Cache geometry command.
+// CCSIDR_EL1 and CCSIDR2_EL1 describe the cache which is selected in CSSELR_EL1.
+// The selection and the reads are done in the kernel module, without interruption,
+// for all caches which are described in CLIDR_EL1, on one CPU core. CSSELR_EL1 is
+// restored afterwards.
+//----------------------------------------------------------------------------
+
+// Maximum number of cache levels in CLIDR_EL1.
+#define CSR_CACHE_LEVELS 7
+
+// Number of entries in a cache geometry command.
+#define CSR_CACHE_COUNT (2 * CSR_CACHE_LEVELS)
+
+// Index of a cache in a cache geometry command, same as the CSSELR_EL1 value.
+// 'level' is from 1 to 7, 'instr' is non-zero for an instruction cache, zero for a data or unified cache.
+#define CSR_CACHE_INDEX(level, instr) ((((level) - 1) << 1) | ((instr) ? 1 : 0))
+
+// Geometry of all caches on one CPU core.
+typedef struct {
+    csr_u64_t cpu;                       // CPU core on which the registers are read or CSR_CPU_ANY, read-only
+    csr_u64_t clidr;                     // CLIDR_EL1, write-only
+    csr_u64_t ctr;                       // CTR_EL0, write-only
+    csr_u64_t ccidx;                     // non-zero with FEAT_CCIDX (64-bit format of CCSIDR_EL1), write-only
+    csr_u64_t valid;                     // bit mask of valid entries (1 << CSR_CACHE_INDEX), write-only
+    csr_u64_t ccsidr[CSR_CACHE_COUNT];   // CCSIDR_EL1, zero when not valid, write-only
+    csr_u64_t ccsidr2[CSR_CACHE_COUNT];  // CCSIDR2_EL1 with FEAT_CCIDX, zero otherwise, write-only
+} csr_cache_info_t;
+
+
+//----------------------------------------------------------------------------
+// Random numbers command.
+// RNDR or RNDRRS is read repeatedly in the kernel module, with FEAT_RNG,
+// to fill a buffer of random numbers in one call. This is typically used
+// when EL0 access to RNDR cannot be used or detected (Windows).
+//----------------------------------------------------------------------------
+
+// Maximum number of random numbers in one command.
+#define CSR_RANDOM_MAX 512
+
+// Maximum number of attempts to read one random number, when no entropy is available.
+#define CSR_RANDOM_RETRY 16
+
+// A buffer of random numbers.
+typedef struct {
+    csr_u64_t count;                  // number of requested values, read/write, less on return when the entropy source fails
+    csr_u64_t reseeded;               // non-zero to read RNDRRS instead of RNDR, read-only
+    csr_u64_t status;                 // 0=success, 1=entropy source failure, 2=CPU feature missing, write-only
+    csr_u64_t values[CSR_RANDOM_MAX]; // random numbers, write-only
+} csr_random_t;
+
+
+//----------------------------------------------------------------------------
+// Multi-register commands.
+// Several registers can be read in one single call to the kernel module,
+// on one specific CPU core or on all CPU cores at once.
+//----------------------------------------------------------------------------
+
+// Maximum number of registers in one multi-register command.
+#define CSR_MULTI_MAX 256
+
+// Maximum number of registers, all CPU cores included, in one all-CPU command.
+#define CSR_ALLCPUS_MAX 65536
+
+// Value of the 'cpu' field in a multi-register command to read on any CPU core.
+#define CSR_CPU_ANY (~(csr_u64_t)0)
+
+// Description of one register in a multi-register command.
+typedef struct {
+    csr_u64_t  regid;   // CSR_REGID_ or CSR_REGID2_ value, read-only
+    csr_u64_t  status;  // 0=success, 1=unknown register, 2=CPU feature missing, 3=CPU offline, write-only
+    csr_pair_t value;   // register value (only 'low' for single registers), write-only
+} csr_multi_reg_t;
+
+// Header of a multi-register command.
+// In memory, the header is immediately followed by 'count' csr_multi_reg_t structures.
+typedef struct {
+    csr_u64_t count;    // number of registers after this header, read-only
+    csr_u64_t cpu;      // CPU core on which the registers are read or CSR_CPU_ANY, read-only
+} csr_multi_t;
+
+// Size in bytes of a multi-register command with 'count' registers.
+#define CSR_MULTI_SIZE(count) (sizeof(csr_multi_t) + (count) * sizeof(csr_multi_reg_t))
+
+// Address of the first register in a multi-register command.
+#define CSR_MULTI_REGS(multi) ((csr_multi_reg_t*)((char*)(multi) + sizeof(csr_multi_t)))
+
+// Header of an all-CPU command.
+// In memory, the header is immediately followed by 'cpus' blocks of 'count' csr_multi_reg_t structures,
+// one block per CPU core, in CPU index order. Only the regid fields of the first block are read.
+// On return, the 'cpus' field contains the number of CPU cores in the system. If this value is larger
+// than the input value, the last CPU cores were not read and the command shall be retried.
+typedef struct {
+    csr_u64_t count;    // number of registers per CPU core, read-only
+    csr_u64_t cpus;     // number of CPU blocks after this header, read-write
+} csr_allcpus_t;
+
+// Size in bytes of an all-CPU command with 'count' registers on 'cpus' CPU cores.
+#define CSR_ALLCPUS_SIZE(count, cpus) (sizeof(csr_allcpus_t) + (count) * (cpus) * sizeof(csr_multi_reg_t))
+
+// Address of the first register for CPU core 'cpu' in an all-CPU command.
+#define CSR_ALLCPUS_REGS(all, cpu) ((csr_multi_reg_t*)((char*)(all) + sizeof(csr_allcpus_t)) + (cpu) * (all)->count)
+
+
+//----------------------------------------------------------------------------
+// Periodic sampler commands (Linux only).
+// A high-resolution timer periodically reads a set of registers on each CPU
+// core. The samples are stored in per-CPU ring buffers in the kernel module.
+// They are drained using read() on /dev/cpusysregs, in whole csr_sample_t.
+//----------------------------------------------------------------------------
+
+// Maximum number of registers in one sample.
+#define CSR_SAMPLER_MAX_REGS 6
+
+// Number of samples in the ring buffer of each CPU core.
+#define CSR_SAMPLER_RING_SIZE 1024
+
+// Minimum sampling period in nanoseconds.
+#define CSR_SAMPLER_MIN_PERIOD 10000
+
+// Parameters of the sampler. All fields are read-only.
+typedef struct {
+    csr_u64_t period_ns;                       // sampling period in nanoseconds
+    csr_u64_t count;                           // number of registers in 'regids'
+    csr_u64_t regids[CSR_SAMPLER_MAX_REGS];    // CSR_REGID_ values, single registers only
+} csr_sampler_t;
+
+// One sample, as returned by read().
+typedef struct {
+    csr_u64_t cpu;                             // CPU core index
+    csr_u64_t seq;                             // sequence number of the sample on this CPU core
+    csr_u64_t dropped;                         // number of samples dropped on this CPU core so far (ring full)
+    csr_u64_t expires_ns;                      // monotonic time when the timer was supposed to fire
+    csr_u64_t time_ns;                         // monotonic time when the registers were read
+    csr_u64_t status;                          // bit mask of registers which could not be read
+    csr_u64_t values[CSR_SAMPLER_MAX_REGS];    // register values
+} csr_sample_t;
+
+
+//----------------------------------------------------------------------------
+// Register watch commands (Linux only).
+// The kernel module periodically reads a set of registers on all CPU cores
+// and compares them with the previous values on the same core. The registers
+// are also checked on a CPU core when it comes online (hotplug, resume). When
+// a change is detected, poll() on /dev/cpusysregs reports POLLPRI. The change
+// is then returned and cleared by CSR_IOC_WATCH_READ.
+//----------------------------------------------------------------------------
+
+// Maximum number of registers in a watch.
+#define CSR_WATCH_MAX_REGS 16
+
+// Minimum check period in nanoseconds (1 ms).
+#define CSR_WATCH_MIN_PERIOD 1000000
+
+// Parameters of the watch. All fields are read-only.
+typedef struct {
+    csr_u64_t period_ns;                       // check period in nanoseconds
+    csr_u64_t count;                           // number of registers in 'regids'
+    csr_u64_t regids[CSR_WATCH_MAX_REGS];      // CSR_REGID_ values, single registers only
+} csr_watch_t;
+
+// Changes since the previous CSR_IOC_WATCH_READ. All fields are write-only.
+// The fields after 'changed' are meaningful only when 'changed' is not zero.
+typedef struct {
+    csr_u64_t changes;                         // total number of detected changes since the watch was started
+    csr_u64_t changed;                         // bit mask of registers (index in regids) which changed, zero if none
+    csr_u64_t cpu;                             // CPU core of the first change
+    csr_u64_t time_ns;                         // monotonic time of the first change
+    csr_u64_t values[CSR_WATCH_MAX_REGS];      // register values on that CPU core after the first change
+} csr_watch_event_t;
+
+
+//----------------------------------------------------------------------------
+// Statistical Profiling Extension (SPE) commands (Linux only).
+// A profiling buffer is allocated by the kernel module on each CPU core.
+// The sampling stops when the buffer of a CPU core is full (no interrupt).
+// After stopping the profiling, the records of each CPU core are read in
+// userland. Since accessing the SPE registers may crash systems where they
+// are trapped by a hypervisor, the module must be loaded with "spe=1".
+//----------------------------------------------------------------------------
+
+// Minimum and maximum size in bytes of the profiling buffer of each CPU core.
+#define CSR_SPE_MIN_BUFFER 0x00010000
+#define CSR_SPE_MAX_BUFFER 0x01000000
+
+// Parameters of the profiling session. All fields are read-only.
+typedef struct {
+    csr_u64_t buffer_size;  // size in bytes of the profiling buffer of each CPU core, multiple of 64 kB
+    csr_u64_t interval;     // sampling interval in operations, PMSIRR_EL1.INTERVAL (bits 31:8)
+    csr_u64_t pmscr;        // PMSCR_EL1, sampling controls (E0SPE, E1SPE, CX, PA, TS, PCT)
+    csr_u64_t pmsfcr;       // PMSFCR_EL1, sampling filter controls
+    csr_u64_t pmsevfr;      // PMSEVFR_EL1, sampling event filter
+    csr_u64_t pmslatfr;     // PMSLATFR_EL1, sampling latency filter
+} csr_spe_config_t;
+
+// Read the profiling records of one CPU core, after the profiling is stopped.
+typedef struct {
+    csr_u64_t cpu;          // CPU core index, read-only
+    csr_u64_t offset;       // offset in the profiling records of this CPU core, read-only
+    csr_u64_t address;      // user address of the data area which receives the records, read-only
+    csr_u64_t size;         // size in bytes of the data area, read-write (returned size)
+    csr_u64_t total;        // total size in bytes of the profiling records of this CPU core, write-only
+    csr_u64_t pmbsr;        // PMBSR_EL1 when the profiling was stopped, write-only
+} csr_spe_read_t;
+
+
+//----------------------------------------------------------------------------
+// Snapshot of immutable registers.
+// The kernel module reads the ID registers once, when loaded, in a read-only
+// snapshot. Linux: mmap() the device at offset 0, read-only, one page.
+// macOS: use getsockopt(CSR_SOCKOPT_GET_SNAPSHOT). Windows: not supported.
+// Linux also exports the snapshot of each CPU core in sysfs, without root access,
+// in /sys/devices/system/cpu/cpuN/cpusysregs: the file "snapshot" contains the
+// binary csr_snapshot_t, and one text file per ID register (e.g. "midr_el1")
+// contains its hexadecimal value, read when the CPU core came online.
+//----------------------------------------------------------------------------
+
+// Identification of a snapshot: "CSRSNAPS" in little-endian order, current version.
+#define CSR_SNAPSHOT_MAGIC   0x5350414E53525343
+#define CSR_SNAPSHOT_VERSION 1
+
+// Maximum number of registers in a snapshot.
+#define CSR_SNAPSHOT_MAX 64
+
+// Content of a snapshot. Registers depending on missing CPU features have status 2.
+// The register values are read on the CPU core which loaded the module.
+typedef struct {
+    csr_u64_t       magic;     // CSR_SNAPSHOT_MAGIC
+    csr_u64_t       version;   // CSR_SNAPSHOT_VERSION
+    csr_u64_t       size;      // size in bytes of the csr_snapshot_t structure
+    csr_u64_t       features;  // CPU features, as seen by the kernel module (FEAT_ bit mask)
+    csr_u64_t       count;     // number of valid registers in 'regs'
+    csr_multi_reg_t regs[CSR_SNAPSHOT_MAX];
+} csr_snapshot_t;
+
+// Check if a snapshot is valid.
+CSR_INLINE int csr_snapshot_is_valid(const csr_snapshot_t* snap)
+{
+    return snap != 0 &&
+           snap->magic == CSR_SNAPSHOT_MAGIC &&
+           snap->version >= CSR_SNAPSHOT_VERSION &&
+           snap->size >= sizeof(csr_snapshot_t) &&
+           snap->count <= CSR_SNAPSHOT_MAX;
+}
+
+// Find a register in a snapshot. Return a null pointer if not present.
+CSR_INLINE const csr_multi_reg_t* csr_snapshot_find(const csr_snapshot_t* snap, int regid)
+{
+    csr_u64_t i;
+    for (i = 0; i < snap->count; i++) {
+        if (snap->regs[i].regid == (csr_u64_t)regid) {
+            return &snap->regs[i];
+        }
+    }
+    return 0;
+}
+
 
 //----------------------------------------------------------------------------
 // Kernel module commands.
@@ -307,11 +689,30 @@ typedef struct {
     // Each code shall be unique since all commands go through ioctl().
     #define _CSR_IOC_REG             0x50
     #define _CSR_IOC_INSTR           0x80
+    #define _CSR_IOC_MULTI           0x90
     #define CSR_IOC_GET_REG(regid)   _IOR(_CSR_IOC_REG, (regid), csr_u64_t)
     #define CSR_IOC_GET_REG2(regid)  _IOR(_CSR_IOC_REG, (regid), csr_pair_t)
     #define CSR_IOC_SET_REG(regid)   _IOW(_CSR_IOC_REG, (regid), csr_u64_t)
     #define CSR_IOC_SET_REG2(regid)  _IOW(_CSR_IOC_REG, (regid), csr_pair_t)
+    #define CSR_IOC_SETGET_REG(regid)  _IOWR(_CSR_IOC_REG, (regid), csr_u64_t)
+    #define CSR_IOC_SETGET_REG2(regid) _IOWR(_CSR_IOC_REG, (regid), csr_pair_t)
     #define CSR_IOC_INSTR(instr)     _IOWR(_CSR_IOC_INSTR, (instr), csr_instr_t)
+    #define CSR_IOC_GET_MULTI        _IOWR(_CSR_IOC_MULTI, 0x01, csr_multi_t)
+    #define CSR_IOC_GET_ALLCPUS      _IOWR(_CSR_IOC_MULTI, 0x02, csr_allcpus_t)
+    #define CSR_IOC_INSTR_BATCH      _IOWR(_CSR_IOC_MULTI, 0x04, csr_instr_batch_t)
+    #define CSR_IOC_SWAP_PAC_KEYS    _IOWR(_CSR_IOC_MULTI, 0x05, csr_pac_keys_t)
+    #define CSR_IOC_SAMPLER_START    _IOW(_CSR_IOC_MULTI, 0x06, csr_sampler_t)
+    #define CSR_IOC_SAMPLER_STOP     _IO(_CSR_IOC_MULTI, 0x07)
+    #define CSR_IOC_SWAP_PMU         _IOWR(_CSR_IOC_MULTI, 0x08, csr_pmu_state_t)
+    #define CSR_IOC_SPE_START        _IOW(_CSR_IOC_MULTI, 0x09, csr_spe_config_t)
+    #define CSR_IOC_SPE_STOP         _IO(_CSR_IOC_MULTI, 0x0A)
+    #define CSR_IOC_SPE_READ         _IOWR(_CSR_IOC_MULTI, 0x0B, csr_spe_read_t)
+    #define CSR_IOC_GET_CACHES       _IOWR(_CSR_IOC_MULTI, 0x0C, csr_cache_info_t)
+    #define CSR_IOC_GET_RANDOM       _IOWR(_CSR_IOC_MULTI, 0x0D, csr_random_t)
+    #define CSR_IOC_WATCH_START      _IOW(_CSR_IOC_MULTI, 0x0E, csr_watch_t)
+    #define CSR_IOC_WATCH_STOP       _IO(_CSR_IOC_MULTI, 0x0F)
+    #define CSR_IOC_WATCH_READ       _IOR(_CSR_IOC_MULTI, 0x10, csr_watch_event_t)
+    #define CSR_IOC_REQUESTS         _IOWR(_CSR_IOC_MULTI, 0x11, csr_requests_t)
 
     // Extract the register id from an ioctl() code.
     // Return CSR_REGID_INVALID if not a set/get register command.
@@ -339,8 +740,21 @@ typedef struct {
     #define _CSR_SOCKOPT_MASK         0x0000FFFF
     #define _CSR_SOCKOPT_REG          0x00AC0000
     #define _CSR_SOCKOPT_INSTR        0x00AD0000
+    #define _CSR_SOCKOPT_MULTI        0x00AE0000
+    #define _CSR_SOCKOPT_SETGET       0x00AF0000
     #define CSR_SOCKOPT_REG(regid)    (_CSR_SOCKOPT_REG | (regid))
+    #define CSR_SOCKOPT_SETGET_REG(regid) (_CSR_SOCKOPT_SETGET | (regid))
     #define CSR_SOCKOPT_INSTR(instr)  (_CSR_SOCKOPT_INSTR | (instr))
+    #define CSR_SOCKOPT_GET_MULTI     (_CSR_SOCKOPT_MULTI | 0x01)
+    #define CSR_SOCKOPT_GET_SNAPSHOT  (_CSR_SOCKOPT_MULTI | 0x03)
+    #define CSR_SOCKOPT_INSTR_BATCH   (_CSR_SOCKOPT_MULTI | 0x04)
+    #define CSR_SOCKOPT_SWAP_PAC_KEYS (_CSR_SOCKOPT_MULTI | 0x05)
+    #define CSR_SOCKOPT_GET_CACHES    (_CSR_SOCKOPT_MULTI | 0x0C)
+    #define CSR_SOCKOPT_GET_RANDOM    (_CSR_SOCKOPT_MULTI | 0x0D)
+    #define CSR_SOCKOPT_REQUESTS      (_CSR_SOCKOPT_MULTI | 0x11)
+
+    // There is no public KPI for cross-CPU calls in macOS kernel extensions.
+    // Multi-register commands are only supported with CSR_CPU_ANY, all-CPU commands are not supported.
 
     // Extract the register id from a socket option.
     // Return CSR_REGID_INVALID if not a set/get register command.
@@ -351,6 +765,15 @@ typedef struct {
             regid : CSR_REGID_INVALID;
     }
 
+    // Extract the register id from a socket option for a write and read back command (getsockopt only).
+    // Return CSR_REGID_INVALID if not a write and read back command.
+    CSR_INLINE int csr_sockopt_to_setget_regid(int opt)
+    {
+        const int regid = opt & _CSR_SOCKOPT_MASK;
+        return (opt & ~_CSR_SOCKOPT_MASK) == _CSR_SOCKOPT_SETGET && regid != _CSR_REGID_END && regid < _CSR_REGID2_END ?
+            regid : CSR_REGID_INVALID;
+    }
+
     // Extract the instruction code from a socket option.
     // Return CSR_INSTR_INVALID if not an instruction command.
     CSR_INLINE int csr_sockopt_to_instr(int opt)
@@ -377,9 +800,20 @@ typedef struct {
     #define _CSR_FUNC_GET_REG       0xA00
     #define _CSR_FUNC_SET_REG       0xB00
     #define _CSR_FUNC_INSTR         0xC00
+    #define _CSR_FUNC_MULTI         0xD00
+    #define _CSR_FUNC_SETGET_REG    0xE00
     #define CSR_IOC_GET_REG(regid)  CTL_CODE(_CSR_IOC, _CSR_FUNC_GET_REG | (regid), METHOD_BUFFERED, FILE_ANY_ACCESS)
     #define CSR_IOC_SET_REG(regid)  CTL_CODE(_CSR_IOC, _CSR_FUNC_SET_REG | (regid), METHOD_BUFFERED, FILE_ANY_ACCESS)
+    #define CSR_IOC_SETGET_REG(regid) CTL_CODE(_CSR_IOC, _CSR_FUNC_SETGET_REG | (regid), METHOD_BUFFERED, FILE_ANY_ACCESS)
     #define CSR_IOC_INSTR(instr)    CTL_CODE(_CSR_IOC, _CSR_FUNC_INSTR | (instr), METHOD_BUFFERED, FILE_ANY_ACCESS)
+    #define CSR_IOC_GET_MULTI       CTL_CODE(_CSR_IOC, _CSR_FUNC_MULTI | 0x01, METHOD_BUFFERED, FILE_ANY_ACCESS)
+    #define CSR_IOC_GET_ALLCPUS     CTL_CODE(_CSR_IOC, _CSR_FUNC_MULTI | 0x02, METHOD_BUFFERED, FILE_ANY_ACCESS)
+    #define CSR_IOC_INSTR_BATCH     CTL_CODE(_CSR_IOC, _CSR_FUNC_MULTI | 0x04, METHOD_BUFFERED, FILE_ANY_ACCESS)
+    #define CSR_IOC_SWAP_PAC_KEYS   CTL_CODE(_CSR_IOC, _CSR_FUNC_MULTI | 0x05, METHOD_BUFFERED, FILE_ANY_ACCESS)
+    #define CSR_IOC_SWAP_PMU        CTL_CODE(_CSR_IOC, _CSR_FUNC_MULTI | 0x08, METHOD_BUFFERED, FILE_ANY_ACCESS)
+    #define CSR_IOC_GET_CACHES      CTL_CODE(_CSR_IOC, _CSR_FUNC_MULTI | 0x0C, METHOD_BUFFERED, FILE_ANY_ACCESS)
+    #define CSR_IOC_GET_RANDOM      CTL_CODE(_CSR_IOC, _CSR_FUNC_MULTI | 0x0D, METHOD_BUFFERED, FILE_ANY_ACCESS)
+    #define CSR_IOC_REQUESTS        CTL_CODE(_CSR_IOC, _CSR_FUNC_MULTI | 0x11, METHOD_BUFFERED, FILE_ANY_ACCESS)
 
     // Not found in current version of ntddk.h (similar to DEVICE_TYPE_FROM_CTL_CODE and METHOD_FROM_CTL_CODE.
     #if !defined(FUNCTION_FROM_CTL_CODE)
@@ -392,6 +826,12 @@ typedef struct {
         return DEVICE_TYPE_FROM_CTL_CODE(cmd) == _CSR_IOC && (FUNCTION_FROM_CTL_CODE(cmd) & _CSR_FUNC_MASK) == _CSR_FUNC_SET_REG;
     }
 
+    // Check if a DeviceIoControl() code is a write and read back register command.
+    CSR_INLINE int csr_ioc_is_setget_reg(ULONG cmd)
+    {
+        return DEVICE_TYPE_FROM_CTL_CODE(cmd) == _CSR_IOC && (FUNCTION_FROM_CTL_CODE(cmd) & _CSR_FUNC_MASK) == _CSR_FUNC_SETGET_REG;
+    }
+
     // Extract the register id from a DeviceIoControl() code.
     // Return CSR_REGID_INVALID if not a get/set register command.
     CSR_INLINE int csr_ioc_to_regid(ULONG cmd)
@@ -399,7 +839,7 @@ typedef struct {
         const ULONG func = FUNCTION_FROM_CTL_CODE(cmd) & _CSR_FUNC_MASK;
         const int regid = (int)(FUNCTION_FROM_CTL_CODE(cmd) & ~_CSR_FUNC_MASK);
         return DEVICE_TYPE_FROM_CTL_CODE(cmd) == _CSR_IOC &&
-               (func == _CSR_FUNC_GET_REG || func == _CSR_FUNC_SET_REG) &&
+               (func == _CSR_FUNC_GET_REG || func == _CSR_FUNC_SET_REG || func == _CSR_FUNC_SETGET_REG) &&
                regid != _CSR_REGID_END &&
                regid < _CSR_REGID2_END ?
                regid : CSR_REGID_INVALID;
@@ -985,6 +1425,12 @@ typedef struct {
 #define CSR_SREG_ZCR_EL2            CSR_SREG(0b11, 0b100, 0b0001, 0b0010, 0b000)
 #define CSR_SREG_ZCR_EL3            CSR_SREG(0b11, 0b110, 0b0001, 0b0010, 0b000)
 
+//
+// Registers with an index in their name. The index must be a constant.
+//
+#define CSR_SREG_PMEVCNTRn_EL0(n)   CSR_SREG(0b11, 0b011, 0b1110, 0b1000 | (((n) >> 3) & 0b11), (n) & 0b111)
+#define CSR_SREG_PMEVTYPERn_EL0(n)  CSR_SREG(0b11, 0b011, 0b1110, 0b1100 | (((n) >> 3) & 0b11), (n) & 0b111)
+
 //
 // Standard stringification macro (not so standard since we must define it again and again).
 //
@@ -1026,14 +1472,34 @@ typedef struct {
     // gcc/clang syntax
     #define csr_msr(sreg,value) asm volatile(_CSR_DEFINE_GPR ".inst 0xd5000000|(" CSR_STRINGIFY(sreg) ")|(.csr_gpr_%0)" : : "r" (value))
     #define csr_mrs(result,sreg) asm volatile(_CSR_DEFINE_GPR ".inst 0xd5200000|(" CSR_STRINGIFY(sreg) ")|(.csr_gpr_%0)" : "=r" (result))
+    #define csr_isb() asm volatile("isb" : : : "memory")
 #elif defined(WINDOWS)
     // msvc syntax
     #define csr_msr(sreg,value) _WriteStatusReg((sreg), (value))
     #define csr_mrs(result,sreg) ((result) = _ReadStatusReg(sreg))
+    #define csr_isb() __isb(_ARM64_BARRIER_SY)
 #endif
 
 //
-// Macros to generate PACxx and AUTxx instructions.
+// Macro to read RNDR or RNDRRS with its status. On failure, when no entropy is available
+// in a reasonable time, the result is zero and NZCV is 0b0100. Here, 'ok' is an int which
+// is set to zero on failure. With msvc, NZCV cannot be checked and a zero result is
+// considered as a failure (a valid zero is returned with a probability of 2^-64).
+//
+#if defined(__linux__) ||  defined(__APPLE__)
+    // gcc/clang syntax
+    #define csr_rndr(result,ok,sreg)                                                  \
+        asm volatile(_CSR_DEFINE_GPR                                                  \
+                     ".inst 0xd5200000|(" CSR_STRINGIFY(sreg) ")|(.csr_gpr_%0)\n"     \
+                     "cset %w1, ne"                                                   \
+                     : "=r" (result), "=r" (ok) : : "cc")
+#elif defined(WINDOWS)
+    // msvc syntax
+    #define csr_rndr(result,ok,sreg) ((result) = _ReadStatusReg(sreg), (ok) = (result) != 0)
+#endif
+
+//
+// Macros to generate PACxx, AUTxx and XPACx instructions.
 // This method works at all levels of architecture, including when PAuth is not
 // supported by the assembler. Since these instructions are in the HINT range,
 // executing them before Armv8.3 is a NOP.
@@ -1049,6 +1515,8 @@ typedef struct {
     #define csr_autda(data,mod) asm volatile(_CSR_DEFINE_GPR ".inst 0xdac11800|((.csr_gpr_%1)<<5)|(.csr_gpr_%0)" : "+r" (data) : "r" (mod))
     #define csr_autdb(data,mod) asm volatile(_CSR_DEFINE_GPR ".inst 0xdac11c00|((.csr_gpr_%1)<<5)|(.csr_gpr_%0)" : "+r" (data) : "r" (mod))
     #define csr_pacga(result,data,mod) asm volatile(_CSR_DEFINE_GPR ".inst 0x9ac03000|((.csr_gpr_%2)<<16)|((.csr_gpr_%1)<<5)|(.csr_gpr_%0)" : "=r" (result) : "r" (data), "r" (mod))
+    #define csr_xpaci(data) asm volatile(_CSR_DEFINE_GPR ".inst 0xdac143e0|(.csr_gpr_%0)" : "+r" (data))
+    #define csr_xpacd(data) asm volatile(_CSR_DEFINE_GPR ".inst 0xdac147e0|(.csr_gpr_%0)" : "+r" (data))
 #elif defined(_MSC_VER)
     // msvc does not support inline asm and has no intrinsics for PAC => need an external .asm module
     __int64 csr_pacia_helper(__int64, __int64);
@@ -1060,6 +1528,8 @@ typedef struct {
     __int64 csr_autda_helper(__int64, __int64);
     __int64 csr_autdb_helper(__int64, __int64);
     __int64 csr_pacga_helper(__int64, __int64);
+    __int64 csr_xpaci_helper(__int64);
+    __int64 csr_xpacd_helper(__int64);
     #define csr_pacia(data,mod) ((data) = csr_pacia_helper((data), (mod)))
     #define csr_pacib(data,mod) ((data) = csr_pacib_helper((data), (mod)))
     #define csr_pacda(data,mod) ((data) = csr_pacda_helper((data), (mod)))
@@ -1069,6 +1539,8 @@ typedef struct {
     #define csr_autda(data,mod) ((data) = csr_autda_helper((data), (mod)))
     #define csr_autdb(data,mod) ((data) = csr_autdb_helper((data), (mod)))
     #define csr_pacga(result,data,mod) ((result) = csr_pacga_helper((data), (mod)))
+    #define csr_xpaci(data) ((data) = csr_xpaci_helper((data)))
+    #define csr_xpacd(data) ((data) = csr_xpacd_helper((data)))
 #endif
 
 
@@ -1096,17 +1568,19 @@ typedef struct {
 #define FEAT_AIE      0x00002000
 #define FEAT_S1PIE    0x00004000
 #define FEAT_SPE      0x00008000
+#define FEAT_CCIDX    0x00010000
 
 // Get the CPU features. Typically called once on module initialization.
 static int csr_get_cpu_features(void)
 {
-    csr_u64_t pfr0, pfr1, dfr0, isar0, isar1, isar2, mmfr3;
+    csr_u64_t pfr0, pfr1, dfr0, isar0, isar1, isar2, mmfr2, mmfr3;
     csr_mrs(pfr0, CSR_SREG_ID_AA64PFR0_EL1);
     csr_mrs(pfr1, CSR_SREG_ID_AA64PFR1_EL1);
     csr_mrs(dfr0, CSR_SREG_ID_AA64DFR0_EL1);
     csr_mrs(isar0, CSR_SREG_ID_AA64ISAR0_EL1);
     csr_mrs(isar1, CSR_SREG_ID_AA64ISAR1_EL1);
     csr_mrs(isar2, CSR_SREG_ID_AA64ISAR2_EL1);
+    csr_mrs(mmfr2, CSR_SREG_ID_AA64MMFR2_EL1);
     csr_mrs(mmfr3, CSR_SREG_ID_AA64MMFR3_EL1);
     return (csr_has_pac(isar1, isar2) ? FEAT_PAC : 0) |
            (csr_has_pacga(isar1, isar2) ? FEAT_PACGA : 0) |
@@ -1123,7 +1597,8 @@ static int csr_get_cpu_features(void)
            (csr_has_sctlr2(mmfr3) ? FEAT_SCTLR2 : 0) |
            (csr_has_aie(mmfr3) ? FEAT_AIE : 0) |
            (csr_has_s1pie(mmfr3) ? FEAT_S1PIE : 0) |
-           (csr_has_spe(dfr0) ? FEAT_SPE : 0);
+           (csr_has_spe(dfr0) ? FEAT_SPE : 0) |
+           (csr_has_ccidx(mmfr2) ? FEAT_CCIDX : 0);
 }
 
 // Set the value of a single register or pair of registers.
@@ -1252,6 +1727,12 @@ static int csr_get_register(int regid, csr_pair_t* value, int cpu_features)
         _getreg(CSR_REGID_PMCCNTR_EL0,      CSR_SREG_PMCCNTR_EL0, FEAT_PMUv3);
         _getreg(CSR_REGID_PMCR_EL0,         CSR_SREG_PMCR_EL0, FEAT_PMUv3);
         _getreg(CSR_REGID_PMUSERENR_EL0,    CSR_SREG_PMUSERENR_EL0, FEAT_PMUv3);
+        _getreg(CSR_REGID_PMCNTENSET_EL0,   CSR_SREG_PMCNTENSET_EL0, FEAT_PMUv3);
+        _getreg(CSR_REGID_PMOVSSET_EL0,     CSR_SREG_PMOVSSET_EL0, FEAT_PMUv3);
+        _getreg(CSR_REGID_CLIDR_EL1,        CSR_SREG_CLIDR_EL1, 0);
+        _getreg(CSR_REGID_CSSELR_EL1,       CSR_SREG_CSSELR_EL1, 0);
+        _getreg(CSR_REGID_ZCR_EL1,          CSR_SREG_ZCR_EL1, FEAT_SVE);
+        _getreg(CSR_REGID_SMCR_EL1,         CSR_SREG_SMCR_EL1, FEAT_SME);
         _getreg2(CSR_REGID2_APIAKEY_EL1,    CSR_SREG_APIAKEYHI_EL1, CSR_SREG_APIAKEYLO_EL1, FEAT_PAC);
         _getreg2(CSR_REGID2_APIBKEY_EL1,    CSR_SREG_APIBKEYHI_EL1, CSR_SREG_APIBKEYLO_EL1, FEAT_PAC);
         _getreg2(CSR_REGID2_APDAKEY_EL1,    CSR_SREG_APDAKEYHI_EL1, CSR_SREG_APDAKEYLO_EL1, FEAT_PAC);
@@ -1265,7 +1746,238 @@ static int csr_get_register(int regid, csr_pair_t* value, int cpu_features)
 #undef _getreg2
 }
 
-// Execute a PACxx or AUTxx instruction.
+// Set the value of a register, then read it back after an instruction synchronization barrier.
+// Return values: same as csr_set_register(), 3=written but not readable.
+static int csr_setget_register(int regid, csr_pair_t* value, int cpu_features)
+{
+    const int status = csr_set_register(regid, value, cpu_features);
+    if (status != 0) {
+        return status;
+    }
+    csr_isb();
+    return csr_get_register(regid, value, cpu_features) == 0 ? 0 : 3;
+}
+
+// Get the values of several registers, as in a multi-register command.
+// The status of each register is individually set.
+static void csr_get_registers(csr_multi_reg_t* regs, csr_u64_t count, int cpu_features)
+{
+    csr_u64_t i;
+    for (i = 0; i < count; i++) {
+        regs[i].value.low = regs[i].value.high = 0;
+        if (regs[i].regid < _CSR_REGID2_END && csr_regid_is_valid((int)regs[i].regid)) {
+            regs[i].status = csr_get_register((int)regs[i].regid, &regs[i].value, cpu_features);
+        }
+        else {
+            regs[i].status = 1;
+        }
+    }
+}
+
+// Read all PAC keys, then write the selected ones, return the previous values.
+// The caller shall prevent interruptions to avoid a half-updated set of keys.
+static void csr_swap_pac_keys(csr_pac_keys_t* keys, int cpu_features)
+{
+    csr_pair_t previous[CSR_PACKEY_COUNT];
+    int i;
+
+    keys->valid = 0;
+    for (i = 0; i < CSR_PACKEY_COUNT; i++) {
+        previous[i].low = previous[i].high = 0;
+        if (csr_get_register(CSR_REGID2_APIAKEY_EL1 + i, &previous[i], cpu_features) == 0) {
+            keys->valid |= (csr_u64_t)1 << i;
+        }
+    }
+    for (i = 0; i < CSR_PACKEY_COUNT; i++) {
+        if ((keys->set & keys->valid) & ((csr_u64_t)1 << i)) {
+            csr_set_register(CSR_REGID2_APIAKEY_EL1 + i, &keys->keys[i], cpu_features);
+        }
+        keys->keys[i] = previous[i];
+    }
+}
+
+// Write the performance monitors state of the current CPU core, return the previous state.
+// The event types are accessed through PMSELR_EL0 and PMXEVTYPER_EL0 to use a variable index.
+// The caller shall prevent interruptions while the state is changed.
+static void csr_swap_pmu(csr_pmu_state_t* state, int cpu_features)
+{
+    csr_pmu_state_t previous;
+    csr_u64_t mask = (csr_u64_t)1 << CSR_PMU_CYCLE_COUNTER;
+    csr_u64_t i;
+
+    if ((cpu_features & FEAT_PMUv3) == 0) {
+        state->status = 2;
+        return;
+    }
+
+    // Read the previous state.
+    csr_mrs(previous.pmcr, CSR_SREG_PMCR_EL0);
+    csr_mrs(previous.userenr, CSR_SREG_PMUSERENR_EL0);
+    csr_mrs(previous.cntenset, CSR_SREG_PMCNTENSET_EL0);
+    csr_mrs(previous.ccfiltr, CSR_SREG_PMCCFILTR_EL0);
+    previous.counters = (previous.pmcr >> 11) & 0x1F;
+    previous.status = 0;
+    for (i = 0; i < CSR_PMU_MAX_COUNTERS; i++) {
+        previous.evtyper[i] = 0;
+        if (i < previous.counters) {
+            csr_msr(CSR_SREG_PMSELR_EL0, i);
+            csr_isb();
+            csr_mrs(previous.evtyper[i], CSR_SREG_PMXEVTYPER_EL0);
+            mask |= (csr_u64_t)1 << i;
+        }
+    }
+
+    // Stop all counters while changing the configuration.
+    csr_msr(CSR_SREG_PMCNTENCLR_EL0, mask);
+    csr_isb();
+    for (i = 0; i < previous.counters; i++) {
+        csr_msr(CSR_SREG_PMSELR_EL0, i);
+        csr_isb();
+        csr_msr(CSR_SREG_PMXEVTYPER_EL0, state->evtyper[i]);
+    }
+    csr_msr(CSR_SREG_PMCCFILTR_EL0, state->ccfiltr);
+    csr_msr(CSR_SREG_PMOVSCLR_EL0, mask);
+    csr_msr(CSR_SREG_PMCR_EL0, state->pmcr);
+    csr_msr(CSR_SREG_PMCNTENSET_EL0, state->cntenset & mask);
+    csr_msr(CSR_SREG_PMUSERENR_EL0, state->userenr);
+    csr_isb();
+
+    *state = previous;
+}
+
+// Read the geometry of all caches of the current CPU core.
+// The caller shall prevent interruptions while CSSELR_EL1 is modified.
+static void csr_get_cache_info(csr_cache_info_t* info, int cpu_features)
+{
+    csr_u64_t csselr, ctype;
+    int i;
+
+    csr_mrs(info->clidr, CSR_SREG_CLIDR_EL1);
+    csr_mrs(info->ctr, CSR_SREG_CTR_EL0);
+    csr_mrs(csselr, CSR_SREG_CSSELR_EL1);
+    info->ccidx = (cpu_features & FEAT_CCIDX) != 0;
+    info->valid = 0;
+    for (i = 0; i < CSR_CACHE_COUNT; i++) {
+        // CLIDR_EL1.Ctype<n>, 3 bits per level: 1=instruction only, 2=data only, 3=separate, 4=unified.
+        ctype = (info->clidr >> (3 * (i >> 1))) & 0x07;
+        info->ccsidr[i] = info->ccsidr2[i] = 0;
+        if ((i & 1) ? (ctype == 1 || ctype == 3) : (ctype >= 2 && ctype <= 4)) {
+            csr_msr(CSR_SREG_CSSELR_EL1, (csr_u64_t)i);
+            csr_isb();
+            csr_mrs(info->ccsidr[i], CSR_SREG_CCSIDR_EL1);
+            if (info->ccidx) {
+                csr_mrs(info->ccsidr2[i], CSR_SREG_CCSIDR2_EL1);
+            }
+            info->valid |= (csr_u64_t)1 << i;
+        }
+    }
+    csr_msr(CSR_SREG_CSSELR_EL1, csselr);
+    csr_isb();
+}
+
+// Fill a buffer of random numbers from RNDR or RNDRRS.
+static void csr_get_random(csr_random_t* rnd, int cpu_features)
+{
+    csr_u64_t i, value = 0;
+    int ok = 0, retry;
+
+    if (!(cpu_features & FEAT_RNG)) {
+        rnd->count = 0;
+        rnd->status = 2;
+        return;
+    }
+    if (rnd->count > CSR_RANDOM_MAX) {
+        rnd->count = CSR_RANDOM_MAX;
+    }
+    rnd->status = 0;
+    for (i = 0; i < rnd->count; i++) {
+        for (ok = 0, retry = 0; !ok && retry < CSR_RANDOM_RETRY; retry++) {
+            if (rnd->reseeded) {
+                csr_rndr(value, ok, CSR_SREG_RNDRRS);
+            }
+            else {
+                csr_rndr(value, ok, CSR_SREG_RNDR);
+            }
+        }
+        if (!ok) {
+            rnd->status = 1;
+            break;
+        }
+        rnd->values[i] = value;
+    }
+    rnd->count = i;
+}
+
+// Fill the snapshot of immutable registers.
+// Only registers which are identical on all cores of an homogeneous system and fixed after boot.
+// Control registers such as TCR_EL1 are writable (sysregs -w) and must always be read live.
+// MPIDR_EL1 and CLIDR_EL1 differ between cores (affinity, caches of big.LITTLE clusters),
+// they are only added in the snapshot of one CPU core (per_cpu non zero).
+static void csr_fill_snapshot(csr_snapshot_t* snap, int cpu_features, int per_cpu)
+{
+    static const int regids[] = {
+        CSR_REGID_MIDR_EL1,
+        CSR_REGID_REVIDR_EL1,
+        CSR_REGID_CTR_EL0,
+        CSR_REGID_ID_AA64ISAR0_EL1,
+        CSR_REGID_ID_AA64ISAR1_EL1,
+        CSR_REGID_ID_AA64ISAR2_EL1,
+        CSR_REGID_ID_AA64PFR0_EL1,
+        CSR_REGID_ID_AA64PFR1_EL1,
+        CSR_REGID_ID_AA64PFR2_EL1,
+        CSR_REGID_ID_AA64DFR0_EL1,
+        CSR_REGID_ID_AA64DFR1_EL1,
+        CSR_REGID_ID_AA64AFR0_EL1,
+        CSR_REGID_ID_AA64AFR1_EL1,
+        CSR_REGID_ID_AA64MMFR0_EL1,
+        CSR_REGID_ID_AA64MMFR1_EL1,
+        CSR_REGID_ID_AA64MMFR2_EL1,
+        CSR_REGID_ID_AA64MMFR3_EL1,
+        CSR_REGID_ID_AA64MMFR4_EL1,
+        CSR_REGID_ID_AA64SMFR0_EL1,
+        CSR_REGID_ID_AA64ZFR0_EL1,
+        CSR_REGID_ID_ISAR0_EL1,
+        CSR_REGID_ID_ISAR1_EL1,
+        CSR_REGID_ID_ISAR2_EL1,
+        CSR_REGID_ID_ISAR3_EL1,
+        CSR_REGID_ID_ISAR4_EL1,
+        CSR_REGID_ID_ISAR5_EL1,
+        CSR_REGID_ID_ISAR6_EL1,
+        CSR_REGID_ID_MMFR0_EL1,
+        CSR_REGID_ID_MMFR1_EL1,
+        CSR_REGID_ID_MMFR2_EL1,
+        CSR_REGID_ID_MMFR3_EL1,
+        CSR_REGID_ID_MMFR4_EL1,
+        CSR_REGID_ID_MMFR5_EL1,
+        CSR_REGID_ID_PFR0_EL1,
+        CSR_REGID_ID_PFR1_EL1,
+        CSR_REGID_ID_PFR2_EL1,
+        CSR_REGID_TRCDEVARCH,
+        CSR_REGID_PMMIR_EL1,
+#if !defined(__linux__)
+        // Reading PMSIDR_EL1 on Linux generates a kernel BUG, see apps/restrictions.h.
+        CSR_REGID_PMSIDR_EL1,
+#endif
+    };
+    static const int cpu_regids[] = {
+        CSR_REGID_MPIDR_EL1,
+        CSR_REGID_CLIDR_EL1,
+    };
+    const csr_u64_t count = sizeof(regids) / sizeof(regids[0]);
+    csr_u64_t i;
+
+    snap->magic = CSR_SNAPSHOT_MAGIC;
+    snap->version = CSR_SNAPSHOT_VERSION;
+    snap->size = sizeof(csr_snapshot_t);
+    snap->features = (csr_u64_t)cpu_features;
+    snap->count = count + (per_cpu ? sizeof(cpu_regids) / sizeof(cpu_regids[0]) : 0);
+    for (i = 0; i < CSR_SNAPSHOT_MAX; i++) {
+        snap->regs[i].regid = i < count ? (csr_u64_t)regids[i] : (i < snap->count ? (csr_u64_t)cpu_regids[i - count] : CSR_REGID_INVALID);
+    }
+    csr_get_registers(snap->regs, snap->count, cpu_features);
+}
+
+// Execute a PACxx, AUTxx or XPACx instruction.
 // Return values: 0=success, 1=unknown instruction.
 static int csr_exec_instr(int instr, csr_instr_t* args)
 {
@@ -1297,11 +2009,60 @@ static int csr_exec_instr(int instr, csr_instr_t* args)
         case CSR_INSTR_AUTDB:
             csr_autdb(args->value, args->modifier);
             return 0;
+        case CSR_INSTR_XPACI:
+            csr_xpaci(args->value);
+            return 0;
+        case CSR_INSTR_XPACD:
+            csr_xpacd(args->value);
+            return 0;
         default:
             return 1;
     }
 }
 
+// Execute a batch of PACxx or AUTxx instructions.
+// The status of each instruction is individually set.
+static void csr_exec_instr_batch(csr_instr_item_t* items, csr_u64_t count)
+{
+    csr_u64_t i;
+    for (i = 0; i < count; i++) {
+        items[i].status = items[i].instr < _CSR_INSTR_END ? csr_exec_instr((int)items[i].instr, &items[i].args) : 1;
+    }
+}
+
+// Execute a batch of requests, in sequence, on the current CPU core.
+// The status of each request is individually set.
+static void csr_exec_requests(csr_request_t* reqs, csr_u64_t count, int cpu_features)
+{
+    csr_instr_t args;
+    csr_u64_t i;
+    for (i = 0; i < count; i++) {
+        csr_request_t* req = &reqs[i];
+        const int valid_reg = req->id < _CSR_REGID2_END && csr_regid_is_valid((int)req->id);
+        switch (req->op) {
+            case CSR_REQ_GET:
+                req->value.low = req->value.high = 0;
+                req->status = valid_reg ? csr_get_register((int)req->id, &req->value, cpu_features) : 1;
+                break;
+            case CSR_REQ_SET:
+                req->status = valid_reg ? csr_set_register((int)req->id, &req->value, cpu_features) : 1;
+                break;
+            case CSR_REQ_SETGET:
+                req->status = valid_reg ? csr_setget_register((int)req->id, &req->value, cpu_features) : 1;
+                break;
+            case CSR_REQ_INSTR:
+                args.value = req->value.low;
+                args.modifier = req->modifier;
+                req->status = req->id < _CSR_INSTR_END ? csr_exec_instr((int)req->id, &args) : 1;
+                req->value.low = args.value;
+                break;
+            default:
+                req->status = 1;
+                break;
+        }
+    }
+}
+
 #endif // KERNEL
 
 #if defined(__cplusplus)
@@ -15,12 +15,30 @@
 
 #include "cpusysregs.h"
 #include <linux/device.h>
+#include <linux/cpu.h>
+#include <linux/cpuhotplug.h>
 #include <linux/fs.h>
+#include <linux/hrtimer.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
+#include <linux/kobject.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/smp.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/sysfs.h>
 #include <linux/uaccess.h>
 #include <linux/version.h>
+#include <linux/vmalloc.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+#include <asm/mmu.h>
 
 // Description of the kernel module.
 
@@ -29,6 +47,12 @@ MODULE_LICENSE("Dual BSD/GPL");
 MODULE_DESCRIPTION("Access the Arm64 CPU system registers");
 MODULE_VERSION("1.0");
 
+// Module parameter: allow the Statistical Profiling Extension (SPE).
+
+static bool csr_spe_allowed = false;
+module_param_named(spe, csr_spe_allowed, bool, 0444);
+MODULE_PARM_DESC(spe, "Allow SPE profiling (may crash if SPE registers are trapped by a hypervisor)");
+
 // Description of the /dev/cpusysregs device.
 // The major number is dynamically allocated when the module is loaded.
 
@@ -37,12 +61,111 @@ static struct class* csr_class = NULL;
 static struct device* csr_device = NULL;
 static int cpu_features = 0;
 
+// Snapshot of immutable registers, one page, mapped read-only in userland.
+
+static csr_snapshot_t* csr_snapshot = NULL;
+
+// Periodic sampler: one timer and one ring buffer per CPU core.
+// The ring buffer is protected by a spinlock since the timer runs in interrupt context.
+
+struct csr_sampler_cpu {
+    struct hrtimer timer;
+    spinlock_t     lock;
+    csr_sample_t*  ring;     // CSR_SAMPLER_RING_SIZE samples
+    csr_u64_t      head;     // total number of samples written in ring
+    csr_u64_t      tail;     // total number of samples read from ring
+    csr_u64_t      seq;      // total number of timer ticks
+    csr_u64_t      dropped;  // number of samples dropped because the ring was full
+    unsigned int   cpu;
+    bool           started;  // timer is started on this CPU
+};
+
+static DEFINE_PER_CPU(struct csr_sampler_cpu, csr_sampler_cpus);
+static DEFINE_MUTEX(csr_sampler_mutex);
+static csr_sampler_t csr_sampler_params;
+static struct file* csr_sampler_owner = NULL;  // file which started the sampler, NULL when stopped
+static bool csr_sampler_allocated = false;     // ring buffers are allocated
+
+// Statistical profiling: one profiling buffer per CPU core.
+
+struct csr_spe_cpu {
+    void*     buffer;   // profiling buffer, page-aligned
+    csr_u64_t used;     // size of the profiling records, after stop
+    csr_u64_t pmbsr;    // PMBSR_EL1 at stop
+    bool      started;  // profiling is started on this CPU
+};
+
+static DEFINE_PER_CPU(struct csr_spe_cpu, csr_spe_cpus);
+static DEFINE_MUTEX(csr_spe_mutex);
+static csr_spe_config_t csr_spe_params;
+static struct file* csr_spe_owner = NULL;  // file which started the profiling, NULL when stopped
+
+// Register watch: a delayed work reads the registers on all CPU cores, a CPU
+// hotplug callback reads them on a CPU core which comes online. The watch
+// parameters are modified with the CPU hotplug lock held, to exclude the callback.
+
+struct csr_watch_cpu {
+    csr_u64_t values[CSR_WATCH_MAX_REGS];  // last values on this CPU
+    bool      valid;                       // the values were read at least once
+};
+
+static DEFINE_PER_CPU(struct csr_watch_cpu, csr_watch_cpus);
+static DEFINE_MUTEX(csr_watch_mutex);
+static DEFINE_SPINLOCK(csr_watch_lock);          // protects csr_watch_event
+static DECLARE_WAIT_QUEUE_HEAD(csr_watch_waitq);
+static csr_watch_t csr_watch_params;
+static csr_watch_event_t csr_watch_event;
+static struct file* csr_watch_owner = NULL;      // file which started the watch, NULL when stopped
+
+// Per-CPU snapshots of the immutable registers, exported in sysfs, in one directory
+// per CPU core (/sys/devices/system/cpu/cpuN/cpusysregs). The snapshot of a CPU core
+// is read when the module is loaded or when the CPU core comes online, never in sysfs reads.
+
+struct csr_idregs_cpu {
+    struct kobject* kobj;  // sysfs directory, NULL if not created
+    csr_snapshot_t  snap;  // invalid (zero magic) until read on this CPU core
+};
+
+static struct csr_idregs_cpu* csr_idregs = NULL;  // nr_cpu_ids elements, NULL if not allocated
+static int csr_cpu_hpstate = -1;                  // dynamic CPU hotplug state, negative when not registered
+
 // Functions in this module.
 
 static int __init csr_init(void);
 static void __exit csr_exit(void);
 static char* csr_devnode(const struct device* dev, umode_t* mode);
 static long csr_ioctl(struct file* filp, unsigned int cmd, unsigned long argp);
+static int csr_mmap(struct file* filp, struct vm_area_struct* vma);
+static ssize_t csr_read(struct file* filp, char __user* buf, size_t len, loff_t* off);
+static __poll_t csr_poll(struct file* filp, poll_table* wait);
+static int csr_release(struct inode* inode, struct file* filp);
+static long csr_ioctl_multi(unsigned long param);
+static long csr_ioctl_allcpus(unsigned long param);
+static long csr_ioctl_instr_batch(unsigned long param);
+static long csr_ioctl_requests(unsigned long param);
+static long csr_ioctl_swap_pac_keys(unsigned long param);
+static long csr_ioctl_sampler_start(struct file* filp, unsigned long param);
+static long csr_ioctl_swap_pmu(unsigned long param);
+static long csr_ioctl_get_caches(unsigned long param);
+static long csr_ioctl_get_random(unsigned long param);
+static long csr_ioctl_spe_start(struct file* filp, unsigned long param);
+static long csr_ioctl_spe_read(unsigned long param);
+static void csr_spe_stop(void);
+static void csr_spe_free(void);
+static void csr_sampler_stop(void);
+static void csr_sampler_free(void);
+static long csr_ioctl_watch_start(struct file* filp, unsigned long param);
+static long csr_ioctl_watch_read(unsigned long param);
+static void csr_watch_stop(void);
+static void csr_watch_work_func(struct work_struct* work);
+static void csr_idregs_fill_cpu(void* info);
+static void csr_idregs_create(void);
+static void csr_idregs_remove(void);
+static int csr_cpu_online(unsigned int cpu);
+
+// Periodic check of the watched registers.
+
+static DECLARE_DELAYED_WORK(csr_watch_work, csr_watch_work_func);
 
 // Registration of the module.
 
@@ -54,6 +177,10 @@ module_exit(csr_exit);
 static struct file_operations csr_fops = {
     .owner = THIS_MODULE,
     .unlocked_ioctl = csr_ioctl,
+    .mmap = csr_mmap,
+    .read = csr_read,
+    .poll = csr_poll,
+    .release = csr_release,
 };
 
 
@@ -66,10 +193,20 @@ static int __init csr_init(void)
     // Get CPU features we may need later.
     cpu_features = csr_get_cpu_features();
 
+    // Build the snapshot of immutable registers, in one page.
+    BUILD_BUG_ON(sizeof(csr_snapshot_t) > PAGE_SIZE);
+    csr_snapshot = (csr_snapshot_t*)get_zeroed_page(GFP_KERNEL);
+    if (csr_snapshot == NULL) {
+        pr_alert("%s: failed to allocate snapshot page\n", CSR_MODULE_NAME);
+        return -ENOMEM;
+    }
+    csr_fill_snapshot(csr_snapshot, cpu_features, 0);
+
     // Register the device. Use same name for module and device.
     // Allocate a major number (first param is zero).
     csr_major_number = register_chrdev(0, CSR_MODULE_NAME, &csr_fops);
     if (csr_major_number < 0) {
+        free_page((unsigned long)csr_snapshot);
         pr_alert("%s: failed to register a major number\n", CSR_MODULE_NAME);
         return csr_major_number;
     }
@@ -83,6 +220,7 @@ static int __init csr_init(void)
 #endif
     if (IS_ERR(csr_class)) {
         unregister_chrdev(csr_major_number, CSR_MODULE_NAME);
+        free_page((unsigned long)csr_snapshot);
         pr_alert("%s: failed to register device class\n", CSR_MODULE_NAME);
         return PTR_ERR(csr_class);
     }
@@ -99,10 +237,28 @@ static int __init csr_init(void)
     if (IS_ERR(csr_device)) {
         class_destroy(csr_class);
         unregister_chrdev(csr_major_number, CSR_MODULE_NAME);
+        free_page((unsigned long)csr_snapshot);
         pr_alert("%s: failed to create the device\n", CSR_MODULE_NAME);
         return PTR_ERR(csr_device);
     }
 
+    // Per-CPU snapshots in sysfs. Not fatal if not available.
+    csr_idregs = vzalloc(nr_cpu_ids * sizeof(struct csr_idregs_cpu));
+    if (csr_idregs == NULL) {
+        pr_warn("%s: failed to allocate the per-CPU snapshots\n", CSR_MODULE_NAME);
+    }
+
+    // Read the per-CPU snapshots now and on CPU cores which come online, also check
+    // the watched registers on CPU cores which come online. Not fatal if not available.
+    csr_cpu_hpstate = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, CSR_MODULE_NAME ":online", csr_cpu_online, NULL);
+    if (csr_cpu_hpstate < 0) {
+        pr_warn("%s: no CPU hotplug notification for the register watch and per-CPU snapshots\n", CSR_MODULE_NAME);
+        if (csr_idregs != NULL) {
+            on_each_cpu(csr_idregs_fill_cpu, NULL, 1);
+        }
+    }
+    csr_idregs_create();
+
     return 0;
 }
 
@@ -114,9 +270,26 @@ static int __init csr_init(void)
 static void __exit csr_exit(void)
 {
     // Close resources in reverse order from csr_init().
+    csr_idregs_remove();
+    mutex_lock(&csr_watch_mutex);
+    csr_watch_stop();
+    mutex_unlock(&csr_watch_mutex);
+    if (csr_cpu_hpstate >= 0) {
+        cpuhp_remove_state_nocalls(csr_cpu_hpstate);
+    }
+    vfree(csr_idregs);
+    mutex_lock(&csr_sampler_mutex);
+    csr_sampler_stop();
+    csr_sampler_free();
+    mutex_unlock(&csr_sampler_mutex);
+    mutex_lock(&csr_spe_mutex);
+    csr_spe_stop();
+    csr_spe_free();
+    mutex_unlock(&csr_spe_mutex);
     device_destroy(csr_class, MKDEV(csr_major_number, 0));
     class_destroy(csr_class);
     unregister_chrdev(csr_major_number, CSR_MODULE_NAME);
+    free_page((unsigned long)csr_snapshot);
     pr_info("%s: module removed\n", CSR_MODULE_NAME);
 }
 
@@ -152,9 +325,82 @@ static char* csr_devnode(const struct device* dev, umode_t* mode)
 
 static long csr_ioctl(struct file* filp, unsigned int cmd, unsigned long param)
 {
-    // Check if this an instruction to execute.
+    // Check if this a multi-register command or an instruction to execute.
     const int instr = csr_ioc_to_instr(cmd);
-    if (instr != CSR_INSTR_INVALID) {
+    if (cmd == CSR_IOC_GET_MULTI) {
+        // Read several registers at once.
+        return csr_ioctl_multi(param);
+    }
+    else if (cmd == CSR_IOC_GET_ALLCPUS) {
+        // Read several registers at once on all CPU cores.
+        return csr_ioctl_allcpus(param);
+    }
+    else if (cmd == CSR_IOC_INSTR_BATCH) {
+        // Execute a batch of instructions.
+        return csr_ioctl_instr_batch(param);
+    }
+    else if (cmd == CSR_IOC_REQUESTS) {
+        // Execute a batch of register and instruction requests.
+        return csr_ioctl_requests(param);
+    }
+    else if (cmd == CSR_IOC_SWAP_PAC_KEYS) {
+        // Read and write all PAC keys at once.
+        return csr_ioctl_swap_pac_keys(param);
+    }
+    else if (cmd == CSR_IOC_SWAP_PMU) {
+        // Swap the performance monitors state on all CPU cores.
+        return csr_ioctl_swap_pmu(param);
+    }
+    else if (cmd == CSR_IOC_GET_CACHES) {
+        // Read the geometry of all caches on one CPU core.
+        return csr_ioctl_get_caches(param);
+    }
+    else if (cmd == CSR_IOC_GET_RANDOM) {
+        // Fill a buffer of random numbers.
+        return csr_ioctl_get_random(param);
+    }
+    else if (cmd == CSR_IOC_SPE_START) {
+        // Start the statistical profiling on all CPU cores.
+        return csr_ioctl_spe_start(filp, param);
+    }
+    else if (cmd == CSR_IOC_SPE_STOP) {
+        // Stop the statistical profiling, keep the profiling records.
+        mutex_lock(&csr_spe_mutex);
+        csr_spe_stop();
+        mutex_unlock(&csr_spe_mutex);
+        return 0;
+    }
+    else if (cmd == CSR_IOC_SPE_READ) {
+        // Read the profiling records of one CPU core.
+        return csr_ioctl_spe_read(param);
+    }
+    else if (cmd == CSR_IOC_SAMPLER_START) {
+        // Start the periodic sampler on all CPU cores.
+        return csr_ioctl_sampler_start(filp, param);
+    }
+    else if (cmd == CSR_IOC_SAMPLER_STOP) {
+        // Stop the periodic sampler, keep the samples which are not yet read.
+        mutex_lock(&csr_sampler_mutex);
+        csr_sampler_stop();
+        mutex_unlock(&csr_sampler_mutex);
+        return 0;
+    }
+    else if (cmd == CSR_IOC_WATCH_START) {
+        // Start watching registers on all CPU cores.
+        return csr_ioctl_watch_start(filp, param);
+    }
+    else if (cmd == CSR_IOC_WATCH_STOP) {
+        // Stop watching registers.
+        mutex_lock(&csr_watch_mutex);
+        csr_watch_stop();
+        mutex_unlock(&csr_watch_mutex);
+        return 0;
+    }
+    else if (cmd == CSR_IOC_WATCH_READ) {
+        // Get and clear the changes in the watched registers.
+        return csr_ioctl_watch_read(param);
+    }
+    else if (instr != CSR_INSTR_INVALID) {
         // Execute that specific instruction.
         csr_instr_t args;
         if (copy_from_user(&args, (void*)param, sizeof(args))) {
@@ -173,6 +419,7 @@ static long csr_ioctl(struct file* filp, unsigned int cmd, unsigned long param)
     else {
         // This must be a register to read/write. Get REGID from ioctl() command.
         csr_pair_t reg;
+        int status = 0;
         const int regid = csr_ioc_to_regid(cmd);
         const size_t size = csr_regid_is_pair(regid) ? sizeof(reg) : sizeof(reg.low);
         if (!csr_regid_is_valid(regid)) {
@@ -208,8 +455,1151 @@ static long csr_ioctl(struct file* filp, unsigned int cmd, unsigned long param)
                 else {
                     return 0;
                 }
+            case _IOC_READ | _IOC_WRITE:
+                // Set register value and read it back.
+                if (copy_from_user(&reg, (void*)param, size)) {
+                    return -EFAULT;
+                }
+                // No migration between the write and the read back, same CPU core.
+                get_cpu();
+                status = csr_setget_register(regid, &reg, cpu_features);
+                put_cpu();
+                switch (status) {
+                    case 0:
+                        return copy_to_user((void*)param, &reg, size) ? -EFAULT : 0;
+                    case 3:
+                        return -ENODATA;
+                    default:
+                        return -EINVAL;
+                }
             default:
                 return -EINVAL;
         }
     }
 }
+
+
+//----------------------------------------------------------------------------
+// Called on mmap() from userland: map the snapshot page, read-only.
+//----------------------------------------------------------------------------
+
+static int csr_mmap(struct file* filp, struct vm_area_struct* vma)
+{
+    if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start > PAGE_SIZE) {
+        return -EINVAL;
+    }
+    if (vma->vm_flags & VM_WRITE) {
+        return -EPERM;
+    }
+
+    // Forbid a later mprotect(PROT_WRITE).
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 3, 0)
+    vma->vm_flags &= ~VM_MAYWRITE;
+#else
+    vm_flags_clear(vma, VM_MAYWRITE);
+#endif
+
+    return remap_pfn_range(vma, vma->vm_start, virt_to_phys(csr_snapshot) >> PAGE_SHIFT, vma->vm_end - vma->vm_start, vma->vm_page_prot);
+}
+
+
+//----------------------------------------------------------------------------
+// Called on read() from userland: drain the sampler ring buffers.
+// Only whole samples are returned. Return zero when no sample is available.
+//----------------------------------------------------------------------------
+
+// Number of samples which are copied to userland at a time.
+#define CSR_SAMPLER_READ_CHUNK 32
+
+static ssize_t csr_read(struct file* filp, char __user* buf, size_t len, loff_t* off)
+{
+    const size_t max = len / sizeof(csr_sample_t);
+    csr_sample_t* chunk = NULL;
+    size_t done = 0;
+    ssize_t status = 0;
+    unsigned int cpu = 0;
+
+    if (max == 0) {
+        return -EINVAL;
+    }
+    chunk = kmalloc(CSR_SAMPLER_READ_CHUNK * sizeof(csr_sample_t), GFP_KERNEL);
+    if (chunk == NULL) {
+        return -ENOMEM;
+    }
+
+    mutex_lock(&csr_sampler_mutex);
+    if (csr_sampler_allocated) {
+        for_each_possible_cpu(cpu) {
+            struct csr_sampler_cpu* sc = &per_cpu(csr_sampler_cpus, cpu);
+            while (status == 0 && done < max && sc->ring != NULL) {
+                // Extract samples from the ring under the lock, copy to userland outside the lock.
+                unsigned long flags = 0;
+                size_t count = 0;
+                spin_lock_irqsave(&sc->lock, flags);
+                while (count < CSR_SAMPLER_READ_CHUNK && done + count < max && sc->tail < sc->head) {
+                    chunk[count++] = sc->ring[sc->tail++ % CSR_SAMPLER_RING_SIZE];
+                }
+                spin_unlock_irqrestore(&sc->lock, flags);
+                if (count == 0) {
+                    break;
+                }
+                if (copy_to_user(buf + done * sizeof(csr_sample_t), chunk, count * sizeof(csr_sample_t))) {
+                    status = -EFAULT;
+                }
+                done += count;
+            }
+        }
+    }
+    mutex_unlock(&csr_sampler_mutex);
+
+    kfree(chunk);
+    return status < 0 ? status : (ssize_t)(done * sizeof(csr_sample_t));
+}
+
+
+//----------------------------------------------------------------------------
+// Called on poll() from userland: POLLPRI when watched registers changed.
+//----------------------------------------------------------------------------
+
+static __poll_t csr_poll(struct file* filp, poll_table* wait)
+{
+    __poll_t mask = 0;
+    unsigned long flags = 0;
+
+    poll_wait(filp, &csr_watch_waitq, wait);
+    spin_lock_irqsave(&csr_watch_lock, flags);
+    if (csr_watch_event.changed != 0) {
+        mask |= EPOLLPRI;
+    }
+    spin_unlock_irqrestore(&csr_watch_lock, flags);
+    return mask;
+}
+
+
+//----------------------------------------------------------------------------
+// Called when a file descriptor on the device is closed.
+//----------------------------------------------------------------------------
+
+static int csr_release(struct inode* inode, struct file* filp)
+{
+    // Don't leave the sampler running when its owner is gone.
+    mutex_lock(&csr_sampler_mutex);
+    if (csr_sampler_owner == filp) {
+        csr_sampler_stop();
+    }
+    mutex_unlock(&csr_sampler_mutex);
+    mutex_lock(&csr_spe_mutex);
+    if (csr_spe_owner == filp) {
+        csr_spe_stop();
+    }
+    mutex_unlock(&csr_spe_mutex);
+    mutex_lock(&csr_watch_mutex);
+    if (csr_watch_owner == filp) {
+        csr_watch_stop();
+    }
+    mutex_unlock(&csr_watch_mutex);
+    return 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Cross-CPU calls for multi-register commands.
+//----------------------------------------------------------------------------
+
+struct csr_cross_call {
+    csr_multi_reg_t* regs;   // first register (multi) or first CPU block (all-CPU)
+    csr_u64_t        count;  // number of registers (per CPU)
+    csr_u64_t        cpus;   // number of CPU blocks (all-CPU)
+};
+
+// Executed on a given CPU core, read registers from a multi-register command.
+static void csr_cross_call_multi(void* info)
+{
+    struct csr_cross_call* call = (struct csr_cross_call*)info;
+    csr_get_registers(call->regs, call->count, cpu_features);
+}
+
+// Executed on all CPU cores, read registers in the block of the current CPU.
+static void csr_cross_call_allcpus(void* info)
+{
+    struct csr_cross_call* call = (struct csr_cross_call*)info;
+    const unsigned int cpu = smp_processor_id();
+    if (cpu < call->cpus) {
+        csr_get_registers(call->regs + cpu * call->count, call->count, cpu_features);
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Called on ioctl(CSR_IOC_GET_MULTI) from userland.
+//----------------------------------------------------------------------------
+
+static long csr_ioctl_multi(unsigned long param)
+{
+    csr_multi_t head;
+    struct csr_cross_call call;
+    size_t size = 0;
+    long status = 0;
+
+    // Get the header of the command, then the list of registers.
+    if (copy_from_user(&head, (void*)param, sizeof(head))) {
+        return -EFAULT;
+    }
+    if (head.count == 0) {
+        return 0;
+    }
+    if (head.count > CSR_MULTI_MAX) {
+        return -E2BIG;
+    }
+    if (head.cpu != CSR_CPU_ANY && (head.cpu >= nr_cpu_ids || !cpu_online((unsigned int)head.cpu))) {
+        return -ENODEV;
+    }
+    size = head.count * sizeof(csr_multi_reg_t);
+    call.regs = memdup_user((char*)param + sizeof(head), size);
+    call.count = head.count;
+    call.cpus = 1;
+    if (IS_ERR(call.regs)) {
+        return PTR_ERR(call.regs);
+    }
+
+    // Read all registers, each one with its own status, on the requested CPU if necessary.
+    if (head.cpu == CSR_CPU_ANY) {
+        csr_get_registers(call.regs, call.count, cpu_features);
+    }
+    else {
+        status = smp_call_function_single((int)head.cpu, csr_cross_call_multi, &call, 1);
+    }
+    if (status == 0 && copy_to_user((char*)param + sizeof(head), call.regs, size)) {
+        status = -EFAULT;
+    }
+    kfree(call.regs);
+    return status;
+}
+
+
+//----------------------------------------------------------------------------
+// Called on ioctl(CSR_IOC_GET_ALLCPUS) from userland.
+//----------------------------------------------------------------------------
+
+static long csr_ioctl_allcpus(unsigned long param)
+{
+    csr_allcpus_t head;
+    struct csr_cross_call call;
+    csr_u64_t cpu = 0;
+    csr_u64_t i = 0;
+    size_t size = 0;
+    long status = 0;
+
+    // Get the header of the command, then the list of registers for the first CPU.
+    if (copy_from_user(&head, (void*)param, sizeof(head))) {
+        return -EFAULT;
+    }
+    if (head.count > CSR_MULTI_MAX || head.cpus > CSR_ALLCPUS_MAX || head.count * head.cpus > CSR_ALLCPUS_MAX) {
+        return -E2BIG;
+    }
+    call.count = head.count;
+    call.cpus = min_t(csr_u64_t, head.cpus, nr_cpu_ids);
+    head.cpus = nr_cpu_ids;
+    if (call.count > 0 && call.cpus > 0) {
+        size = call.count * call.cpus * sizeof(csr_multi_reg_t);
+        call.regs = kvmalloc(size, GFP_KERNEL);
+        if (call.regs == NULL) {
+            return -ENOMEM;
+        }
+        if (copy_from_user(call.regs, (char*)param + sizeof(head), call.count * sizeof(csr_multi_reg_t))) {
+            kvfree(call.regs);
+            return -EFAULT;
+        }
+
+        // Replicate the list of registers in all CPU blocks, with status "CPU offline".
+        for (cpu = 0; cpu < call.cpus; cpu++) {
+            for (i = 0; i < call.count; i++) {
+                csr_multi_reg_t* reg = call.regs + cpu * call.count + i;
+                reg->regid = call.regs[i].regid;
+                reg->status = 3;
+                reg->value.low = reg->value.high = 0;
+            }
+        }
+
+        // Read all registers on all online CPU cores at once.
+        on_each_cpu(csr_cross_call_allcpus, &call, 1);
+
+        if (copy_to_user((char*)param + sizeof(head), call.regs, size)) {
+            status = -EFAULT;
+        }
+        kvfree(call.regs);
+    }
+
+    // Return the actual number of CPU cores.
+    if (status == 0 && copy_to_user((void*)param, &head, sizeof(head))) {
+        status = -EFAULT;
+    }
+    return status;
+}
+
+
+//----------------------------------------------------------------------------
+// Called on ioctl(CSR_IOC_INSTR_BATCH) from userland.
+//----------------------------------------------------------------------------
+
+static long csr_ioctl_instr_batch(unsigned long param)
+{
+    csr_instr_batch_t head;
+    csr_instr_item_t* items = NULL;
+    size_t size = 0;
+    long status = 0;
+
+    // Get the header of the command, then the list of instructions.
+    if (copy_from_user(&head, (void*)param, sizeof(head))) {
+        return -EFAULT;
+    }
+    if (head.count == 0) {
+        return 0;
+    }
+    if (head.count > CSR_INSTR_BATCH_MAX) {
+        return -E2BIG;
+    }
+    size = head.count * sizeof(csr_instr_item_t);
+    items = kvmalloc(size, GFP_KERNEL);
+    if (items == NULL) {
+        return -ENOMEM;
+    }
+    if (copy_from_user(items, (char*)param + sizeof(head), size)) {
+        kvfree(items);
+        return -EFAULT;
+    }
+
+    // Execute all instructions, each one with its own status.
+    csr_exec_instr_batch(items, head.count);
+    if (copy_to_user((char*)param + sizeof(head), items, size)) {
+        status = -EFAULT;
+    }
+    kvfree(items);
+    return status;
+}
+
+
+//----------------------------------------------------------------------------
+// Called on ioctl(CSR_IOC_REQUESTS) from userland.
+//----------------------------------------------------------------------------
+
+struct csr_requests_call {
+    csr_request_t* reqs;
+    csr_u64_t      count;
+};
+
+// Executed on a given CPU core, execute all requests.
+static void csr_cross_call_requests(void* info)
+{
+    struct csr_requests_call* call = (struct csr_requests_call*)info;
+    csr_exec_requests(call->reqs, call->count, cpu_features);
+}
+
+static long csr_ioctl_requests(unsigned long param)
+{
+    csr_requests_t head;
+    struct csr_requests_call call;
+    size_t size = 0;
+    long status = 0;
+
+    // Get the header of the command, then the list of requests.
+    if (copy_from_user(&head, (void*)param, sizeof(head))) {
+        return -EFAULT;
+    }
+    if (head.count == 0) {
+        return 0;
+    }
+    if (head.count > CSR_REQUESTS_MAX) {
+        return -E2BIG;
+    }
+    if (head.cpu != CSR_CPU_ANY && (head.cpu >= nr_cpu_ids || !cpu_online((unsigned int)head.cpu))) {
+        return -ENODEV;
+    }
+    size = head.count * sizeof(csr_request_t);
+    call.count = head.count;
+    call.reqs = kvmalloc(size, GFP_KERNEL);
+    if (call.reqs == NULL) {
+        return -ENOMEM;
+    }
+    if (copy_from_user(call.reqs, (char*)param + sizeof(head), size)) {
+        kvfree(call.reqs);
+        return -EFAULT;
+    }
+
+    // All requests are executed on the same CPU core, without migration between them.
+    if (head.cpu == CSR_CPU_ANY) {
+        get_cpu();
+        csr_exec_requests(call.reqs, call.count, cpu_features);
+        put_cpu();
+    }
+    else {
+        status = smp_call_function_single((int)head.cpu, csr_cross_call_requests, &call, 1);
+    }
+    if (status == 0 && copy_to_user((char*)param + sizeof(head), call.reqs, size)) {
+        status = -EFAULT;
+    }
+    kvfree(call.reqs);
+    return status;
+}
+
+
+//----------------------------------------------------------------------------
+// Called on ioctl(CSR_IOC_SWAP_PAC_KEYS) from userland.
+//----------------------------------------------------------------------------
+
+static long csr_ioctl_swap_pac_keys(unsigned long param)
+{
+    csr_pac_keys_t keys;
+    unsigned long flags = 0;
+
+    if (copy_from_user(&keys, (void*)param, sizeof(keys))) {
+        return -EFAULT;
+    }
+
+    // No interrupt, no preemption, while the keys are updated.
+    local_irq_save(flags);
+    csr_swap_pac_keys(&keys, cpu_features);
+    local_irq_restore(flags);
+
+    return copy_to_user((void*)param, &keys, sizeof(keys)) ? -EFAULT : 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Called on ioctl(CSR_IOC_SWAP_PMU) from userland.
+//----------------------------------------------------------------------------
+
+struct csr_pmu_call {
+    csr_pmu_state_t state;     // new state, same on all CPU cores
+    csr_pmu_state_t previous;  // previous state, on the CPU core of the caller
+    unsigned int    cpu;       // CPU core of the caller
+};
+
+// Executed on all CPU cores, with interrupts disabled.
+static void csr_cross_call_pmu(void* info)
+{
+    struct csr_pmu_call* call = (struct csr_pmu_call*)info;
+    csr_pmu_state_t state = call->state;
+    csr_swap_pmu(&state, cpu_features);
+    if (smp_processor_id() == call->cpu) {
+        call->previous = state;
+    }
+}
+
+static long csr_ioctl_swap_pmu(unsigned long param)
+{
+    struct csr_pmu_call* call = kzalloc(sizeof(struct csr_pmu_call), GFP_KERNEL);
+    long status = 0;
+
+    if (call == NULL) {
+        return -ENOMEM;
+    }
+    if (copy_from_user(&call->state, (void*)param, sizeof(call->state))) {
+        kfree(call);
+        return -EFAULT;
+    }
+
+    // Keep the caller on the same CPU core to get its previous state.
+    call->cpu = get_cpu();
+    on_each_cpu(csr_cross_call_pmu, call, 1);
+    put_cpu();
+
+    if (copy_to_user((void*)param, &call->previous, sizeof(call->previous))) {
+        status = -EFAULT;
+    }
+    kfree(call);
+    return status;
+}
+
+
+//----------------------------------------------------------------------------
+// Called on ioctl(CSR_IOC_GET_CACHES) from userland.
+//----------------------------------------------------------------------------
+
+// Executed on a given CPU core, with interrupts disabled.
+static void csr_cross_call_caches(void* info)
+{
+    csr_get_cache_info((csr_cache_info_t*)info, cpu_features);
+}
+
+static long csr_ioctl_get_caches(unsigned long param)
+{
+    csr_cache_info_t info;
+    unsigned long flags = 0;
+    long status = 0;
+
+    if (copy_from_user(&info, (void*)param, sizeof(info))) {
+        return -EFAULT;
+    }
+    if (info.cpu != CSR_CPU_ANY && (info.cpu >= nr_cpu_ids || !cpu_online((unsigned int)info.cpu))) {
+        return -ENODEV;
+    }
+
+    // No interrupt, no preemption, between the selection in CSSELR_EL1 and the reads.
+    if (info.cpu == CSR_CPU_ANY) {
+        local_irq_save(flags);
+        csr_get_cache_info(&info, cpu_features);
+        local_irq_restore(flags);
+    }
+    else {
+        status = smp_call_function_single((int)info.cpu, csr_cross_call_caches, &info, 1);
+    }
+    if (status == 0 && copy_to_user((void*)param, &info, sizeof(info))) {
+        status = -EFAULT;
+    }
+    return status;
+}
+
+
+//----------------------------------------------------------------------------
+// Called on ioctl(CSR_IOC_GET_RANDOM) from userland.
+//----------------------------------------------------------------------------
+
+static long csr_ioctl_get_random(unsigned long param)
+{
+    // Too large for the kernel stack.
+    csr_random_t* rnd = kzalloc(sizeof(csr_random_t), GFP_KERNEL);
+    long status = 0;
+
+    if (rnd == NULL) {
+        return -ENOMEM;
+    }
+    if (copy_from_user(rnd, (void*)param, sizeof(*rnd))) {
+        kfree(rnd);
+        return -EFAULT;
+    }
+    csr_get_random(rnd, cpu_features);
+    if (copy_to_user((void*)param, rnd, sizeof(*rnd))) {
+        status = -EFAULT;
+    }
+    kfree(rnd);
+    return status;
+}
+
+
+//----------------------------------------------------------------------------
+// Periodic sampler.
+//----------------------------------------------------------------------------
+
+// Timer handler, in interrupt context, on the CPU core of the timer.
+static enum hrtimer_restart csr_sampler_tick(struct hrtimer* timer)
+{
+    struct csr_sampler_cpu* sc = container_of(timer, struct csr_sampler_cpu, timer);
+    csr_sample_t sample;
+    csr_pair_t reg;
+    csr_u64_t i;
+
+    // Read the registers first, as close as possible to the timer expiration.
+    sample.expires_ns = ktime_to_ns(hrtimer_get_expires(timer));
+    sample.time_ns = ktime_get_ns();
+    sample.status = 0;
+    for (i = 0; i < CSR_SAMPLER_MAX_REGS; i++) {
+        reg.low = 0;
+        if (i < csr_sampler_params.count && csr_get_register((int)csr_sampler_params.regids[i], &reg, cpu_features)) {
+            sample.status |= (csr_u64_t)1 << i;
+        }
+        sample.values[i] = reg.low;
+    }
+    sample.cpu = sc->cpu;
+
+    // Store the sample in the ring, drop it if the ring is full.
+    spin_lock(&sc->lock);
+    sample.seq = sc->seq++;
+    if (sc->head - sc->tail >= CSR_SAMPLER_RING_SIZE) {
+        sc->dropped++;
+    }
+    else {
+        sample.dropped = sc->dropped;
+        sc->ring[sc->head++ % CSR_SAMPLER_RING_SIZE] = sample;
+    }
+    spin_unlock(&sc->lock);
+
+    hrtimer_forward_now(timer, ns_to_ktime(csr_sampler_params.period_ns));
+    return HRTIMER_RESTART;
+}
+
+// Executed on all CPU cores, start the timer of the current CPU.
+static void csr_sampler_start_cpu(void* info)
+{
+    struct csr_sampler_cpu* sc = this_cpu_ptr(&csr_sampler_cpus);
+    if (sc->ring != NULL) {
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 13, 0)
+        hrtimer_init(&sc->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_PINNED);
+        sc->timer.function = csr_sampler_tick;
+#else
+        hrtimer_setup(&sc->timer, csr_sampler_tick, CLOCK_MONOTONIC, HRTIMER_MODE_REL_PINNED);
+#endif
+        hrtimer_start(&sc->timer, ns_to_ktime(csr_sampler_params.period_ns), HRTIMER_MODE_REL_PINNED);
+        sc->started = true;
+    }
+}
+
+// Stop all timers. Must be called with csr_sampler_mutex held.
+static void csr_sampler_stop(void)
+{
+    unsigned int cpu = 0;
+    for_each_possible_cpu(cpu) {
+        struct csr_sampler_cpu* sc = &per_cpu(csr_sampler_cpus, cpu);
+        if (sc->started) {
+            hrtimer_cancel(&sc->timer);
+            sc->started = false;
+        }
+    }
+    csr_sampler_owner = NULL;
+}
+
+// Free all ring buffers. Timers must be stopped. Must be called with csr_sampler_mutex held.
+static void csr_sampler_free(void)
+{
+    unsigned int cpu = 0;
+    for_each_possible_cpu(cpu) {
+        struct csr_sampler_cpu* sc = &per_cpu(csr_sampler_cpus, cpu);
+        kvfree(sc->ring);
+        sc->ring = NULL;
+    }
+    csr_sampler_allocated = false;
+}
+
+
+//----------------------------------------------------------------------------
+// Called on ioctl(CSR_IOC_SAMPLER_START) from userland.
+//----------------------------------------------------------------------------
+
+static long csr_ioctl_sampler_start(struct file* filp, unsigned long param)
+{
+    csr_sampler_t params;
+    unsigned int cpu = 0;
+    csr_u64_t i;
+    long status = 0;
+
+    // Check the sampler parameters.
+    if (copy_from_user(&params, (void*)param, sizeof(params))) {
+        return -EFAULT;
+    }
+    if (params.count == 0 || params.count > CSR_SAMPLER_MAX_REGS || params.period_ns < CSR_SAMPLER_MIN_PERIOD) {
+        return -EINVAL;
+    }
+    for (i = 0; i < params.count; i++) {
+        if (!csr_regid_is_valid((int)params.regids[i]) || csr_regid_is_pair((int)params.regids[i])) {
+            return -EINVAL;
+        }
+    }
+
+    mutex_lock(&csr_sampler_mutex);
+    if (csr_sampler_owner != NULL) {
+        mutex_unlock(&csr_sampler_mutex);
+        return -EBUSY;
+    }
+
+    // Samples from a previous session are lost.
+    csr_sampler_free();
+    csr_sampler_params = params;
+
+    // Allocate the ring buffers of online CPU cores and start the timers.
+    cpus_read_lock();
+    for_each_online_cpu(cpu) {
+        struct csr_sampler_cpu* sc = &per_cpu(csr_sampler_cpus, cpu);
+        spin_lock_init(&sc->lock);
+        sc->head = sc->tail = sc->seq = sc->dropped = 0;
+        sc->cpu = cpu;
+        sc->started = false;
+        sc->ring = kvmalloc(CSR_SAMPLER_RING_SIZE * sizeof(csr_sample_t), GFP_KERNEL);
+        if (sc->ring == NULL) {
+            status = -ENOMEM;
+            break;
+        }
+    }
+    csr_sampler_allocated = true;
+    if (status == 0) {
+        on_each_cpu(csr_sampler_start_cpu, NULL, 1);
+        csr_sampler_owner = filp;
+    }
+    else {
+        csr_sampler_free();
+    }
+    cpus_read_unlock();
+
+    mutex_unlock(&csr_sampler_mutex);
+    return status;
+}
+
+
+//----------------------------------------------------------------------------
+// Register watch.
+//----------------------------------------------------------------------------
+
+// Executed on one CPU core: read the watched registers and compare them with
+// the previous values on this core. Not called concurrently on the same core.
+static void csr_watch_check_cpu(void* info)
+{
+    struct csr_watch_cpu* wc = this_cpu_ptr(&csr_watch_cpus);
+    unsigned long flags = 0;
+    csr_u64_t changed = 0;
+    csr_pair_t reg;
+    csr_u64_t i;
+
+    for (i = 0; i < csr_watch_params.count; i++) {
+        // A register which cannot be read is seen as zero.
+        reg.low = 0;
+        csr_get_register((int)csr_watch_params.regids[i], &reg, cpu_features);
+        if (wc->valid && reg.low != wc->values[i]) {
+            changed |= (csr_u64_t)1 << i;
+        }
+        wc->values[i] = reg.low;
+    }
+    wc->valid = true;
+
+    // Record the first change since the previous read and wake up the pollers.
+    if (changed != 0) {
+        spin_lock_irqsave(&csr_watch_lock, flags);
+        if (csr_watch_event.changed == 0) {
+            csr_watch_event.cpu = smp_processor_id();
+            csr_watch_event.time_ns = ktime_get_ns();
+            memcpy(csr_watch_event.values, wc->values, sizeof(csr_watch_event.values));
+        }
+        csr_watch_event.changed |= changed;
+        csr_watch_event.changes++;
+        spin_unlock_irqrestore(&csr_watch_lock, flags);
+        wake_up_interruptible(&csr_watch_waitq);
+    }
+}
+
+// Delayed work, check all online CPU cores and rearm.
+static void csr_watch_work_func(struct work_struct* work)
+{
+    on_each_cpu(csr_watch_check_cpu, NULL, 1);
+    if (READ_ONCE(csr_watch_owner) != NULL) {
+        schedule_delayed_work(&csr_watch_work, nsecs_to_jiffies(csr_watch_params.period_ns));
+    }
+}
+
+// Stop the watch. Must be called with csr_watch_mutex held.
+static void csr_watch_stop(void)
+{
+    cpus_read_lock();
+    WRITE_ONCE(csr_watch_owner, NULL);
+    cpus_read_unlock();
+    cancel_delayed_work_sync(&csr_watch_work);
+}
+
+
+//----------------------------------------------------------------------------
+// Called on ioctl(CSR_IOC_WATCH_START) from userland.
+//----------------------------------------------------------------------------
+
+static long csr_ioctl_watch_start(struct file* filp, unsigned long param)
+{
+    csr_watch_t params;
+    unsigned int cpu = 0;
+    csr_u64_t i;
+
+    // Check the watch parameters.
+    if (copy_from_user(&params, (void*)param, sizeof(params))) {
+        return -EFAULT;
+    }
+    if (params.count == 0 || params.count > CSR_WATCH_MAX_REGS || params.period_ns < CSR_WATCH_MIN_PERIOD) {
+        return -EINVAL;
+    }
+    for (i = 0; i < params.count; i++) {
+        if (!csr_regid_is_valid((int)params.regids[i]) || csr_regid_is_pair((int)params.regids[i])) {
+            return -EINVAL;
+        }
+    }
+
+    mutex_lock(&csr_watch_mutex);
+    if (csr_watch_owner != NULL) {
+        mutex_unlock(&csr_watch_mutex);
+        return -EBUSY;
+    }
+
+    // Read the initial values on all online CPU cores. Changes from a previous watch are lost.
+    cpus_read_lock();
+    csr_watch_params = params;
+    memset(&csr_watch_event, 0, sizeof(csr_watch_event));
+    for_each_possible_cpu(cpu) {
+        per_cpu(csr_watch_cpus, cpu).valid = false;
+    }
+    on_each_cpu(csr_watch_check_cpu, NULL, 1);
+    WRITE_ONCE(csr_watch_owner, filp);
+    cpus_read_unlock();
+
+    schedule_delayed_work(&csr_watch_work, nsecs_to_jiffies(params.period_ns));
+    mutex_unlock(&csr_watch_mutex);
+    return 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Called on ioctl(CSR_IOC_WATCH_READ) from userland.
+//----------------------------------------------------------------------------
+
+static long csr_ioctl_watch_read(unsigned long param)
+{
+    csr_watch_event_t event;
+    unsigned long flags = 0;
+
+    spin_lock_irqsave(&csr_watch_lock, flags);
+    event = csr_watch_event;
+    csr_watch_event.changed = 0;
+    spin_unlock_irqrestore(&csr_watch_lock, flags);
+
+    return copy_to_user((void*)param, &event, sizeof(event)) ? -EFAULT : 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Per-CPU snapshots of the immutable registers in sysfs.
+//----------------------------------------------------------------------------
+
+// A text attribute, the hexadecimal value of one register in the snapshot.
+struct csr_idreg_attr {
+    struct kobj_attribute attr;
+    int regid;
+};
+
+static ssize_t csr_idreg_show(struct kobject* kobj, struct kobj_attribute* attr, char* buf);
+
+#define _idreg(str, id) {.attr = {.attr = {.name = (str), .mode = 0444}, .show = csr_idreg_show}, .regid = (id)}
+
+static struct csr_idreg_attr csr_idreg_attrs[] = {
+    _idreg("midr_el1",         CSR_REGID_MIDR_EL1),
+    _idreg("mpidr_el1",        CSR_REGID_MPIDR_EL1),
+    _idreg("revidr_el1",       CSR_REGID_REVIDR_EL1),
+    _idreg("ctr_el0",          CSR_REGID_CTR_EL0),
+    _idreg("clidr_el1",        CSR_REGID_CLIDR_EL1),
+    _idreg("id_aa64pfr0_el1",  CSR_REGID_ID_AA64PFR0_EL1),
+    _idreg("id_aa64pfr1_el1",  CSR_REGID_ID_AA64PFR1_EL1),
+    _idreg("id_aa64pfr2_el1",  CSR_REGID_ID_AA64PFR2_EL1),
+    _idreg("id_aa64isar0_el1", CSR_REGID_ID_AA64ISAR0_EL1),
+    _idreg("id_aa64isar1_el1", CSR_REGID_ID_AA64ISAR1_EL1),
+    _idreg("id_aa64isar2_el1", CSR_REGID_ID_AA64ISAR2_EL1),
+    _idreg("id_aa64mmfr0_el1", CSR_REGID_ID_AA64MMFR0_EL1),
+    _idreg("id_aa64mmfr1_el1", CSR_REGID_ID_AA64MMFR1_EL1),
+    _idreg("id_aa64mmfr2_el1", CSR_REGID_ID_AA64MMFR2_EL1),
+    _idreg("id_aa64mmfr3_el1", CSR_REGID_ID_AA64MMFR3_EL1),
+    _idreg("id_aa64mmfr4_el1", CSR_REGID_ID_AA64MMFR4_EL1),
+    _idreg("id_aa64dfr0_el1",  CSR_REGID_ID_AA64DFR0_EL1),
+    _idreg("id_aa64dfr1_el1",  CSR_REGID_ID_AA64DFR1_EL1),
+    _idreg("id_aa64afr0_el1",  CSR_REGID_ID_AA64AFR0_EL1),
+    _idreg("id_aa64afr1_el1",  CSR_REGID_ID_AA64AFR1_EL1),
+    _idreg("id_aa64zfr0_el1",  CSR_REGID_ID_AA64ZFR0_EL1),
+    _idreg("id_aa64smfr0_el1", CSR_REGID_ID_AA64SMFR0_EL1),
+};
+
+#undef _idreg
+
+static struct attribute* csr_idregs_attrs[ARRAY_SIZE(csr_idreg_attrs) + 1];
+
+static struct attribute_group csr_idregs_group = {
+    .attrs = csr_idregs_attrs,
+};
+
+// The binary attribute, the complete csr_snapshot_t structure.
+// The "const" parameter has the same issue as in csr_devnode(), the "read" callback
+// of bin_attribute uses "const struct bin_attribute*" in recent kernels only.
+
+static ssize_t csr_idregs_read(struct file* filp, struct kobject* kobj, const struct bin_attribute* attr, char* buf, loff_t off, size_t count);
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wincompatible-pointer-types"
+static struct bin_attribute csr_idregs_bin = {
+    .attr = {.name = "snapshot", .mode = 0444},
+    .size = sizeof(csr_snapshot_t),
+    .read = csr_idregs_read,
+};
+#pragma GCC diagnostic pop
+
+// Get the snapshot of the CPU core of a sysfs directory, NULL if not yet read.
+static const csr_snapshot_t* csr_idregs_snapshot(struct kobject* kobj)
+{
+    const unsigned int cpu = kobj_to_dev(kobj->parent)->id;
+    return csr_idregs != NULL && cpu < nr_cpu_ids && csr_snapshot_is_valid(&csr_idregs[cpu].snap) ? &csr_idregs[cpu].snap : NULL;
+}
+
+static ssize_t csr_idreg_show(struct kobject* kobj, struct kobj_attribute* attr, char* buf)
+{
+    const struct csr_idreg_attr* idattr = container_of(attr, struct csr_idreg_attr, attr);
+    const csr_snapshot_t* snap = csr_idregs_snapshot(kobj);
+    const csr_multi_reg_t* reg = snap == NULL ? NULL : csr_snapshot_find(snap, idattr->regid);
+
+    if (reg == NULL || reg->status != 0) {
+        return -ENODATA;
+    }
+    return scnprintf(buf, PAGE_SIZE, "0x%016llx\n", (unsigned long long)reg->value.low);
+}
+
+static ssize_t csr_idregs_read(struct file* filp, struct kobject* kobj, const struct bin_attribute* attr, char* buf, loff_t off, size_t count)
+{
+    const csr_snapshot_t* snap = csr_idregs_snapshot(kobj);
+    return snap == NULL ? -ENODATA : memory_read_from_buffer(buf, count, &off, snap, sizeof(csr_snapshot_t));
+}
+
+// Executed on one CPU core: read the snapshot of this core.
+static void csr_idregs_fill_cpu(void* info)
+{
+    csr_fill_snapshot(&csr_idregs[smp_processor_id()].snap, cpu_features, 1);
+}
+
+// Create the sysfs directories of all CPU cores. Failures are not fatal.
+static void csr_idregs_create(void)
+{
+    struct device* dev = NULL;
+    struct kobject* kobj = NULL;
+    unsigned int cpu = 0;
+    size_t i;
+
+    if (csr_idregs == NULL) {
+        return;
+    }
+    for (i = 0; i < ARRAY_SIZE(csr_idreg_attrs); i++) {
+        csr_idregs_attrs[i] = &csr_idreg_attrs[i].attr.attr;
+    }
+    for_each_possible_cpu(cpu) {
+        dev = get_cpu_device(cpu);
+        if (dev == NULL) {
+            continue;
+        }
+        kobj = kobject_create_and_add(CSR_MODULE_NAME, &dev->kobj);
+        if (kobj == NULL || sysfs_create_group(kobj, &csr_idregs_group) != 0 || sysfs_create_bin_file(kobj, &csr_idregs_bin) != 0) {
+            pr_warn("%s: failed to create the sysfs directory of CPU %u\n", CSR_MODULE_NAME, cpu);
+            if (kobj != NULL) {
+                kobject_put(kobj);
+            }
+            continue;
+        }
+        csr_idregs[cpu].kobj = kobj;
+    }
+}
+
+// Remove the sysfs directories of all CPU cores.
+static void csr_idregs_remove(void)
+{
+    unsigned int cpu = 0;
+
+    if (csr_idregs == NULL) {
+        return;
+    }
+    for_each_possible_cpu(cpu) {
+        if (csr_idregs[cpu].kobj != NULL) {
+            kobject_put(csr_idregs[cpu].kobj);
+            csr_idregs[cpu].kobj = NULL;
+        }
+    }
+}
+
+// CPU hotplug callback, executed on the CPU core which comes online, also after resume
+// and, when the callback is registered, on all online CPU cores. The per-CPU data are
+// also updated by the IPI of the watch (csr_watch_check_cpu), the interrupts are masked.
+static int csr_cpu_online(unsigned int cpu)
+{
+    unsigned long flags = 0;
+
+    local_irq_save(flags);
+    if (csr_idregs != NULL) {
+        csr_idregs_fill_cpu(NULL);
+    }
+    if (READ_ONCE(csr_watch_owner) != NULL) {
+        csr_watch_check_cpu(NULL);
+    }
+    local_irq_restore(flags);
+    return 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Statistical profiling.
+//----------------------------------------------------------------------------
+
+// Bits in PMSCR_EL1 which can be set from userland: E0SPE, E1SPE, CX, PA, TS, PCT.
+#define CSR_PMSCR_MASK 0xFB
+
+// Bits in PMBLIMITR_EL1 and PMBIDR_EL1.
+#define CSR_PMBLIMITR_E     0x01
+#define CSR_PMBIDR_P        0x10
+
+// Profiling synchronization barrier, PSB CSYNC (in the HINT space).
+#define csr_psb_csync()     asm volatile("hint #17" : : : "memory")
+#define csr_dsb_nsh()       asm volatile("dsb nsh" : : : "memory")
+
+// Executed on all CPU cores, start the profiling on the current CPU.
+static void csr_spe_start_cpu(void* info)
+{
+    struct csr_spe_cpu* sc = this_cpu_ptr(&csr_spe_cpus);
+    const csr_u64_t base = (csr_u64_t)sc->buffer;
+    csr_u64_t pmbidr = 0;
+
+    // Skip CPU cores without buffer or when the profiling buffer is owned by a higher exception level.
+    csr_mrs(pmbidr, CSR_SREG_PMBIDR_EL1);
+    if (sc->buffer == NULL || (pmbidr & CSR_PMBIDR_P) != 0) {
+        return;
+    }
+
+    // Profiling buffer, fill mode (stop when full).
+    csr_msr(CSR_SREG_PMBSR_EL1, 0);
+    csr_msr(CSR_SREG_PMBPTR_EL1, base);
+    csr_msr(CSR_SREG_PMBLIMITR_EL1, (base + csr_spe_params.buffer_size) | CSR_PMBLIMITR_E);
+    csr_isb();
+
+    // Sampling controls.
+    csr_msr(CSR_SREG_PMSFCR_EL1, csr_spe_params.pmsfcr);
+    csr_msr(CSR_SREG_PMSEVFR_EL1, csr_spe_params.pmsevfr);
+    csr_msr(CSR_SREG_PMSLATFR_EL1, csr_spe_params.pmslatfr);
+    csr_msr(CSR_SREG_PMSIRR_EL1, csr_spe_params.interval & 0xFFFFFF00);
+    csr_msr(CSR_SREG_PMSICR_EL1, 0);
+    csr_isb();
+    csr_msr(CSR_SREG_PMSCR_EL1, csr_spe_params.pmscr & CSR_PMSCR_MASK);
+    csr_isb();
+    sc->started = true;
+}
+
+// Executed on all CPU cores, stop the profiling on the current CPU.
+static void csr_spe_stop_cpu(void* info)
+{
+    struct csr_spe_cpu* sc = this_cpu_ptr(&csr_spe_cpus);
+    csr_u64_t ptr = 0;
+
+    if (sc->started) {
+        // Stop sampling, then drain the pending records to memory before disabling the buffer.
+        csr_msr(CSR_SREG_PMSCR_EL1, 0);
+        csr_isb();
+        csr_psb_csync();
+        csr_dsb_nsh();
+        csr_msr(CSR_SREG_PMBLIMITR_EL1, 0);
+        csr_isb();
+        csr_mrs(ptr, CSR_SREG_PMBPTR_EL1);
+        csr_mrs(sc->pmbsr, CSR_SREG_PMBSR_EL1);
+        csr_msr(CSR_SREG_PMBSR_EL1, 0);
+        sc->used = ptr - (csr_u64_t)sc->buffer;
+        if (sc->used > csr_spe_params.buffer_size) {
+            sc->used = csr_spe_params.buffer_size;
+        }
+        sc->started = false;
+    }
+}
+
+// Stop the profiling on all CPU cores. Must be called with csr_spe_mutex held.
+static void csr_spe_stop(void)
+{
+    if (csr_spe_owner != NULL) {
+        on_each_cpu(csr_spe_stop_cpu, NULL, 1);
+        csr_spe_owner = NULL;
+    }
+}
+
+// Free all profiling buffers. Profiling must be stopped. Must be called with csr_spe_mutex held.
+static void csr_spe_free(void)
+{
+    unsigned int cpu = 0;
+    for_each_possible_cpu(cpu) {
+        struct csr_spe_cpu* sc = &per_cpu(csr_spe_cpus, cpu);
+        vfree(sc->buffer);
+        sc->buffer = NULL;
+        sc->used = sc->pmbsr = 0;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Called on ioctl(CSR_IOC_SPE_START) from userland.
+//----------------------------------------------------------------------------
+
+static long csr_ioctl_spe_start(struct file* filp, unsigned long param)
+{
+    csr_spe_config_t params;
+    unsigned int cpu = 0;
+    long status = 0;
+
+    // The profiling buffer is not accessible from EL0 when the kernel is unmapped (KPTI).
+    if (!csr_spe_allowed || (cpu_features & FEAT_SPE) == 0 || arm64_kernel_unmapped_at_el0()) {
+        return -EOPNOTSUPP;
+    }
+    if (copy_from_user(&params, (void*)param, sizeof(params))) {
+        return -EFAULT;
+    }
+    if (params.buffer_size < CSR_SPE_MIN_BUFFER ||
+        params.buffer_size > CSR_SPE_MAX_BUFFER ||
+        params.buffer_size % CSR_SPE_MIN_BUFFER != 0 ||
+        params.interval < 256 || params.interval > 0xFFFFFFFF)
+    {
+        return -EINVAL;
+    }
+
+    mutex_lock(&csr_spe_mutex);
+    if (csr_spe_owner != NULL) {
+        mutex_unlock(&csr_spe_mutex);
+        return -EBUSY;
+    }
+
+    // Records from a previous session are lost.
+    csr_spe_free();
+    csr_spe_params = params;
+
+    // Allocate the profiling buffers of online CPU cores and start the profiling.
+    cpus_read_lock();
+    for_each_online_cpu(cpu) {
+        struct csr_spe_cpu* sc = &per_cpu(csr_spe_cpus, cpu);
+        sc->started = false;
+        sc->buffer = vmalloc(params.buffer_size);
+        if (sc->buffer == NULL) {
+            status = -ENOMEM;
+            break;
+        }
+    }
+    if (status == 0) {
+        on_each_cpu(csr_spe_start_cpu, NULL, 1);
+        csr_spe_owner = filp;
+    }
+    else {
+        csr_spe_free();
+    }
+    cpus_read_unlock();
+
+    mutex_unlock(&csr_spe_mutex);
+    return status;
+}
+
+
+//----------------------------------------------------------------------------
+// Called on ioctl(CSR_IOC_SPE_READ) from userland.
+//----------------------------------------------------------------------------
+
+static long csr_ioctl_spe_read(unsigned long param)
+{
+    csr_spe_read_t req;
+    struct csr_spe_cpu* sc = NULL;
+    long status = 0;
+
+    if (copy_from_user(&req, (void*)param, sizeof(req))) {
+        return -EFAULT;
+    }
+    // The per-CPU data exist for possible CPU cores only (sparse CPU maps). The records remain
+    // after the profiling is stopped: a CPU core which went offline since then is still readable.
+    if (req.cpu >= nr_cpu_ids || !cpu_possible((unsigned int)req.cpu)) {
+        return -EINVAL;
+    }
+
+    mutex_lock(&csr_spe_mutex);
+    sc = &per_cpu(csr_spe_cpus, (unsigned int)req.cpu);
+    if (csr_spe_owner != NULL) {
+        // Profiling still in progress.
+        status = -EBUSY;
+    }
+    else if (sc->buffer == NULL || req.offset >= sc->used) {
+        // No more record on this CPU core.
+        req.size = 0;
+    }
+    else {
+        req.size = min_t(csr_u64_t, req.size, sc->used - req.offset);
+        if (copy_to_user((void __user*)req.address, (char*)sc->buffer + req.offset, req.size)) {
+            status = -EFAULT;
+        }
+    }
+    req.total = sc->used;
+    req.pmbsr = sc->pmbsr;
+    mutex_unlock(&csr_spe_mutex);
+
+    if (status == 0 && copy_to_user((void*)param, &req, sizeof(req))) {
+        status = -EFAULT;
+    }
+    return status;
+}
@@ -22,6 +22,10 @@ static void* _ctlref = NULL;
 static int stop_pending = 0;
 static int cpu_features = 0;
 
+// Snapshot of immutable registers.
+
+static csr_snapshot_t csr_snapshot;
+
 // Functions in this module.
 
 static kern_return_t csr_start(kmod_info_t*, void*);
@@ -52,6 +56,10 @@ static kern_return_t csr_start(kmod_info_t* kinfo, void* data)
     cpu_features = csr_get_cpu_features();
     stop_pending = 0;
 
+    // Build the snapshot of immutable registers.
+    bzero(&csr_snapshot, sizeof(csr_snapshot));
+    csr_fill_snapshot(&csr_snapshot, cpu_features, 0);
+
     // Register the control interface of this kernel extension.
     // Control id and unit are left as zero and will be dynamically allocated.
     struct kern_ctl_reg reg;
@@ -142,9 +150,136 @@ static errno_t csr_getopt(kern_ctl_ref kctlref, u_int32_t unit, void* unitinfo,
         return EFAULT;
     }
 
-    // Check if this an instruction to execute and get the result.
+    // Check if this a write and read back, a snapshot, a multi-register command or an instruction to execute.
     const int instr = csr_sockopt_to_instr(opt);
-    if (instr != CSR_INSTR_INVALID) {
+    const int setget_regid = csr_sockopt_to_setget_regid(opt);
+    if (setget_regid != CSR_REGID_INVALID) {
+        // Set a register and read it back. Input data contain the value to write.
+        const size_t size = csr_regid_is_pair(setget_regid) ? sizeof(csr_pair_t) : sizeof(csr_u64_t);
+        if (data == NULL) {
+            return EFAULT;
+        }
+        if (*len < size) {
+            return EINVAL;
+        }
+        *len = size;
+        switch (csr_setget_register(setget_regid, (csr_pair_t*)data, cpu_features)) {
+            case 0:
+                break;
+            case 3:
+                return ENODATA;
+            default:
+                return ENOTSUP;
+        }
+    }
+    else if (opt == CSR_SOCKOPT_GET_SNAPSHOT) {
+        // Return the snapshot of immutable registers. If data is NULL, simply return the expected size.
+        if (*len < sizeof(csr_snapshot_t)) {
+            return EINVAL;
+        }
+        *len = sizeof(csr_snapshot_t);
+        if (data != NULL) {
+            memcpy(data, &csr_snapshot, sizeof(csr_snapshot_t));
+        }
+    }
+    else if (opt == CSR_SOCKOPT_SWAP_PAC_KEYS) {
+        // Read and write all PAC keys at once. Input data contain the new keys.
+        if (data == NULL) {
+            return EFAULT;
+        }
+        if (*len < sizeof(csr_pac_keys_t)) {
+            return EINVAL;
+        }
+        *len = sizeof(csr_pac_keys_t);
+        csr_swap_pac_keys((csr_pac_keys_t*)data, cpu_features);
+    }
+    else if (opt == CSR_SOCKOPT_GET_CACHES) {
+        // Read the geometry of all caches on the current CPU core. Input data contain the CPU core.
+        if (data == NULL) {
+            return EFAULT;
+        }
+        if (*len < sizeof(csr_cache_info_t)) {
+            return EINVAL;
+        }
+        csr_cache_info_t* info = (csr_cache_info_t*)data;
+        if (info->cpu != CSR_CPU_ANY) {
+            return ENOTSUP;
+        }
+        *len = sizeof(csr_cache_info_t);
+        csr_get_cache_info(info, cpu_features);
+    }
+    else if (opt == CSR_SOCKOPT_GET_RANDOM) {
+        // Fill a buffer of random numbers. Input data contain the number of values.
+        if (data == NULL) {
+            return EFAULT;
+        }
+        if (*len < sizeof(csr_random_t)) {
+            return EINVAL;
+        }
+        *len = sizeof(csr_random_t);
+        csr_get_random((csr_random_t*)data, cpu_features);
+    }
+    else if (opt == CSR_SOCKOPT_INSTR_BATCH) {
+        // Execute a batch of instructions. Input data contain the list of instructions.
+        if (data == NULL) {
+            return EFAULT;
+        }
+        if (*len < sizeof(csr_instr_batch_t)) {
+            return EINVAL;
+        }
+        csr_instr_batch_t* batch = (csr_instr_batch_t*)data;
+        if (batch->count > CSR_INSTR_BATCH_MAX) {
+            return E2BIG;
+        }
+        if (*len < CSR_INSTR_BATCH_SIZE(batch->count)) {
+            return EINVAL;
+        }
+        *len = CSR_INSTR_BATCH_SIZE(batch->count);
+        csr_exec_instr_batch(CSR_INSTR_BATCH_ITEMS(batch), batch->count);
+    }
+    else if (opt == CSR_SOCKOPT_GET_MULTI) {
+        // Read several registers at once. Input data contain the list of registers.
+        if (data == NULL) {
+            return EFAULT;
+        }
+        if (*len < sizeof(csr_multi_t)) {
+            return EINVAL;
+        }
+        csr_multi_t* multi = (csr_multi_t*)data;
+        if (multi->count > CSR_MULTI_MAX) {
+            return E2BIG;
+        }
+        if (multi->cpu != CSR_CPU_ANY) {
+            return ENOTSUP;
+        }
+        if (*len < CSR_MULTI_SIZE(multi->count)) {
+            return EINVAL;
+        }
+        *len = CSR_MULTI_SIZE(multi->count);
+        csr_get_registers(CSR_MULTI_REGS(multi), multi->count, cpu_features);
+    }
+    else if (opt == CSR_SOCKOPT_REQUESTS) {
+        // Execute a batch of requests. Input data contain the list of requests.
+        if (data == NULL) {
+            return EFAULT;
+        }
+        if (*len < sizeof(csr_requests_t)) {
+            return EINVAL;
+        }
+        csr_requests_t* batch = (csr_requests_t*)data;
+        if (batch->count > CSR_REQUESTS_MAX) {
+            return E2BIG;
+        }
+        if (batch->cpu != CSR_CPU_ANY) {
+            return ENOTSUP;
+        }
+        if (*len < CSR_REQUESTS_SIZE(batch->count)) {
+            return EINVAL;
+        }
+        *len = CSR_REQUESTS_SIZE(batch->count);
+        csr_exec_requests(CSR_REQUESTS_ITEMS(batch), batch->count, cpu_features);
+    }
+    else if (instr != CSR_INSTR_INVALID) {
         // Execute that specific instruction. If data is NULL, simply return the expected size.
         if (*len < sizeof(csr_instr_t)) {
             return EINVAL;
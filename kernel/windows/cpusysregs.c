@@ -22,11 +22,22 @@ DRIVER_INITIALIZE DriverEntry;
 DRIVER_UNLOAD csr_unload;
 _Dispatch_type_(IRP_MJ_CREATE) _Dispatch_type_(IRP_MJ_CLOSE) DRIVER_DISPATCH csr_open_close;
 _Dispatch_type_(IRP_MJ_DEVICE_CONTROL) DRIVER_DISPATCH csr_ioctl;
+static NTSTATUS csr_get_registers_on_cpu(csr_multi_t* multi);
+static NTSTATUS csr_exec_requests_on_cpu(csr_requests_t* batch);
+static NTSTATUS csr_get_caches_on_cpu(csr_cache_info_t* info);
+static void csr_swap_pac_keys_on_cpu(csr_pac_keys_t* keys);
+static int csr_setget_register_on_cpu(int regid, csr_pair_t* value);
+static NTSTATUS csr_get_registers_all_cpus(csr_allcpus_t* all, ULONG in_length, ULONG out_length, ULONG_PTR* ret_size);
+static ULONG_PTR csr_ipi_allcpus(ULONG_PTR context);
+static NTSTATUS csr_swap_pmu_all_cpus(csr_pmu_state_t* state);
+static ULONG_PTR csr_ipi_pmu(ULONG_PTR context);
 
 #if defined(ALLOC_PRAGMA)
 #pragma alloc_text(INIT, DriverEntry)
 #pragma alloc_text(PAGE, csr_open_close)
 #pragma alloc_text(PAGE, csr_ioctl)
+#pragma alloc_text(PAGE, csr_get_registers_on_cpu)
+#pragma alloc_text(PAGE, csr_get_registers_all_cpus)
 #pragma alloc_text(PAGE, csr_unload)
 #endif
 
@@ -149,6 +160,95 @@ NTSTATUS csr_ioctl(PDEVICE_OBJECT device_object, PIRP irp)
         // We only accept buffered commands.
         status = STATUS_INVALID_DEVICE_REQUEST;
     }
+    else if (cmd == CSR_IOC_GET_MULTI) {
+        // Read several registers at once. The csr_multi_t and its registers are in/out.
+        csr_multi_t* multi = (csr_multi_t*)(buffer);
+        if (in_length < sizeof(csr_multi_t) ||
+            multi->count > CSR_MULTI_MAX ||
+            in_length < CSR_MULTI_SIZE(multi->count) ||
+            out_length < CSR_MULTI_SIZE(multi->count))
+        {
+            status = STATUS_INVALID_PARAMETER;
+        }
+        else if (multi->cpu == CSR_CPU_ANY) {
+            csr_get_registers(CSR_MULTI_REGS(multi), multi->count, cpu_features);
+            irp->IoStatus.Information = (ULONG_PTR)CSR_MULTI_SIZE(multi->count);
+        }
+        else if (NT_SUCCESS(status = csr_get_registers_on_cpu(multi))) {
+            irp->IoStatus.Information = (ULONG_PTR)CSR_MULTI_SIZE(multi->count);
+        }
+    }
+    else if (cmd == CSR_IOC_GET_ALLCPUS) {
+        // Read several registers at once on all CPU cores. The csr_allcpus_t and its registers are in/out.
+        status = csr_get_registers_all_cpus((csr_allcpus_t*)(buffer), in_length, out_length, &irp->IoStatus.Information);
+    }
+    else if (cmd == CSR_IOC_SWAP_PAC_KEYS) {
+        // Read and write all PAC keys at once. The csr_pac_keys_t is in/out.
+        if (in_length < sizeof(csr_pac_keys_t) || out_length < sizeof(csr_pac_keys_t)) {
+            status = STATUS_INVALID_PARAMETER;
+        }
+        else {
+            csr_swap_pac_keys_on_cpu((csr_pac_keys_t*)(buffer));
+            irp->IoStatus.Information = sizeof(csr_pac_keys_t);
+        }
+    }
+    else if (cmd == CSR_IOC_SWAP_PMU) {
+        // Swap the performance monitors state on all CPU cores. The csr_pmu_state_t is in/out.
+        if (in_length < sizeof(csr_pmu_state_t) || out_length < sizeof(csr_pmu_state_t)) {
+            status = STATUS_INVALID_PARAMETER;
+        }
+        else if (NT_SUCCESS(status = csr_swap_pmu_all_cpus((csr_pmu_state_t*)(buffer)))) {
+            irp->IoStatus.Information = sizeof(csr_pmu_state_t);
+        }
+    }
+    else if (cmd == CSR_IOC_GET_CACHES) {
+        // Read the geometry of all caches on one CPU core. The csr_cache_info_t is in/out.
+        if (in_length < sizeof(csr_cache_info_t) || out_length < sizeof(csr_cache_info_t)) {
+            status = STATUS_INVALID_PARAMETER;
+        }
+        else if (NT_SUCCESS(status = csr_get_caches_on_cpu((csr_cache_info_t*)(buffer)))) {
+            irp->IoStatus.Information = sizeof(csr_cache_info_t);
+        }
+    }
+    else if (cmd == CSR_IOC_GET_RANDOM) {
+        // Fill a buffer of random numbers. The csr_random_t is in/out.
+        if (in_length < sizeof(csr_random_t) || out_length < sizeof(csr_random_t)) {
+            status = STATUS_INVALID_PARAMETER;
+        }
+        else {
+            csr_get_random((csr_random_t*)(buffer), cpu_features);
+            irp->IoStatus.Information = sizeof(csr_random_t);
+        }
+    }
+    else if (cmd == CSR_IOC_INSTR_BATCH) {
+        // Execute a batch of instructions. The csr_instr_batch_t and its instructions are in/out.
+        csr_instr_batch_t* batch = (csr_instr_batch_t*)(buffer);
+        if (in_length < sizeof(csr_instr_batch_t) ||
+            batch->count > CSR_INSTR_BATCH_MAX ||
+            in_length < CSR_INSTR_BATCH_SIZE(batch->count) ||
+            out_length < CSR_INSTR_BATCH_SIZE(batch->count))
+        {
+            status = STATUS_INVALID_PARAMETER;
+        }
+        else {
+            csr_exec_instr_batch(CSR_INSTR_BATCH_ITEMS(batch), batch->count);
+            irp->IoStatus.Information = (ULONG_PTR)CSR_INSTR_BATCH_SIZE(batch->count);
+        }
+    }
+    else if (cmd == CSR_IOC_REQUESTS) {
+        // Execute a batch of register and instruction requests. The csr_requests_t and its requests are in/out.
+        csr_requests_t* batch = (csr_requests_t*)(buffer);
+        if (in_length < sizeof(csr_requests_t) ||
+            batch->count > CSR_REQUESTS_MAX ||
+            in_length < CSR_REQUESTS_SIZE(batch->count) ||
+            out_length < CSR_REQUESTS_SIZE(batch->count))
+        {
+            status = STATUS_INVALID_PARAMETER;
+        }
+        else if (NT_SUCCESS(status = csr_exec_requests_on_cpu(batch))) {
+            irp->IoStatus.Information = (ULONG_PTR)CSR_REQUESTS_SIZE(batch->count);
+        }
+    }
     else if (instr != CSR_INSTR_INVALID) {
         // Execute a specific instruction.
         if (in_length < sizeof(csr_instr_t) || out_length < sizeof(csr_instr_t) || csr_exec_instr(instr, (csr_instr_t*)(buffer))) {
@@ -168,6 +268,16 @@ NTSTATUS csr_ioctl(PDEVICE_OBJECT device_object, PIRP irp)
                 status = STATUS_INVALID_PARAMETER;
             }
         }
+        else if (csr_ioc_is_setget_reg(cmd)) {
+            // Set register value and read it back, on the same CPU core.
+            if (in_length < size || out_length < size || csr_setget_register_on_cpu(regid, (csr_pair_t*)(buffer)) != 0) {
+                status = STATUS_INVALID_PARAMETER;
+            }
+            else {
+                // Update returned data size.
+                irp->IoStatus.Information = size;
+            }
+        }
         else {
             // Get register value.
             if (out_length < size || csr_get_register(regid, (csr_pair_t*)(buffer), cpu_features)) {
@@ -188,3 +298,239 @@ NTSTATUS csr_ioctl(PDEVICE_OBJECT device_object, PIRP irp)
     IoCompleteRequest(irp, IO_NO_INCREMENT);
     return status;
 }
+
+
+//----------------------------------------------------------------------------
+// Read several registers on a given CPU core.
+//----------------------------------------------------------------------------
+
+static NTSTATUS csr_get_registers_on_cpu(csr_multi_t* multi)
+{
+    PAGED_CODE();
+
+    PROCESSOR_NUMBER proc;
+    GROUP_AFFINITY affinity;
+    GROUP_AFFINITY previous;
+
+    if (multi->cpu >= KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS) ||
+        !NT_SUCCESS(KeGetProcessorNumberFromIndex((ULONG)multi->cpu, &proc)))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    // Temporarily move the current thread on the target CPU core.
+    RtlZeroMemory(&affinity, sizeof(affinity));
+    affinity.Group = proc.Group;
+    affinity.Mask = (KAFFINITY)1 << proc.Number;
+    KeSetSystemGroupAffinityThread(&affinity, &previous);
+    csr_get_registers(CSR_MULTI_REGS(multi), multi->count, cpu_features);
+    KeRevertToUserGroupAffinityThread(&previous);
+    return STATUS_SUCCESS;
+}
+
+
+//----------------------------------------------------------------------------
+// Execute a batch of requests on a given CPU core, or on any core.
+//----------------------------------------------------------------------------
+
+// Cannot be paged since it runs at dispatch level.
+static NTSTATUS csr_exec_requests_on_cpu(csr_requests_t* batch)
+{
+    PROCESSOR_NUMBER proc;
+    GROUP_AFFINITY affinity;
+    GROUP_AFFINITY previous;
+    PROCESSOR_NUMBER current;
+    KIRQL irql;
+
+    if (batch->cpu != CSR_CPU_ANY &&
+        (batch->cpu >= KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS) ||
+         !NT_SUCCESS(KeGetProcessorNumberFromIndex((ULONG)batch->cpu, &proc))))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    // Always move the current thread on one CPU core, all requests are executed on the same core.
+    if (batch->cpu == CSR_CPU_ANY) {
+        KeGetCurrentProcessorNumberEx(&current);
+        proc = current;
+    }
+    RtlZeroMemory(&affinity, sizeof(affinity));
+    affinity.Group = proc.Group;
+    affinity.Mask = (KAFFINITY)1 << proc.Number;
+    KeSetSystemGroupAffinityThread(&affinity, &previous);
+
+    // No preemption between the requests. The system buffer of the IRP is nonpaged.
+    KeRaiseIrql(DISPATCH_LEVEL, &irql);
+    csr_exec_requests(CSR_REQUESTS_ITEMS(batch), batch->count, cpu_features);
+    KeLowerIrql(irql);
+
+    KeRevertToUserGroupAffinityThread(&previous);
+    return STATUS_SUCCESS;
+}
+
+
+//----------------------------------------------------------------------------
+// Read the geometry of all caches on a given CPU core, or on any core.
+//----------------------------------------------------------------------------
+
+// Cannot be paged since it runs at high level.
+static NTSTATUS csr_get_caches_on_cpu(csr_cache_info_t* info)
+{
+    PROCESSOR_NUMBER proc;
+    GROUP_AFFINITY affinity;
+    GROUP_AFFINITY previous;
+    KIRQL irql;
+
+    if (info->cpu != CSR_CPU_ANY &&
+        (info->cpu >= KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS) ||
+         !NT_SUCCESS(KeGetProcessorNumberFromIndex((ULONG)info->cpu, &proc))))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    // Temporarily move the current thread on the target CPU core.
+    if (info->cpu != CSR_CPU_ANY) {
+        RtlZeroMemory(&affinity, sizeof(affinity));
+        affinity.Group = proc.Group;
+        affinity.Mask = (KAFFINITY)1 << proc.Number;
+        KeSetSystemGroupAffinityThread(&affinity, &previous);
+    }
+
+    // No interrupt, no preemption, between the selection in CSSELR_EL1 and the reads.
+    KeRaiseIrql(HIGH_LEVEL, &irql);
+    csr_get_cache_info(info, cpu_features);
+    KeLowerIrql(irql);
+
+    if (info->cpu != CSR_CPU_ANY) {
+        KeRevertToUserGroupAffinityThread(&previous);
+    }
+    return STATUS_SUCCESS;
+}
+
+
+//----------------------------------------------------------------------------
+// Read and write all PAC keys at once on the current CPU core.
+//----------------------------------------------------------------------------
+
+// Cannot be paged since it runs at high level.
+static void csr_swap_pac_keys_on_cpu(csr_pac_keys_t* keys)
+{
+    KIRQL irql;
+
+    // No interrupt, no preemption, while the keys are updated.
+    KeRaiseIrql(HIGH_LEVEL, &irql);
+    csr_swap_pac_keys(keys, cpu_features);
+    KeLowerIrql(irql);
+}
+
+
+//----------------------------------------------------------------------------
+// Set a register value and read it back on the current CPU core.
+//----------------------------------------------------------------------------
+
+// Cannot be paged since it runs at dispatch level.
+static int csr_setget_register_on_cpu(int regid, csr_pair_t* value)
+{
+    KIRQL irql;
+    int status;
+
+    // No preemption, no migration to another CPU core, between the write and the read.
+    KeRaiseIrql(DISPATCH_LEVEL, &irql);
+    status = csr_setget_register(regid, value, cpu_features);
+    KeLowerIrql(irql);
+    return status;
+}
+
+
+//----------------------------------------------------------------------------
+// Read several registers on all CPU cores at once.
+//----------------------------------------------------------------------------
+
+// Executed on all CPU cores at IPI level (cannot be paged), read registers in the block of the current CPU.
+static ULONG_PTR csr_ipi_allcpus(ULONG_PTR context)
+{
+    csr_allcpus_t* all = (csr_allcpus_t*)context;
+    const ULONG cpu = KeGetCurrentProcessorNumberEx(NULL);
+    if (cpu < all->cpus) {
+        csr_get_registers(CSR_ALLCPUS_REGS(all, cpu), all->count, cpu_features);
+    }
+    return 0;
+}
+
+static NTSTATUS csr_get_registers_all_cpus(csr_allcpus_t* all, ULONG in_length, ULONG out_length, ULONG_PTR* ret_size)
+{
+    PAGED_CODE();
+
+    const ULONG cpu_count = KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+    if (in_length < sizeof(csr_allcpus_t) ||
+        all->count > CSR_MULTI_MAX ||
+        all->cpus > CSR_ALLCPUS_MAX ||
+        all->count * all->cpus > CSR_ALLCPUS_MAX ||
+        in_length < CSR_ALLCPUS_SIZE(all->count, 1) ||
+        out_length < CSR_ALLCPUS_SIZE(all->count, all->cpus))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    // Replicate the list of registers in all CPU blocks, with status "CPU offline".
+    if (all->cpus > cpu_count) {
+        all->cpus = cpu_count;
+    }
+    for (ULONG cpu = 0; cpu < all->cpus; cpu++) {
+        csr_multi_reg_t* regs = CSR_ALLCPUS_REGS(all, cpu);
+        for (ULONG i = 0; i < all->count; i++) {
+            regs[i].regid = CSR_ALLCPUS_REGS(all, 0)[i].regid;
+            regs[i].status = 3;
+            regs[i].value.low = regs[i].value.high = 0;
+        }
+    }
+
+    // Read all registers on all CPU cores at once.
+    KeIpiGenericCall(csr_ipi_allcpus, (ULONG_PTR)all);
+
+    // Return the actual number of CPU cores.
+    *ret_size = (ULONG_PTR)CSR_ALLCPUS_SIZE(all->count, all->cpus);
+    all->cpus = cpu_count;
+    return STATUS_SUCCESS;
+}
+
+
+//----------------------------------------------------------------------------
+// Swap the performance monitors state on all CPU cores at once.
+//----------------------------------------------------------------------------
+
+typedef struct {
+    csr_pmu_state_t state;     // new state, same on all CPU cores
+    csr_pmu_state_t previous;  // previous state, on the CPU core of the caller
+    ULONG           cpu;       // CPU core of the caller
+} csr_pmu_call_t;
+
+// Executed on all CPU cores at IPI level (cannot be paged).
+static ULONG_PTR csr_ipi_pmu(ULONG_PTR context)
+{
+    csr_pmu_call_t* call = (csr_pmu_call_t*)context;
+    csr_pmu_state_t state = call->state;
+    csr_swap_pmu(&state, cpu_features);
+    if (KeGetCurrentProcessorNumberEx(NULL) == call->cpu) {
+        call->previous = state;
+    }
+    return 0;
+}
+
+// Cannot be paged since it runs at dispatch level.
+static NTSTATUS csr_swap_pmu_all_cpus(csr_pmu_state_t* state)
+{
+    KIRQL irql;
+    csr_pmu_call_t call;
+    call.state = *state;
+
+    // Keep the caller on the same CPU core to get its previous state.
+    KeRaiseIrql(DISPATCH_LEVEL, &irql);
+    call.cpu = KeGetCurrentProcessorNumberEx(NULL);
+    KeIpiGenericCall(csr_ipi_pmu, (ULONG_PTR)&call);
+    KeLowerIrql(irql);
+
+    *state = call.previous;
+    return STATUS_SUCCESS;
+}
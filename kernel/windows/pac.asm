@@ -58,4 +58,14 @@
     ret
     NESTED_END
 
+    NESTED_ENTRY csr_xpaci_helper
+    xpaci x0
+    ret
+    NESTED_END
+
+    NESTED_ENTRY csr_xpacd_helper
+    xpacd x0
+    ret
+    NESTED_END
+
     END
@@ -0,0 +1,237 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Microkernels for the cost of branch protection. This program is built
+// four times, with the same source code: without branch protection and
+// with -mbranch-protection=bti, pac-ret, pac-ret+bti. It is standalone,
+// without library, so that the complete executable is built with the
+// same options. See bpreport.cpp for the comparison.
+//
+// Output: one line per kernel, "name,ns-per-call", lines starting with
+// '#' describe the variant.
+//
+//----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// Prevent inlining, all calls must be real calls.
+#define NOINLINE __attribute__((noinline))
+
+// Sink for the results, prevent the compiler from removing the loops.
+volatile unsigned long sink = 0;
+
+
+//----------------------------------------------------------------------------
+// Call-heavy kernel: a chain of non-leaf functions. With pac-ret, the return
+// address of a non-leaf function is signed in the prologue and authenticated
+// in the epilogue. The leaf function is not signed.
+//----------------------------------------------------------------------------
+
+NOINLINE unsigned long leaf(unsigned long x) { return x * 3 + 1; }
+NOINLINE unsigned long call1(unsigned long x) { return leaf(x) + 1; }
+NOINLINE unsigned long call2(unsigned long x) { return call1(x) ^ 2; }
+NOINLINE unsigned long call3(unsigned long x) { return call2(x) + 3; }
+NOINLINE unsigned long call4(unsigned long x) { return call3(x) ^ 4; }
+
+// Number of calls in one iteration.
+constexpr size_t CALLS_PER_ITERATION = 5;
+
+NOINLINE unsigned long run_calls(size_t count)
+{
+    unsigned long x = 0;
+    for (size_t i = 0; i < count; i++) {
+        x = call4(x);
+    }
+    return x;
+}
+
+
+//----------------------------------------------------------------------------
+// Indirect-call kernel: calls through a table of function pointers. The
+// targets are BTI landing pads ("bti c") and the callees are non-leaf.
+//----------------------------------------------------------------------------
+
+typedef unsigned long (*func_t)(unsigned long);
+NOINLINE unsigned long target0(unsigned long x) { return leaf(x) + 10; }
+NOINLINE unsigned long target1(unsigned long x) { return leaf(x) ^ 11; }
+NOINLINE unsigned long target2(unsigned long x) { return leaf(x) + 12; }
+NOINLINE unsigned long target3(unsigned long x) { return leaf(x) ^ 13; }
+
+// Volatile: the compiler cannot resolve the targets at compile time.
+func_t volatile functions[4] = {target0, target1, target2, target3};
+
+NOINLINE unsigned long run_indirect(size_t count)
+{
+    unsigned long x = 0;
+    for (size_t i = 0; i < count; i++) {
+        x = functions[i & 3](x);
+    }
+    return x;
+}
+
+
+//----------------------------------------------------------------------------
+// Jump-table kernel: a small bytecode interpreter with a dense switch. The
+// switch is compiled as an indirect branch (BR) to a "bti j" landing pad.
+//----------------------------------------------------------------------------
+
+// Bytecode program, volatile to keep the switch dispatch.
+volatile unsigned char program[16] = {0, 1, 2, 3, 4, 5, 6, 7, 3, 1, 4, 1, 5, 2, 6, 0};
+
+NOINLINE unsigned long run_switch(size_t count)
+{
+    unsigned long x = 1;
+    for (size_t i = 0; i < count; i++) {
+        switch (program[i & 15]) {
+            case 0: x += 7; break;
+            case 1: x ^= 0x55; break;
+            case 2: x *= 3; break;
+            case 3: x -= 5; break;
+            case 4: x = (x << 1) | (x >> 63); break;
+            case 5: x += i; break;
+            case 6: x ^= i << 3; break;
+            case 7: x = ~x; break;
+            default: break;
+        }
+    }
+    return x;
+}
+
+
+//----------------------------------------------------------------------------
+// Virtual-dispatch kernel: virtual calls on objects of several classes.
+//----------------------------------------------------------------------------
+
+class Shape
+{
+public:
+    virtual ~Shape() = default;
+    virtual unsigned long area(unsigned long x) const = 0;
+};
+
+class Square : public Shape
+{
+public:
+    NOINLINE unsigned long area(unsigned long x) const override { return leaf(x) * x; }
+};
+
+class Rectangle : public Shape
+{
+public:
+    NOINLINE unsigned long area(unsigned long x) const override { return leaf(x) * (x + 1); }
+};
+
+class Triangle : public Shape
+{
+public:
+    NOINLINE unsigned long area(unsigned long x) const override { return leaf(x) * x / 2; }
+};
+
+class Circle : public Shape
+{
+public:
+    NOINLINE unsigned long area(unsigned long x) const override { return leaf(x) * x * 3; }
+};
+
+NOINLINE unsigned long run_virtual(const Shape* const* shapes, size_t count)
+{
+    unsigned long x = 0;
+    for (size_t i = 0; i < count; i++) {
+        x += shapes[i & 7]->area(x & 0xFFFF);
+    }
+    return x;
+}
+
+
+//----------------------------------------------------------------------------
+// Check if the code of this program is in guarded pages (BTI enforced).
+//----------------------------------------------------------------------------
+
+static const char* Guarded()
+{
+#if defined(__linux__)
+    // The VmFlags of the mapping which contains the code include "bt".
+    const unsigned long addr = (unsigned long)(&run_calls);
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool in_code = false;
+    while (std::getline(smaps, line)) {
+        unsigned long start = 0, end = 0;
+        if (std::sscanf(line.c_str(), "%lx-%lx ", &start, &end) == 2) {
+            in_code = start <= addr && addr < end;
+        }
+        else if (in_code && line.compare(0, 8, "VmFlags:") == 0) {
+            std::istringstream flags(line.substr(8));
+            std::string flag;
+            while (flags >> flag) {
+                if (flag == "bt") {
+                    return "yes";
+                }
+            }
+            return "no";
+        }
+    }
+#endif
+    return "unknown";
+}
+
+
+//----------------------------------------------------------------------------
+// Program entry point.
+//----------------------------------------------------------------------------
+
+// Time a kernel: best of several runs, in nanoseconds per call.
+template <typename FUNC>
+static double Time(FUNC func, size_t count, size_t calls_per_iteration, size_t runs)
+{
+    double best = 0;
+    for (size_t r = 0; r < runs; r++) {
+        const auto start = std::chrono::steady_clock::now();
+        sink = sink + func(count);
+        const auto end = std::chrono::steady_clock::now();
+        const double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / double(count * calls_per_iteration);
+        best = r == 0 ? ns : std::min(best, ns);
+    }
+    return best;
+}
+
+int main(int argc, char* argv[])
+{
+    // Optional parameters: number of iterations and runs per kernel.
+    const size_t count = argc > 1 ? std::max(1ul, std::strtoul(argv[1], nullptr, 0)) : 10000000;
+    const size_t runs = argc > 2 ? std::max(1ul, std::strtoul(argv[2], nullptr, 0)) : 5;
+
+#if defined(__ARM_FEATURE_BTI_DEFAULT)
+    const int bti = __ARM_FEATURE_BTI_DEFAULT;
+#else
+    const int bti = 0;
+#endif
+#if defined(__ARM_FEATURE_PAC_DEFAULT)
+    const int pac = __ARM_FEATURE_PAC_DEFAULT;
+#else
+    const int pac = 0;
+#endif
+    std::printf("# bti=%d pac=%d guarded=%s\n", bti, pac, Guarded());
+
+    const Square sq;
+    const Rectangle re;
+    const Triangle tr;
+    const Circle ci;
+    const Shape* const shapes[8] = {&sq, &re, &tr, &ci, &ci, &sq, &tr, &re};
+
+    std::printf("calls,%.3f\n", Time(run_calls, count, CALLS_PER_ITERATION, runs));
+    std::printf("indirect,%.3f\n", Time(run_indirect, count, 1, runs));
+    std::printf("switch,%.3f\n", Time(run_switch, count, 1, runs));
+    std::printf("virtual,%.3f\n", Time([&shapes](size_t n) { return run_virtual(shapes, n); }, count, 1, runs));
+    return EXIT_SUCCESS;
+}
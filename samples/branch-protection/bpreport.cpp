@@ -0,0 +1,138 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Run the four variants of bpbench and report the relative slowdown of
+// each branch protection, tagged with the PAC and BTI features of the CPU.
+//
+// The variants are run alternately several times and the best time of
+// each kernel is kept, to reduce the effect of the frequency changes.
+//
+//----------------------------------------------------------------------------
+
+#include "armfeatures.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+// The four variants, the first one is the reference.
+static const char* const Variants[] = {"none", "bti", "pac-ret", "pac-ret-bti"};
+static constexpr size_t VariantCount = sizeof(Variants) / sizeof(Variants[0]);
+
+// Results of one variant: ns per call by kernel name, and description lines.
+struct Result {
+    std::map<std::string, double> ns;
+    std::string description;
+};
+
+// Run a variant once, merge the best times in the result.
+static bool RunVariant(const std::string& dir, const char* variant, const std::string& args, Result& result)
+{
+    const std::string command(dir + "bpbench-" + variant + " " + args);
+    FILE* pipe = ::popen(command.c_str(), "r");
+    if (pipe == nullptr) {
+        return false;
+    }
+    char line[256];
+    while (std::fgets(line, sizeof(line), pipe) != nullptr) {
+        std::string str(line);
+        while (!str.empty() && (str.back() == '\n' || str.back() == '\r')) {
+            str.pop_back();
+        }
+        const size_t comma = str.find(',');
+        if (!str.empty() && str.front() == '#') {
+            result.description = str.substr(1);
+        }
+        else if (comma != std::string::npos) {
+            const std::string name(str.substr(0, comma));
+            const double ns = std::strtod(str.c_str() + comma + 1, nullptr);
+            auto it = result.ns.find(name);
+            if (it == result.ns.end() || ns < it->second) {
+                result.ns[name] = ns;
+            }
+        }
+    }
+    return ::pclose(pipe) == 0;
+}
+
+// Program entry point
+int main(int argc, char* argv[])
+{
+    // Optional parameters: number of iterations per kernel and number of rounds.
+    const std::string count(argc > 1 ? argv[1] : "10000000");
+    const size_t rounds = argc > 2 ? std::max<size_t>(1, std::strtoul(argv[2], nullptr, 0)) : 3;
+
+    // The variants are in the same directory as this program.
+    std::string dir(argc > 0 ? argv[0] : "");
+    dir.erase(dir.find_last_of('/') == std::string::npos ? 0 : dir.find_last_of('/') + 1);
+    if (dir.empty()) {
+        dir = "./";
+    }
+
+    Result results[VariantCount];
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t v = 0; v < VariantCount; v++) {
+            if (!RunVariant(dir, Variants[v], count + " 1", results[v])) {
+                std::cerr << argv[0] << ": error running bpbench-" << Variants[v] << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    // Tag the results with the CPU features, the cost of PAC depends on the algorithm.
+    ArmFeatures feat(ArmFeatures::instance());
+    if (!feat.isLoaded()) {
+        feat.loadDirect();
+    }
+    std::cout << "PAC: " << YesNo(feat.FEAT_PAuth()) << ", algorithm: " << feat.pacAlgo()
+              << ", FPAC: " << YesNo(feat.FEAT_FPAC())
+              << ", BTI: " << YesNo(feat.FEAT_BTI()) << std::endl;
+    for (size_t v = 0; v < VariantCount; v++) {
+        std::cout << Format("%-12s", Variants[v]) << results[v].description << std::endl;
+    }
+    std::cout << std::endl;
+
+    // Table of ns per call and slowdown relatively to the reference.
+    std::string line(Format("%-10s %10s", "kernel", "none ns"));
+    for (size_t v = 1; v < VariantCount; v++) {
+        AppendFormat(line, " %12s", Variants[v]);
+    }
+    std::cout << line << std::endl;
+    std::vector<double> product(VariantCount, 1.0);
+    size_t kernels = 0;
+    for (const auto& it : results[0].ns) {
+        const double ref = it.second;
+        line = Format("%-10s %10.3f", it.first.c_str(), ref);
+        for (size_t v = 1; v < VariantCount; v++) {
+            const auto var = results[v].ns.find(it.first);
+            if (ref > 0 && var != results[v].ns.end()) {
+                AppendFormat(line, " %+11.1f%%", (var->second / ref - 1.0) * 100.0);
+                product[v] *= var->second / ref;
+            }
+            else {
+                AppendFormat(line, " %12s", "-");
+            }
+        }
+        std::cout << line << std::endl;
+        kernels++;
+    }
+
+    // Geometric mean of the slowdowns.
+    if (kernels > 0) {
+        line = Format("%-10s %10s", "geomean", "");
+        for (size_t v = 1; v < VariantCount; v++) {
+            AppendFormat(line, " %+11.1f%%", (std::pow(product[v], 1.0 / double(kernels)) - 1.0) * 100.0);
+        }
+        std::cout << line << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
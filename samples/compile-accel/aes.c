@@ -1,24 +1,112 @@
 #include "aes.h"
 #include "aes_accel.h"
-#include "armfeature.h"
-#include <stdio.h>
+#include "aes_sve.h"
+#include "armdispatch.h"
+#include <string.h>
 
-static volatile int aes_accel_checked = 0;
-static volatile int aes_accel_supported = 0;
+static const uint8_t aes_sbox[256] = {
+    0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+    0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+    0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+    0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+    0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+    0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+    0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+    0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+    0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+    0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+    0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+    0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+    0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+    0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+    0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+    0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16,
+};
 
-void aes()
+void aes_init(aes_key_t* key, const uint8_t k[AES_KEY_SIZE])
 {
-    // Check done once only. No need for multi-thread synchronization.
-    if (!aes_accel_checked) {
-        aes_accel_supported = aes_accel_compiled && armfeature(AT_HWCAP, HWCAP_AES, "hw.optional.arm.FEAT_AES");
-        aes_accel_checked = 1;
+    uint8_t* rk = key->rk;
+    uint8_t rcon = 0x01;
+    memcpy(rk, k, AES_KEY_SIZE);
+    for (size_t i = AES_KEY_SIZE; i < sizeof(key->rk); i += 4) {
+        uint8_t t[4] = {rk[i-4], rk[i-3], rk[i-2], rk[i-1]};
+        if (i % AES_KEY_SIZE == 0) {
+            // RotWord, SubWord, Rcon.
+            const uint8_t t0 = t[0];
+            t[0] = aes_sbox[t[1]] ^ rcon;
+            t[1] = aes_sbox[t[2]];
+            t[2] = aes_sbox[t[3]];
+            t[3] = aes_sbox[t0];
+            rcon = (uint8_t)((rcon << 1) ^ ((rcon & 0x80) ? 0x1B : 0));
+        }
+        for (size_t j = 0; j < 4; j++) {
+            rk[i+j] = rk[i+j-AES_KEY_SIZE] ^ t[j];
+        }
     }
+}
+
+static inline uint8_t aes_xtime(uint8_t x)
+{
+    return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1B : 0));
+}
 
-    // Each time, select accelerated implementation when supported.
-    if (aes_accel_supported) {
-        aes_accel();
+static void aes_encrypt_block(const aes_key_t* key, const uint8_t in[AES_BLOCK_SIZE], uint8_t out[AES_BLOCK_SIZE])
+{
+    uint8_t s[AES_BLOCK_SIZE], t[AES_BLOCK_SIZE];
+    for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+        s[i] = in[i] ^ key->rk[i];
     }
-    else {
-        printf("aes():    portable implementation\n");
+    for (int r = 1; r <= AES_ROUNDS; r++) {
+        // SubBytes and ShiftRows: the byte in row i, column c comes from column c+i.
+        for (int c = 0; c < 4; c++) {
+            for (int i = 0; i < 4; i++) {
+                t[4*c + i] = aes_sbox[s[4*((c + i) % 4) + i]];
+            }
+        }
+        // MixColumns, except in the last round.
+        if (r < AES_ROUNDS) {
+            for (int c = 0; c < 4; c++) {
+                uint8_t* a = t + 4*c;
+                const uint8_t a0 = a[0], all = a[0] ^ a[1] ^ a[2] ^ a[3];
+                a[0] ^= all ^ aes_xtime(a[0] ^ a[1]);
+                a[1] ^= all ^ aes_xtime(a[1] ^ a[2]);
+                a[2] ^= all ^ aes_xtime(a[2] ^ a[3]);
+                a[3] ^= all ^ aes_xtime(a[3] ^ a0);
+            }
+        }
+        // AddRoundKey.
+        for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+            s[i] = t[i] ^ key->rk[AES_BLOCK_SIZE * r + i];
+        }
     }
+    memcpy(out, s, AES_BLOCK_SIZE);
 }
+
+static void aes_portable(const aes_key_t* key, uint8_t counter[AES_BLOCK_SIZE], const void* in, void* out, size_t size)
+{
+    const uint8_t* src = in;
+    uint8_t* dst = out;
+    uint8_t ks[AES_BLOCK_SIZE];
+    while (size > 0) {
+        const size_t n = size < AES_BLOCK_SIZE ? size : AES_BLOCK_SIZE;
+        aes_encrypt_block(key, counter, ks);
+        aes_increment(counter);
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = src[i] ^ ks[i];
+        }
+        src += n;
+        dst += n;
+        size -= n;
+    }
+}
+
+// The implementation is selected once at load time, not on each call.
+static const armdispatch_variant_t aes_variants[] = {
+    ARMDISPATCH_VARIANT(aes_sve, &aes_sve_compiled, ARMDISPATCH_SVE2 | ARMDISPATCH_SVE_AES),
+    ARMDISPATCH_VARIANT(aes_accel, &aes_accel_compiled, ARMDISPATCH_AES),
+    ARMDISPATCH_VARIANT(aes_portable, NULL, 0),
+};
+
+ARMDISPATCH(void, aes,
+            (const aes_key_t* key, uint8_t counter[AES_BLOCK_SIZE], const void* in, void* out, size_t size),
+            (key, counter, in, out, size), aes_variants)
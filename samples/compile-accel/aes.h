@@ -1,7 +1,32 @@
 #if !defined(AES_H)
 #define AES_H 1
 
-// Hypothetical AES function.
-void aes();
+#include <stdint.h>
+#include <stddef.h>
+
+// AES-128 parameters.
+#define AES_BLOCK_SIZE 16
+#define AES_KEY_SIZE   16
+#define AES_ROUNDS     10
+
+// AES-128 expanded key.
+typedef struct {
+    uint8_t rk[(AES_ROUNDS + 1) * AES_BLOCK_SIZE];
+} aes_key_t;
+
+// Expand an AES-128 key.
+void aes_init(aes_key_t* key, const uint8_t k[AES_KEY_SIZE]);
+
+// AES-128 encryption or decryption in CTR mode. The 128-bit counter block is
+// big-endian and updated, a partial last block uses one entire counter value.
+// The input and output buffers may be identical.
+void aes(const aes_key_t* key, uint8_t counter[AES_BLOCK_SIZE], const void* in, void* out, size_t size);
+
+// Increment a big-endian counter block.
+static inline void aes_increment(uint8_t counter[AES_BLOCK_SIZE])
+{
+    for (int i = AES_BLOCK_SIZE - 1; i >= 0 && ++counter[i] == 0; i--) {
+    }
+}
 
 #endif // AES_H
@@ -1,25 +1,55 @@
 #include "aes_accel.h"
 #include <assert.h>
-#include <stdio.h>
 
 #if defined(__ARM_FEATURE_CRYPTO)
 
+    #include <arm_neon.h>
+
     const int aes_accel_compiled = 1;
-    void aes_accel()
+    void aes_accel(const aes_key_t* key, uint8_t counter[AES_BLOCK_SIZE], const void* in, void* out, size_t size)
     {
-        printf("aes():    accelerated implementation\n");
-        // Dummy AES instruction, just to demonstrate it is accepted by the compiler.
-        asm("aese v8.16B, v8.16B" : : : "v8");
+        const uint8_t* src = in;
+        uint8_t* dst = out;
+
+        // Keep all round keys in vector registers.
+        uint8x16_t rk[AES_ROUNDS + 1];
+        for (int r = 0; r <= AES_ROUNDS; r++) {
+            rk[r] = vld1q_u8(key->rk + AES_BLOCK_SIZE * r);
+        }
+
+        while (size > 0) {
+            // AESE = AddRoundKey + ShiftRows + SubBytes, AESMC = MixColumns.
+            uint8x16_t b = vld1q_u8(counter);
+            for (int r = 0; r < AES_ROUNDS - 1; r++) {
+                b = vaesmcq_u8(vaeseq_u8(b, rk[r]));
+            }
+            b = veorq_u8(vaeseq_u8(b, rk[AES_ROUNDS - 1]), rk[AES_ROUNDS]);
+            aes_increment(counter);
+
+            if (size >= AES_BLOCK_SIZE) {
+                vst1q_u8(dst, veorq_u8(vld1q_u8(src), b));
+                src += AES_BLOCK_SIZE;
+                dst += AES_BLOCK_SIZE;
+                size -= AES_BLOCK_SIZE;
+            }
+            else {
+                uint8_t ks[AES_BLOCK_SIZE];
+                vst1q_u8(ks, b);
+                for (size_t i = 0; i < size; i++) {
+                    dst[i] = src[i] ^ ks[i];
+                }
+                size = 0;
+            }
+        }
     }
 
 #else
 
     const int aes_accel_compiled = 0;
-    void aes_accel()
+    void aes_accel(const aes_key_t* key, uint8_t counter[AES_BLOCK_SIZE], const void* in, void* out, size_t size)
     {
         // Should never be called if the CPU does not support the compilation target of this module;
-        printf("aes():    ACCELERATED IMPLEMENTATION SHOULD NOT GET CALLED !\n");
         assert(0);
     }
-    
+
 #endif
@@ -1,10 +1,12 @@
 #if !defined(AES_ACCEL_H)
 #define AES_ACCEL_H 1
 
+#include "aes.h"
+
 // Boolean: indicate if this module could be compiled with accelerated instructions.
 extern const int aes_accel_compiled;
 
 // Accelerated AES function.
-void aes_accel();
+void aes_accel(const aes_key_t* key, uint8_t counter[AES_BLOCK_SIZE], const void* in, void* out, size_t size);
 
 #endif // AES_ACCEL_H
@@ -0,0 +1,62 @@
+#include "aes_sve.h"
+#include <assert.h>
+#include <string.h>
+
+#if defined(__ARM_FEATURE_SVE2_AES)
+
+    #include <arm_sve.h>
+
+    const int aes_sve_compiled = 1;
+    void aes_sve(const aes_key_t* key, uint8_t counter[AES_BLOCK_SIZE], const void* in, void* out, size_t size)
+    {
+        const uint8_t* src = in;
+        uint8_t* dst = out;
+        const svbool_t all = svptrue_b8();
+        const size_t vl = svcntb();
+
+        // Vector-length agnostic: the round keys are replicated in all 128-bit segments,
+        // each segment processes one counter block. Two vectors are interleaved to hide
+        // the latency of the AESE/AESMC sequence.
+        svuint8_t rk[AES_ROUNDS + 1];
+        for (int r = 0; r <= AES_ROUNDS; r++) {
+            rk[r] = svld1rq_u8(all, key->rk + AES_BLOCK_SIZE * r);
+        }
+
+        // Counter blocks for two vectors, up to the maximum vector length of 2048 bits.
+        uint8_t ctr[2 * 256];
+
+        for (size_t done = 0; done < size; done += 2 * vl) {
+            const size_t bytes = size - done < 2 * vl ? size - done : 2 * vl;
+            const size_t used = (bytes + AES_BLOCK_SIZE - 1) & ~(size_t)(AES_BLOCK_SIZE - 1);
+            for (size_t i = 0; i < used; i += AES_BLOCK_SIZE) {
+                memcpy(ctr + i, counter, AES_BLOCK_SIZE);
+                aes_increment(counter);
+            }
+
+            svuint8_t b0 = svld1_u8(svwhilelt_b8_u64(0, used), ctr);
+            svuint8_t b1 = svld1_u8(svwhilelt_b8_u64(vl, used), ctr + vl);
+            for (int r = 0; r < AES_ROUNDS - 1; r++) {
+                b0 = svaesmc_u8(svaese_u8(b0, rk[r]));
+                b1 = svaesmc_u8(svaese_u8(b1, rk[r]));
+            }
+            b0 = sveor_u8_x(all, svaese_u8(b0, rk[AES_ROUNDS - 1]), rk[AES_ROUNDS]);
+            b1 = sveor_u8_x(all, svaese_u8(b1, rk[AES_ROUNDS - 1]), rk[AES_ROUNDS]);
+
+            // The predicates exclude the bytes after the end of the buffer, including in a partial last block.
+            const svbool_t p0 = svwhilelt_b8_u64(done, size);
+            const svbool_t p1 = svwhilelt_b8_u64(done + vl, size);
+            svst1_u8(p0, dst + done, sveor_u8_x(p0, svld1_u8(p0, src + done), b0));
+            svst1_u8(p1, dst + done + vl, sveor_u8_x(p1, svld1_u8(p1, src + done + vl), b1));
+        }
+    }
+
+#else
+
+    const int aes_sve_compiled = 0;
+    void aes_sve(const aes_key_t* key, uint8_t counter[AES_BLOCK_SIZE], const void* in, void* out, size_t size)
+    {
+        // Should never be called if the CPU does not support the compilation target of this module;
+        assert(0);
+    }
+
+#endif
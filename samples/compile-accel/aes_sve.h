@@ -0,0 +1,12 @@
+#if !defined(AES_SVE_H)
+#define AES_SVE_H 1
+
+#include "aes.h"
+
+// Boolean: indicate if this module could be compiled with accelerated instructions.
+extern const int aes_sve_compiled;
+
+// AES-128 in CTR mode using SVE2 AES instructions, one block per 128-bit segment of the vectors.
+void aes_sve(const aes_key_t* key, uint8_t counter[AES_BLOCK_SIZE], const void* in, void* out, size_t size);
+
+#endif // AES_SVE_H
@@ -0,0 +1,75 @@
+#include "armdispatch.h"
+#include "armfeature.h"
+#include <string.h>
+
+// List of registered dispatched functions. The registration is done by
+// static constructors, before main(). No need for multi-thread synchronization.
+static armdispatch_symbol_t* armdispatch_list = NULL;
+
+void armdispatch_register(armdispatch_symbol_t* sym)
+{
+    // Append at end of list to report in the order of registration.
+    armdispatch_symbol_t** last = &armdispatch_list;
+    while (*last != NULL) {
+        last = &(*last)->next;
+    }
+    sym->next = NULL;
+    *last = sym;
+}
+
+const armdispatch_symbol_t* armdispatch_first(void)
+{
+    return armdispatch_list;
+}
+
+const armdispatch_symbol_t* armdispatch_find(const char* name)
+{
+    const armdispatch_symbol_t* sym = armdispatch_list;
+    while (sym != NULL && strcmp(sym->name, name) != 0) {
+        sym = sym->next;
+    }
+    return sym;
+}
+
+const char* armdispatch_selected(const char* name)
+{
+    const armdispatch_symbol_t* sym = armdispatch_find(name);
+    return sym == NULL || sym->selected == NULL ? NULL : sym->selected->name;
+}
+
+void armdispatch_report(FILE* out)
+{
+    for (const armdispatch_symbol_t* sym = armdispatch_list; sym != NULL; sym = sym->next) {
+        fprintf(out, "%-16s %s\n", sym->name, sym->selected == NULL ? "(unresolved)" : sym->selected->name);
+    }
+}
+
+int armdispatch_usable(const armdispatch_variant_t* var)
+{
+    return (var->compiled == NULL || *var->compiled) && (var->features & ~armdispatch_caps()) == 0;
+}
+
+uint32_t armdispatch_caps(void)
+{
+#if defined(__linux__) && (defined(__aarch64__) || defined(__arm64__))
+    // Same translation as in the ifunc resolvers.
+    return armdispatch_caps_hwcap(getauxval(AT_HWCAP), getauxval(AT_HWCAP2));
+#else
+    // Check done once only. Concurrent checks return the same value.
+    static volatile int checked = 0;
+    static volatile uint32_t caps = 0;
+
+    if (!checked) {
+        caps = (armfeature(AT_HWCAP, HWCAP_CRC32,  "hw.optional.armv8_crc32")      ? ARMDISPATCH_CRC32  : 0) |
+               (armfeature(AT_HWCAP, HWCAP_AES,    "hw.optional.arm.FEAT_AES")     ? ARMDISPATCH_AES    : 0) |
+               (armfeature(AT_HWCAP, HWCAP_PMULL,  "hw.optional.arm.FEAT_PMULL")   ? ARMDISPATCH_PMULL  : 0) |
+               (armfeature(AT_HWCAP, HWCAP_SHA1,   "hw.optional.arm.FEAT_SHA1")    ? ARMDISPATCH_SHA1   : 0) |
+               (armfeature(AT_HWCAP, HWCAP_SHA2,   "hw.optional.arm.FEAT_SHA256")  ? ARMDISPATCH_SHA256 : 0) |
+               (armfeature(AT_HWCAP, HWCAP_SHA512, "hw.optional.arm.FEAT_SHA512")  ? ARMDISPATCH_SHA512 : 0) |
+               (armfeature(AT_HWCAP, HWCAP_SHA3,   "hw.optional.arm.FEAT_SHA3")    ? ARMDISPATCH_SHA3   : 0);
+        // There is no SVE on Apple CPUs, the SVE bits are never set.
+        checked = 1;
+    }
+    return caps;
+#endif
+}
@@ -0,0 +1,194 @@
+#if !defined(ARMDISPATCH_H)
+#define ARMDISPATCH_H 1
+
+// Runtime dispatch of functions with several implementations, depending on
+// the Arm features of the CPU. The selection is done once at load time:
+//
+// - On Linux Arm64, the function is a GNU indirect function (ifunc). The
+//   dynamic loader calls the resolver once with the AT_HWCAP bits and binds
+//   all calls directly to the selected implementation.
+// - On other systems (macOS, non-Arm), the function is a thin wrapper which
+//   calls through a function pointer. The pointer is resolved by a static
+//   constructor, using sysctlbyname(3) on macOS. A call from another static
+//   constructor which runs first resolves the pointer on the fly.
+//
+// Usage, in the generic module of an algorithm:
+//
+//   static const armdispatch_variant_t crc_variants[] = {
+//       ARMDISPATCH_VARIANT(crc_accel, &crc_accel_compiled, ARMDISPATCH_CRC32),
+//       ARMDISPATCH_VARIANT(crc_portable, NULL, 0),
+//   };
+//   ARMDISPATCH(void, crc, (void), (), crc_variants)
+//
+// The first variant which was compiled with its specialized instructions and
+// for which all required features are present is selected. The last variant
+// must be the portable one, without required feature.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Arm features which can be required by an implementation (bit mask).
+#define ARMDISPATCH_CRC32         0x0001
+#define ARMDISPATCH_AES           0x0002
+#define ARMDISPATCH_PMULL         0x0004
+#define ARMDISPATCH_SHA1          0x0008
+#define ARMDISPATCH_SHA256        0x0010
+#define ARMDISPATCH_SHA512        0x0020
+#define ARMDISPATCH_SHA3          0x0040
+#define ARMDISPATCH_SVE           0x0080
+#define ARMDISPATCH_SVE2          0x0100
+#define ARMDISPATCH_SVE_AES       0x0200
+#define ARMDISPATCH_SVE_PMULL128  0x0400
+#define ARMDISPATCH_SVE_SHA3      0x0800
+
+// Generic function pointer type, used to store all implementations.
+typedef void (*armdispatch_func_t)(void);
+
+// Description of one implementation of a dispatched function.
+typedef struct {
+    const char*        name;      // name of the implementation, for reporting
+    armdispatch_func_t func;      // address of the implementation
+    const int*         compiled;  // if not NULL, the implementation is usable only when *compiled is non-zero
+    uint32_t           features;  // required features, mask of ARMDISPATCH_xxx
+} armdispatch_variant_t;
+
+// Declare one implementation in an array of armdispatch_variant_t.
+#define ARMDISPATCH_VARIANT(func, compiled, features) {#func, (armdispatch_func_t)(func), (compiled), (features)}
+
+// Description of a dispatched function.
+typedef struct armdispatch_symbol {
+    const char*                  name;      // name of the dispatched function
+    const armdispatch_variant_t* variants;  // array of implementations, by order of preference
+    size_t                       count;     // number of implementations
+    const armdispatch_variant_t* selected;  // selected implementation, NULL before resolution
+    struct armdispatch_symbol*   next;      // next registered function
+} armdispatch_symbol_t;
+
+// Register a dispatched function for reporting. Called by static constructors.
+void armdispatch_register(armdispatch_symbol_t* sym);
+
+// Get the first registered dispatched function (use the field next to get the others).
+const armdispatch_symbol_t* armdispatch_first(void);
+
+// Find a registered dispatched function by name, NULL if not found.
+const armdispatch_symbol_t* armdispatch_find(const char* name);
+
+// Get the name of the selected implementation of a dispatched function, NULL if unknown.
+const char* armdispatch_selected(const char* name);
+
+// Print the selected implementation of all dispatched functions.
+void armdispatch_report(FILE* out);
+
+// Get the mask of supported features of the current CPU.
+uint32_t armdispatch_caps(void);
+
+// Check if an implementation can run on the current CPU.
+int armdispatch_usable(const armdispatch_variant_t* var);
+
+// Select the implementation of a dispatched function from the mask of supported features.
+// This function is inlined because it is called from ifunc resolvers, before the
+// relocation of the program is complete. It must not call any external function.
+static inline const armdispatch_variant_t* armdispatch_select(armdispatch_symbol_t* sym, uint32_t caps)
+{
+    const armdispatch_variant_t* var = &sym->variants[sym->count - 1];
+    for (size_t i = 0; i < sym->count; i++) {
+        if ((sym->variants[i].compiled == NULL || *sym->variants[i].compiled) && (sym->variants[i].features & ~caps) == 0) {
+            var = &sym->variants[i];
+            break;
+        }
+    }
+    sym->selected = var;
+    return var;
+}
+
+// Declare a static constructor which registers a dispatched function.
+#define ARMDISPATCH_REGISTER(name)                                   \
+    __attribute__((constructor)) static void name##_register(void)   \
+    {                                                                \
+        armdispatch_register(&name##_dispatch);                      \
+    }
+
+// Descriptor of a dispatched function.
+#define ARMDISPATCH_SYMBOL(name, variants) \
+    static armdispatch_symbol_t name##_dispatch = {#name, variants, sizeof(variants) / sizeof(variants[0]), NULL, NULL};
+
+#if defined(__linux__) && (defined(__aarch64__) || defined(__arm64__))
+
+    #include <sys/auxv.h>
+
+    // Older system headers may not define the SVE bits.
+    #if !defined(HWCAP_SVE)
+        #define HWCAP_SVE (1 << 22)
+    #endif
+    #if !defined(HWCAP2_SVE2)
+        #define HWCAP2_SVE2     (1 << 1)
+        #define HWCAP2_SVEAES   (1 << 2)
+        #define HWCAP2_SVEPMULL (1 << 3)
+        #define HWCAP2_SVESHA3  (1 << 5)
+    #endif
+
+    // Second parameter of ifunc resolvers in glibc 2.30 and higher, same as __ifunc_arg_t
+    // in <sys/ifunc.h>. It is present when ARMDISPATCH_IFUNC_ARG is set in the first one.
+    typedef struct {
+        unsigned long size;
+        unsigned long hwcap;
+        unsigned long hwcap2;
+    } armdispatch_ifunc_arg_t;
+    #define ARMDISPATCH_IFUNC_ARG (1ULL << 62)
+
+    // Translate AT_HWCAP and AT_HWCAP2 bits into a mask of ARMDISPATCH_xxx.
+    static inline uint32_t armdispatch_caps_hwcap(uint64_t hwcap, uint64_t hwcap2)
+    {
+        return ((hwcap & HWCAP_CRC32)       ? ARMDISPATCH_CRC32        : 0) |
+               ((hwcap & HWCAP_AES)         ? ARMDISPATCH_AES          : 0) |
+               ((hwcap & HWCAP_PMULL)       ? ARMDISPATCH_PMULL        : 0) |
+               ((hwcap & HWCAP_SHA1)        ? ARMDISPATCH_SHA1         : 0) |
+               ((hwcap & HWCAP_SHA2)        ? ARMDISPATCH_SHA256       : 0) |
+               ((hwcap & HWCAP_SHA512)      ? ARMDISPATCH_SHA512       : 0) |
+               ((hwcap & HWCAP_SHA3)        ? ARMDISPATCH_SHA3         : 0) |
+               ((hwcap & HWCAP_SVE)         ? ARMDISPATCH_SVE          : 0) |
+               ((hwcap2 & HWCAP2_SVE2)      ? ARMDISPATCH_SVE2         : 0) |
+               ((hwcap2 & HWCAP2_SVEAES)    ? ARMDISPATCH_SVE_AES      : 0) |
+               ((hwcap2 & HWCAP2_SVEPMULL)  ? ARMDISPATCH_SVE_PMULL128 : 0) |
+               ((hwcap2 & HWCAP2_SVESHA3)   ? ARMDISPATCH_SVE_SHA3     : 0);
+    }
+
+    // Define a dispatched function as a GNU indirect function.
+    // The resolver receives AT_HWCAP as first parameter on Arm64, and AT_HWCAP2
+    // in the second one with recent versions of glibc. Without it, SVE2 is ignored.
+    #define ARMDISPATCH(ret, name, params, args, variants)                                                     \
+        ARMDISPATCH_SYMBOL(name, variants)                                                                     \
+        static ret (*name##_resolve(uint64_t hwcap, const armdispatch_ifunc_arg_t* arg)) params                \
+        {                                                                                                      \
+            const uint64_t hwcap2 = (hwcap & ARMDISPATCH_IFUNC_ARG) ? arg->hwcap2 : 0;                         \
+            return (ret (*) params) armdispatch_select(&name##_dispatch, armdispatch_caps_hwcap(hwcap, hwcap2))->func; \
+        }                                                                                                      \
+        ret name params __attribute__((ifunc(#name "_resolve")));                                              \
+        ARMDISPATCH_REGISTER(name)
+
+#else
+
+    // Define a dispatched function as a wrapper on a function pointer, resolved at load time.
+    #define ARMDISPATCH(ret, name, params, args, variants)                                               \
+        ARMDISPATCH_SYMBOL(name, variants)                                                               \
+        static ret name##_resolve params;                                                                \
+        static ret (*name##_pointer) params = name##_resolve;                                            \
+        static ret name##_resolve params                                                                 \
+        {                                                                                                \
+            name##_pointer = (ret (*) params) armdispatch_select(&name##_dispatch, armdispatch_caps())->func; \
+            return name##_pointer args;                                                                  \
+        }                                                                                                \
+        ret name params                                                                                  \
+        {                                                                                                \
+            return name##_pointer args;                                                                  \
+        }                                                                                                \
+        __attribute__((constructor)) static void name##_register(void)                                   \
+        {                                                                                                \
+            armdispatch_register(&name##_dispatch);                                                      \
+            name##_pointer = (ret (*) params) armdispatch_select(&name##_dispatch, armdispatch_caps())->func; \
+        }
+
+#endif
+
+#endif // ARMDISPATCH_H
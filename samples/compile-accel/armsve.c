@@ -0,0 +1,22 @@
+#include "armsve.h"
+#include "armdispatch.h"
+
+#if defined(__ARM_FEATURE_SVE)
+
+    #include <arm_sve.h>
+
+    size_t armsve_vector_length(void)
+    {
+        // RDVL is an illegal instruction without SVE.
+        return (armdispatch_caps() & ARMDISPATCH_SVE) ? (size_t)svcntb() : 0;
+    }
+
+#else
+
+    size_t armsve_vector_length(void)
+    {
+        // Not compiled for SVE (non-Arm system or macOS).
+        return 0;
+    }
+
+#endif
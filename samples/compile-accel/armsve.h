@@ -0,0 +1,11 @@
+#if !defined(ARMSVE_H)
+#define ARMSVE_H 1
+
+#include <stddef.h>
+
+// Get the current SVE vector length in bytes, as returned by the RDVL instruction.
+// This is the effective length, as constrained by the kernel in ZCR_EL1.
+// Return zero if SVE is not supported by the CPU.
+size_t armsve_vector_length(void);
+
+#endif // ARMSVE_H
@@ -0,0 +1,93 @@
+#include "armtimer.h"
+#include <time.h>
+
+#if defined(__aarch64__) || defined(__arm64__)
+
+uint64_t armtimer_counter(void)
+{
+    // The ISB prevents the counter from being read ahead of previous instructions.
+    uint64_t value;
+    __asm__ __volatile__("isb\n\tmrs %0, cntvct_el0" : "=r" (value) : : "memory");
+    return value;
+}
+
+uint64_t armtimer_frequency(void)
+{
+    uint64_t value;
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r" (value));
+    return value;
+}
+
+#else
+
+uint64_t armtimer_counter(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t armtimer_frequency(void)
+{
+    return 1000000000;
+}
+
+#endif
+
+// Execute count x 16 dependent additions. An integer addition has a latency
+// of one cycle on all known cores, the loop control executes in parallel.
+// Use register operands: some cores fold additions of small immediate values.
+#define ARMTIMER_ADD_CHAIN 16
+
+#if defined(__aarch64__) || defined(__arm64__)
+    #define ARMTIMER_ADD1 "add %[x], %[x], %[x]\n\t"
+#elif defined(__x86_64__)
+    #define ARMTIMER_ADD1 "add %[x], %[x]\n\t"
+#endif
+
+#if defined(ARMTIMER_ADD1)
+
+#define ARMTIMER_ADD4 ARMTIMER_ADD1 ARMTIMER_ADD1 ARMTIMER_ADD1 ARMTIMER_ADD1
+
+static void armtimer_add_chain(uint64_t count)
+{
+    uint64_t x = 0;
+    __asm__ __volatile__(
+        "1:\n\t"
+        ARMTIMER_ADD4 ARMTIMER_ADD4 ARMTIMER_ADD4 ARMTIMER_ADD4
+#if defined(__x86_64__)
+        "sub $1, %[n]\n\t"
+        "jnz 1b"
+#else
+        "subs %[n], %[n], #1\n\t"
+        "b.ne 1b"
+#endif
+        : [x] "+r" (x), [n] "+r" (count) : : "cc");
+}
+
+double armtimer_cpu_frequency(void)
+{
+    // About 16 million cycles per measurement. Keep the fastest of several
+    // measurements to filter interrupts and frequency scaling at start.
+    const uint64_t count = 1000000;
+    uint64_t best = UINT64_MAX;
+    armtimer_add_chain(count);
+    for (int i = 0; i < 5; i++) {
+        const uint64_t start = armtimer_counter();
+        armtimer_add_chain(count);
+        const uint64_t ticks = armtimer_counter() - start;
+        if (ticks < best) {
+            best = ticks;
+        }
+    }
+    return best == 0 ? 0.0 : (double)(ARMTIMER_ADD_CHAIN * count) * (double)armtimer_frequency() / (double)best;
+}
+
+#else
+
+double armtimer_cpu_frequency(void)
+{
+    return 0.0;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#if !defined(ARMTIMER_H)
+#define ARMTIMER_H 1
+
+// Timing functions for benchmarks, based on the Arm generic timer.
+
+#include <stdint.h>
+
+// Read the virtual counter CNTVCT_EL0. On other architectures, use a monotonic clock in nanoseconds.
+uint64_t armtimer_counter(void);
+
+// Frequency of the counter in Hz (CNTFRQ_EL0).
+uint64_t armtimer_frequency(void);
+
+// Estimate the CPU clock frequency in Hz, calibrated against the counter.
+// Return zero if the frequency cannot be estimated on this architecture.
+double armtimer_cpu_frequency(void);
+
+#endif // ARMTIMER_H
@@ -0,0 +1,574 @@
+// Throughput benchmark of all implementations of the dispatched functions.
+// The output is in CSV format. Comment lines start with '#'.
+
+#if defined(__linux__)
+    #define _GNU_SOURCE 1
+    #include <sched.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "armdispatch.h"
+#include "armtimer.h"
+#include "armsve.h"
+#include "crc.h"
+#include "crc32c.h"
+#include "aes.h"
+#include "sha1.h"
+#include "sha256.h"
+#include "sha512.h"
+#include "sha3.h"
+
+// Size of the output buffer beyond the input size (digest, CRC).
+#define OUT_EXTRA 2048
+
+//----------------------------------------------------------------------------
+// Benchmark adapters: call one implementation of a dispatched function.
+// Return the size of the result in the output buffer.
+//----------------------------------------------------------------------------
+
+typedef struct {
+    const char* name;     // name of the dispatched function
+    size_t      block;    // processing granularity in bytes
+    size_t (*run)(armdispatch_func_t func, const uint8_t* data, size_t size, uint8_t* out);
+} kernel_t;
+
+static aes_key_t bench_aes_key;
+
+static size_t run_crc(armdispatch_func_t func, const uint8_t* data, size_t size, uint8_t* out)
+{
+    const uint32_t c = ((uint32_t (*)(uint32_t, const void*, size_t))func)(0, data, size);
+    memcpy(out, &c, sizeof(c));
+    return sizeof(c);
+}
+
+static size_t run_crc32c(armdispatch_func_t func, const uint8_t* data, size_t size, uint8_t* out)
+{
+    return run_crc(func, data, size, out);
+}
+
+// Multi-buffer functions: the buffer is split in n independent streams of the same size.
+static size_t run_crc_multi(armdispatch_func_t func, const uint8_t* data, size_t size, uint8_t* out, int n)
+{
+    uint32_t crcs[4] = {0};
+    const uint8_t* ptr[4];
+    for (int j = 0; j < n; j++) {
+        ptr[j] = data + j * (size / n);
+    }
+    ((void (*)(uint32_t*, const uint8_t* const*, size_t))func)(crcs, ptr, size / n);
+    memcpy(out, crcs, n * sizeof(uint32_t));
+    return n * sizeof(uint32_t);
+}
+
+static size_t run_crc_x2(armdispatch_func_t func, const uint8_t* data, size_t size, uint8_t* out)
+{
+    return run_crc_multi(func, data, size, out, 2);
+}
+
+static size_t run_crc_x4(armdispatch_func_t func, const uint8_t* data, size_t size, uint8_t* out)
+{
+    return run_crc_multi(func, data, size, out, 4);
+}
+
+static size_t run_aes(armdispatch_func_t func, const uint8_t* data, size_t size, uint8_t* out)
+{
+    uint8_t counter[AES_BLOCK_SIZE] = {0};
+    ((void (*)(const aes_key_t*, uint8_t*, const void*, void*, size_t))func)(&bench_aes_key, counter, data, out, size);
+    return size;
+}
+
+static size_t run_sha1(armdispatch_func_t func, const uint8_t* data, size_t size, uint8_t* out)
+{
+    uint32_t state[5] = {0};
+    ((void (*)(uint32_t*, const uint8_t*, size_t))func)(state, data, size / SHA1_BLOCK_SIZE);
+    memcpy(out, state, sizeof(state));
+    return sizeof(state);
+}
+
+static size_t run_sha256(armdispatch_func_t func, const uint8_t* data, size_t size, uint8_t* out)
+{
+    uint32_t state[8] = {0};
+    ((void (*)(uint32_t*, const uint8_t*, size_t))func)(state, data, size / SHA256_BLOCK_SIZE);
+    memcpy(out, state, sizeof(state));
+    return sizeof(state);
+}
+
+static size_t run_sha256_multi(armdispatch_func_t func, const uint8_t* data, size_t size, uint8_t* out, int n)
+{
+    uint32_t state[4][8] = {{0}};
+    const uint8_t* ptr[4];
+    for (int j = 0; j < n; j++) {
+        ptr[j] = data + j * (size / n);
+    }
+    ((void (*)(uint32_t (*)[8], const uint8_t* const*, size_t))func)(state, ptr, size / n / SHA256_BLOCK_SIZE);
+    memcpy(out, state, n * sizeof(state[0]));
+    return n * sizeof(state[0]);
+}
+
+static size_t run_sha256_x2(armdispatch_func_t func, const uint8_t* data, size_t size, uint8_t* out)
+{
+    return run_sha256_multi(func, data, size, out, 2);
+}
+
+static size_t run_sha256_x4(armdispatch_func_t func, const uint8_t* data, size_t size, uint8_t* out)
+{
+    return run_sha256_multi(func, data, size, out, 4);
+}
+
+static size_t run_sha512(armdispatch_func_t func, const uint8_t* data, size_t size, uint8_t* out)
+{
+    uint64_t state[8] = {0};
+    ((void (*)(uint64_t*, const uint8_t*, size_t))func)(state, data, size / SHA512_BLOCK_SIZE);
+    memcpy(out, state, sizeof(state));
+    return sizeof(state);
+}
+
+static size_t run_sha3(armdispatch_func_t func, const uint8_t* data, size_t size, uint8_t* out)
+{
+    uint64_t state[25] = {0};
+    ((void (*)(uint64_t*, const uint8_t*, size_t))func)(state, data, size / SHA3_BLOCK_SIZE);
+    memcpy(out, state, sizeof(state));
+    return sizeof(state);
+}
+
+// Multi-buffer SHA-3: 8 streams, enough to fill 512-bit SVE vectors.
+#define SHA3_STREAMS 8
+
+static size_t run_sha3_multi(armdispatch_func_t func, const uint8_t* data, size_t size, uint8_t* out)
+{
+    uint64_t state[SHA3_STREAMS][25];
+    const uint8_t* ptr[SHA3_STREAMS];
+    memset(state, 0, sizeof(state));
+    for (int j = 0; j < SHA3_STREAMS; j++) {
+        ptr[j] = data + j * (size / SHA3_STREAMS);
+    }
+    ((void (*)(uint64_t (*)[25], const uint8_t* const*, size_t, size_t))func)(state, ptr, size / SHA3_STREAMS / SHA3_BLOCK_SIZE, SHA3_STREAMS);
+    memcpy(out, state, sizeof(state));
+    return sizeof(state);
+}
+
+static const kernel_t kernels[] = {
+    {"crc",               1,                              run_crc},
+    {"crc_x2",            2,                              run_crc_x2},
+    {"crc_x4",            4,                              run_crc_x4},
+    {"crc32c",            1,                              run_crc32c},
+    {"aes",               AES_BLOCK_SIZE,                 run_aes},
+    {"sha1_blocks",       SHA1_BLOCK_SIZE,                run_sha1},
+    {"sha256_blocks",     SHA256_BLOCK_SIZE,              run_sha256},
+    {"sha256_blocks_x2",  2 * SHA256_BLOCK_SIZE,          run_sha256_x2},
+    {"sha256_blocks_x4",  4 * SHA256_BLOCK_SIZE,          run_sha256_x4},
+    {"sha512_blocks",     SHA512_BLOCK_SIZE,              run_sha512},
+    {"sha3_blocks",       SHA3_BLOCK_SIZE,                run_sha3},
+    {"sha3_blocks_multi", SHA3_STREAMS * SHA3_BLOCK_SIZE, run_sha3_multi},
+};
+
+#define KERNELS_COUNT (sizeof(kernels) / sizeof(kernels[0]))
+
+// Number of bytes which are processed for a buffer size: at least one block.
+// For multi-buffer functions, the block contains one block per stream.
+static size_t processed_size(const kernel_t* k, size_t size)
+{
+    return size < k->block ? k->block : size - size % k->block;
+}
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+typedef struct {
+    const char* functions[KERNELS_COUNT];  // selected functions, all if none
+    size_t      functions_count;
+    size_t      min_size;
+    size_t      max_size;
+    int         max_threads;
+    uint64_t    duration_ms;
+} options_t;
+
+static void usage(const char* command)
+{
+    fprintf(stderr, "\n"
+                    "Usage: %s [options]\n"
+                    "\n"
+                    "  -a name : benchmark this dispatched function only, repeat for several\n"
+                    "  -d ms : minimum duration of each measurement (default: 50)\n"
+                    "  -h : display this help text\n"
+                    "  -m size : minimum buffer size, suffix k or m allowed (default: 64)\n"
+                    "  -M size : maximum buffer size, suffix k or m allowed (default: 64m)\n"
+                    "  -t count : maximum number of threads (default: number of CPU cores)\n"
+                    "\n"
+                    "The buffer sizes are multiplied by 4 from the minimum to the maximum size.\n"
+                    "The numbers of threads are 1, 2, 4... up to the maximum. Each thread uses\n"
+                    "two private buffers of the maximum size. On Linux, thread n is pinned on\n"
+                    "CPU core n. On macOS, threads cannot be pinned.\n"
+                    "\n", command);
+    exit(EXIT_FAILURE);
+}
+
+static size_t parse_size(const char* command, const char* arg)
+{
+    char* end = NULL;
+    size_t size = (size_t)strtoull(arg, &end, 0);
+    if (*end == 'k' || *end == 'K') {
+        size *= 1024;
+        end++;
+    }
+    else if (*end == 'm' || *end == 'M') {
+        size *= 1024 * 1024;
+        end++;
+    }
+    if (*end != '\0' || size == 0) {
+        fprintf(stderr, "%s: invalid size %s\n", command, arg);
+        exit(EXIT_FAILURE);
+    }
+    return size;
+}
+
+static void get_options(options_t* opt, int argc, char* argv[])
+{
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int c;
+
+    memset(opt, 0, sizeof(*opt));
+    opt->min_size = 64;
+    opt->max_size = 64 * 1024 * 1024;
+    opt->max_threads = cpus < 1 ? 1 : (int)cpus;
+    opt->duration_ms = 50;
+
+    while ((c = getopt(argc, argv, "a:d:hm:M:t:")) != -1) {
+        switch (c) {
+            case 'a':
+                if (armdispatch_find(optarg) == NULL) {
+                    fprintf(stderr, "%s: unknown function %s\n", argv[0], optarg);
+                    exit(EXIT_FAILURE);
+                }
+                if (opt->functions_count < KERNELS_COUNT) {
+                    opt->functions[opt->functions_count++] = optarg;
+                }
+                break;
+            case 'd':
+                opt->duration_ms = strtoull(optarg, NULL, 0);
+                break;
+            case 'm':
+                opt->min_size = parse_size(argv[0], optarg);
+                break;
+            case 'M':
+                opt->max_size = parse_size(argv[0], optarg);
+                break;
+            case 't':
+                opt->max_threads = atoi(optarg);
+                if (opt->max_threads < 1) {
+                    usage(argv[0]);
+                }
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (optind < argc || opt->min_size > opt->max_size) {
+        usage(argv[0]);
+    }
+}
+
+// Next number of threads: 1, 2, 4... max, then max + 1 to end the sequence.
+static int next_threads(int threads, int max_threads)
+{
+    return threads >= max_threads ? max_threads + 1 : (threads * 2 > max_threads ? max_threads : threads * 2);
+}
+
+static int selected_function(const options_t* opt, const char* name)
+{
+    for (size_t i = 0; i < opt->functions_count; i++) {
+        if (strcmp(opt->functions[i], name) == 0) {
+            return 1;
+        }
+    }
+    return opt->functions_count == 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Pool of worker threads. Each worker owns its buffers.
+//----------------------------------------------------------------------------
+
+typedef struct {
+    pthread_t thread;
+    int       index;
+    size_t    buffer_size;
+    uint8_t*  data;      // input buffer, allocated and filled by the thread
+    uint8_t*  out;       // output buffer
+    uint64_t  start;     // counter at start of measurement
+    uint64_t  end;       // counter at end of measurement
+} worker_t;
+
+// Current job, protected by the mutex.
+static pthread_mutex_t  pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   pool_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t   pool_done = PTHREAD_COND_INITIALIZER;
+static int              pool_generation = 0;   // incremented for each job
+static int              pool_active = 0;       // number of threads in current job
+static int              pool_running = 0;      // number of threads still running current job
+static int              pool_quit = 0;
+static const kernel_t*  job_kernel = NULL;
+static armdispatch_func_t job_func = NULL;
+static size_t           job_size = 0;
+static uint64_t         job_iterations = 0;
+
+// Start barrier of the active threads, outside the mutex for a precise start.
+static atomic_int       pool_ready;
+
+static void* worker_main(void* arg)
+{
+    worker_t* w = arg;
+
+#if defined(__linux__)
+    // More threads than CPU cores is allowed, but cycles/byte is then meaningless.
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(w->index % sysconf(_SC_NPROCESSORS_ONLN), &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+
+    // Allocate the buffers in the thread to get memory which is local to its CPU.
+    w->data = malloc(w->buffer_size);
+    w->out = malloc(w->buffer_size + OUT_EXTRA);
+    if (w->data == NULL || w->out == NULL) {
+        fprintf(stderr, "bench-accel: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < w->buffer_size; i++) {
+        w->data[i] = (uint8_t)(i * 7 + w->index);
+    }
+
+    int generation = 0;
+    for (;;) {
+        pthread_mutex_lock(&pool_mutex);
+        while (pool_generation == generation) {
+            pthread_cond_wait(&pool_start, &pool_mutex);
+        }
+        generation = pool_generation;
+        const int quit = pool_quit;
+        const int active = pool_active;
+        pthread_mutex_unlock(&pool_mutex);
+
+        if (quit) {
+            break;
+        }
+        if (w->index >= active) {
+            continue;
+        }
+
+        atomic_fetch_add(&pool_ready, 1);
+        while (atomic_load(&pool_ready) < active) {
+        }
+        w->start = armtimer_counter();
+        for (uint64_t i = 0; i < job_iterations; i++) {
+            job_kernel->run(job_func, w->data, job_size, w->out);
+        }
+        w->end = armtimer_counter();
+
+        pthread_mutex_lock(&pool_mutex);
+        if (--pool_running == 0) {
+            pthread_cond_signal(&pool_done);
+        }
+        pthread_mutex_unlock(&pool_mutex);
+    }
+    free(w->data);
+    free(w->out);
+    return NULL;
+}
+
+// Run a job on the first 'threads' workers and wait for completion.
+static void run_job(int threads, const kernel_t* k, armdispatch_func_t func, size_t size, uint64_t iterations)
+{
+    pthread_mutex_lock(&pool_mutex);
+    job_kernel = k;
+    job_func = func;
+    job_size = size;
+    job_iterations = iterations;
+    atomic_store(&pool_ready, 0);
+    pool_active = pool_running = threads;
+    pool_generation++;
+    pthread_cond_broadcast(&pool_start);
+    while (pool_running > 0) {
+        pthread_cond_wait(&pool_done, &pool_mutex);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+static void stop_pool(worker_t* workers, int count)
+{
+    pthread_mutex_lock(&pool_mutex);
+    pool_quit = 1;
+    pool_generation++;
+    pthread_cond_broadcast(&pool_start);
+    pthread_mutex_unlock(&pool_mutex);
+    for (int i = 0; i < count; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Check that all usable implementations return the same result as the last one (portable).
+//----------------------------------------------------------------------------
+
+static int check_kernel(const kernel_t* k, const armdispatch_symbol_t* sym)
+{
+    const size_t size = 16 * 1024 + 13;
+    uint8_t* data = malloc(size);
+    uint8_t* ref = malloc(size + OUT_EXTRA);
+    uint8_t* out = malloc(size + OUT_EXTRA);
+    int ok = 1;
+
+    for (size_t i = 0; i < size; i++) {
+        data[i] = (uint8_t)(i * 13 + 5);
+    }
+    const size_t ref_size = k->run(sym->variants[sym->count - 1].func, data, size, ref);
+    for (size_t v = 0; v + 1 < sym->count; v++) {
+        if (armdispatch_usable(&sym->variants[v])) {
+            const size_t out_size = k->run(sym->variants[v].func, data, size, out);
+            if (out_size != ref_size || memcmp(out, ref, ref_size) != 0) {
+                fprintf(stderr, "bench-accel: %s returns a different result from %s\n", sym->variants[v].name, sym->variants[sym->count - 1].name);
+                ok = 0;
+            }
+        }
+    }
+    free(data);
+    free(ref);
+    free(out);
+    return ok;
+}
+
+
+//----------------------------------------------------------------------------
+// Application entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    static const struct {
+        uint32_t    bit;
+        const char* name;
+    } features[] = {
+        {ARMDISPATCH_CRC32,        "FEAT_CRC32"},
+        {ARMDISPATCH_AES,          "FEAT_AES"},
+        {ARMDISPATCH_PMULL,        "FEAT_PMULL"},
+        {ARMDISPATCH_SHA1,         "FEAT_SHA1"},
+        {ARMDISPATCH_SHA256,       "FEAT_SHA256"},
+        {ARMDISPATCH_SHA512,       "FEAT_SHA512"},
+        {ARMDISPATCH_SHA3,         "FEAT_SHA3"},
+        {ARMDISPATCH_SVE,          "FEAT_SVE"},
+        {ARMDISPATCH_SVE2,         "FEAT_SVE2"},
+        {ARMDISPATCH_SVE_AES,      "FEAT_SVE_AES"},
+        {ARMDISPATCH_SVE_PMULL128, "FEAT_SVE_PMULL128"},
+        {ARMDISPATCH_SVE_SHA3,     "FEAT_SVE_SHA3"},
+    };
+
+    options_t opt;
+    get_options(&opt, argc, argv);
+
+    static const uint8_t key[AES_KEY_SIZE] = {0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+    aes_init(&bench_aes_key, key);
+
+    // Some environment information, as comment lines.
+    const uint64_t counter_freq = armtimer_frequency();
+    const double cpu_freq = armtimer_cpu_frequency();
+    const uint32_t caps = armdispatch_caps();
+    printf("# counter_frequency_hz,%llu\n", (unsigned long long)counter_freq);
+    printf("# cpu_frequency_hz,%.0f\n", cpu_freq);
+    printf("# cpus,%ld\n", sysconf(_SC_NPROCESSORS_ONLN));
+    printf("# features");
+    for (size_t i = 0; i < sizeof(features) / sizeof(features[0]); i++) {
+        if (caps & features[i].bit) {
+            printf(",%s", features[i].name);
+        }
+    }
+    printf("\n");
+    printf("# sve_vector_length_bits,%zu\n", 8 * armsve_vector_length());
+
+    // Check the consistency of all implementations first.
+    int status = EXIT_SUCCESS;
+    for (size_t i = 0; i < KERNELS_COUNT; i++) {
+        const armdispatch_symbol_t* sym = armdispatch_find(kernels[i].name);
+        if (sym != NULL && selected_function(&opt, kernels[i].name) && !check_kernel(&kernels[i], sym)) {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    // Start all worker threads.
+    worker_t* workers = calloc((size_t)opt.max_threads, sizeof(worker_t));
+    for (int i = 0; i < opt.max_threads; i++) {
+        workers[i].index = i;
+        workers[i].buffer_size = opt.max_size + SHA3_STREAMS * SHA3_BLOCK_SIZE;
+        if (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0) {
+            fprintf(stderr, "%s: cannot create thread\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    const uint64_t min_ticks = opt.duration_ms * counter_freq / 1000;
+    printf("function,variant,selected,size,bytes,threads,iterations,seconds,gbps,cycles_per_byte\n");
+    fflush(stdout);
+
+    for (size_t i = 0; i < KERNELS_COUNT; i++) {
+        const kernel_t* k = &kernels[i];
+        const armdispatch_symbol_t* sym = armdispatch_find(k->name);
+        if (sym == NULL || !selected_function(&opt, k->name)) {
+            continue;
+        }
+        for (size_t v = 0; v < sym->count; v++) {
+            const armdispatch_variant_t* var = &sym->variants[v];
+            if (!armdispatch_usable(var)) {
+                continue;
+            }
+            for (size_t size = opt.min_size; size <= opt.max_size; size *= 4) {
+                const size_t bytes = processed_size(k, size);
+
+                // Find the number of iterations for the minimum duration on one thread.
+                uint64_t iterations = 1;
+                for (;;) {
+                    run_job(1, k, var->func, bytes, iterations);
+                    const uint64_t ticks = workers[0].end - workers[0].start;
+                    if (ticks >= min_ticks) {
+                        break;
+                    }
+                    // Extrapolate with a 10% margin, at most 100 times more.
+                    const uint64_t next = ticks == 0 ? iterations * 100 : (uint64_t)((double)iterations * 1.1 * (double)min_ticks / (double)ticks) + 1;
+                    iterations = next > iterations * 100 ? iterations * 100 : next;
+                }
+
+                for (int threads = 1; threads <= opt.max_threads; threads = next_threads(threads, opt.max_threads)) {
+                    run_job(threads, k, var->func, bytes, iterations);
+
+                    // Total duration from the first start to the last end, average duration per thread.
+                    uint64_t first = workers[0].start, last = workers[0].end;
+                    double thread_ticks = 0.0;
+                    for (int t = 0; t < threads; t++) {
+                        first = workers[t].start < first ? workers[t].start : first;
+                        last = workers[t].end > last ? workers[t].end : last;
+                        thread_ticks += (double)(workers[t].end - workers[t].start);
+                    }
+                    thread_ticks /= threads;
+
+                    const double seconds = (double)(last - first) / (double)counter_freq;
+                    const double total = (double)bytes * (double)iterations * threads;
+                    const double gbps = seconds > 0.0 ? total / seconds / 1e9 : 0.0;
+                    const double cpb = cpu_freq * thread_ticks / (double)counter_freq / ((double)bytes * (double)iterations);
+
+                    printf("%s,%s,%d,%zu,%zu,%d,%llu,%.6f,%.3f,%.3f\n", k->name, var->name, var == sym->selected,
+                           size, bytes, threads, (unsigned long long)iterations, seconds, gbps, cpb);
+                    fflush(stdout);
+                }
+            }
+        }
+    }
+
+    stop_pool(workers, opt.max_threads);
+    free(workers);
+    return status;
+}
@@ -0,0 +1,48 @@
+#if !defined(BYTEORDER_H)
+#define BYTEORDER_H 1
+
+// Load and store integers in memory in a specific byte order, regardless of alignment.
+
+#include <stdint.h>
+
+static inline uint32_t load_be32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline uint64_t load_be64(const uint8_t* p)
+{
+    return ((uint64_t)load_be32(p) << 32) | load_be32(p + 4);
+}
+
+static inline uint64_t load_le64(const uint8_t* p)
+{
+    uint64_t x = 0;
+    for (int i = 7; i >= 0; i--) {
+        x = (x << 8) | p[i];
+    }
+    return x;
+}
+
+static inline void store_be32(uint8_t* p, uint32_t x)
+{
+    p[0] = (uint8_t)(x >> 24);
+    p[1] = (uint8_t)(x >> 16);
+    p[2] = (uint8_t)(x >> 8);
+    p[3] = (uint8_t)x;
+}
+
+static inline void store_be64(uint8_t* p, uint64_t x)
+{
+    store_be32(p, (uint32_t)(x >> 32));
+    store_be32(p + 4, (uint32_t)x);
+}
+
+static inline void store_le64(uint8_t* p, uint64_t x)
+{
+    for (int i = 0; i < 8; i++, x >>= 8) {
+        p[i] = (uint8_t)x;
+    }
+}
+
+#endif // BYTEORDER_H
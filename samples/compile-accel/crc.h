@@ -1,7 +1,20 @@
 #if !defined(CRC_H)
 #define CRC_H 1
 
-// Hypothetical CRC function.
-void crc();
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC-32 function (ISO-HDLC polynomial, same as zlib and Ethernet).
+// Start with crc = 0. Successive calls can be chained on consecutive data.
+uint32_t crc(uint32_t crc, const void* data, size_t size);
+
+// Compute the CRC-32 of several independent buffers, interleaving the computations
+// to fill the pipeline of the CRC32 instructions. On input, crcs[] contains the
+// initial values, usually zero. On output, it contains the CRC of each buffer.
+void crc_multi(uint32_t crcs[], const void* const data[], const size_t sizes[], size_t count);
+
+// CRC-32 of 2 or 4 independent buffers of the same size.
+void crc_x2(uint32_t crcs[2], const uint8_t* const data[2], size_t size);
+void crc_x4(uint32_t crcs[4], const uint8_t* const data[4], size_t size);
 
 #endif // CRC_H
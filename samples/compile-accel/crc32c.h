@@ -0,0 +1,11 @@
+#if !defined(CRC32C_H)
+#define CRC32C_H 1
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC-32C function (Castagnoli polynomial, same as iSCSI, ext4 and SSE4.2).
+// Start with crc = 0. Successive calls can be chained on consecutive data.
+uint32_t crc32c(uint32_t crc, const void* data, size_t size);
+
+#endif // CRC32C_H
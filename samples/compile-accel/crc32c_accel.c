@@ -0,0 +1,36 @@
+#include "crc32c_accel.h"
+#include <assert.h>
+#include <string.h>
+
+#if defined(__ARM_FEATURE_CRC32)
+
+    #include <arm_acle.h>
+
+    const int crc32c_accel_compiled = 1;
+    uint32_t crc32c_accel(uint32_t crc, const void* data, size_t size)
+    {
+        const uint8_t* p = data;
+        crc = ~crc;
+        // Process 8 bytes per instruction, using unaligned 64-bit loads.
+        for (; size >= 8; p += 8, size -= 8) {
+            uint64_t x;
+            memcpy(&x, p, sizeof(x));
+            crc = __crc32cd(crc, x);
+        }
+        while (size-- > 0) {
+            crc = __crc32cb(crc, *p++);
+        }
+        return ~crc;
+    }
+
+#else
+
+    const int crc32c_accel_compiled = 0;
+    uint32_t crc32c_accel(uint32_t crc, const void* data, size_t size)
+    {
+        // Should never be called if the CPU does not support the compilation target of this module;
+        assert(0);
+        return 0;
+    }
+
+#endif
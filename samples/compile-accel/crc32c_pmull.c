@@ -0,0 +1,91 @@
+#include "crc32c_pmull.h"
+#include <assert.h>
+#include <string.h>
+
+#if defined(__ARM_FEATURE_CRC32) && defined(__ARM_FEATURE_CRYPTO)
+
+    #include <arm_acle.h>
+    #include <arm_neon.h>
+
+    // Folding constants for a distance of D bits: x^(D+31) mod P and x^(D-33) mod P,
+    // bit-reflected. The offsets compensate the bit order of the reflected CRC.
+    static const uint64_t crc32c_k512[2] = {0x740EEF02, 0x9E4ADDF8};
+    static const uint64_t crc32c_k128[2] = {0xF20C0DFE, 0x493C7D27};
+
+    // Load 16 bytes at any alignment.
+    static inline uint64x2_t crc32c_load(const uint8_t* p)
+    {
+        return vreinterpretq_u64_u8(vld1q_u8(p));
+    }
+
+    // Fold a 128-bit accumulator over the distance of the constants k.
+    static inline uint64x2_t crc32c_fold(uint64x2_t x, poly64x2_t k)
+    {
+        const poly64x2_t p = vreinterpretq_p64_u64(x);
+        return veorq_u64(vreinterpretq_u64_p128(vmull_p64(vgetq_lane_p64(p, 0), vgetq_lane_p64(k, 0))),
+                         vreinterpretq_u64_p128(vmull_high_p64(p, k)));
+    }
+
+    const int crc32c_pmull_compiled = 1;
+    uint32_t crc32c_pmull(uint32_t crc, const void* data, size_t size)
+    {
+        const uint8_t* p = data;
+        crc = ~crc;
+
+        // The CRC32 instructions have a latency of several cycles and each one depends
+        // on the previous one. Instead, fold four independent 128-bit accumulators,
+        // 64 bytes per iteration, with carry-less multiplications which can be pipelined.
+        if (size >= 128) {
+            const poly64x2_t k512 = vreinterpretq_p64_u64(vld1q_u64(crc32c_k512));
+            const poly64x2_t k128 = vreinterpretq_p64_u64(vld1q_u64(crc32c_k128));
+
+            // The initial CRC value is XOR'ed into the first 4 bytes.
+            uint64x2_t x0 = veorq_u64(crc32c_load(p), vsetq_lane_u64(crc, vdupq_n_u64(0), 0));
+            uint64x2_t x1 = crc32c_load(p + 16);
+            uint64x2_t x2 = crc32c_load(p + 32);
+            uint64x2_t x3 = crc32c_load(p + 48);
+            p += 64;
+            size -= 64;
+
+            for (; size >= 64; p += 64, size -= 64) {
+                x0 = veorq_u64(crc32c_fold(x0, k512), crc32c_load(p));
+                x1 = veorq_u64(crc32c_fold(x1, k512), crc32c_load(p + 16));
+                x2 = veorq_u64(crc32c_fold(x2, k512), crc32c_load(p + 32));
+                x3 = veorq_u64(crc32c_fold(x3, k512), crc32c_load(p + 48));
+            }
+
+            // Fold the four accumulators into one, then the remaining 16-byte chunks.
+            x1 = veorq_u64(crc32c_fold(x0, k128), x1);
+            x2 = veorq_u64(crc32c_fold(x1, k128), x2);
+            x3 = veorq_u64(crc32c_fold(x2, k128), x3);
+            for (; size >= 16; p += 16, size -= 16) {
+                x3 = veorq_u64(crc32c_fold(x3, k128), crc32c_load(p));
+            }
+
+            // The accumulator is now equivalent to the beginning of the message. Its CRC is
+            // computed from zero since the initial value was already injected in the data.
+            crc = __crc32cd(__crc32cd(0, vgetq_lane_u64(x3, 0)), vgetq_lane_u64(x3, 1));
+        }
+
+        for (; size >= 8; p += 8, size -= 8) {
+            uint64_t x;
+            memcpy(&x, p, sizeof(x));
+            crc = __crc32cd(crc, x);
+        }
+        while (size-- > 0) {
+            crc = __crc32cb(crc, *p++);
+        }
+        return ~crc;
+    }
+
+#else
+
+    const int crc32c_pmull_compiled = 0;
+    uint32_t crc32c_pmull(uint32_t crc, const void* data, size_t size)
+    {
+        // Should never be called if the CPU does not support the compilation target of this module;
+        assert(0);
+        return 0;
+    }
+
+#endif
@@ -0,0 +1,13 @@
+#if !defined(CRC32C_PMULL_H)
+#define CRC32C_PMULL_H 1
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Boolean: indicate if this module could be compiled with accelerated instructions.
+extern const int crc32c_pmull_compiled;
+
+// Accelerated CRC-32C function, folding 64 bytes at a time with PMULL.
+uint32_t crc32c_pmull(uint32_t crc, const void* data, size_t size);
+
+#endif // CRC32C_PMULL_H
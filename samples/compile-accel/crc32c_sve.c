@@ -0,0 +1,123 @@
+#include "crc32c_sve.h"
+#include <assert.h>
+#include <string.h>
+
+#if defined(__ARM_FEATURE_SVE2_AES) && defined(__ARM_FEATURE_CRC32)
+
+    #include <arm_acle.h>
+    #include <arm_sve.h>
+
+    // Folding constants x^(D+31) mod P and x^(D-33) mod P, bit-reflected, as in crc32c_pmull.c.
+    // The folding distance D depends on the vector length: index 0 is for 128 bits, etc.
+    // Distance of four vectors, in the main loop.
+    static const uint64_t crc32c_k4[16][2] = {
+        {0x740EEF02, 0x9E4ADDF8},  // VL = 128 bits
+        {0x6992CEA2, 0x0D3B6092},  // VL = 256 bits
+        {0xA87AB8A8, 0xAB7AFF2A},  // VL = 384 bits
+        {0xDCB17AA4, 0xB9E02B86},  // VL = 512 bits
+        {0x21F3D99C, 0xBAC2FD7B},  // VL = 640 bits
+        {0x00AC29CF, 0xD270F1A2},  // VL = 768 bits
+        {0x9AF01F2D, 0x1B03397F},  // VL = 896 bits
+        {0xBD6F81F8, 0xDD7E3B0C},  // VL = 1024 bits
+        {0x52148F02, 0x271D9844},  // VL = 1152 bits
+        {0x4D56973C, 0x6B749FB2},  // VL = 1280 bits
+        {0xD104B8FC, 0xE6FC4E6A},  // VL = 1408 bits
+        {0x8D96551C, 0xD7A4825C},  // VL = 1536 bits
+        {0xD8D26619, 0x26F6A60A},  // VL = 1664 bits
+        {0xDD07448E, 0x68BCE87A},  // VL = 1792 bits
+        {0x80FF0093, 0x3771E98F},  // VL = 1920 bits
+        {0xFE314258, 0x170076FA},  // VL = 2048 bits
+    };
+
+    // Distance of one vector, to fold the four accumulators into one.
+    static const uint64_t crc32c_k1[16][2] = {
+        {0xF20C0DFE, 0x493C7D27},  // VL = 128 bits
+        {0x3DA6D0CB, 0xBA4FC28E},  // VL = 256 bits
+        {0x1C291D04, 0xDDC0152B},  // VL = 384 bits
+        {0x740EEF02, 0x9E4ADDF8},  // VL = 512 bits
+        {0x083A6EEC, 0x39D3B296},  // VL = 640 bits
+        {0xC49F4F67, 0x0715CE53},  // VL = 768 bits
+        {0x2AD91C30, 0x47DB8317},  // VL = 896 bits
+        {0x6992CEA2, 0x0D3B6092},  // VL = 1024 bits
+        {0x7E908048, 0xC96CFDC0},  // VL = 1152 bits
+        {0x1B3D8F29, 0x878A92A7},  // VL = 1280 bits
+        {0xF1D0F55E, 0xDAECE73E},  // VL = 1408 bits
+        {0xA87AB8A8, 0xAB7AFF2A},  // VL = 1536 bits
+        {0x8462D800, 0x2162D385},  // VL = 1664 bits
+        {0x71D111A8, 0x83348832},  // VL = 1792 bits
+        {0xFFD852C6, 0x299847D5},  // VL = 1920 bits
+        {0xDCB17AA4, 0xB9E02B86},  // VL = 2048 bits
+    };
+
+    // Fold each 128-bit segment of an accumulator over the distance of the constants k.
+    static inline svuint64_t crc32c_fold(svuint64_t x, svuint64_t k)
+    {
+        return sveor_u64_x(svptrue_b64(), svpmullb_pair_u64(x, k), svpmullt_pair_u64(x, k));
+    }
+
+    const int crc32c_sve_compiled = 1;
+    uint32_t crc32c_sve(uint32_t crc, const void* data, size_t size)
+    {
+        const uint8_t* p = data;
+        const size_t vl = svcntb();
+        crc = ~crc;
+
+        // Same method as crc32c_pmull(), with one accumulator per 128-bit segment
+        // of four vectors, 4 * svcntb() bytes per iteration.
+        if (size >= 8 * vl) {
+            const svbool_t all = svptrue_b8();
+            const svuint64_t k4 = svld1rq_u64(all, crc32c_k4[vl / 16 - 1]);
+            const svuint64_t k1 = svld1rq_u64(all, crc32c_k1[vl / 16 - 1]);
+
+            // The initial CRC value is XOR'ed into the first 4 bytes.
+            svuint64_t x0 = sveor_n_u64_m(svwhilelt_b64_u64(0, 1), svreinterpret_u64_u8(svld1_u8(all, p)), crc);
+            svuint64_t x1 = svreinterpret_u64_u8(svld1_u8(all, p + vl));
+            svuint64_t x2 = svreinterpret_u64_u8(svld1_u8(all, p + 2 * vl));
+            svuint64_t x3 = svreinterpret_u64_u8(svld1_u8(all, p + 3 * vl));
+            p += 4 * vl;
+            size -= 4 * vl;
+
+            for (; size >= 4 * vl; p += 4 * vl, size -= 4 * vl) {
+                x0 = sveor_u64_x(all, crc32c_fold(x0, k4), svreinterpret_u64_u8(svld1_u8(all, p)));
+                x1 = sveor_u64_x(all, crc32c_fold(x1, k4), svreinterpret_u64_u8(svld1_u8(all, p + vl)));
+                x2 = sveor_u64_x(all, crc32c_fold(x2, k4), svreinterpret_u64_u8(svld1_u8(all, p + 2 * vl)));
+                x3 = sveor_u64_x(all, crc32c_fold(x3, k4), svreinterpret_u64_u8(svld1_u8(all, p + 3 * vl)));
+            }
+
+            // Fold the four accumulators into one.
+            x1 = sveor_u64_x(all, crc32c_fold(x0, k1), x1);
+            x2 = sveor_u64_x(all, crc32c_fold(x1, k1), x2);
+            x3 = sveor_u64_x(all, crc32c_fold(x2, k1), x3);
+
+            // The accumulator is now equivalent to the beginning of the message, one vector.
+            // Its CRC is computed from zero since the initial value was already injected.
+            uint64_t acc[256 / 8];
+            svst1_u64(all, acc, x3);
+            crc = 0;
+            for (size_t i = 0; i < vl / 8; i++) {
+                crc = __crc32cd(crc, acc[i]);
+            }
+        }
+
+        for (; size >= 8; p += 8, size -= 8) {
+            uint64_t x;
+            memcpy(&x, p, sizeof(x));
+            crc = __crc32cd(crc, x);
+        }
+        while (size-- > 0) {
+            crc = __crc32cb(crc, *p++);
+        }
+        return ~crc;
+    }
+
+#else
+
+    const int crc32c_sve_compiled = 0;
+    uint32_t crc32c_sve(uint32_t crc, const void* data, size_t size)
+    {
+        // Should never be called if the CPU does not support the compilation target of this module;
+        assert(0);
+        return 0;
+    }
+
+#endif
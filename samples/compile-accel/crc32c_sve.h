@@ -0,0 +1,13 @@
+#if !defined(CRC32C_SVE_H)
+#define CRC32C_SVE_H 1
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Boolean: indicate if this module could be compiled with accelerated instructions.
+extern const int crc32c_sve_compiled;
+
+// CRC-32C function, folding four vectors at a time with SVE2 PMULL128 instructions.
+uint32_t crc32c_sve(uint32_t crc, const void* data, size_t size);
+
+#endif // CRC32C_SVE_H
@@ -1,25 +1,83 @@
 #include "crc_accel.h"
 #include <assert.h>
-#include <stdio.h>
+#include <string.h>
 
 #if defined(__ARM_FEATURE_CRC32)
 
+    #include <arm_acle.h>
+
     const int crc_accel_compiled = 1;
-    void crc_accel()
+    uint32_t crc_accel(uint32_t crc, const void* data, size_t size)
+    {
+        const uint8_t* p = data;
+        crc = ~crc;
+        // Process 8 bytes per instruction, using unaligned 64-bit loads.
+        for (; size >= 8; p += 8, size -= 8) {
+            uint64_t x;
+            memcpy(&x, p, sizeof(x));
+            crc = __crc32d(crc, x);
+        }
+        while (size-- > 0) {
+            crc = __crc32b(crc, *p++);
+        }
+        return ~crc;
+    }
+
+    // Interleave n independent buffers. Each CRC32 instruction depends on the previous one
+    // of the same buffer only, the CPU can execute the instructions of other buffers meanwhile.
+    static inline __attribute__((always_inline)) void crc_accel_multi(uint32_t crcs[], const uint8_t* const data[], size_t size, const int n)
+    {
+        uint32_t c[4];
+        for (int j = 0; j < n; j++) {
+            c[j] = ~crcs[j];
+        }
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            #pragma GCC unroll 4
+            for (int j = 0; j < n; j++) {
+                uint64_t x;
+                memcpy(&x, data[j] + i, sizeof(x));
+                c[j] = __crc32d(c[j], x);
+            }
+        }
+        for (; i < size; i++) {
+            for (int j = 0; j < n; j++) {
+                c[j] = __crc32b(c[j], data[j][i]);
+            }
+        }
+        for (int j = 0; j < n; j++) {
+            crcs[j] = ~c[j];
+        }
+    }
+
+    void crc_accel_x2(uint32_t crcs[2], const uint8_t* const data[2], size_t size)
+    {
+        crc_accel_multi(crcs, data, size, 2);
+    }
+
+    void crc_accel_x4(uint32_t crcs[4], const uint8_t* const data[4], size_t size)
     {
-        printf("crc():    accelerated implementation\n");
-        // Dummy CRC instruction, just to demonstrate it is accepted by the compiler.
-        asm("crc32x w8, w8, x8" : : : "x8");
+        crc_accel_multi(crcs, data, size, 4);
     }
 
 #else
 
     const int crc_accel_compiled = 0;
-    void crc_accel()
+    uint32_t crc_accel(uint32_t crc, const void* data, size_t size)
     {
         // Should never be called if the CPU does not support the compilation target of this module;
-        printf("crc():    ACCELERATED IMPLEMENTATION SHOULD NOT GET CALLED !\n");
         assert(0);
+        return 0;
     }
-    
+
+    void crc_accel_x2(uint32_t crcs[2], const uint8_t* const data[2], size_t size)
+    {
+        assert(0);
+    }
+
+    void crc_accel_x4(uint32_t crcs[4], const uint8_t* const data[4], size_t size)
+    {
+        assert(0);
+    }
+
 #endif
@@ -1,10 +1,17 @@
 #if !defined(CRC_ACCEL_H)
 #define CRC_ACCEL_H 1
 
+#include <stdint.h>
+#include <stddef.h>
+
 // Boolean: indicate if this module could be compiled with accelerated instructions.
 extern const int crc_accel_compiled;
 
 // Accelerated CRC function.
-void crc_accel();
+uint32_t crc_accel(uint32_t crc, const void* data, size_t size);
+
+// Accelerated CRC functions on 2 or 4 independent buffers of the same size.
+void crc_accel_x2(uint32_t crcs[2], const uint8_t* const data[2], size_t size);
+void crc_accel_x4(uint32_t crcs[4], const uint8_t* const data[4], size_t size);
 
 #endif // CRC_ACCEL_H
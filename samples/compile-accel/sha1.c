@@ -1,24 +1,83 @@
 #include "sha1.h"
 #include "sha1_accel.h"
-#include "armfeature.h"
-#include <stdio.h>
+#include "armdispatch.h"
+#include "byteorder.h"
+#include <string.h>
 
-static volatile int sha1_accel_checked = 0;
-static volatile int sha1_accel_supported = 0;
+static inline uint32_t rol32(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
 
-void sha1()
+static void sha1_portable(uint32_t state[5], const uint8_t* data, size_t blocks)
 {
-    // Check done once only. No need for multi-thread synchronization.
-    if (!sha1_accel_checked) {
-        sha1_accel_supported = sha1_accel_compiled && armfeature(AT_HWCAP, HWCAP_SHA1, "hw.optional.arm.FEAT_SHA1");
-        sha1_accel_checked = 1;
+    for (; blocks > 0; blocks--, data += SHA1_BLOCK_SIZE) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            w[i] = load_be32(data + 4*i);
+        }
+        for (int i = 16; i < 80; i++) {
+            w[i] = rol32(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            const uint32_t t = rol32(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol32(b, 30);
+            b = a;
+            a = t;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
     }
+}
 
-    // Each time, select accelerated implementation when supported.
-    if (sha1_accel_supported) {
-        sha1_accel();
-    }
-    else {
-        printf("sha1():   portable implementation\n");
+void sha1(const void* data, size_t size, uint8_t digest[SHA1_DIGEST_SIZE])
+{
+    uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    const size_t full = size / SHA1_BLOCK_SIZE;
+    const size_t rest = size % SHA1_BLOCK_SIZE;
+    sha1_blocks(state, data, full);
+
+    // Padding: 0x80, zeroes, 64-bit big-endian size in bits, in one or two blocks.
+    uint8_t last[2 * SHA1_BLOCK_SIZE];
+    const size_t padded = rest < SHA1_BLOCK_SIZE - 8 ? SHA1_BLOCK_SIZE : 2 * SHA1_BLOCK_SIZE;
+    memset(last, 0, sizeof(last));
+    memcpy(last, (const uint8_t*)data + full * SHA1_BLOCK_SIZE, rest);
+    last[rest] = 0x80;
+    store_be64(last + padded - 8, (uint64_t)size * 8);
+    sha1_blocks(state, last, padded / SHA1_BLOCK_SIZE);
+
+    for (int i = 0; i < 5; i++) {
+        store_be32(digest + 4*i, state[i]);
     }
 }
+
+// The implementation is selected once at load time, not on each call.
+static const armdispatch_variant_t sha1_variants[] = {
+    ARMDISPATCH_VARIANT(sha1_accel, &sha1_accel_compiled, ARMDISPATCH_SHA1),
+    ARMDISPATCH_VARIANT(sha1_portable, NULL, 0),
+};
+
+ARMDISPATCH(void, sha1_blocks, (uint32_t state[5], const uint8_t* data, size_t blocks), (state, data, blocks), sha1_variants)
@@ -1,7 +1,16 @@
 #if !defined(SHA1_H)
 #define SHA1_H 1
 
-// Hypothetical SHA-1 function.
-void sha1();
+#include <stdint.h>
+#include <stddef.h>
+
+#define SHA1_BLOCK_SIZE  64
+#define SHA1_DIGEST_SIZE 20
+
+// Compute the SHA-1 hash of a message.
+void sha1(const void* data, size_t size, uint8_t digest[SHA1_DIGEST_SIZE]);
+
+// SHA-1 compression function on complete blocks.
+void sha1_blocks(uint32_t state[5], const uint8_t* data, size_t blocks);
 
 #endif // SHA1_H
@@ -1,25 +1,62 @@
 #include "sha1_accel.h"
 #include <assert.h>
-#include <stdio.h>
 
 #if defined(__ARM_FEATURE_CRYPTO)
 
+    #include <arm_neon.h>
+
     const int sha1_accel_compiled = 1;
-    void sha1_accel()
+    void sha1_accel(uint32_t state[5], const uint8_t* data, size_t blocks)
     {
-        printf("sha1():   accelerated implementation\n");
-        // Dummy SHA-1 instruction, just to demonstrate it is accepted by the compiler.
-        asm("sha1h s8, s8" : : : "s8");
+        static const uint32_t k[4] = {0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6};
+        uint32x4_t abcd = vld1q_u32(state);
+        uint32_t e = state[4];
+
+        for (; blocks > 0; blocks--, data += 64) {
+            const uint32x4_t abcd_saved = abcd;
+            const uint32_t e_saved = e;
+
+            // Message schedule, 4 words per vector, big-endian.
+            uint32x4_t w[4];
+            for (int i = 0; i < 4; i++) {
+                w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16*i)));
+            }
+
+            // 20 groups of 4 rounds.
+            for (int i = 0; i < 20; i++) {
+                const uint32x4_t wk = vaddq_u32(w[i % 4], vdupq_n_u32(k[i / 5]));
+                const uint32_t e_next = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+                if (i < 5) {
+                    abcd = vsha1cq_u32(abcd, e, wk);
+                }
+                else if (i >= 10 && i < 15) {
+                    abcd = vsha1mq_u32(abcd, e, wk);
+                }
+                else {
+                    abcd = vsha1pq_u32(abcd, e, wk);
+                }
+                e = e_next;
+                // Compute the message words for group i+4.
+                if (i < 16) {
+                    w[i % 4] = vsha1su1q_u32(vsha1su0q_u32(w[i % 4], w[(i + 1) % 4], w[(i + 2) % 4]), w[(i + 3) % 4]);
+                }
+            }
+
+            abcd = vaddq_u32(abcd, abcd_saved);
+            e += e_saved;
+        }
+
+        vst1q_u32(state, abcd);
+        state[4] = e;
     }
 
 #else
 
     const int sha1_accel_compiled = 0;
-    void sha1_accel()
+    void sha1_accel(uint32_t state[5], const uint8_t* data, size_t blocks)
     {
         // Should never be called if the CPU does not support the compilation target of this module;
-        printf("sha1():   ACCELERATED IMPLEMENTATION SHOULD NOT GET CALLED !\n");
         assert(0);
     }
-    
+
 #endif
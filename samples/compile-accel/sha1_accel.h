@@ -1,10 +1,13 @@
 #if !defined(SHA1_ACCEL_H)
 #define SHA1_ACCEL_H 1
 
+#include <stdint.h>
+#include <stddef.h>
+
 // Boolean: indicate if this module could be compiled with accelerated instructions.
 extern const int sha1_accel_compiled;
 
-// Accelerated SHA-1 function.
-void sha1_accel();
+// Accelerated SHA-1 compression function.
+void sha1_accel(uint32_t state[5], const uint8_t* data, size_t blocks);
 
 #endif // SHA1_ACCEL_H
@@ -1,24 +1,153 @@
 #include "sha256.h"
 #include "sha256_accel.h"
-#include "armfeature.h"
-#include <stdio.h>
+#include "armdispatch.h"
+#include "byteorder.h"
+#include <string.h>
 
-static volatile int sha256_accel_checked = 0;
-static volatile int sha256_accel_supported = 0;
+const uint32_t sha256_k[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
 
-void sha256()
+static inline uint32_t ror32(uint32_t x, int n)
 {
-    // Check done once only. No need for multi-thread synchronization.
-    if (!sha256_accel_checked) {
-        sha256_accel_supported = sha256_accel_compiled && armfeature(AT_HWCAP, HWCAP_SHA2, "hw.optional.arm.FEAT_SHA256");
-        sha256_accel_checked = 1;
+    return (x >> n) | (x << (32 - n));
+}
+
+static void sha256_portable(uint32_t state[8], const uint8_t* data, size_t blocks)
+{
+    for (; blocks > 0; blocks--, data += SHA256_BLOCK_SIZE) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) {
+            w[i] = load_be32(data + 4*i);
+        }
+        for (int i = 16; i < 64; i++) {
+            const uint32_t s0 = ror32(w[i-15], 7) ^ ror32(w[i-15], 18) ^ (w[i-15] >> 3);
+            const uint32_t s1 = ror32(w[i-2], 17) ^ ror32(w[i-2], 19) ^ (w[i-2] >> 10);
+            w[i] = w[i-16] + s0 + w[i-7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++) {
+            const uint32_t t1 = h + (ror32(e, 6) ^ ror32(e, 11) ^ ror32(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+            const uint32_t t2 = (ror32(a, 2) ^ ror32(a, 13) ^ ror32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+// Without SHA-256 instructions, there is no pipeline to fill, one stream after the other.
+static void sha256_portable_x2(uint32_t state[2][8], const uint8_t* const data[2], size_t blocks)
+{
+    for (int j = 0; j < 2; j++) {
+        sha256_portable(state[j], data[j], blocks);
     }
+}
+
+static void sha256_portable_x4(uint32_t state[4][8], const uint8_t* const data[4], size_t blocks)
+{
+    for (int j = 0; j < 4; j++) {
+        sha256_portable(state[j], data[j], blocks);
+    }
+}
+
+static const uint32_t sha256_init[8] = {0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
 
-    // Each time, select accelerated implementation when supported.
-    if (sha256_accel_supported) {
-        sha256_accel();
+// Process the end of a message, starting at byte offset 'done', a multiple of the block size.
+static void sha256_final(uint32_t state[8], const uint8_t* data, size_t size, size_t done, uint8_t digest[SHA256_DIGEST_SIZE])
+{
+    const size_t full = size / SHA256_BLOCK_SIZE;
+    const size_t rest = size % SHA256_BLOCK_SIZE;
+    sha256_blocks(state, data + done, full - done / SHA256_BLOCK_SIZE);
+
+    // Padding: 0x80, zeroes, 64-bit big-endian size in bits, in one or two blocks.
+    uint8_t last[2 * SHA256_BLOCK_SIZE];
+    const size_t padded = rest < SHA256_BLOCK_SIZE - 8 ? SHA256_BLOCK_SIZE : 2 * SHA256_BLOCK_SIZE;
+    memset(last, 0, sizeof(last));
+    memcpy(last, data + full * SHA256_BLOCK_SIZE, rest);
+    last[rest] = 0x80;
+    store_be64(last + padded - 8, (uint64_t)size * 8);
+    sha256_blocks(state, last, padded / SHA256_BLOCK_SIZE);
+
+    for (int i = 0; i < 8; i++) {
+        store_be32(digest + 4*i, state[i]);
     }
-    else {
-        printf("sha256(): portable implementation\n");
+}
+
+void sha256(const void* data, size_t size, uint8_t digest[SHA256_DIGEST_SIZE])
+{
+    uint32_t state[8];
+    memcpy(state, sha256_init, sizeof(state));
+    sha256_final(state, data, size, 0, digest);
+}
+
+void sha256_multi(const void* const data[], const size_t sizes[], uint8_t digests[][SHA256_DIGEST_SIZE], size_t count)
+{
+    // Groups of 4, then 2 messages. The common number of blocks is interleaved, the rest of each
+    // message is processed alone. Messages of similar sizes should be consecutive for better efficiency.
+    for (size_t i = 0; i < count; ) {
+        const size_t n = count - i >= 4 ? 4 : (count - i >= 2 ? 2 : 1);
+        uint32_t state[4][8];
+        const uint8_t* ptr[4];
+        size_t blocks = sizes[i] / SHA256_BLOCK_SIZE;
+        for (size_t j = 0; j < n; j++) {
+            memcpy(state[j], sha256_init, sizeof(state[j]));
+            ptr[j] = data[i + j];
+            blocks = sizes[i + j] / SHA256_BLOCK_SIZE < blocks ? sizes[i + j] / SHA256_BLOCK_SIZE : blocks;
+        }
+        if (n == 4) {
+            sha256_blocks_x4(state, ptr, blocks);
+        }
+        else if (n == 2) {
+            sha256_blocks_x2(state, ptr, blocks);
+        }
+        else {
+            blocks = 0;
+        }
+        for (size_t j = 0; j < n; j++) {
+            sha256_final(state[j], ptr[j], sizes[i + j], blocks * SHA256_BLOCK_SIZE, digests[i + j]);
+        }
+        i += n;
     }
 }
+
+// The implementation is selected once at load time, not on each call.
+static const armdispatch_variant_t sha256_variants[] = {
+    ARMDISPATCH_VARIANT(sha256_accel, &sha256_accel_compiled, ARMDISPATCH_SHA256),
+    ARMDISPATCH_VARIANT(sha256_portable, NULL, 0),
+};
+
+static const armdispatch_variant_t sha256_x2_variants[] = {
+    ARMDISPATCH_VARIANT(sha256_accel_x2, &sha256_accel_compiled, ARMDISPATCH_SHA256),
+    ARMDISPATCH_VARIANT(sha256_portable_x2, NULL, 0),
+};
+
+static const armdispatch_variant_t sha256_x4_variants[] = {
+    ARMDISPATCH_VARIANT(sha256_accel_x4, &sha256_accel_compiled, ARMDISPATCH_SHA256),
+    ARMDISPATCH_VARIANT(sha256_portable_x4, NULL, 0),
+};
+
+ARMDISPATCH(void, sha256_blocks, (uint32_t state[8], const uint8_t* data, size_t blocks), (state, data, blocks), sha256_variants)
+ARMDISPATCH(void, sha256_blocks_x2, (uint32_t state[2][8], const uint8_t* const data[2], size_t blocks), (state, data, blocks), sha256_x2_variants)
+ARMDISPATCH(void, sha256_blocks_x4, (uint32_t state[4][8], const uint8_t* const data[4], size_t blocks), (state, data, blocks), sha256_x4_variants)
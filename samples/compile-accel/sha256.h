@@ -1,7 +1,27 @@
 #if !defined(SHA256_H)
 #define SHA256_H 1
 
-// Hypothetical SHA-256 function.
-void sha256();
+#include <stdint.h>
+#include <stddef.h>
+
+#define SHA256_BLOCK_SIZE  64
+#define SHA256_DIGEST_SIZE 32
+
+// Compute the SHA-256 hash of a message.
+void sha256(const void* data, size_t size, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+// SHA-256 compression function on complete blocks.
+void sha256_blocks(uint32_t state[8], const uint8_t* data, size_t blocks);
+
+// Compute the SHA-256 hash of several independent messages, interleaving the
+// computations to fill the pipeline of the SHA-256 instructions.
+void sha256_multi(const void* const data[], const size_t sizes[], uint8_t digests[][SHA256_DIGEST_SIZE], size_t count);
+
+// SHA-256 compression function on 2 or 4 independent streams of the same number of blocks.
+void sha256_blocks_x2(uint32_t state[2][8], const uint8_t* const data[2], size_t blocks);
+void sha256_blocks_x4(uint32_t state[4][8], const uint8_t* const data[4], size_t blocks);
+
+// Round constants, shared by all implementations.
+extern const uint32_t sha256_k[64];
 
 #endif // SHA256_H
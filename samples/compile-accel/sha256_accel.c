@@ -1,25 +1,116 @@
 #include "sha256_accel.h"
+#include "sha256.h"
 #include <assert.h>
-#include <stdio.h>
 
 #if defined(__ARM_FEATURE_SHA2)
 
+    #include <arm_neon.h>
+
     const int sha256_accel_compiled = 1;
-    void sha256_accel()
+    void sha256_accel(uint32_t state[8], const uint8_t* data, size_t blocks)
+    {
+        uint32x4_t abcd = vld1q_u32(state);
+        uint32x4_t efgh = vld1q_u32(state + 4);
+
+        for (; blocks > 0; blocks--, data += SHA256_BLOCK_SIZE) {
+            const uint32x4_t abcd_saved = abcd;
+            const uint32x4_t efgh_saved = efgh;
+
+            // Message schedule, 4 words per vector, big-endian.
+            uint32x4_t w[4];
+            for (int i = 0; i < 4; i++) {
+                w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16*i)));
+            }
+
+            // 16 groups of 4 rounds.
+            for (int i = 0; i < 16; i++) {
+                const uint32x4_t wk = vaddq_u32(w[i % 4], vld1q_u32(sha256_k + 4*i));
+                const uint32x4_t tmp = abcd;
+                abcd = vsha256hq_u32(abcd, efgh, wk);
+                efgh = vsha256h2q_u32(efgh, tmp, wk);
+                // Compute the message words for group i+4.
+                if (i < 12) {
+                    w[i % 4] = vsha256su1q_u32(vsha256su0q_u32(w[i % 4], w[(i + 1) % 4]), w[(i + 2) % 4], w[(i + 3) % 4]);
+                }
+            }
+
+            abcd = vaddq_u32(abcd, abcd_saved);
+            efgh = vaddq_u32(efgh, efgh_saved);
+        }
+
+        vst1q_u32(state, abcd);
+        vst1q_u32(state + 4, efgh);
+    }
+
+    // Interleave the rounds of n independent streams. The SHA256H instructions of one stream
+    // depend on each other, the CPU can execute the instructions of other streams meanwhile.
+    // The saved state is reloaded from memory after each block to limit the register pressure.
+    static inline __attribute__((always_inline)) void sha256_accel_multi(uint32_t state[][8], const uint8_t* const data[], size_t blocks, const int n)
     {
-        printf("sha256(): accelerated implementation\n");
-        // Dummy SHA-256 instruction, just to demonstrate it is accepted by the compiler.
-        asm("sha256su0 v8.4S, v8.4S" : : : "v8");
+        uint32x4_t abcd[4], efgh[4], w[4][4];
+        for (int j = 0; j < n; j++) {
+            abcd[j] = vld1q_u32(state[j]);
+            efgh[j] = vld1q_u32(state[j] + 4);
+        }
+
+        for (size_t b = 0; b < blocks; b++) {
+            for (int j = 0; j < n; j++) {
+                for (int i = 0; i < 4; i++) {
+                    w[j][i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data[j] + b * SHA256_BLOCK_SIZE + 16*i)));
+                }
+            }
+
+            #pragma GCC unroll 16
+            for (int i = 0; i < 16; i++) {
+                const uint32x4_t k = vld1q_u32(sha256_k + 4*i);
+                #pragma GCC unroll 4
+                for (int j = 0; j < n; j++) {
+                    const uint32x4_t wk = vaddq_u32(w[j][i % 4], k);
+                    const uint32x4_t tmp = abcd[j];
+                    abcd[j] = vsha256hq_u32(abcd[j], efgh[j], wk);
+                    efgh[j] = vsha256h2q_u32(efgh[j], tmp, wk);
+                    if (i < 12) {
+                        w[j][i % 4] = vsha256su1q_u32(vsha256su0q_u32(w[j][i % 4], w[j][(i + 1) % 4]), w[j][(i + 2) % 4], w[j][(i + 3) % 4]);
+                    }
+                }
+            }
+
+            for (int j = 0; j < n; j++) {
+                abcd[j] = vaddq_u32(abcd[j], vld1q_u32(state[j]));
+                efgh[j] = vaddq_u32(efgh[j], vld1q_u32(state[j] + 4));
+                vst1q_u32(state[j], abcd[j]);
+                vst1q_u32(state[j] + 4, efgh[j]);
+            }
+        }
+    }
+
+    void sha256_accel_x2(uint32_t state[2][8], const uint8_t* const data[2], size_t blocks)
+    {
+        sha256_accel_multi(state, data, blocks, 2);
+    }
+
+    void sha256_accel_x4(uint32_t state[4][8], const uint8_t* const data[4], size_t blocks)
+    {
+        sha256_accel_multi(state, data, blocks, 4);
     }
 
 #else
 
     const int sha256_accel_compiled = 0;
-    void sha256_accel()
+    void sha256_accel(uint32_t state[8], const uint8_t* data, size_t blocks)
     {
         // Should never be called if the CPU does not support the compilation target of this module;
-        printf("sha256(): ACCELERATED IMPLEMENTATION SHOULD NOT GET CALLED !\n");
         assert(0);
     }
-    
+
+    void sha256_accel_x2(uint32_t state[2][8], const uint8_t* const data[2], size_t blocks)
+    {
+        assert(0);
+    }
+
+    void sha256_accel_x4(uint32_t state[4][8], const uint8_t* const data[4], size_t blocks)
+    {
+        assert(0);
+    }
+
 #endif
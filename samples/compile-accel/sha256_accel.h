@@ -1,10 +1,17 @@
 #if !defined(SHA256_ACCEL_H)
 #define SHA256_ACCEL_H 1
 
+#include <stdint.h>
+#include <stddef.h>
+
 // Boolean: indicate if this module could be compiled with accelerated instructions.
 extern const int sha256_accel_compiled;
 
-// Accelerated SHA-256 function.
-void sha256_accel();
+// Accelerated SHA-256 compression function.
+void sha256_accel(uint32_t state[8], const uint8_t* data, size_t blocks);
+
+// Accelerated SHA-256 compression functions on 2 or 4 independent streams.
+void sha256_accel_x2(uint32_t state[2][8], const uint8_t* const data[2], size_t blocks);
+void sha256_accel_x4(uint32_t state[4][8], const uint8_t* const data[4], size_t blocks);
 
 #endif // SHA256_ACCEL_H
@@ -1,24 +1,140 @@
 #include "sha3.h"
 #include "sha3_accel.h"
-#include "armfeature.h"
-#include <stdio.h>
+#include "sha3_sve.h"
+#include "armdispatch.h"
+#include "byteorder.h"
+#include <string.h>
 
-static volatile int sha3_accel_checked = 0;
-static volatile int sha3_accel_supported = 0;
+const uint64_t sha3_rc[24] = {
+    0x0000000000000001, 0x0000000000008082, 0x800000000000808A, 0x8000000080008000,
+    0x000000000000808B, 0x0000000080000001, 0x8000000080008081, 0x8000000000008009,
+    0x000000000000008A, 0x0000000000000088, 0x0000000080008009, 0x000000008000000A,
+    0x000000008000808B, 0x800000000000008B, 0x8000000000008089, 0x8000000000008003,
+    0x8000000000008002, 0x8000000000000080, 0x000000000000800A, 0x800000008000000A,
+    0x8000000080008081, 0x8000000000008080, 0x0000000080000001, 0x8000000080008008,
+};
 
-void sha3()
+// Rotations and destination lanes of the rho and pi steps, in the order of the pi cycle.
+static const int sha3_rotc[24] = {1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14, 27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44};
+static const int sha3_piln[24] = {10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4, 15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1};
+
+static inline uint64_t rol64(uint64_t x, int n)
+{
+    return (x << n) | (x >> (64 - n));
+}
+
+static void sha3_permute(uint64_t a[25])
 {
-    // Check done once only. No need for multi-thread synchronization.
-    if (!sha3_accel_checked) {
-        sha3_accel_supported = sha3_accel_compiled && armfeature(AT_HWCAP, HWCAP_SHA3, "hw.optional.arm.FEAT_SHA3");
-        sha3_accel_checked = 1;
+    uint64_t c[5];
+    for (int r = 0; r < 24; r++) {
+        // Theta.
+        for (int x = 0; x < 5; x++) {
+            c[x] = a[x] ^ a[x+5] ^ a[x+10] ^ a[x+15] ^ a[x+20];
+        }
+        for (int x = 0; x < 5; x++) {
+            const uint64_t d = c[(x + 4) % 5] ^ rol64(c[(x + 1) % 5], 1);
+            for (int y = 0; y < 25; y += 5) {
+                a[y+x] ^= d;
+            }
+        }
+        // Rho and pi.
+        uint64_t t = a[1];
+        for (int i = 0; i < 24; i++) {
+            const uint64_t next = a[sha3_piln[i]];
+            a[sha3_piln[i]] = rol64(t, sha3_rotc[i]);
+            t = next;
+        }
+        // Chi.
+        for (int y = 0; y < 25; y += 5) {
+            for (int x = 0; x < 5; x++) {
+                c[x] = a[y+x];
+            }
+            for (int x = 0; x < 5; x++) {
+                a[y+x] = c[x] ^ (~c[(x + 1) % 5] & c[(x + 2) % 5]);
+            }
+        }
+        // Iota.
+        a[0] ^= sha3_rc[r];
     }
+}
 
-    // Each time, select accelerated implementation when supported.
-    if (sha3_accel_supported) {
-        sha3_accel();
+static void sha3_portable(uint64_t state[25], const uint8_t* data, size_t blocks)
+{
+    for (; blocks > 0; blocks--, data += SHA3_BLOCK_SIZE) {
+        for (int i = 0; i < SHA3_BLOCK_SIZE / 8; i++) {
+            state[i] ^= load_le64(data + 8*i);
+        }
+        sha3_permute(state);
     }
-    else {
-        printf("sha3():   portable implementation\n");
+}
+
+// Without SVE, one state after the other, using the best single-state implementation.
+static void sha3_portable_multi(uint64_t state[][25], const uint8_t* const data[], size_t blocks, size_t count)
+{
+    for (size_t j = 0; j < count; j++) {
+        sha3_blocks(state[j], data[j], blocks);
     }
 }
+
+// Process the end of a message, starting at byte offset 'done', a multiple of the block size.
+static void sha3_final(uint64_t state[25], const uint8_t* data, size_t size, size_t done, uint8_t digest[SHA3_DIGEST_SIZE])
+{
+    const size_t full = size / SHA3_BLOCK_SIZE;
+    const size_t rest = size % SHA3_BLOCK_SIZE;
+    sha3_blocks(state, data + done, full - done / SHA3_BLOCK_SIZE);
+
+    // Padding: SHA-3 domain bits 01, then pad10*1, in one block.
+    uint8_t last[SHA3_BLOCK_SIZE];
+    memset(last, 0, sizeof(last));
+    memcpy(last, data + full * SHA3_BLOCK_SIZE, rest);
+    last[rest] = 0x06;
+    last[SHA3_BLOCK_SIZE - 1] |= 0x80;
+    sha3_blocks(state, last, 1);
+
+    for (int i = 0; i < SHA3_DIGEST_SIZE / 8; i++) {
+        store_le64(digest + 8*i, state[i]);
+    }
+}
+
+void sha3(const void* data, size_t size, uint8_t digest[SHA3_DIGEST_SIZE])
+{
+    uint64_t state[25];
+    memset(state, 0, sizeof(state));
+    sha3_final(state, data, size, 0, digest);
+}
+
+void sha3_multi(const void* const data[], const size_t sizes[], uint8_t digests[][SHA3_DIGEST_SIZE], size_t count)
+{
+    // Groups of up to 32 messages, enough for the longest SVE vectors.
+    // The common number of blocks is absorbed in parallel, the rest of each message alone.
+    for (size_t i = 0; i < count; ) {
+        const size_t n = count - i < 32 ? count - i : 32;
+        uint64_t state[32][25];
+        const uint8_t* ptr[32];
+        size_t blocks = sizes[i] / SHA3_BLOCK_SIZE;
+        memset(state, 0, n * sizeof(state[0]));
+        for (size_t j = 0; j < n; j++) {
+            ptr[j] = data[i + j];
+            blocks = sizes[i + j] / SHA3_BLOCK_SIZE < blocks ? sizes[i + j] / SHA3_BLOCK_SIZE : blocks;
+        }
+        sha3_blocks_multi(state, ptr, blocks, n);
+        for (size_t j = 0; j < n; j++) {
+            sha3_final(state[j], ptr[j], sizes[i + j], blocks * SHA3_BLOCK_SIZE, digests[i + j]);
+        }
+        i += n;
+    }
+}
+
+// The implementation is selected once at load time, not on each call.
+static const armdispatch_variant_t sha3_variants[] = {
+    ARMDISPATCH_VARIANT(sha3_accel, &sha3_accel_compiled, ARMDISPATCH_SHA3),
+    ARMDISPATCH_VARIANT(sha3_portable, NULL, 0),
+};
+
+static const armdispatch_variant_t sha3_multi_variants[] = {
+    ARMDISPATCH_VARIANT(sha3_sve_multi, &sha3_sve_compiled, ARMDISPATCH_SVE2 | ARMDISPATCH_SVE_SHA3),
+    ARMDISPATCH_VARIANT(sha3_portable_multi, NULL, 0),
+};
+
+ARMDISPATCH(void, sha3_blocks, (uint64_t state[25], const uint8_t* data, size_t blocks), (state, data, blocks), sha3_variants)
+ARMDISPATCH(void, sha3_blocks_multi, (uint64_t state[][25], const uint8_t* const data[], size_t blocks, size_t count), (state, data, blocks, count), sha3_multi_variants)
@@ -1,7 +1,27 @@
 #if !defined(SHA3_H)
 #define SHA3_H 1
 
-// Hypothetical SHA-3 function.
-void sha3();
+#include <stdint.h>
+#include <stddef.h>
+
+// SHA3-256 parameters: the block size is the rate of the sponge.
+#define SHA3_BLOCK_SIZE  136
+#define SHA3_DIGEST_SIZE 32
+
+// Compute the SHA3-256 hash of a message.
+void sha3(const void* data, size_t size, uint8_t digest[SHA3_DIGEST_SIZE]);
+
+// Absorb complete blocks in the Keccak state, with one Keccak-f[1600] permutation per block.
+void sha3_blocks(uint64_t state[25], const uint8_t* data, size_t blocks);
+
+// Compute the SHA3-256 hash of several independent messages, the common
+// number of blocks of all messages is absorbed in parallel.
+void sha3_multi(const void* const data[], const size_t sizes[], uint8_t digests[][SHA3_DIGEST_SIZE], size_t count);
+
+// Absorb the same number of complete blocks in several independent Keccak states.
+void sha3_blocks_multi(uint64_t state[][25], const uint8_t* const data[], size_t blocks, size_t count);
+
+// Round constants, shared by all implementations.
+extern const uint64_t sha3_rc[24];
 
 #endif // SHA3_H
@@ -1,25 +1,82 @@
 #include "sha3_accel.h"
+#include "sha3.h"
+#include "byteorder.h"
 #include <assert.h>
-#include <stdio.h>
 
 #if defined(__ARM_FEATURE_SHA3)
 
+    #include <arm_neon.h>
+
     const int sha3_accel_compiled = 1;
-    void sha3_accel()
+    void sha3_accel(uint64_t state[25], const uint8_t* data, size_t blocks)
     {
-        printf("sha3():   accelerated implementation\n");
-        // Dummy SHA-3 instruction, just to demonstrate it is accepted by the compiler.
-        asm("eor3 v8.16B, v8.16B, v8.16B, v8.16B" : : : "v8");
+        // One Keccak lane per vector register, only lane 0 is significant.
+        uint64x2_t a[25], b[25], c[5], d[5];
+        for (int i = 0; i < 25; i++) {
+            a[i] = vdupq_n_u64(state[i]);
+        }
+
+        for (; blocks > 0; blocks--, data += SHA3_BLOCK_SIZE) {
+            for (int i = 0; i < SHA3_BLOCK_SIZE / 8; i++) {
+                a[i] = veorq_u64(a[i], vdupq_n_u64(load_le64(data + 8*i)));
+            }
+            for (int r = 0; r < 24; r++) {
+                // Theta: EOR3 computes the column parities, RAX1 = XOR with rotate by 1.
+                for (int x = 0; x < 5; x++) {
+                    c[x] = veor3q_u64(veor3q_u64(a[x], a[x+5], a[x+10]), a[x+15], a[x+20]);
+                }
+                for (int x = 0; x < 5; x++) {
+                    d[x] = vrax1q_u64(c[(x + 4) % 5], c[(x + 1) % 5]);
+                }
+                // Theta, rho and pi: XAR = XOR and rotate right, immediate operand.
+                b[0] = veorq_u64(a[0], d[0]);
+                b[1] = vxarq_u64(a[6], d[1], 20);
+                b[2] = vxarq_u64(a[12], d[2], 21);
+                b[3] = vxarq_u64(a[18], d[3], 43);
+                b[4] = vxarq_u64(a[24], d[4], 50);
+                b[5] = vxarq_u64(a[3], d[3], 36);
+                b[6] = vxarq_u64(a[9], d[4], 44);
+                b[7] = vxarq_u64(a[10], d[0], 61);
+                b[8] = vxarq_u64(a[16], d[1], 19);
+                b[9] = vxarq_u64(a[22], d[2], 3);
+                b[10] = vxarq_u64(a[1], d[1], 63);
+                b[11] = vxarq_u64(a[7], d[2], 58);
+                b[12] = vxarq_u64(a[13], d[3], 39);
+                b[13] = vxarq_u64(a[19], d[4], 56);
+                b[14] = vxarq_u64(a[20], d[0], 46);
+                b[15] = vxarq_u64(a[4], d[4], 37);
+                b[16] = vxarq_u64(a[5], d[0], 28);
+                b[17] = vxarq_u64(a[11], d[1], 54);
+                b[18] = vxarq_u64(a[17], d[2], 49);
+                b[19] = vxarq_u64(a[23], d[3], 8);
+                b[20] = vxarq_u64(a[2], d[2], 2);
+                b[21] = vxarq_u64(a[8], d[3], 9);
+                b[22] = vxarq_u64(a[14], d[4], 25);
+                b[23] = vxarq_u64(a[15], d[0], 23);
+                b[24] = vxarq_u64(a[21], d[1], 62);
+                // Chi: BCAX = bit clear and XOR.
+                for (int y = 0; y < 25; y += 5) {
+                    for (int x = 0; x < 5; x++) {
+                        a[y+x] = vbcaxq_u64(b[y+x], b[y + (x + 2) % 5], b[y + (x + 1) % 5]);
+                    }
+                }
+                // Iota.
+                a[0] = veorq_u64(a[0], vdupq_n_u64(sha3_rc[r]));
+            }
+        }
+
+        for (int i = 0; i < 25; i++) {
+            state[i] = vgetq_lane_u64(a[i], 0);
+        }
     }
 
 #else
 
     const int sha3_accel_compiled = 0;
-    void sha3_accel()
+    void sha3_accel(uint64_t state[25], const uint8_t* data, size_t blocks)
     {
         // Should never be called if the CPU does not support the compilation target of this module;
-        printf("sha3():   ACCELERATED IMPLEMENTATION SHOULD NOT GET CALLED !\n");
         assert(0);
     }
-    
+
 #endif
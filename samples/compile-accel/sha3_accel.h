@@ -1,10 +1,13 @@
 #if !defined(SHA3_ACCEL_H)
 #define SHA3_ACCEL_H 1
 
+#include <stdint.h>
+#include <stddef.h>
+
 // Boolean: indicate if this module could be compiled with accelerated instructions.
 extern const int sha3_accel_compiled;
 
-// Accelerated SHA-1 function.
-void sha3_accel();
+// Accelerated SHA-3 absorb function.
+void sha3_accel(uint64_t state[25], const uint8_t* data, size_t blocks);
 
 #endif // SHA3_ACCEL_H
@@ -0,0 +1,93 @@
+#include "sha3_sve.h"
+#include "sha3.h"
+#include <assert.h>
+
+#if defined(__ARM_FEATURE_SVE2_SHA3)
+
+    #include <arm_sve.h>
+
+    const int sha3_sve_compiled = 1;
+    void sha3_sve_multi(uint64_t state[][25], const uint8_t* const data[], size_t blocks, size_t count)
+    {
+        // Vector-length agnostic: one Keccak state per 64-bit lane, svcntd() states at a time.
+        // The last group of states is partial, the predicate excludes the missing ones.
+        const svuint64_t index = svindex_u64(0, 25);
+
+        for (size_t first = 0; first < count; first += svcntd()) {
+            const svbool_t pg = svwhilelt_b64_u64(first, count);
+            uint64_t* const st = state[first];
+            svuint64_t a[25], b[25], c[5], d[5];
+
+            // Load lane i of all states, 25 words apart.
+            for (int i = 0; i < 25; i++) {
+                a[i] = svld1_gather_u64index_u64(pg, st + i, index);
+            }
+
+            // Addresses of the input streams, as 64-bit lanes.
+            const svuint64_t ptr = svld1_u64(pg, (const uint64_t*)(data + first));
+
+            for (size_t blk = 0; blk < blocks; blk++) {
+                for (int i = 0; i < SHA3_BLOCK_SIZE / 8; i++) {
+                    a[i] = sveor_u64_x(pg, a[i], svld1_gather_u64base_offset_u64(pg, ptr, (int64_t)(blk * SHA3_BLOCK_SIZE + 8*i)));
+                }
+                for (int r = 0; r < 24; r++) {
+                    // Theta: EOR3 computes the column parities, RAX1 = XOR with rotate by 1.
+                    for (int x = 0; x < 5; x++) {
+                        c[x] = sveor3_u64(sveor3_u64(a[x], a[x+5], a[x+10]), a[x+15], a[x+20]);
+                    }
+                    for (int x = 0; x < 5; x++) {
+                        d[x] = svrax1_u64(c[(x + 4) % 5], c[(x + 1) % 5]);
+                    }
+                    // Theta, rho and pi: XAR = XOR and rotate right, immediate operand.
+                    b[0] = sveor_u64_x(pg, a[0], d[0]);
+                    b[1] = svxar_n_u64(a[6], d[1], 20);
+                    b[2] = svxar_n_u64(a[12], d[2], 21);
+                    b[3] = svxar_n_u64(a[18], d[3], 43);
+                    b[4] = svxar_n_u64(a[24], d[4], 50);
+                    b[5] = svxar_n_u64(a[3], d[3], 36);
+                    b[6] = svxar_n_u64(a[9], d[4], 44);
+                    b[7] = svxar_n_u64(a[10], d[0], 61);
+                    b[8] = svxar_n_u64(a[16], d[1], 19);
+                    b[9] = svxar_n_u64(a[22], d[2], 3);
+                    b[10] = svxar_n_u64(a[1], d[1], 63);
+                    b[11] = svxar_n_u64(a[7], d[2], 58);
+                    b[12] = svxar_n_u64(a[13], d[3], 39);
+                    b[13] = svxar_n_u64(a[19], d[4], 56);
+                    b[14] = svxar_n_u64(a[20], d[0], 46);
+                    b[15] = svxar_n_u64(a[4], d[4], 37);
+                    b[16] = svxar_n_u64(a[5], d[0], 28);
+                    b[17] = svxar_n_u64(a[11], d[1], 54);
+                    b[18] = svxar_n_u64(a[17], d[2], 49);
+                    b[19] = svxar_n_u64(a[23], d[3], 8);
+                    b[20] = svxar_n_u64(a[2], d[2], 2);
+                    b[21] = svxar_n_u64(a[8], d[3], 9);
+                    b[22] = svxar_n_u64(a[14], d[4], 25);
+                    b[23] = svxar_n_u64(a[15], d[0], 23);
+                    b[24] = svxar_n_u64(a[21], d[1], 62);
+                    // Chi: BCAX = bit clear and XOR.
+                    for (int y = 0; y < 25; y += 5) {
+                        for (int x = 0; x < 5; x++) {
+                            a[y+x] = svbcax_u64(b[y+x], b[y + (x + 2) % 5], b[y + (x + 1) % 5]);
+                        }
+                    }
+                    // Iota.
+                    a[0] = sveor_n_u64_x(pg, a[0], sha3_rc[r]);
+                }
+            }
+
+            for (int i = 0; i < 25; i++) {
+                svst1_scatter_u64index_u64(pg, st + i, index, a[i]);
+            }
+        }
+    }
+
+#else
+
+    const int sha3_sve_compiled = 0;
+    void sha3_sve_multi(uint64_t state[][25], const uint8_t* const data[], size_t blocks, size_t count)
+    {
+        // Should never be called if the CPU does not support the compilation target of this module;
+        assert(0);
+    }
+
+#endif
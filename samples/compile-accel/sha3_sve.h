@@ -0,0 +1,13 @@
+#if !defined(SHA3_SVE_H)
+#define SHA3_SVE_H 1
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Boolean: indicate if this module could be compiled with accelerated instructions.
+extern const int sha3_sve_compiled;
+
+// Absorb blocks in several independent Keccak states using SVE2 SHA-3 instructions, one state per 64-bit lane.
+void sha3_sve_multi(uint64_t state[][25], const uint8_t* const data[], size_t blocks, size_t count);
+
+#endif // SHA3_SVE_H
@@ -1,24 +1,103 @@
 #include "sha512.h"
 #include "sha512_accel.h"
-#include "armfeature.h"
-#include <stdio.h>
+#include "armdispatch.h"
+#include "byteorder.h"
+#include <string.h>
 
-static volatile int sha512_accel_checked = 0;
-static volatile int sha512_accel_supported = 0;
+const uint64_t sha512_k[80] = {
+    0x428A2F98D728AE22, 0x7137449123EF65CD, 0xB5C0FBCFEC4D3B2F, 0xE9B5DBA58189DBBC,
+    0x3956C25BF348B538, 0x59F111F1B605D019, 0x923F82A4AF194F9B, 0xAB1C5ED5DA6D8118,
+    0xD807AA98A3030242, 0x12835B0145706FBE, 0x243185BE4EE4B28C, 0x550C7DC3D5FFB4E2,
+    0x72BE5D74F27B896F, 0x80DEB1FE3B1696B1, 0x9BDC06A725C71235, 0xC19BF174CF692694,
+    0xE49B69C19EF14AD2, 0xEFBE4786384F25E3, 0x0FC19DC68B8CD5B5, 0x240CA1CC77AC9C65,
+    0x2DE92C6F592B0275, 0x4A7484AA6EA6E483, 0x5CB0A9DCBD41FBD4, 0x76F988DA831153B5,
+    0x983E5152EE66DFAB, 0xA831C66D2DB43210, 0xB00327C898FB213F, 0xBF597FC7BEEF0EE4,
+    0xC6E00BF33DA88FC2, 0xD5A79147930AA725, 0x06CA6351E003826F, 0x142929670A0E6E70,
+    0x27B70A8546D22FFC, 0x2E1B21385C26C926, 0x4D2C6DFC5AC42AED, 0x53380D139D95B3DF,
+    0x650A73548BAF63DE, 0x766A0ABB3C77B2A8, 0x81C2C92E47EDAEE6, 0x92722C851482353B,
+    0xA2BFE8A14CF10364, 0xA81A664BBC423001, 0xC24B8B70D0F89791, 0xC76C51A30654BE30,
+    0xD192E819D6EF5218, 0xD69906245565A910, 0xF40E35855771202A, 0x106AA07032BBD1B8,
+    0x19A4C116B8D2D0C8, 0x1E376C085141AB53, 0x2748774CDF8EEB99, 0x34B0BCB5E19B48A8,
+    0x391C0CB3C5C95A63, 0x4ED8AA4AE3418ACB, 0x5B9CCA4F7763E373, 0x682E6FF3D6B2B8A3,
+    0x748F82EE5DEFB2FC, 0x78A5636F43172F60, 0x84C87814A1F0AB72, 0x8CC702081A6439EC,
+    0x90BEFFFA23631E28, 0xA4506CEBDE82BDE9, 0xBEF9A3F7B2C67915, 0xC67178F2E372532B,
+    0xCA273ECEEA26619C, 0xD186B8C721C0C207, 0xEADA7DD6CDE0EB1E, 0xF57D4F7FEE6ED178,
+    0x06F067AA72176FBA, 0x0A637DC5A2C898A6, 0x113F9804BEF90DAE, 0x1B710B35131C471B,
+    0x28DB77F523047D84, 0x32CAAB7B40C72493, 0x3C9EBE0A15C9BEBC, 0x431D67C49C100D4C,
+    0x4CC5D4BECB3E42B6, 0x597F299CFC657E2A, 0x5FCB6FAB3AD6FAEC, 0x6C44198C4A475817,
+};
 
-void sha512()
+static inline uint64_t ror64(uint64_t x, int n)
 {
-    // Check done once only. No need for multi-thread synchronization.
-    if (!sha512_accel_checked) {
-        sha512_accel_supported = sha512_accel_compiled && armfeature(AT_HWCAP, HWCAP_SHA512, "hw.optional.arm.FEAT_SHA512");
-        sha512_accel_checked = 1;
-    }
+    return (x >> n) | (x << (64 - n));
+}
 
-    // Each time, select accelerated implementation when supported.
-    if (sha512_accel_supported) {
-        sha512_accel();
+static void sha512_portable(uint64_t state[8], const uint8_t* data, size_t blocks)
+{
+    for (; blocks > 0; blocks--, data += SHA512_BLOCK_SIZE) {
+        uint64_t w[80];
+        for (int i = 0; i < 16; i++) {
+            w[i] = load_be64(data + 8*i);
+        }
+        for (int i = 16; i < 80; i++) {
+            const uint64_t s0 = ror64(w[i-15], 1) ^ ror64(w[i-15], 8) ^ (w[i-15] >> 7);
+            const uint64_t s1 = ror64(w[i-2], 19) ^ ror64(w[i-2], 61) ^ (w[i-2] >> 6);
+            w[i] = w[i-16] + s0 + w[i-7] + s1;
+        }
+        uint64_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint64_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 80; i++) {
+            const uint64_t t1 = h + (ror64(e, 14) ^ ror64(e, 18) ^ ror64(e, 41)) + ((e & f) ^ (~e & g)) + sha512_k[i] + w[i];
+            const uint64_t t2 = (ror64(a, 28) ^ ror64(a, 34) ^ ror64(a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
     }
-    else {
-        printf("sha512(): portable implementation\n");
+}
+
+void sha512(const void* data, size_t size, uint8_t digest[SHA512_DIGEST_SIZE])
+{
+    uint64_t state[8] = {
+        0x6A09E667F3BCC908, 0xBB67AE8584CAA73B, 0x3C6EF372FE94F82B, 0xA54FF53A5F1D36F1,
+        0x510E527FADE682D1, 0x9B05688C2B3E6C1F, 0x1F83D9ABFB41BD6B, 0x5BE0CD19137E2179,
+    };
+    const size_t full = size / SHA512_BLOCK_SIZE;
+    const size_t rest = size % SHA512_BLOCK_SIZE;
+    sha512_blocks(state, data, full);
+
+    // Padding: 0x80, zeroes, 128-bit big-endian size in bits, in one or two blocks.
+    uint8_t last[2 * SHA512_BLOCK_SIZE];
+    const size_t padded = rest < SHA512_BLOCK_SIZE - 16 ? SHA512_BLOCK_SIZE : 2 * SHA512_BLOCK_SIZE;
+    memset(last, 0, sizeof(last));
+    memcpy(last, (const uint8_t*)data + full * SHA512_BLOCK_SIZE, rest);
+    last[rest] = 0x80;
+    store_be64(last + padded - 16, (uint64_t)(size >> 61));
+    store_be64(last + padded - 8, (uint64_t)size << 3);
+    sha512_blocks(state, last, padded / SHA512_BLOCK_SIZE);
+
+    for (int i = 0; i < 8; i++) {
+        store_be64(digest + 8*i, state[i]);
     }
 }
+
+// The implementation is selected once at load time, not on each call.
+static const armdispatch_variant_t sha512_variants[] = {
+    ARMDISPATCH_VARIANT(sha512_accel, &sha512_accel_compiled, ARMDISPATCH_SHA512),
+    ARMDISPATCH_VARIANT(sha512_portable, NULL, 0),
+};
+
+ARMDISPATCH(void, sha512_blocks, (uint64_t state[8], const uint8_t* data, size_t blocks), (state, data, blocks), sha512_variants)
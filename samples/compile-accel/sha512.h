@@ -1,7 +1,19 @@
 #if !defined(SHA512_H)
 #define SHA512_H 1
 
-// Hypothetical SHA-512 function.
-void sha512();
+#include <stdint.h>
+#include <stddef.h>
+
+#define SHA512_BLOCK_SIZE  128
+#define SHA512_DIGEST_SIZE 64
+
+// Compute the SHA-512 hash of a message.
+void sha512(const void* data, size_t size, uint8_t digest[SHA512_DIGEST_SIZE]);
+
+// SHA-512 compression function on complete blocks.
+void sha512_blocks(uint64_t state[8], const uint8_t* data, size_t blocks);
+
+// Round constants, shared by all implementations.
+extern const uint64_t sha512_k[80];
 
 #endif // SHA512_H
@@ -1,25 +1,102 @@
 #include "sha512_accel.h"
+#include "sha512.h"
 #include <assert.h>
-#include <stdio.h>
 
 #if defined(__ARM_FEATURE_SHA512)
 
+    #include <arm_neon.h>
+
+    // Compute the next two message words in s0 from the previous 16 ones in s0..s7.
+    #define SHA512_SCHEDULE(s0, s1, s4, s5, s7) \
+        s0 = vsha512su1q_u64(vsha512su0q_u64(s0, s1), s7, vextq_u64(s4, s5, 1))
+
+    // Two rounds. The roles of the four state vectors rotate from one call to the next.
+    #define SHA512_ROUNDS2(ab, cd, ef, gh, s, k)                                                    \
+        do {                                                                                        \
+            const uint64_t* _k = (k);                                                               \
+            const uint64x2_t _sk = vaddq_u64((s), vld1q_u64(_k));                                   \
+            const uint64x2_t _sum = vaddq_u64(vextq_u64(_sk, _sk, 1), gh);                          \
+            const uint64x2_t _t = vsha512hq_u64(_sum, vextq_u64(ef, gh, 1), vextq_u64(cd, ef, 1));  \
+            gh = vsha512h2q_u64(_t, cd, ab);                                                        \
+            cd = vaddq_u64(cd, _t);                                                                 \
+        } while (0)
+
     const int sha512_accel_compiled = 1;
-    void sha512_accel()
+    void sha512_accel(uint64_t state[8], const uint8_t* data, size_t blocks)
     {
-        printf("sha512(): accelerated implementation\n");
-        // Dummy SHA-512 instruction, just to demonstrate it is accepted by the compiler.
-        asm("sha512su0 v8.2D, v8.2D" : : : "v8");
+        uint64x2_t ab = vld1q_u64(state);
+        uint64x2_t cd = vld1q_u64(state + 2);
+        uint64x2_t ef = vld1q_u64(state + 4);
+        uint64x2_t gh = vld1q_u64(state + 6);
+
+        for (; blocks > 0; blocks--, data += SHA512_BLOCK_SIZE) {
+            const uint64x2_t ab_saved = ab, cd_saved = cd, ef_saved = ef, gh_saved = gh;
+
+            // Message schedule, 2 words per vector, big-endian.
+            uint64x2_t s0 = vreinterpretq_u64_u8(vrev64q_u8(vld1q_u8(data)));
+            uint64x2_t s1 = vreinterpretq_u64_u8(vrev64q_u8(vld1q_u8(data + 16)));
+            uint64x2_t s2 = vreinterpretq_u64_u8(vrev64q_u8(vld1q_u8(data + 32)));
+            uint64x2_t s3 = vreinterpretq_u64_u8(vrev64q_u8(vld1q_u8(data + 48)));
+            uint64x2_t s4 = vreinterpretq_u64_u8(vrev64q_u8(vld1q_u8(data + 64)));
+            uint64x2_t s5 = vreinterpretq_u64_u8(vrev64q_u8(vld1q_u8(data + 80)));
+            uint64x2_t s6 = vreinterpretq_u64_u8(vrev64q_u8(vld1q_u8(data + 96)));
+            uint64x2_t s7 = vreinterpretq_u64_u8(vrev64q_u8(vld1q_u8(data + 112)));
+
+            // 5 groups of 16 rounds.
+            for (int t = 0; t < 80; t += 16) {
+                if (t > 0) {
+                    SHA512_SCHEDULE(s0, s1, s4, s5, s7);
+                }
+                SHA512_ROUNDS2(ab, cd, ef, gh, s0, sha512_k + t);
+                if (t > 0) {
+                    SHA512_SCHEDULE(s1, s2, s5, s6, s0);
+                }
+                SHA512_ROUNDS2(gh, ab, cd, ef, s1, sha512_k + t + 2);
+                if (t > 0) {
+                    SHA512_SCHEDULE(s2, s3, s6, s7, s1);
+                }
+                SHA512_ROUNDS2(ef, gh, ab, cd, s2, sha512_k + t + 4);
+                if (t > 0) {
+                    SHA512_SCHEDULE(s3, s4, s7, s0, s2);
+                }
+                SHA512_ROUNDS2(cd, ef, gh, ab, s3, sha512_k + t + 6);
+                if (t > 0) {
+                    SHA512_SCHEDULE(s4, s5, s0, s1, s3);
+                }
+                SHA512_ROUNDS2(ab, cd, ef, gh, s4, sha512_k + t + 8);
+                if (t > 0) {
+                    SHA512_SCHEDULE(s5, s6, s1, s2, s4);
+                }
+                SHA512_ROUNDS2(gh, ab, cd, ef, s5, sha512_k + t + 10);
+                if (t > 0) {
+                    SHA512_SCHEDULE(s6, s7, s2, s3, s5);
+                }
+                SHA512_ROUNDS2(ef, gh, ab, cd, s6, sha512_k + t + 12);
+                if (t > 0) {
+                    SHA512_SCHEDULE(s7, s0, s3, s4, s6);
+                }
+                SHA512_ROUNDS2(cd, ef, gh, ab, s7, sha512_k + t + 14);
+            }
+
+            ab = vaddq_u64(ab, ab_saved);
+            cd = vaddq_u64(cd, cd_saved);
+            ef = vaddq_u64(ef, ef_saved);
+            gh = vaddq_u64(gh, gh_saved);
+        }
+
+        vst1q_u64(state, ab);
+        vst1q_u64(state + 2, cd);
+        vst1q_u64(state + 4, ef);
+        vst1q_u64(state + 6, gh);
     }
 
 #else
 
     const int sha512_accel_compiled = 0;
-    void sha512_accel()
+    void sha512_accel(uint64_t state[8], const uint8_t* data, size_t blocks)
     {
         // Should never be called if the CPU does not support the compilation target of this module;
-        printf("sha512(): ACCELERATED IMPLEMENTATION SHOULD NOT GET CALLED !\n");
         assert(0);
     }
-    
+
 #endif
@@ -1,10 +1,13 @@
 #if !defined(SHA512_ACCEL_H)
 #define SHA512_ACCEL_H 1
 
+#include <stdint.h>
+#include <stddef.h>
+
 // Boolean: indicate if this module could be compiled with accelerated instructions.
 extern const int sha512_accel_compiled;
 
-// Accelerated SHA-512 function.
-void sha512_accel();
+// Accelerated SHA-512 compression function.
+void sha512_accel(uint64_t state[8], const uint8_t* data, size_t blocks);
 
 #endif // SHA512_ACCEL_H
@@ -1,19 +1,241 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "crc.h"
+#include "crc32c.h"
 #include "aes.h"
 #include "sha1.h"
 #include "sha256.h"
 #include "sha512.h"
 #include "sha3.h"
+#include "armdispatch.h"
+
+// Compare a result with a known answer, display the name of the implementation.
+static int check_impl(const char* title, const char* impl, const uint8_t* result, size_t size, const char* expected)
+{
+    char hexa[2 * SHA512_DIGEST_SIZE + 1];
+    for (size_t i = 0; i < size && 2 * i + 2 < sizeof(hexa); i++) {
+        snprintf(hexa + 2 * i, 3, "%02x", result[i]);
+    }
+    const int ok = strcmp(hexa, expected) == 0;
+    printf("%-20s %s, %s\n", title, ok ? "ok" : "FAILED", impl);
+    return ok;
+}
+
+// Same with the selected implementation of a dispatched function.
+static int check(const char* title, const char* function, const uint8_t* result, size_t size, const char* expected)
+{
+    return check_impl(title, armdispatch_selected(function), result, size, expected);
+}
+
+// Same with a CRC value, displayed in big-endian order.
+static int check_crc_impl(const char* title, const char* impl, uint32_t crc, const char* expected)
+{
+    const uint8_t bytes[4] = {(uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc};
+    return check_impl(title, impl, bytes, sizeof(bytes), expected);
+}
+
+static int check_crc(const char* title, const char* function, uint32_t crc, const char* expected)
+{
+    return check_crc_impl(title, armdispatch_selected(function), crc, expected);
+}
+
+// Test data for the long and multi-buffer tests, the expected values come from Python
+// (hashlib and zlib): bytes((i * 31 + (i >> 8)) & 0xFF for i in range(size)).
+static uint8_t pattern[8192];
+
+// Implementations of the dispatched functions which are individually tested.
+typedef void (*aes_func_t)(const aes_key_t* key, uint8_t counter[AES_BLOCK_SIZE], const void* in, void* out, size_t size);
+typedef uint32_t (*crc32c_func_t)(uint32_t crc, const void* data, size_t size);
+
+// Get the usable implementation 'index' of a dispatched function, NULL if not usable.
+static const armdispatch_variant_t* usable_variant(const char* function, size_t index, char* title, size_t title_size)
+{
+    const armdispatch_symbol_t* sym = armdispatch_find(function);
+    if (sym == NULL || index >= sym->count) {
+        return NULL;
+    }
+    snprintf(title, title_size, "%s():", sym->variants[index].name);
+    if (!armdispatch_usable(&sym->variants[index])) {
+        printf("%-20s skipped, not supported\n", title);
+        return NULL;
+    }
+    return &sym->variants[index];
+}
+
+// Number of implementations of a dispatched function.
+static size_t variant_count(const char* function)
+{
+    const armdispatch_symbol_t* sym = armdispatch_find(function);
+    return sym == NULL ? 0 : sym->count;
+}
+
+static void init_pattern(void)
+{
+    for (size_t i = 0; i < sizeof(pattern); i++) {
+        pattern[i] = (uint8_t)(i * 31 + (i >> 8));
+    }
+}
 
 int main(int argc, char* argv[])
 {
-    crc();
-    aes();
-    sha1();
-    sha256();
-    sha512();
-    sha3();
-    return EXIT_SUCCESS;
+    int ok = 1;
+    uint8_t result[SHA512_DIGEST_SIZE];
+    char title[32];
+
+    init_pattern();
+
+    ok &= check_crc("crc():", "crc", crc(0, "123456789", 9), "cbf43926");
+
+    // Multi-buffer CRC of 7 distinct buffers of distinct sizes: one group of 4, one of 2, one alone.
+    static const char* const crc_multi_expected[7] = {
+        "4acdbfc8", "5af6e15e", "8fe1eec6", "489254e0", "1bf0af30", "0203ab64", "11c4227e",
+    };
+    const void* crc_data[7];
+    size_t crc_sizes[7];
+    uint32_t crcs[7];
+    for (size_t j = 0; j < 7; j++) {
+        crc_data[j] = pattern + 3 * j;
+        crc_sizes[j] = 300 + 13 * j;
+        crcs[j] = 0;
+    }
+    crc_multi(crcs, crc_data, crc_sizes, 7);
+    for (size_t j = 0; j < 7; j++) {
+        snprintf(title, sizeof(title), "crc_multi()[%zu]:", j);
+        ok &= check_crc(title, j < 4 ? "crc_x4" : (j < 6 ? "crc_x2" : "crc"), crcs[j], crc_multi_expected[j]);
+    }
+
+    // Interleaved CRC of 4 and 2 buffers of 256 bytes, each lane is checked.
+    static const char* const crc_x_expected[4] = {"9cb64e90", "27c29df8", "565b28cc", "c3a3572e"};
+    const uint8_t* const crc_x_data[4] = {pattern, pattern + 64, pattern + 128, pattern + 192};
+    uint32_t crc_x[4] = {0, 0, 0, 0};
+    crc_x4(crc_x, crc_x_data, 256);
+    for (size_t j = 0; j < 4; j++) {
+        snprintf(title, sizeof(title), "crc_x4()[%zu]:", j);
+        ok &= check_crc(title, "crc_x4", crc_x[j], crc_x_expected[j]);
+    }
+    crc_x[0] = crc_x[1] = 0;
+    crc_x2(crc_x, crc_x_data + 2, 256);
+    for (size_t j = 0; j < 2; j++) {
+        snprintf(title, sizeof(title), "crc_x2()[%zu]:", j);
+        ok &= check_crc(title, "crc_x2", crc_x[j], crc_x_expected[j + 2]);
+    }
+
+    ok &= check_crc("crc32c():", "crc32c", crc32c(0, "123456789", 9), "e3069283");
+
+    // Long enough for the PMULL folding path (128 bytes and more).
+    ok &= check_crc("crc32c(512):", "crc32c", crc32c(0, pattern, 512), "0608342e");
+
+    // Each usable implementation, called directly, on 4099 bytes: longer than the 8 vectors which
+    // are needed by the SVE fold with the longest vectors (2048 bits), plus an unaligned tail.
+    for (size_t v = 0; v < variant_count("crc32c"); v++) {
+        const armdispatch_variant_t* var = usable_variant("crc32c", v, title, sizeof(title));
+        if (var != NULL) {
+            ok &= check_crc_impl(title, var->name, ((crc32c_func_t)var->func)(0, pattern, 4099), "03211760");
+        }
+    }
+
+    // Test vector from NIST SP 800-38A, F.5.1, CTR-AES128.Encrypt, first block.
+    static const uint8_t key[AES_KEY_SIZE] = {0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+    static const uint8_t plain[AES_BLOCK_SIZE] = {0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A};
+    uint8_t counter[AES_BLOCK_SIZE] = {0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF};
+    aes_key_t ekey;
+    aes_init(&ekey, key);
+    aes(&ekey, counter, plain, result, sizeof(plain));
+    ok &= check("aes():", "aes", result, AES_BLOCK_SIZE, "874d6191b620e3261bef6864990db6ce");
+
+    // Each usable implementation, called directly, including aes_sve(): the 4 blocks of F.5.1,
+    // then 1000 bytes, more than the 16 blocks in the longest SVE vectors, with a partial block.
+    // The digest of the long output comes from "openssl enc -aes-128-ctr" and sha256sum.
+    static const uint8_t plain4[4 * AES_BLOCK_SIZE] = {
+        0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A,
+        0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03, 0xAC, 0x9C, 0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51,
+        0x30, 0xC8, 0x1C, 0x46, 0xA3, 0x5C, 0xE4, 0x11, 0xE5, 0xFB, 0xC1, 0x19, 0x1A, 0x0A, 0x52, 0xEF,
+        0xF6, 0x9F, 0x24, 0x45, 0xDF, 0x4F, 0x9B, 0x17, 0xAD, 0x2B, 0x41, 0x7B, 0xE6, 0x6C, 0x37, 0x10,
+    };
+    static uint8_t aes_long[1000];
+    for (size_t v = 0; v < variant_count("aes"); v++) {
+        const armdispatch_variant_t* var = usable_variant("aes", v, title, sizeof(title));
+        if (var != NULL) {
+            for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+                counter[i] = (uint8_t)(0xF0 + i);
+            }
+            ((aes_func_t)var->func)(&ekey, counter, plain4, result, sizeof(plain4));
+            ok &= check_impl(title, var->name, result, sizeof(plain4),
+                             "874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff"
+                             "5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170a0f3009cee");
+            for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+                counter[i] = (uint8_t)(0xF0 + i);
+            }
+            ((aes_func_t)var->func)(&ekey, counter, pattern, aes_long, sizeof(aes_long));
+            sha256(aes_long, sizeof(aes_long), result);
+            snprintf(title, sizeof(title), "%s(1000):", var->name);
+            ok &= check_impl(title, var->name, result, SHA256_DIGEST_SIZE, "6117d4ce4f4adc9977f717e3722c50349466771771cd4b150dec1fdd7e5d09de");
+        }
+    }
+
+    sha1("abc", 3, result);
+    ok &= check("sha1():", "sha1_blocks", result, SHA1_DIGEST_SIZE, "a9993e364706816aba3e25717850c26c9cd0d89d");
+
+    sha256("abc", 3, result);
+    ok &= check("sha256():", "sha256_blocks", result, SHA256_DIGEST_SIZE, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+    // Multi-buffer hash of 7 distinct messages of distinct sizes (2 to 4 blocks): one group of 4,
+    // one of 2, one alone. Each digest is checked, a lane mix-up or a missing lane is detected.
+    static const char* const sha256_multi_expected[7] = {
+        "b373e5ece6eaec264a9f01e5d03c8a7f212a7828d80df079b87059644e33153c",
+        "946e2d7b10e794a3797ddb75cbe7609f9e501d3dffc1a4fc2f43002400fa1639",
+        "73c93779b4b30d34db9d6c7bd92505de7a3931c6eddcca79efd80c89b11846f0",
+        "09455d7bba49396658a94c11c630743e2ba537e1993f9146b701752e0677b425",
+        "63990545db1f56355ff8bea181d9fab7da5c85b0bfb2eaa41789fe8337706bcf",
+        "d25f29108bf249761c7c905f7c4b8ca3ad48dfa788b0b6f402efc0f7f2052c94",
+        "bac60ec40dc872954da2608163271c2207507ee5aa8cf1701b5abc58a9fba602",
+    };
+    const void* messages[7];
+    size_t sizes[7];
+    uint8_t digests[7][SHA256_DIGEST_SIZE];
+    memset(digests, 0, sizeof(digests));
+    for (size_t j = 0; j < 7; j++) {
+        messages[j] = pattern + 5 * j;
+        sizes[j] = 130 + 17 * j;
+    }
+    sha256_multi(messages, sizes, digests, 7);
+    for (size_t j = 0; j < 7; j++) {
+        snprintf(title, sizeof(title), "sha256_multi()[%zu]:", j);
+        ok &= check(title, j < 4 ? "sha256_blocks_x4" : (j < 6 ? "sha256_blocks_x2" : "sha256_blocks"), digests[j], SHA256_DIGEST_SIZE, sha256_multi_expected[j]);
+    }
+
+    sha512("abc", 3, result);
+    ok &= check("sha512():", "sha512_blocks", result, SHA512_DIGEST_SIZE,
+                "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f");
+
+    sha3("abc", 3, result);
+    ok &= check("sha3():", "sha3_blocks", result, SHA3_DIGEST_SIZE, "3a985da74fe225b2045c172d6bd390bd855f086e3e9d525b46bfe24511431532");
+
+    // Multi-buffer hash of 8 distinct messages of distinct sizes (1 to 3 blocks), each digest is checked.
+    static const char* const sha3_multi_expected[8] = {
+        "9cf2138ce5902156bf85d5f6998601c9507af88f20fbc037881dc1ef796b002b",
+        "432e7d397026c40c1ac0472cbb01348453a0b16c87e6fe0f3acddaeff03b4db2",
+        "e28428f0f3e0e18b2ed0f17f1fe337f2a2d83ae6182c34b20ab971153dc869e3",
+        "b1f95374ee980ebc7d1ff2a58713f125186d3b00c05842a4186bebbe58b312f0",
+        "afd44606e63d9ff6e84df8b1a7d8d22d48817514e0c1f75a5a2f37a926919a4c",
+        "e983426f2d44a445818c4501c97a42fdf1acea1cdf781a98f82d40b36fc9c631",
+        "1f5f86a2f5b6fd5d529d262ff22fe5967fd1504799a9f550794408cc36a11c19",
+        "a67645735ef5859f7e3a3ba35a2b649e9ae0d66705cc4d6b16e787479f4ff984",
+    };
+    const void* sha3_messages[8];
+    size_t sha3_sizes[8];
+    uint8_t sha3_digests[8][SHA3_DIGEST_SIZE];
+    memset(sha3_digests, 0, sizeof(sha3_digests));
+    for (size_t j = 0; j < 8; j++) {
+        sha3_messages[j] = pattern + 7 * j;
+        sha3_sizes[j] = 150 + 29 * j;
+    }
+    sha3_multi(sha3_messages, sha3_sizes, sha3_digests, 8);
+    for (size_t j = 0; j < 8; j++) {
+        snprintf(title, sizeof(title), "sha3_multi()[%zu]:", j);
+        ok &= check(title, "sha3_blocks_multi", sha3_digests[j], SHA3_DIGEST_SIZE, sha3_multi_expected[j]);
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,251 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Throughput cost of PSTATE.DIT and PSTATE.SSBS on the cryptographic kernels
+// of compile-accel and on generic integer loops.
+//
+// The modes are run alternately on each kernel and the median time of each
+// mode is kept, to reduce the effect of the frequency changes. The output is
+// in CSV format, comment lines start with '#'. The delta is relative to the
+// reference mode (DIT clear, SSBS set, the fastest one).
+//
+//----------------------------------------------------------------------------
+
+#include "pstate.h"
+#include "userfeatures.h"
+
+extern "C" {
+#include "armdispatch.h"
+#include "armtimer.h"
+#include "aes.h"
+#include "sha1.h"
+#include "sha256.h"
+#include "sha512.h"
+#include "sha3.h"
+}
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Modes, the first one is the reference.
+struct Mode {
+    const char* name;
+    bool        dit;
+    bool        ssbs;
+};
+static const Mode Modes[] = {
+    {"reference",      false, true},
+    {"dit",            true,  true},
+    {"ssbs-clear",     false, false},
+    {"dit-ssbs-clear", true,  false},
+};
+static constexpr size_t ModeCount = sizeof(Modes) / sizeof(Modes[0]);
+
+// A kernel processes the complete input buffer.
+struct Kernel {
+    std::string           name;
+    std::string           variant;
+    std::function<void()> run;
+};
+
+// Prevent the compiler from removing the integer loops.
+static volatile uint64_t sink;
+
+// Input and output buffers, and the AES key.
+static std::vector<uint8_t> input;
+static std::vector<uint8_t> output;
+static aes_key_t aes_key;
+
+
+//----------------------------------------------------------------------------
+// Cryptographic kernels: all usable implementations of the dispatched functions.
+//----------------------------------------------------------------------------
+
+static std::function<void()> CryptoAdapter(const std::string& name, armdispatch_func_t func)
+{
+    if (name == "aes") {
+        return [func]() {
+            uint8_t counter[AES_BLOCK_SIZE] = {0};
+            ((void (*)(const aes_key_t*, uint8_t*, const void*, void*, size_t))func)(&aes_key, counter, input.data(), output.data(), input.size());
+        };
+    }
+    else if (name == "sha1_blocks") {
+        return [func]() {
+            uint32_t state[5] = {0};
+            ((void (*)(uint32_t*, const uint8_t*, size_t))func)(state, input.data(), input.size() / SHA1_BLOCK_SIZE);
+            sink = state[0];
+        };
+    }
+    else if (name == "sha256_blocks") {
+        return [func]() {
+            uint32_t state[8] = {0};
+            ((void (*)(uint32_t*, const uint8_t*, size_t))func)(state, input.data(), input.size() / SHA256_BLOCK_SIZE);
+            sink = state[0];
+        };
+    }
+    else if (name == "sha512_blocks") {
+        return [func]() {
+            uint64_t state[8] = {0};
+            ((void (*)(uint64_t*, const uint8_t*, size_t))func)(state, input.data(), input.size() / SHA512_BLOCK_SIZE);
+            sink = state[0];
+        };
+    }
+    else if (name == "sha3_blocks") {
+        return [func]() {
+            uint64_t state[25] = {0};
+            ((void (*)(uint64_t*, const uint8_t*, size_t))func)(state, input.data(), input.size() / SHA3_BLOCK_SIZE);
+            sink = state[0];
+        };
+    }
+    return nullptr;
+}
+
+static void AddCryptoKernels(std::vector<Kernel>& kernels)
+{
+    for (const char* name : {"aes", "sha1_blocks", "sha256_blocks", "sha512_blocks", "sha3_blocks"}) {
+        const armdispatch_symbol_t* sym = armdispatch_find(name);
+        for (size_t i = 0; sym != nullptr && i < sym->count; i++) {
+            if (armdispatch_usable(&sym->variants[i])) {
+                kernels.push_back({name, sym->variants[i].name, CryptoAdapter(name, sym->variants[i].func)});
+            }
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Generic integer loops.
+//----------------------------------------------------------------------------
+
+// Dependent chain of additions, exclusive or and rotations.
+static void IntAlu()
+{
+    uint64_t x = 0x9E3779B97F4A7C15;
+    for (size_t i = 0; i + 8 <= input.size(); i += 8) {
+        uint64_t v;
+        std::memcpy(&v, &input[i], sizeof(v));
+        x = ((x ^ v) + ((x << 13) | (x >> 51))) ^ (v >> 7);
+    }
+    sink = x;
+}
+
+// Dependent chain of multiplications, some cores shorten them on small operands without DIT.
+static void IntMul()
+{
+    uint64_t x = 1;
+    for (size_t i = 0; i + 8 <= input.size(); i += 8) {
+        uint64_t v;
+        std::memcpy(&v, &input[i], sizeof(v));
+        x = x * (v | 1) + (v >> 32);
+    }
+    sink = x;
+}
+
+// Histogram: each load may alias the previous stores, the bypass is not allowed with SSBS clear.
+static void StoreLoad()
+{
+    uint32_t histo[256] = {0};
+    for (size_t i = 0; i < input.size(); i++) {
+        histo[input[i]]++;
+    }
+    sink = histo[input[0]];
+}
+
+static void AddIntegerKernels(std::vector<Kernel>& kernels)
+{
+    kernels.push_back({"int-alu", "generic", IntAlu});
+    kernels.push_back({"int-mul", "generic", IntMul});
+    kernels.push_back({"store-load", "generic", StoreLoad});
+}
+
+
+//----------------------------------------------------------------------------
+// Time one run of a kernel in a mode, in nanoseconds. Return a negative
+// value if the mode cannot be set on this CPU.
+//----------------------------------------------------------------------------
+
+static double TimeInMode(const Kernel& kernel, const Mode& mode)
+{
+    // Without DIT or SSBS, only the modes with the default value are meaningful.
+    if ((mode.dit && !ScopedDIT::supported()) || (!mode.ssbs && !ScopedSSBS::supported())) {
+        return -1.0;
+    }
+    ScopedDIT dit(mode.dit);
+    ScopedSSBS ssbs(mode.ssbs);
+    if ((ScopedDIT::supported() && !dit.applied()) || (ScopedSSBS::supported() && !ssbs.applied())) {
+        return -1.0;
+    }
+    const uint64_t start = armtimer_counter();
+    kernel.run();
+    const uint64_t ticks = armtimer_counter() - start;
+    return double(ticks) * 1e9 / double(armtimer_frequency());
+}
+
+
+//----------------------------------------------------------------------------
+// Program entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    // Optional parameters: buffer size and number of samples per kernel and mode.
+    const size_t size = argc > 1 ? std::max<size_t>(1024, std::strtoul(argv[1], nullptr, 0)) : 64 * 1024;
+    const size_t samples = argc > 2 ? std::max<size_t>(1, std::strtoul(argv[2], nullptr, 0)) : 21;
+
+    // The buffer size is a multiple of all block sizes.
+    input.resize(size - size % (SHA3_BLOCK_SIZE * SHA512_BLOCK_SIZE) + SHA3_BLOCK_SIZE * SHA512_BLOCK_SIZE);
+    output.resize(input.size());
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = uint8_t(i * 131 + (i >> 9));
+    }
+    const uint8_t key[AES_KEY_SIZE] = {0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+    aes_init(&aes_key, key);
+
+    std::vector<Kernel> kernels;
+    AddCryptoKernels(kernels);
+    AddIntegerKernels(kernels);
+
+    std::printf("# dit,%d,%d\n", int(ScopedDIT::supported()), int(ScopedDIT::get()));
+    std::printf("# ssbs,%d,%d\n", int(ScopedSSBS::supported()), int(ScopedSSBS::get()));
+    std::printf("# size,%zu\n", input.size());
+    std::printf("kernel,variant,mode,median_ns,bytes_per_ns,delta_percent\n");
+
+    for (const auto& k : kernels) {
+        // Warm up, then run all modes alternately.
+        k.run();
+        std::vector<double> ns[ModeCount];
+        for (size_t s = 0; s < samples; s++) {
+            for (size_t m = 0; m < ModeCount; m++) {
+                const double t = TimeInMode(k, Modes[m]);
+                if (t >= 0) {
+                    ns[m].push_back(t);
+                }
+            }
+        }
+        double ref = 0;
+        for (size_t m = 0; m < ModeCount; m++) {
+            if (ns[m].empty()) {
+                std::printf("# %s,%s,%s not supported\n", k.name.c_str(), k.variant.c_str(), Modes[m].name);
+                continue;
+            }
+            std::sort(ns[m].begin(), ns[m].end());
+            const double median = ns[m][ns[m].size() / 2];
+            if (m == 0) {
+                ref = median;
+            }
+            std::printf("%s,%s,%s,%.0f,%.3f,%+.2f\n", k.name.c_str(), k.variant.c_str(), Modes[m].name, median,
+                        median > 0 ? double(input.size()) / median : 0.0,
+                        ref > 0 ? (median / ref - 1.0) * 100.0 : 0.0);
+        }
+    }
+    return EXIT_SUCCESS;
+}